@@ -128,6 +128,10 @@ static void reset_queue_stub()
 {
     queue_stub.event_handler = NULL;
     queue_stub.head = NULL,
+#if MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
+    queue_stub.count = 0;
+    queue_stub.sequence = 0;
+#endif
     queue_stub.tick_last_read = 0;
     queue_stub.tick_remainder = 0;
     queue_stub.frequency = 0;
@@ -251,6 +255,9 @@ static void test_ticker_initialization()
     TEST_ASSERT_EQUAL(0, interface_stub.disable_interrupt_call);
 }
 
+// Tests walking the queue through the next pointers only apply to the
+// sorted list, the ticker-event-heap option orders events in a heap
+#if !MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
 /**
  * Given an initialized ticker_data instance.
  * When the ticker handler is set to a new value
@@ -288,6 +295,7 @@ static void test_ticker_re_initialization()
     TEST_ASSERT_EQUAL(NULL, queue_stub.head->next->next->next);
     TEST_ASSERT_EQUAL(0, interface_stub.disable_interrupt_call);
 }
+#endif
 
 /**
  * Given an initialized ticker_data instance.
@@ -358,6 +366,7 @@ static void test_ticker_read_overflow()
     TEST_ASSERT_EQUAL(0, interface_stub.disable_interrupt_call);
 }
 
+#if !MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
 /**
  * Given an initialized ticker without user registered events.
  * When an event is inserted with ticker_insert_event and the timestamp passed
@@ -981,6 +990,7 @@ static void test_insert_event_us_in_overflow_range()
 
     TEST_ASSERT_EQUAL(0, interface_stub.disable_interrupt_call);
 }
+#endif
 
 /**
  * Given an initialized ticker without user registered events.
@@ -1016,6 +1026,7 @@ static void test_insert_event_us_underflow()
     TEST_ASSERT_EQUAL(0, interface_stub.disable_interrupt_call);
 }
 
+#if !MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
 /**
  * Given an initialized ticker.
  * When an event is inserted with ticker_insert_event_us and a timestamp less
@@ -1529,6 +1540,7 @@ static void test_remove_random()
 
     TEST_ASSERT_EQUAL(0, interface_stub.disable_interrupt_call);
 }
+#endif
 
 /**
  * Given an initialized ticker without user registered events and a ticker
@@ -1718,6 +1730,7 @@ static void test_irq_handler_single_event_spurious()
     TEST_ASSERT_EQUAL(0, interface_stub.disable_interrupt_call);
 }
 
+#if !MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
 /**
  * Given an initialized ticker with multiple ticker event inserted, its
  * interface timestamp at greater than the timestamp of the next schedule event
@@ -1781,6 +1794,7 @@ static void test_irq_handler_multiple_event_multiple_dequeue()
 
     TEST_ASSERT_EQUAL(0, interface_stub.disable_interrupt_call);
 }
+#endif
 
 /**
  * Given an initialized ticker with two ticker event inserted scheduled from more
@@ -2045,7 +2059,9 @@ static void test_irq_handler_insert_non_immediate_in_irq()
         interface_stub.interrupt_timestamp
     );
     TEST_ASSERT_EQUAL_PTR(&ctrl_block.non_immediate_event, queue_stub.head);
+#if !MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
     TEST_ASSERT_EQUAL_PTR(&events[1], queue_stub.head->next);
+#endif
 
     TEST_ASSERT_EQUAL(0, interface_stub.disable_interrupt_call);
 }
@@ -2346,11 +2362,14 @@ static void test_suspend_resume()
 
 static const case_t cases[] = {
     MAKE_TEST_CASE("ticker initialization", test_ticker_initialization),
+#if !MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
     MAKE_TEST_CASE(
         "ticker multiple initialization",  test_ticker_re_initialization
     ),
+#endif
     MAKE_TEST_CASE("ticker read", test_ticker_read),
     MAKE_TEST_CASE("ticker read overflow", test_ticker_read_overflow),
+#if !MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
     MAKE_TEST_CASE(
         "legacy insert event outside overflow range",
         test_legacy_insert_event_outside_overflow_range
@@ -2384,9 +2403,11 @@ static const case_t cases[] = {
         "test_insert_event_us_in_overflow_range",
         test_insert_event_us_in_overflow_range
     ),
+#endif
     MAKE_TEST_CASE(
         "test_insert_event_us_underflow", test_insert_event_us_underflow
     ),
+#if !MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
     MAKE_TEST_CASE("test_insert_event_us_head", test_insert_event_us_head),
     MAKE_TEST_CASE("test_insert_event_us_tail", test_insert_event_us_tail),
     MAKE_TEST_CASE(
@@ -2397,6 +2418,7 @@ static const case_t cases[] = {
     MAKE_TEST_CASE("test_remove_event_head", test_remove_event_head),
     MAKE_TEST_CASE("test_remove_event_invalid", test_remove_event_invalid),
     MAKE_TEST_CASE("test_remove_random", test_remove_random),
+#endif
     MAKE_TEST_CASE("update overflow guard", test_overflow_event_update),
     MAKE_TEST_CASE(
         "update overflow guard in case of spurious interrupt",
@@ -2409,10 +2431,12 @@ static const case_t cases[] = {
         "test_irq_handler_single_event_spurious",
         test_irq_handler_single_event_spurious
     ),
+#if !MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
     MAKE_TEST_CASE(
         "test_irq_handler_multiple_event_multiple_dequeue",
         test_irq_handler_multiple_event_multiple_dequeue
     ),
+#endif
     MAKE_TEST_CASE(
         "test_irq_handler_multiple_event_single_dequeue_overflow",
         test_irq_handler_multiple_event_single_dequeue_overflow
@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "QSPIFlashSim.h"
+
+#define SIM_WRSR    0x01
+#define SIM_PP      0x02
+#define SIM_READ    0x03
+#define SIM_WRDI    0x04
+#define SIM_RDSR    0x05
+#define SIM_WREN    0x06
+#define SIM_SE      0x20
+#define SIM_WRSR2   0x31
+#define SIM_QPP     0x32
+#define SIM_RDSR2   0x35
+#define SIM_SFDP    0x5a
+#define SIM_RSTEN   0x66
+#define SIM_QREAD   0x6b
+#define SIM_RST     0x99
+#define SIM_RDID    0x9f
+#define SIM_EN4B    0xb7
+#define SIM_BE      0xd8
+#define SIM_QIOREAD 0xeb
+
+#define SIM_STATUS_WIP  0x01
+#define SIM_STATUS_WEL  0x02
+#define SIM_STATUS2_QE  0x02
+
+#define SIM_BASIC_TABLE_ADDR        0x30
+#define SIM_SECTOR_MAP_TABLE_ADDR   0x80
+#define SIM_BOOT_REGION_SIZE        (64 * 1024)
+#define SIM_ERASE_POLLS_FACTOR      4
+
+QSPIFlashSim *QSPIFlashSim::instance = NULL;
+
+QSPIFlashSim::QSPIFlashSim(uint32_t size, int features)
+    : memory(new uint8_t[size]), memory_size(size), four_byte_mode(false), _write_enabled(false),
+      _reset_enabled(false), _busy_polls(0), _program_polls(2)
+{
+    memset(memory, 0xFF, size);
+    _status[0] = 0;
+    _status[1] = 0;
+
+    // SFDP header: signature, revision 1.6 and the parameter headers
+    memset(_sfdp, 0xFF, sizeof(_sfdp));
+    memcpy(_sfdp, "SFDP", 4);
+    _sfdp[4] = 6;
+    _sfdp[5] = 1;
+    _sfdp[6] = (features & QSPI_FLASH_SIM_SECTOR_MAP) ? 1 : 0;
+    _sfdp[7] = 0xFF;
+
+    // JEDEC Basic Flash Parameter header: 16 DWORDs at SIM_BASIC_TABLE_ADDR
+    _sfdp[8] = 0x00;
+    _sfdp[9] = 6;
+    _sfdp[10] = 1;
+    _sfdp[11] = 16;
+    _sfdp[12] = SIM_BASIC_TABLE_ADDR;
+    _sfdp[13] = 0;
+    _sfdp[14] = 0;
+    _sfdp[15] = 0xFF;
+
+    // Sector Map header: a single map descriptor with two regions
+    _sfdp[16] = 0x81;
+    _sfdp[17] = 0;
+    _sfdp[18] = 1;
+    _sfdp[19] = 3;
+    _sfdp[20] = SIM_SECTOR_MAP_TABLE_ADDR;
+    _sfdp[21] = 0;
+    _sfdp[22] = 0;
+    _sfdp[23] = 0xFF;
+
+    uint8_t *table = &_sfdp[SIM_BASIC_TABLE_ADDR];
+    memset(table, 0, 64);
+    table[0] = 0xE5;
+    table[1] = SIM_SE;          // Legacy 4KB erase instruction
+    table[2] = 0x00;
+    if (size > 16 * 1024 * 1024) {
+        table[2] |= 1 << 1;     // 3 or 4 byte addressing
+        table[63] = 0x01;       // Enter 4-byte addressing with B7h
+    }
+    if (features & QSPI_FLASH_SIM_READ_1_4_4) {
+        table[2] |= 0x20;
+        table[8] = (2 << 5) | 4;  // 2 mode cycles, 4 wait states
+        table[9] = SIM_QIOREAD;
+    }
+    if (features & QSPI_FLASH_SIM_READ_1_1_4) {
+        table[2] |= 0x40;
+        table[10] = (0 << 5) | 8; // 0 mode cycles, 8 wait states
+        table[11] = SIM_QREAD;
+    }
+    uint32_t density = size * 8 - 1;
+    table[4] = density & 0xFF;
+    table[5] = (density >> 8) & 0xFF;
+    table[6] = (density >> 16) & 0xFF;
+    table[7] = (density >> 24) & 0xFF;
+    table[28] = 12;             // Erase type 1: 4KB
+    table[29] = SIM_SE;
+    table[30] = 16;             // Erase type 2: 64KB
+    table[31] = SIM_BE;
+    table[40] = 8 << 4;         // Page size 2^8
+    table[58] = 5 << 4;         // QE is bit 1 of status register 2, read with 35h
+
+    // Boot region erased in 4KB sectors, the rest of the device in 64KB sectors
+    uint8_t *map = &_sfdp[SIM_SECTOR_MAP_TABLE_ADDR];
+    uint32_t boot_units = SIM_BOOT_REGION_SIZE / 256 - 1;
+    uint32_t main_units = (size - SIM_BOOT_REGION_SIZE) / 256 - 1;
+    map[0] = 0x03;
+    map[1] = 0;
+    map[2] = 1;
+    map[3] = 0xFF;
+    map[4] = 0x01;
+    map[5] = boot_units & 0xFF;
+    map[6] = (boot_units >> 8) & 0xFF;
+    map[7] = (boot_units >> 16) & 0xFF;
+    map[8] = 0x02;
+    map[9] = main_units & 0xFF;
+    map[10] = (main_units >> 8) & 0xFF;
+    map[11] = (main_units >> 16) & 0xFF;
+
+    reset_counters();
+    instance = this;
+}
+
+QSPIFlashSim::~QSPIFlashSim()
+{
+    if (instance == this) {
+        instance = NULL;
+    }
+    delete[] memory;
+}
+
+void QSPIFlashSim::reset_counters()
+{
+    commands = 0;
+    bus_cycles = 0;
+    page_programs = 0;
+    erases = 0;
+    status_polls = 0;
+    busy_violations = 0;
+    protocol_errors = 0;
+}
+
+bool QSPIFlashSim::quad_enabled() const
+{
+    return (_status[1] & SIM_STATUS2_QE) != 0;
+}
+
+static uint32_t bus_lines(qspi_bus_width_t width)
+{
+    switch (width) {
+        case QSPI_CFG_BUS_DUAL:
+            return 2;
+        case QSPI_CFG_BUS_QUAD:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+uint32_t QSPIFlashSim::count_cycles(const qspi_command_t *command, size_t data_size) const
+{
+    uint32_t cycles = 0;
+
+    if (!command->instruction.disabled) {
+        cycles += 8 / bus_lines(command->instruction.bus_width);
+    }
+    if (!command->address.disabled) {
+        cycles += (command->address.size + 1) * 8 / bus_lines(command->address.bus_width);
+    }
+    if (!command->alt.disabled) {
+        cycles += (command->alt.size + 1) * 8 / bus_lines(command->alt.bus_width);
+    }
+    cycles += command->dummy_count;
+    cycles += data_size * 8 / bus_lines(command->data.bus_width);
+
+    return cycles;
+}
+
+bool QSPIFlashSim::check_format(const qspi_command_t *command, size_t data_size) const
+{
+    if (command->instruction.disabled || command->instruction.bus_width != QSPI_CFG_BUS_SINGLE) {
+        return false;
+    }
+
+    qspi_address_size_t address_size = four_byte_mode ? QSPI_CFG_ADDR_SIZE_32 : QSPI_CFG_ADDR_SIZE_24;
+    qspi_bus_width_t address_width = QSPI_CFG_BUS_SINGLE;
+    qspi_bus_width_t data_width = QSPI_CFG_BUS_SINGLE;
+    bool addressed = true;
+    bool alt = false;
+    bool quad = false;
+    int dummy = 0;
+
+    switch (command->instruction.value) {
+        case SIM_SFDP:
+            // Always 3 byte addresses and 8 wait states
+            address_size = QSPI_CFG_ADDR_SIZE_24;
+            dummy = 8;
+            break;
+        case SIM_READ:
+        case SIM_PP:
+            break;
+        case SIM_SE:
+        case SIM_BE:
+            if (data_size) {
+                return false;
+            }
+            break;
+        case SIM_QPP:
+            data_width = QSPI_CFG_BUS_QUAD;
+            quad = true;
+            break;
+        case SIM_QREAD:
+            data_width = QSPI_CFG_BUS_QUAD;
+            quad = true;
+            dummy = 8;
+            break;
+        case SIM_QIOREAD:
+            address_width = QSPI_CFG_BUS_QUAD;
+            data_width = QSPI_CFG_BUS_QUAD;
+            quad = true;
+            alt = true;
+            dummy = 4;
+            if (command->alt.disabled || command->alt.bus_width != QSPI_CFG_BUS_QUAD ||
+                    command->alt.size != QSPI_CFG_ALT_SIZE_8 || (command->alt.value & 0x30) == 0x20) {
+                // Mode bits Ax would enter continuous read mode
+                return false;
+            }
+            break;
+        default:
+            addressed = false;
+            break;
+    }
+
+    if (quad && !quad_enabled()) {
+        return false;
+    }
+    if (command->address.disabled == addressed) {
+        return false;
+    }
+    if (addressed && (command->address.size != address_size || command->address.bus_width != address_width)) {
+        return false;
+    }
+    if (!alt && !command->alt.disabled) {
+        return false;
+    }
+    if (command->dummy_count != dummy) {
+        return false;
+    }
+    if (data_size && command->data.bus_width != data_width) {
+        return false;
+    }
+
+    return true;
+}
+
+void QSPIFlashSim::write_status(const uint8_t *data, size_t size, bool status_register_2)
+{
+    if (status_register_2) {
+        _status[1] = data[0];
+    } else {
+        // WIP and WEL are read only
+        _status[0] = data[0] & ~(SIM_STATUS_WIP | SIM_STATUS_WEL);
+        if (size > 1) {
+            _status[1] = data[1];
+        }
+    }
+}
+
+qspi_status_t QSPIFlashSim::command(const qspi_command_t *command, const void *tx_data, size_t tx_size,
+                                    void *rx_data, size_t rx_size)
+{
+    const uint8_t *tx = static_cast<const uint8_t *>(tx_data);
+    uint8_t *rx = static_cast<uint8_t *>(rx_data);
+    uint8_t instruction = command->instruction.value;
+    uint32_t address = command->address.value;
+
+    commands++;
+    bus_cycles += count_cycles(command, tx_size + rx_size);
+    if (rx_size) {
+        memset(rx, 0xFF, rx_size);
+    }
+
+    if (!check_format(command, tx_size + rx_size)) {
+        protocol_errors++;
+        return QSPI_STATUS_OK;
+    }
+
+    if (instruction == SIM_RDSR) {
+        status_polls++;
+        for (size_t i = 0; i < rx_size; i++) {
+            rx[i] = _status[0] | (_busy_polls ? SIM_STATUS_WIP : 0) | (_write_enabled ? SIM_STATUS_WEL : 0);
+        }
+        if (_busy_polls) {
+            _busy_polls--;
+        }
+        return QSPI_STATUS_OK;
+    }
+
+    if (_busy_polls) {
+        busy_violations++;
+        return QSPI_STATUS_OK;
+    }
+
+    bool reset_enabled = _reset_enabled;
+    _reset_enabled = false;
+
+    if (!four_byte_mode) {
+        address &= 0xFFFFFF;
+    }
+
+    switch (instruction) {
+        case SIM_RDSR2:
+            if (rx_size) {
+                rx[0] = _status[1];
+            }
+            break;
+        case SIM_RDID: {
+            static const uint8_t id[3] = {0xEF, 0x40, 0x19};
+            for (size_t i = 0; i < rx_size; i++) {
+                rx[i] = id[i % 3];
+            }
+            break;
+        }
+        case SIM_WREN:
+            _write_enabled = true;
+            break;
+        case SIM_WRDI:
+            _write_enabled = false;
+            break;
+        case SIM_WRSR:
+        case SIM_WRSR2:
+            if (_write_enabled && tx_size) {
+                write_status(tx, tx_size, instruction == SIM_WRSR2);
+                _busy_polls = _program_polls;
+            }
+            _write_enabled = false;
+            break;
+        case SIM_EN4B:
+            four_byte_mode = true;
+            break;
+        case SIM_RSTEN:
+            _reset_enabled = true;
+            break;
+        case SIM_RST:
+            if (reset_enabled) {
+                _write_enabled = false;
+                four_byte_mode = false;
+            }
+            break;
+        case SIM_READ:
+        case SIM_QREAD:
+        case SIM_QIOREAD:
+            for (size_t i = 0; i < rx_size; i++) {
+                rx[i] = memory[(address + i) % memory_size];
+            }
+            break;
+        case SIM_SFDP:
+            for (size_t i = 0; i < rx_size; i++) {
+                rx[i] = (address + i) < sizeof(_sfdp) ? _sfdp[address + i] : 0xFF;
+            }
+            break;
+        case SIM_PP:
+        case SIM_QPP:
+            if (_write_enabled && tx_size) {
+                // Data wraps around within the addressed page
+                uint32_t base = (address % memory_size) & ~(QSPI_FLASH_SIM_PAGE_SIZE - 1);
+                for (size_t i = 0; i < tx_size; i++) {
+                    memory[base + (address + i) % QSPI_FLASH_SIM_PAGE_SIZE] &= tx[i];
+                }
+                page_programs++;
+                _busy_polls = _program_polls;
+            }
+            _write_enabled = false;
+            break;
+        case SIM_SE:
+        case SIM_BE:
+            if (_write_enabled) {
+                uint32_t size = instruction == SIM_SE ? 4096 : 65536;
+                uint32_t base = (address % memory_size) & ~(size - 1);
+                memset(&memory[base], 0xFF, size);
+                erases++;
+                _busy_polls = _program_polls * SIM_ERASE_POLLS_FACTOR;
+            }
+            _write_enabled = false;
+            break;
+        default:
+            break;
+    }
+
+    return QSPI_STATUS_OK;
+}
+
+/*
+ * QSPI HAL connected to the simulated flash
+ */
+qspi_status_t qspi_init(qspi_t *obj, PinName io0, PinName io1, PinName io2, PinName io3, PinName sclk, PinName ssel,
+                        uint32_t hz, uint8_t mode)
+{
+    return QSPI_STATUS_OK;
+}
+
+qspi_status_t qspi_free(qspi_t *obj)
+{
+    return QSPI_STATUS_OK;
+}
+
+qspi_status_t qspi_frequency(qspi_t *obj, int hz)
+{
+    return QSPI_STATUS_OK;
+}
+
+qspi_status_t qspi_write(qspi_t *obj, const qspi_command_t *command, const void *data, size_t *length)
+{
+    if (!QSPIFlashSim::instance) {
+        return QSPI_STATUS_ERROR;
+    }
+    return QSPIFlashSim::instance->command(command, data, *length, NULL, 0);
+}
+
+qspi_status_t qspi_command_transfer(qspi_t *obj, const qspi_command_t *command, const void *tx_data, size_t tx_size,
+                                    void *rx_data, size_t rx_size)
+{
+    if (!QSPIFlashSim::instance) {
+        return QSPI_STATUS_ERROR;
+    }
+    return QSPIFlashSim::instance->command(command, tx_data, tx_size, rx_data, rx_size);
+}
+
+qspi_status_t qspi_read(qspi_t *obj, const qspi_command_t *command, void *data, size_t *length)
+{
+    if (!QSPIFlashSim::instance) {
+        return QSPI_STATUS_ERROR;
+    }
+    return QSPIFlashSim::instance->command(command, NULL, 0, data, *length);
+}
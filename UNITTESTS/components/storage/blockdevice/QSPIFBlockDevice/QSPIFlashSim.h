@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef QSPI_FLASH_SIM_H
+#define QSPI_FLASH_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hal/qspi_api.h"
+
+#define QSPI_FLASH_SIM_PAGE_SIZE    256
+#define QSPI_FLASH_SIM_SFDP_SIZE    0xC0
+
+/** Read modes and layouts advertised in the SFDP tables of QSPIFlashSim */
+enum qspi_flash_sim_features {
+    QSPI_FLASH_SIM_SINGLE     = 0x00, /* 1-1-1 reads and page programs only */
+    QSPI_FLASH_SIM_READ_1_1_4 = 0x01, /* Quad Output Fast Read (6Bh) */
+    QSPI_FLASH_SIM_READ_1_4_4 = 0x02, /* Quad I/O Fast Read (EBh) with mode bits */
+    QSPI_FLASH_SIM_SECTOR_MAP = 0x04, /* 4KB sector boot region followed by 64KB sectors */
+};
+
+/** SFDP compliant quad NOR flash attached to the QSPI HAL
+ *
+ * Every command is checked against the bus format the instruction
+ * requires on a real part: quad phases need the Quad Enable bit, the
+ * address size has to follow the 3/4-byte addressing mode and reads
+ * need the right number of dummy cycles. Commands that do not match
+ * are ignored and counted as protocol errors. Bus clock cycles of all
+ * commands are counted so tests can compare the throughput of the
+ * read and program modes.
+ *
+ * Page programs and erases keep the device busy for a fixed number of
+ * status register polls, any other command sent meanwhile is ignored
+ * and counted as a violation.
+ */
+class QSPIFlashSim {
+public:
+    QSPIFlashSim(uint32_t size, int features);
+
+    ~QSPIFlashSim();
+
+    /** The flash the QSPI HAL stub is connected to */
+    static QSPIFlashSim *instance;
+
+    /** Status register polls a page program keeps the device busy for */
+    void set_program_polls(unsigned polls)
+    {
+        _program_polls = polls;
+    }
+
+    void reset_counters();
+
+    bool quad_enabled() const;
+
+    qspi_status_t command(const qspi_command_t *command, const void *tx_data, size_t tx_size,
+                          void *rx_data, size_t rx_size);
+
+    uint8_t *memory;
+    const uint32_t memory_size;
+
+    bool four_byte_mode;
+
+    uint32_t commands;
+    uint64_t bus_cycles;
+    uint32_t page_programs;
+    uint32_t erases;
+    uint32_t status_polls;
+    uint32_t busy_violations;
+    uint32_t protocol_errors;
+
+private:
+    bool check_format(const qspi_command_t *command, size_t data_size) const;
+    uint32_t count_cycles(const qspi_command_t *command, size_t data_size) const;
+    void write_status(const uint8_t *data, size_t size, bool status_register_2);
+
+    uint8_t _sfdp[QSPI_FLASH_SIM_SFDP_SIZE];
+    uint8_t _status[2];
+    bool _write_enabled;
+    bool _reset_enabled;
+    unsigned _busy_polls;
+    unsigned _program_polls;
+};
+
+#endif /* QSPI_FLASH_SIM_H */
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "QSPIFBlockDevice.h"
+#include "QSPIFlashSim.h"
+
+#include <string.h>
+
+#define TEST_BLOCK_SIZE     4096
+#define TEST_FLASH_SIZE     (2 * 1024 * 1024)
+#define TEST_LARGE_SIZE     (32 * 1024 * 1024)
+#define TEST_QUAD_FEATURES  (QSPI_FLASH_SIM_READ_1_1_4 | QSPI_FLASH_SIM_READ_1_4_4)
+
+class TestQSPIFBlockDevice : public testing::Test {
+protected:
+    QSPIFlashSim *flash;
+    QSPIFBlockDevice *bd;
+    uint8_t buffer[TEST_BLOCK_SIZE];
+    uint8_t pattern[TEST_BLOCK_SIZE];
+
+    virtual void SetUp()
+    {
+        flash = NULL;
+        bd = NULL;
+
+        for (int i = 0; i < TEST_BLOCK_SIZE; i++) {
+            pattern[i] = (i * 7) ^ (i >> 8);
+        }
+    }
+
+    virtual void TearDown()
+    {
+        stop();
+    }
+
+    void start(uint32_t size, int features)
+    {
+        stop();
+        flash = new QSPIFlashSim(size, features);
+        bd = new QSPIFBlockDevice(NC, NC, NC, NC, NC, NC, QSPIF_POLARITY_MODE_0);
+        ASSERT_EQ(QSPIF_BD_ERROR_OK, bd->init());
+        ASSERT_EQ(0, flash->protocol_errors);
+        flash->reset_counters();
+    }
+
+    void stop()
+    {
+        delete bd;
+        delete flash;
+        bd = NULL;
+        flash = NULL;
+    }
+
+    /** Bus clock cycles per KB of data moved by the last operation */
+    uint32_t cycles_per_kb(bd_size_t size)
+    {
+        return (flash->bus_cycles * 1024 + size - 1) / size;
+    }
+};
+
+TEST_F(TestQSPIFBlockDevice, init)
+{
+    start(TEST_FLASH_SIZE, TEST_QUAD_FEATURES);
+
+    EXPECT_EQ(TEST_FLASH_SIZE, bd->size());
+    EXPECT_EQ(1, bd->get_read_size());
+    EXPECT_EQ(1, bd->get_program_size());
+    EXPECT_EQ(4096, bd->get_erase_size());
+    EXPECT_EQ(0xFF, bd->get_erase_value());
+    EXPECT_TRUE(flash->quad_enabled());
+    EXPECT_FALSE(flash->four_byte_mode);
+}
+
+TEST_F(TestQSPIFBlockDevice, program_read)
+{
+    start(TEST_FLASH_SIZE, TEST_QUAD_FEATURES);
+
+    // Unaligned start and a length covering several partial and full pages
+    bd_addr_t addr = 3 * QSPI_FLASH_SIM_PAGE_SIZE + 17;
+    bd_size_t size = 5 * QSPI_FLASH_SIM_PAGE_SIZE + 100;
+
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->program(pattern, addr, size));
+    EXPECT_EQ(6, flash->page_programs);
+
+    memset(buffer, 0, sizeof(buffer));
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->read(buffer, addr, size));
+    EXPECT_EQ(0, memcmp(buffer, pattern, size));
+    EXPECT_EQ(0, memcmp(&flash->memory[addr], pattern, size));
+    EXPECT_EQ(0xFF, flash->memory[addr - 1]);
+    EXPECT_EQ(0xFF, flash->memory[addr + size]);
+    EXPECT_EQ(0, flash->protocol_errors);
+    EXPECT_EQ(0, flash->busy_violations);
+}
+
+TEST_F(TestQSPIFBlockDevice, quad_output_read)
+{
+    // Only the 1-1-4 read mode is advertised
+    start(TEST_FLASH_SIZE, QSPI_FLASH_SIM_READ_1_1_4);
+
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->program(pattern, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE));
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->read(buffer, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE));
+    EXPECT_EQ(0, memcmp(buffer, pattern, TEST_BLOCK_SIZE));
+    EXPECT_EQ(0, flash->protocol_errors);
+}
+
+TEST_F(TestQSPIFBlockDevice, erase)
+{
+    start(TEST_FLASH_SIZE, TEST_QUAD_FEATURES);
+
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->program(pattern, 0, TEST_BLOCK_SIZE));
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->program(pattern, 2 * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE));
+
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->erase(0, TEST_BLOCK_SIZE));
+    EXPECT_EQ(1, flash->erases);
+
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->read(buffer, 0, TEST_BLOCK_SIZE));
+    for (int i = 0; i < TEST_BLOCK_SIZE; i++) {
+        EXPECT_EQ(0xFF, buffer[i]);
+    }
+    EXPECT_EQ(0, memcmp(&flash->memory[2 * TEST_BLOCK_SIZE], pattern, TEST_BLOCK_SIZE));
+
+    EXPECT_EQ(QSPIF_BD_ERROR_INVALID_ERASE_PARAMS, bd->erase(100, TEST_BLOCK_SIZE));
+    EXPECT_EQ(0, flash->protocol_errors);
+    EXPECT_EQ(0, flash->busy_violations);
+}
+
+TEST_F(TestQSPIFBlockDevice, throughput_vs_single_line)
+{
+    // Single line part, the bus modes SPIFBlockDevice uses
+    start(TEST_FLASH_SIZE, QSPI_FLASH_SIM_SINGLE);
+    EXPECT_FALSE(flash->quad_enabled());
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->program(pattern, 0, TEST_BLOCK_SIZE));
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->sync());
+    uint32_t single_program = cycles_per_kb(TEST_BLOCK_SIZE);
+    flash->reset_counters();
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->read(buffer, 0, TEST_BLOCK_SIZE));
+    uint32_t single_read = cycles_per_kb(TEST_BLOCK_SIZE);
+    EXPECT_EQ(0, flash->protocol_errors);
+
+    start(TEST_FLASH_SIZE, TEST_QUAD_FEATURES);
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->program(pattern, 0, TEST_BLOCK_SIZE));
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->sync());
+    uint32_t quad_program = cycles_per_kb(TEST_BLOCK_SIZE);
+    flash->reset_counters();
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->read(buffer, 0, TEST_BLOCK_SIZE));
+    uint32_t quad_read = cycles_per_kb(TEST_BLOCK_SIZE);
+    EXPECT_EQ(0, memcmp(buffer, pattern, TEST_BLOCK_SIZE));
+    EXPECT_EQ(0, flash->protocol_errors);
+
+    RecordProperty("single_read_cycles_per_kb", single_read);
+    RecordProperty("quad_read_cycles_per_kb", quad_read);
+    RecordProperty("single_program_cycles_per_kb", single_program);
+    RecordProperty("quad_program_cycles_per_kb", quad_program);
+
+    // 1-4-4 reads move a byte every two clocks instead of eight
+    EXPECT_LT(quad_read * 3, single_read);
+    EXPECT_LT(quad_program * 2, single_program);
+}
+
+TEST_F(TestQSPIFBlockDevice, four_byte_addressing)
+{
+    start(TEST_LARGE_SIZE, TEST_QUAD_FEATURES);
+
+    EXPECT_EQ(TEST_LARGE_SIZE, bd->size());
+    EXPECT_TRUE(flash->four_byte_mode);
+
+    // Above the 16MB a 3 byte address can reach
+    bd_addr_t addr = 20 * 1024 * 1024;
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->program(pattern, addr, TEST_BLOCK_SIZE));
+    EXPECT_EQ(0, memcmp(&flash->memory[addr], pattern, TEST_BLOCK_SIZE));
+    EXPECT_EQ(0xFF, flash->memory[addr - 16 * 1024 * 1024]);
+
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->read(buffer, addr, TEST_BLOCK_SIZE));
+    EXPECT_EQ(0, memcmp(buffer, pattern, TEST_BLOCK_SIZE));
+
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->erase(addr, TEST_BLOCK_SIZE));
+    EXPECT_EQ(0xFF, flash->memory[addr]);
+    EXPECT_EQ(0, flash->protocol_errors);
+
+    // init after deinit switches a reset device to 4-byte addressing again
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->deinit());
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->init());
+    EXPECT_TRUE(flash->four_byte_mode);
+    EXPECT_EQ(0, flash->protocol_errors);
+}
+
+TEST_F(TestQSPIFBlockDevice, sector_map_regions)
+{
+    start(TEST_FLASH_SIZE, TEST_QUAD_FEATURES | QSPI_FLASH_SIM_SECTOR_MAP);
+
+    // 64KB boot region of 4KB sectors, 64KB sectors after it
+    EXPECT_EQ(4096, bd->get_erase_size(0));
+    EXPECT_EQ(4096, bd->get_erase_size(60 * 1024));
+    EXPECT_EQ(65536, bd->get_erase_size(64 * 1024));
+    EXPECT_EQ(65536, bd->get_erase_size(TEST_FLASH_SIZE - 1));
+    EXPECT_EQ(0, bd->get_erase_size());
+
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->erase(0, TEST_BLOCK_SIZE));
+    EXPECT_EQ(1, flash->erases);
+    EXPECT_EQ(QSPIF_BD_ERROR_INVALID_ERASE_PARAMS, bd->erase(64 * 1024, TEST_BLOCK_SIZE));
+
+    // Crossing from the boot region into the next one
+    flash->reset_counters();
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->program(pattern, 60 * 1024, TEST_BLOCK_SIZE));
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->program(pattern, 64 * 1024, TEST_BLOCK_SIZE));
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->erase(60 * 1024, 4 * 1024 + 64 * 1024));
+    EXPECT_EQ(2, flash->erases);
+    EXPECT_EQ(0xFF, flash->memory[60 * 1024]);
+    EXPECT_EQ(0xFF, flash->memory[64 * 1024]);
+    EXPECT_EQ(0, flash->protocol_errors);
+    EXPECT_EQ(0, flash->busy_violations);
+}
+
+TEST_F(TestQSPIFBlockDevice, memory_mapped_reads)
+{
+    start(TEST_FLASH_SIZE, TEST_QUAD_FEATURES);
+    flash->set_program_polls(5);
+
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->program(pattern, TEST_BLOCK_SIZE, QSPI_FLASH_SIM_PAGE_SIZE));
+    bd->set_memory_mapped_reads(flash->memory);
+    flash->reset_counters();
+
+    // Only the completion of the pending page program is polled
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->read(buffer, TEST_BLOCK_SIZE, QSPI_FLASH_SIM_PAGE_SIZE));
+    EXPECT_EQ(flash->status_polls, flash->commands);
+    EXPECT_EQ(0, memcmp(buffer, pattern, QSPI_FLASH_SIM_PAGE_SIZE));
+
+    flash->reset_counters();
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->read(buffer, TEST_BLOCK_SIZE, QSPI_FLASH_SIM_PAGE_SIZE));
+    EXPECT_EQ(0, flash->commands);
+
+    bd->set_memory_mapped_reads(NULL);
+    EXPECT_EQ(QSPIF_BD_ERROR_OK, bd->read(buffer, TEST_BLOCK_SIZE, QSPI_FLASH_SIM_PAGE_SIZE));
+    EXPECT_EQ(1, flash->commands);
+    EXPECT_EQ(0, memcmp(buffer, pattern, QSPI_FLASH_SIM_PAGE_SIZE));
+    EXPECT_EQ(0, flash->busy_violations);
+}
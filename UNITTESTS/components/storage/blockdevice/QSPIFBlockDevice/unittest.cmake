@@ -0,0 +1,24 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  ../components/storage/blockdevice/COMPONENT_QSPIF
+  ../features/storage/blockdevice
+  ../features/frameworks/mbed-trace/mbed-trace
+)
+
+set(unittest-sources
+  ../components/storage/blockdevice/COMPONENT_QSPIF/QSPIFBlockDevice.cpp
+  ../drivers/QSPI.cpp
+)
+
+set(unittest-test-sources
+  components/storage/blockdevice/QSPIFBlockDevice/test_QSPIFBlockDevice.cpp
+  components/storage/blockdevice/QSPIFBlockDevice/QSPIFlashSim.cpp
+  stubs/mbed_assert_stub.c
+  stubs/mbed_critical_stub.c
+  stubs/mbed_wait_api_stub.cpp
+  stubs/Mutex_stub.cpp
+)
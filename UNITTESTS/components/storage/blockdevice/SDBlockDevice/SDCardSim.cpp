@@ -0,0 +1,525 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "SDCardSim.h"
+#include "SPI.h"
+#include "Timer.h"
+#include "hal/gpio_api.h"
+
+#define SIM_R1_IDLE             0x01
+#define SIM_R1_ILLEGAL          0x04
+#define SIM_R1_CRC_ERROR        0x08
+#define SIM_R1_ADDRESS_ERROR    0x20
+#define SIM_R1_PARAMETER_ERROR  0x40
+
+#define SIM_START_BLOCK         0xFE
+#define SIM_START_MULTI_WRITE   0xFC
+#define SIM_STOP_TRAN           0xFD
+
+#define SIM_DATA_ACCEPTED       0xE5
+#define SIM_DATA_CRC_ERROR      0xEB
+#define SIM_DATA_WRITE_ERROR    0xED
+
+#define SIM_INIT_POLLS          2
+#define SIM_STOP_BUSY           2
+#define SIM_ERASE_BUSY_FACTOR   4
+#define SIM_NO_BLOCK            0xFFFFFFFF
+
+static uint8_t sim_crc7(const uint8_t *data, unsigned length)
+{
+    uint8_t crc = 0;
+    for (unsigned i = 0; i < length; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            uint8_t in = ((data[i] >> bit) & 1) ^ ((crc >> 6) & 1);
+            crc = (crc << 1) & 0x7F;
+            if (in) {
+                crc ^= 0x09;
+            }
+        }
+    }
+    return crc;
+}
+
+static uint16_t sim_crc16(const uint8_t *data, unsigned length)
+{
+    uint16_t crc = 0;
+    for (unsigned i = 0; i < length; i++) {
+        crc ^= data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+SDCardSim *SDCardSim::instance = NULL;
+
+SDCardSim::SDCardSim()
+    : hz(1000000), _queue_head(0), _queue_size(0), _packet_length(0), _packet_pos(0),
+      _packet_latency(0), _read_multiple(false), _read_block(0), _write_state(WRITE_NONE),
+      _write_multiple(false), _write_block(0), _write_pos(0), _cmd_pos(0), _selected(false),
+      _idle(true), _app_cmd(false), _crc_on(false), _init_polls(SIM_INIT_POLLS), _busy(0),
+      _erase_start(0), _erase_end(0), _read_latency(2), _program_busy(64),
+      _corrupt_block(SIM_NO_BLOCK), _clock_ns(0)
+{
+    memset(memory, 0xFF, sizeof(memory));
+    reset_counters();
+    instance = this;
+}
+
+SDCardSim::~SDCardSim()
+{
+    if (instance == this) {
+        instance = NULL;
+    }
+}
+
+void SDCardSim::reset_counters()
+{
+    spi_calls = 0;
+    bytes = 0;
+    memset(cmd_count, 0, sizeof(cmd_count));
+    memset(acmd_count, 0, sizeof(acmd_count));
+    blocks_read = 0;
+    blocks_written = 0;
+    pre_erase_blocks = 0;
+    erases = 0;
+    crc_errors = 0;
+    busy_violations = 0;
+}
+
+void SDCardSim::select(bool selected)
+{
+    // The card keeps its transfer state, only the command framing restarts
+    _selected = selected;
+    _cmd_pos = 0;
+}
+
+void SDCardSim::queue(uint8_t value)
+{
+    _queue[(_queue_head + _queue_size) % sizeof(_queue)] = value;
+    _queue_size++;
+}
+
+void SDCardSim::start_packet(const uint8_t *data, unsigned length, bool corrupt_crc)
+{
+    uint16_t crc = sim_crc16(data, length);
+    if (corrupt_crc) {
+        crc ^= 0x0001;
+    }
+
+    _packet[0] = SIM_START_BLOCK;
+    memcpy(&_packet[1], data, length);
+    _packet[length + 1] = crc >> 8;
+    _packet[length + 2] = crc & 0xFF;
+    _packet_length = length + 3;
+    _packet_pos = 0;
+    _packet_latency = _read_latency;
+}
+
+void SDCardSim::start_read_block()
+{
+    if (_read_block >= SD_CARD_SIM_BLOCKS) {
+        _read_multiple = false;
+        return;
+    }
+
+    bool corrupt = _corrupt_block == _read_block;
+    if (corrupt) {
+        _corrupt_block = SIM_NO_BLOCK;
+    }
+    start_packet(&memory[_read_block * SD_CARD_SIM_BLOCK_SIZE], SD_CARD_SIM_BLOCK_SIZE, corrupt);
+    _read_block++;
+}
+
+uint8_t SDCardSim::exchange(uint8_t mosi)
+{
+    bytes++;
+    _clock_ns += 8000000000ULL / hz;
+    if (!_selected) {
+        return 0xFF;
+    }
+
+    // Output: pending responses, then busy, then the data packet being read
+    uint8_t miso = 0xFF;
+    bool busy = false;
+    if (_queue_size) {
+        miso = _queue[_queue_head];
+        _queue_head = (_queue_head + 1) % sizeof(_queue);
+        _queue_size--;
+    } else if (_busy) {
+        miso = 0x00;
+        busy = true;
+        _busy--;
+    } else if (_packet_length) {
+        if (_packet_latency) {
+            _packet_latency--;
+        } else {
+            miso = _packet[_packet_pos++];
+            if (_packet_pos == _packet_length) {
+                if (_packet_length == SD_CARD_SIM_BLOCK_SIZE + 3) {
+                    blocks_read++;
+                }
+                _packet_length = 0;
+                if (_read_multiple) {
+                    start_read_block();
+                }
+            }
+        }
+    }
+
+    // Input: data tokens and blocks of a write, otherwise commands
+    if (_write_state != WRITE_NONE) {
+        if (busy && mosi != 0xFF) {
+            busy_violations++;
+        } else {
+            receive_data(mosi);
+        }
+        return miso;
+    }
+
+    if (_cmd_pos == 0) {
+        if ((mosi & 0xC0) != 0x40) {
+            return miso;
+        }
+        if (busy) {
+            busy_violations++;
+            return miso;
+        }
+    }
+
+    _cmd[_cmd_pos++] = mosi;
+    if (_cmd_pos == sizeof(_cmd)) {
+        _cmd_pos = 0;
+        execute();
+    }
+    return miso;
+}
+
+void SDCardSim::receive_data(uint8_t mosi)
+{
+    if (_write_state == WRITE_TOKEN) {
+        if (mosi == (_write_multiple ? SIM_START_MULTI_WRITE : SIM_START_BLOCK)) {
+            _write_state = WRITE_DATA;
+            _write_pos = 0;
+        } else if (_write_multiple && mosi == SIM_STOP_TRAN) {
+            _write_state = WRITE_NONE;
+            _busy = SIM_STOP_BUSY;
+        }
+        return;
+    }
+
+    _write_buffer[_write_pos++] = mosi;
+    if (_write_pos < sizeof(_write_buffer)) {
+        return;
+    }
+
+    uint16_t crc = (_write_buffer[SD_CARD_SIM_BLOCK_SIZE] << 8) | _write_buffer[SD_CARD_SIM_BLOCK_SIZE + 1];
+    if (_crc_on && crc != sim_crc16(_write_buffer, SD_CARD_SIM_BLOCK_SIZE)) {
+        crc_errors++;
+        queue(SIM_DATA_CRC_ERROR);
+    } else if (_write_block >= SD_CARD_SIM_BLOCKS) {
+        queue(SIM_DATA_WRITE_ERROR);
+    } else {
+        memcpy(&memory[_write_block * SD_CARD_SIM_BLOCK_SIZE], _write_buffer, SD_CARD_SIM_BLOCK_SIZE);
+        blocks_written++;
+        _write_block++;
+        queue(SIM_DATA_ACCEPTED);
+        _busy = _program_busy;
+    }
+    _write_state = _write_multiple ? WRITE_TOKEN : WRITE_NONE;
+}
+
+void SDCardSim::execute()
+{
+    uint8_t index = _cmd[0] & 0x3F;
+    uint32_t arg = (_cmd[1] << 24) | (_cmd[2] << 16) | (_cmd[3] << 8) | _cmd[4];
+    bool app = _app_cmd;
+    _app_cmd = false;
+
+    // Command response time (NCR)
+    queue(0xFF);
+
+    // CMD0 and CMD8 are always protected by a CRC
+    if ((_crc_on || index == 0 || index == 8) && (((sim_crc7(_cmd, 5) << 1) | 1) != _cmd[5])) {
+        crc_errors++;
+        queue(SIM_R1_CRC_ERROR | (_idle ? SIM_R1_IDLE : 0));
+        return;
+    }
+
+    uint8_t r1 = _idle ? SIM_R1_IDLE : 0;
+    if (app) {
+        acmd_count[index]++;
+        switch (index) {
+            case 23:
+                pre_erase_blocks = arg & 0x7FFFFF;
+                queue(r1);
+                return;
+            case 41:
+                if (_init_polls) {
+                    _init_polls--;
+                }
+                _idle = _init_polls != 0;
+                queue(_idle ? SIM_R1_IDLE : 0);
+                return;
+            default:
+                queue(r1 | SIM_R1_ILLEGAL);
+                return;
+        }
+    }
+
+    cmd_count[index]++;
+    switch (index) {
+        case 0:
+            _idle = true;
+            _crc_on = false;
+            _init_polls = SIM_INIT_POLLS;
+            _packet_length = 0;
+            _read_multiple = false;
+            _write_state = WRITE_NONE;
+            queue(SIM_R1_IDLE);
+            break;
+        case 8:
+            queue(r1);
+            queue(0x00);
+            queue(0x00);
+            queue((arg >> 8) & 0x0F);
+            queue(arg & 0xFF);
+            break;
+        case 9: {
+            // CSD version 2.0, C_SIZE in bits [69:48]
+            uint8_t csd[16];
+            uint32_t c_size = SD_CARD_SIM_BLOCKS / 1024 - 1;
+            memset(csd, 0, sizeof(csd));
+            csd[0] = 0x40;
+            csd[7] = (c_size >> 16) & 0x3F;
+            csd[8] = (c_size >> 8) & 0xFF;
+            csd[9] = c_size & 0xFF;
+            queue(r1);
+            start_packet(csd, sizeof(csd), false);
+            break;
+        }
+        case 12:
+            // The byte after the command is a stuff byte, the NCR byte above stands for it
+            _packet_length = 0;
+            _read_multiple = false;
+            queue(r1);
+            _busy = SIM_STOP_BUSY;
+            break;
+        case 16:
+            queue(arg == SD_CARD_SIM_BLOCK_SIZE ? r1 : r1 | SIM_R1_PARAMETER_ERROR);
+            break;
+        case 17:
+        case 18:
+            if (arg >= SD_CARD_SIM_BLOCKS) {
+                queue(r1 | SIM_R1_ADDRESS_ERROR);
+                break;
+            }
+            queue(r1);
+            _read_block = arg;
+            _read_multiple = index == 18;
+            start_read_block();
+            break;
+        case 24:
+        case 25:
+            if (arg >= SD_CARD_SIM_BLOCKS) {
+                queue(r1 | SIM_R1_ADDRESS_ERROR);
+                break;
+            }
+            queue(r1);
+            _write_block = arg;
+            _write_multiple = index == 25;
+            _write_state = WRITE_TOKEN;
+            break;
+        case 32:
+            _erase_start = arg;
+            queue(r1);
+            break;
+        case 33:
+            _erase_end = arg;
+            queue(r1);
+            break;
+        case 38:
+            if (_erase_start > _erase_end || _erase_end >= SD_CARD_SIM_BLOCKS) {
+                queue(r1 | SIM_R1_PARAMETER_ERROR);
+                break;
+            }
+            memset(&memory[_erase_start * SD_CARD_SIM_BLOCK_SIZE], 0xFF,
+                   (_erase_end - _erase_start + 1) * SD_CARD_SIM_BLOCK_SIZE);
+            erases++;
+            queue(r1);
+            _busy = _program_busy * SIM_ERASE_BUSY_FACTOR;
+            break;
+        case 55:
+            _app_cmd = true;
+            queue(r1);
+            break;
+        case 58:
+            // OCR: power up status, CCS and 2.7-3.6V
+            queue(r1);
+            queue((_idle ? 0x00 : 0x80) | 0x40);
+            queue(0xFF);
+            queue(0x80);
+            queue(0x00);
+            break;
+        case 59:
+            _crc_on = arg & 1;
+            queue(r1);
+            break;
+        default:
+            queue(r1 | SIM_R1_ILLEGAL);
+            break;
+    }
+}
+
+/*
+ * mbed::SPI, mbed::Timer and gpio HAL connected to the simulated card
+ */
+namespace mbed {
+
+SPI::SPI(PinName mosi, PinName miso, PinName sclk, PinName ssel)
+    : _bits(8), _mode(0), _hz(1000000), _write_fill(0xFF)
+{
+}
+
+SPI::~SPI()
+{
+}
+
+void SPI::format(int bits, int mode)
+{
+    _bits = bits;
+    _mode = mode;
+}
+
+void SPI::frequency(int hz)
+{
+    _hz = hz;
+    if (SDCardSim::instance) {
+        SDCardSim::instance->hz = hz;
+    }
+}
+
+int SPI::write(int value)
+{
+    if (!SDCardSim::instance) {
+        return 0xFF;
+    }
+    SDCardSim::instance->spi_calls++;
+    return SDCardSim::instance->exchange(value);
+}
+
+int SPI::write(const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length)
+{
+    if (!SDCardSim::instance) {
+        return 0;
+    }
+    SDCardSim::instance->spi_calls++;
+
+    int total = tx_length > rx_length ? tx_length : rx_length;
+    for (int i = 0; i < total; i++) {
+        char out = SDCardSim::instance->exchange(i < tx_length ? tx_buffer[i] : _write_fill);
+        if (i < rx_length) {
+            rx_buffer[i] = out;
+        }
+    }
+    return total;
+}
+
+void SPI::lock()
+{
+}
+
+void SPI::unlock()
+{
+}
+
+void SPI::set_default_write_value(char data)
+{
+    _write_fill = data;
+}
+
+static us_timestamp_t sim_now_us()
+{
+    return SDCardSim::instance ? SDCardSim::instance->now_us() : 0;
+}
+
+Timer::Timer() : _running(0), _start(0), _time(0), _ticker_data(NULL), _lock_deepsleep(false)
+{
+}
+
+Timer::~Timer()
+{
+}
+
+void Timer::start()
+{
+    if (!_running) {
+        _start = sim_now_us();
+        _running = 1;
+    }
+}
+
+void Timer::stop()
+{
+    if (_running) {
+        _time += sim_now_us() - _start;
+        _running = 0;
+    }
+}
+
+void Timer::reset()
+{
+    _start = sim_now_us();
+    _time = 0;
+}
+
+int Timer::read_ms()
+{
+    us_timestamp_t elapsed = _time + (_running ? sim_now_us() - _start : 0);
+    return elapsed / 1000;
+}
+
+} // namespace mbed
+
+void gpio_init_out(gpio_t *gpio, PinName pin)
+{
+}
+
+void gpio_init_out_ex(gpio_t *gpio, PinName pin, int value)
+{
+    gpio_write(gpio, value);
+}
+
+void gpio_write(gpio_t *obj, int value)
+{
+    if (SDCardSim::instance) {
+        SDCardSim::instance->select(value == 0);
+    }
+}
+
+int gpio_read(gpio_t *obj)
+{
+    return 1;
+}
+
+int gpio_is_connected(const gpio_t *obj)
+{
+    return 1;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SD_CARD_SIM_H
+#define SD_CARD_SIM_H
+
+#include <stdint.h>
+
+#define SD_CARD_SIM_BLOCK_SIZE      512
+#define SD_CARD_SIM_BLOCKS          8192
+#define SD_CARD_SIM_SIZE            (SD_CARD_SIM_BLOCKS * SD_CARD_SIM_BLOCK_SIZE)
+
+/** SDHC card in SPI mode attached to the mbed::SPI, Timer and gpio stubs
+ *
+ * The chip select is the only DigitalOut of the test. Every call to
+ * SPI::write() is counted and the simulated clock advances by one byte time
+ * at the current SPI frequency for every byte exchanged; the Timer stub
+ * reads that clock. Read data packets follow a fixed access latency and
+ * every programmed block or erase keeps the card busy for a fixed number of
+ * bytes. A command sent while the card is busy is ignored and counted as a
+ * violation. Command and data CRCs are verified once the host enables them
+ * with CMD59.
+ */
+class SDCardSim {
+public:
+    SDCardSim();
+
+    ~SDCardSim();
+
+    /** The card the SPI, Timer and gpio stubs are connected to */
+    static SDCardSim *instance;
+
+    /** Bytes of 0xFF the card sends before the start token of a read */
+    void set_read_latency(unsigned bytes)
+    {
+        _read_latency = bytes;
+    }
+
+    /** Bytes the card stays busy for after a block is programmed */
+    void set_program_busy(unsigned bytes)
+    {
+        _program_busy = bytes;
+    }
+
+    /** Send a wrong CRC16 the next time the block is read */
+    void corrupt_read_crc(uint32_t block)
+    {
+        _corrupt_block = block;
+    }
+
+    void reset_counters();
+
+    void select(bool selected);
+
+    uint8_t exchange(uint8_t mosi);
+
+    /** Simulated time in microseconds */
+    uint64_t now_us() const
+    {
+        return _clock_ns / 1000;
+    }
+
+    uint8_t memory[SD_CARD_SIM_SIZE];
+
+    int hz;
+    uint32_t spi_calls;
+    uint32_t bytes;
+    uint32_t cmd_count[64];
+    uint32_t acmd_count[64];
+    uint32_t blocks_read;
+    uint32_t blocks_written;
+    uint32_t pre_erase_blocks;
+    uint32_t erases;
+    uint32_t crc_errors;
+    uint32_t busy_violations;
+
+private:
+    void execute();
+    void queue(uint8_t value);
+    void start_packet(const uint8_t *data, unsigned length, bool corrupt_crc);
+    void start_read_block();
+    void receive_data(uint8_t mosi);
+
+    enum WriteState {
+        WRITE_NONE,
+        WRITE_TOKEN,
+        WRITE_DATA
+    };
+
+    uint8_t _queue[16];
+    unsigned _queue_head;
+    unsigned _queue_size;
+
+    uint8_t _packet[SD_CARD_SIM_BLOCK_SIZE + 3];
+    unsigned _packet_length;
+    unsigned _packet_pos;
+    unsigned _packet_latency;
+    bool _read_multiple;
+    uint32_t _read_block;
+
+    WriteState _write_state;
+    bool _write_multiple;
+    uint32_t _write_block;
+    uint8_t _write_buffer[SD_CARD_SIM_BLOCK_SIZE + 2];
+    unsigned _write_pos;
+
+    uint8_t _cmd[6];
+    unsigned _cmd_pos;
+    bool _selected;
+    bool _idle;
+    bool _app_cmd;
+    bool _crc_on;
+    unsigned _init_polls;
+    unsigned _busy;
+    uint32_t _erase_start;
+    uint32_t _erase_end;
+
+    unsigned _read_latency;
+    unsigned _program_busy;
+    uint32_t _corrupt_block;
+    uint64_t _clock_ns;
+};
+
+#endif /* SD_CARD_SIM_H */
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "SDBlockDevice.h"
+#include "SDCardSim.h"
+#include "events/EventQueue.h"
+#include "equeue_sim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_BLOCKS             128
+#define TEST_SIZE               (TEST_BLOCKS * SD_CARD_SIM_BLOCK_SIZE)
+#define TEST_FREQUENCY          25000000
+
+// Error codes private to SDBlockDevice.cpp
+#define TEST_SD_ERROR_CRC       -5009
+#define TEST_SD_ERROR_PARAMETER -5003
+
+class TestSDBlockDevice : public testing::Test {
+protected:
+    SDCardSim *card;
+    SDBlockDevice *bd;
+    uint8_t buffer[TEST_SIZE];
+    uint8_t pattern[TEST_SIZE];
+
+    virtual void SetUp()
+    {
+        card = new SDCardSim;
+        bd = NULL;
+
+        for (int i = 0; i < TEST_SIZE; i++) {
+            pattern[i] = (i * 7) ^ (i >> 9);
+        }
+        completed = 0;
+        last_err = 0;
+        last_tick = 0;
+        equeue_sim_set_tick(0);
+    }
+
+    virtual void TearDown()
+    {
+        delete bd;
+        delete card;
+    }
+
+    void init(bool crc_on)
+    {
+        bd = new SDBlockDevice(NC, NC, NC, NC, TEST_FREQUENCY, crc_on);
+        ASSERT_EQ(BD_ERROR_OK, bd->init());
+        card->reset_counters();
+    }
+
+    /** Results of the requests queued with submit() */
+    int completed;
+    int last_err;
+    unsigned last_tick;
+    bd_request_t *completion_order[32];
+
+    void done(bd_request_t *request, int err)
+    {
+        if (completed < 32) {
+            completion_order[completed] = request;
+        }
+        completed++;
+        last_tick = equeue_tick();
+        if (err) {
+            last_err = err;
+        }
+    }
+
+    void prepare(bd_request_t &request, bd_request_type_t type, void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        request.type = type;
+        request.buffer = buffer;
+        request.addr = addr;
+        request.size = size;
+        request.callback = mbed::callback(this, &TestSDBlockDevice::done);
+    }
+
+    /** Driver calls per KB of data moved by the last operation */
+    uint32_t calls_per_kb(bd_size_t size)
+    {
+        return (card->spi_calls * 1024 + size - 1) / size;
+    }
+
+    void record(const char *name, uint32_t value)
+    {
+        char text[16];
+        snprintf(text, sizeof(text), "%u", (unsigned)value);
+        RecordProperty(name, text);
+    }
+};
+
+TEST_F(TestSDBlockDevice, init)
+{
+    init(false);
+    EXPECT_EQ(SD_CARD_SIM_SIZE, bd->size());
+    EXPECT_EQ(SD_CARD_SIM_BLOCK_SIZE, bd->get_read_size());
+    EXPECT_EQ(SD_CARD_SIM_BLOCK_SIZE, bd->get_program_size());
+    EXPECT_EQ(SD_CARD_SIM_BLOCK_SIZE, bd->get_erase_size());
+}
+
+TEST_F(TestSDBlockDevice, single_block)
+{
+    init(true);
+    bd_addr_t addr = 5 * SD_CARD_SIM_BLOCK_SIZE;
+
+    EXPECT_EQ(BD_ERROR_OK, bd->program(pattern, addr, SD_CARD_SIM_BLOCK_SIZE));
+    EXPECT_EQ(1, card->cmd_count[24]);
+    EXPECT_EQ(0, memcmp(&card->memory[addr], pattern, SD_CARD_SIM_BLOCK_SIZE));
+
+    memset(buffer, 0, sizeof(buffer));
+    EXPECT_EQ(BD_ERROR_OK, bd->read(buffer, addr, SD_CARD_SIM_BLOCK_SIZE));
+    EXPECT_EQ(1, card->cmd_count[17]);
+    EXPECT_EQ(0, card->cmd_count[12]);
+    EXPECT_EQ(0, memcmp(buffer, pattern, SD_CARD_SIM_BLOCK_SIZE));
+    EXPECT_EQ(0, card->crc_errors);
+    EXPECT_EQ(0, card->busy_violations);
+}
+
+TEST_F(TestSDBlockDevice, multiple_block)
+{
+    init(true);
+    bd_addr_t addr = 3 * SD_CARD_SIM_BLOCK_SIZE;
+
+    EXPECT_EQ(BD_ERROR_OK, bd->program(pattern, addr, TEST_SIZE));
+    EXPECT_EQ(1, card->cmd_count[25]);
+    EXPECT_EQ(0, card->cmd_count[24]);
+    EXPECT_EQ(TEST_BLOCKS, card->blocks_written);
+    EXPECT_EQ(0, memcmp(&card->memory[addr], pattern, TEST_SIZE));
+    EXPECT_EQ(0xFF, card->memory[addr - 1]);
+    EXPECT_EQ(0xFF, card->memory[addr + TEST_SIZE]);
+
+    memset(buffer, 0, sizeof(buffer));
+    EXPECT_EQ(BD_ERROR_OK, bd->read(buffer, addr, TEST_SIZE));
+    EXPECT_EQ(1, card->cmd_count[18]);
+    EXPECT_EQ(1, card->cmd_count[12]);
+    EXPECT_EQ(0, memcmp(buffer, pattern, TEST_SIZE));
+    EXPECT_EQ(0, card->crc_errors);
+    EXPECT_EQ(0, card->busy_violations);
+}
+
+TEST_F(TestSDBlockDevice, pre_erase_large_writes)
+{
+    init(false);
+
+    // Short multiple block writes skip the pre-erase command
+    EXPECT_EQ(BD_ERROR_OK, bd->program(pattern, 0, 2 * SD_CARD_SIM_BLOCK_SIZE));
+    EXPECT_EQ(0, card->acmd_count[23]);
+
+    EXPECT_EQ(BD_ERROR_OK, bd->program(pattern, 0, TEST_SIZE));
+    EXPECT_EQ(1, card->acmd_count[23]);
+    EXPECT_EQ(TEST_BLOCKS, card->pre_erase_blocks);
+    EXPECT_EQ(0, memcmp(card->memory, pattern, TEST_SIZE));
+}
+
+TEST_F(TestSDBlockDevice, read_crc_error)
+{
+    init(true);
+    EXPECT_EQ(BD_ERROR_OK, bd->program(pattern, 0, TEST_SIZE));
+
+    // The last block is only checked after the data phase
+    card->corrupt_read_crc(TEST_BLOCKS - 1);
+    EXPECT_EQ(TEST_SD_ERROR_CRC, bd->read(buffer, 0, TEST_SIZE));
+
+    card->corrupt_read_crc(10);
+    EXPECT_EQ(TEST_SD_ERROR_CRC, bd->read(buffer, 0, TEST_SIZE));
+    EXPECT_EQ(2, card->cmd_count[12]);
+
+    // The transmission was stopped, the card is usable again
+    memset(buffer, 0, sizeof(buffer));
+    EXPECT_EQ(BD_ERROR_OK, bd->read(buffer, 0, TEST_SIZE));
+    EXPECT_EQ(0, memcmp(buffer, pattern, TEST_SIZE));
+    EXPECT_EQ(0, card->busy_violations);
+}
+
+TEST_F(TestSDBlockDevice, trim)
+{
+    init(false);
+    EXPECT_EQ(BD_ERROR_OK, bd->program(pattern, 0, TEST_SIZE));
+
+    EXPECT_EQ(BD_ERROR_OK, bd->trim(SD_CARD_SIM_BLOCK_SIZE, 2 * SD_CARD_SIM_BLOCK_SIZE));
+    EXPECT_EQ(1, card->erases);
+    EXPECT_EQ(0xFF, card->memory[SD_CARD_SIM_BLOCK_SIZE]);
+    EXPECT_EQ(0xFF, card->memory[3 * SD_CARD_SIM_BLOCK_SIZE - 1]);
+    EXPECT_EQ(0, memcmp(card->memory, pattern, SD_CARD_SIM_BLOCK_SIZE));
+    EXPECT_EQ(0, memcmp(&card->memory[3 * SD_CARD_SIM_BLOCK_SIZE], &pattern[3 * SD_CARD_SIM_BLOCK_SIZE],
+                        SD_CARD_SIM_BLOCK_SIZE));
+
+    EXPECT_EQ(TEST_SD_ERROR_PARAMETER, bd->trim(100, SD_CARD_SIM_BLOCK_SIZE));
+
+    EXPECT_EQ(BD_ERROR_OK, bd->read(buffer, 0, TEST_SIZE));
+    EXPECT_EQ(0, card->busy_violations);
+}
+
+TEST_F(TestSDBlockDevice, read_calls_per_kb)
+{
+    init(true);
+    EXPECT_EQ(BD_ERROR_OK, bd->read(buffer, 0, TEST_SIZE));
+    EXPECT_EQ(TEST_BLOCKS, card->blocks_read);
+
+    // Start token polls, one data transfer and one CRC transfer per block
+    record("read_calls_per_kb", calls_per_kb(TEST_SIZE));
+    EXPECT_GE(11, calls_per_kb(TEST_SIZE));
+}
+
+TEST_F(TestSDBlockDevice, program_calls_per_kb)
+{
+    init(true);
+    EXPECT_EQ(BD_ERROR_OK, bd->program(pattern, 0, TEST_SIZE));
+    EXPECT_EQ(TEST_BLOCKS, card->blocks_written);
+
+    // Token, data and CRC with response per block, busy polled in bursts
+    record("program_calls_per_kb", calls_per_kb(TEST_SIZE));
+    EXPECT_GE(32, calls_per_kb(TEST_SIZE));
+    EXPECT_EQ(0, card->busy_violations);
+}
+
+TEST_F(TestSDBlockDevice, async_program_read)
+{
+    init(true);
+    events::EventQueue queue;
+    bd->set_event_queue(&queue);
+
+    bd_request_t program, read;
+    prepare(program, BD_REQUEST_PROGRAM, pattern, 2 * SD_CARD_SIM_BLOCK_SIZE, TEST_SIZE);
+    prepare(read, BD_REQUEST_READ, buffer, 2 * SD_CARD_SIM_BLOCK_SIZE, TEST_SIZE);
+    EXPECT_EQ(BD_ERROR_OK, bd->submit(&program));
+    EXPECT_EQ(BD_ERROR_OK, bd->submit(&read));
+
+    // Nothing happens on the caller's thread
+    EXPECT_EQ(0, card->spi_calls);
+    EXPECT_EQ(0, completed);
+
+    queue.dispatch(1000);
+    EXPECT_EQ(2, completed);
+    EXPECT_EQ(0, last_err);
+    EXPECT_EQ(&program, completion_order[0]);
+    EXPECT_EQ(1, card->cmd_count[25]);
+    EXPECT_EQ(1, card->acmd_count[23]);
+    EXPECT_EQ(TEST_BLOCKS, card->blocks_written);
+    EXPECT_EQ(0, memcmp(buffer, pattern, TEST_SIZE));
+    EXPECT_EQ(0, card->crc_errors);
+    EXPECT_EQ(0, card->busy_violations);
+}
+
+TEST_F(TestSDBlockDevice, async_polls_busy_card_from_the_queue)
+{
+    init(false);
+    card->set_program_busy(8 * 40);
+    events::EventQueue queue;
+    bd->set_event_queue(&queue);
+
+    bd_request_t program;
+    prepare(program, BD_REQUEST_PROGRAM, pattern, 0, 2 * SD_CARD_SIM_BLOCK_SIZE);
+    EXPECT_EQ(BD_ERROR_OK, bd->submit(&program));
+
+    // The first block is sent, and the queue is free while the card programs it
+    queue.dispatch(0);
+    EXPECT_EQ(1, card->blocks_written);
+    EXPECT_EQ(0, completed);
+
+    // A blocking call in between closes the open write
+    EXPECT_EQ(BD_ERROR_OK, bd->read(buffer, 0, SD_CARD_SIM_BLOCK_SIZE));
+    EXPECT_EQ(0, memcmp(buffer, pattern, SD_CARD_SIM_BLOCK_SIZE));
+
+    queue.dispatch(1000);
+    EXPECT_EQ(1, completed);
+    EXPECT_EQ(0, last_err);
+    EXPECT_EQ(2, card->cmd_count[25]);
+    EXPECT_EQ(0, memcmp(card->memory, pattern, 2 * SD_CARD_SIM_BLOCK_SIZE));
+    EXPECT_EQ(0, card->busy_violations);
+    // Long busy periods are polled once per millisecond of the simulated clock
+    EXPECT_LE(20u, last_tick);
+    EXPECT_GT(80u, last_tick);
+}
+
+TEST_F(TestSDBlockDevice, async_merges_adjacent_requests)
+{
+    init(true);
+    EXPECT_EQ(BD_ERROR_OK, bd->program(pattern, 0, TEST_SIZE));
+    events::EventQueue queue;
+    bd->set_event_queue(&queue);
+    card->reset_counters();
+
+    // Four reads into separate buffers, submitted out of order
+    uint8_t parts[4][TEST_SIZE / 4];
+    bd_request_t reads[4];
+    const int order[4] = { 2, 0, 3, 1 };
+    for (int i = 0; i < 4; i++) {
+        int part = order[i];
+        prepare(reads[part], BD_REQUEST_READ, parts[part], part * sizeof(parts[0]), sizeof(parts[0]));
+        EXPECT_EQ(BD_ERROR_OK, bd->submit(&reads[part]));
+    }
+    queue.dispatch(1000);
+    EXPECT_EQ(4, completed);
+    EXPECT_EQ(1, card->cmd_count[18]);
+    EXPECT_EQ(1, card->cmd_count[12]);
+    EXPECT_EQ(0, memcmp(parts, pattern, TEST_SIZE));
+
+    // Block trims in reverse order make up a single erase
+    bd_request_t trims[8];
+    for (int i = 0; i < 8; i++) {
+        prepare(trims[i], BD_REQUEST_TRIM, NULL, (7 - i) * SD_CARD_SIM_BLOCK_SIZE, SD_CARD_SIM_BLOCK_SIZE);
+        EXPECT_EQ(BD_ERROR_OK, bd->submit(&trims[i]));
+    }
+    queue.dispatch(1000);
+    EXPECT_EQ(12, completed);
+    EXPECT_EQ(0, last_err);
+    EXPECT_EQ(1, card->erases);
+    EXPECT_EQ(0xFF, card->memory[0]);
+    EXPECT_EQ(0xFF, card->memory[8 * SD_CARD_SIM_BLOCK_SIZE - 1]);
+    EXPECT_EQ(pattern[8 * SD_CARD_SIM_BLOCK_SIZE], card->memory[8 * SD_CARD_SIM_BLOCK_SIZE]);
+    EXPECT_EQ(0, card->busy_violations);
+}
+
+TEST_F(TestSDBlockDevice, async_rejects_invalid_requests)
+{
+    init(false);
+    events::EventQueue queue;
+    bd->set_event_queue(&queue);
+
+    bd_request_t program, trim;
+    prepare(program, BD_REQUEST_PROGRAM, pattern, 100, SD_CARD_SIM_BLOCK_SIZE);
+    prepare(trim, BD_REQUEST_TRIM, NULL, SD_CARD_SIM_SIZE, SD_CARD_SIM_BLOCK_SIZE);
+    EXPECT_EQ(TEST_SD_ERROR_PARAMETER, bd->submit(&program));
+    EXPECT_EQ(TEST_SD_ERROR_PARAMETER, bd->submit(&trim));
+
+    queue.dispatch(100);
+    EXPECT_EQ(0, completed);
+}
@@ -0,0 +1,32 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  ../components/storage/blockdevice/COMPONENT_SD
+  ../features/storage/blockdevice
+)
+
+set(unittest-sources
+  ../components/storage/blockdevice/COMPONENT_SD/SDBlockDevice.cpp
+  ../drivers/MbedCRC.cpp
+  ../drivers/TableCRC.cpp
+  ../features/storage/blockdevice/BlockDeviceRequestQueue.cpp
+  ../events/EventQueue.cpp
+  ../events/equeue/equeue.c
+)
+
+set(unittest-test-sources
+  components/storage/blockdevice/SDBlockDevice/test_SDBlockDevice.cpp
+  components/storage/blockdevice/SDBlockDevice/SDCardSim.cpp
+  stubs/mbed_assert_stub.c
+  stubs/mbed_critical_stub.c
+  stubs/mbed_shared_queues_stub.cpp
+  stubs/equeue_sim.c
+  stubs/mbed_wait_api_stub.cpp
+  stubs/Mutex_stub.cpp
+)
+
+set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DDEVICE_SPI=1")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -DDEVICE_SPI=1")
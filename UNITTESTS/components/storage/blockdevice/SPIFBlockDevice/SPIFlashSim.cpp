@@ -0,0 +1,384 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "SPIFlashSim.h"
+#include "SPI.h"
+#include "hal/gpio_api.h"
+
+#define SIM_PP      0x02
+#define SIM_READ    0x03
+#define SIM_WRDI    0x04
+#define SIM_RDSR    0x05
+#define SIM_WREN    0x06
+#define SIM_SE      0x20
+#define SIM_SFDP    0x5a
+#define SIM_RSTEN   0x66
+#define SIM_RST     0x99
+#define SIM_RDID    0x9f
+#define SIM_BE      0xd8
+
+#define SIM_STATUS_WIP  0x01
+#define SIM_STATUS_WEL  0x02
+
+#define SIM_BASIC_TABLE_ADDR    0x30
+#define SIM_SECTOR_MAP_TABLE_ADDR   0x70
+#define SIM_BOOT_REGION_SIZE    (64 * 1024)
+#define SIM_ERASE_POLLS_FACTOR  4
+
+SPIFlashSim *SPIFlashSim::instance = NULL;
+
+SPIFlashSim::SPIFlashSim(bool sector_map)
+    : _selected(false), _ignored(false), _instruction(0), _position(0), _address(0),
+      _page_bytes(0), _write_enabled(false), _reset_enabled(false), _busy_polls(0),
+      _program_polls(2)
+{
+    memset(memory, 0xFF, sizeof(memory));
+
+    // SFDP header: signature, revision 1.6 and the parameter headers
+    memset(_sfdp, 0xFF, sizeof(_sfdp));
+    memcpy(_sfdp, "SFDP", 4);
+    _sfdp[4] = 6;
+    _sfdp[5] = 1;
+    _sfdp[6] = sector_map ? 1 : 0;
+    _sfdp[7] = 0xFF;
+
+    // JEDEC Basic Flash Parameter header: 16 DWORDs at SIM_BASIC_TABLE_ADDR
+    _sfdp[8] = 0x00;
+    _sfdp[9] = 6;
+    _sfdp[10] = 1;
+    _sfdp[11] = 16;
+    _sfdp[12] = SIM_BASIC_TABLE_ADDR;
+    _sfdp[13] = 0;
+    _sfdp[14] = 0;
+    _sfdp[15] = 0xFF;
+
+    // Sector Map header: 3 DWORDs at SIM_SECTOR_MAP_TABLE_ADDR
+    _sfdp[16] = 0x81;
+    _sfdp[17] = 0;
+    _sfdp[18] = 1;
+    _sfdp[19] = 3;
+    _sfdp[20] = SIM_SECTOR_MAP_TABLE_ADDR;
+    _sfdp[21] = 0;
+    _sfdp[22] = 0;
+    _sfdp[23] = 0xFF;
+
+    uint8_t *table = &_sfdp[SIM_BASIC_TABLE_ADDR];
+    memset(table, 0, 64);
+    table[0] = 0xE5;
+    table[1] = SIM_SE;          // Legacy 4KB erase instruction
+    table[2] = 0x00;            // 3 byte addressing only
+    uint32_t density = SPI_FLASH_SIM_SIZE * 8 - 1;
+    table[4] = density & 0xFF;
+    table[5] = (density >> 8) & 0xFF;
+    table[6] = (density >> 16) & 0xFF;
+    table[7] = (density >> 24) & 0xFF;
+    table[28] = 12;             // Erase type 1: 4KB
+    table[29] = SIM_SE;
+    table[30] = 16;             // Erase type 2: 64KB
+    table[31] = SIM_BE;
+    table[40] = 8 << 4;         // Page size 2^8
+
+    // Boot region erased in 4KB sectors, the rest of the device in 64KB sectors
+    uint8_t *map = &_sfdp[SIM_SECTOR_MAP_TABLE_ADDR];
+    uint32_t boot_units = SIM_BOOT_REGION_SIZE / 256 - 1;
+    uint32_t main_units = (SPI_FLASH_SIM_SIZE - SIM_BOOT_REGION_SIZE) / 256 - 1;
+    map[0] = 0x03;
+    map[1] = 0;
+    map[2] = 1;
+    map[3] = 0xFF;
+    map[4] = 0x01;
+    map[5] = boot_units & 0xFF;
+    map[6] = (boot_units >> 8) & 0xFF;
+    map[7] = (boot_units >> 16) & 0xFF;
+    map[8] = 0x02;
+    map[9] = main_units & 0xFF;
+    map[10] = (main_units >> 8) & 0xFF;
+    map[11] = (main_units >> 16) & 0xFF;
+
+    reset_counters();
+    instance = this;
+}
+
+SPIFlashSim::~SPIFlashSim()
+{
+    if (instance == this) {
+        instance = NULL;
+    }
+}
+
+void SPIFlashSim::reset_counters()
+{
+    spi_calls = 0;
+    bytes = 0;
+    commands = 0;
+    page_programs = 0;
+    erases = 0;
+    status_polls = 0;
+    busy_violations = 0;
+}
+
+unsigned SPIFlashSim::address_bytes(uint8_t instruction) const
+{
+    switch (instruction) {
+        case SIM_PP:
+        case SIM_READ:
+        case SIM_SE:
+        case SIM_BE:
+        case SIM_SFDP:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+unsigned SPIFlashSim::dummy_bytes(uint8_t instruction) const
+{
+    return instruction == SIM_SFDP ? 1 : 0;
+}
+
+void SPIFlashSim::select(bool selected)
+{
+    if (selected == _selected) {
+        return;
+    }
+
+    _selected = selected;
+    if (selected) {
+        _position = 0;
+        _address = 0;
+        _page_bytes = 0;
+        _ignored = false;
+    } else if (_position) {
+        end_command();
+    }
+}
+
+uint8_t SPIFlashSim::exchange(uint8_t mosi)
+{
+    bytes++;
+    if (!_selected) {
+        return 0xFF;
+    }
+
+    unsigned position = _position++;
+    if (position == 0) {
+        _instruction = mosi;
+        commands++;
+        if (_busy_polls && _instruction != SIM_RDSR) {
+            busy_violations++;
+            _ignored = true;
+        }
+        if (_instruction == SIM_PP) {
+            memset(_page, 0xFF, sizeof(_page));
+        }
+        return 0xFF;
+    }
+
+    if (_ignored) {
+        return 0xFF;
+    }
+
+    unsigned header = 1 + address_bytes(_instruction);
+    if (position < header) {
+        _address = (_address << 8) | mosi;
+        return 0xFF;
+    }
+
+    if (position < header + dummy_bytes(_instruction)) {
+        return 0xFF;
+    }
+
+    switch (_instruction) {
+        case SIM_RDSR:
+            return (_busy_polls ? SIM_STATUS_WIP : 0) | (_write_enabled ? SIM_STATUS_WEL : 0);
+        case SIM_RDID: {
+            static const uint8_t id[3] = {0xEF, 0x40, 0x15};
+            return id[(position - 1) % 3];
+        }
+        case SIM_READ: {
+            uint8_t value = memory[_address % SPI_FLASH_SIM_SIZE];
+            _address++;
+            return value;
+        }
+        case SIM_SFDP: {
+            uint8_t value = _address < sizeof(_sfdp) ? _sfdp[_address] : 0xFF;
+            _address++;
+            return value;
+        }
+        case SIM_PP:
+            // Data wraps around within the addressed page
+            _page[(_address + _page_bytes) % SPI_FLASH_SIM_PAGE_SIZE] &= mosi;
+            _page_bytes++;
+            return 0xFF;
+        default:
+            return 0xFF;
+    }
+}
+
+void SPIFlashSim::end_command()
+{
+    if (_instruction == SIM_RDSR) {
+        status_polls++;
+        if (_busy_polls) {
+            _busy_polls--;
+        }
+        return;
+    }
+
+    if (_ignored) {
+        return;
+    }
+
+    bool reset_enabled = _reset_enabled;
+    _reset_enabled = false;
+
+    switch (_instruction) {
+        case SIM_WREN:
+            _write_enabled = true;
+            break;
+        case SIM_WRDI:
+            _write_enabled = false;
+            break;
+        case SIM_RSTEN:
+            _reset_enabled = true;
+            break;
+        case SIM_RST:
+            if (reset_enabled) {
+                _write_enabled = false;
+                _busy_polls = 0;
+            }
+            break;
+        case SIM_PP:
+            if (_write_enabled && _page_bytes) {
+                uint32_t base = (_address % SPI_FLASH_SIM_SIZE) & ~(SPI_FLASH_SIM_PAGE_SIZE - 1);
+                for (unsigned i = 0; i < SPI_FLASH_SIM_PAGE_SIZE; i++) {
+                    memory[base + i] &= _page[i];
+                }
+                page_programs++;
+                _busy_polls = _program_polls;
+            }
+            _write_enabled = false;
+            break;
+        case SIM_SE:
+        case SIM_BE:
+            if (_write_enabled) {
+                uint32_t size = _instruction == SIM_SE ? 4096 : 65536;
+                uint32_t base = (_address % SPI_FLASH_SIM_SIZE) & ~(size - 1);
+                memset(&memory[base], 0xFF, size);
+                erases++;
+                _busy_polls = _program_polls * SIM_ERASE_POLLS_FACTOR;
+            }
+            _write_enabled = false;
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * mbed::SPI and gpio HAL connected to the simulated flash
+ */
+namespace mbed {
+
+SPI::SPI(PinName mosi, PinName miso, PinName sclk, PinName ssel)
+    : _bits(8), _mode(0), _hz(1000000), _write_fill(0xFF)
+{
+}
+
+SPI::~SPI()
+{
+}
+
+void SPI::format(int bits, int mode)
+{
+    _bits = bits;
+    _mode = mode;
+}
+
+void SPI::frequency(int hz)
+{
+    _hz = hz;
+}
+
+int SPI::write(int value)
+{
+    if (!SPIFlashSim::instance) {
+        return 0xFF;
+    }
+    SPIFlashSim::instance->spi_calls++;
+    return SPIFlashSim::instance->exchange(value);
+}
+
+int SPI::write(const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length)
+{
+    if (!SPIFlashSim::instance) {
+        return 0;
+    }
+    SPIFlashSim::instance->spi_calls++;
+
+    int total = tx_length > rx_length ? tx_length : rx_length;
+    for (int i = 0; i < total; i++) {
+        char out = SPIFlashSim::instance->exchange(i < tx_length ? tx_buffer[i] : _write_fill);
+        if (i < rx_length) {
+            rx_buffer[i] = out;
+        }
+    }
+    return total;
+}
+
+void SPI::lock()
+{
+}
+
+void SPI::unlock()
+{
+}
+
+void SPI::set_default_write_value(char data)
+{
+    _write_fill = data;
+}
+
+} // namespace mbed
+
+void gpio_init_out(gpio_t *gpio, PinName pin)
+{
+}
+
+void gpio_init_out_ex(gpio_t *gpio, PinName pin, int value)
+{
+    gpio_write(gpio, value);
+}
+
+void gpio_write(gpio_t *obj, int value)
+{
+    if (SPIFlashSim::instance) {
+        SPIFlashSim::instance->select(value == 0);
+    }
+}
+
+int gpio_read(gpio_t *obj)
+{
+    return 1;
+}
+
+int gpio_is_connected(const gpio_t *obj)
+{
+    return 1;
+}
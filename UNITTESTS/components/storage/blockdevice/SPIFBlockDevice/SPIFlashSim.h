@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPI_FLASH_SIM_H
+#define SPI_FLASH_SIM_H
+
+#include <stdint.h>
+
+#define SPI_FLASH_SIM_SIZE          (2 * 1024 * 1024)
+#define SPI_FLASH_SIM_PAGE_SIZE     256
+#define SPI_FLASH_SIM_SFDP_SIZE     0x80
+
+/** SFDP compliant SPI NOR flash attached to the mbed::SPI and gpio stubs
+ *
+ * The chip select is the only DigitalOut of the test. Every call to
+ * SPI::write() is counted so tests can measure the driver overhead of a
+ * block device operation. Page programs and erases keep the device busy
+ * for a fixed number of status register polls; any other command sent
+ * while the device is busy is ignored and counted as a violation.
+ *
+ * With a sector map the first 64KB of the device are erased in 4KB sectors
+ * and the rest of it in 64KB sectors.
+ */
+class SPIFlashSim {
+public:
+    explicit SPIFlashSim(bool sector_map = false);
+
+    ~SPIFlashSim();
+
+    /** The flash the SPI and gpio stubs are connected to */
+    static SPIFlashSim *instance;
+
+    /** Status register polls a page program keeps the device busy for */
+    void set_program_polls(unsigned polls)
+    {
+        _program_polls = polls;
+    }
+
+    void reset_counters();
+
+    void select(bool selected);
+
+    uint8_t exchange(uint8_t mosi);
+
+    uint8_t memory[SPI_FLASH_SIM_SIZE];
+
+    uint32_t spi_calls;
+    uint32_t bytes;
+    uint32_t commands;
+    uint32_t page_programs;
+    uint32_t erases;
+    uint32_t status_polls;
+    uint32_t busy_violations;
+
+private:
+    void end_command();
+    unsigned address_bytes(uint8_t instruction) const;
+    unsigned dummy_bytes(uint8_t instruction) const;
+
+    uint8_t _sfdp[SPI_FLASH_SIM_SFDP_SIZE];
+    uint8_t _page[SPI_FLASH_SIM_PAGE_SIZE];
+    bool _selected;
+    bool _ignored;
+    uint8_t _instruction;
+    unsigned _position;
+    uint32_t _address;
+    unsigned _page_bytes;
+    bool _write_enabled;
+    bool _reset_enabled;
+    unsigned _busy_polls;
+    unsigned _program_polls;
+};
+
+#endif /* SPI_FLASH_SIM_H */
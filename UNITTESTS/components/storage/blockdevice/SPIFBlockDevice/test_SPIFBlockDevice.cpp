@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "SPIFBlockDevice.h"
+#include "SPIFlashSim.h"
+#include "events/EventQueue.h"
+#include "equeue_sim.h"
+
+#include <string.h>
+
+#define TEST_BLOCK_SIZE 4096
+
+class TestSPIFBlockDevice : public testing::Test {
+protected:
+    SPIFlashSim *flash;
+    SPIFBlockDevice *bd;
+    uint8_t buffer[TEST_BLOCK_SIZE];
+    uint8_t pattern[TEST_BLOCK_SIZE];
+
+    virtual void SetUp()
+    {
+        flash = new SPIFlashSim;
+        bd = new SPIFBlockDevice(NC, NC, NC, NC);
+        ASSERT_EQ(SPIF_BD_ERROR_OK, bd->init());
+        flash->reset_counters();
+
+        for (int i = 0; i < TEST_BLOCK_SIZE; i++) {
+            pattern[i] = (i * 7) ^ (i >> 8);
+        }
+        completed = 0;
+        last_err = 0;
+        equeue_sim_set_tick(0);
+    }
+
+    virtual void TearDown()
+    {
+        delete bd;
+        delete flash;
+    }
+
+    /** Results of the requests queued with submit() */
+    int completed;
+    int last_err;
+    bd_request_t *completion_order[32];
+
+    void done(bd_request_t *request, int err)
+    {
+        if (completed < 32) {
+            completion_order[completed] = request;
+        }
+        completed++;
+        if (err) {
+            last_err = err;
+        }
+    }
+
+    void prepare(bd_request_t &request, bd_request_type_t type, void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        request.type = type;
+        request.buffer = buffer;
+        request.addr = addr;
+        request.size = size;
+        request.callback = mbed::callback(this, &TestSPIFBlockDevice::done);
+    }
+
+    /** Driver calls per KB of data moved by the last operation */
+    uint32_t calls_per_kb(bd_size_t size)
+    {
+        return (flash->spi_calls * 1024 + size - 1) / size;
+    }
+};
+
+TEST_F(TestSPIFBlockDevice, init)
+{
+    EXPECT_EQ(SPI_FLASH_SIM_SIZE, bd->size());
+    EXPECT_EQ(1, bd->get_read_size());
+    EXPECT_EQ(1, bd->get_program_size());
+    EXPECT_EQ(4096, bd->get_erase_size());
+    EXPECT_EQ(0xFF, bd->get_erase_value());
+}
+
+TEST_F(TestSPIFBlockDevice, program_read)
+{
+    // Unaligned start and a length covering several partial and full pages
+    bd_addr_t addr = 3 * SPI_FLASH_SIM_PAGE_SIZE + 17;
+    bd_size_t size = 5 * SPI_FLASH_SIM_PAGE_SIZE + 100;
+
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, addr, size));
+    EXPECT_EQ(6, flash->page_programs);
+
+    memset(buffer, 0, sizeof(buffer));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->read(buffer, addr, size));
+    EXPECT_EQ(0, memcmp(buffer, pattern, size));
+    EXPECT_EQ(0, memcmp(&flash->memory[addr], pattern, size));
+    EXPECT_EQ(0xFF, flash->memory[addr - 1]);
+    EXPECT_EQ(0xFF, flash->memory[addr + size]);
+    EXPECT_EQ(0, flash->busy_violations);
+}
+
+TEST_F(TestSPIFBlockDevice, erase)
+{
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, 0, TEST_BLOCK_SIZE));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, 2 * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE));
+
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->erase(0, TEST_BLOCK_SIZE));
+    EXPECT_EQ(1, flash->erases);
+    EXPECT_EQ(0, flash->busy_violations);
+
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->read(buffer, 0, TEST_BLOCK_SIZE));
+    for (int i = 0; i < TEST_BLOCK_SIZE; i++) {
+        EXPECT_EQ(0xFF, buffer[i]);
+    }
+    EXPECT_EQ(0, memcmp(&flash->memory[2 * TEST_BLOCK_SIZE], pattern, TEST_BLOCK_SIZE));
+
+    EXPECT_EQ(SPIF_BD_ERROR_INVALID_ERASE_PARAMS, bd->erase(100, TEST_BLOCK_SIZE));
+}
+
+TEST_F(TestSPIFBlockDevice, sector_map_regions)
+{
+    delete bd;
+    delete flash;
+    flash = new SPIFlashSim(true);
+    bd = new SPIFBlockDevice(NC, NC, NC, NC);
+    ASSERT_EQ(SPIF_BD_ERROR_OK, bd->init());
+
+    // 64KB boot region of 4KB sectors, 64KB sectors after it
+    EXPECT_EQ(4096, bd->get_erase_size(0));
+    EXPECT_EQ(4096, bd->get_erase_size(60 * 1024));
+    EXPECT_EQ(65536, bd->get_erase_size(64 * 1024));
+    EXPECT_EQ(65536, bd->get_erase_size(SPI_FLASH_SIM_SIZE - 1));
+    EXPECT_EQ(0, bd->get_erase_size());
+
+    flash->reset_counters();
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->erase(0, TEST_BLOCK_SIZE));
+    EXPECT_EQ(1, flash->erases);
+    EXPECT_EQ(SPIF_BD_ERROR_INVALID_ERASE_PARAMS, bd->erase(64 * 1024, TEST_BLOCK_SIZE));
+
+    // Crossing from the boot region into the next one
+    flash->reset_counters();
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, 60 * 1024, TEST_BLOCK_SIZE));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, 64 * 1024, TEST_BLOCK_SIZE));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->erase(60 * 1024, 4 * 1024 + 64 * 1024));
+    EXPECT_EQ(2, flash->erases);
+    EXPECT_EQ(0xFF, flash->memory[60 * 1024]);
+    EXPECT_EQ(0xFF, flash->memory[64 * 1024]);
+    EXPECT_EQ(0, flash->busy_violations);
+}
+
+TEST_F(TestSPIFBlockDevice, read_calls_per_kb)
+{
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->read(buffer, 0, TEST_BLOCK_SIZE));
+
+    // Command header and data phase, independent of the size
+    EXPECT_EQ(2, flash->spi_calls);
+    EXPECT_GE(1, calls_per_kb(TEST_BLOCK_SIZE));
+}
+
+TEST_F(TestSPIFBlockDevice, program_calls_per_kb)
+{
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, 0, TEST_BLOCK_SIZE));
+    EXPECT_EQ(TEST_BLOCK_SIZE / SPI_FLASH_SIM_PAGE_SIZE, flash->page_programs);
+
+    // A handful of commands per page instead of one call per byte
+    EXPECT_GE(64, calls_per_kb(TEST_BLOCK_SIZE));
+    EXPECT_EQ(0, flash->busy_violations);
+}
+
+TEST_F(TestSPIFBlockDevice, program_completes_before_next_command)
+{
+    flash->set_program_polls(5);
+
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, 0, SPI_FLASH_SIM_PAGE_SIZE));
+
+    // program() returns while the last page is still being written
+    uint32_t polls = flash->status_polls;
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->read(buffer, 0, SPI_FLASH_SIM_PAGE_SIZE));
+    EXPECT_LT(polls, flash->status_polls);
+    EXPECT_EQ(0, memcmp(buffer, pattern, SPI_FLASH_SIM_PAGE_SIZE));
+
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, SPI_FLASH_SIM_PAGE_SIZE, SPI_FLASH_SIM_PAGE_SIZE));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->sync());
+    polls = flash->status_polls;
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->sync());
+    EXPECT_EQ(polls, flash->status_polls);
+
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, 2 * SPI_FLASH_SIM_PAGE_SIZE, SPI_FLASH_SIM_PAGE_SIZE));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->erase(TEST_BLOCK_SIZE, TEST_BLOCK_SIZE));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->deinit());
+    EXPECT_EQ(0, flash->busy_violations);
+}
+
+TEST_F(TestSPIFBlockDevice, async_program_read)
+{
+    events::EventQueue queue;
+    bd->set_event_queue(&queue);
+
+    bd_request_t program, read;
+    prepare(program, BD_REQUEST_PROGRAM, pattern, 17, 3 * SPI_FLASH_SIM_PAGE_SIZE);
+    prepare(read, BD_REQUEST_READ, buffer, 17, 3 * SPI_FLASH_SIM_PAGE_SIZE);
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->submit(&program));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->submit(&read));
+
+    // Nothing happens on the caller's thread
+    EXPECT_EQ(0, flash->commands);
+    EXPECT_EQ(0, completed);
+
+    queue.dispatch(100);
+    EXPECT_EQ(2, completed);
+    EXPECT_EQ(0, last_err);
+    EXPECT_EQ(&program, completion_order[0]);
+    EXPECT_EQ(0, memcmp(buffer, pattern, 3 * SPI_FLASH_SIM_PAGE_SIZE));
+    EXPECT_EQ(4, flash->page_programs);
+    EXPECT_EQ(0, flash->busy_violations);
+}
+
+TEST_F(TestSPIFBlockDevice, async_erase_polls_from_the_queue)
+{
+    events::EventQueue queue;
+    bd->set_event_queue(&queue);
+    flash->set_program_polls(10);
+
+    bd_request_t erase;
+    prepare(erase, BD_REQUEST_ERASE, NULL, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE);
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->submit(&erase));
+
+    // The erase is started, and the queue is free while the flash is busy
+    queue.dispatch(0);
+    EXPECT_EQ(1, flash->erases);
+    EXPECT_EQ(0, completed);
+
+    queue.dispatch(1000);
+    EXPECT_EQ(1, completed);
+    EXPECT_EQ(0, last_err);
+    EXPECT_EQ(0, flash->busy_violations);
+    // One status poll per millisecond of the simulated clock
+    EXPECT_LE(40u, flash->status_polls);
+    EXPECT_GT(50u, flash->status_polls);
+}
+
+TEST_F(TestSPIFBlockDevice, async_merges_adjacent_requests)
+{
+    events::EventQueue queue;
+    bd->set_event_queue(&queue);
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, 0, TEST_BLOCK_SIZE));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->sync());
+    flash->reset_counters();
+
+    // Four reads into separate buffers, submitted out of order
+    uint8_t parts[4][TEST_BLOCK_SIZE / 4];
+    bd_request_t reads[4];
+    const int order[4] = { 2, 0, 3, 1 };
+    for (int i = 0; i < 4; i++) {
+        int part = order[i];
+        prepare(reads[part], BD_REQUEST_READ, parts[part], part * sizeof(parts[0]), sizeof(parts[0]));
+        EXPECT_EQ(SPIF_BD_ERROR_OK, bd->submit(&reads[part]));
+    }
+    queue.dispatch(100);
+    EXPECT_EQ(4, completed);
+    EXPECT_EQ(1, flash->commands);
+    EXPECT_EQ(0, memcmp(parts, pattern, TEST_BLOCK_SIZE));
+
+    // Sixteen sector erases make up a single 64KB block erase
+    bd_request_t erases[16];
+    for (int i = 0; i < 16; i++) {
+        prepare(erases[i], BD_REQUEST_ERASE, NULL, (15 - i) * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE);
+        EXPECT_EQ(SPIF_BD_ERROR_OK, bd->submit(&erases[i]));
+    }
+    queue.dispatch(1000);
+    EXPECT_EQ(20, completed);
+    EXPECT_EQ(0, last_err);
+    EXPECT_EQ(1, flash->erases);
+    EXPECT_EQ(0xFF, flash->memory[0]);
+    EXPECT_EQ(0, flash->busy_violations);
+}
+
+TEST_F(TestSPIFBlockDevice, async_keeps_order_of_overlapping_requests)
+{
+    events::EventQueue queue;
+    bd->set_event_queue(&queue);
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->program(pattern, 0, TEST_BLOCK_SIZE));
+
+    bd_request_t read_before, erase, read_after, sync;
+    uint8_t before[16], after[16];
+    prepare(read_before, BD_REQUEST_READ, before, 0, sizeof(before));
+    prepare(erase, BD_REQUEST_ERASE, NULL, 0, TEST_BLOCK_SIZE);
+    prepare(read_after, BD_REQUEST_READ, after, 0, sizeof(after));
+    prepare(sync, BD_REQUEST_SYNC, NULL, 0, 0);
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->submit(&read_before));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->submit(&erase));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->submit(&read_after));
+    EXPECT_EQ(SPIF_BD_ERROR_OK, bd->submit(&sync));
+    queue.dispatch(1000);
+
+    EXPECT_EQ(4, completed);
+    EXPECT_EQ(0, memcmp(before, pattern, sizeof(before)));
+    for (size_t i = 0; i < sizeof(after); i++) {
+        EXPECT_EQ(0xFF, after[i]);
+    }
+    EXPECT_EQ(&sync, completion_order[3]);
+}
+
+TEST_F(TestSPIFBlockDevice, async_rejects_invalid_requests)
+{
+    events::EventQueue queue;
+    bd->set_event_queue(&queue);
+
+    bd_request_t erase, read;
+    prepare(erase, BD_REQUEST_ERASE, NULL, 100, TEST_BLOCK_SIZE);
+    prepare(read, BD_REQUEST_READ, buffer, SPI_FLASH_SIM_SIZE - 1, 2);
+    EXPECT_EQ(SPIF_BD_ERROR_INVALID_ERASE_PARAMS, bd->submit(&erase));
+    EXPECT_EQ(SPIF_BD_ERROR_DEVICE_ERROR, bd->submit(&read));
+
+    queue.dispatch(100);
+    EXPECT_EQ(0, completed);
+}
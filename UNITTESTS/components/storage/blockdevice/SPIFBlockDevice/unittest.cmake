@@ -0,0 +1,28 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  ../components/storage/blockdevice/COMPONENT_SPIF
+  ../features/storage/blockdevice
+  ../features/frameworks/mbed-trace/mbed-trace
+)
+
+set(unittest-sources
+  ../components/storage/blockdevice/COMPONENT_SPIF/SPIFBlockDevice.cpp
+  ../features/storage/blockdevice/BlockDeviceRequestQueue.cpp
+  ../events/EventQueue.cpp
+  ../events/equeue/equeue.c
+)
+
+set(unittest-test-sources
+  components/storage/blockdevice/SPIFBlockDevice/test_SPIFBlockDevice.cpp
+  components/storage/blockdevice/SPIFBlockDevice/SPIFlashSim.cpp
+  stubs/mbed_assert_stub.c
+  stubs/mbed_critical_stub.c
+  stubs/mbed_shared_queues_stub.cpp
+  stubs/equeue_sim.c
+  stubs/mbed_wait_api_stub.cpp
+  stubs/Mutex_stub.cpp
+)
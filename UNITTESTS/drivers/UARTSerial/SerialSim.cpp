@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SerialSim.h"
+#include "platform/mbed_power_mgmt.h"
+
+SerialSim *SerialSim::instance = NULL;
+
+SerialSim::SerialSim(unsigned tx_fifo_depth, unsigned rx_fifo_depth)
+    : now(0), _tx_fifo_depth(tx_fifo_depth), _rx_fifo_depth(rx_fifo_depth), _baud(9600), _tx_done(0),
+      _handler(NULL), _handler_id(0), _tx_irq_enabled(false), _rx_irq_enabled(false)
+{
+    reset_counters();
+    instance = this;
+}
+
+SerialSim::~SerialSim()
+{
+    if (instance == this) {
+        instance = NULL;
+    }
+}
+
+void SerialSim::reset_counters()
+{
+    sleeps = 0;
+    tx_irqs = 0;
+    rx_irqs = 0;
+    rx_overruns = 0;
+}
+
+uint64_t SerialSim::byte_time() const
+{
+    // Start bit, 8 data bits and a stop bit
+    return 10 * 1000000000ULL / _baud;
+}
+
+void SerialSim::inject_rx(const char *data, size_t length)
+{
+    uint64_t arrival = _rx.empty() ? now : _rx.back().arrival;
+    if (arrival < now) {
+        arrival = now;
+    }
+    for (size_t i = 0; i < length; i++) {
+        arrival += byte_time();
+        rx_byte byte = {arrival, data[i]};
+        _rx.push_back(byte);
+    }
+}
+
+unsigned SerialSim::tx_level() const
+{
+    if (_tx_done <= now) {
+        return 0;
+    }
+    return (_tx_done - now + byte_time() - 1) / byte_time();
+}
+
+bool SerialSim::irq_pending()
+{
+    return (_tx_irq_enabled && tx_level() == 0) || (_rx_irq_enabled && readable());
+}
+
+bool SerialSim::next_event(uint64_t &time)
+{
+    bool found = false;
+
+    if (_tx_irq_enabled && _tx_done > now) {
+        time = _tx_done;
+        found = true;
+    }
+    if (_rx_irq_enabled && !_rx.empty() && (!found || _rx.front().arrival < time)) {
+        time = _rx.front().arrival;
+        found = true;
+    }
+
+    return found;
+}
+
+void SerialSim::advance_to(uint64_t time)
+{
+    now = time;
+
+    // Characters arriving while the RX FIFO is full are lost
+    size_t arrived = 0;
+    while (arrived < _rx.size() && _rx[arrived].arrival <= now) {
+        arrived++;
+    }
+    while (arrived > _rx_fifo_depth) {
+        _rx.erase(_rx.begin() + _rx_fifo_depth);
+        rx_overruns++;
+        arrived--;
+    }
+}
+
+void SerialSim::service_irqs()
+{
+    if (!_handler) {
+        return;
+    }
+    if (_rx_irq_enabled && readable()) {
+        rx_irqs++;
+        _handler(_handler_id, RxIrq);
+    }
+    if (_tx_irq_enabled && tx_level() == 0) {
+        tx_irqs++;
+        _handler(_handler_id, TxIrq);
+    }
+}
+
+void SerialSim::sleep()
+{
+    sleeps++;
+
+    while (!irq_pending()) {
+        uint64_t time;
+        if (!next_event(time)) {
+            fprintf(stderr, "SerialSim: sleeping with no interrupt to wake up\n");
+            abort();
+        }
+        advance_to(time);
+    }
+
+    service_irqs();
+}
+
+void SerialSim::run_for(uint64_t ns)
+{
+    uint64_t end = now + ns;
+    uint64_t time;
+
+    service_irqs();
+    while (next_event(time) && time <= end) {
+        advance_to(time);
+        service_irqs();
+    }
+    advance_to(end);
+    service_irqs();
+}
+
+void SerialSim::irq_handler(uart_irq_handler handler, uint32_t id)
+{
+    _handler = handler;
+    _handler_id = id;
+}
+
+void SerialSim::irq_set(SerialIrq irq, bool enable)
+{
+    if (irq == TxIrq) {
+        _tx_irq_enabled = enable;
+    } else {
+        _rx_irq_enabled = enable;
+    }
+}
+
+void SerialSim::baud(int baudrate)
+{
+    _baud = baudrate;
+}
+
+bool SerialSim::readable()
+{
+    return !_rx.empty() && _rx.front().arrival <= now;
+}
+
+int SerialSim::getc()
+{
+    if (!readable()) {
+        return 0;
+    }
+    char data = _rx.front().data;
+    _rx.pop_front();
+    return data;
+}
+
+bool SerialSim::writable()
+{
+    return tx_level() < _tx_fifo_depth;
+}
+
+void SerialSim::putc(int c)
+{
+    if (_tx_done < now) {
+        _tx_done = now;
+    }
+    _tx_done += byte_time();
+    tx_data += (char)c;
+}
+
+/*
+ * Serial HAL and sleep manager connected to the simulated UART
+ */
+void serial_init(serial_t *obj, PinName tx, PinName rx)
+{
+}
+
+void serial_free(serial_t *obj)
+{
+}
+
+void serial_baud(serial_t *obj, int baudrate)
+{
+    if (SerialSim::instance) {
+        SerialSim::instance->baud(baudrate);
+    }
+}
+
+void serial_format(serial_t *obj, int data_bits, SerialParity parity, int stop_bits)
+{
+}
+
+void serial_irq_handler(serial_t *obj, uart_irq_handler handler, uint32_t id)
+{
+    if (SerialSim::instance) {
+        SerialSim::instance->irq_handler(handler, id);
+    }
+}
+
+void serial_irq_set(serial_t *obj, SerialIrq irq, uint32_t enable)
+{
+    if (SerialSim::instance) {
+        SerialSim::instance->irq_set(irq, enable != 0);
+    }
+}
+
+int serial_getc(serial_t *obj)
+{
+    return SerialSim::instance ? SerialSim::instance->getc() : 0;
+}
+
+void serial_putc(serial_t *obj, int c)
+{
+    if (SerialSim::instance) {
+        SerialSim::instance->putc(c);
+    }
+}
+
+int serial_readable(serial_t *obj)
+{
+    return SerialSim::instance && SerialSim::instance->readable();
+}
+
+int serial_writable(serial_t *obj)
+{
+    return SerialSim::instance && SerialSim::instance->writable();
+}
+
+void serial_clear(serial_t *obj)
+{
+}
+
+void serial_break_set(serial_t *obj)
+{
+}
+
+void serial_break_clear(serial_t *obj)
+{
+}
+
+void sleep_manager_lock_deep_sleep(void)
+{
+}
+
+void sleep_manager_unlock_deep_sleep(void)
+{
+}
+
+void sleep_manager_sleep_auto(void)
+{
+    if (SerialSim::instance) {
+        SerialSim::instance->sleep();
+    }
+}
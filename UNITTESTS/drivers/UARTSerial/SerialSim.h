@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SERIAL_SIM_H
+#define SERIAL_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <string>
+#include "hal/serial_api.h"
+
+/** UART peripheral behind the serial HAL, with a simulated clock
+ *
+ * Time only passes while the core sleeps: sleep_manager_sleep_auto()
+ * advances the clock to the next enabled interrupt and calls the
+ * registered handler, so a blocked read or write shows up as a number
+ * of wake-ups and an amount of line time. The TX interrupt fires when
+ * the TX FIFO is empty, the RX interrupt while RX data is available.
+ */
+class SerialSim {
+public:
+    SerialSim(unsigned tx_fifo_depth, unsigned rx_fifo_depth);
+
+    ~SerialSim();
+
+    /** The UART the serial HAL stub is connected to */
+    static SerialSim *instance;
+
+    /** Receive data back to back at the line rate, starting now */
+    void inject_rx(const char *data, size_t length);
+
+    /** Let time pass, servicing interrupts, without sleeping */
+    void run_for(uint64_t ns);
+
+    /** Line time of a single 8N1 character */
+    uint64_t byte_time() const;
+
+    void reset_counters();
+
+    void sleep();
+
+    void irq_handler(uart_irq_handler handler, uint32_t id);
+    void irq_set(SerialIrq irq, bool enable);
+    void baud(int baudrate);
+    int getc();
+    void putc(int c);
+    bool readable();
+    bool writable();
+
+    uint64_t now;
+    std::string tx_data;
+
+    uint32_t sleeps;
+    uint32_t tx_irqs;
+    uint32_t rx_irqs;
+    uint32_t rx_overruns;
+
+private:
+    unsigned tx_level() const;
+    bool irq_pending();
+    bool next_event(uint64_t &time);
+    void advance_to(uint64_t time);
+    void service_irqs();
+
+    struct rx_byte {
+        uint64_t arrival;
+        char data;
+    };
+
+    const unsigned _tx_fifo_depth;
+    const unsigned _rx_fifo_depth;
+    int _baud;
+    uint64_t _tx_done;
+    std::deque<rx_byte> _rx;
+    uart_irq_handler _handler;
+    uint32_t _handler_id;
+    bool _tx_irq_enabled;
+    bool _rx_irq_enabled;
+};
+
+#endif /* SERIAL_SIM_H */
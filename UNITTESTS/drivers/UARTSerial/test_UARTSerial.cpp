@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "UARTSerial.h"
+#include "SerialSim.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define TEST_BAUD           921600
+#define TEST_FIFO_DEPTH     16
+#define TEST_DATA_SIZE      4096
+
+using namespace mbed;
+
+class TestUARTSerial : public testing::Test {
+protected:
+    SerialSim *sim;
+    UARTSerial *serial;
+    char pattern[TEST_DATA_SIZE];
+    char buffer[TEST_DATA_SIZE];
+    int sigio_calls;
+
+    virtual void SetUp()
+    {
+        sim = new SerialSim(TEST_FIFO_DEPTH, TEST_FIFO_DEPTH);
+        serial = new UARTSerial(NC, NC, TEST_BAUD);
+        sigio_calls = 0;
+
+        for (int i = 0; i < TEST_DATA_SIZE; i++) {
+            pattern[i] = (i * 7) ^ (i >> 8);
+        }
+    }
+
+    virtual void TearDown()
+    {
+        delete serial;
+        delete sim;
+    }
+
+public:
+    void sigio()
+    {
+        sigio_calls++;
+    }
+};
+
+TEST_F(TestUARTSerial, write_blocking_at_line_rate)
+{
+    EXPECT_EQ(TEST_DATA_SIZE, serial->write(pattern, TEST_DATA_SIZE));
+    EXPECT_EQ(0, serial->sync());
+
+    // The last FIFO load is still being shifted out
+    ASSERT_EQ(TEST_DATA_SIZE, sim->tx_data.size());
+    EXPECT_EQ(0, memcmp(sim->tx_data.data(), pattern, TEST_DATA_SIZE));
+
+    uint64_t line_time = (TEST_DATA_SIZE - TEST_FIFO_DEPTH) * sim->byte_time();
+    RecordProperty("tx_bytes_per_second", (int)(TEST_DATA_SIZE * 1000000000ULL / sim->now));
+    RecordProperty("tx_wakeups_per_kb", sim->sleeps * 1024 / TEST_DATA_SIZE);
+
+    // No idle line time between the FIFO loads
+    EXPECT_GE(line_time, sim->now);
+    // One wake-up per FIFO load instead of one per 1ms poll or per byte
+    EXPECT_GE(TEST_DATA_SIZE / TEST_FIFO_DEPTH + 1, sim->sleeps);
+    EXPECT_EQ(sim->sleeps, sim->tx_irqs);
+}
+
+TEST_F(TestUARTSerial, read_wakes_on_first_byte)
+{
+    sim->inject_rx("hello", 5);
+
+    // Returns as soon as the first character arrived, not on the next poll
+    EXPECT_EQ(1, serial->read(buffer, sizeof(buffer)));
+    EXPECT_EQ('h', buffer[0]);
+    EXPECT_EQ(sim->byte_time(), sim->now);
+    EXPECT_EQ(1, sim->sleeps);
+
+    sim->run_for(4 * sim->byte_time());
+    EXPECT_EQ(4, serial->read(buffer, sizeof(buffer)));
+    EXPECT_EQ(0, memcmp(buffer, "ello", 4));
+}
+
+TEST_F(TestUARTSerial, read_blocking_bulk)
+{
+    sim->inject_rx(pattern, TEST_DATA_SIZE);
+
+    int received = 0;
+    while (received < TEST_DATA_SIZE) {
+        ssize_t length = serial->read(buffer + received, TEST_DATA_SIZE - received);
+        ASSERT_LT(0, length);
+        received += length;
+    }
+
+    EXPECT_EQ(0, memcmp(buffer, pattern, TEST_DATA_SIZE));
+    EXPECT_EQ(0, sim->rx_overruns);
+    EXPECT_EQ(TEST_DATA_SIZE * sim->byte_time(), sim->now);
+    RecordProperty("rx_wakeups_per_kb", sim->sleeps * 1024 / TEST_DATA_SIZE);
+}
+
+TEST_F(TestUARTSerial, rx_buffer_full_stops_irq)
+{
+    sim->inject_rx(pattern, MBED_CONF_DRIVERS_UART_SERIAL_RXBUF_SIZE + TEST_FIFO_DEPTH);
+    sim->run_for((MBED_CONF_DRIVERS_UART_SERIAL_RXBUF_SIZE + TEST_FIFO_DEPTH) * sim->byte_time());
+
+    // The buffer and the FIFO hold everything without an overrun
+    EXPECT_EQ(0, sim->rx_overruns);
+    EXPECT_EQ(MBED_CONF_DRIVERS_UART_SERIAL_RXBUF_SIZE, serial->read(buffer, sizeof(buffer)));
+    EXPECT_EQ(TEST_FIFO_DEPTH, serial->read(buffer + MBED_CONF_DRIVERS_UART_SERIAL_RXBUF_SIZE, sizeof(buffer)));
+    EXPECT_EQ(0, memcmp(buffer, pattern, MBED_CONF_DRIVERS_UART_SERIAL_RXBUF_SIZE + TEST_FIFO_DEPTH));
+}
+
+TEST_F(TestUARTSerial, non_blocking)
+{
+    serial->set_blocking(false);
+    serial->sigio(callback(this, &TestUARTSerial::sigio));
+    EXPECT_EQ(1, sigio_calls);
+
+    EXPECT_EQ(-EAGAIN, serial->read(buffer, sizeof(buffer)));
+    EXPECT_EQ(0, serial->poll(POLLIN) & POLLIN);
+
+    // Partial write into the free buffer space
+    EXPECT_EQ(MBED_CONF_DRIVERS_UART_SERIAL_TXBUF_SIZE + TEST_FIFO_DEPTH, serial->write(pattern, TEST_DATA_SIZE));
+    EXPECT_EQ(-EAGAIN, serial->write(pattern, TEST_DATA_SIZE));
+    EXPECT_EQ(0, serial->poll(POLLOUT) & POLLOUT);
+    int calls = sigio_calls;
+
+    sim->run_for(TEST_FIFO_DEPTH * sim->byte_time());
+    EXPECT_EQ(POLLOUT, serial->poll(POLLOUT) & POLLOUT);
+    EXPECT_EQ(calls + 1, sigio_calls);
+
+    sim->inject_rx("ok", 2);
+    sim->run_for(2 * sim->byte_time());
+    EXPECT_EQ(POLLIN, serial->poll(POLLIN) & POLLIN);
+    EXPECT_EQ(calls + 2, sigio_calls);
+    EXPECT_EQ(2, serial->read(buffer, sizeof(buffer)));
+    EXPECT_EQ(0, sim->sleeps);
+}
@@ -0,0 +1,22 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-sources
+  ../drivers/UARTSerial.cpp
+)
+
+set(unittest-test-sources
+  drivers/UARTSerial/test_UARTSerial.cpp
+  drivers/UARTSerial/SerialSim.cpp
+  stubs/mbed_assert_stub.c
+  stubs/mbed_critical_stub.c
+  stubs/FileHandle_stub.cpp
+  stubs/mbed_poll_stub.cpp
+  stubs/InterruptIn_stub.cpp
+  stubs/SerialBase_stub.cpp
+)
+
+set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DDEVICE_SERIAL=1 -DDEVICE_INTERRUPTIN=1 -DMBED_CONF_PLATFORM_DEFAULT_SERIAL_BAUD_RATE=9600")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -DDEVICE_SERIAL=1 -DDEVICE_INTERRUPTIN=1 -DMBED_CONF_PLATFORM_DEFAULT_SERIAL_BAUD_RATE=9600")
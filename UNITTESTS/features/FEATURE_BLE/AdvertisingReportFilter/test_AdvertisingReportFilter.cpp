@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "ble/generic/ResolvedAddressCache.h"
+#include "ble/generic/AdvertisingDuplicateFilter.h"
+
+#include <stdio.h>
+
+using namespace ble;
+using ble::generic::AdvertisingDuplicateFilter;
+using ble::generic::ResolvedAddressCache;
+
+#define CACHE_SIZE      16
+#define CACHE_TIMEOUT   900000
+#define FILTER_SIZE     32
+
+class TestAdvertisingReportFilter : public testing::Test {
+protected:
+    TestAdvertisingReportFilter() :
+        cache(CACHE_SIZE, CACHE_TIMEOUT),
+        filter(FILTER_SIZE)
+    {
+    }
+
+    /* private resolvable address of an advertiser, the hash part looks random */
+    address_t private_address(uint32_t n)
+    {
+        uint32_t hash = (n + 1) * 2654435761UL;
+        uint8_t bytes[6] = {
+            (uint8_t) hash, (uint8_t) (hash >> 8), (uint8_t) (hash >> 16),
+            (uint8_t) n, (uint8_t) (n >> 8), 0x40
+        };
+        return address_t(bytes);
+    }
+
+    ResolvedAddressCache::identity_t identity(uint8_t n)
+    {
+        ResolvedAddressCache::identity_t identity;
+        uint8_t bytes[6] = { n, n, n, n, n, 0xC0 };
+        identity.address = address_t(bytes);
+        identity.is_public = false;
+        identity.resolved = true;
+        return identity;
+    }
+
+    bool is_duplicate(const address_t &address, const uint8_t *data, size_t size, uint32_t now)
+    {
+        return filter.is_duplicate(
+            address, 0x01, 0x00, ArrayView<const uint8_t>(data, size), now
+        );
+    }
+
+    void record(const char *name, uint32_t value)
+    {
+        char text[16];
+        snprintf(text, sizeof(text), "%u", (unsigned)value);
+        RecordProperty(name, text);
+    }
+
+    ResolvedAddressCache cache;
+    AdvertisingDuplicateFilter filter;
+};
+
+TEST_F(TestAdvertisingReportFilter, cache_hit)
+{
+    ResolvedAddressCache::identity_t result;
+    EXPECT_FALSE(cache.find(private_address(1), 0, result));
+
+    cache.add(private_address(1), identity(1), 0);
+    ASSERT_TRUE(cache.find(private_address(1), 1000, result));
+    EXPECT_TRUE(result.resolved);
+    EXPECT_EQ(identity(1).address, result.address);
+    EXPECT_FALSE(cache.find(private_address(2), 1000, result));
+}
+
+TEST_F(TestAdvertisingReportFilter, cache_expiry)
+{
+    ResolvedAddressCache::identity_t result;
+    cache.add(private_address(1), identity(1), 0xFFFFF000);
+
+    // the clock wraps before the result expires
+    EXPECT_TRUE(cache.find(private_address(1), 0xFFFFF000 + CACHE_TIMEOUT - 1, result));
+    EXPECT_FALSE(cache.find(private_address(1), 0xFFFFF000 + CACHE_TIMEOUT, result));
+}
+
+TEST_F(TestAdvertisingReportFilter, cache_negative_results)
+{
+    ResolvedAddressCache::identity_t unresolved;
+    cache.add(private_address(1), unresolved, 0);
+    cache.add(private_address(2), identity(2), 0);
+
+    ResolvedAddressCache::identity_t result;
+    ASSERT_TRUE(cache.find(private_address(1), 0, result));
+    EXPECT_FALSE(result.resolved);
+
+    // a new identity may resolve addresses which did not resolve before
+    cache.remove_unresolved();
+    EXPECT_FALSE(cache.find(private_address(1), 0, result));
+    EXPECT_TRUE(cache.find(private_address(2), 0, result));
+
+    cache.clear();
+    EXPECT_FALSE(cache.find(private_address(2), 0, result));
+}
+
+TEST_F(TestAdvertisingReportFilter, cache_oldest_replaced)
+{
+    // addresses sharing the slot of the first one
+    address_t addresses[5];
+    for (size_t i = 0; i < 5; ++i) {
+        uint8_t bytes[6] = { 0x11, 0x22, (uint8_t) i, 0x33, (uint8_t) i, 0x40 };
+        addresses[i] = address_t(bytes);
+        cache.add(addresses[i], identity(i), i);
+    }
+
+    ResolvedAddressCache::identity_t result;
+    EXPECT_FALSE(cache.find(addresses[0], 10, result));
+    for (size_t i = 1; i < 5; ++i) {
+        ASSERT_TRUE(cache.find(addresses[i], 10, result));
+        EXPECT_EQ(identity(i).address, result.address);
+    }
+}
+
+TEST_F(TestAdvertisingReportFilter, duplicate_within_window)
+{
+    const uint8_t data[] = { 0x02, 0x01, 0x06 };
+    const uint8_t other_data[] = { 0x02, 0x01, 0x04 };
+    filter.set_window(1000);
+
+    EXPECT_FALSE(is_duplicate(private_address(1), data, sizeof(data), 0));
+    EXPECT_TRUE(is_duplicate(private_address(1), data, sizeof(data), 999));
+    EXPECT_FALSE(is_duplicate(private_address(1), other_data, sizeof(other_data), 999));
+    EXPECT_FALSE(is_duplicate(private_address(2), data, sizeof(data), 999));
+
+    // the window starts from the report let through
+    EXPECT_FALSE(is_duplicate(private_address(1), data, sizeof(data), 1000));
+    EXPECT_TRUE(is_duplicate(private_address(1), data, sizeof(data), 1500));
+
+    filter.clear();
+    EXPECT_FALSE(is_duplicate(private_address(1), data, sizeof(data), 1500));
+}
+
+TEST_F(TestAdvertisingReportFilter, duplicate_filter_disabled)
+{
+    const uint8_t data[] = { 0x02, 0x01, 0x06 };
+    EXPECT_EQ(0U, filter.get_window());
+
+    EXPECT_FALSE(is_duplicate(private_address(1), data, sizeof(data), 0));
+    EXPECT_FALSE(is_duplicate(private_address(1), data, sizeof(data), 0));
+}
+
+TEST_F(TestAdvertisingReportFilter, report_stream)
+{
+    // 12 advertisers rotating their address every 15 minutes, advertising
+    // every 100ms during an hour, observed by a scanner with the default
+    // configuration
+    const uint32_t advertisers = 12;
+    const uint32_t interval = 100;
+    const uint32_t rotation = 900000;
+    const uint32_t duration = 3600000;
+    const uint8_t data[] = { 0x02, 0x01, 0x06, 0x03, 0x03, 0xAA, 0xFE };
+
+    filter.set_window(1000);
+
+    uint32_t reports = 0;
+    uint32_t resolutions = 0;
+    uint32_t delivered = 0;
+    for (uint32_t now = 0; now < duration; now += interval) {
+        for (uint32_t i = 0; i < advertisers; ++i) {
+            address_t address = private_address(i + advertisers * (now / rotation));
+            ++reports;
+
+            ResolvedAddressCache::identity_t result;
+            if (!cache.find(address, now, result)) {
+                ++resolutions;
+                cache.add(address, identity(i), now);
+            }
+
+            if (!is_duplicate(address, data, sizeof(data), now)) {
+                ++delivered;
+            }
+        }
+    }
+
+    // every advertiser is delivered at most once per window
+    EXPECT_LE(delivered, advertisers * (duration / 1000 + 4));
+    EXPECT_LT(resolutions, reports / 100);
+    record("reports", reports);
+    record("resolutions", resolutions);
+    record("resolutions_avoided", reports - resolutions);
+    record("reports_delivered", delivered);
+}
@@ -0,0 +1,20 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  ../features/FEATURE_BLE
+  ../features/FEATURE_BLE/ble
+  ../features/FEATURE_BLE/ble/generic
+)
+
+set(unittest-sources
+  ../features/FEATURE_BLE/source/generic/ResolvedAddressCache.cpp
+  ../features/FEATURE_BLE/source/generic/AdvertisingDuplicateFilter.cpp
+)
+
+set(unittest-test-sources
+  features/FEATURE_BLE/AdvertisingReportFilter/test_AdvertisingReportFilter.cpp
+  stubs/mbed_assert_stub.c
+)
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "ble/generic/FileSecurityDb.h"
+#include "ble/generic/MemorySecurityDb.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace ble;
+using ble::generic::FileSecurityDb;
+using ble::generic::MemorySecurityDb;
+using ble::generic::SecurityDb;
+
+class TestFileSecurityDb : public testing::Test {
+protected:
+    char path[32];
+    FileSecurityDb *db;
+    address_t peer;
+    std::vector<uint8_t> cache;
+
+    virtual void SetUp()
+    {
+        strcpy(path, "/tmp/securitydbXXXXXX");
+        int fd = mkstemp(path);
+        ASSERT_NE(-1, fd);
+        close(fd);
+
+        const uint8_t address[6] = { 1, 2, 3, 4, 5, 6 };
+        peer = address_t(address);
+        for (size_t i = 0; i < 300; i++) {
+            cache.push_back(i * 7);
+        }
+
+        db = NULL;
+        open();
+    }
+
+    virtual void TearDown()
+    {
+        delete db;
+        remove(path);
+    }
+
+    void open()
+    {
+        delete db;
+        FILE *file = FileSecurityDb::open_db_file(path);
+        ASSERT_TRUE(file != NULL);
+        db = new FileSecurityDb(file);
+        db->restore();
+    }
+
+    SecurityDb::entry_handle_t bond()
+    {
+        SecurityDb::entry_handle_t entry = db->open_entry(peer_address_type_t::PUBLIC, peer);
+        EXPECT_TRUE(entry != NULL);
+        db->set_entry_peer_ltk(entry, ltk_t());
+        return entry;
+    }
+
+    bool has_cache(SecurityDb::entry_handle_t entry, const std::vector<uint8_t> &expected)
+    {
+        ArrayView<const uint8_t> stored = db->get_entry_gatt_cache(entry);
+        return stored.size() == expected.size() &&
+               (expected.empty() || memcmp(stored.data(), &expected[0], expected.size()) == 0);
+    }
+};
+
+TEST_F(TestFileSecurityDb, gatt_cache_persists)
+{
+    SecurityDb::entry_handle_t entry = bond();
+    EXPECT_EQ(0, db->get_entry_gatt_cache(entry).size());
+
+    db->set_entry_gatt_cache(entry, ArrayView<const uint8_t>(&cache[0], cache.size()));
+    EXPECT_TRUE(has_cache(entry, cache));
+    db->close_entry(entry);
+    db->set_restore(true);
+
+    open();
+    entry = db->find_entry_by_peer_address(peer_address_type_t::PUBLIC, peer);
+    ASSERT_TRUE(entry != NULL);
+    EXPECT_TRUE(has_cache(entry, cache));
+
+    // erased with an empty cache
+    db->set_entry_gatt_cache(entry, ArrayView<const uint8_t>());
+    EXPECT_EQ(0, db->get_entry_gatt_cache(entry).size());
+}
+
+TEST_F(TestFileSecurityDb, gatt_cache_too_large)
+{
+    SecurityDb::entry_handle_t entry = bond();
+    db->set_entry_gatt_cache(entry, ArrayView<const uint8_t>(&cache[0], cache.size()));
+
+    // the previous cache does not survive an update which does not fit
+    std::vector<uint8_t> large(SecurityDb::MAX_GATT_CACHE_SIZE + 1, 0xAA);
+    db->set_entry_gatt_cache(entry, ArrayView<const uint8_t>(&large[0], large.size()));
+    EXPECT_EQ(0, db->get_entry_gatt_cache(entry).size());
+}
+
+TEST_F(TestFileSecurityDb, gatt_cache_removed_with_bond)
+{
+    SecurityDb::entry_handle_t entry = bond();
+    db->set_entry_gatt_cache(entry, ArrayView<const uint8_t>(&cache[0], cache.size()));
+    db->close_entry(entry);
+    db->remove_entry(peer_address_type_t::PUBLIC, peer);
+
+    entry = bond();
+    EXPECT_EQ(0, db->get_entry_gatt_cache(entry).size());
+}
+
+TEST_F(TestFileSecurityDb, version_1_file_keeps_bonds)
+{
+    db->close_entry(bond());
+    db->set_restore(true);
+    delete db;
+    db = NULL;
+
+    // version 1 files end where the attribute caches of the 5 entries start
+    FILE *file = fopen(path, "rb+");
+    ASSERT_TRUE(file != NULL);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file) - 5 * 516;
+    const uint16_t version = 1;
+    fseek(file, 0, SEEK_SET);
+    fwrite(&version, sizeof(version), 1, file);
+    fclose(file);
+    ASSERT_EQ(0, truncate(path, size));
+
+    open();
+    SecurityDb::entry_handle_t entry = db->find_entry_by_peer_address(peer_address_type_t::PUBLIC, peer);
+    ASSERT_TRUE(entry != NULL);
+    EXPECT_EQ(0, db->get_entry_gatt_cache(entry).size());
+
+    db->set_entry_gatt_cache(entry, ArrayView<const uint8_t>(&cache[0], cache.size()));
+    db->close_entry(entry);
+    db->set_restore(true);
+
+    open();
+    entry = db->find_entry_by_peer_address(peer_address_type_t::PUBLIC, peer);
+    ASSERT_TRUE(entry != NULL);
+    EXPECT_TRUE(has_cache(entry, cache));
+}
+
+TEST_F(TestFileSecurityDb, memory_gatt_cache)
+{
+    MemorySecurityDb memory_db;
+    SecurityDb::entry_handle_t entry = memory_db.open_entry(peer_address_type_t::PUBLIC, peer);
+    ASSERT_TRUE(entry != NULL);
+
+    memory_db.set_entry_gatt_cache(entry, ArrayView<const uint8_t>(&cache[0], cache.size()));
+    ArrayView<const uint8_t> stored = memory_db.get_entry_gatt_cache(entry);
+    ASSERT_EQ(cache.size(), stored.size());
+    EXPECT_EQ(0, memcmp(stored.data(), &cache[0], cache.size()));
+
+    memory_db.close_entry(entry);
+    memory_db.remove_entry(peer_address_type_t::PUBLIC, peer);
+    EXPECT_EQ(0, memory_db.get_entry_gatt_cache(entry).size());
+}
@@ -0,0 +1,525 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PalGattClientMock.h"
+#include "ble/pal/SimpleAttServerMessage.h"
+
+#include <string.h>
+
+using namespace ble;
+using namespace ble::pal;
+
+PalGattClientMock::PalGattClientMock() :
+    mtu(23), prepare_queue_limit(0xFFFFFFFF), _pending(false), _prepare_queue_size(0)
+{
+    reset_counters();
+}
+
+void PalGattClientMock::reset_counters()
+{
+    round_trips = 0;
+    commands = 0;
+    violations = 0;
+    memset(request_count, 0, sizeof(request_count));
+}
+
+void PalGattClientMock::set_value(attribute_handle_t handle, const uint8_t *value, uint16_t length)
+{
+    _values[handle].assign(value, value + length);
+}
+
+const std::vector<uint8_t> &PalGattClientMock::value(attribute_handle_t handle)
+{
+    return _values[handle];
+}
+
+void PalGattClientMock::add_service(attribute_handle_t begin, attribute_handle_t end, const UUID &uuid)
+{
+    attribute_t service = { begin, end, 0, uuid };
+    _services.push_back(service);
+}
+
+void PalGattClientMock::add_characteristic(attribute_handle_t declaration, uint8_t properties, const UUID &uuid)
+{
+    attribute_t characteristic = { declaration, declaration, properties, uuid };
+    _characteristics.push_back(characteristic);
+    _values[declaration + 1];
+}
+
+void PalGattClientMock::add_descriptor(attribute_handle_t handle, const UUID &uuid)
+{
+    attribute_t descriptor = { handle, handle, 0, uuid };
+    _descriptors.push_back(descriptor);
+    _values[handle];
+}
+
+void PalGattClientMock::clear_attributes()
+{
+    _services.clear();
+    _characteristics.clear();
+    _descriptors.clear();
+    _values.clear();
+}
+
+void PalGattClientMock::indicate(connection_handle_t connection, attribute_handle_t handle)
+{
+    const std::vector<uint8_t> &value = _values[handle];
+    on_server_event(
+        connection,
+        AttHandleValueIndication(handle, ArrayView<const uint8_t>(value.empty() ? NULL : &value[0], value.size()))
+    );
+}
+
+void PalGattClientMock::append_uuid(std::vector<uint8_t> &data, const UUID &uuid)
+{
+    if (uuid.shortOrLong() == UUID::UUID_TYPE_SHORT) {
+        data.push_back(uuid.getShortUUID());
+        data.push_back(uuid.getShortUUID() >> 8);
+    } else {
+        data.insert(data.end(), uuid.getBaseUUID(), uuid.getBaseUUID() + UUID::LENGTH_OF_LONG_UUID);
+    }
+}
+
+// Each response packs as many attributes of the same size as the MTU allows
+void PalGattClientMock::respond_services(const request_t &request)
+{
+    std::vector<uint8_t> data;
+    uint8_t element_size = 0;
+    for (size_t i = 0; i < _services.size(); i++) {
+        const attribute_t &service = _services[i];
+        uint8_t size = 4 + service.uuid.getLen();
+        if (service.handle < request.handle) {
+            continue;
+        }
+        if (element_size == 0) {
+            element_size = size;
+        }
+        if (size != element_size || data.size() + size > (size_t)(mtu - 2)) {
+            break;
+        }
+        data.push_back(service.handle);
+        data.push_back(service.handle >> 8);
+        data.push_back(service.end);
+        data.push_back(service.end >> 8);
+        append_uuid(data, service.uuid);
+    }
+
+    if (data.empty()) {
+        respond_error(request, request.handle, AttErrorResponse::ATTRIBUTE_NOT_FOUND);
+        return;
+    }
+
+    on_server_event(
+        request.connection,
+        SimpleAttReadByGroupTypeResponse(element_size, ArrayView<const uint8_t>(&data[0], data.size()))
+    );
+}
+
+void PalGattClientMock::respond_characteristics(const request_t &request)
+{
+    std::vector<uint8_t> data;
+    uint8_t element_size = 0;
+    for (size_t i = 0; i < _characteristics.size(); i++) {
+        const attribute_t &characteristic = _characteristics[i];
+        uint8_t size = 5 + characteristic.uuid.getLen();
+        if (characteristic.handle < request.handle || characteristic.handle > request.end) {
+            continue;
+        }
+        if (element_size == 0) {
+            element_size = size;
+        }
+        if (size != element_size || data.size() + size > (size_t)(mtu - 2)) {
+            break;
+        }
+        attribute_handle_t value_handle = characteristic.handle + 1;
+        data.push_back(characteristic.handle);
+        data.push_back(characteristic.handle >> 8);
+        data.push_back(characteristic.properties);
+        data.push_back(value_handle);
+        data.push_back(value_handle >> 8);
+        append_uuid(data, characteristic.uuid);
+    }
+
+    if (data.empty()) {
+        respond_error(request, request.handle, AttErrorResponse::ATTRIBUTE_NOT_FOUND);
+        return;
+    }
+
+    on_server_event(
+        request.connection,
+        SimpleAttReadByTypeResponse(element_size, ArrayView<const uint8_t>(&data[0], data.size()))
+    );
+}
+
+void PalGattClientMock::respond_descriptors(const request_t &request)
+{
+    std::vector<uint8_t> data;
+    uint8_t element_size = 0;
+    for (size_t i = 0; i < _descriptors.size(); i++) {
+        const attribute_t &descriptor = _descriptors[i];
+        uint8_t size = 2 + descriptor.uuid.getLen();
+        if (descriptor.handle < request.handle || descriptor.handle > request.end) {
+            continue;
+        }
+        if (element_size == 0) {
+            element_size = size;
+        }
+        if (size != element_size || data.size() + size > (size_t)(mtu - 2)) {
+            break;
+        }
+        data.push_back(descriptor.handle);
+        data.push_back(descriptor.handle >> 8);
+        append_uuid(data, descriptor.uuid);
+    }
+
+    if (data.empty()) {
+        respond_error(request, request.handle, AttErrorResponse::ATTRIBUTE_NOT_FOUND);
+        return;
+    }
+
+    on_server_event(
+        request.connection,
+        SimpleAttFindInformationResponse(
+            element_size == 4 ?
+                SimpleAttFindInformationResponse::FORMAT_16_BIT_UUID :
+                SimpleAttFindInformationResponse::FORMAT_128_BIT_UUID,
+            ArrayView<const uint8_t>(&data[0], data.size())
+        )
+    );
+}
+
+ble_error_t PalGattClientMock::send(const request_t &request)
+{
+    if (_pending) {
+        violations++;
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    request_count[request.opcode]++;
+    _request = request;
+    _pending = true;
+    return BLE_ERROR_NONE;
+}
+
+void PalGattClientMock::respond_error(const request_t &request, attribute_handle_t handle, uint8_t error)
+{
+    on_server_event(
+        request.connection,
+        AttErrorResponse(AttributeOpcode::Code(request.opcode), handle, error)
+    );
+}
+
+bool PalGattClientMock::respond()
+{
+    if (!_pending) {
+        return false;
+    }
+
+    // the bearer is free from here, the client may send the next request
+    // while handling the response
+    request_t request = _request;
+    _pending = false;
+    round_trips++;
+
+    switch (request.opcode) {
+        case AttributeOpcode::READ_REQUEST:
+        case AttributeOpcode::READ_BLOB_REQUEST: {
+            if (!_values.count(request.handle)) {
+                respond_error(request, request.handle, AttErrorResponse::INVALID_HANDLE);
+                break;
+            }
+
+            const std::vector<uint8_t> &value = _values[request.handle];
+            if (request.offset > value.size()) {
+                respond_error(request, request.handle, AttErrorResponse::INVALID_OFFSET);
+                break;
+            }
+
+            size_t length = std::min(value.size() - request.offset, (size_t)(mtu - 1));
+            ArrayView<const uint8_t> data(value.empty() ? NULL : &value[request.offset], length);
+            if (request.opcode == AttributeOpcode::READ_REQUEST) {
+                on_server_event(request.connection, AttReadResponse(data));
+            } else {
+                on_server_event(request.connection, AttReadBlobResponse(data));
+            }
+        }   break;
+
+        case AttributeOpcode::READ_MULTIPLE_REQUEST: {
+            std::vector<uint8_t> values;
+            for (size_t i = 0; i < request.handles.size(); i++) {
+                if (!_values.count(request.handles[i])) {
+                    respond_error(request, request.handles[i], AttErrorResponse::INVALID_HANDLE);
+                    return true;
+                }
+                const std::vector<uint8_t> &value = _values[request.handles[i]];
+                values.insert(values.end(), value.begin(), value.end());
+            }
+            values.resize(std::min(values.size(), (size_t)(mtu - 1)));
+            on_server_event(
+                request.connection,
+                AttReadMultipleResponse(ArrayView<const uint8_t>(values.empty() ? NULL : &values[0], values.size()))
+            );
+        }   break;
+
+        case AttributeOpcode::WRITE_REQUEST:
+            if (!_values.count(request.handle)) {
+                respond_error(request, request.handle, AttErrorResponse::INVALID_HANDLE);
+                break;
+            }
+            _values[request.handle] = request.data;
+            on_server_event(request.connection, AttWriteResponse());
+            break;
+
+        case AttributeOpcode::PREPARE_WRITE_REQUEST: {
+            if (!_values.count(request.handle)) {
+                respond_error(request, request.handle, AttErrorResponse::INVALID_HANDLE);
+                break;
+            }
+            if (_prepare_queue_size + request.data.size() > prepare_queue_limit) {
+                respond_error(request, request.handle, AttErrorResponse::PREPARE_QUEUE_FULL);
+                break;
+            }
+
+            prepared_write_t write = { request.handle, request.offset, request.data };
+            _prepare_queue.push_back(write);
+            _prepare_queue_size += request.data.size();
+            on_server_event(
+                request.connection,
+                AttPrepareWriteResponse(
+                    request.handle,
+                    request.offset,
+                    ArrayView<const uint8_t>(request.data.empty() ? NULL : &request.data[0], request.data.size())
+                )
+            );
+        }   break;
+
+        case AttributeOpcode::EXECUTE_WRITE_REQUEST:
+            if (request.execute) {
+                for (size_t i = 0; i < _prepare_queue.size(); i++) {
+                    const prepared_write_t &write = _prepare_queue[i];
+                    std::vector<uint8_t> &value = _values[write.handle];
+                    if (write.offset == 0) {
+                        value.clear();
+                    }
+                    value.resize(write.offset);
+                    value.insert(value.end(), write.data.begin(), write.data.end());
+                }
+            }
+            _prepare_queue.clear();
+            _prepare_queue_size = 0;
+            on_server_event(request.connection, AttExecuteWriteResponse());
+            break;
+
+        case AttributeOpcode::READ_BY_GROUP_TYPE_REQUEST:
+            respond_services(request);
+            break;
+
+        case AttributeOpcode::READ_BY_TYPE_REQUEST:
+            respond_characteristics(request);
+            break;
+
+        case AttributeOpcode::FIND_INFORMATION_REQUEST:
+            respond_descriptors(request);
+            break;
+
+        default:
+            respond_error(request, request.handle, AttErrorResponse::ATTRIBUTE_NOT_FOUND);
+            break;
+    }
+
+    return true;
+}
+
+void PalGattClientMock::run()
+{
+    while (respond()) {
+    }
+}
+
+void PalGattClientMock::timeout()
+{
+    if (_pending) {
+        _pending = false;
+        on_transaction_timeout(_request.connection);
+    }
+}
+
+ble_error_t PalGattClientMock::initialize()
+{
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t PalGattClientMock::terminate()
+{
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t PalGattClientMock::exchange_mtu(connection_handle_t connection)
+{
+    return BLE_ERROR_NOT_IMPLEMENTED;
+}
+
+ble_error_t PalGattClientMock::get_mtu_size(connection_handle_t connection_handle, uint16_t &mtu_size)
+{
+    mtu_size = mtu;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t PalGattClientMock::discover_primary_service(
+    connection_handle_t connection,
+    attribute_handle_t discovery_range_begining
+)
+{
+    request_t request = { AttributeOpcode::READ_BY_GROUP_TYPE_REQUEST, connection, discovery_range_begining };
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::discover_primary_service_by_service_uuid(
+    connection_handle_t connection_handle,
+    attribute_handle_t discovery_range_beginning,
+    const UUID &uuid
+)
+{
+    request_t request = { AttributeOpcode::FIND_BY_TYPE_VALUE_REQUEST, connection_handle, discovery_range_beginning };
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::find_included_service(
+    connection_handle_t connection_handle,
+    ble::attribute_handle_range_t service_range
+)
+{
+    request_t request = { AttributeOpcode::READ_BY_TYPE_REQUEST, connection_handle, service_range.begin };
+    request.end = service_range.end;
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::discover_characteristics_of_a_service(
+    connection_handle_t connection_handle,
+    ble::attribute_handle_range_t discovery_range
+)
+{
+    request_t request = { AttributeOpcode::READ_BY_TYPE_REQUEST, connection_handle, discovery_range.begin };
+    request.end = discovery_range.end;
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::discover_characteristics_descriptors(
+    connection_handle_t connection_handle,
+    ble::attribute_handle_range_t descriptors_discovery_range
+)
+{
+    request_t request = { AttributeOpcode::FIND_INFORMATION_REQUEST, connection_handle, descriptors_discovery_range.begin };
+    request.end = descriptors_discovery_range.end;
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::read_attribute_value(
+    connection_handle_t connection_handle,
+    attribute_handle_t attribute_handle
+)
+{
+    request_t request = { AttributeOpcode::READ_REQUEST, connection_handle, attribute_handle };
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::read_using_characteristic_uuid(
+    connection_handle_t connection_handle,
+    ble::attribute_handle_range_t read_range,
+    const UUID &uuid
+)
+{
+    request_t request = { AttributeOpcode::READ_BY_TYPE_REQUEST, connection_handle, read_range.begin };
+    request.end = read_range.end;
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::read_attribute_blob(
+    connection_handle_t connection_handle,
+    attribute_handle_t attribute_handle,
+    uint16_t offset
+)
+{
+    request_t request = { AttributeOpcode::READ_BLOB_REQUEST, connection_handle, attribute_handle, offset };
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::read_multiple_characteristic_values(
+    connection_handle_t connection_handle,
+    const ble::ArrayView<const attribute_handle_t> &characteristic_value_handles
+)
+{
+    request_t request = { AttributeOpcode::READ_MULTIPLE_REQUEST, connection_handle };
+    request.handles.assign(
+        characteristic_value_handles.data(),
+        characteristic_value_handles.data() + characteristic_value_handles.size()
+    );
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::write_without_response(
+    connection_handle_t connection_handle,
+    attribute_handle_t characteristic_value_handle,
+    const ble::ArrayView<const uint8_t> &value
+)
+{
+    commands++;
+    _values[characteristic_value_handle].assign(value.data(), value.data() + value.size());
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t PalGattClientMock::signed_write_without_response(
+    connection_handle_t connection_handle,
+    attribute_handle_t characteristic_value_handle,
+    const ble::ArrayView<const uint8_t> &value
+)
+{
+    return write_without_response(connection_handle, characteristic_value_handle, value);
+}
+
+ble_error_t PalGattClientMock::write_attribute(
+    connection_handle_t connection_handle,
+    attribute_handle_t attribute_handle,
+    const ble::ArrayView<const uint8_t> &value
+)
+{
+    request_t request = { AttributeOpcode::WRITE_REQUEST, connection_handle, attribute_handle };
+    request.data.assign(value.data(), value.data() + value.size());
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::queue_prepare_write(
+    connection_handle_t connection_handle,
+    attribute_handle_t characteristic_value_handle,
+    const ble::ArrayView<const uint8_t> &value,
+    uint16_t offset
+)
+{
+    request_t request = { AttributeOpcode::PREPARE_WRITE_REQUEST, connection_handle, characteristic_value_handle, offset };
+    request.data.assign(value.data(), value.data() + value.size());
+    return send(request);
+}
+
+ble_error_t PalGattClientMock::execute_write_queue(
+    connection_handle_t connection_handle,
+    bool execute
+)
+{
+    request_t request = { AttributeOpcode::EXECUTE_WRITE_REQUEST, connection_handle };
+    request.execute = execute;
+    return send(request);
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PAL_GATT_CLIENT_MOCK_H
+#define PAL_GATT_CLIENT_MOCK_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "ble/pal/PalGattClient.h"
+
+/** pal::GattClient answering from an in memory attribute table
+ *
+ * Requests are held until the test calls respond(), one response is the
+ * end of one round trip. A request sent while another one is outstanding
+ * breaks the ATT sequential protocol and is counted as a violation. Commands
+ * are applied immediately and counted separately. Discovery requests are
+ * answered from the services, characteristics and descriptors added.
+ */
+class PalGattClientMock : public ble::pal::GattClient {
+public:
+    typedef ble::connection_handle_t connection_handle_t;
+    typedef ble::attribute_handle_t attribute_handle_t;
+
+    PalGattClientMock();
+
+    /** Set the value of an attribute in the server table */
+    void set_value(attribute_handle_t handle, const uint8_t *value, uint16_t length);
+
+    /** Value of an attribute in the server table */
+    const std::vector<uint8_t> &value(attribute_handle_t handle);
+
+    /** Add a primary service to the server table */
+    void add_service(attribute_handle_t begin, attribute_handle_t end, const UUID &uuid);
+
+    /** Add a characteristic declaration, its value follows the declaration */
+    void add_characteristic(attribute_handle_t declaration, uint8_t properties, const UUID &uuid);
+
+    /** Add a characteristic descriptor */
+    void add_descriptor(attribute_handle_t handle, const UUID &uuid);
+
+    /** Remove services, characteristics and descriptors from the table */
+    void clear_attributes();
+
+    /** Send an indication of an attribute value to the client */
+    void indicate(connection_handle_t connection, attribute_handle_t handle);
+
+    /** Answer the outstanding request; return false if there is none */
+    bool respond();
+
+    /** Answer requests until no request is outstanding */
+    void run();
+
+    /** Drop the outstanding request and report a transaction timeout */
+    void timeout();
+
+    void reset_counters();
+
+    uint16_t mtu;
+    uint32_t prepare_queue_limit;
+
+    uint32_t round_trips;
+    uint32_t commands;
+    uint32_t violations;
+    uint32_t request_count[256];
+
+    virtual ble_error_t initialize();
+    virtual ble_error_t terminate();
+    virtual ble_error_t exchange_mtu(connection_handle_t connection);
+    virtual ble_error_t get_mtu_size(connection_handle_t connection_handle, uint16_t &mtu_size);
+    virtual ble_error_t discover_primary_service(
+        connection_handle_t connection,
+        attribute_handle_t discovery_range_begining
+    );
+    virtual ble_error_t discover_primary_service_by_service_uuid(
+        connection_handle_t connection_handle,
+        attribute_handle_t discovery_range_beginning,
+        const UUID &uuid
+    );
+    virtual ble_error_t find_included_service(
+        connection_handle_t connection_handle,
+        ble::attribute_handle_range_t service_range
+    );
+    virtual ble_error_t discover_characteristics_of_a_service(
+        connection_handle_t connection_handle,
+        ble::attribute_handle_range_t discovery_range
+    );
+    virtual ble_error_t discover_characteristics_descriptors(
+        connection_handle_t connection_handle,
+        ble::attribute_handle_range_t descriptors_discovery_range
+    );
+    virtual ble_error_t read_attribute_value(
+        connection_handle_t connection_handle,
+        attribute_handle_t attribute_handle
+    );
+    virtual ble_error_t read_using_characteristic_uuid(
+        connection_handle_t connection_handle,
+        ble::attribute_handle_range_t read_range,
+        const UUID &uuid
+    );
+    virtual ble_error_t read_attribute_blob(
+        connection_handle_t connection_handle,
+        attribute_handle_t attribute_handle,
+        uint16_t offset
+    );
+    virtual ble_error_t read_multiple_characteristic_values(
+        connection_handle_t connection_handle,
+        const ble::ArrayView<const attribute_handle_t> &characteristic_value_handles
+    );
+    virtual ble_error_t write_without_response(
+        connection_handle_t connection_handle,
+        attribute_handle_t characteristic_value_handle,
+        const ble::ArrayView<const uint8_t> &value
+    );
+    virtual ble_error_t signed_write_without_response(
+        connection_handle_t connection_handle,
+        attribute_handle_t characteristic_value_handle,
+        const ble::ArrayView<const uint8_t> &value
+    );
+    virtual ble_error_t write_attribute(
+        connection_handle_t connection_handle,
+        attribute_handle_t attribute_handle,
+        const ble::ArrayView<const uint8_t> &value
+    );
+    virtual ble_error_t queue_prepare_write(
+        connection_handle_t connection_handle,
+        attribute_handle_t characteristic_value_handle,
+        const ble::ArrayView<const uint8_t> &value,
+        uint16_t offset
+    );
+    virtual ble_error_t execute_write_queue(
+        connection_handle_t connection_handle,
+        bool execute
+    );
+
+private:
+    struct request_t {
+        uint8_t opcode;
+        connection_handle_t connection;
+        attribute_handle_t handle;
+        uint16_t offset;
+        bool execute;
+        attribute_handle_t end;
+        std::vector<attribute_handle_t> handles;
+        std::vector<uint8_t> data;
+    };
+
+    struct attribute_t {
+        attribute_handle_t handle;
+        attribute_handle_t end;
+        uint8_t properties;
+        UUID uuid;
+    };
+
+    struct prepared_write_t {
+        attribute_handle_t handle;
+        uint16_t offset;
+        std::vector<uint8_t> data;
+    };
+
+    ble_error_t send(const request_t &request);
+    void respond_error(const request_t &request, attribute_handle_t handle, uint8_t error);
+    void respond_services(const request_t &request);
+    void respond_characteristics(const request_t &request);
+    void respond_descriptors(const request_t &request);
+    static void append_uuid(std::vector<uint8_t> &data, const UUID &uuid);
+
+    bool _pending;
+    request_t _request;
+    std::map<attribute_handle_t, std::vector<uint8_t> > _values;
+    std::vector<attribute_t> _services;
+    std::vector<attribute_t> _characteristics;
+    std::vector<attribute_t> _descriptors;
+    std::vector<prepared_write_t> _prepare_queue;
+    uint32_t _prepare_queue_size;
+};
+
+#endif // PAL_GATT_CLIENT_MOCK_H
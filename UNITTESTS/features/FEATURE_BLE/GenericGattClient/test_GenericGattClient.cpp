@@ -0,0 +1,733 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "ble/generic/GenericGattClient.h"
+#include "ble/BLEInstanceBase.h"
+#include "ble/DiscoveredCharacteristic.h"
+#include "ble/DiscoveredCharacteristicDescriptor.h"
+#include "PalGattClientMock.h"
+
+#include <stdio.h>
+#include <vector>
+
+#define TEST_CONNECTION     1
+#define TEST_FIRST_HANDLE   3
+#define TEST_HANDLE_STEP    3
+#define TEST_VALUES         40
+#define TEST_LONG_VALUE     40
+#define TEST_SENSORS        8
+#define TEST_ROUND_TRIP_MS  60  // request and response 2 connection events apart at 30 ms
+
+using ble::generic::GenericGattClient;
+using ble::pal::AttributeOpcode;
+
+// Signed writes are not exercised, the BLE instance is never used
+BLEInstanceBase *createBLEInstance(void)
+{
+    return NULL;
+}
+
+// Key function of BLEInstanceBase, its type info is needed by -fsanitize=vptr builds
+BLEInstanceBase::~BLEInstanceBase()
+{
+}
+
+static void on_service(const DiscoveredService *service)
+{
+}
+
+/** Attribute cache storage of a single peer, bonded unless told otherwise */
+class AttributeCacheStore : public ble::pal::AttributeCacheMonitor::EventHandler {
+public:
+    AttributeCacheStore() : bonded(true), updates(0) { }
+
+    virtual ble::ArrayView<const uint8_t> get_attribute_cache(ble::connection_handle_t connection)
+    {
+        if (!bonded || cache.empty()) {
+            return ble::ArrayView<const uint8_t>();
+        }
+        return ble::ArrayView<const uint8_t>(&cache[0], cache.size());
+    }
+
+    virtual void on_attribute_cache_updated(
+        ble::connection_handle_t connection,
+        const ble::ArrayView<const uint8_t> &value
+    )
+    {
+        if (bonded) {
+            cache.assign(value.data(), value.data() + value.size());
+            updates++;
+        }
+    }
+
+    bool bonded;
+    std::vector<uint8_t> cache;
+    uint32_t updates;
+};
+
+class TestGenericGattClient : public testing::Test {
+protected:
+    struct read_t {
+        GattAttribute::Handle_t handle;
+        ble_error_t status;
+        std::vector<uint8_t> data;
+    };
+
+    PalGattClientMock *pal;
+    GenericGattClient *client;
+    std::vector<read_t> reads;
+    std::vector<GattWriteCallbackParams> writes;
+    uint32_t terminations;
+
+    virtual void SetUp()
+    {
+        pal = new PalGattClientMock;
+        client = new GenericGattClient(pal);
+        client->onDataRead(GattClient::ReadCallback_t(this, &TestGenericGattClient::on_read));
+        client->onDataWritten(GattClient::WriteCallback_t(this, &TestGenericGattClient::on_write));
+        client->onServiceDiscoveryTermination(
+            ServiceDiscovery::TerminationCallback_t(this, &TestGenericGattClient::on_termination)
+        );
+        terminations = 0;
+        invalidations = 0;
+        terminate_after = 0;
+    }
+
+    virtual void TearDown()
+    {
+        delete client;
+        delete pal;
+    }
+
+    /** A new client, as after a reconnection, sharing the cache storage */
+    void reconnect()
+    {
+        delete client;
+        client = new GenericGattClient(pal);
+        client->onServiceDiscoveryTermination(
+            ServiceDiscovery::TerminationCallback_t(this, &TestGenericGattClient::on_termination)
+        );
+        client->set_attribute_cache_event_handler(&store);
+        client->when_attribute_cache_invalidated(
+            mbed::callback(this, &TestGenericGattClient::on_invalidated)
+        );
+        pal->reset_counters();
+        characteristics.clear();
+        descriptors.clear();
+    }
+
+    /** GAP and GATT services followed by sensor services with 128 bit UUIDs */
+    void fill_database()
+    {
+        pal->add_service(0x0001, 0x0005, UUID(0x1800));
+        pal->add_characteristic(0x0002, 0x02, UUID(0x2A00));
+        pal->add_characteristic(0x0004, 0x02, UUID(0x2A01));
+
+        pal->add_service(0x0006, 0x0009, UUID(0x1801));
+        pal->add_characteristic(0x0007, 0x20, UUID(BLE_UUID_GATT_CHARACTERISTIC_SERVICE_CHANGED));
+        pal->add_descriptor(0x0009, UUID(BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG));
+
+        for (int i = 0; i < TEST_SENSORS; i++) {
+            GattAttribute::Handle_t begin = 0x0010 + i * 0x10;
+            UUID::LongUUIDBytes_t service = {
+                0x6E, 0x40, 0x00, 0x01, 0xB5, 0xA3, 0xF3, 0x93,
+                0xE0, 0xA9, 0xE5, 0x0E, 0x24, 0xDC, 0xCA, (uint8_t) i
+            };
+            pal->add_service(begin, begin + 8, UUID(service));
+            pal->add_characteristic(begin + 1, 0x12, UUID(0x2A6E));
+            pal->add_descriptor(begin + 3, UUID(BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG));
+            pal->add_characteristic(begin + 4, 0x12, UUID(0x2A6F));
+            pal->add_descriptor(begin + 6, UUID(BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG));
+            pal->add_characteristic(begin + 7, 0x0A, UUID(0x2A19));
+        }
+    }
+
+    /** Discover every characteristic; return the round trips spent */
+    uint32_t discover_all()
+    {
+        characteristics.clear();
+        pal->reset_counters();
+        uint32_t terminations_before = terminations;
+        EXPECT_EQ(BLE_ERROR_NONE, client->launchServiceDiscovery(
+            TEST_CONNECTION,
+            on_service,
+            characteristic_callback(),
+            UUID(),
+            UUID()
+        ));
+        pal->run();
+        EXPECT_EQ(terminations_before + 1, terminations);
+        EXPECT_EQ(0, pal->violations);
+        return pal->round_trips;
+    }
+
+    void discover_descriptors(const DiscoveredCharacteristic &characteristic)
+    {
+        descriptors.clear();
+        EXPECT_EQ(BLE_ERROR_NONE, client->discoverCharacteristicDescriptors(
+            characteristic,
+            CharacteristicDescriptorDiscovery::DiscoveryCallback_t(this, &TestGenericGattClient::on_descriptor),
+            CharacteristicDescriptorDiscovery::TerminationCallback_t(this, &TestGenericGattClient::on_descriptor_termination)
+        ));
+        pal->run();
+    }
+
+    ServiceDiscovery::CharacteristicCallback_t characteristic_callback()
+    {
+        return ServiceDiscovery::CharacteristicCallback_t(this, &TestGenericGattClient::on_characteristic);
+    }
+
+    void on_characteristic(const DiscoveredCharacteristic *characteristic)
+    {
+        characteristics.push_back(*characteristic);
+        if (characteristics.size() == terminate_after) {
+            client->terminateServiceDiscovery();
+        }
+    }
+
+    void on_descriptor(const CharacteristicDescriptorDiscovery::DiscoveryCallbackParams_t *params)
+    {
+        descriptors.push_back(params->descriptor.getAttributeHandle());
+    }
+
+    void on_descriptor_termination(const CharacteristicDescriptorDiscovery::TerminationCallbackParams_t *params)
+    {
+        EXPECT_EQ(BLE_ERROR_NONE, params->status);
+    }
+
+    void on_invalidated(Gap::Handle_t connection)
+    {
+        EXPECT_EQ(TEST_CONNECTION, connection);
+        invalidations++;
+    }
+
+    void expect_same_characteristics(const std::vector<DiscoveredCharacteristic> &expected)
+    {
+        ASSERT_EQ(expected.size(), characteristics.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            EXPECT_TRUE(expected[i].getUUID() == characteristics[i].getUUID());
+            EXPECT_EQ(expected[i].getDeclHandle(), characteristics[i].getDeclHandle());
+            EXPECT_EQ(expected[i].getValueHandle(), characteristics[i].getValueHandle());
+            EXPECT_EQ(expected[i].getLastHandle(), characteristics[i].getLastHandle());
+            EXPECT_EQ(expected[i].getProperties().notify(), characteristics[i].getProperties().notify());
+            EXPECT_EQ(expected[i].getProperties().write(), characteristics[i].getProperties().write());
+            EXPECT_EQ(TEST_CONNECTION, characteristics[i].getConnectionHandle());
+        }
+    }
+
+    void on_read(const GattReadCallbackParams *params)
+    {
+        read_t read = { params->handle, params->status };
+        if (params->status == BLE_ERROR_NONE && params->len) {
+            read.data.assign(params->data, params->data + params->len);
+        }
+        reads.push_back(read);
+    }
+
+    void on_write(const GattWriteCallbackParams *params)
+    {
+        writes.push_back(*params);
+    }
+
+    void on_termination(Gap::Handle_t handle)
+    {
+        terminations++;
+    }
+
+    GattAttribute::Handle_t handle(int index)
+    {
+        return TEST_FIRST_HANDLE + index * TEST_HANDLE_STEP;
+    }
+
+    /**
+     * A service holding the values of the server as Appearance
+     * characteristics, whose two bytes size is fixed by the specification,
+     * followed by the GATT service.
+     */
+    void fill_fixed_database()
+    {
+        pal->add_service(0x0001, handle(TEST_VALUES - 1), UUID(0x1800));
+        for (int i = 0; i < TEST_VALUES; i++) {
+            pal->add_characteristic(handle(i) - 1, 0x02, UUID(BLE_UUID_GAP_CHARACTERISTIC_APPEARANCE));
+        }
+
+        pal->add_service(0x00FE, 0x0101, UUID(0x1801));
+        pal->add_characteristic(0x00FF, 0x20, UUID(BLE_UUID_GATT_CHARACTERISTIC_SERVICE_CHANGED));
+        pal->add_descriptor(0x0101, UUID(BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG));
+    }
+
+    /** Two bytes values, the shape of most standard characteristics */
+    void fill_server()
+    {
+        for (int i = 0; i < TEST_VALUES; i++) {
+            uint8_t value[2] = { (uint8_t) i, (uint8_t)(0xA0 + i) };
+            pal->set_value(handle(i), value, sizeof(value));
+        }
+    }
+
+    /** Read every value of the server; return the round trips spent */
+    uint32_t read_all()
+    {
+        reads.clear();
+        pal->reset_counters();
+        for (int i = 0; i < TEST_VALUES; i++) {
+            EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(i), 0));
+        }
+        pal->run();
+
+        EXPECT_EQ(TEST_VALUES, (int) reads.size());
+        for (size_t i = 0; i < reads.size(); i++) {
+            EXPECT_EQ(handle(i), reads[i].handle);
+            EXPECT_EQ(BLE_ERROR_NONE, reads[i].status);
+            EXPECT_TRUE(reads[i].data == pal->value(handle(i)));
+        }
+        EXPECT_EQ(0, pal->violations);
+        return pal->round_trips;
+    }
+
+    AttributeCacheStore store;
+    std::vector<DiscoveredCharacteristic> characteristics;
+    std::vector<GattAttribute::Handle_t> descriptors;
+    uint32_t invalidations;
+    size_t terminate_after;
+
+    void record(const char *name, uint32_t value)
+    {
+        char text[16];
+        snprintf(text, sizeof(text), "%u", (unsigned)value);
+        RecordProperty(name, text);
+    }
+};
+
+TEST_F(TestGenericGattClient, queued_reads)
+{
+    fill_server();
+
+    // the second and third reads wait for the bearer instead of failing
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(0), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(1), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(2), 0));
+    EXPECT_EQ(1, pal->request_count[AttributeOpcode::READ_REQUEST]);
+
+    pal->run();
+    EXPECT_EQ(3, pal->round_trips);
+    EXPECT_EQ(0, pal->violations);
+    ASSERT_EQ(3, (int) reads.size());
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(handle(i), reads[i].handle);
+        EXPECT_TRUE(reads[i].data == pal->value(handle(i)));
+    }
+}
+
+TEST_F(TestGenericGattClient, read_multiple)
+{
+    fill_fixed_database();
+    fill_server();
+
+    // values read with the same size are not known to be fixed
+    uint32_t cold = read_all();
+    EXPECT_EQ(TEST_VALUES, cold);
+    EXPECT_EQ(TEST_VALUES, read_all());
+    EXPECT_EQ(0, pal->request_count[AttributeOpcode::READ_MULTIPLE_REQUEST]);
+
+    // the first read goes out alone, the 39 queued behind it in Read
+    // Multiple Requests of 10 handles with the default MTU
+    discover_all();
+    uint32_t warm = read_all();
+    EXPECT_EQ(5, warm);
+    EXPECT_EQ(4, pal->request_count[AttributeOpcode::READ_MULTIPLE_REQUEST]);
+
+    record("round_trips_cold", cold);
+    record("round_trips_warm", warm);
+}
+
+TEST_F(TestGenericGattClient, read_multiple_size_change)
+{
+    fill_fixed_database();
+    discover_all();
+    fill_server();
+    EXPECT_EQ(5, read_all());
+
+    // a peer which does not follow the specification
+    uint8_t value[3] = { 1, 2, 3 };
+    pal->set_value(handle(5), value, sizeof(value));
+
+    // the response cannot be split: the batch is read again value per value
+    read_all();
+    EXPECT_LT(5, pal->round_trips);
+
+    // and the values of that batch are not merged anymore
+    EXPECT_LT(5, read_all());
+}
+
+TEST_F(TestGenericGattClient, read_multiple_variable_last)
+{
+    fill_fixed_database();
+    discover_all();
+    fill_server();
+
+    // the Service Changed CCCD has a fixed size; the Device Name has not
+    discover_descriptors(characteristics.back());
+    ASSERT_EQ(1, (int) descriptors.size());
+    EXPECT_EQ(0x0101, descriptors[0]);
+    const uint8_t cccd[2] = { 0x02, 0x00 };
+    pal->set_value(0x0101, cccd, sizeof(cccd));
+    pal->add_characteristic(0x00F0, 0x02, UUID(BLE_UUID_GAP_CHARACTERISTIC_DEVICE_NAME));
+    pal->set_value(0x00F1, (const uint8_t *) "mbed", 4);
+
+    reads.clear();
+    pal->reset_counters();
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(0), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(1), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, 0x0101, 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, 0x00F1, 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(2), 0));
+    pal->run();
+
+    // the value of any size closes the batch, the next read starts another
+    EXPECT_EQ(3, pal->round_trips);
+    EXPECT_EQ(1, pal->request_count[AttributeOpcode::READ_MULTIPLE_REQUEST]);
+    EXPECT_EQ(0, pal->violations);
+    ASSERT_EQ(5, (int) reads.size());
+    GattAttribute::Handle_t expected[5] = { handle(0), handle(1), 0x0101, 0x00F1, handle(2) };
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(expected[i], reads[i].handle);
+        EXPECT_EQ(BLE_ERROR_NONE, reads[i].status);
+        EXPECT_TRUE(reads[i].data == pal->value(expected[i]));
+    }
+}
+
+TEST_F(TestGenericGattClient, read_multiple_variable_last_truncated)
+{
+    fill_fixed_database();
+    discover_all();
+    fill_server();
+
+    // the name does not fit in the response after the two fixed values
+    const char name[] = "a device name longer than the MTU";
+    pal->add_characteristic(0x00F0, 0x02, UUID(BLE_UUID_GAP_CHARACTERISTIC_DEVICE_NAME));
+    pal->set_value(0x00F1, (const uint8_t *) name, sizeof(name) - 1);
+
+    reads.clear();
+    pal->reset_counters();
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(0), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(1), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(2), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, 0x00F1, 0));
+    pal->run();
+
+    // the name is read again on its own, with a blob for its end
+    EXPECT_EQ(4, pal->round_trips);
+    EXPECT_EQ(1, pal->request_count[AttributeOpcode::READ_MULTIPLE_REQUEST]);
+    EXPECT_EQ(0, pal->violations);
+    ASSERT_EQ(4, (int) reads.size());
+    GattAttribute::Handle_t expected[4] = { handle(0), handle(1), handle(2), 0x00F1 };
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(expected[i], reads[i].handle);
+        EXPECT_EQ(BLE_ERROR_NONE, reads[i].status);
+        EXPECT_TRUE(reads[i].data == pal->value(expected[i]));
+    }
+}
+
+TEST_F(TestGenericGattClient, read_multiple_after_disconnection)
+{
+    fill_fixed_database();
+    discover_all();
+    fill_server();
+    EXPECT_EQ(5, read_all());
+
+    // the connection handle may be given to another peer
+    Gap::DisconnectionCallbackParams_t params(TEST_CONNECTION, Gap::REMOTE_USER_TERMINATED_CONNECTION);
+    client->on_disconnection(&params);
+    EXPECT_EQ(TEST_VALUES, read_all());
+    EXPECT_EQ(TEST_VALUES, read_all());
+
+    discover_all();
+    EXPECT_EQ(5, read_all());
+}
+
+TEST_F(TestGenericGattClient, read_multiple_after_service_changed)
+{
+    // no attribute cache: Service Changed is known from the discovery
+    fill_fixed_database();
+    discover_all();
+    fill_server();
+    EXPECT_EQ(5, read_all());
+
+    pal->indicate(TEST_CONNECTION, handle(1));
+    EXPECT_EQ(5, read_all());
+
+    pal->indicate(TEST_CONNECTION, 0x0100);
+    EXPECT_EQ(TEST_VALUES, read_all());
+}
+
+TEST_F(TestGenericGattClient, long_writes_share_execute)
+{
+    uint8_t value[TEST_LONG_VALUE];
+    for (int i = 0; i < 4; i++) {
+        pal->set_value(handle(i), value, 1);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        memset(value, i, sizeof(value));
+        EXPECT_EQ(BLE_ERROR_NONE, client->write(
+            GattClient::GATT_OP_WRITE_REQ, TEST_CONNECTION, handle(i), sizeof(value), value
+        ));
+    }
+    pal->run();
+
+    // 3 prepare writes per value; the first write goes out alone and the
+    // three queued behind it share a single execute
+    EXPECT_EQ(2, pal->request_count[AttributeOpcode::EXECUTE_WRITE_REQUEST]);
+    EXPECT_EQ(14, pal->round_trips);
+    EXPECT_EQ(0, pal->violations);
+
+    ASSERT_EQ(4, (int) writes.size());
+    for (int i = 0; i < 4; i++) {
+        memset(value, i, sizeof(value));
+        EXPECT_EQ(handle(i), writes[i].handle);
+        EXPECT_EQ(BLE_ERROR_NONE, writes[i].status);
+        EXPECT_EQ(sizeof(value), pal->value(handle(i)).size());
+        EXPECT_EQ(0, memcmp(value, &pal->value(handle(i))[0], sizeof(value)));
+    }
+    record("long_write_round_trips", pal->round_trips);
+}
+
+TEST_F(TestGenericGattClient, prepare_queue_full)
+{
+    uint8_t value[TEST_LONG_VALUE];
+    for (int i = 0; i < 3; i++) {
+        pal->set_value(handle(i), value, 1);
+    }
+    pal->prepare_queue_limit = TEST_LONG_VALUE + 10;
+
+    for (int i = 0; i < 3; i++) {
+        memset(value, i, sizeof(value));
+        EXPECT_EQ(BLE_ERROR_NONE, client->write(
+            GattClient::GATT_OP_WRITE_REQ, TEST_CONNECTION, handle(i), sizeof(value), value
+        ));
+    }
+    pal->run();
+
+    // the shared queue is cancelled and every value written on its own
+    EXPECT_EQ(0, pal->violations);
+    ASSERT_EQ(3, (int) writes.size());
+    for (int i = 0; i < 3; i++) {
+        memset(value, i, sizeof(value));
+        EXPECT_EQ(handle(i), writes[i].handle);
+        EXPECT_EQ(BLE_ERROR_NONE, writes[i].status);
+        EXPECT_EQ(0, memcmp(value, &pal->value(handle(i))[0], sizeof(value)));
+    }
+}
+
+TEST_F(TestGenericGattClient, write_commands_bypass_queue)
+{
+    fill_server();
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(0), 0));
+
+    uint8_t value[2] = { 0x55, 0xAA };
+    for (int i = 1; i < 4; i++) {
+        EXPECT_EQ(BLE_ERROR_NONE, client->write(
+            GattClient::GATT_OP_WRITE_CMD, TEST_CONNECTION, handle(i), sizeof(value), value
+        ));
+    }
+    EXPECT_EQ(3, pal->commands);
+    EXPECT_EQ(0, pal->round_trips);
+    EXPECT_EQ(0, memcmp(value, &pal->value(handle(3))[0], sizeof(value)));
+
+    pal->run();
+    EXPECT_EQ(1, pal->round_trips);
+    EXPECT_EQ(1, (int) reads.size());
+}
+
+TEST_F(TestGenericGattClient, timeout_fails_queue)
+{
+    fill_server();
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(0), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(1), 0));
+
+    pal->timeout();
+    ASSERT_EQ(2, (int) reads.size());
+    EXPECT_EQ(BLE_ERROR_UNSPECIFIED, reads[0].status);
+    EXPECT_EQ(BLE_ERROR_UNSPECIFIED, reads[1].status);
+    EXPECT_FALSE(pal->respond());
+}
+
+TEST_F(TestGenericGattClient, queued_discovery)
+{
+    fill_server();
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(0), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->launchServiceDiscovery(
+        TEST_CONNECTION, on_service, NULL, UUID(), UUID()
+    ));
+    EXPECT_TRUE(client->isServiceDiscoveryActive());
+
+    pal->run();
+    EXPECT_EQ(1, terminations);
+    EXPECT_EQ(1, pal->request_count[AttributeOpcode::READ_BY_GROUP_TYPE_REQUEST]);
+    EXPECT_FALSE(client->isServiceDiscoveryActive());
+
+    // terminated while waiting, the discovery never reaches the server
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(0), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->launchServiceDiscovery(
+        TEST_CONNECTION, on_service, NULL, UUID(), UUID()
+    ));
+    client->terminateServiceDiscovery();
+    pal->run();
+    EXPECT_EQ(2, terminations);
+    EXPECT_EQ(1, pal->request_count[AttributeOpcode::READ_BY_GROUP_TYPE_REQUEST]);
+}
+
+TEST_F(TestGenericGattClient, reset_aborts_queue)
+{
+    fill_server();
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(0), 0));
+    EXPECT_EQ(BLE_ERROR_NONE, client->read(TEST_CONNECTION, handle(1), 0));
+
+    EXPECT_EQ(BLE_ERROR_NONE, client->reset());
+    ASSERT_EQ(2, (int) reads.size());
+    EXPECT_EQ(BLE_ERROR_INVALID_STATE, reads[0].status);
+    EXPECT_EQ(BLE_ERROR_INVALID_STATE, reads[1].status);
+}
+
+TEST_F(TestGenericGattClient, discovery_from_cache)
+{
+    fill_database();
+    reconnect();
+
+    uint32_t cold = discover_all();
+    EXPECT_EQ(3 + 3 * TEST_SENSORS, (int) characteristics.size());
+    EXPECT_EQ(1, store.updates);
+    std::vector<DiscoveredCharacteristic> expected = characteristics;
+
+    // the handles are usable as soon as the discovery is launched
+    reconnect();
+    uint32_t cached = discover_all();
+    EXPECT_EQ(0, cached);
+    expect_same_characteristics(expected);
+    EXPECT_FALSE(client->isServiceDiscoveryActive());
+
+    record("time_to_handles_cold_ms", cold * TEST_ROUND_TRIP_MS);
+    record("time_to_handles_cached_ms", cached * TEST_ROUND_TRIP_MS);
+}
+
+TEST_F(TestGenericGattClient, filtered_discovery_from_cache)
+{
+    fill_database();
+    reconnect();
+    discover_all();
+
+    reconnect();
+    EXPECT_EQ(BLE_ERROR_NONE, client->launchServiceDiscovery(
+        TEST_CONNECTION,
+        NULL,
+        characteristic_callback(),
+        UUID(0x1801),
+        UUID(BLE_UUID_GATT_CHARACTERISTIC_SERVICE_CHANGED)
+    ));
+    EXPECT_EQ(0, pal->round_trips);
+    ASSERT_EQ(1, (int) characteristics.size());
+    EXPECT_EQ(0x0008, characteristics[0].getValueHandle());
+    EXPECT_EQ(0x0009, characteristics[0].getLastHandle());
+
+    // terminated from a callback, the discovery stops there
+    characteristics.clear();
+    terminate_after = 3;
+    discover_all();
+    EXPECT_EQ(3, (int) characteristics.size());
+}
+
+TEST_F(TestGenericGattClient, descriptors_from_cache)
+{
+    fill_database();
+    reconnect();
+    discover_all();
+    DiscoveredCharacteristic measurement = characteristics[2];
+    EXPECT_EQ(0x0008, measurement.getValueHandle());
+
+    pal->reset_counters();
+    discover_descriptors(measurement);
+    EXPECT_LT(0, pal->round_trips);
+    ASSERT_EQ(1, (int) descriptors.size());
+    EXPECT_EQ(0x0009, descriptors[0]);
+
+    reconnect();
+    discover_all();
+    discover_descriptors(characteristics[2]);
+    EXPECT_EQ(0, pal->round_trips);
+    ASSERT_EQ(1, (int) descriptors.size());
+    EXPECT_EQ(0x0009, descriptors[0]);
+}
+
+TEST_F(TestGenericGattClient, peer_not_bonded)
+{
+    fill_database();
+    store.bonded = false;
+    reconnect();
+
+    uint32_t cold = discover_all();
+    reconnect();
+    EXPECT_EQ(cold, discover_all());
+    EXPECT_EQ(0, store.updates);
+}
+
+TEST_F(TestGenericGattClient, service_changed_invalidates_cache)
+{
+    fill_database();
+    reconnect();
+    uint32_t cold = discover_all();
+    std::vector<DiscoveredCharacteristic> expected = characteristics;
+
+    // indications of other characteristics leave the cache untouched
+    pal->indicate(TEST_CONNECTION, 0x0012);
+    EXPECT_EQ(0, invalidations);
+
+    pal->indicate(TEST_CONNECTION, 0x0008);
+    EXPECT_EQ(1, invalidations);
+    EXPECT_TRUE(store.cache.empty());
+
+    // discovered again over the air, then cached again
+    reconnect();
+    EXPECT_EQ(cold, discover_all());
+    expect_same_characteristics(expected);
+    EXPECT_FALSE(store.cache.empty());
+}
+
+TEST_F(TestGenericGattClient, background_verification)
+{
+    fill_database();
+    reconnect();
+    discover_all();
+
+    reconnect();
+    client->set_attribute_cache_verification(true);
+    discover_all();
+    EXPECT_EQ(3 + 3 * TEST_SENSORS, (int) characteristics.size());
+    EXPECT_EQ(0, invalidations);
+    EXPECT_LT(0, pal->request_count[AttributeOpcode::READ_BY_GROUP_TYPE_REQUEST]);
+    EXPECT_EQ(0, pal->request_count[AttributeOpcode::READ_BY_TYPE_REQUEST]);
+    EXPECT_FALSE(store.cache.empty());
+
+    // a service is added while disconnected, the cache is out of date
+    pal->add_service(0x0100, 0x0104, UUID(0x180F));
+    reconnect();
+    client->set_attribute_cache_verification(true);
+    discover_all();
+    EXPECT_EQ(1, invalidations);
+    EXPECT_TRUE(store.cache.empty());
+}
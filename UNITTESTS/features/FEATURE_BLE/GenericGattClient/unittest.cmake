@@ -0,0 +1,19 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  ../features/FEATURE_BLE
+  ../features/FEATURE_BLE/ble
+)
+
+set(unittest-sources
+  ../features/FEATURE_BLE/source/generic/GenericGattClient.cpp
+)
+
+set(unittest-test-sources
+  features/FEATURE_BLE/GenericGattClient/test_GenericGattClient.cpp
+  features/FEATURE_BLE/GenericGattClient/PalGattClientMock.cpp
+  stubs/mbed_assert_stub.c
+)
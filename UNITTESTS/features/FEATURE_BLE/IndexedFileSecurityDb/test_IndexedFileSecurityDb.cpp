@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "ble/generic/IndexedFileSecurityDb.h"
+#include "ble/generic/FileSecurityDb.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace ble;
+using ble::generic::FileSecurityDb;
+using ble::generic::IndexedFileSecurityDb;
+using ble::generic::SecurityDb;
+using ble::generic::SecurityDistributionFlags_t;
+using ble::generic::SecurityEntryKeys_t;
+
+#define TEST_BONDS      300
+#define TEST_CAPACITY   320
+
+/**
+ * File held in memory which counts the writes reaching the storage and keeps
+ * a copy of the content after each of them.
+ */
+struct SimFile {
+    std::vector<uint8_t> data;
+    size_t position;
+    uint32_t writes;
+    uint32_t bytes_written;
+    bool record_history;
+    std::vector<std::vector<uint8_t> > history;
+
+    SimFile() : position(0), writes(0), bytes_written(0), record_history(false) { }
+
+    FILE *open()
+    {
+        cookie_io_functions_t functions = { read, write, seek, close };
+        position = 0;
+        return fopencookie(this, "rb+", functions);
+    }
+
+    void reset_counters()
+    {
+        writes = 0;
+        bytes_written = 0;
+    }
+
+    static ssize_t read(void *cookie, char *buffer, size_t size)
+    {
+        SimFile *file = static_cast<SimFile *>(cookie);
+        if (file->position >= file->data.size()) {
+            return 0;
+        }
+        size_t count = file->data.size() - file->position;
+        count = count < size ? count : size;
+        memcpy(buffer, &file->data[file->position], count);
+        file->position += count;
+        return count;
+    }
+
+    static ssize_t write(void *cookie, const char *buffer, size_t size)
+    {
+        SimFile *file = static_cast<SimFile *>(cookie);
+        if (file->data.size() < file->position + size) {
+            file->data.resize(file->position + size);
+        }
+        memcpy(&file->data[file->position], buffer, size);
+        file->position += size;
+        file->writes++;
+        file->bytes_written += size;
+        if (file->record_history) {
+            file->history.push_back(file->data);
+        }
+        return size;
+    }
+
+    static int seek(void *cookie, off64_t *offset, int whence)
+    {
+        SimFile *file = static_cast<SimFile *>(cookie);
+        off64_t base = whence == SEEK_SET ? 0 :
+                       whence == SEEK_CUR ? file->position : file->data.size();
+        file->position = base + *offset;
+        *offset = file->position;
+        return 0;
+    }
+
+    static int close(void *cookie)
+    {
+        return 0;
+    }
+};
+
+class TestIndexedFileSecurityDb : public testing::Test {
+protected:
+    char path[32];
+    SecurityDb *db;
+    SecurityEntryKeys_t keys;
+    bool keys_found;
+
+    virtual void SetUp()
+    {
+        strcpy(path, "/tmp/securitydbXXXXXX");
+        int fd = mkstemp(path);
+        ASSERT_NE(-1, fd);
+        close(fd);
+        db = NULL;
+    }
+
+    virtual void TearDown()
+    {
+        delete db;
+        remove(path);
+    }
+
+    void open(size_t capacity = TEST_CAPACITY)
+    {
+        delete db;
+        db = NULL;
+        FILE *file = IndexedFileSecurityDb::open_db_file(path, capacity);
+        ASSERT_TRUE(file != NULL);
+        db = new IndexedFileSecurityDb(file, capacity);
+        db->restore();
+    }
+
+    void open(SimFile &file, size_t capacity = TEST_CAPACITY)
+    {
+        delete db;
+        db = new IndexedFileSecurityDb(file.open(), capacity);
+        db->restore();
+    }
+
+    static address_t peer_address(size_t i)
+    {
+        const uint8_t address[6] = { (uint8_t) i, (uint8_t)(i >> 8), 0x10, 0x20, 0x30, 0x40 };
+        return address_t(address);
+    }
+
+    static address_t identity_address(size_t i)
+    {
+        const uint8_t address[6] = { (uint8_t) i, (uint8_t)(i >> 8), 0x50, 0x60, 0x70, 0xC0 };
+        return address_t(address);
+    }
+
+    static ltk_t key(size_t i)
+    {
+        uint8_t value[16];
+        memset(value, i, sizeof(value));
+        value[0] = i >> 8;
+        return ltk_t(value);
+    }
+
+    /** Store the keys distributed during a pairing then disconnect. */
+    void pair(size_t i)
+    {
+        SecurityDb::entry_handle_t entry = db->open_entry(peer_address_type_t::RANDOM, peer_address(i));
+        ASSERT_TRUE(entry != NULL);
+        db->set_entry_peer_ltk(entry, key(i));
+        db->set_entry_peer_ediv_rand(entry, ediv_t(), rand_t());
+        db->set_entry_local_ltk(entry, key(i + 1));
+        db->set_entry_local_ediv_rand(entry, ediv_t(), rand_t());
+        db->set_entry_peer_irk(entry, irk_t());
+        db->set_entry_peer_bdaddr(entry, false, identity_address(i));
+        db->set_entry_peer_csrk(entry, csrk_t());
+        db->close_entry(entry);
+    }
+
+    void keys_cb(SecurityDb::entry_handle_t entry, const SecurityEntryKeys_t *entry_keys)
+    {
+        keys_found = entry_keys != NULL;
+        if (entry_keys) {
+            keys = *entry_keys;
+        }
+    }
+
+    bool has_bond(size_t i)
+    {
+        SecurityDb::entry_handle_t entry =
+            db->find_entry_by_peer_address(peer_address_type_t::RANDOM_STATIC_IDENTITY, identity_address(i));
+        if (!entry) {
+            return false;
+        }
+
+        keys_found = false;
+        db->get_entry_peer_keys(mbed::callback(this, &TestIndexedFileSecurityDb::keys_cb), entry);
+        return keys_found && keys.ltk == key(i);
+    }
+
+    void record(const char *name, uint32_t value)
+    {
+        char text[16];
+        snprintf(text, sizeof(text), "%u", (unsigned)value);
+        RecordProperty(name, text);
+    }
+};
+
+TEST_F(TestIndexedFileSecurityDb, lookup_many_bonds)
+{
+    open();
+    db->set_restore(true);
+
+    for (size_t i = 0; i < TEST_BONDS; i++) {
+        pair(i);
+    }
+
+    for (size_t i = 0; i < TEST_BONDS; i++) {
+        SecurityDb::entry_handle_t entry =
+            db->find_entry_by_peer_address(peer_address_type_t::RANDOM, peer_address(i));
+        ASSERT_TRUE(entry != NULL);
+        EXPECT_TRUE(has_bond(i)) << i;
+    }
+
+    EXPECT_TRUE(db->find_entry_by_peer_address(peer_address_type_t::RANDOM, identity_address(TEST_BONDS)) == NULL);
+}
+
+TEST_F(TestIndexedFileSecurityDb, restore_bonds)
+{
+    open();
+    db->set_restore(true);
+
+    for (size_t i = 0; i < TEST_BONDS; i++) {
+        pair(i);
+    }
+
+    open();
+    for (size_t i = 0; i < TEST_BONDS; i++) {
+        EXPECT_TRUE(has_bond(i)) << i;
+    }
+
+    // bonds are not kept unless requested
+    db->set_restore(false);
+    open();
+    EXPECT_FALSE(has_bond(0));
+}
+
+TEST_F(TestIndexedFileSecurityDb, capacity_change_erases)
+{
+    open();
+    db->set_restore(true);
+    pair(1);
+
+    open(TEST_CAPACITY / 2);
+    EXPECT_FALSE(has_bond(1));
+}
+
+TEST_F(TestIndexedFileSecurityDb, reconnect_with_new_address)
+{
+    open();
+    db->set_restore(true);
+    pair(7);
+
+    // the peer comes back with a new resolvable address
+    SecurityDb::entry_handle_t entry =
+        db->open_entry(peer_address_type_t::RANDOM_STATIC_IDENTITY, identity_address(7));
+    ASSERT_TRUE(entry != NULL);
+    SecurityDistributionFlags_t *flags = db->get_distribution_flags(entry);
+    flags->peer_address = peer_address(1000);
+    db->close_entry(entry);
+
+    EXPECT_TRUE(db->find_entry_by_peer_address(peer_address_type_t::RANDOM, peer_address(7)) == NULL);
+    EXPECT_TRUE(db->find_entry_by_peer_address(peer_address_type_t::RANDOM, peer_address(1000)) == entry);
+
+    open();
+    EXPECT_TRUE(db->find_entry_by_peer_address(peer_address_type_t::RANDOM, peer_address(1000)) != NULL);
+    EXPECT_TRUE(has_bond(7));
+}
+
+TEST_F(TestIndexedFileSecurityDb, unbonded_entries_not_kept)
+{
+    open();
+    db->set_restore(true);
+
+    SecurityDb::entry_handle_t entry = db->open_entry(peer_address_type_t::RANDOM, peer_address(3));
+    ASSERT_TRUE(entry != NULL);
+    db->close_entry(entry);
+
+    EXPECT_TRUE(db->find_entry_by_peer_address(peer_address_type_t::RANDOM, peer_address(3)) == NULL);
+}
+
+TEST_F(TestIndexedFileSecurityDb, least_recently_used_replaced)
+{
+    open(4);
+    db->set_restore(true);
+
+    for (size_t i = 0; i < 4; i++) {
+        pair(i);
+    }
+
+    // reconnecting refreshes the bond
+    db->close_entry(db->open_entry(peer_address_type_t::RANDOM, peer_address(0)));
+
+    pair(4);
+    EXPECT_TRUE(has_bond(0));
+    EXPECT_FALSE(has_bond(1));
+    EXPECT_TRUE(has_bond(4));
+
+    open(4);
+    EXPECT_TRUE(has_bond(0));
+    EXPECT_FALSE(has_bond(1));
+    EXPECT_TRUE(has_bond(2));
+    EXPECT_TRUE(has_bond(4));
+}
+
+TEST_F(TestIndexedFileSecurityDb, gatt_cache)
+{
+    open();
+    db->set_restore(true);
+
+    std::vector<uint8_t> cache(300, 0x5A);
+    SecurityDb::entry_handle_t entry = db->open_entry(peer_address_type_t::PUBLIC, peer_address(1));
+    db->set_entry_peer_ltk(entry, key(1));
+    db->set_entry_gatt_cache(entry, ArrayView<const uint8_t>(&cache[0], cache.size()));
+    db->close_entry(entry);
+
+    open();
+    entry = db->find_entry_by_peer_address(peer_address_type_t::PUBLIC, peer_address(1));
+    ASSERT_TRUE(entry != NULL);
+    ArrayView<const uint8_t> stored = db->get_entry_gatt_cache(entry);
+    ASSERT_EQ(cache.size(), stored.size());
+    EXPECT_EQ(0, memcmp(stored.data(), &cache[0], cache.size()));
+
+    // a new bond in the same entry does not see the cache of the previous one
+    db->remove_entry(peer_address_type_t::PUBLIC, peer_address(1));
+    db->sync(NULL);
+    open();
+    entry = db->open_entry(peer_address_type_t::PUBLIC, peer_address(2));
+    db->set_entry_peer_ltk(entry, key(2));
+    EXPECT_EQ(0, db->get_entry_gatt_cache(entry).size());
+}
+
+TEST_F(TestIndexedFileSecurityDb, interrupted_sync)
+{
+    SimFile file;
+    open(file, 16);
+    db->set_restore(true);
+    pair(1);
+
+    // several pairings completed at once, then synced together
+    SecurityDb::entry_handle_t entries[3];
+    for (size_t i = 0; i < 3; i++) {
+        entries[i] = db->open_entry(peer_address_type_t::RANDOM, peer_address(10 + i));
+        db->set_entry_peer_ltk(entries[i], key(10 + i));
+        db->set_entry_peer_irk(entries[i], irk_t());
+        db->set_entry_peer_bdaddr(entries[i], false, identity_address(10 + i));
+    }
+
+    const std::vector<uint8_t> before = file.data;
+    file.record_history = true;
+    db->sync(entries[0]);
+    file.record_history = false;
+    ASSERT_LT(0U, file.history.size());
+
+    // reset after any write of the transaction: all or none of the bonds
+    file.history.insert(file.history.begin(), before);
+    size_t committed = 0;
+    for (size_t step = 0; step < file.history.size(); step++) {
+        SimFile crashed;
+        crashed.data = file.history[step];
+        delete db;
+        db = NULL;
+        open(crashed, 16);
+
+        EXPECT_TRUE(has_bond(1)) << step;
+        bool first = has_bond(10);
+        EXPECT_EQ(first, has_bond(11)) << step;
+        EXPECT_EQ(first, has_bond(12)) << step;
+        if (first) {
+            committed++;
+        }
+        delete db;
+        db = NULL;
+    }
+
+    EXPECT_LT(0U, committed);
+    EXPECT_TRUE(committed < file.history.size());
+}
+
+TEST_F(TestIndexedFileSecurityDb, writes_per_pairing)
+{
+    SimFile indexed_file;
+    open(indexed_file, TEST_CAPACITY);
+    db->set_restore(true);
+    for (size_t i = 0; i < TEST_BONDS - 1; i++) {
+        pair(i);
+    }
+    indexed_file.reset_counters();
+    pair(TEST_BONDS - 1);
+    const uint32_t indexed_writes = indexed_file.writes;
+    delete db;
+    db = NULL;
+
+    SimFile file;
+    db = new FileSecurityDb(file.open());
+    db->restore();
+    db->set_restore(true);
+    file.reset_counters();
+    pair(0);
+    const uint32_t file_writes = file.writes;
+    delete db;
+    db = NULL;
+
+    // journal with its header, local data, record and journal release
+    record("indexed_writes_per_pairing", indexed_writes);
+    record("file_writes_per_pairing", file_writes);
+    EXPECT_GE(5U, indexed_writes);
+    EXPECT_LT(indexed_writes, file_writes);
+}
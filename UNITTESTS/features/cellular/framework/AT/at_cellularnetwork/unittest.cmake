@@ -24,6 +24,7 @@ set(unittest-test-sources
   stubs/ATHandler_stub.cpp
   stubs/AT_CellularBase_stub.cpp
   stubs/EventQueue_stub.cpp
+  stubs/equeue_stub.c
   stubs/FileHandle_stub.cpp
   stubs/NetworkInterface_stub.cpp
   stubs/NetworkStack_stub.cpp
@@ -22,6 +22,7 @@ set(unittest-test-sources
   stubs/ATHandler_stub.cpp
   stubs/AT_CellularBase_stub.cpp
   stubs/EventQueue_stub.cpp
+  stubs/equeue_stub.c
   stubs/FileHandle_stub.cpp
   stubs/CellularUtil_stub.cpp
   stubs/us_ticker_stub.cpp
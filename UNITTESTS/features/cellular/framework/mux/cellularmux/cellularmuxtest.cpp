@@ -0,0 +1,518 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+#include <deque>
+#include <map>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include "EventQueue.h"
+#include "ATHandler.h"
+#include "FileHandle.h"
+#include "Timer_stub.h"
+#include "CellularMux.h"
+#include "bench_timer.h"
+
+using namespace mbed;
+using namespace events;
+
+#define FLAG 0xF9
+#define SABM 0x2F
+#define UA 0x63
+#define DM 0x0F
+#define DISC 0x43
+#define UIH 0xEF
+#define PF 0x10
+
+#define MSG_MSC 0xE1
+#define MSG_CLD 0xC1
+#define MSC_FC 0x02
+
+#define AT_DLCI 1
+#define PPP_DLCI 2
+
+/**
+ * Modem in multiplexer mode.
+ *
+ * Answers channel requests, AT commands on DLCI 1 and echoes the data of
+ * DLCI 2. Frames are handed to the host one at a time, and frames of a
+ * channel the host has stopped wait until the host releases it, like a modem
+ * observing the flow control of the host.
+ */
+class CmuxModem : public FileHandle {
+public:
+    CmuxModem() :
+        frames_received(0),
+        flow_stops(0),
+        fcs_errors(0),
+        at_commands(0),
+        urc_interval(0),
+        ppp_frames(0)
+    {
+    }
+
+    static uint8_t fcs(const std::string &bytes)
+    {
+        uint8_t fcs = 0xFF;
+        for (size_t i = 0; i < bytes.size(); i++) {
+            fcs ^= (uint8_t)bytes[i];
+            for (int bit = 0; bit < 8; bit++) {
+                fcs = (fcs & 1) ? (fcs >> 1) ^ 0xE0 : fcs >> 1;
+            }
+        }
+        return 0xFF - fcs;
+    }
+
+    // frame sent by the modem, the responder, which clears C/R in commands
+    static std::string frame(uint8_t dlci, uint8_t control, bool command, const std::string &data = "")
+    {
+        std::string header;
+        header += (char)((dlci << 2) | (command ? 0 : 2) | 1);
+        header += (char)control;
+        if (data.size() > 127) {
+            header += (char)((data.size() << 1) & 0xFE);
+            header += (char)(data.size() >> 7);
+        } else {
+            header += (char)((data.size() << 1) | 1);
+        }
+        return std::string(1, (char)FLAG) + header + data + (char)fcs(header) + (char)FLAG;
+    }
+
+    // modem status command of the modem for a channel
+    static std::string modem_status(uint8_t dlci, bool stopped)
+    {
+        std::string msg;
+        msg += (char)(MSG_MSC | 2);
+        msg += (char)((2 << 1) | 1);
+        msg += (char)((dlci << 2) | 2 | 1);
+        msg += (char)(0x8D | (stopped ? MSC_FC : 0));
+        return frame(0, UIH, true, msg);
+    }
+
+    void send(uint8_t dlci, const std::string &frame)
+    {
+        Pending pending = { dlci, frame };
+        _pending.push_back(pending);
+        signal();
+    }
+
+    bool is_open(uint8_t dlci) const
+    {
+        std::map<uint8_t, bool>::const_iterator it = _open.find(dlci);
+        return it != _open.end() && it->second;
+    }
+
+    bool host_stopped(uint8_t dlci) const
+    {
+        std::map<uint8_t, bool>::const_iterator it = _host_stopped.find(dlci);
+        return it != _host_stopped.end() && it->second;
+    }
+
+    bool idle() const
+    {
+        return _rx.empty() && _pending.empty();
+    }
+
+    virtual ssize_t read(void *buffer, size_t size)
+    {
+        next_frame();
+        size_t len = _rx.size() < size ? _rx.size() : size;
+        memcpy(buffer, _rx.data(), len);
+        _rx.erase(0, len);
+        return len;
+    }
+
+    virtual ssize_t write(const void *buffer, size_t size)
+    {
+        _tx.append((const char *)buffer, size);
+
+        for (;;) {
+            size_t start = _tx.find((char)FLAG);
+            if (start == std::string::npos || _tx.size() < start + 4) {
+                break;
+            }
+            if (_tx[start + 1] == (char)FLAG) {
+                _tx.erase(0, start + 1);
+                continue;
+            }
+            size_t header = ((uint8_t)_tx[start + 3] & 1) ? 3 : 4;
+            if (_tx.size() < start + 1 + header) {
+                break;
+            }
+            size_t length = (uint8_t)_tx[start + 3] >> 1;
+            if (header == 4) {
+                length |= (size_t)(uint8_t)_tx[start + 4] << 7;
+            }
+            size_t end = start + 1 + header + length + 1;
+            if (_tx.size() < end + 1) {
+                break;
+            }
+            EXPECT_EQ((char)FLAG, _tx[end]);
+            std::string head = _tx.substr(start + 1, header);
+            if ((uint8_t)_tx[end - 1] == fcs(head)) {
+                receive((uint8_t)head[0] >> 2, (uint8_t)head[1], _tx.substr(start + 1 + header, length));
+            } else {
+                fcs_errors++;
+            }
+            _tx.erase(0, end + 1);
+        }
+
+        return size;
+    }
+
+    virtual off_t seek(off_t offset, int whence = SEEK_SET)
+    {
+        return -ESPIPE;
+    }
+
+    virtual int close()
+    {
+        return 0;
+    }
+
+    virtual short poll(short events) const
+    {
+        return POLLOUT | ((!_rx.empty() || sendable() != _pending.end()) ? POLLIN : 0);
+    }
+
+    virtual void sigio(Callback<void()> func)
+    {
+        _sigio_cb = func;
+        signal();
+    }
+
+    int frames_received;
+    int flow_stops;
+    int fcs_errors;
+    int at_commands;
+    // a URC is sent on the AT channel after every urc_interval PPP frames, 0 for none
+    int urc_interval;
+    int ppp_frames;
+    std::string ppp_data;
+    std::map<uint8_t, bool> refuse;
+
+private:
+    struct Pending {
+        uint8_t dlci;
+        std::string frame;
+    };
+
+    // like a serial port, tell the host when there is input for it
+    void signal()
+    {
+        if (_sigio_cb && (poll(POLLIN) & POLLIN)) {
+            _sigio_cb();
+        }
+    }
+
+    std::deque<Pending>::const_iterator sendable() const
+    {
+        std::deque<Pending>::const_iterator it = _pending.begin();
+        while (it != _pending.end() && host_stopped(it->dlci)) {
+            ++it;
+        }
+        return it;
+    }
+
+    void next_frame()
+    {
+        if (!_rx.empty()) {
+            return;
+        }
+        std::deque<Pending>::const_iterator it = sendable();
+        if (it != _pending.end()) {
+            _rx = it->frame;
+            _pending.erase(_pending.begin() + (it - _pending.begin()));
+        }
+    }
+
+    void receive(uint8_t dlci, uint8_t control, const std::string &data)
+    {
+        frames_received++;
+        switch (control & ~PF) {
+            case SABM:
+                if (refuse[dlci]) {
+                    send(0, frame(dlci, DM | PF, false));
+                } else {
+                    _open[dlci] = true;
+                    send(0, frame(dlci, UA | PF, false));
+                }
+                break;
+            case DISC:
+                _open[dlci] = false;
+                send(0, frame(dlci, UA | PF, false));
+                break;
+            case UA:
+                // answer to a disconnect of the modem
+                break;
+            case UIH:
+                if (dlci == 0) {
+                    control_message(data);
+                } else if (dlci == AT_DLCI) {
+                    at_input(data);
+                } else if (dlci == PPP_DLCI) {
+                    ppp_data += data;
+                    send(PPP_DLCI, frame(PPP_DLCI, UIH, true, data));
+                    ppp_frames++;
+                    if (urc_interval && ppp_frames % urc_interval == 0) {
+                        send(AT_DLCI, frame(AT_DLCI, UIH, true, "\r\n+CREG: 1\r\n"));
+                    }
+                }
+                break;
+            default:
+                ADD_FAILURE() << "unexpected frame type " << (int)control;
+                break;
+        }
+    }
+
+    void control_message(const std::string &data)
+    {
+        ASSERT_GE(data.size(), 2u);
+        uint8_t type = (uint8_t)data[0];
+        if (!(type & 2)) {
+            // response to a command of the modem
+            return;
+        }
+        if ((type & ~2) == MSG_MSC) {
+            ASSERT_EQ(4u, data.size());
+            uint8_t dlci = (uint8_t)data[2] >> 2;
+            bool stopped = (uint8_t)data[3] & MSC_FC;
+            bool released = !stopped && _host_stopped[dlci];
+            if (stopped && !_host_stopped[dlci]) {
+                flow_stops++;
+            }
+            _host_stopped[dlci] = stopped;
+            if (released) {
+                signal();
+            }
+        } else if ((type & ~2) == MSG_CLD) {
+            _open.clear();
+        }
+        std::string response = data;
+        response[0] = (char)(type & ~2);
+        send(0, frame(0, UIH, true, response));
+    }
+
+    void at_input(const std::string &data)
+    {
+        _line += data;
+        size_t end;
+        while ((end = _line.find('\r')) != std::string::npos) {
+            std::string command = _line.substr(0, end);
+            _line.erase(0, end + 1);
+            at_commands++;
+            send(AT_DLCI, frame(AT_DLCI, UIH, true, command == "AT" ? "\r\nOK\r\n" : "\r\nERROR\r\n"));
+        }
+    }
+
+    std::deque<Pending> _pending;
+    std::map<uint8_t, bool> _open;
+    std::map<uint8_t, bool> _host_stopped;
+    std::string _line;
+    std::string _tx;
+    std::string _rx;
+    Callback<void()> _sigio_cb;
+};
+
+class TestCellularMux : public testing::Test {
+protected:
+    TestCellularMux() :
+        mux(&modem, queue),
+        urcs(0),
+        wakeups(0)
+    {
+    }
+
+    void SetUp()
+    {
+        timer_stub_step = 1;
+    }
+
+    std::string read_all(FileHandle *channel, size_t length)
+    {
+        std::string data;
+        char buffer[100];
+        while (data.size() < length) {
+            ssize_t len = channel->read(buffer, sizeof(buffer));
+            if (len <= 0) {
+                ADD_FAILURE() << "read error " << len;
+                break;
+            }
+            data.append(buffer, len);
+        }
+        return data;
+    }
+
+public:
+    void urc()
+    {
+        urcs++;
+    }
+
+    void wakeup()
+    {
+        wakeups++;
+    }
+
+protected:
+    CmuxModem modem;
+    EventQueue queue;
+    CellularMux mux;
+    int urcs;
+    int wakeups;
+};
+
+TEST_F(TestCellularMux, start_and_open_channels)
+{
+    EXPECT_TRUE(NULL == mux.open_channel(AT_DLCI));
+    ASSERT_EQ(NSAPI_ERROR_OK, mux.start());
+    EXPECT_TRUE(modem.is_open(0));
+
+    CellularMuxChannel *at = mux.open_channel(AT_DLCI);
+    ASSERT_TRUE(at != NULL);
+    EXPECT_EQ(AT_DLCI, at->get_dlci());
+    EXPECT_TRUE(modem.is_open(AT_DLCI));
+    EXPECT_TRUE(NULL == mux.open_channel(AT_DLCI));
+
+    modem.refuse[PPP_DLCI] = true;
+    EXPECT_TRUE(NULL == mux.open_channel(PPP_DLCI));
+    modem.refuse[PPP_DLCI] = false;
+    CellularMuxChannel *ppp = mux.open_channel(PPP_DLCI);
+    ASSERT_TRUE(ppp != NULL);
+
+    EXPECT_EQ(0, ppp->close());
+    EXPECT_FALSE(modem.is_open(PPP_DLCI));
+    EXPECT_EQ(-ENOTCONN, ppp->write("x", 1));
+
+    EXPECT_EQ(NSAPI_ERROR_OK, mux.stop());
+    mux.process(0);
+    EXPECT_FALSE(modem.is_open(AT_DLCI));
+    EXPECT_TRUE(at->poll(POLLIN) & POLLHUP);
+    EXPECT_EQ(0, modem.fcs_errors);
+}
+
+TEST_F(TestCellularMux, ppp_data_flows_during_at_commands)
+{
+    ASSERT_EQ(NSAPI_ERROR_OK, mux.start());
+    CellularMuxChannel *at_channel = mux.open_channel(AT_DLCI);
+    CellularMuxChannel *ppp = mux.open_channel(PPP_DLCI);
+    ASSERT_TRUE(at_channel && ppp);
+
+    ATHandler at(at_channel, queue, 1000, "\r");
+    at.set_urc_handler("+CREG:", Callback<void()>(this, &TestCellularMux::urc));
+    modem.urc_interval = 12;
+
+    const int rounds = 200;
+    const size_t packet = 1500;
+    std::string sent;
+    std::string echoed;
+
+    bench_time_t start = bench_now();
+    for (int i = 0; i < rounds; i++) {
+        std::string data;
+        for (size_t j = 0; j < packet; j++) {
+            data += (char)(i + j * 7);
+        }
+        sent += data;
+        ASSERT_EQ((ssize_t)packet, ppp->write(data.data(), data.size()));
+
+        // the AT response is queued behind the echo, which the host holds off
+        at.lock();
+        at.cmd_start("AT");
+        at.cmd_stop();
+        at.resp_start();
+        at.resp_stop();
+        ASSERT_EQ(NSAPI_ERROR_OK, at.unlock_return_error());
+
+        echoed += read_all(ppp, packet);
+    }
+    uint64_t us = bench_ns_since(start) / 1000;
+    at.process_oob();
+
+    EXPECT_TRUE(sent == echoed);
+    EXPECT_TRUE(sent == modem.ppp_data);
+    EXPECT_EQ(rounds, modem.at_commands);
+    EXPECT_EQ(modem.ppp_frames / modem.urc_interval, urcs);
+    EXPECT_GT(modem.flow_stops, 0);
+    EXPECT_EQ(0, modem.fcs_errors);
+    EXPECT_TRUE(modem.idle());
+
+    bench_report("ppp_bytes", sent.size(), "B");
+    bench_report("ppp_bytes_per_ms", us ? (double)sent.size() * 2 * 1000 / us : 0, "B/ms");
+    bench_report("at_commands", modem.at_commands, "commands");
+    bench_report("urcs", urcs, "URCs");
+    bench_report("flow_stops", modem.flow_stops, "stops");
+}
+
+TEST_F(TestCellularMux, modem_flow_control_stops_writes)
+{
+    ASSERT_EQ(NSAPI_ERROR_OK, mux.start());
+    CellularMuxChannel *ppp = mux.open_channel(PPP_DLCI);
+    ASSERT_TRUE(ppp != NULL);
+    ppp->set_blocking(false);
+    ppp->sigio(Callback<void()>(this, &TestCellularMux::wakeup));
+    wakeups = 0;
+
+    modem.send(0, CmuxModem::modem_status(PPP_DLCI, true));
+    EXPECT_FALSE(ppp->poll(POLLOUT) & POLLOUT);
+    EXPECT_EQ(-EAGAIN, ppp->write("data", 4));
+    EXPECT_TRUE(modem.ppp_data.empty());
+
+    modem.send(0, CmuxModem::modem_status(PPP_DLCI, false));
+    EXPECT_TRUE(ppp->poll(POLLOUT) & POLLOUT);
+    EXPECT_EQ(1, wakeups);
+    EXPECT_EQ(4, ppp->write("data", 4));
+    EXPECT_EQ("data", modem.ppp_data);
+}
+
+TEST_F(TestCellularMux, corrupted_frame_is_dropped)
+{
+    ASSERT_EQ(NSAPI_ERROR_OK, mux.start());
+    CellularMuxChannel *at = mux.open_channel(AT_DLCI);
+    ASSERT_TRUE(at != NULL);
+    at->set_blocking(false);
+
+    std::string bad = CmuxModem::frame(AT_DLCI, UIH, true, "bad");
+    bad[bad.size() - 2] ^= 0x01;
+    modem.send(AT_DLCI, bad);
+    modem.send(AT_DLCI, CmuxModem::frame(AT_DLCI, UIH, true, "good"));
+
+    char buffer[16];
+    ASSERT_EQ(4, at->read(buffer, sizeof(buffer)));
+    EXPECT_EQ(0, memcmp(buffer, "good", 4));
+    EXPECT_EQ(-EAGAIN, at->read(buffer, sizeof(buffer)));
+}
+
+TEST_F(TestCellularMux, modem_disconnects_channel)
+{
+    ASSERT_EQ(NSAPI_ERROR_OK, mux.start());
+    CellularMuxChannel *ppp = mux.open_channel(PPP_DLCI);
+    ASSERT_TRUE(ppp != NULL);
+
+    modem.send(PPP_DLCI, CmuxModem::frame(PPP_DLCI, UIH, true, "last"));
+    modem.send(0, CmuxModem::frame(PPP_DLCI, DISC | PF, true));
+    mux.process(0);
+
+    // the modem got its answer and data received before is still readable
+    EXPECT_TRUE(modem.idle());
+    short revents = ppp->poll(POLLIN);
+    EXPECT_TRUE(revents & POLLHUP);
+    EXPECT_TRUE(revents & POLLIN);
+    char buffer[8];
+    EXPECT_EQ(4, ppp->read(buffer, sizeof(buffer)));
+    EXPECT_EQ(-ENOTCONN, ppp->read(buffer, sizeof(buffer)));
+}
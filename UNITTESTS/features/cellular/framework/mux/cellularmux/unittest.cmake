@@ -0,0 +1,38 @@
+####################
+# UNIT TESTS
+####################
+
+# Blocked channels wait on event flags set by the multiplexer, so the test uses the real rtos
+set(unittest-rtos posix)
+
+# Add test specific include paths
+set(unittest-includes ${unittest-includes}
+  features/cellular/framework/common/util
+  ../features/cellular/framework/common
+  ../features/cellular/framework/AT
+  ../features/cellular/framework/mux
+  ../features/frameworks/mbed-client-randlib/mbed-client-randlib
+)
+
+# Source files
+set(unittest-sources
+  ../features/cellular/framework/mux/CellularMux.cpp
+  ../features/cellular/framework/AT/ATHandler.cpp
+  ../features/cellular/framework/common/CellularUtil.cpp
+  ../platform/mbed_poll.cpp
+  ../events/EventQueue.cpp
+  ../events/equeue/equeue.c
+)
+
+# Test files
+set(unittest-test-sources
+  features/cellular/framework/mux/cellularmux/cellularmuxtest.cpp
+  stubs/AT_CellularBase_stub.cpp
+  stubs/FileHandle_stub.cpp
+  stubs/us_ticker_stub.cpp
+  stubs/mbed_wait_api_stub.cpp
+  stubs/mbed_assert_stub.c
+  stubs/Timer_stub.cpp
+  stubs/randLIB_stub.cpp
+  stubs/equeue_sim.c
+)
@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+#include <deque>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include "EventQueue.h"
+#include "ATHandler.h"
+#include "FileHandle.h"
+#include "mbed_poll.h"
+#include "mbed_poll_stub.h"
+#include "SocketAddress.h"
+#include "QUECTEL/BG96/QUECTEL_BG96_CellularStack.h"
+
+using namespace mbed;
+using namespace events;
+
+/**
+ * Modem stand-in answering the AT commands of the test script.
+ *
+ * Each step expects either a command line starting with a prefix or raw
+ * socket data, and queues its reply for reading once the step has been
+ * written. An optional action runs while the step is in flight, before the
+ * modem replies.
+ */
+class ScriptedModem : public FileHandle {
+public:
+    ScriptedModem() : exchanges(0)
+    {
+    }
+
+    void expect(const std::string &command, const std::string &reply, Callback<void()> action = NULL)
+    {
+        Step step = { command, false, reply, action };
+        _script.push_back(step);
+    }
+
+    void expect_data(const std::string &data, const std::string &reply, Callback<void()> action = NULL)
+    {
+        Step step = { data, true, reply, action };
+        _script.push_back(step);
+    }
+
+    bool done() const
+    {
+        return _script.empty() && _rx.empty();
+    }
+
+    virtual ssize_t read(void *buffer, size_t size)
+    {
+        size_t len = _rx.size() < size ? _rx.size() : size;
+        memcpy(buffer, _rx.data(), len);
+        _rx.erase(0, len);
+        return len;
+    }
+
+    virtual ssize_t write(const void *buffer, size_t size)
+    {
+        _tx.append((const char *)buffer, size);
+
+        while (!_script.empty()) {
+            Step &step = _script.front();
+            if (step.raw) {
+                if (_tx.size() < step.text.size()) {
+                    break;
+                }
+                EXPECT_EQ(step.text, _tx.substr(0, step.text.size()));
+                _tx.erase(0, step.text.size());
+            } else {
+                size_t end = _tx.find('\r');
+                if (end == std::string::npos) {
+                    break;
+                }
+                EXPECT_EQ(step.text, _tx.substr(0, step.text.size()));
+                _tx.erase(0, end + 1);
+            }
+
+            Step served = step;
+            _script.pop_front();
+            exchanges++;
+            if (served.action) {
+                served.action();
+            }
+            _rx.append(served.reply);
+        }
+
+        return size;
+    }
+
+    virtual off_t seek(off_t offset, int whence = SEEK_SET)
+    {
+        return -ESPIPE;
+    }
+
+    virtual int close()
+    {
+        return 0;
+    }
+
+    virtual short poll(short events) const
+    {
+        return POLLOUT | (_rx.empty() ? 0 : POLLIN);
+    }
+
+    virtual void sigio(Callback<void()> func)
+    {
+    }
+
+    // number of steps served
+    int exchanges;
+
+private:
+    struct Step {
+        std::string text;
+        bool raw;
+        std::string reply;
+        Callback<void()> action;
+    };
+
+    std::deque<Step> _script;
+    std::string _tx;
+    std::string _rx;
+};
+
+class TestStack : public QUECTEL_BG96_CellularStack {
+public:
+    TestStack(ATHandler &at) : QUECTEL_BG96_CellularStack(at, 1, IPV4_STACK)
+    {
+    }
+
+    using QUECTEL_BG96_CellularStack::socket_open;
+    using QUECTEL_BG96_CellularStack::socket_close;
+    using QUECTEL_BG96_CellularStack::socket_connect;
+    using QUECTEL_BG96_CellularStack::socket_send;
+    using QUECTEL_BG96_CellularStack::socket_recv;
+    using QUECTEL_BG96_CellularStack::socket_recvfrom;
+    using QUECTEL_BG96_CellularStack::socket_attach;
+};
+
+class TestBG96_CellularStack : public testing::Test {
+protected:
+    TestBG96_CellularStack() :
+        at(&modem, queue, 1000, "\r"),
+        stack(at),
+        socket(NULL),
+        wakeups(0)
+    {
+    }
+
+    void SetUp()
+    {
+        mbed_poll_stub::revents_value = POLLIN | POLLOUT;
+        mbed_poll_stub::int_value = 1;
+    }
+
+    void record(const char *name, uint32_t value)
+    {
+        char text[16];
+        snprintf(text, sizeof(text), "%u", (unsigned)value);
+        RecordProperty(name, text);
+    }
+
+    static void wakeup(void *data)
+    {
+        static_cast<TestBG96_CellularStack *>(data)->wakeups++;
+    }
+
+    void connect()
+    {
+        ASSERT_EQ(NSAPI_ERROR_OK, stack.socket_open(&socket, NSAPI_TCP));
+        stack.socket_attach(socket, &TestBG96_CellularStack::wakeup, this);
+
+        modem.expect("AT+QIOPEN=1,0,\"TCP\",\"10.0.0.1\",5000,", "\r\nOK\r\n\r\n+QIOPEN: 0,0\r\n");
+        ASSERT_EQ(NSAPI_ERROR_OK, stack.socket_connect(socket, SocketAddress("10.0.0.1", 5000)));
+        ASSERT_TRUE(modem.done());
+    }
+
+    // steps of a send of data which the modem accepts
+    void expect_send(const std::string &data, int sent_before, Callback<void()> action = NULL)
+    {
+        char text[64];
+        snprintf(text, sizeof(text), "\r\n+QISEND: %d,0,0\r\n\r\nOK\r\n", sent_before);
+        modem.expect("AT+QISEND=0,0", text);
+        snprintf(text, sizeof(text), "AT+QISEND=0,%u", (unsigned)data.size());
+        modem.expect(text, "\r\n> ");
+        modem.expect_data(data, "\r\nSEND OK\r\n", action);
+        snprintf(text, sizeof(text), "\r\n+QISEND: %d,0,0\r\n\r\nOK\r\n", sent_before + (int)data.size());
+        modem.expect("AT+QISEND=0,0", text);
+    }
+
+    nsapi_size_or_error_t send(const std::string &data)
+    {
+        return stack.socket_send(socket, data.data(), data.size());
+    }
+
+public:
+    // application sends while the modem is taking the previous data
+    void send_during_transfer()
+    {
+        int exchanges = modem.exchanges;
+        for (int i = 0; i < 3; i++) {
+            EXPECT_EQ(10, send("abcdefghij"));
+        }
+        // the data is queued without waiting for the send in progress
+        EXPECT_EQ(exchanges, modem.exchanges);
+    }
+
+protected:
+    ScriptedModem modem;
+    EventQueue queue;
+    ATHandler at;
+    TestStack stack;
+    nsapi_socket_t socket;
+    int wakeups;
+};
+
+TEST_F(TestBG96_CellularStack, small_reads_are_served_from_read_ahead)
+{
+    connect();
+
+    std::string data;
+    for (int i = 0; i < 100; i++) {
+        data += (char)('a' + i % 26);
+    }
+    modem.expect("AT+QIRD=0", "\r\n+QIRD: 100\r\n" + data + "\r\n\r\nOK\r\n");
+
+    int exchanges = modem.exchanges;
+    std::string received;
+    for (int i = 0; i < 100; i++) {
+        char c;
+        ASSERT_EQ(1, stack.socket_recv(socket, &c, 1));
+        received += c;
+    }
+    EXPECT_EQ(data, received);
+    EXPECT_EQ(1, modem.exchanges - exchanges);
+    record("read_commands_per_100_reads", modem.exchanges - exchanges);
+
+    // nothing left on the modem either
+    modem.expect("AT+QIRD=0", "\r\n+QIRD: 0\r\n\r\nOK\r\n");
+    char c;
+    EXPECT_EQ(NSAPI_ERROR_WOULD_BLOCK, stack.socket_recv(socket, &c, 1));
+    EXPECT_TRUE(modem.done());
+}
+
+TEST_F(TestBG96_CellularStack, datagram_is_read_whole_and_truncated)
+{
+    ASSERT_EQ(NSAPI_ERROR_OK, stack.socket_open(&socket, NSAPI_UDP));
+
+    modem.expect("AT+QIOPEN=1,0,\"UDP SERVICE\",\"127.0.0.1\",0,", "\r\nOK\r\n\r\n+QIOPEN: 0,0\r\n");
+    modem.expect("AT+QIRD=0", "\r\n+QIRD: 8,\"10.0.0.2\",7000\r\n01234567\r\n\r\nOK\r\n");
+
+    char buffer[4];
+    SocketAddress address;
+    ASSERT_EQ(4, stack.socket_recvfrom(socket, &address, buffer, sizeof(buffer)));
+    EXPECT_EQ(0, memcmp(buffer, "0123", 4));
+    EXPECT_STREQ("10.0.0.2", address.get_ip_address());
+    EXPECT_EQ(7000, address.get_port());
+
+    // rest of the datagram is dropped, the next read asks the modem
+    modem.expect("AT+QIRD=0", "\r\n+QIRD: 2,\"10.0.0.3\",7001\r\nab\r\n\r\nOK\r\n");
+    ASSERT_EQ(2, stack.socket_recvfrom(socket, &address, buffer, sizeof(buffer)));
+    EXPECT_EQ(0, memcmp(buffer, "ab", 2));
+    EXPECT_STREQ("10.0.0.3", address.get_ip_address());
+    EXPECT_TRUE(modem.done());
+}
+
+TEST_F(TestBG96_CellularStack, sends_queued_during_transfer_are_coalesced)
+{
+    connect();
+
+    int exchanges = modem.exchanges;
+    EXPECT_EQ(10, send("0123456789"));
+    EXPECT_EQ(exchanges, modem.exchanges);
+
+    expect_send("0123456789", 0, Callback<void()>(this, &TestBG96_CellularStack::send_during_transfer));
+    expect_send("abcdefghijabcdefghijabcdefghij", 10);
+    queue.dispatch(0);
+
+    EXPECT_TRUE(modem.done());
+    // four application sends took two modem sends
+    EXPECT_EQ(8, modem.exchanges - exchanges);
+    EXPECT_EQ(2, wakeups);
+    record("modem_exchanges_per_4_sends", modem.exchanges - exchanges);
+}
+
+TEST_F(TestBG96_CellularStack, full_queue_would_block_until_sent)
+{
+    connect();
+
+    std::string data(BG96_SOCKET_TX_BUFFER_SIZE, 'x');
+    EXPECT_EQ(BG96_SOCKET_TX_BUFFER_SIZE, send(data + "y"));
+    EXPECT_EQ(NSAPI_ERROR_WOULD_BLOCK, send("y"));
+
+    expect_send(data, 0);
+    queue.dispatch(0);
+    EXPECT_TRUE(modem.done());
+    EXPECT_EQ(1, wakeups);
+
+    EXPECT_EQ(1, send("y"));
+}
+
+TEST_F(TestBG96_CellularStack, send_error_is_returned_by_next_send)
+{
+    connect();
+
+    EXPECT_EQ(4, send("data"));
+
+    modem.expect("AT+QISEND=0,0", "\r\n+QISEND: 0,0,0\r\n\r\nOK\r\n");
+    modem.expect("AT+QISEND=0,4", "\r\nERROR\r\n");
+    queue.dispatch(0);
+    EXPECT_EQ(1, wakeups);
+
+    EXPECT_EQ(NSAPI_ERROR_DEVICE_ERROR, send("more"));
+    EXPECT_TRUE(modem.done());
+}
+
+TEST_F(TestBG96_CellularStack, close_sends_queued_data)
+{
+    connect();
+
+    EXPECT_EQ(5, send("hello"));
+
+    expect_send("hello", 0);
+    modem.expect("AT+QICLOSE=0", "\r\nOK\r\n");
+    EXPECT_EQ(NSAPI_ERROR_OK, stack.socket_close(socket));
+    EXPECT_TRUE(modem.done());
+
+    // the pending flush finds nothing left to send
+    queue.dispatch(0);
+    EXPECT_TRUE(modem.done());
+}
@@ -0,0 +1,43 @@
+
+####################
+# UNIT TESTS
+####################
+
+# Add test specific include paths
+set(unittest-includes ${unittest-includes}
+  features/cellular/framework/common/util
+  ../features/cellular/framework/common
+  ../features/cellular/framework/AT
+  ../features/cellular/framework/targets
+  ../features/frameworks/mbed-client-randlib/mbed-client-randlib
+)
+
+# Source files
+set(unittest-sources
+  ../features/cellular/framework/AT/ATHandler.cpp
+  ../features/cellular/framework/AT/AT_CellularStack.cpp
+  ../features/cellular/framework/targets/QUECTEL/BG96/QUECTEL_BG96_CellularStack.cpp
+  ../features/cellular/framework/common/CellularUtil.cpp
+  ../features/netsocket/SocketAddress.cpp
+  ../features/frameworks/nanostack-libservice/source/libip4string/ip4tos.c
+  ../features/frameworks/nanostack-libservice/source/libip4string/stoip4.c
+  ../events/EventQueue.cpp
+  ../events/equeue/equeue.c
+)
+
+# Test files
+set(unittest-test-sources
+  features/cellular/framework/targets/QUECTEL/bg96_cellularstack/bg96_cellularstacktest.cpp
+  stubs/AT_CellularBase_stub.cpp
+  stubs/FileHandle_stub.cpp
+  stubs/NetworkStack_stub.cpp
+  stubs/us_ticker_stub.cpp
+  stubs/mbed_wait_api_stub.cpp
+  stubs/mbed_assert_stub.c
+  stubs/mbed_poll_stub.cpp
+  stubs/Timer_stub.cpp
+  stubs/Kernel_stub.cpp
+  stubs/Thread_stub.cpp
+  stubs/randLIB_stub.cpp
+  stubs/equeue_sim.c
+)
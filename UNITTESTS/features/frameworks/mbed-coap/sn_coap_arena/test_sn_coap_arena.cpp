@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "mbed-coap/sn_coap_header.h"
+#include "mbed-coap/sn_coap_protocol.h"
+#include "sn_coap_protocol_internal.h"
+#include "bench_timer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCHMARK_ROUNDS 20000
+
+static uint32_t allocations;
+
+static void *counting_malloc(uint16_t size)
+{
+    allocations++;
+    return malloc(size);
+}
+
+static void counting_free(void *ptr)
+{
+    free(ptr);
+}
+
+class TestSnCoapArena : public testing::Test {
+protected:
+    void SetUp()
+    {
+        memset(&handle, 0, sizeof(handle));
+        handle.sn_coap_protocol_malloc = counting_malloc;
+        handle.sn_coap_protocol_free = counting_free;
+        allocations = 0;
+
+        static const uint8_t token_value[] = { 0xde, 0xad, 0xbe, 0xef };
+        memcpy(token, token_value, sizeof(token));
+
+        /* A LwM2M style notification */
+        sn_coap_parser_init_message(&msg);
+        memset(&options, 0, sizeof(options));
+        options.max_age = COAP_OPTION_MAX_AGE_DEFAULT;
+        options.uri_port = COAP_OPTION_URI_PORT_NONE;
+        options.observe = 12;
+        options.accept = COAP_CT_NONE;
+        options.block1 = COAP_OPTION_BLOCK_NONE;
+        options.block2 = COAP_OPTION_BLOCK_NONE;
+        options.uri_host_ptr = (uint8_t *)"lwm2m.example.com";
+        options.uri_host_len = strlen("lwm2m.example.com");
+        options.uri_query_ptr = (uint8_t *)"ep=node-0001&lt=86400";
+        options.uri_query_len = strlen("ep=node-0001&lt=86400");
+
+        msg.msg_type = COAP_MSG_TYPE_CONFIRMABLE;
+        msg.msg_code = COAP_MSG_CODE_REQUEST_POST;
+        msg.msg_id = 0x1234;
+        msg.token_ptr = token;
+        msg.token_len = sizeof(token);
+        msg.uri_path_ptr = (uint8_t *)"3303/0/5700";
+        msg.uri_path_len = strlen("3303/0/5700");
+        msg.content_format = COAP_CT_TEXT_PLAIN;
+        msg.payload_ptr = (uint8_t *)"21.5";
+        msg.payload_len = 4;
+        msg.options_list_ptr = &options;
+    }
+
+    int16_t build(uint8_t *packet)
+    {
+        uint16_t size = sn_coap_builder_calc_needed_packet_data_size(&msg);
+        return sn_coap_builder_3(packet, size, &msg);
+    }
+
+    void expect_parsed(sn_coap_hdr_s *parsed)
+    {
+        ASSERT_TRUE(parsed != NULL);
+        EXPECT_EQ(COAP_STATUS_OK, parsed->coap_status);
+        EXPECT_EQ(msg.msg_id, parsed->msg_id);
+        EXPECT_EQ(msg.msg_code, parsed->msg_code);
+        ASSERT_EQ(msg.token_len, parsed->token_len);
+        EXPECT_EQ(0, memcmp(msg.token_ptr, parsed->token_ptr, msg.token_len));
+        ASSERT_EQ(msg.uri_path_len, parsed->uri_path_len);
+        EXPECT_EQ(0, memcmp(msg.uri_path_ptr, parsed->uri_path_ptr, msg.uri_path_len));
+        EXPECT_EQ(msg.content_format, parsed->content_format);
+        ASSERT_EQ(msg.payload_len, parsed->payload_len);
+        EXPECT_EQ(0, memcmp(msg.payload_ptr, parsed->payload_ptr, msg.payload_len));
+
+        ASSERT_TRUE(parsed->options_list_ptr != NULL);
+        EXPECT_EQ(options.observe, parsed->options_list_ptr->observe);
+        ASSERT_EQ(options.uri_host_len, parsed->options_list_ptr->uri_host_len);
+        EXPECT_EQ(0, memcmp(options.uri_host_ptr, parsed->options_list_ptr->uri_host_ptr, options.uri_host_len));
+        ASSERT_EQ(options.uri_query_len, parsed->options_list_ptr->uri_query_len);
+        EXPECT_EQ(0, memcmp(options.uri_query_ptr, parsed->options_list_ptr->uri_query_ptr, options.uri_query_len));
+    }
+
+    struct coap_s handle;
+    sn_coap_hdr_s msg;
+    sn_coap_options_list_s options;
+    uint8_t token[4];
+};
+
+TEST_F(TestSnCoapArena, builder_matches_two_pass_builder)
+{
+    uint8_t expected[128];
+    uint8_t packet[128];
+
+    int16_t expected_len = sn_coap_builder(expected, &msg);
+    ASSERT_GT(expected_len, 0);
+    EXPECT_EQ(expected_len, sn_coap_builder_3(packet, sizeof(packet), &msg));
+    EXPECT_EQ(0, memcmp(expected, packet, expected_len));
+}
+
+TEST_F(TestSnCoapArena, builder_destination_too_small)
+{
+    uint8_t packet[128];
+    int16_t len = sn_coap_builder(packet, &msg);
+    ASSERT_GT(len, 0);
+
+    for (int16_t size = 0; size < len; ++size) {
+        uint8_t *small = (uint8_t *)malloc(size ? size : 1);
+        EXPECT_EQ(-1, sn_coap_builder_3(small, size, &msg)) << size;
+        free(small);
+    }
+
+    EXPECT_EQ(-2, sn_coap_builder_3(NULL, sizeof(packet), &msg));
+}
+
+TEST_F(TestSnCoapArena, builder_rejects_invalid_message)
+{
+    uint8_t packet[128];
+
+    /* ETag options are 1-8 bytes long */
+    uint8_t etag[9] = { 0 };
+    options.etag_ptr = etag;
+    options.etag_len = sizeof(etag);
+    EXPECT_EQ(0, sn_coap_builder_calc_needed_packet_data_size(&msg));
+    EXPECT_EQ(-1, sn_coap_builder_3(packet, sizeof(packet), &msg));
+
+    options.etag_ptr = NULL;
+    options.observe = 0x1000000;
+    EXPECT_EQ(0, sn_coap_builder_calc_needed_packet_data_size(&msg));
+    EXPECT_EQ(-1, sn_coap_builder_3(packet, sizeof(packet), &msg));
+}
+
+TEST_F(TestSnCoapArena, parse_into_arena)
+{
+    uint8_t packet[128];
+    int16_t len = build(packet);
+    ASSERT_GT(len, 0);
+
+    uint8_t arena[SN_COAP_PARSER_ARENA_SIZE(sizeof(packet))];
+    coap_version_e version;
+    sn_coap_hdr_s *parsed = sn_coap_parser_arena(len, packet, &version, arena, sizeof(arena));
+    expect_parsed(parsed);
+    EXPECT_EQ(COAP_VERSION_1, version);
+    EXPECT_EQ(0U, allocations);
+
+    /* single options are not copied */
+    EXPECT_TRUE(parsed->token_ptr >= packet && parsed->token_ptr < packet + len);
+    EXPECT_TRUE(parsed->options_list_ptr->uri_host_ptr >= packet && parsed->options_list_ptr->uri_host_ptr < packet + len);
+    EXPECT_TRUE(parsed->uri_path_ptr >= arena && parsed->uri_path_ptr < arena + sizeof(arena));
+}
+
+TEST_F(TestSnCoapArena, parse_into_heap_unchanged)
+{
+    uint8_t packet[128];
+    int16_t len = build(packet);
+    ASSERT_GT(len, 0);
+
+    coap_version_e version;
+    sn_coap_hdr_s *parsed = sn_coap_parser(&handle, len, packet, &version);
+    expect_parsed(parsed);
+    /* message, options, token, uri host, uri path and uri query */
+    EXPECT_EQ(6U, allocations);
+    sn_coap_parser_release_allocated_coap_msg_mem(&handle, parsed);
+}
+
+TEST_F(TestSnCoapArena, arena_too_small)
+{
+    uint8_t packet[128];
+    int16_t len = build(packet);
+    ASSERT_GT(len, 0);
+
+    uint8_t arena[SN_COAP_PARSER_ARENA_SIZE(sizeof(packet))];
+    coap_version_e version;
+    EXPECT_TRUE(sn_coap_parser_arena(len, packet, &version, arena, sizeof(sn_coap_hdr_s) - 1) == NULL);
+
+    /* options do not fit, the message reports the error */
+    sn_coap_hdr_s *parsed = sn_coap_parser_arena(len, packet, &version, arena, sizeof(sn_coap_hdr_s) + SN_COAP_PARSER_ARENA_ALIGN);
+    ASSERT_TRUE(parsed != NULL);
+    EXPECT_EQ(COAP_STATUS_PARSER_ERROR_IN_HEADER, parsed->coap_status);
+
+    EXPECT_TRUE(sn_coap_parser_arena(len, packet, &version, NULL, sizeof(arena)) == NULL);
+}
+
+TEST_F(TestSnCoapArena, benchmark)
+{
+    uint8_t packet[128];
+    uint8_t arena[SN_COAP_PARSER_ARENA_SIZE(sizeof(packet))];
+    coap_version_e version;
+    int16_t len = build(packet);
+    ASSERT_GT(len, 0);
+
+    bench_time_t start = bench_now();
+    for (int i = 0; i < BENCHMARK_ROUNDS; ++i) {
+        sn_coap_hdr_s *parsed = sn_coap_parser(&handle, len, packet, &version);
+        sn_coap_parser_release_allocated_coap_msg_mem(&handle, parsed);
+    }
+    uint32_t heap_ns = bench_ns_since(start) / BENCHMARK_ROUNDS;
+    uint32_t heap_allocations = allocations / BENCHMARK_ROUNDS;
+
+    allocations = 0;
+    start = bench_now();
+    for (int i = 0; i < BENCHMARK_ROUNDS; ++i) {
+        ASSERT_TRUE(sn_coap_parser_arena(len, packet, &version, arena, sizeof(arena)) != NULL);
+    }
+    uint32_t arena_ns = bench_ns_since(start) / BENCHMARK_ROUNDS;
+    EXPECT_EQ(0U, allocations);
+
+    start = bench_now();
+    for (int i = 0; i < BENCHMARK_ROUNDS; ++i) {
+        uint16_t size = sn_coap_builder_calc_needed_packet_data_size(&msg);
+        ASSERT_EQ(len, sn_coap_builder_2(packet, &msg, size));
+    }
+    uint32_t two_pass_build_ns = bench_ns_since(start) / BENCHMARK_ROUNDS;
+
+    start = bench_now();
+    for (int i = 0; i < BENCHMARK_ROUNDS; ++i) {
+        ASSERT_EQ(len, sn_coap_builder_3(packet, sizeof(packet), &msg));
+    }
+    uint32_t single_pass_build_ns = bench_ns_since(start) / BENCHMARK_ROUNDS;
+
+    bench_report("heap_parse_allocations", heap_allocations, "allocations");
+    bench_report("heap_parse_ns", heap_ns, "ns");
+    bench_report("arena_parse_ns", arena_ns, "ns");
+    bench_report("two_pass_build_ns", two_pass_build_ns, "ns");
+    bench_report("single_pass_build_ns", single_pass_build_ns, "ns");
+}
@@ -0,0 +1,19 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  ../features/frameworks/mbed-coap
+  ../features/frameworks/mbed-coap/source/include
+)
+
+set(unittest-sources
+  ../features/frameworks/mbed-coap/source/sn_coap_parser.c
+  ../features/frameworks/mbed-coap/source/sn_coap_builder.c
+  ../features/frameworks/mbed-coap/source/sn_coap_header_check.c
+)
+
+set(unittest-test-sources
+  features/frameworks/mbed-coap/sn_coap_arena/test_sn_coap_arena.cpp
+)
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "mbed-coap/sn_coap_header.h"
+#include "mbed-coap/sn_coap_protocol.h"
+#include "sn_coap_protocol_internal.h"
+#include "bench_timer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIENTS 4096
+#define UPLOADERS 1024
+#define BLOCKS 3
+#define BLOCK_SIZE 16
+
+/* resending times without randomisation */
+extern "C" {
+void randLIB_seed_random(void)
+{
+}
+
+uint16_t randLIB_get_16bit(void)
+{
+    return 1;
+}
+
+uint16_t randLIB_get_random_in_range(uint16_t min, uint16_t max)
+{
+    return min;
+}
+}
+
+static uint32_t transmissions;
+static uint32_t failures;
+
+static void *protocol_malloc(uint16_t size)
+{
+    return malloc(size);
+}
+
+static void protocol_free(void *ptr)
+{
+    free(ptr);
+}
+
+static uint8_t tx_callback(uint8_t *, uint16_t, sn_nsdl_addr_s *, void *)
+{
+    transmissions++;
+    return 1;
+}
+
+static int8_t rx_callback(sn_coap_hdr_s *msg, sn_nsdl_addr_s *, void *)
+{
+    if (msg->coap_status == COAP_STATUS_BUILDER_MESSAGE_SENDING_FAILED) {
+        failures++;
+    }
+    return 0;
+}
+
+class TestSnCoapLookup : public testing::Test {
+protected:
+    void SetUp()
+    {
+        transmissions = 0;
+        failures = 0;
+        handle = sn_coap_protocol_init(protocol_malloc, protocol_free, tx_callback, rx_callback);
+        ASSERT_TRUE(handle != NULL);
+    }
+
+    void TearDown()
+    {
+        sn_coap_protocol_destroy(handle);
+    }
+
+    /* a distinct IPv6 address and port per client */
+    void client(uint32_t index, sn_nsdl_addr_s &addr)
+    {
+        memset(&addr, 0, sizeof(addr));
+        memset(addresses[index], 0, sizeof(addresses[index]));
+        addresses[index][0] = 0xfd;
+        addresses[index][14] = index >> 8;
+        addresses[index][15] = index;
+        addr.type = SN_NSDL_ADDRESS_TYPE_IPV6;
+        addr.addr_ptr = addresses[index];
+        addr.addr_len = sizeof(addresses[index]);
+        addr.port = 49152 + (index % 16);
+    }
+
+    void message(sn_coap_msg_type_e type, uint16_t msg_id, sn_coap_msg_code_e code = COAP_MSG_CODE_REQUEST_PUT)
+    {
+        sn_coap_parser_init_message(&msg);
+        msg.msg_type = type;
+        msg.msg_code = code;
+        msg.msg_id = msg_id;
+        msg.uri_path_ptr = (uint8_t *)"3/0/13";
+        msg.uri_path_len = strlen("3/0/13");
+    }
+
+    /* parse a message received from a client, return its status */
+    sn_coap_status_e receive(uint32_t index, uint16_t port_offset = 0)
+    {
+        uint8_t packet[128];
+        int16_t len = sn_coap_builder(packet, &msg);
+        EXPECT_GT(len, 0);
+
+        sn_nsdl_addr_s addr;
+        client(index, addr);
+        addr.port += port_offset;
+        sn_coap_hdr_s *parsed = sn_coap_protocol_parse(handle, &addr, len, packet, NULL);
+        EXPECT_TRUE(parsed != NULL);
+        if (!parsed) {
+            return COAP_STATUS_PARSER_ERROR_IN_HEADER;
+        }
+
+        sn_coap_status_e status = parsed->coap_status;
+        if (status == COAP_STATUS_PARSER_BLOCKWISE_MSG_RECEIVED) {
+            received_len = parsed->payload_len;
+            memcpy(received, parsed->payload_ptr, parsed->payload_len);
+            handle->sn_coap_protocol_free(parsed->payload_ptr);
+            parsed->payload_ptr = NULL;
+        }
+        sn_coap_parser_release_allocated_coap_msg_mem(handle, parsed);
+        return status;
+    }
+
+    int16_t send(uint32_t index)
+    {
+        uint8_t packet[128];
+        sn_nsdl_addr_s addr;
+        client(index, addr);
+        return sn_coap_protocol_build(handle, &addr, packet, &msg, NULL);
+    }
+
+    struct coap_s *handle;
+    sn_coap_hdr_s msg;
+    uint8_t addresses[CLIENTS][16];
+    uint8_t received[BLOCKS * BLOCK_SIZE];
+    uint16_t received_len;
+};
+
+TEST_F(TestSnCoapLookup, duplicates_of_thousands_of_clients)
+{
+    /* clients pick their message IDs independently, many collide */
+    for (uint32_t i = 0; i < CLIENTS; ++i) {
+        message(COAP_MSG_TYPE_CONFIRMABLE, 0x100 + (i % 64));
+        ASSERT_EQ(COAP_STATUS_OK, receive(i)) << i;
+    }
+    EXPECT_EQ(CLIENTS, handle->count_duplication_msgs);
+
+    bench_time_t start = bench_now();
+    for (uint32_t i = 0; i < CLIENTS; ++i) {
+        message(COAP_MSG_TYPE_CONFIRMABLE, 0x100 + (i % 64));
+        ASSERT_EQ(COAP_STATUS_PARSER_DUPLICATED_MSG, receive(i)) << i;
+    }
+    bench_report("duplicate_parse_ns", bench_ns_since(start) / CLIENTS, "ns");
+
+    /* same message ID from another port of the same host is not a duplicate */
+    message(COAP_MSG_TYPE_CONFIRMABLE, 0x100);
+    EXPECT_EQ(COAP_STATUS_OK, receive(0, 1));
+    EXPECT_EQ(CLIENTS, handle->count_duplication_msgs);
+}
+
+TEST_F(TestSnCoapLookup, duplicates_expire_in_order)
+{
+    sn_coap_protocol_exec(handle, 0);
+    for (uint32_t i = 0; i < CLIENTS / 2; ++i) {
+        message(COAP_MSG_TYPE_NON_CONFIRMABLE, i);
+        ASSERT_EQ(COAP_STATUS_OK, receive(i));
+    }
+
+    sn_coap_protocol_exec(handle, 30);
+    for (uint32_t i = CLIENTS / 2; i < CLIENTS; ++i) {
+        message(COAP_MSG_TYPE_NON_CONFIRMABLE, i);
+        ASSERT_EQ(COAP_STATUS_OK, receive(i));
+    }
+
+    sn_coap_protocol_exec(handle, 61);
+    EXPECT_EQ(CLIENTS / 2, handle->count_duplication_msgs);
+    message(COAP_MSG_TYPE_NON_CONFIRMABLE, 0);
+    EXPECT_EQ(COAP_STATUS_OK, receive(0));
+    message(COAP_MSG_TYPE_NON_CONFIRMABLE, CLIENTS - 1);
+    EXPECT_EQ(COAP_STATUS_PARSER_DUPLICATED_MSG, receive(CLIENTS - 1));
+
+    sn_coap_protocol_exec(handle, 200);
+    EXPECT_EQ(0, handle->count_duplication_msgs);
+}
+
+TEST_F(TestSnCoapLookup, acknowledgements_of_thousands_of_notifications)
+{
+    for (uint32_t i = 0; i < CLIENTS; ++i) {
+        message(COAP_MSG_TYPE_CONFIRMABLE, i + 1, COAP_MSG_CODE_RESPONSE_CONTENT);
+        ASSERT_GT(send(i), 0) << i;
+    }
+    EXPECT_EQ(CLIENTS, handle->count_resent_msgs);
+
+    /* acknowledgement from another endpoint is ignored */
+    message(COAP_MSG_TYPE_ACKNOWLEDGEMENT, 1, COAP_MSG_CODE_EMPTY);
+    receive(0, 1);
+    EXPECT_EQ(CLIENTS, handle->count_resent_msgs);
+
+    bench_time_t start = bench_now();
+    for (uint32_t i = 0; i < CLIENTS; ++i) {
+        message(COAP_MSG_TYPE_ACKNOWLEDGEMENT, i + 1, COAP_MSG_CODE_EMPTY);
+        receive(i);
+    }
+    bench_report("acknowledgement_parse_ns", bench_ns_since(start) / CLIENTS, "ns");
+
+    EXPECT_EQ(0, handle->count_resent_msgs);
+    EXPECT_EQ(0U, handle->size_resent_msgs);
+    EXPECT_TRUE(ns_list_is_empty(&handle->linked_list_resent_msgs));
+}
+
+TEST_F(TestSnCoapLookup, resends_visit_due_messages)
+{
+    /* first half is due at 10, second half at 15 */
+    sn_coap_protocol_exec(handle, 0);
+    for (uint32_t i = 0; i < CLIENTS / 2; ++i) {
+        message(COAP_MSG_TYPE_CONFIRMABLE, i + 1, COAP_MSG_CODE_RESPONSE_CONTENT);
+        ASSERT_GT(send(i), 0);
+    }
+    sn_coap_protocol_exec(handle, 5);
+    for (uint32_t i = CLIENTS / 2; i < CLIENTS; ++i) {
+        message(COAP_MSG_TYPE_CONFIRMABLE, i + 1, COAP_MSG_CODE_RESPONSE_CONTENT);
+        ASSERT_GT(send(i), 0);
+    }
+
+    bench_time_t start = bench_now();
+    for (uint32_t time = 6; time < 10; ++time) {
+        sn_coap_protocol_exec(handle, time);
+    }
+    bench_report("idle_exec_ns", bench_ns_since(start) / 4, "ns");
+    EXPECT_EQ(0U, transmissions);
+
+    sn_coap_protocol_exec(handle, 10);
+    EXPECT_EQ(CLIENTS / 2U, transmissions);
+    sn_coap_protocol_exec(handle, 15);
+    EXPECT_EQ(CLIENTS + 0U, transmissions);
+
+    /* list stays in order of resending time */
+    uint32_t previous = 0;
+    ns_list_foreach(coap_send_msg_s, stored, &handle->linked_list_resent_msgs) {
+        EXPECT_LE(previous, stored->resending_time);
+        previous = stored->resending_time;
+    }
+
+    /* third and fourth attempts, then all fail */
+    sn_coap_protocol_exec(handle, 1000);
+    sn_coap_protocol_exec(handle, 2000);
+    EXPECT_EQ(3U * CLIENTS, transmissions);
+    EXPECT_EQ(0U, failures);
+    sn_coap_protocol_exec(handle, 3000);
+    EXPECT_EQ(CLIENTS + 0U, failures);
+    EXPECT_EQ(0, handle->count_resent_msgs);
+}
+
+TEST_F(TestSnCoapLookup, blockwise_uploads_of_thousands_of_clients)
+{
+    sn_coap_options_list_s options;
+    uint8_t token[4];
+    uint8_t payload[BLOCK_SIZE];
+
+    bench_time_t start = bench_now();
+    for (uint32_t block = 0; block < BLOCKS; ++block) {
+        for (uint32_t i = 0; i < UPLOADERS; ++i) {
+            message(COAP_MSG_TYPE_CONFIRMABLE, block * UPLOADERS + i + 1);
+            memset(&options, 0, sizeof(options));
+            options.uri_port = COAP_OPTION_URI_PORT_NONE;
+            options.observe = COAP_OBSERVE_NONE;
+            options.accept = COAP_CT_NONE;
+            options.block2 = COAP_OPTION_BLOCK_NONE;
+            /* 16 byte blocks */
+            options.block1 = (block << 4) | (block < BLOCKS - 1 ? 0x08 : 0);
+            msg.options_list_ptr = &options;
+
+            token[0] = 0x5a;
+            token[1] = i >> 8;
+            token[2] = i;
+            token[3] = 0xa5;
+            msg.token_ptr = token;
+            msg.token_len = sizeof(token);
+
+            memset(payload, (uint8_t)(i + block), sizeof(payload));
+            msg.payload_ptr = payload;
+            msg.payload_len = sizeof(payload);
+
+            if (block < BLOCKS - 1) {
+                ASSERT_EQ(COAP_STATUS_PARSER_BLOCKWISE_MSG_RECEIVING, receive(i)) << i;
+                continue;
+            }
+
+            ASSERT_EQ(COAP_STATUS_PARSER_BLOCKWISE_MSG_RECEIVED, receive(i)) << i;
+            ASSERT_EQ(BLOCKS * BLOCK_SIZE, received_len);
+            for (uint32_t j = 0; j < BLOCKS; ++j) {
+                for (uint32_t k = 0; k < BLOCK_SIZE; ++k) {
+                    ASSERT_EQ((uint8_t)(i + j), received[j * BLOCK_SIZE + k]) << i;
+                }
+            }
+        }
+    }
+    bench_report("block_parse_ns", bench_ns_since(start) / (BLOCKS * UPLOADERS), "ns");
+
+    /* an acknowledgement of each non final block */
+    EXPECT_EQ((BLOCKS - 1U) * UPLOADERS, transmissions);
+    EXPECT_TRUE(ns_list_is_empty(&handle->linked_list_blockwise_received_payloads));
+}
@@ -0,0 +1,26 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  ../features/frameworks/mbed-coap
+  ../features/frameworks/mbed-coap/source/include
+)
+
+set(unittest-sources
+  ../features/frameworks/mbed-coap/source/sn_coap_protocol.c
+  ../features/frameworks/mbed-coap/source/sn_coap_parser.c
+  ../features/frameworks/mbed-coap/source/sn_coap_builder.c
+  ../features/frameworks/mbed-coap/source/sn_coap_header_check.c
+  ../features/frameworks/nanostack-libservice/source/libList/ns_list.c
+)
+
+set(unittest-test-sources
+  features/frameworks/mbed-coap/sn_coap_lookup/test_sn_coap_lookup.cpp
+)
+
+# a server keeping thousands of exchanges in flight
+set(COAP_SERVER_FLAGS "-DMBED_CONF_MBED_CLIENT_SN_COAP_DUPLICATION_MAX_MSGS_COUNT=4096 -DMBED_CONF_MBED_CLIENT_SN_COAP_RESENDING_QUEUE_SIZE_MSGS=4096 -DMBED_CONF_MBED_CLIENT_SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE=64 -DMBED_CONF_MBED_CLIENT_SN_COAP_LOOKUP_INDEX_SIZE=1024")
+set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${COAP_SERVER_FLAGS}")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${COAP_SERVER_FLAGS}")
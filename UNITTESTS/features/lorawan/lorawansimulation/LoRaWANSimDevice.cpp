@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "LoRaWANSimDevice.h"
+
+#define BUSY_RETRY_DELAY    1000
+#define APP_PORT            15
+
+LoRaWANSimDevice::LoRaWANSimDevice(LoRaWANSimAir &air, uint32_t id, int8_t snr)
+    : connected(false),
+      connected_at(0),
+      join_failures(0),
+      uplinks_requested(0),
+      would_block(0),
+      tx_done(0),
+      tx_errors(0),
+      rx_done(0),
+      max_backoff(0),
+      total_tx_delay(0),
+      _radio(air, (id + 1) * 2654435761u, snr),
+      _queue(air.queue()),
+      _seed((id + 1) * 40503u),
+      _running(false),
+      _interval(0),
+      _payload_size(0),
+      _flags(MSG_UNCONFIRMED_FLAG),
+      _join_trials(0),
+      _requested_at(0),
+      _uplink_event(0)
+{
+    const uint8_t app_eui[8] = {0x70, 0xB3, 0xD5, 0x7E, 0xD0, 0x00, 0x00, 0x01};
+
+    memcpy(_app_eui, app_eui, sizeof(_app_eui));
+
+    _dev_eui[0] = 0x00;
+    _dev_eui[1] = 0x80;
+    _dev_eui[2] = 0x00;
+    _dev_eui[3] = 0x00;
+    _dev_eui[4] = (id >> 24) & 0xFF;
+    _dev_eui[5] = (id >> 16) & 0xFF;
+    _dev_eui[6] = (id >> 8) & 0xFF;
+    _dev_eui[7] = id & 0xFF;
+
+    // keys must differ between all devices, a device accepts any join
+    // accept it can decrypt
+    for (uint8_t i = 0; i < sizeof(_app_key); i++) {
+        _app_key[i] = (uint8_t)((id >> (8 * (i % 4))) + i * 17 + 0x2B);
+    }
+
+    _stack.bind_phy_and_radio_driver(_radio, _phy);
+    _stack.initialize_mac_layer(&_queue);
+
+    _callbacks.events = mbed::callback(this, &LoRaWANSimDevice::on_event);
+    _stack.set_lora_callbacks(&_callbacks);
+}
+
+LoRaWANSimDevice::~LoRaWANSimDevice()
+{
+    stop();
+}
+
+lorawan_status_t LoRaWANSimDevice::start(unsigned interval, uint8_t payload_size,
+                                         uint8_t flags, uint8_t join_trials)
+{
+    _interval = interval;
+    _payload_size = payload_size;
+    _flags = flags;
+    _join_trials = join_trials;
+    _running = true;
+
+    if (connected) {
+        schedule_uplink(jitter(_interval));
+        return LORAWAN_STATUS_OK;
+    }
+
+    // spread the join requests of a fleet powered up at the same time
+    _uplink_event = _queue.call_in(jitter(_interval), this, &LoRaWANSimDevice::connect);
+    return _uplink_event ? LORAWAN_STATUS_OK : LORAWAN_STATUS_BUSY;
+}
+
+void LoRaWANSimDevice::stop()
+{
+    _running = false;
+    if (_uplink_event) {
+        _queue.cancel(_uplink_event);
+        _uplink_event = 0;
+    }
+}
+
+void LoRaWANSimDevice::connect()
+{
+    lorawan_connect_t params;
+
+    _uplink_event = 0;
+    if (!_running) {
+        return;
+    }
+
+    params.connect_type = LORAWAN_CONNECTION_OTAA;
+    params.connection_u.otaa.dev_eui = _dev_eui;
+    params.connection_u.otaa.app_eui = _app_eui;
+    params.connection_u.otaa.app_key = _app_key;
+    params.connection_u.otaa.nb_trials = _join_trials;
+
+    lorawan_status_t status = _stack.connect(params);
+    if (status != LORAWAN_STATUS_OK && status != LORAWAN_STATUS_CONNECT_IN_PROGRESS) {
+        _uplink_event = _queue.call_in(BUSY_RETRY_DELAY, this, &LoRaWANSimDevice::connect);
+    }
+}
+
+void LoRaWANSimDevice::send_uplink()
+{
+    uint8_t payload[255];
+
+    _uplink_event = 0;
+    if (!_running) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < _payload_size; i++) {
+        payload[i] = (uint8_t)(uplinks_requested + i);
+    }
+
+    _requested_at = _queue.tick();
+    int16_t ret = _stack.handle_tx(APP_PORT, payload, _payload_size, _flags);
+
+    if (ret == LORAWAN_STATUS_WOULD_BLOCK) {
+        would_block++;
+        schedule_uplink(BUSY_RETRY_DELAY);
+        return;
+    }
+
+    if (ret < 0) {
+        tx_errors++;
+        schedule_uplink(_interval + jitter(_interval / 10));
+        return;
+    }
+
+    uplinks_requested++;
+
+    int backoff;
+    if (_stack.acquire_backoff_metadata(backoff) == LORAWAN_STATUS_OK && backoff > max_backoff) {
+        max_backoff = backoff;
+    }
+}
+
+void LoRaWANSimDevice::schedule_uplink(unsigned delay)
+{
+    if (!_running) {
+        return;
+    }
+
+    _uplink_event = _queue.call_in(delay, this, &LoRaWANSimDevice::send_uplink);
+}
+
+uint32_t LoRaWANSimDevice::jitter(uint32_t max)
+{
+    // xorshift32
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+
+    return max ? _seed % max : 0;
+}
+
+void LoRaWANSimDevice::on_event(lorawan_event_t event)
+{
+    switch (event) {
+        case CONNECTED:
+            connected = true;
+            connected_at = _queue.tick();
+            schedule_uplink(jitter(_interval));
+            break;
+        case JOIN_FAILURE:
+            join_failures++;
+            _uplink_event = _queue.call(this, &LoRaWANSimDevice::connect);
+            break;
+        case TX_DONE:
+            tx_done++;
+            total_tx_delay += _radio.last_tx_start() - _requested_at;
+            schedule_uplink(_interval + jitter(_interval / 10));
+            break;
+        case TX_TIMEOUT:
+        case TX_ERROR:
+        case TX_SCHEDULING_ERROR:
+        case CRYPTO_ERROR:
+            tx_errors++;
+            schedule_uplink(_interval + jitter(_interval / 10));
+            break;
+        case RX_DONE:
+            rx_done++;
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LORAWAN_SIM_DEVICE_H_
+#define LORAWAN_SIM_DEVICE_H_
+
+#include <stdint.h>
+
+#include "LoRaWANStack.h"
+#include "LoRaPHYEU868.h"
+#include "LoRaWANSimRadio.h"
+
+/** An EU868 class A end device running the real LoRaWANStack
+ *
+ * Once started the device joins with OTAA and then sends an uplink every
+ * 'interval' ms plus a random jitter of up to a tenth of the interval.
+ * Failed joins are retried right away, uplinks the stack refuses because
+ * it is busy are retried after a second.
+ */
+class LoRaWANSimDevice {
+public:
+    /** Create a device
+     *
+     * @param air   Medium shared with the gateway
+     * @param id    Unique identifier the keys and the DevEUI are derived from
+     * @param snr   Link budget towards the gateway in dB
+     */
+    LoRaWANSimDevice(LoRaWANSimAir &air, uint32_t id, int8_t snr);
+
+    ~LoRaWANSimDevice();
+
+    /** Join the network and start sending uplinks
+     *
+     * @param interval      Time between two uplinks in ms
+     * @param payload_size  Application payload size of every uplink
+     * @param flags         MSG_UNCONFIRMED_FLAG or MSG_CONFIRMED_FLAG
+     * @param join_trials   Number of join requests per connect()
+     */
+    lorawan_status_t start(unsigned interval, uint8_t payload_size,
+                           uint8_t flags = MSG_UNCONFIRMED_FLAG,
+                           uint8_t join_trials = 8);
+
+    /** Stop sending uplinks, an ongoing transmission is not aborted */
+    void stop();
+
+    const uint8_t *dev_eui() const
+    {
+        return _dev_eui;
+    }
+
+    const uint8_t *app_eui() const
+    {
+        return _app_eui;
+    }
+
+    const uint8_t *app_key() const
+    {
+        return _app_key;
+    }
+
+    LoRaWANStack &stack()
+    {
+        return _stack;
+    }
+
+    LoRaWANSimRadio &radio()
+    {
+        return _radio;
+    }
+
+    bool connected;
+    unsigned connected_at;
+    uint32_t join_failures;
+    uint32_t uplinks_requested;
+    uint32_t would_block;
+    uint32_t tx_done;
+    uint32_t tx_errors;
+    uint32_t rx_done;
+    /** Longest backoff reported by the stack while sending, in ms */
+    int max_backoff;
+    /** Sum of the time between handing an uplink to the stack and the start
+     *  of the transmission that completed it, in ms */
+    uint64_t total_tx_delay;
+
+private:
+    void on_event(lorawan_event_t event);
+    void connect();
+    void send_uplink();
+    void schedule_uplink(unsigned delay);
+    uint32_t jitter(uint32_t max);
+
+    LoRaWANSimRadio _radio;
+    LoRaPHYEU868 _phy;
+    LoRaWANStack _stack;
+    events::EventQueue &_queue;
+    lorawan_app_callbacks_t _callbacks;
+    uint8_t _dev_eui[8];
+    uint8_t _app_eui[8];
+    uint8_t _app_key[16];
+    uint32_t _seed;
+    bool _running;
+    unsigned _interval;
+    uint8_t _payload_size;
+    uint8_t _flags;
+    uint8_t _join_trials;
+    unsigned _requested_at;
+    int _uplink_event;
+};
+
+#endif /* LORAWAN_SIM_DEVICE_H_ */
@@ -0,0 +1,576 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "LoRaWANSimNetworkServer.h"
+#include "mbedtls/aes.h"
+
+#define NET_ID                      0x000013
+#define NWK_ADDR_MASK               0x01FFFFFF
+
+#define MTYPE_JOIN_REQUEST          0x00
+#define MTYPE_JOIN_ACCEPT           0x01
+#define MTYPE_UNCONFIRMED_UP        0x02
+#define MTYPE_UNCONFIRMED_DOWN      0x03
+#define MTYPE_CONFIRMED_UP          0x04
+
+#define FCTRL_ADR                   0x80
+#define FCTRL_ADR_ACK_REQ           0x40
+#define FCTRL_ACK                   0x20
+#define FCTRL_FOPTS_LEN_MASK        0x0F
+
+#define JOIN_REQUEST_SIZE           23
+#define MIC_SIZE                    4
+#define UP_LINK                     0
+#define DOWN_LINK                   1
+
+#define EU868_RX1_DELAY             1000
+#define EU868_JOIN_ACCEPT_DELAY1    5000
+#define RX2_DELAY_AFTER_RX1         1000
+#define EU868_RX2_FREQUENCY         869525000
+#define EU868_RX2_SF                12
+#define EU868_MAX_DATARATE          5
+#define EU868_MAX_TX_POWER_INDEX    5
+#define DOWNLINK_PREAMBLE_LENGTH    8
+
+// dB kept in reserve by the ADR algorithm, as in the Semtech network server
+#define ADR_INSTALLATION_MARGIN     10
+#define ADR_STEP_DB                 3
+
+static uint64_t eui_key(const uint8_t *eui)
+{
+    uint64_t key = 0;
+    for (int i = 0; i < 8; i++) {
+        key = (key << 8) | eui[i];
+    }
+    return key;
+}
+
+static uint32_t read_le32(const uint8_t *buf)
+{
+    return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8)
+           | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static void write_le32(uint8_t *buf, uint32_t value)
+{
+    buf[0] = value & 0xFF;
+    buf[1] = (value >> 8) & 0xFF;
+    buf[2] = (value >> 16) & 0xFF;
+    buf[3] = (value >> 24) & 0xFF;
+}
+
+static uint8_t sf_of(uint8_t datarate)
+{
+    return 12 - datarate;
+}
+
+LoRaWANSimNetworkServer::LoRaWANSimNetworkServer(LoRaWANSimAir &air)
+    : join_requests(0),
+      join_accepts(0),
+      join_replays(0),
+      uplinks(0),
+      confirmed_uplinks(0),
+      duplicates(0),
+      mic_failures(0),
+      unknown_devices(0),
+      downlinks(0),
+      downlinks_dropped(0),
+      adr_requests(0),
+      adr_answers(0),
+      _air(air),
+      _adr_enabled(true),
+      _adr_history(LORAWAN_SIM_ADR_HISTORY_MAX),
+      _cf_list(true),
+      _app_nonce(1)
+{
+    _air.set_uplink_handler(this);
+}
+
+LoRaWANSimNetworkServer::~LoRaWANSimNetworkServer()
+{
+    _air.set_uplink_handler(NULL);
+}
+
+void LoRaWANSimNetworkServer::add_device(const uint8_t *dev_eui, const uint8_t *app_eui,
+                                         const uint8_t *app_key)
+{
+    lorawan_sim_node_t node;
+    memset(node.snr_history, 0, sizeof(node.snr_history));
+    memcpy(node.dev_eui, dev_eui, sizeof(node.dev_eui));
+    memcpy(node.app_eui, app_eui, sizeof(node.app_eui));
+    memcpy(node.app_key, app_key, sizeof(node.app_key));
+    node.joined = false;
+    node.dev_addr = 0;
+    memset(node.nwk_skey, 0, sizeof(node.nwk_skey));
+    memset(node.app_skey, 0, sizeof(node.app_skey));
+    node.fcnt_up_valid = false;
+    node.fcnt_up = 0;
+    node.fcnt_down = 0;
+    node.datarate = 0;
+    node.tx_power = 0;
+    node.snr_count = 0;
+    node.snr_pos = 0;
+    node.adr_requested = false;
+    node.adr_datarate = 0;
+    node.adr_tx_power = 0;
+    node.join_requests = 0;
+    node.uplinks = 0;
+    node.duplicates = 0;
+    node.joined_at = 0;
+    node.last_uplink_at = 0;
+
+    _by_dev_eui[eui_key(dev_eui)] = _nodes.size();
+    _nodes.push_back(node);
+}
+
+void LoRaWANSimNetworkServer::enable_adr(bool enable)
+{
+    _adr_enabled = enable;
+}
+
+void LoRaWANSimNetworkServer::set_adr_history(uint8_t length)
+{
+    if (length == 0 || length > LORAWAN_SIM_ADR_HISTORY_MAX) {
+        length = LORAWAN_SIM_ADR_HISTORY_MAX;
+    }
+    _adr_history = length;
+}
+
+void LoRaWANSimNetworkServer::enable_cf_list(bool enable)
+{
+    _cf_list = enable;
+}
+
+const lorawan_sim_node_t *LoRaWANSimNetworkServer::find_device(const uint8_t *dev_eui) const
+{
+    std::map<uint64_t, size_t>::const_iterator it = _by_dev_eui.find(eui_key(dev_eui));
+    if (it == _by_dev_eui.end()) {
+        return NULL;
+    }
+    return &_nodes[it->second];
+}
+
+uint8_t LoRaWANSimNetworkServer::datarate_of(uint8_t sf, uint8_t bandwidth)
+{
+    // EU868: DR0..DR5 are SF12..SF7 at 125 kHz, DR6 is SF7 at 250 kHz
+    if (bandwidth == 1) {
+        return 6;
+    }
+    return 12 - sf;
+}
+
+void LoRaWANSimNetworkServer::on_uplink(const lorawan_sim_frame_t &frame)
+{
+    if (frame.size == 0) {
+        return;
+    }
+
+    switch (frame.payload[0] >> 5) {
+        case MTYPE_JOIN_REQUEST:
+            handle_join_request(frame);
+            break;
+        case MTYPE_UNCONFIRMED_UP:
+        case MTYPE_CONFIRMED_UP:
+            handle_data_uplink(frame);
+            break;
+        default:
+            break;
+    }
+}
+
+void LoRaWANSimNetworkServer::handle_join_request(const lorawan_sim_frame_t &frame)
+{
+    const uint8_t *p = frame.payload;
+    uint8_t dev_eui[8];
+    uint32_t mic = 0;
+
+    join_requests++;
+
+    if (frame.size != JOIN_REQUEST_SIZE) {
+        return;
+    }
+
+    // EUIs are sent little endian
+    for (int i = 0; i < 8; i++) {
+        dev_eui[i] = p[16 - i];
+    }
+
+    std::map<uint64_t, size_t>::iterator it = _by_dev_eui.find(eui_key(dev_eui));
+    if (it == _by_dev_eui.end()) {
+        unknown_devices++;
+        return;
+    }
+
+    lorawan_sim_node_t &node = _nodes[it->second];
+
+    if (_crypto.compute_join_frame_mic(p, JOIN_REQUEST_SIZE - MIC_SIZE, node.app_key,
+                                       sizeof(node.app_key) * 8, &mic) != 0
+            || mic != read_le32(p + JOIN_REQUEST_SIZE - MIC_SIZE)) {
+        mic_failures++;
+        return;
+    }
+
+    const uint16_t dev_nonce = p[17] | (p[18] << 8);
+    for (size_t i = 0; i < node.dev_nonces.size(); i++) {
+        if (node.dev_nonces[i] == dev_nonce) {
+            join_replays++;
+            return;
+        }
+    }
+    node.dev_nonces.push_back(dev_nonce);
+    node.join_requests++;
+
+    uint8_t plain[33];
+    uint8_t len = 0;
+    const uint32_t dev_addr = ((uint32_t)(NET_ID & 0x7F) << 25) | (uint32_t)(it->second + 1);
+
+    plain[len++] = MTYPE_JOIN_ACCEPT << 5;
+    plain[len++] = _app_nonce & 0xFF;
+    plain[len++] = (_app_nonce >> 8) & 0xFF;
+    plain[len++] = (_app_nonce >> 16) & 0xFF;
+    plain[len++] = NET_ID & 0xFF;
+    plain[len++] = (NET_ID >> 8) & 0xFF;
+    plain[len++] = (NET_ID >> 16) & 0xFF;
+    write_le32(plain + len, dev_addr);
+    len += 4;
+    // DLSettings: RX1DROffset 0, RX2 at DR0
+    plain[len++] = 0x00;
+    // RxDelay 1 s
+    plain[len++] = 0x01;
+
+    if (_cf_list) {
+        for (uint32_t freq = 867100000; freq <= 867900000; freq += 200000) {
+            const uint32_t value = freq / 100;
+            plain[len++] = value & 0xFF;
+            plain[len++] = (value >> 8) & 0xFF;
+            plain[len++] = (value >> 16) & 0xFF;
+        }
+        plain[len++] = 0x00;
+    }
+
+    if (_crypto.compute_join_frame_mic(plain, len, node.app_key,
+                                       sizeof(node.app_key) * 8, &mic) != 0) {
+        return;
+    }
+    write_le32(plain + len, mic);
+    len += MIC_SIZE;
+
+    uint8_t nwk_skey[16];
+    uint8_t app_skey[16];
+    if (_crypto.compute_skeys_for_join_frame(node.app_key, sizeof(node.app_key) * 8,
+                                             plain + 1, dev_nonce,
+                                             nwk_skey, app_skey) != 0) {
+        return;
+    }
+
+    // The network server encrypts with an AES decrypt operation
+    uint8_t accept[33];
+    mbedtls_aes_context aes;
+    mbedtls_aes_init(&aes);
+    mbedtls_aes_setkey_dec(&aes, node.app_key, sizeof(node.app_key) * 8);
+    accept[0] = plain[0];
+    for (uint8_t i = 1; i < len; i += 16) {
+        mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_DECRYPT, plain + i, accept + i);
+    }
+    mbedtls_aes_free(&aes);
+
+    if (!send_downlink(frame, accept, len, EU868_JOIN_ACCEPT_DELAY1)) {
+        return;
+    }
+
+    _app_nonce++;
+    join_accepts++;
+
+    node.joined = true;
+    node.dev_addr = dev_addr;
+    memcpy(node.nwk_skey, nwk_skey, sizeof(node.nwk_skey));
+    memcpy(node.app_skey, app_skey, sizeof(node.app_skey));
+    node.fcnt_up_valid = false;
+    node.fcnt_up = 0;
+    node.fcnt_down = 0;
+    node.datarate = datarate_of(frame.sf, frame.bandwidth);
+    node.tx_power = 0;
+    node.snr_count = 0;
+    node.snr_pos = 0;
+    node.adr_requested = false;
+    node.joined_at = frame.end;
+}
+
+void LoRaWANSimNetworkServer::handle_data_uplink(const lorawan_sim_frame_t &frame)
+{
+    const uint8_t *p = frame.payload;
+    const uint8_t size = frame.size;
+    uint32_t mic = 0;
+
+    // MHDR, DevAddr, FCtrl, FCnt and MIC
+    if (size < 8 + MIC_SIZE) {
+        return;
+    }
+
+    const uint8_t mtype = p[0] >> 5;
+    const uint32_t dev_addr = read_le32(p + 1);
+    const size_t index = (dev_addr & NWK_ADDR_MASK) - 1;
+
+    if (index >= _nodes.size() || !_nodes[index].joined
+            || _nodes[index].dev_addr != dev_addr) {
+        unknown_devices++;
+        return;
+    }
+
+    lorawan_sim_node_t &node = _nodes[index];
+    const uint8_t fctrl = p[5];
+    const uint8_t fopts_len = fctrl & FCTRL_FOPTS_LEN_MASK;
+    const uint16_t fcnt16 = p[6] | (p[7] << 8);
+
+    if (8 + fopts_len + MIC_SIZE > size) {
+        return;
+    }
+
+    uint32_t fcnt = fcnt16;
+    if (node.fcnt_up_valid) {
+        fcnt = (node.fcnt_up & 0xFFFF0000) | fcnt16;
+        if (fcnt < node.fcnt_up) {
+            fcnt += 0x10000;
+        }
+    }
+
+    if (_crypto.compute_mic(p, size - MIC_SIZE, node.nwk_skey, sizeof(node.nwk_skey) * 8,
+                            dev_addr, UP_LINK, fcnt, &mic) != 0
+            || mic != read_le32(p + size - MIC_SIZE)) {
+        mic_failures++;
+        return;
+    }
+
+    const bool duplicate = node.fcnt_up_valid && fcnt == node.fcnt_up;
+    node.fcnt_up = fcnt;
+    node.fcnt_up_valid = true;
+    node.datarate = datarate_of(frame.sf, frame.bandwidth);
+    node.last_uplink_at = frame.end;
+
+    uplinks++;
+    node.uplinks++;
+    if (mtype == MTYPE_CONFIRMED_UP) {
+        confirmed_uplinks++;
+    }
+
+    bool link_check = false;
+    parse_mac_answers(node, p + 8, fopts_len, link_check);
+
+    const uint8_t payload_start = 8 + fopts_len;
+    if (size - MIC_SIZE > payload_start + 1 && p[payload_start] == 0) {
+        uint8_t commands[255];
+        const uint8_t len = size - MIC_SIZE - payload_start - 1;
+        if (_crypto.decrypt_payload(p + payload_start + 1, len, node.nwk_skey,
+                                    sizeof(node.nwk_skey) * 8, dev_addr, UP_LINK,
+                                    fcnt, commands) == 0) {
+            parse_mac_answers(node, commands, len, link_check);
+        }
+    }
+
+    bool adr = false;
+    if (duplicate) {
+        duplicates++;
+        node.duplicates++;
+    } else if (_adr_enabled && (fctrl & FCTRL_ADR)) {
+        adr = run_adr(node, frame.snr);
+    }
+
+    if (mtype != MTYPE_CONFIRMED_UP && !(fctrl & FCTRL_ADR_ACK_REQ) && !adr && !link_check) {
+        return;
+    }
+
+    uint8_t buf[32];
+    uint8_t len = 0;
+    uint8_t fopts = 0;
+
+    buf[len++] = MTYPE_UNCONFIRMED_DOWN << 5;
+    write_le32(buf + len, dev_addr);
+    len += 4;
+    buf[len++] = 0; // FCtrl, filled in below
+    buf[len++] = node.fcnt_down & 0xFF;
+    buf[len++] = (node.fcnt_down >> 8) & 0xFF;
+
+    if (link_check) {
+        const int margin = frame.snr - LoRaWANSimAir::required_snr(frame.sf);
+        buf[len++] = 0x02; // LinkCheckAns
+        buf[len++] = margin < 0 ? 0 : margin;
+        buf[len++] = 1;
+        fopts += 3;
+    }
+
+    if (adr) {
+        const uint16_t ch_mask = _cf_list ? 0x00FF : 0x0007;
+        buf[len++] = 0x03; // LinkADRReq
+        buf[len++] = (node.adr_datarate << 4) | node.adr_tx_power;
+        buf[len++] = ch_mask & 0xFF;
+        buf[len++] = (ch_mask >> 8) & 0xFF;
+        buf[len++] = 0x01; // ChMaskCntl 0, NbTrans 1
+        fopts += 5;
+    }
+
+    buf[5] = (_adr_enabled ? FCTRL_ADR : 0)
+             | (mtype == MTYPE_CONFIRMED_UP ? FCTRL_ACK : 0) | fopts;
+
+    if (_crypto.compute_mic(buf, len, node.nwk_skey, sizeof(node.nwk_skey) * 8,
+                            dev_addr, DOWN_LINK, node.fcnt_down, &mic) != 0) {
+        return;
+    }
+    write_le32(buf + len, mic);
+    len += MIC_SIZE;
+
+    if (send_downlink(frame, buf, len, EU868_RX1_DELAY)) {
+        node.fcnt_down++;
+        if (adr) {
+            adr_requests++;
+            node.adr_requested = true;
+        }
+    }
+}
+
+uint8_t LoRaWANSimNetworkServer::parse_mac_answers(lorawan_sim_node_t &node, const uint8_t *buf,
+                                                   uint8_t len, bool &link_check_requested)
+{
+    uint8_t i = 0;
+
+    while (i < len) {
+        switch (buf[i++]) {
+            case 0x02: // LinkCheckReq
+                link_check_requested = true;
+                break;
+            case 0x03: // LinkADRAns
+                adr_answers++;
+                if ((buf[i] & 0x07) == 0x07) {
+                    node.tx_power = node.adr_tx_power;
+                    node.adr_requested = false;
+                }
+                i += 1;
+                break;
+            case 0x04: // DutyCycleAns
+            case 0x08: // RXTimingSetupAns
+            case 0x09: // TxParamSetupAns
+                break;
+            case 0x05: // RXParamSetupAns
+            case 0x07: // NewChannelAns
+            case 0x0A: // DlChannelAns
+                i += 1;
+                break;
+            case 0x06: // DevStatusAns
+                i += 2;
+                break;
+            default:
+                // unknown command, the rest cannot be parsed
+                return i;
+        }
+    }
+
+    return i;
+}
+
+bool LoRaWANSimNetworkServer::run_adr(lorawan_sim_node_t &node, int8_t snr)
+{
+    node.snr_history[node.snr_pos] = snr;
+    node.snr_pos = (node.snr_pos + 1) % _adr_history;
+    if (node.snr_count < _adr_history) {
+        node.snr_count++;
+        return false;
+    }
+
+    int8_t max_snr = node.snr_history[0];
+    for (uint8_t i = 1; i < _adr_history; i++) {
+        if (node.snr_history[i] > max_snr) {
+            max_snr = node.snr_history[i];
+        }
+    }
+
+    const int margin = max_snr - LoRaWANSimAir::required_snr(sf_of(node.datarate))
+                       - ADR_INSTALLATION_MARGIN;
+    int steps = margin >= 0 ? margin / ADR_STEP_DB : -((-margin + ADR_STEP_DB - 1) / ADR_STEP_DB);
+    uint8_t datarate = node.datarate;
+    uint8_t tx_power = node.tx_power;
+
+    while (steps > 0 && datarate < EU868_MAX_DATARATE) {
+        datarate++;
+        steps--;
+    }
+
+    while (steps > 0 && tx_power < EU868_MAX_TX_POWER_INDEX) {
+        tx_power++;
+        steps--;
+    }
+
+    while (steps < 0 && tx_power > 0) {
+        tx_power--;
+        steps++;
+    }
+
+    if (datarate == node.datarate && tx_power == node.tx_power) {
+        return false;
+    }
+
+    node.adr_datarate = datarate;
+    node.adr_tx_power = tx_power;
+    // start collecting measurements at the new settings from scratch
+    node.snr_count = 0;
+    node.snr_pos = 0;
+
+    return true;
+}
+
+bool LoRaWANSimNetworkServer::send_downlink(const lorawan_sim_frame_t &uplink, uint8_t *buf,
+                                            uint8_t size, unsigned rx1_delay)
+{
+    lorawan_sim_frame_t frame;
+
+    frame.frequency = uplink.frequency;
+    frame.sf = uplink.sf;
+    frame.bandwidth = uplink.bandwidth;
+    frame.start = uplink.end + rx1_delay;
+    frame.end = frame.start + LoRaWANSimAir::time_on_air(frame.sf, frame.bandwidth,
+                                                         DOWNLINK_PREAMBLE_LENGTH,
+                                                         false, false, size);
+    frame.collided = false;
+    frame.snr = 0;
+    frame.origin = NULL;
+    frame.size = size;
+    memcpy(frame.payload, buf, size);
+
+    // A class A device re-arms its receiver for RX2 one second after RX1
+    // opens, so RX1 is only usable for frames shorter than that
+    if (frame.end - frame.start < RX2_DELAY_AFTER_RX1 && _air.schedule_downlink(frame)) {
+        downlinks++;
+        return true;
+    }
+
+    // RX1 slot taken or too short, try RX2
+    frame.frequency = EU868_RX2_FREQUENCY;
+    frame.sf = EU868_RX2_SF;
+    frame.bandwidth = 0;
+    frame.start = uplink.end + rx1_delay + RX2_DELAY_AFTER_RX1;
+    frame.end = frame.start + LoRaWANSimAir::time_on_air(frame.sf, frame.bandwidth,
+                                                         DOWNLINK_PREAMBLE_LENGTH,
+                                                         false, false, size);
+
+    if (_air.schedule_downlink(frame)) {
+        downlinks++;
+        return true;
+    }
+
+    downlinks_dropped++;
+    return false;
+}
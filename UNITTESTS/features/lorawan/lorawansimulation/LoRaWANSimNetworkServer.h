@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LORAWAN_SIM_NETWORK_SERVER_H_
+#define LORAWAN_SIM_NETWORK_SERVER_H_
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+#include "LoRaWANSimRadio.h"
+#include "LoRaMacCrypto.h"
+
+#define LORAWAN_SIM_ADR_HISTORY_MAX     20
+
+/** Network server view of a provisioned end device
+ */
+typedef struct {
+    uint8_t dev_eui[8];
+    uint8_t app_eui[8];
+    uint8_t app_key[16];
+
+    bool joined;
+    uint32_t dev_addr;
+    uint8_t nwk_skey[16];
+    uint8_t app_skey[16];
+    std::vector<uint16_t> dev_nonces;
+
+    bool fcnt_up_valid;
+    uint32_t fcnt_up;
+    uint32_t fcnt_down;
+
+    uint8_t datarate;
+    uint8_t tx_power;
+    int8_t snr_history[LORAWAN_SIM_ADR_HISTORY_MAX];
+    uint8_t snr_count;
+    uint8_t snr_pos;
+    bool adr_requested;
+    uint8_t adr_datarate;
+    uint8_t adr_tx_power;
+
+    uint32_t join_requests;
+    uint32_t uplinks;
+    uint32_t duplicates;
+    unsigned joined_at;
+    unsigned last_uplink_at;
+} lorawan_sim_node_t;
+
+/** Minimal LoRaWAN 1.0.2 network server for EU868 behind one gateway
+ *
+ * Handles OTAA joins, verifies uplink MICs and frame counters, acknowledges
+ * confirmed uplinks, answers LinkCheckReq and runs a simplified version of
+ * the Semtech network server ADR algorithm based on the best SNR of the
+ * last uplinks. All downlinks are sent in RX1, falling back to RX2 when the
+ * gateway is busy transmitting.
+ */
+class LoRaWANSimNetworkServer: public LoRaWANSimUplinkHandler {
+public:
+    LoRaWANSimNetworkServer(LoRaWANSimAir &air);
+
+    virtual ~LoRaWANSimNetworkServer();
+
+    /** Provision a device for OTAA */
+    void add_device(const uint8_t *dev_eui, const uint8_t *app_eui, const uint8_t *app_key);
+
+    /** Enable or disable network driven ADR */
+    void enable_adr(bool enable);
+
+    /** Number of uplinks the ADR algorithm looks at, at most LORAWAN_SIM_ADR_HISTORY_MAX */
+    void set_adr_history(uint8_t length);
+
+    /** Send the five extra EU868 channels in the join accept CFList */
+    void enable_cf_list(bool enable);
+
+    const lorawan_sim_node_t *find_device(const uint8_t *dev_eui) const;
+
+    virtual void on_uplink(const lorawan_sim_frame_t &frame);
+
+    static uint8_t datarate_of(uint8_t sf, uint8_t bandwidth);
+
+    uint32_t join_requests;
+    uint32_t join_accepts;
+    uint32_t join_replays;
+    uint32_t uplinks;
+    uint32_t confirmed_uplinks;
+    uint32_t duplicates;
+    uint32_t mic_failures;
+    uint32_t unknown_devices;
+    uint32_t downlinks;
+    uint32_t downlinks_dropped;
+    uint32_t adr_requests;
+    uint32_t adr_answers;
+
+private:
+    void handle_join_request(const lorawan_sim_frame_t &frame);
+    void handle_data_uplink(const lorawan_sim_frame_t &frame);
+    uint8_t parse_mac_answers(lorawan_sim_node_t &node, const uint8_t *buf, uint8_t len,
+                              bool &link_check_requested);
+    bool run_adr(lorawan_sim_node_t &node, int8_t snr);
+    bool send_downlink(const lorawan_sim_frame_t &uplink, uint8_t *buf, uint8_t size,
+                       unsigned rx1_delay);
+
+    LoRaWANSimAir &_air;
+    LoRaMacCrypto _crypto;
+    std::vector<lorawan_sim_node_t> _nodes;
+    std::map<uint64_t, size_t> _by_dev_eui;
+    bool _adr_enabled;
+    uint8_t _adr_history;
+    bool _cf_list;
+    uint32_t _app_nonce;
+};
+
+#endif /* LORAWAN_SIM_NETWORK_SERVER_H_ */
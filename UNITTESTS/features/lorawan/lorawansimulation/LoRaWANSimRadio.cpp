@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "LoRaWANSimRadio.h"
+
+// Downlinks older than this are forgotten by the air
+#define DOWNLINK_HISTORY_MS         10000
+// Rough noise floor of a 125 kHz LoRa receiver, used to fake RSSI from SNR
+#define NOISE_FLOOR_DBM             (-117)
+// Preamble symbols a receiver opened late still needs to see out of the 8
+// symbol downlink preamble
+#define PREAMBLE_LOCK_SYMBOLS       4
+
+using namespace events;
+
+/*****************************************************************************
+ * LoRaWANSimAir                                                             *
+ ****************************************************************************/
+LoRaWANSimAir::LoRaWANSimAir(EventQueue &queue)
+    : uplinks_started(0),
+      uplinks_collided(0),
+      uplinks_below_sensitivity(0),
+      uplinks_delivered(0),
+      downlinks_scheduled(0),
+      downlinks_rejected(0),
+      downlinks_received(0),
+      _queue(queue),
+      _handler(NULL)
+{
+}
+
+void LoRaWANSimAir::set_uplink_handler(LoRaWANSimUplinkHandler *handler)
+{
+    _handler = handler;
+}
+
+lorawan_sim_frame_t *LoRaWANSimAir::start_uplink(const lorawan_sim_frame_t &frame)
+{
+    lorawan_sim_frame_t *f = new lorawan_sim_frame_t(frame);
+    f->collided = false;
+
+    for (size_t i = 0; i < _in_flight.size(); i++) {
+        lorawan_sim_frame_t *other = _in_flight[i];
+        if (other->frequency == f->frequency && other->sf == f->sf
+                && other->bandwidth == f->bandwidth
+                && other->start < f->end && f->start < other->end) {
+            other->collided = true;
+            f->collided = true;
+        }
+    }
+
+    _in_flight.push_back(f);
+    uplinks_started++;
+
+    return f;
+}
+
+void LoRaWANSimAir::end_uplink(lorawan_sim_frame_t *frame)
+{
+    for (size_t i = 0; i < _in_flight.size(); i++) {
+        if (_in_flight[i] == frame) {
+            _in_flight[i] = _in_flight.back();
+            _in_flight.pop_back();
+            break;
+        }
+    }
+
+    if (frame->collided) {
+        uplinks_collided++;
+    } else if (frame->snr < required_snr(frame->sf)) {
+        uplinks_below_sensitivity++;
+    } else {
+        uplinks_delivered++;
+        if (_handler) {
+            _handler->on_uplink(*frame);
+        }
+    }
+
+    delete frame;
+}
+
+bool LoRaWANSimAir::schedule_downlink(const lorawan_sim_frame_t &frame)
+{
+    const unsigned now = _queue.tick();
+
+    for (size_t i = 0; i < _downlinks.size();) {
+        if ((int)(now - _downlinks[i].end) > DOWNLINK_HISTORY_MS) {
+            _downlinks[i] = _downlinks.back();
+            _downlinks.pop_back();
+            continue;
+        }
+
+        if (_downlinks[i].start < frame.end && frame.start < _downlinks[i].end) {
+            downlinks_rejected++;
+            return false;
+        }
+        i++;
+    }
+
+    _downlinks.push_back(frame);
+    downlinks_scheduled++;
+
+    return true;
+}
+
+const lorawan_sim_frame_t *LoRaWANSimAir::find_downlink(uint32_t frequency, uint8_t sf,
+                                                        uint8_t bandwidth, unsigned now,
+                                                        unsigned window)
+{
+    // The receiver locks on if it is open at the start of the frame or
+    // late by no more than PREAMBLE_LOCK_SYMBOLS
+    const int late = (PREAMBLE_LOCK_SYMBOLS * symbol_time_us(sf, bandwidth)) / 1000;
+
+    for (size_t i = 0; i < _downlinks.size(); i++) {
+        const lorawan_sim_frame_t &f = _downlinks[i];
+        if (f.frequency == frequency && f.sf == sf && f.bandwidth == bandwidth
+                && (int)(now - f.start) <= late && (int)(f.start - now) <= (int)window) {
+            return &f;
+        }
+    }
+
+    return NULL;
+}
+
+int8_t LoRaWANSimAir::required_snr(uint8_t sf)
+{
+    // SX127x demodulator floor, SF7 = -7.5 dB down to SF12 = -20 dB
+    switch (sf) {
+        case 6:
+            return -5;
+        case 7:
+            return -7;
+        case 8:
+            return -10;
+        case 9:
+            return -12;
+        case 10:
+            return -15;
+        case 11:
+            return -17;
+        case 12:
+            return -20;
+        default:
+            return 0;
+    }
+}
+
+uint32_t LoRaWANSimAir::symbol_time_us(uint8_t sf, uint8_t bandwidth)
+{
+    const uint32_t bw = 125000UL << bandwidth;
+    return (uint32_t)(((uint64_t)1000000 << sf) / bw);
+}
+
+uint32_t LoRaWANSimAir::time_on_air(uint8_t sf, uint8_t bandwidth, uint16_t preamble_len,
+                                    bool crc_on, bool fix_len, uint8_t pkt_len)
+{
+    // Same computation as the SX1272/SX1276 drivers, coding rate 4/5
+    const double bw = 125000UL << bandwidth;
+    const double ts = (double)(1UL << sf) / bw;
+    const bool low_dr_optimize = (bandwidth == 0 && sf >= 11) || (bandwidth == 1 && sf == 12);
+    const double t_preamble = (preamble_len + 4.25) * ts;
+
+    double tmp = ceil((8.0 * pkt_len - 4.0 * sf + 28 + 16 * (crc_on ? 1 : 0) - (fix_len ? 20 : 0))
+                      / (4.0 * (sf - (low_dr_optimize ? 2 : 0)))) * (1 + 4);
+    const double n_payload = 8 + (tmp > 0 ? tmp : 0);
+    const double t_payload = n_payload * ts;
+
+    return (uint32_t)floor((t_preamble + t_payload) * 1000 + 0.999);
+}
+
+/*****************************************************************************
+ * LoRaWANSimRadio                                                           *
+ ****************************************************************************/
+LoRaWANSimRadio::LoRaWANSimRadio(LoRaWANSimAir &air, uint32_t seed, int8_t snr)
+    : tx_count(0),
+      rx_windows(0),
+      rx_count(0),
+      _air(air),
+      _events(NULL),
+      _seed(seed ? seed : 1),
+      _snr(snr),
+      _state(RF_IDLE),
+      _frequency(0),
+      _tx_sf(12),
+      _tx_bandwidth(0),
+      _tx_preamble_len(8),
+      _tx_crc_on(true),
+      _rx_sf(12),
+      _rx_bandwidth(0),
+      _rx_symb_timeout(0),
+      _rx_continuous(false),
+      _pending_event(0),
+      _tx_frame(NULL),
+      _airtime(0),
+      _last_tx_start(0)
+{
+    memset(&_rx_frame, 0, sizeof(_rx_frame));
+}
+
+LoRaWANSimRadio::~LoRaWANSimRadio()
+{
+    cancel_pending();
+}
+
+void LoRaWANSimRadio::init_radio(radio_events_t *events)
+{
+    _events = events;
+}
+
+void LoRaWANSimRadio::radio_reset()
+{
+    cancel_pending();
+}
+
+void LoRaWANSimRadio::sleep(void)
+{
+    cancel_pending();
+}
+
+void LoRaWANSimRadio::standby(void)
+{
+    cancel_pending();
+}
+
+void LoRaWANSimRadio::set_rx_config(radio_modems_t modem, uint32_t bandwidth,
+                                    uint32_t datarate, uint8_t coderate,
+                                    uint32_t bandwidth_afc, uint16_t preamble_len,
+                                    uint16_t symb_timeout, bool fix_len,
+                                    uint8_t payload_len,
+                                    bool crc_on, bool freq_hop_on, uint8_t hop_period,
+                                    bool iq_inverted, bool rx_continuous)
+{
+    // FSK is not simulated, such a receiver never hears anything
+    _rx_sf = (modem == MODEM_LORA) ? datarate : 0;
+    _rx_bandwidth = bandwidth;
+    _rx_symb_timeout = symb_timeout;
+    _rx_continuous = rx_continuous;
+}
+
+void LoRaWANSimRadio::set_tx_config(radio_modems_t modem, int8_t power, uint32_t fdev,
+                                    uint32_t bandwidth, uint32_t datarate,
+                                    uint8_t coderate, uint16_t preamble_len,
+                                    bool fix_len, bool crc_on, bool freq_hop_on,
+                                    uint8_t hop_period, bool iq_inverted, uint32_t timeout)
+{
+    _tx_sf = (modem == MODEM_LORA) ? datarate : 0;
+    _tx_bandwidth = bandwidth;
+    _tx_preamble_len = preamble_len;
+    _tx_crc_on = crc_on;
+}
+
+void LoRaWANSimRadio::send(uint8_t *buffer, uint8_t size)
+{
+    cancel_pending();
+
+    const unsigned now = _air.queue().tick();
+    const uint32_t toa = time_on_air(MODEM_LORA, size);
+
+    lorawan_sim_frame_t frame;
+    frame.frequency = _frequency;
+    frame.sf = _tx_sf;
+    frame.bandwidth = _tx_bandwidth;
+    frame.start = now;
+    frame.end = now + toa;
+    frame.collided = false;
+    frame.snr = _snr;
+    frame.origin = this;
+    frame.size = size;
+    memcpy(frame.payload, buffer, size);
+
+    _tx_frame = _air.start_uplink(frame);
+    _state = RF_TX_RUNNING;
+    _airtime += toa;
+    _last_tx_start = now;
+    tx_count++;
+
+    _pending_event = _air.queue().call_in(toa, this, &LoRaWANSimRadio::on_tx_done);
+}
+
+void LoRaWANSimRadio::receive(void)
+{
+    cancel_pending();
+
+    const unsigned now = _air.queue().tick();
+    const uint32_t window = _rx_continuous ? 0x7FFFFFFF :
+                            (_rx_symb_timeout * LoRaWANSimAir::symbol_time_us(_rx_sf, _rx_bandwidth)
+                             + 999) / 1000;
+
+    _state = RF_RX_RUNNING;
+    rx_windows++;
+
+    const lorawan_sim_frame_t *downlink = _air.find_downlink(_frequency, _rx_sf,
+                                                             _rx_bandwidth, now, window);
+
+    if (downlink && _snr >= LoRaWANSimAir::required_snr(downlink->sf)) {
+        _rx_frame = *downlink;
+        _pending_event = _air.queue().call_in(downlink->end - now, this,
+                                              &LoRaWANSimRadio::on_rx_done);
+    } else if (!_rx_continuous) {
+        _pending_event = _air.queue().call_in(window, this,
+                                              &LoRaWANSimRadio::on_rx_timeout);
+    }
+}
+
+void LoRaWANSimRadio::set_channel(uint32_t freq)
+{
+    _frequency = freq;
+}
+
+uint32_t LoRaWANSimRadio::random(void)
+{
+    // xorshift32
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+    return _seed;
+}
+
+uint8_t LoRaWANSimRadio::get_status(void)
+{
+    return _state;
+}
+
+void LoRaWANSimRadio::set_max_payload_length(radio_modems_t modem, uint8_t max)
+{
+}
+
+void LoRaWANSimRadio::set_public_network(bool enable)
+{
+}
+
+uint32_t LoRaWANSimRadio::time_on_air(radio_modems_t modem, uint8_t pkt_len)
+{
+    if (modem == MODEM_FSK) {
+        // preamble, sync word, length, payload and CRC at 50 kbps
+        return ((5 + 3 + 1 + pkt_len + 2) * 8 * 1000 + 49999) / 50000;
+    }
+
+    return LoRaWANSimAir::time_on_air(_tx_sf, _tx_bandwidth, _tx_preamble_len,
+                                      _tx_crc_on, false, pkt_len);
+}
+
+bool LoRaWANSimRadio::perform_carrier_sense(radio_modems_t modem,
+                                            uint32_t freq,
+                                            int16_t rssi_threshold,
+                                            uint32_t max_carrier_sense_time)
+{
+    return true;
+}
+
+void LoRaWANSimRadio::start_cad(void)
+{
+}
+
+bool LoRaWANSimRadio::check_rf_frequency(uint32_t frequency)
+{
+    return true;
+}
+
+void LoRaWANSimRadio::set_tx_continuous_wave(uint32_t freq, int8_t power, uint16_t time)
+{
+}
+
+void LoRaWANSimRadio::lock(void)
+{
+}
+
+void LoRaWANSimRadio::unlock(void)
+{
+}
+
+void LoRaWANSimRadio::cancel_pending()
+{
+    if (_pending_event) {
+        _air.queue().cancel(_pending_event);
+        _pending_event = 0;
+    }
+
+    if (_tx_frame) {
+        // an aborted transmission still occupied the air until now
+        _tx_frame->end = _air.queue().tick();
+        _air.end_uplink(_tx_frame);
+        _tx_frame = NULL;
+    }
+
+    _state = RF_IDLE;
+}
+
+void LoRaWANSimRadio::on_tx_done()
+{
+    lorawan_sim_frame_t *frame = _tx_frame;
+
+    _pending_event = 0;
+    _tx_frame = NULL;
+    _state = RF_IDLE;
+
+    _air.end_uplink(frame);
+
+    if (_events && _events->tx_done) {
+        _events->tx_done();
+    }
+}
+
+void LoRaWANSimRadio::on_rx_done()
+{
+    _pending_event = 0;
+    _state = RF_IDLE;
+    rx_count++;
+    _air.downlinks_received++;
+
+    if (_events && _events->rx_done) {
+        _events->rx_done(_rx_frame.payload, _rx_frame.size,
+                         NOISE_FLOOR_DBM + _snr, _snr);
+    }
+}
+
+void LoRaWANSimRadio::on_rx_timeout()
+{
+    _pending_event = 0;
+    _state = RF_IDLE;
+
+    if (_events && _events->rx_timeout) {
+        _events->rx_timeout();
+    }
+}
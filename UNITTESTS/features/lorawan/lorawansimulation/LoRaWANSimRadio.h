@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LORAWAN_SIM_RADIO_H_
+#define LORAWAN_SIM_RADIO_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "LoRaRadio.h"
+#include "events/EventQueue.h"
+
+class LoRaWANSimRadio;
+
+/** A frame travelling through the simulated air
+ */
+typedef struct {
+    uint32_t frequency;
+    uint8_t sf;
+    uint8_t bandwidth;
+    unsigned start;
+    unsigned end;
+    bool collided;
+    int8_t snr;
+    LoRaWANSimRadio *origin;
+    uint8_t size;
+    uint8_t payload[255];
+} lorawan_sim_frame_t;
+
+/** Receiver of uplinks which survived the air, i.e., a network server
+ */
+class LoRaWANSimUplinkHandler {
+public:
+    virtual ~LoRaWANSimUplinkHandler() {}
+
+    /** Called at the end of every uplink that was demodulated by the gateway
+     *
+     * @param frame  The frame as it was heard by the gateway
+     */
+    virtual void on_uplink(const lorawan_sim_frame_t &frame) = 0;
+};
+
+/** Shared medium connecting all simulated radios to a single gateway
+ *
+ * Uplinks overlapping in time on the same frequency and spreading factor
+ * destroy each other. Uplinks with a link budget below the demodulation
+ * floor of their spreading factor are never heard. The gateway is
+ * half-duplex for downlinks: only one downlink can be on air at a time.
+ */
+class LoRaWANSimAir {
+public:
+    LoRaWANSimAir(events::EventQueue &queue);
+
+    void set_uplink_handler(LoRaWANSimUplinkHandler *handler);
+
+    events::EventQueue &queue()
+    {
+        return _queue;
+    }
+
+    /** Start an uplink. The caller must call end_uplink() once it is done.
+     */
+    lorawan_sim_frame_t *start_uplink(const lorawan_sim_frame_t &frame);
+
+    void end_uplink(lorawan_sim_frame_t *frame);
+
+    /** Queue a downlink from the gateway
+     *
+     * @return false if the gateway is already transmitting at that time
+     */
+    bool schedule_downlink(const lorawan_sim_frame_t &frame);
+
+    /** Find a downlink a receiver opened at 'now' for 'window' ms would lock on
+     */
+    const lorawan_sim_frame_t *find_downlink(uint32_t frequency, uint8_t sf,
+                                             uint8_t bandwidth, unsigned now,
+                                             unsigned window);
+
+    /** Minimum SNR required to demodulate a LoRa spreading factor */
+    static int8_t required_snr(uint8_t sf);
+
+    /** Time on air of a LoRa frame in ms */
+    static uint32_t time_on_air(uint8_t sf, uint8_t bandwidth, uint16_t preamble_len,
+                                bool crc_on, bool fix_len, uint8_t pkt_len);
+
+    /** Duration of a LoRa symbol in microseconds */
+    static uint32_t symbol_time_us(uint8_t sf, uint8_t bandwidth);
+
+    uint32_t uplinks_started;
+    uint32_t uplinks_collided;
+    uint32_t uplinks_below_sensitivity;
+    uint32_t uplinks_delivered;
+    uint32_t downlinks_scheduled;
+    uint32_t downlinks_rejected;
+    uint32_t downlinks_received;
+
+private:
+    events::EventQueue &_queue;
+    LoRaWANSimUplinkHandler *_handler;
+    std::vector<lorawan_sim_frame_t *> _in_flight;
+    std::vector<lorawan_sim_frame_t> _downlinks;
+};
+
+/** Software LoRaRadio attached to a LoRaWANSimAir
+ *
+ * Transmissions and receptions take the real LoRa time on air, measured
+ * on the virtual clock of the shared EventQueue. Radio interrupts are
+ * raised from events posted to that queue.
+ */
+class LoRaWANSimRadio: public LoRaRadio {
+public:
+    LoRaWANSimRadio(LoRaWANSimAir &air, uint32_t seed, int8_t snr);
+
+    virtual ~LoRaWANSimRadio();
+
+    virtual void init_radio(radio_events_t *events);
+
+    virtual void radio_reset();
+
+    virtual void sleep(void);
+
+    virtual void standby(void);
+
+    virtual void set_rx_config(radio_modems_t modem, uint32_t bandwidth,
+                               uint32_t datarate, uint8_t coderate,
+                               uint32_t bandwidth_afc, uint16_t preamble_len,
+                               uint16_t symb_timeout, bool fix_len,
+                               uint8_t payload_len,
+                               bool crc_on, bool freq_hop_on, uint8_t hop_period,
+                               bool iq_inverted, bool rx_continuous);
+
+    virtual void set_tx_config(radio_modems_t modem, int8_t power, uint32_t fdev,
+                               uint32_t bandwidth, uint32_t datarate,
+                               uint8_t coderate, uint16_t preamble_len,
+                               bool fix_len, bool crc_on, bool freq_hop_on,
+                               uint8_t hop_period, bool iq_inverted, uint32_t timeout);
+
+    virtual void send(uint8_t *buffer, uint8_t size);
+
+    virtual void receive(void);
+
+    virtual void set_channel(uint32_t freq);
+
+    virtual uint32_t random(void);
+
+    virtual uint8_t get_status(void);
+
+    virtual void set_max_payload_length(radio_modems_t modem, uint8_t max);
+
+    virtual void set_public_network(bool enable);
+
+    virtual uint32_t time_on_air(radio_modems_t modem, uint8_t pkt_len);
+
+    virtual bool perform_carrier_sense(radio_modems_t modem,
+                                       uint32_t freq,
+                                       int16_t rssi_threshold,
+                                       uint32_t max_carrier_sense_time);
+
+    virtual void start_cad(void);
+
+    virtual bool check_rf_frequency(uint32_t frequency);
+
+    virtual void set_tx_continuous_wave(uint32_t freq, int8_t power, uint16_t time);
+
+    virtual void lock(void);
+
+    virtual void unlock(void);
+
+    /** Link budget towards the gateway, the same in both directions */
+    int8_t snr() const
+    {
+        return _snr;
+    }
+
+    void set_snr(int8_t snr)
+    {
+        _snr = snr;
+    }
+
+    /** Total time spent transmitting, in ms */
+    uint32_t airtime() const
+    {
+        return _airtime;
+    }
+
+    /** Virtual time at which the last transmission started */
+    unsigned last_tx_start() const
+    {
+        return _last_tx_start;
+    }
+
+    uint32_t tx_count;
+    uint32_t rx_windows;
+    uint32_t rx_count;
+
+private:
+    void cancel_pending();
+    void on_tx_done();
+    void on_rx_done();
+    void on_rx_timeout();
+
+    LoRaWANSimAir &_air;
+    radio_events_t *_events;
+    uint32_t _seed;
+    int8_t _snr;
+    uint8_t _state;
+    uint32_t _frequency;
+    uint8_t _tx_sf;
+    uint8_t _tx_bandwidth;
+    uint16_t _tx_preamble_len;
+    bool _tx_crc_on;
+    uint8_t _rx_sf;
+    uint8_t _rx_bandwidth;
+    uint16_t _rx_symb_timeout;
+    bool _rx_continuous;
+    int _pending_event;
+    lorawan_sim_frame_t *_tx_frame;
+    lorawan_sim_frame_t _rx_frame;
+    uint32_t _airtime;
+    unsigned _last_tx_start;
+};
+
+#endif /* LORAWAN_SIM_RADIO_H_ */
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "EventQueue.h"
+#include "equeue_sim.h"
+#include "LoRaWANSimRadio.h"
+#include "LoRaWANSimNetworkServer.h"
+#include "LoRaWANSimDevice.h"
+
+using namespace events;
+
+#define MINUTES(m)              ((m) * 60 * 1000)
+#define EVENTS_PER_DEVICE       16
+#define DEFAULT_FLEET_SIZE      200
+
+class Test_LoRaWANSimulation : public testing::Test {
+protected:
+    EventQueue *queue;
+    LoRaWANSimAir *air;
+    LoRaWANSimNetworkServer *server;
+    std::vector<LoRaWANSimDevice *> devices;
+
+    void SetUp()
+    {
+        queue = NULL;
+        air = NULL;
+        server = NULL;
+        equeue_sim_set_tick(0);
+    }
+
+    void TearDown()
+    {
+        for (size_t i = 0; i < devices.size(); i++) {
+            delete devices[i];
+        }
+        devices.clear();
+        delete server;
+        delete air;
+        delete queue;
+    }
+
+    void create_network(unsigned device_count)
+    {
+        queue = new EventQueue(device_count * EVENTS_PER_DEVICE * (EVENTS_EVENT_SIZE + 32));
+        air = new LoRaWANSimAir(*queue);
+        server = new LoRaWANSimNetworkServer(*air);
+    }
+
+    LoRaWANSimDevice *add_device(int8_t snr)
+    {
+        LoRaWANSimDevice *device = new LoRaWANSimDevice(*air, devices.size(), snr);
+        server->add_device(device->dev_eui(), device->app_eui(), device->app_key());
+        devices.push_back(device);
+        return device;
+    }
+
+    const lorawan_sim_node_t *node_of(LoRaWANSimDevice *device)
+    {
+        return server->find_device(device->dev_eui());
+    }
+};
+
+TEST_F(Test_LoRaWANSimulation, join_and_unconfirmed_uplinks)
+{
+    create_network(1);
+    LoRaWANSimDevice *device = add_device(10);
+
+    EXPECT_EQ(LORAWAN_STATUS_OK, device->start(MINUTES(1), 10));
+    queue->dispatch(MINUTES(15));
+
+    EXPECT_TRUE(device->connected);
+    EXPECT_EQ(1, server->join_accepts);
+    EXPECT_EQ(0, server->mic_failures);
+    EXPECT_EQ(0, server->unknown_devices);
+    EXPECT_GE(device->tx_done, 10);
+    EXPECT_EQ(0, device->tx_errors);
+    EXPECT_EQ(device->tx_done, server->uplinks);
+    EXPECT_EQ(0, server->duplicates);
+
+    const lorawan_sim_node_t *node = node_of(device);
+    ASSERT_TRUE(node != NULL);
+    EXPECT_TRUE(node->joined);
+    EXPECT_EQ(device->tx_done - 1, node->fcnt_up);
+}
+
+TEST_F(Test_LoRaWANSimulation, confirmed_uplinks_are_acknowledged)
+{
+    create_network(1);
+    server->enable_adr(false);
+    LoRaWANSimDevice *device = add_device(0);
+
+    EXPECT_EQ(LORAWAN_STATUS_OK, device->start(MINUTES(2), 10, MSG_CONFIRMED_FLAG));
+    queue->dispatch(MINUTES(30));
+
+    EXPECT_TRUE(device->connected);
+    EXPECT_GE(device->tx_done, 10);
+    EXPECT_EQ(0, device->tx_errors);
+    // every confirmed uplink was acknowledged on the first attempt
+    EXPECT_EQ(device->tx_done, server->confirmed_uplinks);
+    EXPECT_EQ(0, server->duplicates);
+    EXPECT_EQ(server->confirmed_uplinks + server->join_accepts, server->downlinks);
+    EXPECT_EQ(server->downlinks, air->downlinks_received);
+}
+
+TEST_F(Test_LoRaWANSimulation, duty_cycle_limits_airtime)
+{
+    create_network(1);
+    server->enable_adr(false);
+    // only the three default channels, all in the 1% sub-band
+    server->enable_cf_list(false);
+    LoRaWANSimDevice *device = add_device(10);
+
+    // ask for far more than the sub-band allows
+    EXPECT_EQ(LORAWAN_STATUS_OK, device->start(1000, 20));
+    queue->dispatch(MINUTES(5));
+    ASSERT_TRUE(device->connected);
+
+    const unsigned start = queue->tick();
+    const uint32_t airtime_at_start = device->radio().airtime();
+    queue->dispatch(MINUTES(60));
+    const unsigned elapsed = queue->tick() - start;
+    const uint32_t airtime = device->radio().airtime() - airtime_at_start;
+
+    EXPECT_GT(device->max_backoff, 0);
+    EXPECT_GT(device->tx_done, 10);
+    // the band time-off lets one frame through at most early
+    EXPECT_LE(airtime, elapsed / 100 + LoRaWANSimAir::time_on_air(12, 0, 8, true, false, 33));
+    // and the device is not held back more than needed
+    EXPECT_GE(airtime, elapsed / 200);
+    EXPECT_EQ(0, server->mic_failures);
+}
+
+TEST_F(Test_LoRaWANSimulation, adr_follows_link_budget)
+{
+    create_network(2);
+    server->set_adr_history(5);
+    LoRaWANSimDevice *strong = add_device(10);
+    LoRaWANSimDevice *weak = add_device(-12);
+
+    EXPECT_EQ(LORAWAN_STATUS_OK, strong->start(MINUTES(1), 10));
+    EXPECT_EQ(LORAWAN_STATUS_OK, weak->start(MINUTES(1), 10));
+    queue->dispatch(MINUTES(5));
+    ASSERT_TRUE(strong->connected);
+    ASSERT_TRUE(weak->connected);
+
+    // start from the most robust data rate
+    strong->stack().enable_adaptive_datarate(false);
+    EXPECT_EQ(LORAWAN_STATUS_OK, strong->stack().set_channel_data_rate(DR_0));
+    strong->stack().enable_adaptive_datarate(true);
+
+    queue->dispatch(MINUTES(60));
+
+    EXPECT_GE(server->adr_requests, 1);
+    EXPECT_GE(server->adr_answers, 1);
+    EXPECT_EQ(5, node_of(strong)->datarate);
+    EXPECT_FALSE(node_of(strong)->adr_requested);
+    // SF9 is the fastest the weak link can carry, it is never pushed past it
+    EXPECT_LE(node_of(weak)->datarate, 3);
+    EXPECT_EQ(0, server->mic_failures);
+}
+
+TEST_F(Test_LoRaWANSimulation, fleet_shares_one_gateway)
+{
+    unsigned fleet_size = DEFAULT_FLEET_SIZE;
+    const char *env = getenv("LORAWAN_SIM_DEVICES");
+    if (env && atoi(env) > 0) {
+        fleet_size = atoi(env);
+    }
+
+    create_network(fleet_size);
+    for (unsigned i = 0; i < fleet_size; i++) {
+        // link budgets spread from -15 dB to +10 dB
+        add_device(-15 + (int8_t)((i * 7) % 26));
+    }
+
+    for (unsigned i = 0; i < fleet_size; i++) {
+        EXPECT_EQ(LORAWAN_STATUS_OK, devices[i]->start(MINUTES(10), 20));
+    }
+    queue->dispatch(MINUTES(120));
+
+    unsigned connected = 0;
+    uint32_t tx_done = 0;
+    uint32_t tx_errors = 0;
+    uint32_t join_failures = 0;
+    uint64_t tx_delay = 0;
+    for (unsigned i = 0; i < fleet_size; i++) {
+        connected += devices[i]->connected ? 1 : 0;
+        tx_done += devices[i]->tx_done;
+        tx_errors += devices[i]->tx_errors;
+        join_failures += devices[i]->join_failures;
+        tx_delay += devices[i]->total_tx_delay;
+    }
+
+    printf("devices %u, connected %u, join failures %u\n",
+           fleet_size, connected, join_failures);
+    printf("uplinks started %u, collided %u, below sensitivity %u, delivered %u\n",
+           air->uplinks_started, air->uplinks_collided,
+           air->uplinks_below_sensitivity, air->uplinks_delivered);
+    printf("server: joins %u/%u, uplinks %u, duplicates %u, downlinks %u, dropped %u\n",
+           server->join_accepts, server->join_requests, server->uplinks,
+           server->duplicates, server->downlinks, server->downlinks_dropped);
+    printf("tx done %u, tx errors %u, mean tx delay %u ms\n", tx_done, tx_errors,
+           tx_done ? (unsigned)(tx_delay / tx_done) : 0);
+
+    // larger fleets may saturate the gateway, which is what they are for
+    if (fleet_size <= DEFAULT_FLEET_SIZE) {
+        EXPECT_GE(connected * 100, fleet_size * 95);
+    }
+    EXPECT_EQ(0, server->mic_failures);
+    EXPECT_EQ(0, server->unknown_devices);
+    EXPECT_EQ(air->uplinks_delivered, server->join_requests + server->uplinks);
+    EXPECT_GT(server->uplinks, connected * 5);
+}
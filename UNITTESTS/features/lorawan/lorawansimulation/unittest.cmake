@@ -0,0 +1,58 @@
+#[[
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+]]
+
+# Unit test suite name
+set(TEST_SUITE_NAME "lorawan_LoRaWANSimulation")
+
+# Source files
+set(unittest-sources
+  ../features/lorawan/LoRaWANStack.cpp
+  ../features/lorawan/lorastack/mac/LoRaMac.cpp
+  ../features/lorawan/lorastack/mac/LoRaMacChannelPlan.cpp
+  ../features/lorawan/lorastack/mac/LoRaMacCommand.cpp
+  ../features/lorawan/lorastack/mac/LoRaMacCrypto.cpp
+  ../features/lorawan/lorastack/phy/LoRaPHY.cpp
+  ../features/lorawan/lorastack/phy/LoRaPHYEU868.cpp
+  ../features/lorawan/system/LoRaWANTimer.cpp
+  ../features/mbedtls/src/aes.c
+  ../features/mbedtls/src/aesni.c
+  ../features/mbedtls/src/ccm.c
+  ../features/mbedtls/src/cipher.c
+  ../features/mbedtls/src/cipher_wrap.c
+  ../features/mbedtls/src/cmac.c
+  ../features/mbedtls/src/gcm.c
+  ../features/mbedtls/src/platform_util.c
+  ../events/EventQueue.cpp
+  ../events/equeue/equeue.c
+)
+
+# Add test specific include paths
+set(unittest-includes ${unittest-includes}
+  target_h
+  ../features/lorawan
+  features/lorawan/lorawansimulation
+)
+
+# Test & stub files
+set(unittest-test-sources
+  features/lorawan/lorawansimulation/Test_LoRaWANSimulation.cpp
+  features/lorawan/lorawansimulation/LoRaWANSimRadio.cpp
+  features/lorawan/lorawansimulation/LoRaWANSimNetworkServer.cpp
+  features/lorawan/lorawansimulation/LoRaWANSimDevice.cpp
+  stubs/equeue_sim.c
+  stubs/mbed_assert_stub.c
+)
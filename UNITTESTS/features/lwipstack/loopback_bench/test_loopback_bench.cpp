@@ -0,0 +1,550 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Network stack benchmarks over a HostEMAC link.
+ *
+ * LWIP is a singleton, so the far end of the link runs in a forked server
+ * process with its own stack, serving a TCP sink, a TCP accept-and-close
+ * port, UDP and TCP echo ports and a DNS responder. The test process is the
+ * client and times everything through the public socket API. Results are
+ * printed and recorded as gtest properties, so --gtest_output=xml turns a
+ * run into a baseline for stack tuning.
+ *
+ * The loopback_bench_no_fast_path suite builds the same benchmarks with
+ * lwip.socket-fast-path disabled, for comparison.
+ */
+
+#include "gtest/gtest.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench_timer.h"
+#include "HostEMAC.h"
+#include "EMACInterface.h"
+#include "OnboardNetworkStack.h"
+#include "TCPSocket.h"
+#include "UDPSocket.h"
+#include "rtos/Semaphore.h"
+#include "rtos/Thread.h"
+#include "lwip/err.h"
+#include "lwip/dns.h"
+
+namespace {
+
+const char *const client_ip = "10.0.0.1";
+const char *const server_ip = "10.0.0.2";
+const char *const netmask = "255.255.255.0";
+const char *const gateway = "0.0.0.0"; // the static bringup path requires one
+// Paced like 100 Mbit/s Ethernet, so figures reflect the stack rather than host scheduling
+const uint32_t link_rate = 100000000;
+const uint8_t client_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+const uint8_t server_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+
+const uint16_t sink_port = 5001;
+const uint16_t setup_port = 5002;
+const uint16_t echo_port = 5003;
+const uint16_t tcp_echo_port = 5004;
+const uint16_t dns_port = 53;
+
+const uint32_t bulk_bytes = 512 * 1024;
+const int setup_rounds = 200;
+const int echo_rounds = 2000;
+const int dns_rounds = 200;
+const int small_rounds = 2000;
+const int small_size = 16;
+const int dispatch_sockets = 64;
+const int dispatch_rounds = 1000;
+const int counter_rounds = 32;
+
+bool recv_all(TCPSocket *sock, void *data, uint32_t size)
+{
+    uint8_t *ptr = static_cast<uint8_t *>(data);
+    while (size) {
+        nsapi_size_or_error_t ret = sock->recv(ptr, size);
+        if (ret <= 0) {
+            return false;
+        }
+        ptr += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+// Counts the events of one socket and wakes the benchmark thread
+struct SocketEvents {
+    rtos::Semaphore *wake;
+    unsigned count;
+
+    void raise()
+    {
+        count++;
+        wake->release();
+    }
+};
+
+/* Server process */
+
+// Reads a 4-byte length then that many bytes, and acknowledges with one byte
+void tcp_sink(TCPSocket *listener)
+{
+    static uint8_t buf[8192];
+    for (;;) {
+        TCPSocket *conn = listener->accept();
+        if (!conn) {
+            continue;
+        }
+        uint8_t header[4];
+        if (recv_all(conn, header, sizeof(header))) {
+            uint32_t left = (header[0] << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+            while (left) {
+                nsapi_size_or_error_t ret = conn->recv(buf, left < sizeof(buf) ? left : sizeof(buf));
+                if (ret <= 0) {
+                    break;
+                }
+                left -= ret;
+            }
+            uint8_t ack = left == 0;
+            conn->send(&ack, 1);
+            conn->recv(buf, 1);
+        }
+        conn->close();
+    }
+}
+
+void tcp_setup(TCPSocket *listener)
+{
+    for (;;) {
+        TCPSocket *conn = listener->accept();
+        if (conn) {
+            conn->close();
+        }
+    }
+}
+
+void udp_echo(UDPSocket *sock)
+{
+    uint8_t buf[1500];
+    for (;;) {
+        SocketAddress peer;
+        nsapi_size_or_error_t ret = sock->recvfrom(&peer, buf, sizeof(buf));
+        if (ret >= 0) {
+            sock->sendto(peer, buf, ret);
+        }
+    }
+}
+
+void tcp_echo(TCPSocket *listener)
+{
+    uint8_t buf[1500];
+    for (;;) {
+        TCPSocket *conn = listener->accept();
+        if (!conn) {
+            continue;
+        }
+        nsapi_size_or_error_t ret;
+        while ((ret = conn->recv(buf, sizeof(buf))) > 0) {
+            if (conn->send(buf, ret) != ret) {
+                break;
+            }
+        }
+        conn->close();
+    }
+}
+
+// Answers every A query with 10.0.1.1
+void dns_responder(UDPSocket *sock)
+{
+    uint8_t buf[512];
+    for (;;) {
+        SocketAddress peer;
+        nsapi_size_or_error_t len = sock->recvfrom(&peer, buf, sizeof(buf) - 16);
+        if (len < 12 || (buf[2] & 0x80)) {
+            continue;
+        }
+
+        // Question: the query name followed by type and class
+        int pos = 12;
+        while (pos < len && buf[pos] != 0) {
+            pos += buf[pos] + 1;
+        }
+        pos += 5;
+        if (pos > len) {
+            continue;
+        }
+
+        const uint8_t answer[] = {
+            0xc0, 0x0c,             // name: pointer to the question
+            0x00, 0x01, 0x00, 0x01, // type A, class IN
+            0x00, 0x00, 0x00, 0x3c, // ttl
+            0x00, 0x04,             // rdlength
+            10, 0, 1, 1
+        };
+        buf[2] = 0x81;
+        buf[3] = 0x80;
+        buf[6] = 0;
+        buf[7] = 1;
+        buf[8] = buf[9] = buf[10] = buf[11] = 0;
+        memcpy(buf + pos, answer, sizeof(answer));
+        sock->sendto(peer, buf, pos + sizeof(answer));
+    }
+}
+
+void run_server(int link_fd, int ready_fd)
+{
+    static HostEMAC emac(link_fd, server_mac);
+    emac.set_link_rate(link_rate);
+    static EMACInterface net(emac, OnboardNetworkStack::get_default_instance());
+    static TCPSocket sink_listener, setup_listener, echo_listener;
+    static UDPSocket echo_sock, dns_sock;
+    static rtos::Thread threads[5];
+
+    net.set_network(server_ip, netmask, gateway);
+    bool ok = net.connect() == NSAPI_ERROR_OK;
+
+    ok = ok && sink_listener.open(&net) == NSAPI_ERROR_OK
+         && sink_listener.bind(sink_port) == NSAPI_ERROR_OK
+         && sink_listener.listen(1) == NSAPI_ERROR_OK;
+    ok = ok && setup_listener.open(&net) == NSAPI_ERROR_OK
+         && setup_listener.bind(setup_port) == NSAPI_ERROR_OK
+         && setup_listener.listen(2) == NSAPI_ERROR_OK;
+    ok = ok && echo_listener.open(&net) == NSAPI_ERROR_OK
+         && echo_listener.bind(tcp_echo_port) == NSAPI_ERROR_OK
+         && echo_listener.listen(1) == NSAPI_ERROR_OK;
+    ok = ok && echo_sock.open(&net) == NSAPI_ERROR_OK
+         && echo_sock.bind(echo_port) == NSAPI_ERROR_OK;
+    ok = ok && dns_sock.open(&net) == NSAPI_ERROR_OK
+         && dns_sock.bind(dns_port) == NSAPI_ERROR_OK;
+
+    if (ok) {
+        threads[0].start(mbed::callback(tcp_sink, &sink_listener));
+        threads[1].start(mbed::callback(tcp_setup, &setup_listener));
+        threads[2].start(mbed::callback(udp_echo, &echo_sock));
+        threads[3].start(mbed::callback(dns_responder, &dns_sock));
+        threads[4].start(mbed::callback(tcp_echo, &echo_listener));
+    }
+
+    char status = ok ? 'R' : 'E';
+    if (write(ready_fd, &status, 1) != 1 || !ok) {
+        _exit(1);
+    }
+    for (;;) {
+        pause();
+    }
+}
+
+/*
+ * Echo round trips from one socket among many open ones, woken by the
+ * socket event rather than polled, so the figure includes the dispatch of
+ * every event raised on the tcpip thread to its socket.
+ */
+double dispatch_round_trip_us(NetworkInterface *net, int socket_count)
+{
+    static UDPSocket socks[dispatch_sockets];
+    static SocketEvents events[dispatch_sockets];
+    rtos::Semaphore wake;
+    SocketAddress server(server_ip, echo_port);
+
+    for (int i = 0; i < socket_count; i++) {
+        events[i].wake = &wake;
+        events[i].count = 0;
+        EXPECT_EQ(NSAPI_ERROR_OK, socks[i].open(net));
+        socks[i].set_blocking(false);
+        socks[i].sigio(mbed::callback(&events[i], &SocketEvents::raise));
+    }
+
+    uint8_t out[16];
+    uint8_t in[16];
+    memset(out, 0x3c, sizeof(out));
+    int lost = 0;
+
+    bench_time_t start = bench_now();
+    for (int round = 0; round < dispatch_rounds; round++) {
+        // Every open socket takes its turn, starting from the end of the socket arena
+        UDPSocket &sock = socks[socket_count - 1 - round % socket_count];
+        memcpy(out, &round, sizeof(round));
+        EXPECT_EQ((nsapi_size_or_error_t)sizeof(out), sock.sendto(server, out, sizeof(out)));
+        nsapi_size_or_error_t ret;
+        while ((ret = sock.recvfrom(NULL, in, sizeof(in))) == NSAPI_ERROR_WOULD_BLOCK) {
+            if (wake.wait(1000) <= 0) {
+                break;
+            }
+        }
+        if (ret != (nsapi_size_or_error_t)sizeof(in) || memcmp(out, in, sizeof(out)) != 0) {
+            lost++;
+        }
+    }
+    double elapsed = bench_seconds_since(start);
+
+    unsigned count = 0;
+    for (int i = 0; i < socket_count; i++) {
+        count += events[i].count;
+        socks[i].sigio(NULL);
+        socks[i].close();
+    }
+    EXPECT_EQ(0, lost);
+    // Every round raises an event for the reply at least
+    EXPECT_GE(count, (unsigned)dispatch_rounds);
+
+    return elapsed * 1e6 / dispatch_rounds;
+}
+
+} // namespace
+
+/* Client process */
+
+class TestLoopbackBench : public testing::Test {
+protected:
+    static void SetUpTestCase()
+    {
+        int link[2];
+        int ready[2];
+        ASSERT_EQ(0, HostEMAC::create_link(link));
+        ASSERT_EQ(0, pipe(ready));
+
+        // Fork before this process starts any thread of its own
+        server_pid = fork();
+        ASSERT_GE(server_pid, 0);
+        if (server_pid == 0) {
+            close(link[0]);
+            close(ready[0]);
+            run_server(link[1], ready[1]);
+        }
+        close(link[1]);
+        close(ready[1]);
+
+        char status = 0;
+        ssize_t ret = read(ready[0], &status, 1);
+        close(ready[0]);
+        ASSERT_EQ(1, ret);
+        ASSERT_EQ('R', status);
+
+        emac = new HostEMAC(link[0], client_mac);
+        emac->set_link_rate(link_rate);
+        net = new EMACInterface(*emac, OnboardNetworkStack::get_default_instance());
+        ASSERT_EQ(NSAPI_ERROR_OK, net->set_network(client_ip, netmask, gateway));
+        ASSERT_EQ(NSAPI_ERROR_OK, net->connect());
+
+        // Static bringup fills the stack's own resolver list, which is tried
+        // before any nsapi server, with a public one; use the responder
+        ip_addr_t dns_addr;
+        ASSERT_TRUE(ipaddr_aton(server_ip, &dns_addr));
+        dns_setserver(0, &dns_addr);
+    }
+
+    static void TearDownTestCase()
+    {
+        if (server_pid > 0) {
+            kill(server_pid, SIGKILL);
+            waitpid(server_pid, NULL, 0);
+        }
+        // The stack cannot be torn down, so the client side is left running
+    }
+
+    static pid_t server_pid;
+    static HostEMAC *emac;
+    static EMACInterface *net;
+};
+
+pid_t TestLoopbackBench::server_pid;
+HostEMAC *TestLoopbackBench::emac;
+EMACInterface *TestLoopbackBench::net;
+
+TEST_F(TestLoopbackBench, tcp_bulk_throughput)
+{
+    static uint8_t chunk[8192];
+    memset(chunk, 0xa5, sizeof(chunk));
+
+    TCPSocket sock;
+    ASSERT_EQ(NSAPI_ERROR_OK, sock.open(net));
+    ASSERT_EQ(NSAPI_ERROR_OK, sock.connect(SocketAddress(server_ip, sink_port)));
+
+    bench_time_t start = bench_now();
+    uint8_t header[4] = {
+        (uint8_t)(bulk_bytes >> 24), (uint8_t)(bulk_bytes >> 16), (uint8_t)(bulk_bytes >> 8), (uint8_t)bulk_bytes
+    };
+    ASSERT_EQ(4, sock.send(header, sizeof(header)));
+    for (uint32_t sent = 0; sent < bulk_bytes; sent += sizeof(chunk)) {
+        ASSERT_EQ((nsapi_size_or_error_t)sizeof(chunk), sock.send(chunk, sizeof(chunk)));
+    }
+    uint8_t ack = 0;
+    ASSERT_EQ(1, sock.recv(&ack, 1));
+    double elapsed = bench_seconds_since(start);
+    EXPECT_EQ(1, ack);
+    sock.close();
+
+    bench_report("tcp_bulk_kBps", bulk_bytes / 1024.0 / elapsed, "KiB/s");
+}
+
+TEST_F(TestLoopbackBench, tcp_connection_setup_rate)
+{
+    bench_time_t start = bench_now();
+    for (int i = 0; i < setup_rounds; i++) {
+        TCPSocket sock;
+        ASSERT_EQ(NSAPI_ERROR_OK, sock.open(net));
+        ASSERT_EQ(NSAPI_ERROR_OK, sock.connect(SocketAddress(server_ip, setup_port))) << "round " << i;
+        // Wait for the server to accept and close, completing the cycle
+        uint8_t byte;
+        EXPECT_EQ(0, sock.recv(&byte, 1));
+        sock.close();
+    }
+    double elapsed = bench_seconds_since(start);
+
+    bench_report("tcp_connections_per_s", setup_rounds / elapsed, "conn/s");
+}
+
+TEST_F(TestLoopbackBench, udp_packet_rate)
+{
+    UDPSocket sock;
+    ASSERT_EQ(NSAPI_ERROR_OK, sock.open(net));
+    sock.set_timeout(1000);
+    SocketAddress server(server_ip, echo_port);
+
+    uint8_t out[64];
+    uint8_t in[64];
+    memset(out, 0x5a, sizeof(out));
+
+    bench_time_t start = bench_now();
+    for (int i = 0; i < echo_rounds; i++) {
+        memcpy(out, &i, sizeof(i));
+        ASSERT_EQ((nsapi_size_or_error_t)sizeof(out), sock.sendto(server, out, sizeof(out)));
+        ASSERT_EQ((nsapi_size_or_error_t)sizeof(in), sock.recvfrom(NULL, in, sizeof(in))) << "round " << i;
+        ASSERT_EQ(0, memcmp(out, in, sizeof(out)));
+    }
+    double elapsed = bench_seconds_since(start);
+    sock.close();
+
+    // Each round trip is one datagram each way
+    bench_report("udp_packets_per_s", 2 * echo_rounds / elapsed, "pkt/s");
+}
+
+TEST_F(TestLoopbackBench, udp_small_round_trip)
+{
+    UDPSocket sock;
+    ASSERT_EQ(NSAPI_ERROR_OK, sock.open(net));
+    sock.set_timeout(1000);
+    SocketAddress server(server_ip, echo_port);
+
+    uint8_t out[small_size];
+    uint8_t in[small_size];
+    memset(out, 0x69, sizeof(out));
+
+    bench_time_t start = bench_now();
+    for (int i = 0; i < small_rounds; i++) {
+        memcpy(out, &i, sizeof(i));
+        ASSERT_EQ((nsapi_size_or_error_t)sizeof(out), sock.sendto(server, out, sizeof(out)));
+        ASSERT_EQ((nsapi_size_or_error_t)sizeof(in), sock.recvfrom(NULL, in, sizeof(in))) << "round " << i;
+        ASSERT_EQ(0, memcmp(out, in, sizeof(out)));
+    }
+    double elapsed = bench_seconds_since(start);
+    sock.close();
+
+    bench_report("udp_small_rtt_us", elapsed * 1e6 / small_rounds, "us/round trip");
+}
+
+#if MBED_CONF_LWIP_SOCKET_FAST_PATH
+TEST_F(TestLoopbackBench, udp_oversized_datagram)
+{
+    static uint8_t out[0x10000];
+
+    UDPSocket sock;
+    ASSERT_EQ(NSAPI_ERROR_OK, sock.open(net));
+    SocketAddress server(server_ip, echo_port);
+
+    EXPECT_EQ(NSAPI_ERROR_PARAMETER, sock.sendto(server, out, sizeof(out)));
+    sock.close();
+}
+#endif
+
+TEST_F(TestLoopbackBench, tcp_small_round_trip)
+{
+    TCPSocket sock;
+    ASSERT_EQ(NSAPI_ERROR_OK, sock.open(net));
+    ASSERT_EQ(NSAPI_ERROR_OK, sock.connect(SocketAddress(server_ip, tcp_echo_port)));
+    sock.set_timeout(1000);
+
+    uint8_t out[small_size];
+    uint8_t in[small_size];
+    memset(out, 0x96, sizeof(out));
+
+    bench_time_t start = bench_now();
+    for (int i = 0; i < small_rounds; i++) {
+        memcpy(out, &i, sizeof(i));
+        ASSERT_EQ((nsapi_size_or_error_t)sizeof(out), sock.send(out, sizeof(out)));
+        ASSERT_TRUE(recv_all(&sock, in, sizeof(in))) << "round " << i;
+        ASSERT_EQ(0, memcmp(out, in, sizeof(out)));
+    }
+    double elapsed = bench_seconds_since(start);
+    sock.close();
+
+    bench_report("tcp_small_rtt_us", elapsed * 1e6 / small_rounds, "us/round trip");
+}
+
+TEST_F(TestLoopbackBench, socket_event_dispatch)
+{
+    bench_report("udp_event_rtt_1_socket_us", dispatch_round_trip_us(net, 1), "us/round trip");
+    bench_report("udp_event_rtt_64_sockets_us", dispatch_round_trip_us(net, dispatch_sockets), "us/round trip");
+}
+
+TEST_F(TestLoopbackBench, dns_query_latency)
+{
+    bench_time_t start = bench_now();
+    for (int i = 0; i < dns_rounds; i++) {
+        // Distinct names so every query misses the resolver cache
+        char name[32];
+        snprintf(name, sizeof(name), "host%d.bench.test", i);
+        SocketAddress addr;
+        ASSERT_EQ(NSAPI_ERROR_OK, net->gethostbyname(name, &addr)) << name;
+        ASSERT_STREQ("10.0.1.1", addr.get_ip_address());
+    }
+    double elapsed = bench_seconds_since(start);
+
+    bench_report("dns_query_us", elapsed * 1e6 / dns_rounds, "us/query");
+}
+
+TEST_F(TestLoopbackBench, link_counters)
+{
+    // Earlier benchmarks may have dropped frames under load, so only this
+    // test's own traffic is checked
+    HostEMAC::stats_t before = emac->get_stats();
+
+    UDPSocket sock;
+    ASSERT_EQ(NSAPI_ERROR_OK, sock.open(net));
+    sock.set_timeout(1000);
+    SocketAddress server(server_ip, echo_port);
+
+    uint8_t out[small_size];
+    uint8_t in[small_size];
+    memset(out, 0x3c, sizeof(out));
+    for (int i = 0; i < counter_rounds; i++) {
+        ASSERT_EQ((nsapi_size_or_error_t)sizeof(out), sock.sendto(server, out, sizeof(out)));
+        ASSERT_EQ((nsapi_size_or_error_t)sizeof(in), sock.recvfrom(NULL, in, sizeof(in))) << "round " << i;
+    }
+    sock.close();
+
+    HostEMAC::stats_t after = emac->get_stats();
+    EXPECT_GE(after.tx_frames - before.tx_frames, (uint32_t)counter_rounds);
+    EXPECT_GE(after.rx_frames - before.rx_frames, (uint32_t)counter_rounds);
+    EXPECT_GE(after.tx_bytes - before.tx_bytes, (uint32_t)(counter_rounds * small_size));
+    EXPECT_GE(after.rx_bytes - before.rx_bytes, (uint32_t)(counter_rounds * small_size));
+    EXPECT_EQ(before.tx_errors, after.tx_errors);
+    EXPECT_EQ(before.rx_drops, after.rx_drops);
+}
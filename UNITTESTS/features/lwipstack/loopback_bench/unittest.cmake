@@ -0,0 +1,116 @@
+
+####################
+# UNIT TESTS
+####################
+
+# Runs the real LWIP stack, netsocket and rtos classes on the POSIX backend
+set(unittest-rtos posix)
+
+set(unittest-includes ${unittest-includes}
+  ../features/lwipstack
+  ../features/lwipstack/lwip/src
+  ../features/lwipstack/lwip/src/include
+  ../features/lwipstack/lwip/src/include/lwip
+  ../features/lwipstack/lwip-sys
+  ../features/lwipstack/lwip-sys/arch
+  ../features/frameworks/mbed-client-randlib/mbed-client-randlib
+)
+
+# mbed_lib.json defaults, with enough sockets for the benchmark server and
+# the event dispatch benchmark
+set(unittest-definitions
+  MBED_CONF_LWIP_IPV4_ENABLED=1
+  MBED_CONF_LWIP_IPV6_ENABLED=0
+  MBED_CONF_LWIP_IP_VER_PREF=4
+  MBED_CONF_LWIP_ADDR_TIMEOUT=5
+  MBED_CONF_LWIP_ADDR_TIMEOUT_MODE=1
+  MBED_CONF_LWIP_ETHERNET_ENABLED=1
+  MBED_CONF_LWIP_DEBUG_ENABLED=0
+  MBED_CONF_LWIP_PPP_ENABLED=0
+  MBED_CONF_LWIP_USE_MBED_TRACE=0
+  MBED_CONF_LWIP_ENABLE_PPP_TRACE=0
+  MBED_CONF_LWIP_SOCKET_FAST_PATH=1
+  MBED_CONF_LWIP_TCP_ENABLED=1
+  MBED_CONF_LWIP_SOCKET_MAX=72
+  MBED_CONF_LWIP_TCP_SERVER_MAX=4
+  MBED_CONF_LWIP_TCP_SOCKET_MAX=8
+  MBED_CONF_LWIP_UDP_SOCKET_MAX=68
+  MBED_CONF_LWIP_TCPIP_THREAD_STACKSIZE=1200
+  MBED_CONF_LWIP_DEFAULT_THREAD_STACKSIZE=512
+  MBED_CONF_LWIP_PPP_THREAD_STACKSIZE=768
+  MBED_CONF_NSAPI_PRESENT=1
+  MBED_CONF_NSAPI_DEFAULT_STACK=LWIP
+  MBED_CONF_NSAPI_DNS_RESPONSE_WAIT_TIME=5000
+  MBED_CONF_NSAPI_DNS_TOTAL_ATTEMPTS=3
+  MBED_CONF_NSAPI_DNS_RETRIES=0
+  MBED_CONF_NSAPI_DNS_CACHE_SIZE=3
+)
+
+set(unittest-sources
+  ../features/lwipstack/lwip/src/api/lwip_api_lib.c
+  ../features/lwipstack/lwip/src/api/lwip_api_msg.c
+  ../features/lwipstack/lwip/src/api/lwip_err.c
+  ../features/lwipstack/lwip/src/api/lwip_netbuf.c
+  ../features/lwipstack/lwip/src/api/lwip_tcpip.c
+  ../features/lwipstack/lwip/src/core/lwip_def.c
+  ../features/lwipstack/lwip/src/core/lwip_dns.c
+  ../features/lwipstack/lwip/src/core/lwip_inet_chksum.c
+  ../features/lwipstack/lwip/src/core/lwip_init.c
+  ../features/lwipstack/lwip/src/core/lwip_ip.c
+  ../features/lwipstack/lwip/src/core/lwip_mem.c
+  ../features/lwipstack/lwip/src/core/lwip_memp.c
+  ../features/lwipstack/lwip/src/core/lwip_netif.c
+  ../features/lwipstack/lwip/src/core/lwip_pbuf.c
+  ../features/lwipstack/lwip/src/core/lwip_raw.c
+  ../features/lwipstack/lwip/src/core/lwip_stats.c
+  ../features/lwipstack/lwip/src/core/lwip_sys.c
+  ../features/lwipstack/lwip/src/core/lwip_tcp.c
+  ../features/lwipstack/lwip/src/core/lwip_tcp_in.c
+  ../features/lwipstack/lwip/src/core/lwip_tcp_out.c
+  ../features/lwipstack/lwip/src/core/lwip_timeouts.c
+  ../features/lwipstack/lwip/src/core/lwip_udp.c
+  ../features/lwipstack/lwip/src/core/ipv4/lwip_autoip.c
+  ../features/lwipstack/lwip/src/core/ipv4/lwip_dhcp.c
+  ../features/lwipstack/lwip/src/core/ipv4/lwip_etharp.c
+  ../features/lwipstack/lwip/src/core/ipv4/lwip_icmp.c
+  ../features/lwipstack/lwip/src/core/ipv4/lwip_igmp.c
+  ../features/lwipstack/lwip/src/core/ipv4/lwip_ip4.c
+  ../features/lwipstack/lwip/src/core/ipv4/lwip_ip4_addr.c
+  ../features/lwipstack/lwip/src/core/ipv4/lwip_ip4_frag.c
+  ../features/lwipstack/lwip/src/netif/lwip_ethernet.c
+  ../features/lwipstack/lwip-sys/lwip_random.c
+  ../features/lwipstack/lwip-sys/lwip_tcp_isn.c
+  ../features/lwipstack/lwip-sys/arch/lwip_checksum.c
+  ../features/lwipstack/lwip-sys/arch/lwip_memcpy.c
+  ../features/lwipstack/lwip-sys/arch/lwip_sys_arch.c
+  ../features/lwipstack/LWIPStack.cpp
+  ../features/lwipstack/LWIPInterface.cpp
+  ../features/lwipstack/LWIPInterfaceEMAC.cpp
+  ../features/lwipstack/LWIPMemoryManager.cpp
+  ../features/lwipstack/lwip_tools.cpp
+  ../features/netsocket/EMACInterface.cpp
+  ../features/netsocket/EMACMemoryManager.cpp
+  ../features/netsocket/NetworkInterface.cpp
+  ../features/netsocket/NetworkStack.cpp
+  ../features/netsocket/InternetSocket.cpp
+  ../features/netsocket/TCPSocket.cpp
+  ../features/netsocket/TCPServer.cpp
+  ../features/netsocket/UDPSocket.cpp
+  ../features/netsocket/SocketAddress.cpp
+  ../features/netsocket/nsapi_dns.cpp
+  ../features/frameworks/nanostack-libservice/source/libip4string/ip4tos.c
+  ../features/frameworks/nanostack-libservice/source/libip4string/stoip4.c
+  ../features/frameworks/nanostack-libservice/source/libip6string/ip6tos.c
+  ../features/frameworks/nanostack-libservice/source/libip6string/stoip6.c
+  ../features/frameworks/nanostack-libservice/source/libBits/common_functions.c
+  ../features/frameworks/mbed-client-randlib/source/randLIB.c
+)
+
+set(unittest-test-sources
+  features/lwipstack/loopback_bench/test_loopback_bench.cpp
+  stubs/mbed_assert_stub.c
+  stubs/equeue_stub.c
+  stubs/EventQueue_stub.cpp
+  stubs/mbed_shared_queues_stub.cpp
+  target_posix/HostEMAC.cpp
+)
@@ -0,0 +1,10 @@
+####################
+# UNIT TESTS
+####################
+
+# The loopback benchmarks built with lwip.socket-fast-path disabled, so its
+# figures can be compared with the ones of loopback_bench
+include(${CMAKE_CURRENT_LIST_DIR}/../loopback_bench/unittest.cmake)
+
+list(REMOVE_ITEM unittest-definitions MBED_CONF_LWIP_SOCKET_FAST_PATH=1)
+list(APPEND unittest-definitions MBED_CONF_LWIP_SOCKET_FAST_PATH=0)
@@ -0,0 +1,509 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctime>
+#include <vector>
+
+#include "events/EventQueue.h"
+#include "drivers/Timer.h"
+#include "nfc/NFCController.h"
+#include "nfc/NFCControllerDriver.h"
+#include "nfc/NFCRemoteInitiator.h"
+
+#include "stack/transceiver/loopback/loopback.h"
+
+using namespace mbed;
+using namespace mbed::nfc;
+
+#define BITRATE 106000
+#define NDEF_BUFFER_SIZE 4096
+#define MAX_ITERATIONS 100000
+
+typedef std::vector<uint8_t> bytes_t;
+
+// Controller driver giving the loopback transceiver of the target to the NFCController
+class LoopbackDriver : public NFCControllerDriver {
+public:
+    LoopbackDriver(loopback_t *loopback) : _loopback(loopback)
+    {
+    }
+
+    virtual nfc_transceiver_t *initialize(nfc_scheduler_timer_t *scheduler_timer)
+    {
+        if (loopback_init(_loopback, scheduler_timer, BITRATE, LOOPBACK_FRAME_SIZE_MAX) != NFC_OK) {
+            return NULL;
+        }
+        loopback_set_irq_callback(_loopback, &LoopbackDriver::s_irq, this);
+        return loopback_get_transceiver(_loopback);
+    }
+
+    virtual void get_supported_nfc_techs(nfc_tech_t *initiator, nfc_tech_t *target) const
+    {
+        memset(initiator, 0, sizeof(nfc_tech_t));
+        memset(target, 0, sizeof(nfc_tech_t));
+        target->nfc_iso_dep_a = true;
+    }
+
+private:
+    static void s_irq(loopback_t *loopback, void *user_data)
+    {
+        static_cast<LoopbackDriver *>(user_data)->hw_interrupt();
+    }
+
+    loopback_t *_loopback;
+};
+
+// ISO-DEP initiator (PCD) on a loopback transceiver, running the other end with the pump between frames
+class Reader {
+public:
+    Reader(Callback<void()> pump) :
+        _pump(pump), _irq(false), _done(false), _ret(NFC_OK), _block_size(LOOPBACK_FRAME_SIZE_MAX), _block_number(0)
+    {
+    }
+
+    void init()
+    {
+        loopback_init(&_loopback, (nfc_scheduler_timer_t *)&_timer, BITRATE, LOOPBACK_FRAME_SIZE_MAX);
+        loopback_set_irq_callback(&_loopback, &Reader::s_irq, this);
+
+        nfc_tech_t initiators;
+        nfc_tech_t targets;
+        polling_options_t options;
+        memset(&initiators, 0, sizeof(initiators));
+        memset(&targets, 0, sizeof(targets));
+        memset(&options, 0, sizeof(options));
+        initiators.nfc_iso_dep_a = true;
+        transceiver_set_protocols(transceiver(), initiators, targets, options);
+    }
+
+    loopback_t *loopback()
+    {
+        return &_loopback;
+    }
+
+    // Largest I-block sent, longer C-APDUs are chained
+    void set_block_size(size_t block_size)
+    {
+        _block_size = block_size;
+    }
+
+    nfc_err_t poll()
+    {
+        _done = false;
+        transceiver_poll(transceiver(), &Reader::s_transceiver_cb, this);
+        return wait();
+    }
+
+    nfc_err_t rats(bytes_t &ats)
+    {
+        static const uint8_t rats[] = { 0xE0, 0x80 }; // FSD of 256 bytes, CID 0
+        _block_number = 0;
+        return exchange(bytes_t(rats, rats + sizeof(rats)), ats);
+    }
+
+    nfc_err_t deselect()
+    {
+        bytes_t response;
+        nfc_err_t ret = exchange(bytes_t(1, 0xC2), response);
+        if (ret != NFC_OK) {
+            return ret;
+        }
+        return ((response.size() == 1) && (response[0] == 0xC2)) ? NFC_OK : NFC_ERR_PROTOCOL;
+    }
+
+    nfc_err_t apdu(const bytes_t &c_apdu, bytes_t &r_apdu)
+    {
+        bytes_t frame;
+        bytes_t response;
+        size_t offset = 0;
+        nfc_err_t ret;
+
+        do {
+            size_t length = std::min(_block_size - 1, c_apdu.size() - offset);
+            bool chaining = (offset + length) < c_apdu.size();
+            frame.assign(1, 0x02 | (chaining ? 0x10 : 0x00) | _block_number);
+            frame.insert(frame.end(), c_apdu.begin() + offset, c_apdu.begin() + offset + length);
+            offset += length;
+
+            ret = exchange(frame, response);
+            // Grant extensions of the waiting time until the target answers
+            while ((ret == NFC_OK) && (response.size() == 2) && (response[0] == 0xF2)) {
+                frame = response;
+                ret = exchange(frame, response);
+            }
+            if (ret != NFC_OK) {
+                return ret;
+            }
+            if (response.empty()) {
+                return NFC_ERR_PROTOCOL;
+            }
+
+            if (chaining && (response[0] != (0xA2 | _block_number))) {
+                return NFC_ERR_PROTOCOL;
+            }
+            _block_number ^= 1;
+        } while (offset < c_apdu.size());
+
+        // R-APDUs fit in a single I-block with a FSD of 256 bytes
+        if ((response[0] & 0xF2) != 0x02) {
+            return NFC_ERR_PROTOCOL;
+        }
+        r_apdu.assign(response.begin() + 1, response.end());
+        return NFC_OK;
+    }
+
+private:
+    nfc_transceiver_t *transceiver()
+    {
+        return loopback_get_transceiver(&_loopback);
+    }
+
+    nfc_err_t exchange(const bytes_t &frame, bytes_t &response)
+    {
+        ac_buffer_t buffer;
+        ac_buffer_init(&buffer, frame.data(), frame.size());
+        transceiver_set_write(transceiver(), &buffer);
+
+        _done = false;
+        nfc_transceiver_transceive(transceiver(), &Reader::s_transceiver_cb, this);
+        nfc_err_t ret = wait();
+
+        ac_buffer_t read;
+        ac_buffer_dup(&read, transceiver_get_read(transceiver()));
+        response.resize(ac_buffer_reader_readable(&read));
+        ac_buffer_read_n_bytes(&read, response.data(), response.size());
+        return ret;
+    }
+
+    nfc_err_t wait()
+    {
+        for (int i = 0; !_done && (i < MAX_ITERATIONS); i++) {
+            if (_irq) {
+                _irq = false;
+                nfc_scheduler_iteration(transceiver_get_scheduler(transceiver()), EVENT_HW_INTERRUPT);
+            } else {
+                _pump();
+            }
+        }
+        return _done ? _ret : NFC_ERR_TIMEOUT;
+    }
+
+    static void s_irq(loopback_t *loopback, void *user_data)
+    {
+        static_cast<Reader *>(user_data)->_irq = true;
+    }
+
+    static void s_transceiver_cb(nfc_transceiver_t *transceiver, nfc_err_t ret, void *user_data)
+    {
+        Reader *self = static_cast<Reader *>(user_data);
+        self->_done = true;
+        self->_ret = ret;
+    }
+
+    Callback<void()> _pump;
+    loopback_t _loopback;
+    Timer _timer;
+    bool _irq;
+    bool _done;
+    nfc_err_t _ret;
+    size_t _block_size;
+    uint8_t _block_number;
+};
+
+class TestType4RemoteInitiator : public testing::Test, public NFCController::Delegate, public NFCRemoteInitiator::Delegate {
+public:
+    TestType4RemoteInitiator() :
+        driver(&target),
+        controller(&driver, &queue, Span<uint8_t>(ndef_buffer, sizeof(ndef_buffer))),
+        reader(callback(this, &TestType4RemoteInitiator::pump)),
+        connected(false),
+        parsed_count(0)
+    {
+    }
+
+    void pump()
+    {
+        queue.dispatch(0);
+    }
+
+    virtual void on_nfc_initiator_discovered(const SharedPtr<NFCRemoteInitiator> &nfc_initiator)
+    {
+        initiator = nfc_initiator;
+        initiator->set_delegate(this);
+        initiator->connect();
+    }
+
+    virtual void on_connected()
+    {
+        connected = true;
+    }
+
+    virtual void parse_ndef_message(const Span<const uint8_t> &buffer)
+    {
+        parsed.assign(buffer.data(), buffer.data() + buffer.size());
+        parsed_count++;
+    }
+
+    virtual size_t build_ndef_message(const Span<uint8_t> &buffer)
+    {
+        size_t length = std::min(message.size(), (size_t)buffer.size());
+        if (length > 0) {
+            memcpy(buffer.data(), message.data(), length);
+        }
+        return length;
+    }
+
+protected:
+    void SetUp()
+    {
+        controller.set_delegate(this);
+        ASSERT_EQ(NFC_OK, controller.initialize());
+
+        reader.init();
+        loopback_pair(&target, reader.loopback());
+
+        ASSERT_EQ(NFC_OK, controller.configure_rf_protocols(controller.get_supported_rf_protocols()));
+        ASSERT_EQ(NFC_OK, controller.start_discovery());
+        pump();
+
+        ASSERT_EQ(NFC_OK, reader.poll());
+        bytes_t ats;
+        ASSERT_EQ(NFC_OK, reader.rats(ats));
+        ASSERT_EQ(5, ats.size());
+        ASSERT_TRUE(initiator);
+        ASSERT_TRUE(connected);
+    }
+
+    void command(const uint8_t *header, const bytes_t &data, int le, bytes_t &response, uint16_t sw = 0x9000)
+    {
+        bytes_t c_apdu(header, header + 4);
+        if (!data.empty()) {
+            c_apdu.push_back(data.size());
+            c_apdu.insert(c_apdu.end(), data.begin(), data.end());
+        }
+        if (le >= 0) {
+            c_apdu.push_back(le);
+        }
+
+        bytes_t r_apdu;
+        ASSERT_EQ(NFC_OK, reader.apdu(c_apdu, r_apdu));
+        ASSERT_GE(r_apdu.size(), 2);
+        EXPECT_EQ(sw, (r_apdu[r_apdu.size() - 2] << 8) | r_apdu[r_apdu.size() - 1]);
+        response.assign(r_apdu.begin(), r_apdu.end() - 2);
+    }
+
+    void select_application()
+    {
+        static const uint8_t header[] = { 0x00, 0xA4, 0x04, 0x00 };
+        static const uint8_t aid[] = { 0xD2, 0x76, 0x00, 0x00, 0x85, 0x01, 0x01 };
+        bytes_t response;
+        command(header, bytes_t(aid, aid + sizeof(aid)), 0, response);
+    }
+
+    void select_file(uint16_t file)
+    {
+        static const uint8_t header[] = { 0x00, 0xA4, 0x00, 0x0C };
+        bytes_t id;
+        id.push_back(file >> 8);
+        id.push_back(file & 0xFF);
+        bytes_t response;
+        command(header, id, -1, response);
+    }
+
+    void read_binary(size_t offset, size_t length, bytes_t &data)
+    {
+        uint8_t header[] = { 0x00, 0xB0, (uint8_t)(offset >> 8), (uint8_t)(offset & 0xFF) };
+        command(header, bytes_t(), length, data);
+        ASSERT_EQ(length, data.size());
+    }
+
+    void update_binary(size_t offset, const bytes_t &data)
+    {
+        uint8_t header[] = { 0x00, 0xD6, (uint8_t)(offset >> 8), (uint8_t)(offset & 0xFF) };
+        bytes_t response;
+        command(header, data, -1, response);
+    }
+
+    // Select the NDEF application and read the maximum R-APDU and C-APDU data sizes from the CC file
+    void open_ndef(size_t &max_read, size_t &max_write)
+    {
+        bytes_t cc;
+        select_application();
+        select_file(0xE103);
+        read_binary(0, 15, cc);
+        max_read = (cc[3] << 8) | cc[4];
+        max_write = (cc[5] << 8) | cc[6];
+        select_file(0xA443);
+    }
+
+    void read_ndef(bytes_t &content)
+    {
+        size_t max_read, max_write;
+        open_ndef(max_read, max_write);
+
+        bytes_t data;
+        read_binary(0, 2, data);
+        size_t length = (data[0] << 8) | data[1];
+
+        content.clear();
+        while (content.size() < length) {
+            read_binary(2 + content.size(), std::min(max_read, length - content.size()), data);
+            content.insert(content.end(), data.begin(), data.end());
+        }
+    }
+
+    void write_ndef(const bytes_t &content)
+    {
+        size_t max_read, max_write;
+        open_ndef(max_read, max_write);
+
+        update_binary(0, bytes_t(2, 0));
+        for (size_t offset = 0; offset < content.size(); offset += max_write) {
+            size_t length = std::min(max_write, content.size() - offset);
+            update_binary(2 + offset, bytes_t(content.begin() + offset, content.begin() + offset + length));
+        }
+        bytes_t header;
+        header.push_back(content.size() >> 8);
+        header.push_back(content.size() & 0xFF);
+        update_binary(0, header);
+
+        // Content is parsed when the target is deselected, once it is activated again
+        ASSERT_EQ(NFC_OK, reader.deselect());
+        bytes_t ats;
+        ASSERT_EQ(NFC_OK, reader.rats(ats));
+    }
+
+    uint64_t air_time_us()
+    {
+        return target.stats.airTimeUs + reader.loopback()->stats.airTimeUs;
+    }
+
+    void report(const char *name, size_t size, uint64_t air_time, clock_t cpu_time)
+    {
+        double cpu_us = ((double)cpu_time * 1000000) / CLOCKS_PER_SEC;
+        printf("[ BENCH    ] %s: %u bytes, %u frames, %.1f ms on air (%.0f B/s at %u bit/s), %.0f us of CPU\n", name,
+               (unsigned)size, (unsigned)(target.stats.frames + reader.loopback()->stats.frames),
+               air_time / 1000.0, (size * 1000000.0) / air_time, BITRATE, cpu_us);
+    }
+
+    static bytes_t pattern(size_t size)
+    {
+        bytes_t data(size);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = (i * 7 + (i >> 8)) & 0xFF;
+        }
+        return data;
+    }
+
+    events::EventQueue queue;
+    loopback_t target;
+    LoopbackDriver driver;
+    uint8_t ndef_buffer[NDEF_BUFFER_SIZE];
+    NFCController controller;
+    Reader reader;
+    SharedPtr<NFCRemoteInitiator> initiator;
+
+    bool connected;
+    bytes_t message;
+    bytes_t parsed;
+    int parsed_count;
+};
+
+TEST_F(TestType4RemoteInitiator, test_ndef_read_throughput)
+{
+    message = pattern(NDEF_BUFFER_SIZE - 96);
+
+    uint64_t air_time = air_time_us();
+    clock_t start = clock();
+
+    bytes_t content;
+    read_ndef(content);
+
+    clock_t cpu_time = clock() - start;
+    EXPECT_EQ(message, content);
+
+    report("NDEF read", content.size(), air_time_us() - air_time, cpu_time);
+}
+
+TEST_F(TestType4RemoteInitiator, test_ndef_write_throughput)
+{
+    bytes_t content = pattern(NDEF_BUFFER_SIZE - 96);
+
+    uint64_t air_time = air_time_us();
+    clock_t start = clock();
+
+    write_ndef(content);
+
+    clock_t cpu_time = clock() - start;
+    EXPECT_EQ(1, parsed_count);
+    EXPECT_EQ(content, parsed);
+
+    report("NDEF write", content.size(), air_time_us() - air_time, cpu_time);
+}
+
+TEST_F(TestType4RemoteInitiator, test_chained_c_apdu)
+{
+    bytes_t content = pattern(600);
+
+    // Each C-APDU is received in several I-blocks
+    reader.set_block_size(32);
+    write_ndef(content);
+
+    EXPECT_EQ(1, parsed_count);
+    EXPECT_EQ(content, parsed);
+
+    reader.set_block_size(LOOPBACK_FRAME_SIZE_MAX);
+    message = content;
+    bytes_t read;
+    read_ndef(read);
+    EXPECT_EQ(content, read);
+}
+
+TEST_F(TestType4RemoteInitiator, test_c_apdu_too_large)
+{
+    select_application();
+    select_file(0xA443);
+
+    // 4 header bytes, Lc, 255 data bytes and Le do not fit in the receive buffer of the target
+    static const uint8_t header[] = { 0x00, 0xD6, 0x00, 0x02 };
+    bytes_t response;
+    reader.set_block_size(64);
+    command(header, bytes_t(255, 0xAA), 0, response, 0x6700);
+
+    // Next C-APDU is received again
+    reader.set_block_size(LOOPBACK_FRAME_SIZE_MAX);
+    bytes_t data;
+    read_binary(0, 2, data);
+}
+
+TEST_F(TestType4RemoteInitiator, test_loopback_errors)
+{
+    loopback_t loopback;
+    EXPECT_EQ(NFC_ERR_PARAMS, loopback_init(&loopback, NULL, 0, 64));
+    EXPECT_EQ(NFC_ERR_PARAMS, loopback_init(&loopback, NULL, BITRATE, LOOPBACK_FRAME_SIZE_MAX + 1));
+
+    // Frames longer than the peer can receive are not sent
+    bytes_t response;
+    select_application();
+    target.frameSize = 16;
+    bytes_t r_apdu;
+    EXPECT_EQ(NFC_ERR_BUFFER_TOO_SMALL, reader.apdu(bytes_t(32, 0x00), r_apdu));
+}
@@ -0,0 +1,48 @@
+####################
+# UNIT TESTS
+####################
+
+# Add test specific include paths
+set(unittest-includes ${unittest-includes}
+  ../features/nfc
+  ../features/nfc/nfc
+  ../features/nfc/stack
+  ../features/nfc/acore
+)
+
+# Source files
+set(unittest-sources
+  ../features/nfc/acore/source/ac_buffer.c
+  ../features/nfc/acore/source/ac_buffer_builder.c
+  ../features/nfc/acore/source/ac_buffer_reader.c
+  ../features/nfc/acore/source/ac_stream.c
+  ../features/nfc/stack/platform/nfc_scheduler.c
+  ../features/nfc/stack/transceiver/transceiver.c
+  ../features/nfc/stack/transceiver/loopback/loopback.c
+  ../features/nfc/stack/tech/isodep/isodep_target.c
+  ../features/nfc/stack/tech/iso7816/iso7816.c
+  ../features/nfc/stack/tech/iso7816/iso7816_app.c
+  ../features/nfc/stack/tech/type4/type4_target.c
+  ../features/nfc/stack/ndef/ndef.c
+  ../features/nfc/source/nfc/NFCController.cpp
+  ../features/nfc/source/nfc/NFCControllerDriver.cpp
+  ../features/nfc/source/nfc/NFCRemoteEndpoint.cpp
+  ../features/nfc/source/nfc/NFCRemoteInitiator.cpp
+  ../features/nfc/source/nfc/NFCNDEFCapable.cpp
+  ../features/nfc/source/nfc/Type4RemoteInitiator.cpp
+  ../events/EventQueue.cpp
+  ../events/equeue/equeue.c
+)
+
+# Test files
+set(unittest-test-sources
+  features/nfc/Type4RemoteInitiator/test_Type4RemoteInitiator.cpp
+  stubs/Timer_stub.cpp
+  stubs/TimerEvent_stub.cpp
+  stubs/Ticker_stub.cpp
+  stubs/mbed_sleep_manager_stub.c
+  stubs/mbed_assert_stub.c
+  stubs/mbed_critical_stub.c
+  stubs/us_ticker_stub.cpp
+  stubs/equeue_sim.c
+)
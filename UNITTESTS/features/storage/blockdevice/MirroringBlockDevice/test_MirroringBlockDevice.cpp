@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * MirroringBlockDevice tests: writes that land on every device, reads that
+ * fail over to another device and that spread over the devices, and read
+ * throughput of concurrent readers on the POSIX rtos backend with heap
+ * devices that simulate a latency per operation. Benchmark results are
+ * printed and recorded as gtest properties.
+ */
+
+#include "gtest/gtest.h"
+#include "bench_timer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "HeapBlockDevice.h"
+#include "MirroringBlockDevice.h"
+#include "rtos/Thread.h"
+
+namespace {
+
+/** Heap device that sleeps for the latency of reads and can fail them */
+class LatencyBlockDevice : public HeapBlockDevice {
+public:
+    LatencyBlockDevice(bd_size_t size, bd_size_t read, bd_size_t program, bd_size_t erase)
+        : HeapBlockDevice(size, read, program, erase), read_us(0), fail_reads(false)
+    {
+    }
+
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        if (read_us) {
+            bench_sleep_us(read_us);
+        }
+        if (fail_reads) {
+            return BD_ERROR_DEVICE_ERROR;
+        }
+        return HeapBlockDevice::read(buffer, addr, size);
+    }
+
+    uint32_t read_us;
+    bool fail_reads;
+};
+
+const bd_size_t block_size = 512;
+const bd_size_t device_size = 16 * 1024;
+
+}
+
+class TestMirroringBlockDevice : public testing::Test {
+protected:
+    TestMirroringBlockDevice()
+        : heap0(device_size, 1, 256, block_size)
+        , heap1(device_size + 4 * block_size, 16, 256, 2 * block_size)
+    {
+        bds[0] = &heap0;
+        bds[1] = &heap1;
+    }
+
+    virtual void SetUp()
+    {
+        for (size_t i = 0; i < sizeof(pattern); i++) {
+            pattern[i] = (i * 7) ^ (i >> 9);
+        }
+    }
+
+    LatencyBlockDevice heap0, heap1;
+    BlockDevice *bds[2];
+    uint8_t pattern[8 * block_size];
+    uint8_t buffer[8 * block_size];
+};
+
+TEST_F(TestMirroringBlockDevice, geometry)
+{
+    MirroringBlockDevice bd(bds);
+    ASSERT_EQ(BD_ERROR_OK, bd.init());
+
+    // The smallest device and the largest block sizes
+    EXPECT_EQ(device_size, bd.size());
+    EXPECT_EQ(16u, bd.get_read_size());
+    EXPECT_EQ(256u, bd.get_program_size());
+    EXPECT_EQ(2 * block_size, bd.get_erase_size());
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+}
+
+TEST_F(TestMirroringBlockDevice, writes_land_on_every_device)
+{
+    MirroringBlockDevice bd(bds);
+    ASSERT_EQ(BD_ERROR_OK, bd.init());
+
+    EXPECT_EQ(BD_ERROR_OK, bd.erase(0, sizeof(pattern)));
+    EXPECT_EQ(BD_ERROR_OK, bd.program(pattern, 2 * block_size, sizeof(pattern)));
+    EXPECT_EQ(BD_ERROR_OK, bd.trim(0, 2 * block_size));
+    EXPECT_EQ(BD_ERROR_OK, bd.sync());
+
+    for (size_t i = 0; i < 2; i++) {
+        memset(buffer, 0, sizeof(buffer));
+        EXPECT_EQ(BD_ERROR_OK, bds[i]->read(buffer, 2 * block_size, sizeof(buffer)));
+        EXPECT_EQ(0, memcmp(buffer, pattern, sizeof(buffer))) << "device " << i;
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    EXPECT_EQ(BD_ERROR_OK, bd.read(buffer, 2 * block_size, sizeof(buffer)));
+    EXPECT_EQ(0, memcmp(buffer, pattern, sizeof(buffer)));
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+}
+
+TEST_F(TestMirroringBlockDevice, reads_fail_over_to_another_device)
+{
+    MirroringBlockDevice bd(bds);
+    ASSERT_EQ(BD_ERROR_OK, bd.init());
+    EXPECT_EQ(BD_ERROR_OK, bd.program(pattern, 0, sizeof(pattern)));
+
+    heap0.fail_reads = true;
+    for (int i = 0; i < 4; i++) {
+        memset(buffer, 0, sizeof(buffer));
+        EXPECT_EQ(BD_ERROR_OK, bd.read(buffer, 0, sizeof(buffer)));
+        EXPECT_EQ(0, memcmp(buffer, pattern, sizeof(buffer)));
+    }
+    EXPECT_EQ(0u, bd.get_read_count(0));
+    EXPECT_EQ(4u, bd.get_read_count(1));
+
+    heap1.fail_reads = true;
+    EXPECT_EQ(BD_ERROR_DEVICE_ERROR, bd.read(buffer, 0, sizeof(buffer)));
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+}
+
+TEST_F(TestMirroringBlockDevice, reads_take_turns)
+{
+    MirroringBlockDevice bd(bds);
+    ASSERT_EQ(BD_ERROR_OK, bd.init());
+
+    for (int i = 0; i < 8; i++) {
+        EXPECT_EQ(BD_ERROR_OK, bd.read(buffer, 0, sizeof(buffer)));
+    }
+    EXPECT_EQ(4u, bd.get_read_count(0));
+    EXPECT_EQ(4u, bd.get_read_count(1));
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+}
+
+namespace {
+
+struct reader {
+    BlockDevice *bd;
+    int reads;
+    int err;
+    std::vector<uint8_t> buffer;
+
+    void run()
+    {
+        for (int i = 0; i < reads && !err; i++) {
+            err = bd->read(&buffer[0], 0, buffer.size());
+        }
+    }
+};
+
+/** Time for readers threads to read from bd */
+double read_us(BlockDevice *bd, size_t readers, int reads)
+{
+    std::vector<reader> r(readers);
+    std::vector<rtos::Thread *> threads(readers);
+    bench_time_t start = bench_now();
+    for (size_t i = 0; i < readers; i++) {
+        r[i].bd = bd;
+        r[i].reads = reads;
+        r[i].err = 0;
+        r[i].buffer.resize(block_size);
+        threads[i] = new rtos::Thread;
+        EXPECT_EQ(osOK, threads[i]->start(mbed::callback(&r[i], &reader::run)));
+    }
+    for (size_t i = 0; i < readers; i++) {
+        threads[i]->join();
+        delete threads[i];
+        EXPECT_EQ(BD_ERROR_OK, r[i].err);
+    }
+    return bench_seconds_since(start) * 1e6;
+}
+
+}
+
+TEST(BenchMirroringBlockDevice, concurrent_readers)
+{
+    // Devices that take 1ms per read, readers that read 16 blocks each
+    const int reads = 16;
+    LatencyBlockDevice *heaps[4];
+    BlockDevice *children[4];
+    for (size_t i = 0; i < 4; i++) {
+        heaps[i] = new LatencyBlockDevice(device_size, 1, 1, block_size);
+        heaps[i]->read_us = 1000;
+        children[i] = heaps[i];
+    }
+
+    const size_t counts[] = { 1, 2, 4 };
+    double single_us = 0;
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        MirroringBlockDevice bd(children, counts[c]);
+        ASSERT_EQ(BD_ERROR_OK, bd.init());
+        double us = read_us(&bd, 4, reads);
+
+        char name[32];
+        snprintf(name, sizeof(name), "mirror%u_reads_per_s", (unsigned)counts[c]);
+        bench_report(name, 4 * reads * 1e6 / us, "reads/s");
+
+        if (counts[c] == 1) {
+            single_us = us;
+        } else {
+            // Readers are spread over the devices
+            EXPECT_GT(single_us, us * 3 / 2);
+            for (size_t i = 0; i < counts[c]; i++) {
+                EXPECT_LT(0u, bd.get_read_count(i));
+            }
+        }
+        EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+    }
+
+    for (size_t i = 0; i < 4; i++) {
+        delete heaps[i];
+    }
+}
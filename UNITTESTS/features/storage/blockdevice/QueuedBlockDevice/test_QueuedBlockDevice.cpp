@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * BlockDeviceRequestQueue and QueuedBlockDevice tests, on the POSIX rtos
+ * backend, and a queue depth benchmark on a simulated device that charges a
+ * fixed latency per operation and a seek latency proportional to the
+ * distance from the previous operation.
+ * Benchmark results are printed and recorded as gtest properties.
+ */
+
+#include "gtest/gtest.h"
+#include "bench_timer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "BlockDeviceRequestQueue.h"
+#include "HeapBlockDevice.h"
+#include "QueuedBlockDevice.h"
+#include "rtos/Semaphore.h"
+#include "rtos/ThisThread.h"
+#include "rtos/Thread.h"
+
+namespace {
+
+void prepare(bd_request_t &request, bd_request_type_t type, void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    request.type = type;
+    request.buffer = buffer;
+    request.addr = addr;
+    request.size = size;
+}
+
+/** Heap backed device that counts operations and sleeps for their latency */
+class LatencyBlockDevice : public HeapBlockDevice {
+public:
+    LatencyBlockDevice(bd_size_t size, bd_size_t block)
+        : HeapBlockDevice(size, block), ops(0), op_us(0), seek_us_per_kb(0), init_us(0), _position(0)
+    {
+    }
+
+    virtual int init()
+    {
+        if (init_us) {
+            bench_sleep_us(init_us);
+        }
+        return HeapBlockDevice::init();
+    }
+
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        access(addr, size);
+        return HeapBlockDevice::read(buffer, addr, size);
+    }
+
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        access(addr, size);
+        return HeapBlockDevice::program(buffer, addr, size);
+    }
+
+    virtual int erase(bd_addr_t addr, bd_size_t size)
+    {
+        access(addr, size);
+        return HeapBlockDevice::erase(addr, size);
+    }
+
+    uint32_t ops;
+    uint32_t op_us;
+    uint32_t seek_us_per_kb;
+    uint32_t init_us;
+
+private:
+    void access(bd_addr_t addr, bd_size_t size)
+    {
+        ops++;
+        bd_size_t distance = addr > _position ? addr - _position : _position - addr;
+        uint32_t us = op_us + seek_us_per_kb * (distance / 1024);
+        if (us) {
+            bench_sleep_us(us);
+        }
+        _position = addr + size;
+    }
+
+    bd_addr_t _position;
+};
+
+/** Completions of requests served on the worker thread */
+class Completions {
+public:
+    Completions() : count(0), errors(0)
+    {
+    }
+
+    void done(bd_request_t *request, int err)
+    {
+        order.push_back(request);
+        count++;
+        if (err) {
+            errors++;
+        }
+        _done.release();
+    }
+
+    mbed::Callback<void(bd_request_t *, int)> callback()
+    {
+        return mbed::callback(this, &Completions::done);
+    }
+
+    void wait(int n)
+    {
+        for (int i = 0; i < n; i++) {
+            ASSERT_LT(0, _done.wait(1000));
+        }
+    }
+
+    std::vector<bd_request_t *> order;
+    int count;
+    int errors;
+
+private:
+    rtos::Semaphore _done;
+};
+
+/** Initializes a device from its own thread */
+struct Initializer {
+    BlockDevice *bd;
+    int err;
+
+    void run()
+    {
+        err = bd->init();
+    }
+};
+
+const bd_size_t block_size = 512;
+
+}
+
+class TestBlockDeviceRequestQueue : public testing::Test {
+protected:
+    BlockDeviceRequestQueue queue;
+    bd_request_t requests[8];
+};
+
+TEST_F(TestBlockDeviceRequestQueue, elevator_order)
+{
+    const bd_addr_t addrs[4] = { 5, 1, 9, 3 };
+    for (int i = 0; i < 4; i++) {
+        prepare(requests[i], BD_REQUEST_READ, NULL, addrs[i] * block_size, block_size);
+        queue.push(&requests[i]);
+    }
+
+    // Lowest address first, then upwards from the end of each request
+    EXPECT_EQ(&requests[1], queue.pop());
+    prepare(requests[4], BD_REQUEST_READ, NULL, 0, block_size);
+    queue.push(&requests[4]);
+    EXPECT_EQ(&requests[3], queue.pop());
+    EXPECT_EQ(&requests[0], queue.pop());
+    EXPECT_EQ(&requests[2], queue.pop());
+
+    // Wraps around once nothing is left ahead
+    EXPECT_EQ(&requests[4], queue.pop());
+    EXPECT_EQ(NULL, queue.pop());
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(TestBlockDeviceRequestQueue, merges_adjacent_requests)
+{
+    // 2, 0, 3 and 1 end up as a single request covering 0 to 3
+    const bd_addr_t addrs[4] = { 2, 0, 3, 1 };
+    for (int i = 0; i < 4; i++) {
+        prepare(requests[i], BD_REQUEST_PROGRAM, NULL, addrs[i] * block_size, block_size);
+        queue.push(&requests[i]);
+    }
+    EXPECT_EQ(3u, queue.get_merge_count());
+
+    bd_request_t *request = queue.pop();
+    EXPECT_EQ(0u, request->addr);
+    EXPECT_EQ(4 * block_size, request->span);
+    EXPECT_TRUE(queue.empty());
+
+    // Merged requests follow each other in address order
+    bd_addr_t addr = 0;
+    for (bd_request_t *segment = request; segment; segment = segment->merged) {
+        EXPECT_EQ(addr, segment->addr);
+        addr += segment->size;
+    }
+    EXPECT_EQ(4 * block_size, addr);
+
+    // Each merged request is completed
+    Completions completions;
+    for (int i = 0; i < 4; i++) {
+        requests[i].callback = mbed::callback(&completions, &Completions::done);
+    }
+    BlockDeviceRequestQueue::complete(request, 0);
+    EXPECT_EQ(4, completions.count);
+}
+
+TEST_F(TestBlockDeviceRequestQueue, merges_only_same_type_up_to_max_size)
+{
+    BlockDeviceRequestQueue limited(2 * block_size);
+    prepare(requests[0], BD_REQUEST_ERASE, NULL, 0, block_size);
+    prepare(requests[1], BD_REQUEST_TRIM, NULL, block_size, block_size);
+    prepare(requests[2], BD_REQUEST_ERASE, NULL, 2 * block_size, block_size);
+    prepare(requests[3], BD_REQUEST_ERASE, NULL, 3 * block_size, block_size);
+    prepare(requests[4], BD_REQUEST_ERASE, NULL, 4 * block_size, block_size);
+    for (int i = 0; i < 5; i++) {
+        limited.push(&requests[i]);
+    }
+
+    EXPECT_EQ(1u, limited.get_merge_count());
+    EXPECT_EQ(&requests[0], limited.pop());
+    EXPECT_EQ(&requests[1], limited.pop());
+    EXPECT_EQ(&requests[2], limited.pop());
+    EXPECT_EQ(2 * block_size, requests[2].span);
+    EXPECT_EQ(&requests[4], limited.pop());
+}
+
+TEST_F(TestBlockDeviceRequestQueue, keeps_order_of_overlapping_requests)
+{
+    // Reads may pass each other, but not a program to the same block
+    prepare(requests[0], BD_REQUEST_READ, NULL, 4 * block_size, block_size);
+    prepare(requests[1], BD_REQUEST_READ, NULL, 4 * block_size, block_size);
+    prepare(requests[2], BD_REQUEST_PROGRAM, NULL, 4 * block_size, block_size);
+    prepare(requests[3], BD_REQUEST_READ, NULL, 0, block_size);
+    prepare(requests[4], BD_REQUEST_SYNC, NULL, 0, 0);
+    prepare(requests[5], BD_REQUEST_READ, NULL, 0, block_size);
+    for (int i = 0; i < 6; i++) {
+        queue.push(&requests[i]);
+    }
+
+    EXPECT_EQ(&requests[0], queue.pop());
+    EXPECT_EQ(&requests[1], queue.pop());
+    // The read of another block may pass the program
+    EXPECT_EQ(&requests[3], queue.pop());
+    EXPECT_EQ(&requests[2], queue.pop());
+    EXPECT_EQ(&requests[4], queue.pop());
+    EXPECT_EQ(&requests[5], queue.pop());
+    EXPECT_EQ(0u, queue.get_merge_count());
+}
+
+class TestQueuedBlockDevice : public testing::Test {
+protected:
+    TestQueuedBlockDevice()
+        : heap(64 * block_size, block_size), bd(&heap)
+    {
+    }
+
+    virtual void SetUp()
+    {
+        ASSERT_EQ(BD_ERROR_OK, bd.init());
+        for (size_t i = 0; i < sizeof(pattern); i++) {
+            pattern[i] = (i * 7) ^ (i >> 9);
+        }
+    }
+
+    virtual void TearDown()
+    {
+        EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+    }
+
+    LatencyBlockDevice heap;
+    QueuedBlockDevice bd;
+    Completions completions;
+    uint8_t pattern[8 * block_size];
+    uint8_t buffer[8 * block_size];
+};
+
+TEST_F(TestQueuedBlockDevice, program_read)
+{
+    bd_request_t erase, program, read;
+    prepare(erase, BD_REQUEST_ERASE, NULL, 0, sizeof(pattern));
+    prepare(program, BD_REQUEST_PROGRAM, pattern, 0, sizeof(pattern));
+    prepare(read, BD_REQUEST_READ, buffer, 0, sizeof(buffer));
+    erase.callback = program.callback = read.callback = completions.callback();
+
+    EXPECT_EQ(BD_ERROR_OK, bd.submit(&erase));
+    EXPECT_EQ(BD_ERROR_OK, bd.submit(&program));
+    EXPECT_EQ(BD_ERROR_OK, bd.submit(&read));
+    completions.wait(3);
+
+    EXPECT_EQ(0, completions.errors);
+    EXPECT_EQ(&erase, completions.order[0]);
+    EXPECT_EQ(&program, completions.order[1]);
+    EXPECT_EQ(&read, completions.order[2]);
+    EXPECT_EQ(0, memcmp(buffer, pattern, sizeof(buffer)));
+}
+
+TEST_F(TestQueuedBlockDevice, merged_requests_with_contiguous_buffers_take_one_call)
+{
+    EXPECT_EQ(BD_ERROR_OK, bd.program(pattern, 0, sizeof(pattern)));
+
+    // Keep the worker busy while the reads are queued
+    heap.op_us = 20000;
+    bd_request_t slow, reads[8];
+    uint8_t other[block_size];
+    prepare(slow, BD_REQUEST_READ, other, 32 * block_size, block_size);
+    slow.callback = completions.callback();
+    EXPECT_EQ(BD_ERROR_OK, bd.submit(&slow));
+    rtos::ThisThread::sleep_for(5);
+
+    for (int i = 7; i >= 0; i--) {
+        prepare(reads[i], BD_REQUEST_READ, &buffer[i * block_size], i * block_size, block_size);
+        reads[i].callback = completions.callback();
+        EXPECT_EQ(BD_ERROR_OK, bd.submit(&reads[i]));
+    }
+    completions.wait(9);
+
+    EXPECT_EQ(0, completions.errors);
+    EXPECT_EQ(7u, bd.get_merge_count());
+    // The program, the first read and the merged reads
+    EXPECT_EQ(3u, heap.ops);
+    EXPECT_EQ(0, memcmp(buffer, pattern, sizeof(buffer)));
+}
+
+TEST_F(TestQueuedBlockDevice, deinit_completes_queued_requests)
+{
+    heap.op_us = 1000;
+    bd_request_t reads[4];
+    for (int i = 0; i < 4; i++) {
+        prepare(reads[i], BD_REQUEST_READ, &buffer[i * block_size], 8 * i * block_size, block_size);
+        reads[i].callback = completions.callback();
+        EXPECT_EQ(BD_ERROR_OK, bd.submit(&reads[i]));
+    }
+
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+    EXPECT_EQ(4, completions.count);
+
+    // Not accepted until initialized again
+    EXPECT_EQ(BD_ERROR_DEVICE_ERROR, bd.submit(&reads[0]));
+    EXPECT_EQ(BD_ERROR_OK, bd.init());
+}
+
+TEST(TestQueuedBlockDeviceInit, concurrent_init_returns_once_usable)
+{
+    LatencyBlockDevice heap(64 * block_size, block_size);
+    heap.init_us = 20000;
+    QueuedBlockDevice bd(&heap);
+    Initializer first = { &bd, BD_ERROR_DEVICE_ERROR };
+    rtos::Thread thread;
+    ASSERT_EQ(osOK, thread.start(mbed::callback(&first, &Initializer::run)));
+    rtos::ThisThread::sleep_for(5);
+
+    // Returns once the first init() has started the device and the worker
+    EXPECT_EQ(BD_ERROR_OK, bd.init());
+    uint8_t data[block_size];
+    EXPECT_EQ(BD_ERROR_OK, bd.read(data, 0, block_size));
+    thread.join();
+    EXPECT_EQ(BD_ERROR_OK, first.err);
+
+    // Usable until both references are released
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+    EXPECT_EQ(BD_ERROR_OK, bd.read(data, 0, block_size));
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+    EXPECT_EQ(BD_ERROR_DEVICE_ERROR, bd.read(data, 0, block_size));
+}
+
+TEST_F(TestQueuedBlockDevice, rejects_invalid_requests)
+{
+    bd_request_t read, erase;
+    prepare(read, BD_REQUEST_READ, NULL, 0, block_size);
+    prepare(erase, BD_REQUEST_ERASE, NULL, 1, block_size);
+    EXPECT_EQ(BD_ERROR_DEVICE_ERROR, bd.submit(&read));
+    EXPECT_EQ(BD_ERROR_DEVICE_ERROR, bd.submit(&erase));
+    EXPECT_EQ(0, completions.count);
+}
+
+namespace {
+
+/** Keeps up to depth requests of a workload queued */
+class DepthLimiter {
+public:
+    DepthLimiter(int depth) : _slots(depth, depth), _depth(depth)
+    {
+    }
+
+    void done(bd_request_t *request, int err)
+    {
+        _slots.release();
+    }
+
+    void submit(QueuedBlockDevice &bd, bd_request_t *request)
+    {
+        _slots.wait();
+        request->callback = mbed::callback(this, &DepthLimiter::done);
+        EXPECT_EQ(BD_ERROR_OK, bd.submit(request));
+    }
+
+    void drain()
+    {
+        for (int i = 0; i < _depth; i++) {
+            _slots.wait();
+        }
+    }
+
+private:
+    rtos::Semaphore _slots;
+    int _depth;
+};
+
+}
+
+TEST(BenchQueuedBlockDevice, queue_depth_scaling)
+{
+    // Eight files read sequentially in 4KB requests, interleaved like concurrent readers would
+    const bd_size_t request_size = 4096;
+    const int streams = 8;
+    const int per_stream = 32;
+    const int total = streams * per_stream;
+    const bd_size_t stream_size = per_stream * request_size;
+
+    LatencyBlockDevice dev(streams * stream_size, block_size);
+    dev.op_us = 200;
+    dev.seek_us_per_kb = 2;
+    QueuedBlockDevice bd(&dev);
+    ASSERT_EQ(BD_ERROR_OK, bd.init());
+
+    std::vector<uint8_t> data(streams * stream_size);
+    std::vector<bd_request_t> requests(total);
+    const int depths[] = { 1, 2, 4, 8, 16, 32 };
+    uint32_t ops_at_depth_1 = 0, ops_at_depth_32 = 0;
+    double us_at_depth_1 = 0, us_at_depth_32 = 0;
+
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        DepthLimiter limiter(depths[d]);
+        dev.ops = 0;
+        bench_time_t start = bench_now();
+        for (int i = 0; i < total; i++) {
+            bd_addr_t addr = (i % streams) * stream_size + (i / streams) * request_size;
+            prepare(requests[i], BD_REQUEST_READ, &data[addr], addr, request_size);
+            limiter.submit(bd, &requests[i]);
+        }
+        limiter.drain();
+        double us = bench_seconds_since(start) * 1e6 / total;
+
+        char name[32];
+        snprintf(name, sizeof(name), "qd%d_us_per_request", depths[d]);
+        bench_report(name, us, "us");
+        snprintf(name, sizeof(name), "qd%d_device_ops", depths[d]);
+        bench_report(name, dev.ops, "ops");
+
+        if (depths[d] == 1) {
+            ops_at_depth_1 = dev.ops;
+            us_at_depth_1 = us;
+        } else if (depths[d] == 32) {
+            ops_at_depth_32 = dev.ops;
+            us_at_depth_32 = us;
+        }
+    }
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+
+    // Deeper queues merge the streams into fewer, closer operations
+    EXPECT_EQ((uint32_t)total, ops_at_depth_1);
+    EXPECT_GT(ops_at_depth_1 / 2, ops_at_depth_32);
+    EXPECT_GT(us_at_depth_1, us_at_depth_32);
+}
@@ -0,0 +1,22 @@
+
+####################
+# UNIT TESTS
+####################
+
+# The worker thread runs on the POSIX backend, so completions and benchmarks use real threads
+set(unittest-rtos posix)
+
+set(unittest-includes ${unittest-includes}
+  ../features/storage/blockdevice
+)
+
+set(unittest-sources
+  ../features/storage/blockdevice/BlockDeviceRequestQueue.cpp
+  ../features/storage/blockdevice/HeapBlockDevice.cpp
+  ../features/storage/blockdevice/QueuedBlockDevice.cpp
+)
+
+set(unittest-test-sources
+  features/storage/blockdevice/QueuedBlockDevice/test_QueuedBlockDevice.cpp
+  stubs/mbed_assert_stub.c
+)
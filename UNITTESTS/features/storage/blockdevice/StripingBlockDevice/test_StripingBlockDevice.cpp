@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * StripingBlockDevice tests: layout of the stripe units on the devices,
+ * accesses within and across units, and throughput on the POSIX rtos
+ * backend with heap devices that simulate a latency per operation.
+ * Benchmark results are printed and recorded as gtest properties.
+ */
+
+#include "gtest/gtest.h"
+#include "bench_timer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "HeapBlockDevice.h"
+#include "StripingBlockDevice.h"
+
+namespace {
+
+/** Heap device that counts operations and sleeps for their latency */
+class LatencyBlockDevice : public HeapBlockDevice {
+public:
+    LatencyBlockDevice(bd_size_t size, bd_size_t read, bd_size_t program, bd_size_t erase)
+        : HeapBlockDevice(size, read, program, erase), ops(0), op_us(0), us_per_kb(0)
+    {
+    }
+
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        access(size);
+        return HeapBlockDevice::read(buffer, addr, size);
+    }
+
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        access(size);
+        return HeapBlockDevice::program(buffer, addr, size);
+    }
+
+    virtual int erase(bd_addr_t addr, bd_size_t size)
+    {
+        access(0);
+        return HeapBlockDevice::erase(addr, size);
+    }
+
+    uint32_t ops;
+    uint32_t op_us;
+    uint32_t us_per_kb;
+
+private:
+    void access(bd_size_t size)
+    {
+        ops++;
+        uint32_t us = op_us + us_per_kb * (size / 1024);
+        if (us) {
+            bench_sleep_us(us);
+        }
+    }
+};
+
+const bd_size_t block_size = 512;
+const bd_size_t device_size = 64 * 1024;
+
+}
+
+class TestStripingBlockDevice : public testing::Test {
+protected:
+    TestStripingBlockDevice()
+        : heap0(device_size, 1, 256, block_size)
+        , heap1(device_size, 1, 256, block_size)
+        , heap2(device_size + 3 * block_size, 1, 256, block_size)
+    {
+        bds[0] = &heap0;
+        bds[1] = &heap1;
+        bds[2] = &heap2;
+    }
+
+    virtual void SetUp()
+    {
+        for (size_t i = 0; i < sizeof(pattern); i++) {
+            pattern[i] = (i * 7) ^ (i >> 9);
+        }
+    }
+
+    LatencyBlockDevice heap0, heap1, heap2;
+    BlockDevice *bds[3];
+    uint8_t pattern[16 * block_size];
+    uint8_t buffer[16 * block_size];
+};
+
+TEST_F(TestStripingBlockDevice, geometry)
+{
+    StripingBlockDevice bd(bds, 3, 4 * block_size);
+    ASSERT_EQ(BD_ERROR_OK, bd.init());
+
+    // The smallest device limits the size of every one
+    EXPECT_EQ(3 * device_size, bd.size());
+    EXPECT_EQ(4 * block_size, bd.get_stripe_size());
+    EXPECT_EQ(1u, bd.get_read_size());
+    EXPECT_EQ(256u, bd.get_program_size());
+    EXPECT_EQ(block_size, bd.get_erase_size());
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+
+    // Stripes are an erase block by default
+    StripingBlockDevice by_block(bds);
+    ASSERT_EQ(BD_ERROR_OK, by_block.init());
+    EXPECT_EQ(block_size, by_block.get_stripe_size());
+    EXPECT_EQ(BD_ERROR_OK, by_block.deinit());
+}
+
+TEST_F(TestStripingBlockDevice, units_go_to_the_devices_in_turn)
+{
+    const bd_size_t unit = 2 * block_size;
+    StripingBlockDevice bd(bds, 3, unit);
+    ASSERT_EQ(BD_ERROR_OK, bd.init());
+
+    EXPECT_EQ(BD_ERROR_OK, bd.erase(0, sizeof(pattern)));
+    EXPECT_EQ(BD_ERROR_OK, bd.program(pattern, 0, sizeof(pattern)));
+
+    // Unit i is unit i / 3 on device i % 3
+    for (bd_size_t i = 0; i < sizeof(pattern) / unit; i++) {
+        EXPECT_EQ(BD_ERROR_OK, bds[i % 3]->read(buffer, (i / 3) * unit, unit));
+        EXPECT_EQ(0, memcmp(buffer, &pattern[i * unit], unit)) << "unit " << i;
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    EXPECT_EQ(BD_ERROR_OK, bd.read(buffer, 0, sizeof(buffer)));
+    EXPECT_EQ(0, memcmp(buffer, pattern, sizeof(buffer)));
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+}
+
+TEST_F(TestStripingBlockDevice, accesses_within_and_across_units)
+{
+    const bd_size_t unit = 4 * block_size;
+    StripingBlockDevice bd(bds, 3, unit);
+    ASSERT_EQ(BD_ERROR_OK, bd.init());
+    EXPECT_EQ(BD_ERROR_OK, bd.erase(0, 2 * sizeof(pattern)));
+    EXPECT_EQ(BD_ERROR_OK, bd.program(pattern, 3 * 256, sizeof(pattern) - 1024));
+
+    // Within a unit only one device is called
+    uint32_t ops[3] = { heap0.ops, heap1.ops, heap2.ops };
+    EXPECT_EQ(BD_ERROR_OK, bd.read(buffer, unit + 100, 300));
+    EXPECT_EQ(0, memcmp(buffer, &pattern[unit + 100 - 3 * 256], 300));
+    EXPECT_EQ(ops[0], heap0.ops);
+    EXPECT_EQ(ops[1] + 1, heap1.ops);
+    EXPECT_EQ(ops[2], heap2.ops);
+
+    // Odd reads across units
+    for (bd_size_t start = 3 * 256; start < 3 * unit; start += 333) {
+        bd_size_t size = sizeof(pattern) - 1024 - (start - 3 * 256);
+        memset(buffer, 0, sizeof(buffer));
+        EXPECT_EQ(BD_ERROR_OK, bd.read(buffer, start, size));
+        EXPECT_EQ(0, memcmp(buffer, &pattern[start - 3 * 256], size)) << "start " << start;
+    }
+
+    // A trim and an erase across units are a single call on each device
+    ops[0] = heap0.ops;
+    EXPECT_EQ(BD_ERROR_OK, bd.trim(0, 2 * sizeof(pattern)));
+    EXPECT_EQ(BD_ERROR_OK, bd.erase(block_size, 6 * unit));
+    EXPECT_EQ(ops[0] + 1, heap0.ops);
+    EXPECT_EQ(BD_ERROR_OK, bd.sync());
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+}
+
+TEST_F(TestStripingBlockDevice, single_device)
+{
+    StripingBlockDevice bd(bds, 1, 2 * block_size);
+    ASSERT_EQ(BD_ERROR_OK, bd.init());
+    EXPECT_EQ(device_size, bd.size());
+
+    EXPECT_EQ(BD_ERROR_OK, bd.erase(0, sizeof(pattern)));
+    EXPECT_EQ(BD_ERROR_OK, bd.program(pattern, 0, sizeof(pattern)));
+    EXPECT_EQ(BD_ERROR_OK, heap0.read(buffer, 0, sizeof(buffer)));
+    EXPECT_EQ(0, memcmp(buffer, pattern, sizeof(buffer)));
+    EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+}
+
+TEST(BenchStripingBlockDevice, throughput)
+{
+    // Devices that take 1ms per operation plus 100us per KB
+    const bd_size_t unit = 8 * 1024;
+    const bd_size_t transfer = 64 * 1024;
+    const int transfers = 4;
+    std::vector<uint8_t> data(transfer);
+    double single_us = 0;
+
+    const size_t counts[] = { 1, 2, 4 };
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        LatencyBlockDevice *heaps[4];
+        BlockDevice *children[4];
+        for (size_t i = 0; i < counts[c]; i++) {
+            heaps[i] = new LatencyBlockDevice(transfer, 1, 1, block_size);
+            heaps[i]->op_us = 1000;
+            heaps[i]->us_per_kb = 100;
+            children[i] = heaps[i];
+        }
+
+        StripingBlockDevice bd(children, counts[c], unit);
+        ASSERT_EQ(BD_ERROR_OK, bd.init());
+        ASSERT_EQ(BD_ERROR_OK, bd.program(&data[0], 0, transfer));
+
+        bench_time_t start = bench_now();
+        for (int i = 0; i < transfers; i++) {
+            ASSERT_EQ(BD_ERROR_OK, bd.read(&data[0], 0, transfer));
+        }
+        double us = bench_seconds_since(start) * 1e6 / transfers;
+        EXPECT_EQ(BD_ERROR_OK, bd.deinit());
+
+        char name[32];
+        snprintf(name, sizeof(name), "stripe%u_kb_per_s", (unsigned)counts[c]);
+        bench_report(name, transfer / 1024 * 1e6 / us, "KB/s");
+
+        if (counts[c] == 1) {
+            single_us = us;
+        } else {
+            // Devices are read in parallel
+            EXPECT_GT(single_us, us * 3 / 2);
+        }
+
+        for (size_t i = 0; i < counts[c]; i++) {
+            delete heaps[i];
+        }
+    }
+}
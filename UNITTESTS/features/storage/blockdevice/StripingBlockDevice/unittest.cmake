@@ -0,0 +1,22 @@
+
+####################
+# UNIT TESTS
+####################
+
+# The worker threads run on the POSIX backend, so the throughput tests use real threads
+set(unittest-rtos posix)
+
+set(unittest-includes ${unittest-includes}
+  ../features/storage/blockdevice
+)
+
+set(unittest-sources
+  ../features/storage/blockdevice/BlockDeviceWorkers.cpp
+  ../features/storage/blockdevice/HeapBlockDevice.cpp
+  ../features/storage/blockdevice/StripingBlockDevice.cpp
+)
+
+set(unittest-test-sources
+  features/storage/blockdevice/StripingBlockDevice/test_StripingBlockDevice.cpp
+  stubs/mbed_assert_stub.c
+)
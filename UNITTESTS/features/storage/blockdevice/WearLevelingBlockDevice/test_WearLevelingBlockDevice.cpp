@@ -0,0 +1,595 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * WearLevelingBlockDevice tests: remapping, power loss at every program and
+ * erase unit, wear spread, and benchmarks of the FAT driver on a simulated NOR
+ * flash with and without the translation layer.
+ * Benchmark results are printed and recorded as gtest properties.
+ */
+
+#include "gtest/gtest.h"
+#include "bench_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "FlashSimBlockDevice.h"
+#include "HeapBlockDevice.h"
+#include "ProfilingBlockDevice.h"
+#include "WearLevelingBlockDevice.h"
+#include "ff.h"
+#include "diskio.h"
+
+namespace {
+
+const bd_size_t sector_size = 512;
+
+void fill(std::vector<uint8_t> &buf, uint32_t seed)
+{
+    uint32_t x = seed * 2654435761u + 1;
+    for (size_t i = 0; i < buf.size(); i++) {
+        x = x * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(x >> 16);
+    }
+}
+
+/* Counts erases of every erase unit, to see how evenly wear is spread.
+ */
+class WearCountingBlockDevice : public BlockDevice {
+public:
+    WearCountingBlockDevice(BlockDevice *bd) : _bd(bd) {}
+    virtual ~WearCountingBlockDevice() {}
+
+    uint32_t max_erases() const
+    {
+        uint32_t max = 0;
+        for (size_t i = 0; i < _erases.size(); i++) {
+            max = std::max(max, _erases[i]);
+        }
+        return max;
+    }
+
+    virtual int init()
+    {
+        int err = _bd->init();
+        _erases.resize(_bd->size() / _bd->get_erase_size());
+        return err;
+    }
+
+    virtual int deinit()
+    {
+        return _bd->deinit();
+    }
+
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        return _bd->read(buffer, addr, size);
+    }
+
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        return _bd->program(buffer, addr, size);
+    }
+
+    virtual int erase(bd_addr_t addr, bd_size_t size)
+    {
+        for (bd_size_t done = 0; done < size; done += get_erase_size()) {
+            _erases[(addr + done) / get_erase_size()]++;
+        }
+        return _bd->erase(addr, size);
+    }
+
+    virtual bd_size_t get_read_size() const
+    {
+        return _bd->get_read_size();
+    }
+
+    virtual bd_size_t get_program_size() const
+    {
+        return _bd->get_program_size();
+    }
+
+    virtual bd_size_t get_erase_size() const
+    {
+        return _bd->get_erase_size();
+    }
+
+    virtual int get_erase_value() const
+    {
+        return _bd->get_erase_value();
+    }
+
+    virtual bd_size_t size() const
+    {
+        return _bd->size();
+    }
+
+private:
+    BlockDevice *_bd;
+    std::vector<uint32_t> _erases;
+};
+
+/* Passes everything through until a budget of program and erase units runs
+ * out. The unit it runs out in is torn, and nothing reaches the device after
+ * that, as if power was lost.
+ */
+class PowerCutBlockDevice : public BlockDevice {
+public:
+    PowerCutBlockDevice(BlockDevice *bd) : _bd(bd), _budget(-1), _cut(false) {}
+    virtual ~PowerCutBlockDevice() {}
+
+    void set_budget(int64_t units)
+    {
+        _budget = units;
+        _cut = false;
+    }
+
+    bool cut() const
+    {
+        return _cut;
+    }
+
+    virtual int init()
+    {
+        return _bd->init();
+    }
+
+    virtual int deinit()
+    {
+        return _bd->deinit();
+    }
+
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        return _bd->read(buffer, addr, size);
+    }
+
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        bd_size_t unit = get_program_size();
+        const uint8_t *data = static_cast<const uint8_t *>(buffer);
+        for (bd_size_t done = 0; done < size; done += unit) {
+            if (!consume()) {
+                // Only the first half of the torn unit makes it
+                std::vector<uint8_t> torn(data + done, data + done + unit);
+                memset(&torn[unit / 2], 0, unit - unit / 2);
+                _bd->program(&torn[0], addr + done, unit);
+                return BD_ERROR_DEVICE_ERROR;
+            }
+            int ret = _bd->program(data + done, addr + done, unit);
+            if (ret) {
+                return ret;
+            }
+        }
+        return 0;
+    }
+
+    virtual int erase(bd_addr_t addr, bd_size_t size)
+    {
+        bd_size_t unit = get_erase_size();
+        for (bd_size_t done = 0; done < size; done += unit) {
+            if (!consume()) {
+                return BD_ERROR_DEVICE_ERROR;
+            }
+            int ret = _bd->erase(addr + done, unit);
+            if (ret) {
+                return ret;
+            }
+        }
+        return 0;
+    }
+
+    virtual bd_size_t get_read_size() const
+    {
+        return _bd->get_read_size();
+    }
+
+    virtual bd_size_t get_program_size() const
+    {
+        return _bd->get_program_size();
+    }
+
+    virtual bd_size_t get_erase_size() const
+    {
+        return _bd->get_erase_size();
+    }
+
+    virtual int get_erase_value() const
+    {
+        return _bd->get_erase_value();
+    }
+
+    virtual bd_size_t size() const
+    {
+        return _bd->size();
+    }
+
+private:
+    bool consume()
+    {
+        if (_cut || _budget == 0) {
+            _cut = true;
+            return false;
+        }
+        if (_budget > 0) {
+            _budget--;
+        }
+        return true;
+    }
+
+    BlockDevice *_bd;
+    int64_t _budget;
+    bool _cut;
+};
+
+// The FAT driver's disk glue, as in FATFileSystem.cpp, on a single volume
+BlockDevice *fat_disk;
+
+WORD fat_sector_size()
+{
+    return std::max<bd_size_t>(fat_disk->get_erase_size(), 512);
+}
+
+}
+
+DWORD get_fattime(void)
+{
+    return 0;
+}
+
+void *ff_memalloc(UINT size)
+{
+    return malloc(size);
+}
+
+void ff_memfree(void *p)
+{
+    free(p);
+}
+
+DSTATUS disk_status(BYTE pdrv)
+{
+    return RES_OK;
+}
+
+// The tests init and deinit the device themselves
+DSTATUS disk_initialize(BYTE pdrv)
+{
+    return RES_OK;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+    WORD ssize = fat_sector_size();
+    return fat_disk->read(buff, (bd_addr_t)sector * ssize, (bd_size_t)count * ssize) ? RES_PARERR : RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+    WORD ssize = fat_sector_size();
+    bd_addr_t addr = (bd_addr_t)sector * ssize;
+    bd_size_t size = (bd_size_t)count * ssize;
+    if (fat_disk->erase(addr, size) || fat_disk->program(buff, addr, size)) {
+        return RES_PARERR;
+    }
+    return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+    switch (cmd) {
+        case CTRL_SYNC:
+            return fat_disk->sync() ? RES_ERROR : RES_OK;
+        case GET_SECTOR_COUNT:
+            *((DWORD *)buff) = fat_disk->size() / fat_sector_size();
+            return RES_OK;
+        case GET_SECTOR_SIZE:
+            *((WORD *)buff) = fat_sector_size();
+            return RES_OK;
+        case GET_BLOCK_SIZE:
+            *((DWORD *)buff) = 1;
+            return RES_OK;
+        case CTRL_TRIM: {
+            DWORD *sectors = (DWORD *)buff;
+            WORD ssize = fat_sector_size();
+            return fat_disk->trim((bd_addr_t)sectors[0] * ssize,
+                                  (bd_size_t)(sectors[1] - sectors[0] + 1) * ssize) ? RES_PARERR : RES_OK;
+        }
+    }
+    return RES_PARERR;
+}
+
+class TestWearLevelingBlockDevice : public testing::Test {
+};
+
+TEST_F(TestWearLevelingBlockDevice, rewrites_survive_remount)
+{
+    HeapBlockDevice heap(32 * 4096, 1, 8, 4096);
+    FlashSimBlockDevice flash(&heap);
+    WearLevelingBlockDevice bd(&flash);
+    std::vector<uint8_t> buf(sector_size), expected(sector_size);
+
+    ASSERT_EQ(0, bd.init());
+    EXPECT_EQ(sector_size, bd.get_erase_size());
+    EXPECT_EQ(sector_size, bd.get_program_size());
+    EXPECT_EQ(-1, bd.get_erase_value());
+    uint32_t sectors = bd.size() / sector_size;
+    ASSERT_GT(sectors, 100u);
+    std::vector<uint32_t> model(sectors, 0);
+
+    srand(1);
+    for (uint32_t i = 1; i <= 3000; i++) {
+        // Mostly a few hot sectors, as the FAT and directory of a file system
+        uint32_t lsn = (rand() % 4) ? rand() % 4 : rand() % sectors;
+        fill(buf, i);
+        ASSERT_EQ(0, bd.program(&buf[0], (bd_addr_t)lsn * sector_size, sector_size)) << i;
+        model[lsn] = i;
+    }
+
+    ASSERT_EQ(0, bd.deinit());
+    ASSERT_EQ(0, bd.init());
+    for (uint32_t lsn = 0; lsn < sectors; lsn++) {
+        ASSERT_EQ(0, bd.read(&buf[0], (bd_addr_t)lsn * sector_size, sector_size));
+        if (model[lsn]) {
+            fill(expected, model[lsn]);
+        } else {
+            std::fill(expected.begin(), expected.end(), 0xFF);
+        }
+        ASSERT_TRUE(buf == expected) << lsn;
+    }
+    ASSERT_EQ(0, bd.deinit());
+}
+
+TEST_F(TestWearLevelingBlockDevice, erase_drops_sectors)
+{
+    HeapBlockDevice heap(16 * 4096, 1, 8, 4096);
+    FlashSimBlockDevice flash(&heap);
+    WearLevelingBlockDevice bd(&flash);
+    std::vector<uint8_t> buf(2 * sector_size), blank(2 * sector_size, 0xFF);
+
+    ASSERT_EQ(0, bd.init());
+    fill(buf, 1);
+    ASSERT_EQ(0, bd.program(&buf[0], 0, 2 * sector_size));
+    ASSERT_EQ(0, bd.erase(0, sector_size));
+    ASSERT_EQ(0, bd.trim(sector_size, sector_size));
+    ASSERT_EQ(0, bd.read(&buf[0], 0, 2 * sector_size));
+    EXPECT_TRUE(buf == blank);
+
+    // Dropped sectors cost garbage collection nothing
+    for (uint32_t i = 0; i < 1000; i++) {
+        fill(buf, i);
+        ASSERT_EQ(0, bd.program(&buf[0], 0, 2 * sector_size));
+        ASSERT_EQ(0, bd.trim(0, 2 * sector_size));
+    }
+    ASSERT_EQ(0, bd.deinit());
+}
+
+TEST_F(TestWearLevelingBlockDevice, geometry)
+{
+    std::vector<uint8_t> buf(sector_size);
+
+    // Erase units too small for a sector are grouped
+    HeapBlockDevice small_units(64 * 256, 1, 1, 256);
+    WearLevelingBlockDevice grouped(&small_units);
+    ASSERT_EQ(0, grouped.init());
+    EXPECT_GT(grouped.size(), 0u);
+    for (uint32_t i = 0; i < 200; i++) {
+        fill(buf, i);
+        ASSERT_EQ(0, grouped.program(&buf[0], (i % 5) * sector_size, sector_size));
+    }
+    ASSERT_EQ(0, grouped.deinit());
+
+    // Sectors must be whole program units, and the device must leave room for garbage collection
+    HeapBlockDevice big_units(64 * 4096, 1, 1024, 4096);
+    WearLevelingBlockDevice misaligned(&big_units, 512);
+    EXPECT_NE(0, misaligned.init());
+    HeapBlockDevice tiny(3 * 4096, 1, 1, 4096);
+    WearLevelingBlockDevice too_small(&tiny);
+    EXPECT_NE(0, too_small.init());
+    EXPECT_EQ(0u, too_small.size());
+}
+
+TEST_F(TestWearLevelingBlockDevice, wear_is_spread_to_cold_blocks)
+{
+    HeapBlockDevice heap(32 * 4096, 1, 8, 4096);
+    FlashSimBlockDevice flash(&heap);
+    WearLevelingBlockDevice bd(&flash, sector_size, 8);
+    std::vector<uint8_t> buf(sector_size);
+
+    ASSERT_EQ(0, bd.init());
+    uint32_t sectors = bd.size() / sector_size;
+    for (uint32_t lsn = 0; lsn < sectors; lsn++) {
+        fill(buf, lsn);
+        ASSERT_EQ(0, bd.program(&buf[0], (bd_addr_t)lsn * sector_size, sector_size));
+    }
+    // Only two sectors change from now on; the rest of the device would never wear without moving it
+    for (uint32_t i = 0; i < 20000; i++) {
+        fill(buf, sectors + i);
+        ASSERT_EQ(0, bd.program(&buf[0], (bd_addr_t)(i % 2) * sector_size, sector_size));
+    }
+
+    uint32_t min, max;
+    ASSERT_EQ(0, bd.get_erase_counts(min, max));
+    EXPECT_GT(min, 1u);
+    EXPECT_LE(max - min, 8u + 2u);
+
+    ASSERT_EQ(0, bd.deinit());
+    ASSERT_EQ(0, bd.init());
+    for (uint32_t lsn = 2; lsn < sectors; lsn++) {
+        std::vector<uint8_t> expected(sector_size);
+        fill(expected, lsn);
+        ASSERT_EQ(0, bd.read(&buf[0], (bd_addr_t)lsn * sector_size, sector_size));
+        ASSERT_TRUE(buf == expected) << lsn;
+    }
+    uint32_t min2, max2;
+    ASSERT_EQ(0, bd.get_erase_counts(min2, max2));
+    EXPECT_EQ(min, min2);
+    EXPECT_EQ(max, max2);
+    ASSERT_EQ(0, bd.deinit());
+}
+
+/* Cuts power after every possible number of program and erase units of a
+ * rewrite workload, then checks that a remount finds every completed write,
+ * and the write in flight either complete or not at all.
+ */
+TEST_F(TestWearLevelingBlockDevice, power_loss_at_every_unit)
+{
+    int64_t budget;
+    for (budget = 0; ; budget++) {
+        // Program units of a quarter sector, and erase units grouped in threes
+        HeapBlockDevice heap(30 * 1024, 1, 128, 1024);
+        FlashSimBlockDevice flash(&heap);
+        PowerCutBlockDevice power(&flash);
+        std::vector<uint8_t> buf(sector_size);
+        std::vector<uint32_t> model;
+        uint32_t in_flight = 0, in_flight_seed = 0;
+        bool completed;
+
+        {
+            WearLevelingBlockDevice bd(&power);
+            ASSERT_EQ(0, bd.init());
+            model.assign(bd.size() / sector_size, 0);
+            power.set_budget(budget);
+            completed = true;
+            srand(2);
+            for (uint32_t i = 1; i <= 120; i++) {
+                in_flight = (rand() % 2) ? rand() % 3 : rand() % model.size();
+                in_flight_seed = i;
+                fill(buf, i);
+                if (bd.program(&buf[0], (bd_addr_t)in_flight * sector_size, sector_size)) {
+                    completed = false;
+                    break;
+                }
+                model[in_flight] = i;
+            }
+            if (completed) {
+                ASSERT_FALSE(power.cut());
+                break;
+            }
+            ASSERT_TRUE(power.cut()) << "failed without a power cut at " << budget;
+        }
+
+        power.set_budget(-1);
+        WearLevelingBlockDevice bd(&power);
+        ASSERT_EQ(0, bd.init()) << "budget " << budget;
+        for (uint32_t lsn = 0; lsn < model.size(); lsn++) {
+            std::vector<uint8_t> expected(sector_size, 0xFF), alternative(sector_size);
+            if (model[lsn]) {
+                fill(expected, model[lsn]);
+            }
+            fill(alternative, in_flight_seed);
+            ASSERT_EQ(0, bd.read(&buf[0], (bd_addr_t)lsn * sector_size, sector_size));
+            ASSERT_TRUE(buf == expected || (lsn == in_flight && buf == alternative))
+                    << "budget " << budget << " sector " << lsn;
+        }
+
+        // The remounted device keeps working
+        for (uint32_t i = 0; i < 40; i++) {
+            fill(buf, 1000 + i);
+            ASSERT_EQ(0, bd.program(&buf[0], (bd_addr_t)(i % 4) * sector_size, sector_size)) << "budget " << budget;
+        }
+        ASSERT_EQ(0, bd.read(&buf[0], 3 * sector_size, sector_size));
+        std::vector<uint8_t> expected(sector_size);
+        fill(expected, 1039);
+        ASSERT_TRUE(buf == expected) << "budget " << budget;
+    }
+    // The workload has to get through garbage collection for the sweep to mean much
+    EXPECT_GT(budget, 800);
+}
+
+/* Appends records to a log file with a sync after each, as a data logger does,
+ * with the FAT driver on a NOR flash of 4 KiB erase units, once directly and
+ * once through the translation layer. The flash time is estimated from typical
+ * SPI NOR timings.
+ */
+TEST_F(TestWearLevelingBlockDevice, benchmark_fat_on_nor)
+{
+    const double page_program_s = 0.0007;   // per 256 bytes
+    const double sector_erase_s = 0.045;    // per 4 KiB
+    const uint32_t records = 2000;
+    const uint32_t record_size = 64;
+    const char *names[2] = { "direct", "ftl" };
+
+    for (int use_ftl = 0; use_ftl < 2; use_ftl++) {
+        HeapBlockDevice heap(512 * 1024, 1, 1, 4096);
+        FlashSimBlockDevice flash(&heap);
+        WearCountingBlockDevice wear(&flash);
+        ProfilingBlockDevice profiler(&wear);
+        WearLevelingBlockDevice ftl(&profiler);
+        fat_disk = use_ftl ? (BlockDevice *)&ftl : (BlockDevice *)&profiler;
+
+        FATFS fs;
+        FIL file;
+        UINT written;
+        std::vector<uint8_t> record(record_size);
+
+        ASSERT_EQ(0, fat_disk->init());
+        ASSERT_EQ(FR_OK, f_mkfs("0:", FM_ANY | FM_SFD, 0, NULL, 0));
+        ASSERT_EQ(FR_OK, f_mount(&fs, "0:", 1));
+        // create_name reads one character past the end of the path
+        static const char path[] = "0:/log.bin\0";
+        ASSERT_EQ(FR_OK, f_open(&file, path, FA_WRITE | FA_CREATE_ALWAYS));
+        profiler.reset();
+
+        bench_time_t start = bench_now();
+        for (uint32_t i = 0; i < records; i++) {
+            fill(record, i);
+            ASSERT_EQ(FR_OK, f_write(&file, &record[0], record_size, &written));
+            ASSERT_EQ(record_size, written);
+            ASSERT_EQ(FR_OK, f_sync(&file));
+        }
+        double host_s = bench_seconds_since(start);
+        ASSERT_EQ(FR_OK, f_close(&file));
+
+        double user_bytes = (double)records * record_size;
+        double programmed = profiler.get_program_count();
+        double erased = profiler.get_erase_count();
+        double flash_s = programmed / 256 * page_program_s + erased / 4096 * sector_erase_s;
+        char name[48];
+        snprintf(name, sizeof(name), "%s_programmed_per_byte", names[use_ftl]);
+        bench_report(name, programmed / user_bytes, "bytes");
+        snprintf(name, sizeof(name), "%s_erased_per_byte", names[use_ftl]);
+        bench_report(name, erased / user_bytes, "bytes");
+        snprintf(name, sizeof(name), "%s_max_erases_per_unit", names[use_ftl]);
+        bench_report(name, wear.max_erases(), "erases");
+        snprintf(name, sizeof(name), "%s_nor_estimated_Bps", names[use_ftl]);
+        bench_report(name, user_bytes / flash_s, "B/s");
+        snprintf(name, sizeof(name), "%s_host_us_per_record", names[use_ftl]);
+        bench_report(name, host_s * 1e6 / records, "us");
+
+        // The log reads back after a remount
+        ASSERT_EQ(FR_OK, f_mount(NULL, "0:", 0));
+        ASSERT_EQ(0, fat_disk->deinit());
+        ASSERT_EQ(0, fat_disk->init());
+        ASSERT_EQ(FR_OK, f_mount(&fs, "0:", 1));
+        ASSERT_EQ(FR_OK, f_open(&file, path, FA_READ));
+        EXPECT_EQ(user_bytes, f_size(&file));
+        std::vector<uint8_t> expected(record_size);
+        for (uint32_t i = 0; i < records; i++) {
+            UINT got;
+            fill(expected, i);
+            ASSERT_EQ(FR_OK, f_read(&file, &record[0], record_size, &got));
+            ASSERT_TRUE(record == expected) << names[use_ftl] << " record " << i;
+        }
+        ASSERT_EQ(FR_OK, f_close(&file));
+        ASSERT_EQ(FR_OK, f_mount(NULL, "0:", 0));
+        ASSERT_EQ(0, fat_disk->deinit());
+    }
+}
@@ -0,0 +1,25 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  ../features/storage/blockdevice
+  ../features/storage/filesystem/fat/ChaN
+)
+
+# The FAT driver runs without FATFileSystem; the test provides its disk glue
+set(unittest-sources
+  ../features/storage/blockdevice/FlashSimBlockDevice.cpp
+  ../features/storage/blockdevice/HeapBlockDevice.cpp
+  ../features/storage/blockdevice/ProfilingBlockDevice.cpp
+  ../features/storage/blockdevice/WearLevelingBlockDevice.cpp
+  ../features/storage/filesystem/fat/ChaN/ff.cpp
+  ../features/storage/filesystem/fat/ChaN/ffunicode.cpp
+)
+
+set(unittest-test-sources
+  features/storage/blockdevice/WearLevelingBlockDevice/test_WearLevelingBlockDevice.cpp
+  stubs/mbed_assert_stub.c
+  stubs/mbed_critical_stub.c
+)
@@ -0,0 +1,667 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * JournalKVStore tests: the API, power loss at every program and erase unit
+ * of a workload, worn out blocks, and benchmarks on a simulated flash.
+ * Benchmark results are printed and recorded as gtest properties.
+ */
+
+#include "gtest/gtest.h"
+#include "bench_timer.h"
+
+#include <map>
+#include <set>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "ExhaustibleBlockDevice.h"
+#include "FlashSimBlockDevice.h"
+#include "HeapBlockDevice.h"
+#include "ProfilingBlockDevice.h"
+#include "SlicingBlockDevice.h"
+#include "JournalKVStore.h"
+
+namespace {
+
+std::string make_value(uint32_t seed, size_t size)
+{
+    std::string value(size, '\0');
+    uint32_t x = seed * 2654435761u + 1;
+    for (size_t i = 0; i < size; i++) {
+        x = x * 1103515245u + 12345u;
+        value[i] = (char)(x >> 16);
+    }
+    return value;
+}
+
+std::string get_value(JournalKVStore &store, const char *key, int &ret)
+{
+    size_t size = 0;
+    ret = store.get_info(key, &size);
+    if (ret) {
+        return std::string();
+    }
+    std::vector<char> buf(size + 1);
+    size_t actual = 0;
+    ret = store.get(key, &buf[0], size, &actual);
+    return std::string(&buf[0], actual);
+}
+
+/* Passes everything through until a budget of program and erase units runs
+ * out. The unit it runs out in is torn, and nothing reaches the device after
+ * that, as if power was lost.
+ */
+class PowerCutBlockDevice : public BlockDevice {
+public:
+    PowerCutBlockDevice(BlockDevice *bd) : _bd(bd), _budget(-1), _cut(false) {}
+    virtual ~PowerCutBlockDevice() {}
+
+    void set_budget(int64_t units)
+    {
+        _budget = units;
+        _cut = false;
+    }
+
+    bool cut() const
+    {
+        return _cut;
+    }
+
+    virtual int init()
+    {
+        return _bd->init();
+    }
+
+    virtual int deinit()
+    {
+        return _bd->deinit();
+    }
+
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        return _bd->read(buffer, addr, size);
+    }
+
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        bd_size_t unit = get_program_size();
+        const uint8_t *data = static_cast<const uint8_t *>(buffer);
+        for (bd_size_t done = 0; done < size; done += unit) {
+            if (!consume()) {
+                // Only the first half of the torn unit makes it
+                std::vector<uint8_t> torn(data + done, data + done + unit);
+                memset(&torn[unit / 2], 0, unit - unit / 2);
+                _bd->program(&torn[0], addr + done, unit);
+                return BD_ERROR_DEVICE_ERROR;
+            }
+            int ret = _bd->program(data + done, addr + done, unit);
+            if (ret) {
+                return ret;
+            }
+        }
+        return 0;
+    }
+
+    virtual int erase(bd_addr_t addr, bd_size_t size)
+    {
+        bd_size_t unit = get_erase_size();
+        for (bd_size_t done = 0; done < size; done += unit) {
+            if (!consume()) {
+                return BD_ERROR_DEVICE_ERROR;
+            }
+            int ret = _bd->erase(addr + done, unit);
+            if (ret) {
+                return ret;
+            }
+        }
+        return 0;
+    }
+
+    virtual bd_size_t get_read_size() const
+    {
+        return _bd->get_read_size();
+    }
+
+    virtual bd_size_t get_program_size() const
+    {
+        return _bd->get_program_size();
+    }
+
+    virtual bd_size_t get_erase_size() const
+    {
+        return _bd->get_erase_size();
+    }
+
+    virtual int get_erase_value() const
+    {
+        return _bd->get_erase_value();
+    }
+
+    virtual bd_size_t size() const
+    {
+        return _bd->size();
+    }
+
+private:
+    bool consume()
+    {
+        if (_cut || _budget == 0) {
+            _cut = true;
+            return false;
+        }
+        if (_budget > 0) {
+            _budget--;
+        }
+        return true;
+    }
+
+    BlockDevice *_bd;
+    int64_t _budget;
+    bool _cut;
+};
+
+typedef std::map<std::string, std::string> model_t;
+
+struct Pending {
+    bool active;
+    std::string key;
+    bool removed;
+    std::string value;
+};
+
+/* Sets, overwrites, removes and incremental sets, enough to go through garbage
+ * collection several times on a small device. Stops at the first failure,
+ * leaving what was in flight in pending.
+ */
+bool run_workload(JournalKVStore &store, model_t &model, Pending &pending)
+{
+    for (uint32_t i = 0; i < 48; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%u", (unsigned)(i % 6));
+        pending.active = true;
+        pending.key = key;
+        pending.removed = false;
+        int ret;
+
+        if (i % 11 == 10) {
+            pending.removed = true;
+            ret = store.remove(key);
+            if (ret == JOURNAL_KV_NOT_FOUND && !model.count(key)) {
+                ret = JOURNAL_KV_SUCCESS;
+            }
+        } else if (i % 9 == 5) {
+            pending.value = make_value(i, 400);
+            JournalKVStore::set_handle_t handle;
+            ret = store.set_start(&handle, key, pending.value.size());
+            for (size_t off = 0; !ret && off < pending.value.size(); off += 50) {
+                ret = store.set_add_data(handle, pending.value.data() + off, 50);
+                if (ret) {
+                    store.set_finalize(handle);
+                }
+            }
+            if (!ret) {
+                ret = store.set_finalize(handle);
+            }
+        } else {
+            pending.value = make_value(i, 20 + (i * 37) % 230);
+            ret = store.set(key, pending.value.data(), pending.value.size());
+        }
+
+        if (ret) {
+            return false;
+        }
+        if (pending.removed) {
+            model.erase(key);
+        } else {
+            model[key] = pending.value;
+        }
+        pending.active = false;
+    }
+    return true;
+}
+
+void check_contents(JournalKVStore &store, const model_t &model, const Pending &pending)
+{
+    size_t expected_keys = model.size();
+    for (model_t::const_iterator it = model.begin(); it != model.end(); ++it) {
+        int ret;
+        std::string value = get_value(store, it->first.c_str(), ret);
+        if (pending.active && it->first == pending.key) {
+            if (ret == JOURNAL_KV_NOT_FOUND && pending.removed) {
+                expected_keys--;
+                continue;
+            }
+            ASSERT_EQ(JOURNAL_KV_SUCCESS, ret);
+            ASSERT_TRUE(value == it->second || (!pending.removed && value == pending.value));
+        } else {
+            ASSERT_EQ(JOURNAL_KV_SUCCESS, ret) << it->first;
+            ASSERT_TRUE(value == it->second) << it->first;
+        }
+    }
+    if (pending.active && !pending.removed && !model.count(pending.key)) {
+        int ret;
+        std::string value = get_value(store, pending.key.c_str(), ret);
+        if (ret == JOURNAL_KV_SUCCESS) {
+            ASSERT_TRUE(value == pending.value);
+            expected_keys++;
+        } else {
+            ASSERT_EQ(JOURNAL_KV_NOT_FOUND, ret);
+        }
+    }
+    ASSERT_EQ(expected_keys, store.num_keys());
+}
+
+/* Cuts power after every possible number of program and erase units in the
+ * workload, then checks that a reboot finds every committed change, and the
+ * change in flight either fully applied or not at all.
+ */
+void power_loss_sweep(bd_size_t read_size, bd_size_t program_size)
+{
+    int64_t budget;
+    for (budget = 0; ; budget++) {
+        HeapBlockDevice heap(8192, read_size, program_size, 512);
+        FlashSimBlockDevice flash(&heap);
+        PowerCutBlockDevice power(&flash);
+        model_t model;
+        Pending pending = { false, "", false, "" };
+
+        {
+            JournalKVStore store(&power);
+            ASSERT_EQ(JOURNAL_KV_SUCCESS, store.init());
+            ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set("base", "line", 4));
+            model["base"] = "line";
+            power.set_budget(budget);
+            if (run_workload(store, model, pending)) {
+                ASSERT_FALSE(power.cut());
+                break;
+            }
+            ASSERT_TRUE(power.cut()) << "failed without a power cut at " << budget;
+        }
+
+        power.set_budget(-1);
+        JournalKVStore store(&power);
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, store.init()) << "budget " << budget;
+        check_contents(store, model, pending);
+        if (::testing::Test::HasFatalFailure()) {
+            ADD_FAILURE() << "budget " << budget;
+            return;
+        }
+
+        // The recovered store keeps working, and the result survives another reboot
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set("after", "cut", 3));
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, store.deinit());
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, store.init());
+        int ret;
+        ASSERT_EQ("cut", get_value(store, "after", ret));
+    }
+    // The workload has to get through garbage collection for the sweep to mean much
+    EXPECT_GT(budget, 100);
+}
+
+}
+
+class TestJournalKVStore : public testing::Test {
+protected:
+    TestJournalKVStore() : heap(8192, 1, 16, 1024), flash(&heap), store(&flash) {}
+
+    virtual void SetUp()
+    {
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, store.init());
+    }
+
+    virtual void TearDown()
+    {
+        store.deinit();
+    }
+
+    HeapBlockDevice heap;
+    FlashSimBlockDevice flash;
+    JournalKVStore store;
+};
+
+TEST_F(TestJournalKVStore, set_get_remove)
+{
+    int ret;
+
+    EXPECT_EQ(0u, store.num_keys());
+    EXPECT_EQ(JOURNAL_KV_NOT_FOUND, store.get_info("a", NULL));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set("a", "first", 5));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set("bb", "second", 6));
+    EXPECT_EQ("first", get_value(store, "a", ret));
+    EXPECT_EQ("second", get_value(store, "bb", ret));
+    EXPECT_EQ(2u, store.num_keys());
+
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set("a", "overwritten", 11));
+    EXPECT_EQ("overwritten", get_value(store, "a", ret));
+    EXPECT_EQ(2u, store.num_keys());
+
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.remove("a"));
+    EXPECT_EQ(JOURNAL_KV_NOT_FOUND, store.get_info("a", NULL));
+    EXPECT_EQ(JOURNAL_KV_NOT_FOUND, store.remove("a"));
+    EXPECT_EQ(1u, store.num_keys());
+
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set("empty", NULL, 0));
+    size_t size = 1;
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.get_info("empty", &size));
+    EXPECT_EQ(0u, size);
+}
+
+TEST_F(TestJournalKVStore, values_persist_across_init)
+{
+    int ret;
+    std::string big = make_value(1, 3000);
+
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set("small", "x", 1));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set("big", big.data(), big.size()));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set("gone", "y", 1));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.remove("gone"));
+    size_t free_space = store.free_space();
+
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.deinit());
+    EXPECT_EQ(JOURNAL_KV_NOT_INITIALIZED, store.get_info("small", NULL));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.init());
+
+    EXPECT_EQ(2u, store.num_keys());
+    EXPECT_EQ(free_space, store.free_space());
+    EXPECT_EQ("x", get_value(store, "small", ret));
+    EXPECT_TRUE(big == get_value(store, "big", ret));
+    EXPECT_EQ(JOURNAL_KV_NOT_FOUND, store.get_info("gone", NULL));
+}
+
+TEST_F(TestJournalKVStore, partial_reads)
+{
+    std::string value = make_value(2, 100);
+    char buf[100];
+    size_t actual = 0;
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set("key", value.data(), value.size()));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.get("key", buf, 10, &actual));
+    EXPECT_EQ(10u, actual);
+    EXPECT_EQ(0, memcmp(buf, value.data(), 10));
+
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.get("key", buf, sizeof(buf), &actual, 33));
+    EXPECT_EQ(67u, actual);
+    EXPECT_EQ(0, memcmp(buf, value.data() + 33, 67));
+
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.get("key", buf, sizeof(buf), &actual, 100));
+    EXPECT_EQ(0u, actual);
+    EXPECT_EQ(JOURNAL_KV_BAD_VALUE, store.get("key", buf, sizeof(buf), &actual, 101));
+}
+
+TEST_F(TestJournalKVStore, incremental_set)
+{
+    int ret;
+    std::string value = make_value(3, 2500);
+    JournalKVStore::set_handle_t handle;
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set_start(&handle, "inc", value.size()));
+    for (size_t off = 0; off < value.size(); off += 7) {
+        size_t chunk = std::min<size_t>(7, value.size() - off);
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set_add_data(handle, value.data() + off, chunk));
+    }
+    EXPECT_EQ(JOURNAL_KV_BAD_VALUE, store.set_add_data(handle, "x", 1));
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set_finalize(handle));
+    EXPECT_TRUE(value == get_value(store, "inc", ret));
+    EXPECT_EQ(JOURNAL_KV_BAD_VALUE, store.set_finalize(handle));
+}
+
+TEST_F(TestJournalKVStore, abandoned_incremental_set_keeps_old_value)
+{
+    int ret;
+    JournalKVStore::set_handle_t handle;
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set("key", "old", 3));
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set_start(&handle, "key", 100));
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set_add_data(handle, "new", 3));
+    EXPECT_EQ(JOURNAL_KV_BAD_VALUE, store.set_finalize(handle));
+    EXPECT_EQ("old", get_value(store, "key", ret));
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.deinit());
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.init());
+    EXPECT_EQ("old", get_value(store, "key", ret));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set("key", "new", 3));
+    EXPECT_EQ("new", get_value(store, "key", ret));
+}
+
+TEST_F(TestJournalKVStore, write_once)
+{
+    int ret;
+    uint32_t flags = 0;
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set("once", "1", 1, JournalKVStore::WRITE_ONCE_FLAG));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.get_info("once", NULL, &flags));
+    EXPECT_EQ((uint32_t)JournalKVStore::WRITE_ONCE_FLAG, flags);
+    EXPECT_EQ(JOURNAL_KV_WRITE_PROTECTED, store.set("once", "2", 1));
+    EXPECT_EQ(JOURNAL_KV_WRITE_PROTECTED, store.remove("once"));
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.garbage_collection());
+    EXPECT_EQ(JOURNAL_KV_WRITE_PROTECTED, store.set("once", "2", 1));
+    EXPECT_EQ("1", get_value(store, "once", ret));
+}
+
+TEST_F(TestJournalKVStore, bad_arguments)
+{
+    std::string long_key(JournalKVStore::max_key_size + 1, 'k');
+    std::string max_key(JournalKVStore::max_key_size, 'k');
+    JournalKVStore::set_handle_t handle;
+
+    EXPECT_EQ(JOURNAL_KV_BAD_VALUE, store.set("", "x", 1));
+    EXPECT_EQ(JOURNAL_KV_BAD_VALUE, store.set(NULL, "x", 1));
+    EXPECT_EQ(JOURNAL_KV_BAD_VALUE, store.set(long_key.c_str(), "x", 1));
+    EXPECT_EQ(JOURNAL_KV_BAD_VALUE, store.set("key", "x", 1, 0x100));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set(max_key.c_str(), "x", 1));
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set_start(&handle, "key", 1));
+    EXPECT_EQ(JOURNAL_KV_BAD_VALUE, store.set_add_data(handle, "xy", 2));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set_add_data(handle, "x", 1));
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set_finalize(handle));
+}
+
+TEST_F(TestJournalKVStore, garbage_collection_reclaims_space)
+{
+    int ret;
+
+    // Far more than the area holds, so every byte gets rewritten several times
+    for (uint32_t i = 0; i < 400; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "k%u", (unsigned)(i % 5));
+        std::string value = make_value(i, 150);
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set(key, value.data(), value.size())) << i;
+    }
+    EXPECT_EQ(5u, store.num_keys());
+    for (uint32_t i = 395; i < 400; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "k%u", (unsigned)(i % 5));
+        EXPECT_TRUE(make_value(i, 150) == get_value(store, key, ret));
+    }
+
+    size_t before = store.free_space();
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.garbage_collection());
+    EXPECT_GE(store.free_space(), before);
+
+    std::string huge(8192, 'h');
+    EXPECT_EQ(JOURNAL_KV_MEDIA_FULL, store.set("huge", huge.data(), huge.size()));
+    EXPECT_EQ(5u, store.num_keys());
+}
+
+TEST_F(TestJournalKVStore, many_keys)
+{
+    int ret;
+
+    for (uint32_t i = 0; i < 70; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "many/%u", (unsigned)i);
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set(key, &i, sizeof(i))) << i;
+    }
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.deinit());
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.init());
+    EXPECT_EQ(70u, store.num_keys());
+    for (uint32_t i = 0; i < 70; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "many/%u", (unsigned)i);
+        EXPECT_EQ(std::string((const char *)&i, sizeof(i)), get_value(store, key, ret));
+    }
+}
+
+TEST_F(TestJournalKVStore, reset_clears_everything)
+{
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set("a", "1", 1));
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.set("b", "2", 1, JournalKVStore::WRITE_ONCE_FLAG));
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.reset());
+    EXPECT_EQ(0u, store.num_keys());
+    EXPECT_EQ(JOURNAL_KV_NOT_FOUND, store.get_info("a", NULL));
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.deinit());
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, store.init());
+    EXPECT_EQ(0u, store.num_keys());
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, store.set("b", "3", 1));
+}
+
+TEST_F(TestJournalKVStore, runs_on_other_block_devices)
+{
+    int ret;
+
+    // A slice of a device without an erase value, and with a read unit
+    HeapBlockDevice heap2(16384, 8, 32, 2048);
+    SlicingBlockDevice slice(&heap2, 4096, 12288);
+    JournalKVStore sliced(&slice);
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, sliced.init());
+    for (uint32_t i = 0; i < 100; i++) {
+        std::string value = make_value(i, 1 + i * 13 % 300);
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, sliced.set(i % 2 ? "odd" : "even", value.data(), value.size()));
+    }
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, sliced.deinit());
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, sliced.init());
+    EXPECT_TRUE(make_value(98, 1 + 98 * 13 % 300) == get_value(sliced, "even", ret));
+    EXPECT_TRUE(make_value(99, 1 + 99 * 13 % 300) == get_value(sliced, "odd", ret));
+
+    char buf[3];
+    size_t actual;
+    EXPECT_EQ(JOURNAL_KV_SUCCESS, sliced.get("odd", buf, sizeof(buf), &actual, 5));
+    EXPECT_EQ(0, memcmp(buf, make_value(99, 1 + 99 * 13 % 300).data() + 5, 3));
+
+    HeapBlockDevice tiny(512, 1, 1, 512);
+    JournalKVStore one_unit(&tiny);
+    EXPECT_EQ(JOURNAL_KV_BAD_VALUE, one_unit.init());
+}
+
+TEST_F(TestJournalKVStore, power_loss_at_every_unit)
+{
+    power_loss_sweep(1, 16);
+}
+
+TEST_F(TestJournalKVStore, power_loss_at_every_unit_with_read_unit)
+{
+    power_loss_sweep(4, 8);
+}
+
+TEST_F(TestJournalKVStore, worn_out_blocks_never_return_wrong_data)
+{
+    HeapBlockDevice heap2(4096, 1, 16, 512);
+    FlashSimBlockDevice flash2(&heap2);
+    ExhaustibleBlockDevice worn(&flash2, 8);
+    std::map<std::string, std::set<std::string> > written;
+    int failures = 0;
+
+    {
+        JournalKVStore wearing(&worn);
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, wearing.init());
+        for (uint32_t i = 0; i < 3000 && failures < 50; i++) {
+            char key[8];
+            snprintf(key, sizeof(key), "w%u", (unsigned)(i % 4));
+            std::string value = make_value(i, 60 + i % 90);
+            if (wearing.set(key, value.data(), value.size())) {
+                failures++;
+                continue;
+            }
+            written[key].insert(value);
+
+            int ret;
+            std::string read = get_value(wearing, key, ret);
+            if (ret == JOURNAL_KV_SUCCESS) {
+                ASSERT_TRUE(written[key].count(read)) << i;
+            }
+        }
+    }
+    EXPECT_GT(failures, 0) << "the device never wore out";
+
+    // Whatever a reboot still finds was written at some point
+    JournalKVStore rebooted(&worn);
+    if (rebooted.init() == JOURNAL_KV_SUCCESS) {
+        for (std::map<std::string, std::set<std::string> >::iterator it = written.begin(); it != written.end(); ++it) {
+            int ret;
+            std::string read = get_value(rebooted, it->first.c_str(), ret);
+            if (ret == JOURNAL_KV_SUCCESS) {
+                EXPECT_TRUE(it->second.count(read)) << it->first;
+            }
+        }
+    }
+}
+
+TEST_F(TestJournalKVStore, benchmark)
+{
+    HeapBlockDevice heap2(64 * 1024, 1, 16, 4096);
+    FlashSimBlockDevice flash2(&heap2);
+    ProfilingBlockDevice profiler(&flash2);
+    JournalKVStore bench(&profiler);
+    const uint32_t small_sets = 20000;
+    const uint32_t key_count = 200;
+    char key[16];
+    char value[16] = "0123456789abcde";
+    int ret;
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, bench.init());
+    profiler.reset();
+
+    bench_time_t start = bench_now();
+    for (uint32_t i = 0; i < small_sets; i++) {
+        snprintf(key, sizeof(key), "bench/%u", (unsigned)(i % key_count));
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, bench.set(key, value, sizeof(value)));
+    }
+    double elapsed = bench_seconds_since(start);
+    bench_report("set_16B_us", elapsed * 1e6 / small_sets, "us/set");
+    bench_report("set_16B_programmed", (double)profiler.get_program_count() / small_sets, "bytes/set");
+    bench_report("set_16B_erased", (double)profiler.get_erase_count() / small_sets, "bytes/set");
+
+    start = bench_now();
+    for (uint32_t i = 0; i < small_sets; i++) {
+        snprintf(key, sizeof(key), "bench/%u", (unsigned)(i % key_count));
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, bench.get(key, value, sizeof(value)));
+    }
+    bench_report("get_16B_us", bench_seconds_since(start) * 1e6 / small_sets, "us/get");
+
+    std::string big = make_value(4, 8192);
+    start = bench_now();
+    for (uint32_t i = 0; i < 100; i++) {
+        ASSERT_EQ(JOURNAL_KV_SUCCESS, bench.set("big", big.data(), big.size()));
+    }
+    bench_report("set_8KiB_kBps", 100 * big.size() / 1024.0 / bench_seconds_since(start), "KiB/s");
+
+    start = bench_now();
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, bench.garbage_collection());
+    bench_report("garbage_collection_us", bench_seconds_since(start) * 1e6, "us");
+
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, bench.deinit());
+    start = bench_now();
+    ASSERT_EQ(JOURNAL_KV_SUCCESS, bench.init());
+    bench_report("init_201_keys_us", bench_seconds_since(start) * 1e6, "us");
+    EXPECT_EQ(key_count + 1, bench.num_keys());
+    EXPECT_TRUE(big == get_value(bench, "big", ret));
+}
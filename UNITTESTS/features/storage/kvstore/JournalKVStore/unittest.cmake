@@ -0,0 +1,24 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-includes ${unittest-includes}
+  ../features/storage/blockdevice
+  ../features/storage/kvstore
+)
+
+set(unittest-sources
+  ../features/storage/blockdevice/ExhaustibleBlockDevice.cpp
+  ../features/storage/blockdevice/FlashSimBlockDevice.cpp
+  ../features/storage/blockdevice/HeapBlockDevice.cpp
+  ../features/storage/blockdevice/ProfilingBlockDevice.cpp
+  ../features/storage/blockdevice/SlicingBlockDevice.cpp
+  ../features/storage/kvstore/JournalKVStore.cpp
+)
+
+set(unittest-test-sources
+  features/storage/kvstore/JournalKVStore/test_JournalKVStore.cpp
+  stubs/mbed_assert_stub.c
+  stubs/mbed_critical_stub.c
+)
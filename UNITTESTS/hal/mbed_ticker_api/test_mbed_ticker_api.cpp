@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "hal/ticker_api.h"
+#include "bench_timer.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define SCALE_SMALL     16
+#define SCALE_LARGE     4096
+#define SCALE_OPS       200000
+
+/*
+ * Fake 1MHz 32 bit ticker driven by the test
+ */
+static uint32_t fake_tick;
+static uint32_t fake_match;
+static uint32_t fake_set_calls;
+static uint32_t fake_fire_calls;
+
+static const ticker_info_t fake_info = { 1000000, 32 };
+
+static void fake_init(void)
+{
+}
+
+static uint32_t fake_read(void)
+{
+    return fake_tick;
+}
+
+static void fake_disable_interrupt(void)
+{
+}
+
+static void fake_clear_interrupt(void)
+{
+}
+
+static void fake_set_interrupt(timestamp_t timestamp)
+{
+    fake_match = timestamp;
+    fake_set_calls++;
+}
+
+static void fake_fire_interrupt(void)
+{
+    fake_fire_calls++;
+}
+
+static void fake_free(void)
+{
+}
+
+static const ticker_info_t *fake_get_info(void)
+{
+    return &fake_info;
+}
+
+static const ticker_interface_t fake_interface = {
+    fake_init, fake_read, fake_disable_interrupt, fake_clear_interrupt,
+    fake_set_interrupt, fake_fire_interrupt, fake_free, fake_get_info
+};
+
+static ticker_event_queue_t fake_queue;
+static const ticker_data_t fake_ticker = { &fake_interface, &fake_queue };
+
+/*
+ * Event handler recording the dispatch order
+ */
+static std::vector<uint32_t> dispatched;
+static ticker_event_t periodic_event;
+static uint32_t periodic_remaining;
+
+static void record_handler(uint32_t id)
+{
+    dispatched.push_back(id);
+
+    // Reinsert from within the dispatch loop like a Ticker does
+    if ((id == 0) && periodic_remaining) {
+        periodic_remaining--;
+        ticker_insert_event_us(&fake_ticker, &periodic_event, periodic_event.timestamp + 10, 0);
+    }
+}
+
+static void count_handler(uint32_t id)
+{
+}
+
+class TestTickerApi : public testing::Test {
+protected:
+    uint32_t random_state;
+
+    virtual void SetUp()
+    {
+        memset(&fake_queue, 0, sizeof(fake_queue));
+        memset(&periodic_event, 0, sizeof(periodic_event));
+        fake_tick = 0;
+        fake_match = 0;
+        fake_set_calls = 0;
+        fake_fire_calls = 0;
+        periodic_remaining = 0;
+        dispatched.clear();
+        random_state = 1;
+
+        ticker_set_handler(&fake_ticker, record_handler);
+    }
+
+    uint32_t random(uint32_t range)
+    {
+        random_state = random_state * 1103515245 + 12345;
+        return (random_state >> 8) % range;
+    }
+
+    void run_until(uint32_t tick)
+    {
+        fake_tick = tick;
+        ticker_irq_handler(&fake_ticker);
+    }
+
+    void record(const char *name, double value)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "%.1f", value);
+        RecordProperty(name, text);
+    }
+
+    /** Average ns of removing and reinserting a random event among count pending ones */
+    double reschedule_ns(uint32_t count)
+    {
+        std::vector<ticker_event_t> events(count);
+        memset(&events[0], 0, count * sizeof(ticker_event_t));
+        for (uint32_t i = 0; i < count; i++) {
+            ticker_insert_event_us(&fake_ticker, &events[i], 1000000 + random(1000000), i);
+        }
+
+        bench_time_t start = bench_now();
+        for (uint32_t i = 0; i < SCALE_OPS; i++) {
+            ticker_event_t *event = &events[random(count)];
+            ticker_remove_event(&fake_ticker, event);
+            ticker_insert_event_us(&fake_ticker, event, 1000000 + random(1000000), 0);
+        }
+        uint64_t elapsed = bench_ns_since(start);
+
+        for (uint32_t i = 0; i < count; i++) {
+            ticker_remove_event(&fake_ticker, &events[i]);
+        }
+        EXPECT_EQ(NULL, fake_queue.head);
+        return (double)elapsed / SCALE_OPS;
+    }
+
+    /** Average ns of dispatching one event among count due ones */
+    double dispatch_ns(uint32_t count)
+    {
+        std::vector<ticker_event_t> events(count);
+        uint64_t elapsed = 0;
+        uint32_t rounds = SCALE_OPS / count;
+
+        ticker_set_handler(&fake_ticker, count_handler);
+        for (uint32_t round = 0; round < rounds; round++) {
+            memset(&events[0], 0, count * sizeof(ticker_event_t));
+            for (uint32_t i = 0; i < count; i++) {
+                ticker_insert_event_us(&fake_ticker, &events[i], fake_tick + 1 + random(1000), i);
+            }
+
+            fake_tick += 1001;
+            bench_time_t start = bench_now();
+            ticker_irq_handler(&fake_ticker);
+            elapsed += bench_ns_since(start);
+            EXPECT_EQ(NULL, fake_queue.head);
+        }
+        ticker_set_handler(&fake_ticker, record_handler);
+        return (double)elapsed / (rounds * count);
+    }
+};
+
+TEST_F(TestTickerApi, dispatch_order)
+{
+    const uint32_t count = 1000;
+    std::vector<ticker_event_t> events(count);
+    std::vector<std::pair<uint32_t, uint32_t> > expected;
+
+    // Plenty of equal timestamps, those are dispatched in insertion order
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t timestamp = 1 + random(200);
+        ticker_insert_event_us(&fake_ticker, &events[i], timestamp, i);
+        expected.push_back(std::make_pair(timestamp, i));
+    }
+    std::stable_sort(expected.begin(), expected.end());
+
+    timestamp_t next;
+    EXPECT_EQ(1, ticker_get_next_timestamp(&fake_ticker, &next));
+    EXPECT_EQ(expected[0].first, next);
+
+    run_until(1000);
+    ASSERT_EQ(count, dispatched.size());
+    for (uint32_t i = 0; i < count; i++) {
+        EXPECT_EQ(expected[i].second, dispatched[i]);
+    }
+    EXPECT_EQ(0, ticker_get_next_timestamp(&fake_ticker, &next));
+}
+
+TEST_F(TestTickerApi, remove)
+{
+    const uint32_t count = 1000;
+    std::vector<ticker_event_t> events(count);
+    std::vector<std::pair<uint32_t, uint32_t> > expected;
+    ticker_event_t never_inserted, stale;
+
+    // Events are not required to be zeroed before their first insertion
+    memset(&never_inserted, 0xA5, sizeof(never_inserted));
+    memset(&stale, 0, sizeof(stale));
+    stale.index = 1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        ticker_insert_event_us(&fake_ticker, &events[i], 1 + random(100000), i);
+    }
+
+    // Removing an event twice or one never inserted has no effect
+    for (uint32_t i = 0; i < count; i += 3) {
+        ticker_remove_event(&fake_ticker, &events[i]);
+        ticker_remove_event(&fake_ticker, &events[i]);
+    }
+    ticker_remove_event(&fake_ticker, &never_inserted);
+    ticker_remove_event(&fake_ticker, &stale);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (i % 3) {
+            expected.push_back(std::make_pair((uint32_t)events[i].timestamp, i));
+        }
+    }
+    std::stable_sort(expected.begin(), expected.end());
+
+    timestamp_t next;
+    EXPECT_EQ(1, ticker_get_next_timestamp(&fake_ticker, &next));
+    EXPECT_EQ(expected[0].first, next);
+
+    run_until(200000);
+    ASSERT_EQ(expected.size(), dispatched.size());
+    for (uint32_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(expected[i].second, dispatched[i]);
+    }
+}
+
+TEST_F(TestTickerApi, interrupt_follows_head)
+{
+    ticker_event_t first, second, third;
+    memset(&first, 0, sizeof(first));
+    memset(&second, 0, sizeof(second));
+    memset(&third, 0, sizeof(third));
+
+    ticker_insert_event_us(&fake_ticker, &first, 100, 1);
+    EXPECT_EQ(100, fake_match);
+
+    // Not the head: the interrupt is left alone
+    uint32_t set_calls = fake_set_calls;
+    ticker_insert_event_us(&fake_ticker, &second, 200, 2);
+    EXPECT_EQ(set_calls, fake_set_calls);
+
+    ticker_insert_event_us(&fake_ticker, &third, 50, 3);
+    EXPECT_EQ(50, fake_match);
+
+    ticker_remove_event(&fake_ticker, &third);
+    EXPECT_EQ(100, fake_match);
+
+    set_calls = fake_set_calls;
+    ticker_remove_event(&fake_ticker, &second);
+    EXPECT_EQ(set_calls, fake_set_calls);
+
+    run_until(100);
+    ASSERT_EQ(1, dispatched.size());
+    EXPECT_EQ(1, dispatched[0]);
+}
+
+TEST_F(TestTickerApi, reinsert_moves_event)
+{
+    ticker_event_t first, second;
+    memset(&first, 0, sizeof(first));
+    memset(&second, 0, sizeof(second));
+
+    ticker_insert_event_us(&fake_ticker, &first, 100, 1);
+    ticker_insert_event_us(&fake_ticker, &second, 200, 2);
+    ticker_insert_event_us(&fake_ticker, &first, 300, 1);
+
+    timestamp_t next;
+    EXPECT_EQ(1, ticker_get_next_timestamp(&fake_ticker, &next));
+    EXPECT_EQ(200, next);
+
+    run_until(400);
+    ASSERT_EQ(2, dispatched.size());
+    EXPECT_EQ(2, dispatched[0]);
+    EXPECT_EQ(1, dispatched[1]);
+}
+
+TEST_F(TestTickerApi, reinsert_from_handler)
+{
+    ticker_event_t other;
+    memset(&other, 0, sizeof(other));
+
+    periodic_remaining = 4;
+    ticker_insert_event_us(&fake_ticker, &periodic_event, 10, 0);
+    ticker_insert_event_us(&fake_ticker, &other, 35, 1);
+
+    // Events falling due while dispatching are dispatched in the same interrupt
+    run_until(100);
+    uint32_t expected[] = { 0, 0, 0, 1, 0, 0 };
+    ASSERT_EQ(6, dispatched.size());
+    for (uint32_t i = 0; i < 6; i++) {
+        EXPECT_EQ(expected[i], dispatched[i]);
+    }
+    EXPECT_EQ(NULL, fake_queue.head);
+}
+
+TEST_F(TestTickerApi, suspend_resume)
+{
+    ticker_event_t event;
+    memset(&event, 0, sizeof(event));
+    ticker_insert_event_us(&fake_ticker, &event, 100, 1);
+
+    ticker_suspend(&fake_ticker);
+    run_until(200);
+    EXPECT_EQ(0, dispatched.size());
+
+    // Time does not pass while suspended, the event is still 100us away
+    ticker_resume(&fake_ticker);
+    EXPECT_EQ(300, fake_match);
+    EXPECT_EQ(0, dispatched.size());
+
+    run_until(300);
+    ASSERT_EQ(1, dispatched.size());
+    EXPECT_EQ(1, dispatched[0]);
+}
+
+TEST_F(TestTickerApi, cost_at_scale)
+{
+    // Best of three runs to keep scheduling noise out
+    double small_reschedule = 1e12, large_reschedule = 1e12;
+    double small_dispatch = 1e12, large_dispatch = 1e12;
+    for (int run = 0; run < 3; run++) {
+        small_reschedule = std::min(small_reschedule, reschedule_ns(SCALE_SMALL));
+        large_reschedule = std::min(large_reschedule, reschedule_ns(SCALE_LARGE));
+        small_dispatch = std::min(small_dispatch, dispatch_ns(SCALE_SMALL));
+        large_dispatch = std::min(large_dispatch, dispatch_ns(SCALE_LARGE));
+    }
+
+    record("reschedule_ns_16", small_reschedule);
+    record("reschedule_ns_4096", large_reschedule);
+    record("dispatch_ns_16", small_dispatch);
+    record("dispatch_ns_4096", large_dispatch);
+
+    // 256 times the events: a sorted list walk costs about 256 times more,
+    // the heap walks three times the number of levels
+    EXPECT_LT(large_reschedule, small_reschedule * 16);
+    EXPECT_LT(large_dispatch, small_dispatch * 16);
+}
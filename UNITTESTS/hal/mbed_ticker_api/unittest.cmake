@@ -0,0 +1,17 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-sources
+  ../hal/mbed_ticker_api.c
+)
+
+set(unittest-test-sources
+  hal/mbed_ticker_api/test_mbed_ticker_api.cpp
+  stubs/mbed_assert_stub.c
+  stubs/mbed_critical_stub.c
+)
+
+set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DMBED_CONF_PLATFORM_TICKER_EVENT_HEAP=1")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -DMBED_CONF_PLATFORM_TICKER_EVENT_HEAP=1")
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* poll() built with its RTOS wait path, which is not configured for unit tests.
+ * Defining it for the suite would leak into every other suite through CMAKE_CXX_FLAGS,
+ * so it is only defined for this translation unit. The suite runs on the POSIX rtos
+ * backend, which provides the RTOS primitives. */
+#define MBED_CONF_RTOS_PRESENT 1
+#define MBED_CONF_PLATFORM_POLL_RESCAN_INTERVAL 100
+#include "platform/mbed_poll.cpp"
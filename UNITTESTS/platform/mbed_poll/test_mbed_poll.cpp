@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "bench_timer.h"
+#include "platform/mbed_poll.h"
+#include "platform/FileHandle.h"
+#include "platform/mbed_critical.h"
+#include "rtos/Thread.h"
+
+using namespace mbed;
+
+class TestFileHandle : public FileHandle {
+public:
+    TestFileHandle() : scans(0), _revents(0) {}
+
+    virtual ssize_t read(void *buffer, size_t size)
+    {
+        return -EAGAIN;
+    }
+
+    virtual ssize_t write(const void *buffer, size_t size)
+    {
+        return -EAGAIN;
+    }
+
+    virtual off_t seek(off_t offset, int whence)
+    {
+        return -ESPIPE;
+    }
+
+    virtual int close()
+    {
+        return 0;
+    }
+
+    virtual short poll(short events) const
+    {
+        core_util_atomic_incr_u32(&scans, 1);
+        return _revents;
+    }
+
+    // Change the state of the handle and notify pollers, as a driver would from its interrupt
+    void set_revents(short revents)
+    {
+        _revents = revents;
+        poll_change(this);
+    }
+
+    // Change the state of the handle like a driver that does not notify pollers
+    void set_revents_silently(short revents)
+    {
+        _revents = revents;
+    }
+
+    mutable volatile uint32_t scans;
+
+private:
+    volatile short _revents;
+};
+
+namespace {
+
+// Makes a file handle readable after a delay, from its own thread
+struct Notifier {
+    TestFileHandle *fh;
+    uint32_t delay_us;
+    bool notify;
+    bench_time_t changed_at;
+
+    void run()
+    {
+        bench_sleep_us(delay_us);
+        changed_at = bench_now();
+        if (notify) {
+            fh->set_revents(POLLIN);
+        } else {
+            fh->set_revents_silently(POLLIN);
+        }
+    }
+};
+
+// Polls a file handle from its own thread
+struct Poller {
+    TestFileHandle *fh;
+    int result;
+
+    void run()
+    {
+        pollfh fhs = { fh, POLLIN, 0 };
+        result = poll(&fhs, 1, 1000);
+    }
+};
+
+}
+
+class TestMbedPoll : public testing::Test {
+protected:
+    TestMbedPoll() : _thread(NULL) {}
+
+    // Make fh readable after delay_ms from another thread, recording when it happened
+    void change_after(TestFileHandle &fh, uint32_t delay_ms, bool notify = true)
+    {
+        _notifier.fh = &fh;
+        _notifier.delay_us = delay_ms * 1000;
+        _notifier.notify = notify;
+        _thread = new rtos::Thread;
+        ASSERT_EQ(osOK, _thread->start(callback(&_notifier, &Notifier::run)));
+    }
+
+    // Microseconds from the change to now
+    uint64_t wake_latency()
+    {
+        bench_time_t now = bench_now();
+        _thread->join();
+        delete _thread;
+        _thread = NULL;
+        return (now - _notifier.changed_at) / 1000;
+    }
+
+    Notifier _notifier;
+    rtos::Thread *_thread;
+};
+
+TEST_F(TestMbedPoll, ready_without_blocking)
+{
+    TestFileHandle fh;
+    fh.set_revents(POLLIN);
+    pollfh fhs = { &fh, POLLIN, 0 };
+
+    EXPECT_EQ(1, poll(&fhs, 1, -1));
+    EXPECT_EQ(POLLIN, fhs.revents);
+    EXPECT_EQ(1U, fh.scans);
+}
+
+TEST_F(TestMbedPoll, zero_timeout_scans_once)
+{
+    TestFileHandle fh;
+    pollfh fhs = { &fh, POLLIN, 0 };
+
+    EXPECT_EQ(0, poll(&fhs, 1, 0));
+    EXPECT_EQ(0, fhs.revents);
+    EXPECT_EQ(1U, fh.scans);
+}
+
+TEST_F(TestMbedPoll, null_handle_is_invalid)
+{
+    pollfh fhs = { NULL, POLLIN, 0 };
+
+    EXPECT_EQ(1, poll(&fhs, 1, -1));
+    EXPECT_EQ(POLLNVAL, fhs.revents);
+}
+
+TEST_F(TestMbedPoll, change_wakes_poller)
+{
+    TestFileHandle fh;
+    pollfh fhs = { &fh, POLLIN, 0 };
+
+    change_after(fh, 50);
+    EXPECT_EQ(1, poll(&fhs, 1, -1));
+    uint64_t latency_us = wake_latency();
+
+    EXPECT_EQ(POLLIN, fhs.revents);
+    // Initial scan, scan after registering, scan after the single wake-up
+    EXPECT_EQ(3U, fh.scans);
+    EXPECT_LT(latency_us, 20000U);
+    bench_report("poll_wake_latency_us", latency_us, "us");
+}
+
+TEST_F(TestMbedPoll, timeout_without_change)
+{
+    TestFileHandle fh;
+    pollfh fhs = { &fh, POLLIN, 0 };
+
+    bench_time_t start = bench_now();
+    EXPECT_EQ(0, poll(&fhs, 1, 30));
+    uint64_t elapsed_ms = bench_ns_since(start) / 1000000;
+
+    EXPECT_EQ(0, fhs.revents);
+    EXPECT_GE(elapsed_ms, 30U);
+    // Initial scan, scan after registering, scan after the timeout
+    EXPECT_EQ(3U, fh.scans);
+}
+
+TEST_F(TestMbedPoll, unrelated_change_does_not_wake)
+{
+    TestFileHandle fh;
+    TestFileHandle other;
+    pollfh fhs = { &fh, POLLIN, 0 };
+
+    change_after(other, 10);
+    EXPECT_EQ(0, poll(&fhs, 1, 50));
+    wake_latency();
+
+    // Only the timeout woke the poller
+    EXPECT_EQ(3U, fh.scans);
+    EXPECT_EQ(0U, other.scans);
+}
+
+TEST_F(TestMbedPoll, change_on_any_handle_wakes_poller)
+{
+    TestFileHandle fh[3];
+    pollfh fhs[3] = {
+        { &fh[0], POLLIN, 0 },
+        { &fh[1], POLLIN, 0 },
+        { &fh[2], POLLIN, 0 },
+    };
+
+    change_after(fh[2], 10);
+    EXPECT_EQ(1, poll(fhs, 3, 1000));
+    wake_latency();
+
+    EXPECT_EQ(0, fhs[0].revents);
+    EXPECT_EQ(0, fhs[1].revents);
+    EXPECT_EQ(POLLIN, fhs[2].revents);
+    EXPECT_EQ(3U, fh[2].scans);
+}
+
+TEST_F(TestMbedPoll, change_wakes_all_pollers)
+{
+    TestFileHandle fh;
+    Poller pollers[2] = { { &fh, 0 }, { &fh, 0 } };
+    rtos::Thread threads[2];
+
+    for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(osOK, threads[i].start(callback(&pollers[i], &Poller::run)));
+    }
+    change_after(fh, 50);
+    for (int i = 0; i < 2; i++) {
+        threads[i].join();
+    }
+    wake_latency();
+
+    EXPECT_EQ(1, pollers[0].result);
+    EXPECT_EQ(1, pollers[1].result);
+    // Three scans by each poller
+    EXPECT_EQ(6U, fh.scans);
+}
+
+TEST_F(TestMbedPoll, silent_change_found_by_rescan)
+{
+    TestFileHandle fh;
+    pollfh fhs = { &fh, POLLIN, 0 };
+
+    bench_time_t start = bench_now();
+    change_after(fh, 10, false);
+    EXPECT_EQ(1, poll(&fhs, 1, -1));
+    uint64_t elapsed_ms = bench_ns_since(start) / 1000000;
+    wake_latency();
+
+    // Found by the first rescan, after MBED_CONF_PLATFORM_POLL_RESCAN_INTERVAL
+    EXPECT_EQ(POLLIN, fhs.revents);
+    EXPECT_EQ(3U, fh.scans);
+    EXPECT_GE(elapsed_ms, 90U);
+    EXPECT_LT(elapsed_ms, 500U);
+}
+
+TEST_F(TestMbedPoll, wake_latency_bench)
+{
+    const int rounds = 50;
+    uint64_t total_us = 0;
+    uint64_t worst_us = 0;
+    uint32_t scans = 0;
+
+    for (int i = 0; i < rounds; i++) {
+        TestFileHandle fh;
+        pollfh fhs = { &fh, POLLIN, 0 };
+
+        change_after(fh, 2);
+        ASSERT_EQ(1, poll(&fhs, 1, -1));
+        uint64_t latency_us = wake_latency();
+        total_us += latency_us;
+        if (latency_us > worst_us) {
+            worst_us = latency_us;
+        }
+        scans += fh.scans;
+    }
+
+    // One wake-up per change, rather than one per scheduler tick
+    EXPECT_EQ(3U * rounds, scans);
+    bench_report("poll_wake_latency_average_us", (double)total_us / rounds, "us");
+    bench_report("poll_wake_latency_worst_us", worst_us, "us");
+}
@@ -0,0 +1,17 @@
+
+####################
+# UNIT TESTS
+####################
+
+# Pollers and notifiers are real threads of the POSIX rtos backend
+set(unittest-rtos posix)
+
+set(unittest-sources
+)
+
+set(unittest-test-sources
+  platform/mbed_poll/test_mbed_poll.cpp
+  platform/mbed_poll/mbed_poll_rtos.cpp
+  stubs/FileHandle_stub.cpp
+  stubs/mbed_assert_stub.c
+)
@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Channel tests and benchmarks against Mail, on the POSIX rtos backend.
+ * Benchmark results are printed and recorded as gtest properties.
+ */
+
+#include "gtest/gtest.h"
+
+#include "bench_timer.h"
+#include "rtos/Channel.h"
+#include "rtos/Mail.h"
+#include "rtos/ThisThread.h"
+#include "rtos/Thread.h"
+
+using namespace rtos;
+
+namespace {
+
+struct Message {
+    uint32_t sender;
+    uint32_t sequence;
+    uint32_t payload[2];
+};
+
+const int producer_count = 4;
+const uint32_t bench_messages = 200000;
+
+void report(const char *name, bench_time_t start, uint32_t messages)
+{
+    bench_report(name, (double)bench_ns_since(start) / messages, "ns/message");
+}
+
+// Runs task->run() on a new thread; the task must outlive join()
+template <typename T>
+void start(Thread &thread, T *task)
+{
+    ASSERT_EQ(osOK, thread.start(mbed::callback(task, &T::run)));
+}
+
+/* Thread tasks, sharing the state of their test */
+
+struct DelayedPut {
+    Channel<uint32_t, 1> *channel;
+
+    void run()
+    {
+        ThisThread::sleep_for(10);
+        channel->put(42);
+    }
+};
+
+struct DelayedGet {
+    Channel<uint32_t, 1> *channel;
+    uint32_t *value;
+
+    void run()
+    {
+        ThisThread::sleep_for(10);
+        channel->get(*value);
+    }
+};
+
+struct NumberedProducer {
+    Channel<Message, 16> *channel;
+    volatile uint32_t *started;
+
+    void run()
+    {
+        Message message = { core_util_atomic_incr_u32(started, 1) - 1, 0, { 0, 0 } };
+        for (uint32_t i = 0; i < bench_messages / producer_count; i++) {
+            message.sequence = i;
+            channel->put(message);
+        }
+    }
+};
+
+struct ChannelProducer {
+    Channel<Message, 16> *channel;
+
+    void run()
+    {
+        Message sent = { 0, 0, { 0, 0 } };
+        for (uint32_t i = 0; i < bench_messages; i++) {
+            sent.sequence = i;
+            channel->put(sent);
+        }
+    }
+};
+
+struct MailProducer {
+    Mail<Message, 16> *mail;
+
+    void run()
+    {
+        for (uint32_t i = 0; i < bench_messages; i++) {
+            Message *mptr;
+            // Mail::alloc() cannot block, so a full pool is retried
+            while ((mptr = mail->alloc()) == NULL) {
+                ThisThread::yield();
+            }
+            mptr->sequence = i;
+            mail->put(mptr);
+        }
+    }
+};
+
+}
+
+class TestChannel : public testing::Test {
+};
+
+TEST_F(TestChannel, try_put_and_try_get_are_fifo)
+{
+    Channel<Message, 4> channel;
+    Message message = { 0, 0, { 0, 0 } };
+
+    EXPECT_TRUE(channel.empty());
+    for (uint32_t i = 0; i < 4; i++) {
+        message.sequence = i;
+        EXPECT_TRUE(channel.try_put(message));
+    }
+    EXPECT_TRUE(channel.full());
+    EXPECT_EQ(4u, channel.count());
+    EXPECT_FALSE(channel.try_put(message));
+
+    for (uint32_t i = 0; i < 4; i++) {
+        EXPECT_TRUE(channel.try_get(message));
+        EXPECT_EQ(i, message.sequence);
+    }
+    EXPECT_FALSE(channel.try_get(message));
+    EXPECT_TRUE(channel.empty());
+}
+
+TEST_F(TestChannel, wraps_around_many_times)
+{
+    Channel<uint32_t, 2> channel;
+    uint32_t value;
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        ASSERT_TRUE(channel.try_put(i));
+        ASSERT_TRUE(channel.try_get(value));
+        ASSERT_EQ(i, value);
+    }
+}
+
+TEST_F(TestChannel, timed_waits_expire)
+{
+    Channel<uint32_t, 1> channel;
+    uint32_t value = 0;
+
+    EXPECT_FALSE(channel.get(value, 0));
+    bench_time_t start = bench_now();
+    EXPECT_FALSE(channel.get(value, 20));
+    EXPECT_GE(bench_seconds_since(start), 0.019);
+
+    EXPECT_TRUE(channel.put(1, 0));
+    EXPECT_FALSE(channel.put(2, 0));
+    start = bench_now();
+    EXPECT_FALSE(channel.put(2, 20));
+    EXPECT_GE(bench_seconds_since(start), 0.019);
+}
+
+TEST_F(TestChannel, blocked_get_wakes_on_put)
+{
+    Channel<uint32_t, 1> channel;
+    Thread thread;
+    uint32_t value = 0;
+    DelayedPut task = { &channel };
+
+    start(thread, &task);
+    EXPECT_TRUE(channel.get(value, 1000));
+    EXPECT_EQ(42u, value);
+    thread.join();
+}
+
+TEST_F(TestChannel, blocked_put_wakes_on_get)
+{
+    Channel<uint32_t, 1> channel;
+    Thread thread;
+    uint32_t value = 0;
+    DelayedGet task = { &channel, &value };
+
+    ASSERT_TRUE(channel.try_put(1));
+    start(thread, &task);
+    EXPECT_TRUE(channel.put(2, 1000));
+    thread.join();
+    EXPECT_EQ(1u, value);
+}
+
+TEST_F(TestChannel, drain_takes_a_burst)
+{
+    Channel<uint32_t, 8> channel;
+    uint32_t values[8];
+
+    EXPECT_EQ(0u, channel.drain(values, 8));
+    for (uint32_t i = 0; i < 5; i++) {
+        channel.try_put(i);
+    }
+    EXPECT_EQ(3u, channel.drain(values, 3));
+    EXPECT_EQ(2u, values[2]);
+    EXPECT_EQ(2u, channel.drain(values, 8, osWaitForever));
+    EXPECT_EQ(4u, values[1]);
+}
+
+TEST_F(TestChannel, many_producers_keep_per_sender_order)
+{
+    Channel<Message, 16> channel;
+    Thread threads[producer_count];
+    uint32_t next[producer_count] = { 0 };
+    volatile uint32_t started = 0;
+    NumberedProducer task = { &channel, &started };
+
+    for (int i = 0; i < producer_count; i++) {
+        start(threads[i], &task);
+    }
+    Message message;
+    for (uint32_t i = 0; i < bench_messages; i++) {
+        ASSERT_TRUE(channel.get(message, 5000));
+        ASSERT_EQ(next[message.sender], message.sequence);
+        next[message.sender]++;
+    }
+    for (int i = 0; i < producer_count; i++) {
+        threads[i].join();
+    }
+    EXPECT_TRUE(channel.empty());
+}
+
+TEST_F(TestChannel, bench_same_thread_round_trip)
+{
+    Channel<Message, 16> channel;
+    Mail<Message, 16> mail;
+    Message message = { 0, 0, { 0, 0 } };
+
+    bench_time_t start_time = bench_now();
+    for (uint32_t i = 0; i < bench_messages; i++) {
+        message.sequence = i;
+        channel.try_put(message);
+        channel.try_get(message);
+    }
+    report("channel_round_trip", start_time, bench_messages);
+
+    start_time = bench_now();
+    for (uint32_t i = 0; i < bench_messages; i++) {
+        Message *mptr = mail.alloc();
+        mptr->sequence = i;
+        mail.put(mptr);
+        osEvent evt = mail.get(0);
+        mail.free(static_cast<Message *>(evt.value.p));
+    }
+    report("mail_round_trip", start_time, bench_messages);
+}
+
+TEST_F(TestChannel, bench_producer_consumer)
+{
+    Channel<Message, 16> channel;
+    Mail<Message, 16> mail;
+    Thread channel_producer;
+    Thread drain_producer;
+    Thread mail_producer;
+    ChannelProducer channel_task = { &channel };
+    MailProducer mail_task = { &mail };
+
+    bench_time_t start_time = bench_now();
+    start(channel_producer, &channel_task);
+    Message message;
+    for (uint32_t i = 0; i < bench_messages; i++) {
+        ASSERT_TRUE(channel.get(message));
+        ASSERT_EQ(i, message.sequence);
+    }
+    report("channel_cross_thread", start_time, bench_messages);
+    channel_producer.join();
+
+    start_time = bench_now();
+    start(drain_producer, &channel_task);
+    Message batch[16];
+    for (uint32_t i = 0; i < bench_messages;) {
+        uint32_t received = channel.drain(batch, 16, osWaitForever);
+        ASSERT_NE(0u, received);
+        ASSERT_EQ(i, batch[0].sequence);
+        i += received;
+    }
+    report("channel_cross_thread_drain", start_time, bench_messages);
+    drain_producer.join();
+
+    start_time = bench_now();
+    start(mail_producer, &mail_task);
+    for (uint32_t i = 0; i < bench_messages; i++) {
+        osEvent evt = mail.get();
+        ASSERT_EQ(osEventMail, evt.status);
+        Message *mptr = static_cast<Message *>(evt.value.p);
+        ASSERT_EQ(i, mptr->sequence);
+        mail.free(mptr);
+    }
+    report("mail_cross_thread", start_time, bench_messages);
+    mail_producer.join();
+}
@@ -0,0 +1,11 @@
+####################
+# UNIT TESTS
+####################
+
+# Channel runs on the POSIX backend, so blocking and benchmarks use real threads
+set(unittest-rtos posix)
+
+set(unittest-test-sources
+  rtos/Channel/test_Channel.cpp
+  stubs/mbed_assert_stub.c
+)
@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stress tests for the rtos classes running on the POSIX backend.
+ *
+ * Every test runs its workers as rtos::Thread on real pthreads, so the
+ * races they look for are genuine; run the suite under valgrind --tool=helgrind
+ * or a -fsanitize=thread build to check the port itself.
+ */
+
+#include "gtest/gtest.h"
+
+#include "rtos/Kernel.h"
+#include "rtos/Mail.h"
+#include "rtos/MemoryPool.h"
+#include "rtos/Mutex.h"
+#include "rtos/Queue.h"
+#include "rtos/Semaphore.h"
+#include "rtos/EventFlags.h"
+#include "rtos/ConditionVariable.h"
+#include "rtos/ThisThread.h"
+#include "rtos/Thread.h"
+
+using namespace rtos;
+
+namespace {
+
+const int worker_count = 4;
+const int rounds = 20000;
+
+struct Workers {
+    Thread *threads[worker_count];
+
+    Workers()
+    {
+        for (int i = 0; i < worker_count; i++) {
+            threads[i] = new Thread(osPriorityNormal, OS_STACK_SIZE);
+        }
+    }
+
+    ~Workers()
+    {
+        for (int i = 0; i < worker_count; i++) {
+            delete threads[i];
+        }
+    }
+
+    // The task is shared by all workers and must outlive join()
+    template <typename T>
+    void start(T *task)
+    {
+        for (int i = 0; i < worker_count; i++) {
+            ASSERT_EQ(osOK, threads[i]->start(mbed::callback(task, &T::run)));
+        }
+    }
+
+    void join()
+    {
+        for (int i = 0; i < worker_count; i++) {
+            EXPECT_EQ(osOK, threads[i]->join());
+        }
+    }
+};
+
+struct Message {
+    uint32_t sender;
+    uint32_t sequence;
+};
+
+void timer_count(void *argument)
+{
+    (*static_cast<volatile uint32_t *>(argument))++;
+}
+
+struct SelfDeletingTimer {
+    osTimerId_t id;
+    Semaphore done;
+};
+
+void timer_delete_self(void *argument)
+{
+    SelfDeletingTimer *timer = static_cast<SelfDeletingTimer *>(argument);
+    osTimerDelete(timer->id);
+    timer->done.release();
+}
+
+/* Worker tasks, sharing the state of their test */
+
+struct Incrementer {
+    Mutex *mutex;
+    uint32_t *counter;
+
+    void run()
+    {
+        for (int i = 0; i < rounds; i++) {
+            mutex->lock();
+            (*counter)++;
+            mutex->unlock();
+        }
+    }
+};
+
+struct TokenTaker {
+    Semaphore *tokens;
+    Semaphore *done;
+    Mutex *mutex;
+    uint32_t *taken;
+
+    void run()
+    {
+        while (tokens->wait(100) > 0) {
+            mutex->lock();
+            (*taken)++;
+            mutex->unlock();
+        }
+        done->release();
+    }
+};
+
+struct FlagsWaiter {
+    EventFlags *flags;
+    Semaphore *arrived;
+
+    void run()
+    {
+        arrived->release();
+        EXPECT_EQ(0x3u, flags->wait_all(0x3, osWaitForever, false) & 0x3);
+    }
+};
+
+struct CountDown {
+    Mutex *mutex;
+    ConditionVariable *cond;
+    int *remaining;
+
+    void run()
+    {
+        mutex->lock();
+        (*remaining)--;
+        cond->notify_all();
+        mutex->unlock();
+    }
+};
+
+struct QueueSender {
+    Message (*messages)[rounds];
+    Queue<Message, 16> *queue;
+    Semaphore *index_lock;
+    uint32_t *started;
+
+    void run()
+    {
+        index_lock->wait();
+        uint32_t sender = (*started)++;
+        index_lock->release();
+        for (uint32_t i = 0; i < (uint32_t)rounds; i++) {
+            messages[sender][i].sender = sender;
+            messages[sender][i].sequence = i;
+            ASSERT_EQ(osOK, queue->put(&messages[sender][i], osWaitForever));
+        }
+    }
+};
+
+struct MailSender {
+    Mail<Message, 8> *mail;
+
+    void run()
+    {
+        for (uint32_t i = 0; i < (uint32_t)rounds; i++) {
+            Message *message;
+            while ((message = mail->alloc()) == NULL) {
+                ThisThread::yield();
+            }
+            message->sequence = i;
+            ASSERT_EQ(osOK, mail->put(message));
+        }
+    }
+};
+
+struct TickReader {
+    void run()
+    {
+        uint64_t last = Kernel::get_ms_count();
+        for (int i = 0; i < rounds; i++) {
+            uint64_t now = Kernel::get_ms_count();
+            ASSERT_GE(now, last);
+            last = now;
+        }
+    }
+};
+
+}
+
+class TestPosixRtos : public testing::Test {
+};
+
+TEST_F(TestPosixRtos, mutex_serialises_increments)
+{
+    Mutex mutex;
+    uint32_t counter = 0;
+    Workers workers;
+
+    Incrementer task = { &mutex, &counter };
+    workers.start(&task);
+    workers.join();
+
+    EXPECT_EQ((uint32_t)(worker_count * rounds), counter);
+}
+
+TEST_F(TestPosixRtos, semaphore_hands_over_every_token)
+{
+    Semaphore tokens(0, rounds);
+    Semaphore done(0);
+    uint32_t taken = 0;
+    Mutex mutex;
+    Workers workers;
+
+    TokenTaker task = { &tokens, &done, &mutex, &taken };
+    workers.start(&task);
+    for (int i = 0; i < rounds; i++) {
+        ASSERT_EQ(osOK, tokens.release());
+    }
+    workers.join();
+
+    EXPECT_EQ((uint32_t)rounds, taken);
+    EXPECT_EQ(0, tokens.wait(0));
+}
+
+TEST_F(TestPosixRtos, event_flags_wake_all_waiters)
+{
+    EventFlags flags;
+    Semaphore arrived(0);
+    Workers workers;
+
+    FlagsWaiter task = { &flags, &arrived };
+    workers.start(&task);
+    for (int i = 0; i < worker_count; i++) {
+        arrived.wait();
+    }
+    flags.set(0x1);
+    ThisThread::sleep_for(5);
+    flags.set(0x2);
+    workers.join();
+
+    EXPECT_EQ(0x3u, flags.get());
+}
+
+TEST_F(TestPosixRtos, condition_variable_counts_down)
+{
+    Mutex mutex;
+    ConditionVariable cond(mutex);
+    int remaining = worker_count;
+    Workers workers;
+
+    CountDown task = { &mutex, &cond, &remaining };
+    workers.start(&task);
+    mutex.lock();
+    while (remaining != 0) {
+        cond.wait();
+    }
+    mutex.unlock();
+    workers.join();
+}
+
+TEST_F(TestPosixRtos, queue_keeps_per_sender_order)
+{
+    static Message messages[worker_count][rounds];
+    Queue<Message, 16> queue;
+    uint32_t next[worker_count] = { 0 };
+    Semaphore index_lock(1);
+    uint32_t started = 0;
+    Workers workers;
+
+    QueueSender task = { messages, &queue, &index_lock, &started };
+    workers.start(&task);
+    for (int i = 0; i < worker_count * rounds; i++) {
+        osEvent evt = queue.get();
+        ASSERT_EQ(osEventMessage, evt.status);
+        Message *message = static_cast<Message *>(evt.value.p);
+        ASSERT_EQ(next[message->sender], message->sequence);
+        next[message->sender]++;
+    }
+    workers.join();
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(osEventTimeout, queue.get(1).status);
+}
+
+TEST_F(TestPosixRtos, queue_delivers_by_priority)
+{
+    Queue<Message, 4> queue;
+    Message low = { 0, 0 }, high = { 0, 1 }, low2 = { 0, 2 };
+
+    EXPECT_EQ(osOK, queue.put(&low, 0, 0));
+    EXPECT_EQ(osOK, queue.put(&high, 0, 5));
+    EXPECT_EQ(osOK, queue.put(&low2, 0, 0));
+
+    EXPECT_EQ(&high, queue.get(0).value.p);
+    EXPECT_EQ(&low, queue.get(0).value.p);
+    EXPECT_EQ(&low2, queue.get(0).value.p);
+}
+
+TEST_F(TestPosixRtos, mail_round_trips_under_load)
+{
+    Mail<Message, 8> mail;
+    Semaphore sent(0);
+    uint32_t received = 0;
+    uint64_t sum = 0;
+    Workers workers;
+
+    MailSender task = { &mail };
+    workers.start(&task);
+    while (received < (uint32_t)(worker_count * rounds)) {
+        osEvent evt = mail.get();
+        ASSERT_EQ(osEventMail, evt.status);
+        Message *message = static_cast<Message *>(evt.value.p);
+        sum += message->sequence;
+        ASSERT_EQ(osOK, mail.free(message));
+        received++;
+    }
+    workers.join();
+
+    EXPECT_EQ((uint64_t)worker_count * rounds * (rounds - 1) / 2, sum);
+}
+
+TEST_F(TestPosixRtos, memory_pool_exhausts_and_validates)
+{
+    MemoryPool<Message, 4> pool;
+    Message *blocks[4];
+    Message outside;
+
+    for (int i = 0; i < 4; i++) {
+        blocks[i] = pool.alloc();
+        ASSERT_TRUE(blocks[i] != NULL);
+    }
+    EXPECT_TRUE(pool.alloc() == NULL);
+    EXPECT_EQ(osErrorParameter, pool.free(&outside));
+    EXPECT_EQ(osErrorParameter, pool.free(reinterpret_cast<Message *>(reinterpret_cast<char *>(blocks[0]) + 1)));
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(osOK, pool.free(blocks[i]));
+    }
+    EXPECT_TRUE(pool.calloc() != NULL);
+}
+
+TEST_F(TestPosixRtos, periodic_timer_fires_until_stopped)
+{
+    volatile uint32_t count = 0;
+    osTimerId_t timer = osTimerNew(timer_count, osTimerPeriodic, (void *)&count, NULL);
+    ASSERT_TRUE(timer != NULL);
+
+    EXPECT_EQ(osErrorParameter, osTimerStart(timer, 0));
+    EXPECT_EQ(osOK, osTimerStart(timer, 2));
+    EXPECT_EQ(1u, osTimerIsRunning(timer));
+    ThisThread::sleep_for(50);
+    EXPECT_EQ(osOK, osTimerStop(timer));
+    EXPECT_EQ(osErrorResource, osTimerStop(timer));
+    uint32_t fired = count;
+    ThisThread::sleep_for(10);
+
+    EXPECT_GE(fired, 10u);
+    EXPECT_EQ(fired, count);
+    EXPECT_EQ(osOK, osTimerDelete(timer));
+}
+
+TEST_F(TestPosixRtos, one_shot_timer_can_delete_itself)
+{
+    SelfDeletingTimer timer;
+    timer.id = osTimerNew(timer_delete_self, osTimerOnce, &timer, NULL);
+    ASSERT_TRUE(timer.id != NULL);
+
+    EXPECT_EQ(osOK, osTimerStart(timer.id, 1));
+    EXPECT_EQ(1, timer.done.wait(1000));
+}
+
+TEST_F(TestPosixRtos, kernel_tick_is_monotonic_across_threads)
+{
+    Workers workers;
+    uint64_t start = Kernel::get_ms_count();
+
+    TickReader task;
+    workers.start(&task);
+    ThisThread::sleep_for(20);
+    workers.join();
+
+    EXPECT_GE(Kernel::get_ms_count() - start, 20u);
+}
@@ -0,0 +1,11 @@
+####################
+# UNIT TESTS
+####################
+
+# Stress tests for the rtos classes on the POSIX backend
+set(unittest-rtos posix)
+
+set(unittest-test-sources
+  rtos/posix/test_posix_rtos.cpp
+  stubs/mbed_assert_stub.c
+)
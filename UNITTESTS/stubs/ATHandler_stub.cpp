@@ -92,6 +92,11 @@ FileHandle *ATHandler::get_file_handle()
     return ATHandler_stub::fh_value;
 }
 
+events::EventQueue *ATHandler::get_event_queue() const
+{
+    return &_queue;
+}
+
 void ATHandler::set_file_handle(FileHandle *fh)
 {
 }
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) , Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "drivers/SerialBase.h"
+#include "platform/mbed_critical.h"
+#include "platform/mbed_power_mgmt.h"
+
+namespace mbed {
+
+// The serial HAL identifies the object with a 32 bit id, which can not
+// hold a pointer on the host, so the objects are looked up in a table
+#define SERIAL_BASE_STUB_MAX_OBJECTS 8
+static SerialBase *serial_base_objects[SERIAL_BASE_STUB_MAX_OBJECTS];
+
+SerialBase::SerialBase(PinName tx, PinName rx, int baud) :
+    _serial(), _baud(baud)
+{
+    uint32_t id = 0;
+
+    for (size_t i = 0; i < sizeof _irq / sizeof _irq[0]; i++) {
+        _irq[i] = NULL;
+    }
+
+    while (id < SERIAL_BASE_STUB_MAX_OBJECTS - 1 && serial_base_objects[id]) {
+        id++;
+    }
+    serial_base_objects[id] = this;
+
+    serial_init(&_serial, tx, rx);
+    serial_baud(&_serial, _baud);
+    serial_irq_handler(&_serial, SerialBase::_irq_handler, id);
+}
+
+void SerialBase::baud(int baudrate)
+{
+    serial_baud(&_serial, baudrate);
+    _baud = baudrate;
+}
+
+void SerialBase::format(int bits, Parity parity, int stop_bits)
+{
+    serial_format(&_serial, bits, (SerialParity)parity, stop_bits);
+}
+
+int SerialBase::readable()
+{
+    return serial_readable(&_serial);
+}
+
+int SerialBase::writeable()
+{
+    return serial_writable(&_serial);
+}
+
+void SerialBase::attach(Callback<void()> func, IrqType type)
+{
+    if (func) {
+        if (!_irq[type]) {
+            sleep_manager_lock_deep_sleep();
+        }
+        _irq[type] = func;
+        serial_irq_set(&_serial, (SerialIrq)type, 1);
+    } else {
+        if (_irq[type]) {
+            sleep_manager_unlock_deep_sleep();
+        }
+        _irq[type] = NULL;
+        serial_irq_set(&_serial, (SerialIrq)type, 0);
+    }
+}
+
+void SerialBase::_irq_handler(uint32_t id, SerialIrq irq_type)
+{
+    SerialBase *handler = serial_base_objects[id];
+    if (handler && handler->_irq[irq_type]) {
+        handler->_irq[irq_type]();
+    }
+}
+
+int SerialBase::_base_getc()
+{
+    return serial_getc(&_serial);
+}
+
+int SerialBase::_base_putc(int c)
+{
+    serial_putc(&_serial, c);
+    return c;
+}
+
+void SerialBase::send_break()
+{
+}
+
+void SerialBase::lock()
+{
+}
+
+void SerialBase::unlock()
+{
+}
+
+SerialBase::~SerialBase()
+{
+    for (int irq = 0; irq < IrqCnt; irq++) {
+        attach(NULL, (IrqType)irq);
+    }
+
+    for (int id = 0; id < SERIAL_BASE_STUB_MAX_OBJECTS; id++) {
+        if (serial_base_objects[id] == this) {
+            serial_base_objects[id] = NULL;
+        }
+    }
+}
+
+} // namespace mbed
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "drivers/Ticker.h"
+#include "drivers/Timeout.h"
+
+namespace mbed {
+
+void Ticker::detach()
+{
+    _function = 0;
+}
+
+void Ticker::setup(us_timestamp_t t)
+{
+    _delay = t;
+}
+
+void Ticker::handler()
+{
+    if (_function) {
+        _function();
+    }
+}
+
+void Timeout::handler()
+{
+    Callback<void()> local = _function;
+    detach();
+    local.call();
+}
+
+} // namespace mbed
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>
+#include "drivers/TimerEvent.h"
+
+namespace mbed {
+
+TimerEvent::TimerEvent() : event(), _ticker_data(NULL)
+{
+}
+
+TimerEvent::TimerEvent(const ticker_data_t *data) : event(), _ticker_data(data)
+{
+}
+
+TimerEvent::~TimerEvent()
+{
+}
+
+void TimerEvent::irq(uint32_t id)
+{
+}
+
+void TimerEvent::insert(timestamp_t timestamp)
+{
+}
+
+void TimerEvent::insert_absolute(us_timestamp_t timestamp)
+{
+}
+
+void TimerEvent::remove()
+{
+}
+
+} // namespace mbed
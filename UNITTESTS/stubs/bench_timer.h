@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BENCH_TIMER_H
+#define BENCH_TIMER_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "gtest/gtest.h"
+
+/** Point in time for benchmarks, in nanoseconds of the monotonic clock */
+typedef uint64_t bench_time_t;
+
+/** Current time of the monotonic clock
+ *
+ * @return Nanoseconds since an arbitrary start
+ */
+inline bench_time_t bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (bench_time_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/** Nanoseconds elapsed since a point in time
+ *
+ * @param start Value returned by bench_now()
+ */
+inline uint64_t bench_ns_since(bench_time_t start)
+{
+    return bench_now() - start;
+}
+
+/** Seconds elapsed since a point in time
+ *
+ * @param start Value returned by bench_now()
+ */
+inline double bench_seconds_since(bench_time_t start)
+{
+    return bench_ns_since(start) / 1e9;
+}
+
+/** Sleep the calling thread, like a device busy for that long
+ *
+ * @param us Microseconds to sleep
+ */
+inline void bench_sleep_us(uint32_t us)
+{
+    struct timespec ts;
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+/** Print a benchmark result and record it as a gtest property, so
+ * --gtest_output=xml turns a run into a baseline
+ *
+ * @param name  Name of the figure
+ * @param value Measured value
+ * @param unit  Unit of the value
+ */
+inline void bench_report(const char *name, double value, const char *unit)
+{
+    printf("[ BENCH    ] %-32s %12.2f %s\n", name, value, unit);
+    ::testing::Test::RecordProperty(name, (int)value);
+}
+
+#endif // BENCH_TIMER_H
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Virtual time equeue platform for single threaded tests.
+ *
+ * The tests are single threaded and run a single EventQueue, so mutexes
+ * are no-ops and the event semaphore is a plain flag. Waiting on it does not
+ * block; instead the virtual clock jumps forward by
+ * the requested amount, which lets equeue_dispatch() skip straight from one
+ * deadline to the next.
+ */
+
+#include "equeue_sim.h"
+#include "equeue_platform.h"
+
+static unsigned sim_tick = 0;
+static bool sim_signal = false;
+
+void equeue_sim_set_tick(unsigned tick)
+{
+    sim_tick = tick;
+}
+
+// Tick operations
+unsigned equeue_tick(void)
+{
+    return sim_tick;
+}
+
+
+// Mutex operations
+int equeue_mutex_create(equeue_mutex_t *m)
+{
+    (void)m;
+    return 0;
+}
+
+void equeue_mutex_destroy(equeue_mutex_t *m)
+{
+    (void)m;
+}
+
+void equeue_mutex_lock(equeue_mutex_t *m)
+{
+    (void)m;
+}
+
+void equeue_mutex_unlock(equeue_mutex_t *m)
+{
+    (void)m;
+}
+
+
+// Semaphore operations
+int equeue_sema_create(equeue_sema_t *s)
+{
+    (void)s;
+    sim_signal = false;
+    return 0;
+}
+
+void equeue_sema_destroy(equeue_sema_t *s)
+{
+    (void)s;
+}
+
+void equeue_sema_signal(equeue_sema_t *s)
+{
+    (void)s;
+    sim_signal = true;
+}
+
+bool equeue_sema_wait(equeue_sema_t *s, int ms)
+{
+    (void)s;
+    bool signal = sim_signal;
+    sim_signal = false;
+
+    if (!signal && ms > 0) {
+        sim_tick += ms;
+    }
+
+    return signal;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EQUEUE_SIM_H
+#define EQUEUE_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Reset the virtual clock returned by equeue_tick().
+ *
+ * @param tick New value of the virtual clock in milliseconds.
+ */
+void equeue_sim_set_tick(unsigned tick);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EQUEUE_SIM_H
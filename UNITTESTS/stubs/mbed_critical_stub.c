@@ -68,33 +68,39 @@ bool core_util_atomic_cas_u32(volatile uint32_t *ptr, uint32_t *expectedCurrentV
 
 uint8_t core_util_atomic_incr_u8(volatile uint8_t *valuePtr, uint8_t delta)
 {
-    return 0;
+    *valuePtr += delta;
+    return *valuePtr;
 }
 
 uint16_t core_util_atomic_incr_u16(volatile uint16_t *valuePtr, uint16_t delta)
 {
-    return 0;
+    *valuePtr += delta;
+    return *valuePtr;
 }
 
 uint32_t core_util_atomic_incr_u32(volatile uint32_t *valuePtr, uint32_t delta)
 {
-    return 0;
+    *valuePtr += delta;
+    return *valuePtr;
 }
 
 
 uint8_t core_util_atomic_decr_u8(volatile uint8_t *valuePtr, uint8_t delta)
 {
-    return 0;
+    *valuePtr -= delta;
+    return *valuePtr;
 }
 
 uint16_t core_util_atomic_decr_u16(volatile uint16_t *valuePtr, uint16_t delta)
 {
-    return 0;
+    *valuePtr -= delta;
+    return *valuePtr;
 }
 
 uint32_t core_util_atomic_decr_u32(volatile uint32_t *valuePtr, uint32_t delta)
 {
-    return 0;
+    *valuePtr -= delta;
+    return *valuePtr;
 }
 
 
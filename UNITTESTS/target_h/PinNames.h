@@ -32,6 +32,8 @@ typedef enum {
 } PinName;
 
 typedef enum {
+    PullNone = 0,
+    PullDefault = PullNone
 } PinMode;
 
 #ifdef __cplusplus
@@ -18,6 +18,9 @@
 #ifndef MBED_DEVICE_H
 #define MBED_DEVICE_H
 
+#define DEVICE_QSPI 1
+#define DEVICE_SPI 1
+
 #include "objects.h"
 
 #endif
@@ -29,6 +29,19 @@ typedef unsigned equeue_mutex_t;
 typedef struct equeue_sema {
 } equeue_sema_t;
 
+// Platform operations, implemented by stubs or by a test specific platform
+unsigned equeue_tick(void);
+
+int equeue_mutex_create(equeue_mutex_t *mutex);
+void equeue_mutex_destroy(equeue_mutex_t *mutex);
+void equeue_mutex_lock(equeue_mutex_t *mutex);
+void equeue_mutex_unlock(equeue_mutex_t *mutex);
+
+int equeue_sema_create(equeue_sema_t *sema);
+void equeue_sema_destroy(equeue_sema_t *sema);
+void equeue_sema_signal(equeue_sema_t *sema);
+bool equeue_sema_wait(equeue_sema_t *sema, int ms);
+
 #ifdef __cplusplus
 }
 #endif
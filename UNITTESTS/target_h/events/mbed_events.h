@@ -22,4 +22,6 @@
 
 #include "events/mbed_shared_queues.h"
 
+using namespace events;
+
 #endif
@@ -27,6 +27,22 @@ extern "C" {
 
 #include "gpio_object.h"
 
+struct gpio_irq_s {
+    int id;
+};
+
+struct qspi_s {
+    int hz;
+};
+
+struct serial_s {
+    int index;
+};
+
+struct spi_s {
+    int bits;
+};
+
 #ifdef __cplusplus
 }
 #endif
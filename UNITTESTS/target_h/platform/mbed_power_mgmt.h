@@ -15,3 +15,27 @@
  * limitations under the License.
  */
 
+#ifndef MBED_POWER_MGMT_H
+#define MBED_POWER_MGMT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sleep_manager_lock_deep_sleep(void);
+
+void sleep_manager_unlock_deep_sleep(void);
+
+void sleep_manager_sleep_auto(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// C++ linkage so it overloads sleep(unsigned) of the host C library
+static inline void sleep(void)
+{
+    sleep_manager_sleep_auto();
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include <cstring>
 
 #include "platform/mbed_retarget.h"
+#include "device.h"
 #include "nvic_wrapper.h"
 
 #endif
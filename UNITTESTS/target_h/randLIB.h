@@ -21,6 +21,8 @@
 
 extern void randLIB_seed_random(void);
 
+uint16_t randLIB_get_16bit(void);
+
 uint16_t randLIB_get_random_in_range(uint16_t min, uint16_t max);
 
 
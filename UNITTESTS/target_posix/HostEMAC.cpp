@@ -0,0 +1,283 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+
+#include "platform/mbed_critical.h"
+#include "HostEMAC.h"
+
+#define HOST_EMAC_IF_NAME       "hs"
+#define HOST_EMAC_MTU           1500
+#define HOST_EMAC_FRAME_MAX     (HOST_EMAC_MTU + 18)
+#define HOST_EMAC_RX_POLL_MS    50
+// Preamble, start delimiter, FCS and inter-frame gap
+#define HOST_EMAC_WIRE_OVERHEAD 24
+
+static uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+HostEMAC::HostEMAC(int fd, const uint8_t *hwaddr) : _fd(fd), _powered(false), _memory_manager(NULL),
+    _link_input_cb(NULL), _link_state_cb(NULL), _rx_thread(NULL), _link_rate(0), _tx_free_ns(0)
+{
+    memcpy(_hwaddr, hwaddr, sizeof(_hwaddr));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+HostEMAC::~HostEMAC()
+{
+    power_down();
+    close(_fd);
+}
+
+int HostEMAC::create_link(int fds[2])
+{
+    // SOCK_SEQPACKET keeps frame boundaries and never reorders
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        return -errno;
+    }
+    return 0;
+}
+
+int HostEMAC::open_tap(const char *ifname)
+{
+    int fd = open("/dev/net/tun", O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    if (ioctl(fd, TUNSETIFF, &ifr) < 0) {
+        int err = -errno;
+        close(fd);
+        return err;
+    }
+    return fd;
+}
+
+HostEMAC::stats_t HostEMAC::get_stats() const
+{
+    stats_t stats;
+    core_util_critical_section_enter();
+    stats = _stats;
+    core_util_critical_section_exit();
+    return stats;
+}
+
+uint32_t HostEMAC::get_mtu_size() const
+{
+    return HOST_EMAC_MTU;
+}
+
+uint32_t HostEMAC::get_align_preference() const
+{
+    return 0;
+}
+
+void HostEMAC::get_ifname(char *name, uint8_t size) const
+{
+    memcpy(name, HOST_EMAC_IF_NAME, (size < sizeof(HOST_EMAC_IF_NAME)) ? size : sizeof(HOST_EMAC_IF_NAME));
+}
+
+uint8_t HostEMAC::get_hwaddr_size() const
+{
+    return sizeof(_hwaddr);
+}
+
+bool HostEMAC::get_hwaddr(uint8_t *addr) const
+{
+    memcpy(addr, _hwaddr, sizeof(_hwaddr));
+    return true;
+}
+
+void HostEMAC::set_hwaddr(const uint8_t *addr)
+{
+    memcpy(_hwaddr, addr, sizeof(_hwaddr));
+}
+
+bool HostEMAC::link_out(emac_mem_buf_t *buf)
+{
+    uint8_t frame[HOST_EMAC_FRAME_MAX];
+    uint32_t len = _memory_manager->get_total_len(buf);
+    bool sent = false;
+
+    if (len <= sizeof(frame)) {
+        _memory_manager->copy_from_buf(frame, len, buf);
+        if (_link_rate) {
+            pace(len);
+        }
+        ssize_t ret;
+        do {
+            ret = write(_fd, frame, len);
+        } while (ret < 0 && errno == EINTR);
+        sent = ret == (ssize_t)len;
+    }
+    _memory_manager->free(buf);
+
+    core_util_critical_section_enter();
+    if (sent) {
+        _stats.tx_frames++;
+        _stats.tx_bytes += len;
+    } else {
+        _stats.tx_errors++;
+    }
+    core_util_critical_section_exit();
+    return sent;
+}
+
+void HostEMAC::set_link_rate(uint32_t bits_per_second)
+{
+    _link_rate = bits_per_second;
+}
+
+// Blocks until the previous frame and this one would have left the wire
+void HostEMAC::pace(uint32_t len)
+{
+    uint64_t wire_ns = (uint64_t)(len + HOST_EMAC_WIRE_OVERHEAD) * 8 * 1000000000 / _link_rate;
+
+    core_util_critical_section_enter();
+    uint64_t now = monotonic_ns();
+    uint64_t done = (_tx_free_ns > now ? _tx_free_ns : now) + wire_ns;
+    _tx_free_ns = done;
+    core_util_critical_section_exit();
+
+    // The default 50us timer slack would dominate the wire time of small
+    // frames. The slack is per thread, and the call is cheap next to the sleep.
+    prctl(PR_SET_TIMERSLACK, 1UL);
+
+    struct timespec ts;
+    ts.tv_sec = done / 1000000000;
+    ts.tv_nsec = done % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+bool HostEMAC::power_up()
+{
+    if (_powered) {
+        return true;
+    }
+    _powered = true;
+    _rx_thread = new rtos::Thread(osPriorityHigh, 2048, NULL, "host_emac_rx");
+    if (_rx_thread->start(mbed::callback(this, &HostEMAC::rx_task)) != osOK) {
+        delete _rx_thread;
+        _rx_thread = NULL;
+        _powered = false;
+        return false;
+    }
+    // The far end is always attached
+    if (_link_state_cb) {
+        _link_state_cb(true);
+    }
+    return true;
+}
+
+void HostEMAC::power_down()
+{
+    if (!_powered) {
+        return;
+    }
+    _powered = false;
+    _rx_thread->join();
+    delete _rx_thread;
+    _rx_thread = NULL;
+    if (_link_state_cb) {
+        _link_state_cb(false);
+    }
+}
+
+void HostEMAC::set_link_input_cb(emac_link_input_cb_t input_cb)
+{
+    _link_input_cb = input_cb;
+}
+
+void HostEMAC::set_link_state_cb(emac_link_state_change_cb_t state_cb)
+{
+    _link_state_cb = state_cb;
+}
+
+void HostEMAC::add_multicast_group(const uint8_t *address)
+{
+    // Every frame on the link is delivered
+}
+
+void HostEMAC::remove_multicast_group(const uint8_t *address)
+{
+}
+
+void HostEMAC::set_all_multicast(bool all)
+{
+}
+
+void HostEMAC::set_memory_manager(EMACMemoryManager &mem_mngr)
+{
+    _memory_manager = &mem_mngr;
+}
+
+void HostEMAC::rx_task()
+{
+    uint8_t frame[HOST_EMAC_FRAME_MAX];
+
+    while (_powered) {
+        struct pollfd pfd;
+        pfd.fd = _fd;
+        pfd.events = POLLIN;
+        if (::poll(&pfd, 1, HOST_EMAC_RX_POLL_MS) <= 0) {
+            continue;
+        }
+
+        ssize_t len = read(_fd, frame, sizeof(frame));
+        if (len <= 0) {
+            if (len == 0 || (errno != EINTR && errno != EAGAIN)) {
+                // Far end closed
+                break;
+            }
+            continue;
+        }
+
+        emac_mem_buf_t *buf = _memory_manager->alloc_heap(len, 0);
+        if (buf == NULL) {
+            core_util_critical_section_enter();
+            _stats.rx_drops++;
+            core_util_critical_section_exit();
+            continue;
+        }
+        _memory_manager->copy_to_buf(buf, frame, len);
+
+        core_util_critical_section_enter();
+        _stats.rx_frames++;
+        _stats.rx_bytes += len;
+        core_util_critical_section_exit();
+
+        _link_input_cb(buf);
+    }
+}
@@ -0,0 +1,115 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_EMAC_H
+#define HOST_EMAC_H
+
+#include "EMAC.h"
+#include "rtos/Thread.h"
+
+/** EMAC for the POSIX backend
+ *
+ * Carries Ethernet frames over a host file descriptor that delivers one
+ * frame per read() and write(): either one end of a link made by
+ * create_link(), or a Linux tap device opened with open_tap(). Received
+ * frames are passed to the stack from a dedicated rtos::Thread.
+ */
+class HostEMAC : public EMAC {
+public:
+    /** Frame counters, updated by the transmit path and the receive thread */
+    struct stats_t {
+        uint32_t tx_frames;
+        uint32_t tx_bytes;
+        uint32_t tx_errors;
+        uint32_t rx_frames;
+        uint32_t rx_bytes;
+        uint32_t rx_drops;
+    };
+
+    /** Create an EMAC on a frame descriptor
+     *
+     * @param fd      Descriptor carrying one frame per message; owned by the EMAC
+     * @param hwaddr  6-byte MAC address reported to the stack
+     */
+    HostEMAC(int fd, const uint8_t *hwaddr);
+
+    virtual ~HostEMAC();
+
+    /** Create both ends of a point-to-point link
+     *
+     * The ends may be used in one process or split across a fork(), each
+     * handed to its own HostEMAC.
+     *
+     * @param fds  Receives the two descriptors
+     * @return     0 on success, negative errno on failure
+     */
+    static int create_link(int fds[2]);
+
+    /** Attach to a Linux tap device, creating it if needed
+     *
+     * Requires CAP_NET_ADMIN or a device already owned by the caller.
+     *
+     * @param ifname  Name of the tap interface, e.g. "tap0"
+     * @return        Descriptor on success, negative errno on failure
+     */
+    static int open_tap(const char *ifname);
+
+    /** Limit transmission to the rate of a physical link
+     *
+     * Unpaced, frames arrive as fast as the host can copy them and the
+     * receive thread can outrun the stack's input mailbox, which turns
+     * throughput figures into a measure of host scheduling.
+     *
+     * @param bits_per_second  Link rate, or 0 to send unpaced (the default)
+     */
+    void set_link_rate(uint32_t bits_per_second);
+
+    /** Snapshot of the frame counters */
+    stats_t get_stats() const;
+
+    virtual uint32_t get_mtu_size() const;
+    virtual uint32_t get_align_preference() const;
+    virtual void get_ifname(char *name, uint8_t size) const;
+    virtual uint8_t get_hwaddr_size() const;
+    virtual bool get_hwaddr(uint8_t *addr) const;
+    virtual void set_hwaddr(const uint8_t *addr);
+    virtual bool link_out(emac_mem_buf_t *buf);
+    virtual bool power_up();
+    virtual void power_down();
+    virtual void set_link_input_cb(emac_link_input_cb_t input_cb);
+    virtual void set_link_state_cb(emac_link_state_change_cb_t state_cb);
+    virtual void add_multicast_group(const uint8_t *address);
+    virtual void remove_multicast_group(const uint8_t *address);
+    virtual void set_all_multicast(bool all);
+    virtual void set_memory_manager(EMACMemoryManager &mem_mngr);
+
+private:
+    void rx_task();
+    void pace(uint32_t len);
+
+    int _fd;
+    uint8_t _hwaddr[6];
+    volatile bool _powered;
+    EMACMemoryManager *_memory_manager;
+    emac_link_input_cb_t _link_input_cb;
+    emac_link_state_change_cb_t _link_state_cb;
+    rtos::Thread *_rx_thread;
+    uint32_t _link_rate;
+    uint64_t _tx_free_ns;
+    stats_t _stats;
+};
+
+#endif /* HOST_EMAC_H */
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_CMSIS_H
+#define MBED_CMSIS_H
+
+#include <stdint.h>
+
+/* Core register stand-ins for platform code built on the POSIX backend.
+ * Host threads never run in handler mode, interrupts are never masked and
+ * there are no exclusive monitors, so atomics fall back to critical sections.
+ */
+#define MBED_EXCLUSIVE_ACCESS 0U
+
+static inline uint32_t __get_PRIMASK(void)
+{
+    return 0;
+}
+
+static inline uint32_t __get_IPSR(void)
+{
+    return 0;
+}
+
+#endif /* MBED_CMSIS_H */
@@ -0,0 +1,1603 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * CMSIS-RTOS2 on POSIX threads.
+ *
+ * Host backend for the mbed RTOS API. It lets the real rtos:: classes, the
+ * LWIP sys_arch port and anything else written against cmsis_os2.h run on
+ * Linux with real concurrency, so they can be exercised under perf, valgrind
+ * and the sanitizers.
+ *
+ * Every kernel object is a heap allocated control block guarded by its own
+ * mutex and CLOCK_MONOTONIC condition variable; timers share one, and their
+ * callbacks run on a timer thread as they do on RTX. Memory passed in through
+ * the attributes for control blocks, stacks, queues and pools is accepted and
+ * ignored: threads run on default pthread stacks. Priorities are recorded but
+ * not enforced, and osKernelLock() only serialises against other kernel lock
+ * holders.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <cstddef>
+#include <new>
+
+#include "cmsis_os2.h"
+#include "mbed_rtx_conf.h"
+#include "hal/critical_section_api.h"
+#include "rtos/rtos_idle.h"
+#include "rtos/rtos_handlers.h"
+
+namespace {
+
+uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t kernel_epoch_ns()
+{
+    static const uint64_t epoch = monotonic_ns();
+    return epoch;
+}
+
+uint64_t kernel_elapsed_ns()
+{
+    uint64_t epoch = kernel_epoch_ns();
+    return monotonic_ns() - epoch;
+}
+
+struct timespec to_timespec(uint64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    return ts;
+}
+
+class ScopedLock {
+public:
+    explicit ScopedLock(pthread_mutex_t &mutex) : _mutex(mutex)
+    {
+        pthread_mutex_lock(&_mutex);
+    }
+
+    ~ScopedLock()
+    {
+        pthread_mutex_unlock(&_mutex);
+    }
+
+private:
+    pthread_mutex_t &_mutex;
+};
+
+struct Thread;
+Thread *current_thread();
+void set_state(Thread *thread, osThreadState_t state);
+
+/* Marks the calling thread blocked for the lifetime of a wait */
+class BlockedScope {
+public:
+    BlockedScope() : _thread(current_thread())
+    {
+        set_state(_thread, osThreadBlocked);
+    }
+
+    ~BlockedScope()
+    {
+        set_state(_thread, osThreadRunning);
+    }
+
+private:
+    Thread *_thread;
+};
+
+/* Lock and condition shared by every kind of control block */
+struct Waitable {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    Waitable()
+    {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&cond, &attr);
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_init(&lock, NULL);
+    }
+
+    ~Waitable()
+    {
+        pthread_cond_destroy(&cond);
+        pthread_mutex_destroy(&lock);
+    }
+
+    /* Called with lock held: waits up to timeout ms for ready() to hold */
+    template <typename Ready>
+    bool wait(uint32_t timeout, Ready ready)
+    {
+        if (ready()) {
+            return true;
+        }
+        if (timeout == 0) {
+            return false;
+        }
+
+        BlockedScope blocked;
+        if (timeout == osWaitForever) {
+            while (!ready()) {
+                pthread_cond_wait(&cond, &lock);
+            }
+            return true;
+        }
+
+        struct timespec deadline = to_timespec(monotonic_ns() + timeout * 1000000ULL);
+        while (!ready()) {
+            if (pthread_cond_timedwait(&cond, &lock, &deadline) == ETIMEDOUT) {
+                return ready();
+            }
+        }
+        return true;
+    }
+};
+
+struct Mutex;
+
+struct Thread : Waitable {
+    pthread_t handle;
+    osThreadFunc_t func;
+    void *argument;
+    const char *name;
+    uint32_t stack_size;
+    osPriority_t priority;
+    bool joinable;
+    bool adopted;
+    int state;
+    uint32_t flags;
+    Mutex *owned;
+    Thread *next;
+};
+
+struct Mutex : Waitable {
+    const char *name;
+    uint32_t attr_bits;
+    Thread *owner;
+    uint32_t count;
+    Mutex *next_owned;
+};
+
+struct Semaphore : Waitable {
+    const char *name;
+    uint32_t max_count;
+    uint32_t count;
+};
+
+struct EventFlags : Waitable {
+    const char *name;
+    uint32_t flags;
+};
+
+struct MemoryPool : Waitable {
+    const char *name;
+    uint32_t block_count;
+    uint32_t block_size;
+    uint32_t used;
+    uint8_t *storage;
+    void *free_list;
+};
+
+struct MessageQueue : Waitable {
+    const char *name;
+    uint32_t msg_count;
+    uint32_t msg_size;
+    uint32_t head;
+    uint32_t used;
+    uint8_t *storage;
+    uint8_t *priorities;
+
+    uint8_t *slot(uint32_t index)
+    {
+        return storage + ((head + index) % msg_count) * msg_size;
+    }
+};
+
+struct Timer {
+    const char *name;
+    osTimerFunc_t func;
+    void *argument;
+    osTimerType_t type;
+    uint32_t period;
+    uint64_t deadline;
+    bool running;
+    bool deleted;
+    Timer *next;
+};
+
+/* Active timers, earliest deadline first, and the thread that fires them */
+struct TimerService : Waitable {
+    Timer *active;
+    Timer *executing;
+    osThreadId_t thread;
+};
+
+pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+Thread *registry;
+uint32_t registry_count;
+
+pthread_key_t current_key;
+pthread_once_t current_once = PTHREAD_ONCE_INIT;
+
+/* Process wide lock that knows its owner. Only the owner sets or clears the
+ * owner, so a thread finds out whether it holds the lock without a race and
+ * without thread local storage. */
+struct OwnedLock {
+    pthread_mutex_t mutex;
+    pthread_t owner;
+    bool owned;
+};
+
+bool is_owner(OwnedLock &lock)
+{
+    return __atomic_load_n(&lock.owned, __ATOMIC_ACQUIRE) && pthread_equal(lock.owner, pthread_self());
+}
+
+void owned_lock(OwnedLock &lock)
+{
+    pthread_mutex_lock(&lock.mutex);
+    lock.owner = pthread_self();
+    __atomic_store_n(&lock.owned, true, __ATOMIC_RELEASE);
+}
+
+void owned_unlock(OwnedLock &lock)
+{
+    __atomic_store_n(&lock.owned, false, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&lock.mutex);
+}
+
+OwnedLock kernel_lock = { PTHREAD_MUTEX_INITIALIZER, pthread_t(), false };
+OwnedLock critical_lock = { PTHREAD_MUTEX_INITIALIZER, pthread_t(), false };
+
+void (*terminate_hook)(osThreadId_t id);
+
+void set_state(Thread *thread, osThreadState_t state)
+{
+    __atomic_store_n(&thread->state, (int)state, __ATOMIC_RELAXED);
+}
+
+osThreadState_t get_state(Thread *thread)
+{
+    return (osThreadState_t)__atomic_load_n(&thread->state, __ATOMIC_RELAXED);
+}
+
+Thread *thread_alloc(const char *name, uint32_t stack_size, osPriority_t priority, bool joinable)
+{
+    Thread *thread = new (std::nothrow) Thread;
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->func = NULL;
+    thread->argument = NULL;
+    thread->name = name;
+    thread->stack_size = stack_size;
+    thread->priority = priority;
+    thread->joinable = joinable;
+    thread->adopted = false;
+    thread->state = osThreadReady;
+    thread->flags = 0;
+    thread->owned = NULL;
+    thread->next = NULL;
+    return thread;
+}
+
+void thread_register(Thread *thread)
+{
+    ScopedLock guard(registry_lock);
+    thread->next = registry;
+    registry = thread;
+    registry_count++;
+}
+
+void thread_unregister(Thread *thread)
+{
+    ScopedLock guard(registry_lock);
+    for (Thread **link = &registry; *link != NULL; link = &(*link)->next) {
+        if (*link == thread) {
+            *link = thread->next;
+            registry_count--;
+            break;
+        }
+    }
+}
+
+/* Runs on the exiting thread, whether it returned, exited or was cancelled */
+void thread_finish(Thread *thread)
+{
+    if (terminate_hook) {
+        terminate_hook(thread);
+    }
+
+    // Like RTX, hand robust mutexes still held by the thread to the next waiter
+    for (Mutex *mutex = thread->owned; mutex != NULL;) {
+        Mutex *next = mutex->next_owned;
+        if (mutex->attr_bits & osMutexRobust) {
+            ScopedLock guard(mutex->lock);
+            mutex->owner = NULL;
+            mutex->count = 0;
+            mutex->next_owned = NULL;
+            pthread_cond_signal(&mutex->cond);
+        }
+        mutex = next;
+    }
+    thread->owned = NULL;
+
+    thread_unregister(thread);
+
+    bool release;
+    {
+        ScopedLock guard(thread->lock);
+        set_state(thread, osThreadTerminated);
+        release = !thread->joinable;
+    }
+    if (release) {
+        delete thread;
+    }
+}
+
+void adopted_thread_exit(void *arg)
+{
+    thread_finish(static_cast<Thread *>(arg));
+}
+
+void current_key_create()
+{
+    pthread_key_create(&current_key, adopted_thread_exit);
+}
+
+/* Threads not created by osThreadNew get a control block on first use */
+Thread *current_thread()
+{
+    pthread_once(&current_once, current_key_create);
+    Thread *thread = static_cast<Thread *>(pthread_getspecific(current_key));
+    if (thread == NULL) {
+        thread = thread_alloc(NULL, 0, osPriorityNormal, false);
+        thread->handle = pthread_self();
+        thread->adopted = true;
+        thread->state = osThreadRunning;
+        thread_register(thread);
+        pthread_setspecific(current_key, thread);
+    }
+    return thread;
+}
+
+class ThreadExit {
+public:
+    explicit ThreadExit(Thread *thread) : _thread(thread) {}
+
+    ~ThreadExit()
+    {
+        pthread_setspecific(current_key, NULL);
+        thread_finish(_thread);
+    }
+
+private:
+    Thread *_thread;
+};
+
+void *thread_entry(void *arg)
+{
+    Thread *thread = static_cast<Thread *>(arg);
+    pthread_setspecific(current_key, thread);
+    set_state(thread, osThreadRunning);
+
+    ThreadExit exit(thread);
+    thread->func(thread->argument);
+    return NULL;
+}
+
+uint32_t flags_set(Waitable &object, uint32_t &value, uint32_t flags)
+{
+    if (flags & osFlagsError) {
+        return osFlagsErrorParameter;
+    }
+    ScopedLock guard(object.lock);
+    value |= flags;
+    pthread_cond_broadcast(&object.cond);
+    return value;
+}
+
+uint32_t flags_clear(Waitable &object, uint32_t &value, uint32_t flags)
+{
+    if (flags & osFlagsError) {
+        return osFlagsErrorParameter;
+    }
+    ScopedLock guard(object.lock);
+    uint32_t previous = value;
+    value &= ~flags;
+    return previous;
+}
+
+/* Wait conditions, as C++98 has no lambdas */
+struct FlagsSet {
+    uint32_t *value;
+    uint32_t flags;
+    uint32_t options;
+    uint32_t *matched;
+
+    bool operator()() const
+    {
+        uint32_t hit = *value & flags;
+        *matched = *value;
+        return (options & osFlagsWaitAll) ? hit == flags : hit != 0;
+    }
+};
+
+struct MutexFree {
+    Mutex *mutex;
+
+    bool operator()() const
+    {
+        return mutex->owner == NULL;
+    }
+};
+
+struct SemaphoreToken {
+    Semaphore *semaphore;
+
+    bool operator()() const
+    {
+        return semaphore->count != 0;
+    }
+};
+
+struct PoolBlock {
+    MemoryPool *pool;
+
+    bool operator()() const
+    {
+        return pool->free_list != NULL;
+    }
+};
+
+struct QueueSpace {
+    MessageQueue *queue;
+
+    bool operator()() const
+    {
+        return queue->used < queue->msg_count;
+    }
+};
+
+struct QueueMessage {
+    MessageQueue *queue;
+
+    bool operator()() const
+    {
+        return queue->used != 0;
+    }
+};
+
+uint32_t flags_wait(Waitable &object, uint32_t &value, uint32_t flags, uint32_t options, uint32_t timeout)
+{
+    if (flags & osFlagsError) {
+        return osFlagsErrorParameter;
+    }
+    ScopedLock guard(object.lock);
+    uint32_t matched = 0;
+    FlagsSet set = { &value, flags, options, &matched };
+    bool ready = object.wait(timeout, set);
+    if (!ready) {
+        return timeout ? osFlagsErrorTimeout : osFlagsErrorResource;
+    }
+    if (!(options & osFlagsNoClear)) {
+        value &= ~flags;
+    }
+    return matched;
+}
+
+TimerService &timer_service()
+{
+    // Never destroyed: the timer thread is still waiting on it at exit
+    static TimerService *service = new TimerService();
+    return *service;
+}
+
+/* Called with the service lock held */
+void timer_insert(TimerService &service, Timer *timer)
+{
+    Timer **link = &service.active;
+    while (*link != NULL && (*link)->deadline <= timer->deadline) {
+        link = &(*link)->next;
+    }
+    timer->next = *link;
+    *link = timer;
+}
+
+/* Called with the service lock held */
+void timer_remove(TimerService &service, Timer *timer)
+{
+    for (Timer **link = &service.active; *link != NULL; link = &(*link)->next) {
+        if (*link == timer) {
+            *link = timer->next;
+            break;
+        }
+    }
+    timer->next = NULL;
+}
+
+void timer_thread(void *arg)
+{
+    TimerService &service = *static_cast<TimerService *>(arg);
+    ScopedLock guard(service.lock);
+    for (;;) {
+        Timer *timer = service.active;
+        if (timer == NULL) {
+            pthread_cond_wait(&service.cond, &service.lock);
+            continue;
+        }
+        if (timer->deadline > kernel_elapsed_ns()) {
+            struct timespec deadline = to_timespec(kernel_epoch_ns() + timer->deadline);
+            pthread_cond_timedwait(&service.cond, &service.lock, &deadline);
+            continue;
+        }
+
+        service.active = timer->next;
+        if (timer->type == osTimerPeriodic) {
+            // Rearm from the missed deadline so the period does not drift
+            timer->deadline += timer->period * 1000000ULL;
+            timer_insert(service, timer);
+        } else {
+            timer->running = false;
+        }
+
+        // The callback may start, stop or delete timers, this one included
+        service.executing = timer;
+        osTimerFunc_t func = timer->func;
+        void *argument = timer->argument;
+        pthread_mutex_unlock(&service.lock);
+        func(argument);
+        pthread_mutex_lock(&service.lock);
+        service.executing = NULL;
+        if (timer->deleted) {
+            delete timer;
+        }
+        pthread_cond_broadcast(&service.cond);
+    }
+}
+
+osStatus_t sleep_until_ns(uint64_t wakeup)
+{
+    BlockedScope blocked;
+    struct timespec ts = to_timespec(wakeup);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+    return osOK;
+}
+
+} // namespace
+
+/* Kernel */
+
+osStatus_t osKernelInitialize(void)
+{
+    kernel_epoch_ns();
+    return osOK;
+}
+
+osStatus_t osKernelGetInfo(osVersion_t *version, char *id_buf, uint32_t id_size)
+{
+    if (version != NULL) {
+        version->api = 20010003U;
+        version->kernel = 20010003U;
+    }
+    if (id_buf != NULL && id_size != 0) {
+        strncpy(id_buf, "POSIX", id_size);
+        id_buf[id_size - 1] = '\0';
+    }
+    return osOK;
+}
+
+osKernelState_t osKernelGetState(void)
+{
+    return is_owner(kernel_lock) ? osKernelLocked : osKernelRunning;
+}
+
+osStatus_t osKernelStart(void)
+{
+    return osOK;
+}
+
+int32_t osKernelLock(void)
+{
+    if (is_owner(kernel_lock)) {
+        return 1;
+    }
+    owned_lock(kernel_lock);
+    return 0;
+}
+
+int32_t osKernelUnlock(void)
+{
+    if (!is_owner(kernel_lock)) {
+        return 0;
+    }
+    owned_unlock(kernel_lock);
+    return 1;
+}
+
+int32_t osKernelRestoreLock(int32_t lock)
+{
+    if (lock) {
+        osKernelLock();
+    } else {
+        osKernelUnlock();
+    }
+    return lock;
+}
+
+uint32_t osKernelSuspend(void)
+{
+    return 0;
+}
+
+void osKernelResume(uint32_t sleep_ticks)
+{
+    (void)sleep_ticks;
+}
+
+uint32_t osKernelGetTickCount(void)
+{
+    return (uint32_t)(kernel_elapsed_ns() / 1000000ULL);
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+    return 1000;
+}
+
+uint32_t osKernelGetSysTimerCount(void)
+{
+    return (uint32_t)(kernel_elapsed_ns() / 1000ULL);
+}
+
+uint32_t osKernelGetSysTimerFreq(void)
+{
+    return 1000000;
+}
+
+/* Threads */
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr)
+{
+    if (func == NULL) {
+        return NULL;
+    }
+    pthread_once(&current_once, current_key_create);
+
+    const char *name = NULL;
+    uint32_t stack_size = OS_STACK_SIZE;
+    osPriority_t priority = osPriorityNormal;
+    bool joinable = false;
+    if (attr != NULL) {
+        name = attr->name;
+        if (attr->stack_size != 0) {
+            stack_size = attr->stack_size;
+        }
+        if (attr->priority != osPriorityNone) {
+            priority = attr->priority;
+        }
+        joinable = (attr->attr_bits & osThreadJoinable) != 0;
+    }
+    if (priority < osPriorityIdle || priority > osPriorityISR) {
+        return NULL;
+    }
+
+    Thread *thread = thread_alloc(name, stack_size, priority, joinable);
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->func = func;
+    thread->argument = argument;
+    thread_register(thread);
+
+    pthread_attr_t thread_attr;
+    pthread_attr_init(&thread_attr);
+    pthread_attr_setdetachstate(&thread_attr, joinable ? PTHREAD_CREATE_JOINABLE : PTHREAD_CREATE_DETACHED);
+    int err = pthread_create(&thread->handle, &thread_attr, thread_entry, thread);
+    pthread_attr_destroy(&thread_attr);
+    if (err != 0) {
+        thread_unregister(thread);
+        delete thread;
+        return NULL;
+    }
+    return thread;
+}
+
+const char *osThreadGetName(osThreadId_t thread_id)
+{
+    if (thread_id == NULL) {
+        return NULL;
+    }
+    return static_cast<Thread *>(thread_id)->name;
+}
+
+osThreadId_t osThreadGetId(void)
+{
+    return current_thread();
+}
+
+osThreadState_t osThreadGetState(osThreadId_t thread_id)
+{
+    if (thread_id == NULL) {
+        return osThreadError;
+    }
+    return get_state(static_cast<Thread *>(thread_id));
+}
+
+uint32_t osThreadGetStackSize(osThreadId_t thread_id)
+{
+    if (thread_id == NULL) {
+        return 0;
+    }
+    return static_cast<Thread *>(thread_id)->stack_size;
+}
+
+uint32_t osThreadGetStackSpace(osThreadId_t thread_id)
+{
+    // Host stacks are not the ones requested, so report the request as unused
+    return osThreadGetStackSize(thread_id);
+}
+
+osStatus_t osThreadSetPriority(osThreadId_t thread_id, osPriority_t priority)
+{
+    if (thread_id == NULL || priority < osPriorityIdle || priority > osPriorityISR) {
+        return osErrorParameter;
+    }
+    Thread *thread = static_cast<Thread *>(thread_id);
+    ScopedLock guard(thread->lock);
+    thread->priority = priority;
+    return osOK;
+}
+
+osPriority_t osThreadGetPriority(osThreadId_t thread_id)
+{
+    if (thread_id == NULL) {
+        return osPriorityError;
+    }
+    Thread *thread = static_cast<Thread *>(thread_id);
+    ScopedLock guard(thread->lock);
+    return thread->priority;
+}
+
+osStatus_t osThreadYield(void)
+{
+    sched_yield();
+    return osOK;
+}
+
+osStatus_t osThreadSuspend(osThreadId_t thread_id)
+{
+    (void)thread_id;
+    return osError;
+}
+
+osStatus_t osThreadResume(osThreadId_t thread_id)
+{
+    (void)thread_id;
+    return osError;
+}
+
+osStatus_t osThreadDetach(osThreadId_t thread_id)
+{
+    if (thread_id == NULL) {
+        return osErrorParameter;
+    }
+    Thread *thread = static_cast<Thread *>(thread_id);
+    bool finished;
+    {
+        ScopedLock guard(thread->lock);
+        if (!thread->joinable) {
+            return osErrorResource;
+        }
+        thread->joinable = false;
+        finished = get_state(thread) == osThreadTerminated;
+    }
+    pthread_detach(thread->handle);
+    if (finished) {
+        delete thread;
+    }
+    return osOK;
+}
+
+osStatus_t osThreadJoin(osThreadId_t thread_id)
+{
+    if (thread_id == NULL) {
+        return osErrorParameter;
+    }
+    Thread *thread = static_cast<Thread *>(thread_id);
+    if (thread == current_thread() || !thread->joinable) {
+        return osErrorResource;
+    }
+    {
+        BlockedScope blocked;
+        pthread_join(thread->handle, NULL);
+    }
+    delete thread;
+    return osOK;
+}
+
+void osThreadExit(void)
+{
+    pthread_exit(NULL);
+}
+
+osStatus_t osThreadTerminate(osThreadId_t thread_id)
+{
+    if (thread_id == NULL) {
+        return osErrorParameter;
+    }
+    Thread *thread = static_cast<Thread *>(thread_id);
+    if (thread == current_thread()) {
+        pthread_exit(NULL);
+    }
+    if (get_state(thread) == osThreadTerminated) {
+        return osErrorResource;
+    }
+    // Takes effect at the target's next blocking call, which unwinds it
+    // through thread_entry so it is cleaned up like a normal exit
+    return pthread_cancel(thread->handle) == 0 ? osOK : osErrorResource;
+}
+
+uint32_t osThreadGetCount(void)
+{
+    ScopedLock guard(registry_lock);
+    return registry_count;
+}
+
+uint32_t osThreadEnumerate(osThreadId_t *thread_array, uint32_t array_items)
+{
+    if (thread_array == NULL) {
+        return 0;
+    }
+    ScopedLock guard(registry_lock);
+    uint32_t count = 0;
+    for (Thread *thread = registry; thread != NULL && count < array_items; thread = thread->next) {
+        thread_array[count++] = thread;
+    }
+    return count;
+}
+
+/* Thread flags */
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags)
+{
+    if (thread_id == NULL) {
+        return osFlagsErrorParameter;
+    }
+    Thread *thread = static_cast<Thread *>(thread_id);
+    return flags_set(*thread, thread->flags, flags);
+}
+
+uint32_t osThreadFlagsClear(uint32_t flags)
+{
+    Thread *thread = current_thread();
+    return flags_clear(*thread, thread->flags, flags);
+}
+
+uint32_t osThreadFlagsGet(void)
+{
+    Thread *thread = current_thread();
+    ScopedLock guard(thread->lock);
+    return thread->flags;
+}
+
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout)
+{
+    Thread *thread = current_thread();
+    return flags_wait(*thread, thread->flags, flags, options, timeout);
+}
+
+/* Generic wait */
+
+osStatus_t osDelay(uint32_t ticks)
+{
+    if (ticks == 0) {
+        return osOK;
+    }
+    return sleep_until_ns(monotonic_ns() + ticks * 1000000ULL);
+}
+
+osStatus_t osDelayUntil(uint32_t ticks)
+{
+    uint64_t now = kernel_elapsed_ns() / 1000000ULL;
+    uint32_t delay = ticks - (uint32_t)now;
+    if (delay == 0 || delay > 0x7FFFFFFFU) {
+        return osErrorParameter;
+    }
+    return sleep_until_ns(kernel_epoch_ns() + (now + delay) * 1000000ULL);
+}
+
+/* Event flags */
+
+osEventFlagsId_t osEventFlagsNew(const osEventFlagsAttr_t *attr)
+{
+    EventFlags *ef = new (std::nothrow) EventFlags;
+    if (ef == NULL) {
+        return NULL;
+    }
+    ef->name = attr ? attr->name : NULL;
+    ef->flags = 0;
+    return ef;
+}
+
+const char *osEventFlagsGetName(osEventFlagsId_t ef_id)
+{
+    return ef_id ? static_cast<EventFlags *>(ef_id)->name : NULL;
+}
+
+uint32_t osEventFlagsSet(osEventFlagsId_t ef_id, uint32_t flags)
+{
+    if (ef_id == NULL) {
+        return osFlagsErrorParameter;
+    }
+    EventFlags *ef = static_cast<EventFlags *>(ef_id);
+    return flags_set(*ef, ef->flags, flags);
+}
+
+uint32_t osEventFlagsClear(osEventFlagsId_t ef_id, uint32_t flags)
+{
+    if (ef_id == NULL) {
+        return osFlagsErrorParameter;
+    }
+    EventFlags *ef = static_cast<EventFlags *>(ef_id);
+    return flags_clear(*ef, ef->flags, flags);
+}
+
+uint32_t osEventFlagsGet(osEventFlagsId_t ef_id)
+{
+    if (ef_id == NULL) {
+        return 0;
+    }
+    EventFlags *ef = static_cast<EventFlags *>(ef_id);
+    ScopedLock guard(ef->lock);
+    return ef->flags;
+}
+
+uint32_t osEventFlagsWait(osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout)
+{
+    if (ef_id == NULL) {
+        return osFlagsErrorParameter;
+    }
+    EventFlags *ef = static_cast<EventFlags *>(ef_id);
+    return flags_wait(*ef, ef->flags, flags, options, timeout);
+}
+
+osStatus_t osEventFlagsDelete(osEventFlagsId_t ef_id)
+{
+    if (ef_id == NULL) {
+        return osErrorParameter;
+    }
+    delete static_cast<EventFlags *>(ef_id);
+    return osOK;
+}
+
+/* Mutexes */
+
+osMutexId_t osMutexNew(const osMutexAttr_t *attr)
+{
+    Mutex *mutex = new (std::nothrow) Mutex;
+    if (mutex == NULL) {
+        return NULL;
+    }
+    mutex->name = attr ? attr->name : NULL;
+    mutex->attr_bits = attr ? attr->attr_bits : 0;
+    mutex->owner = NULL;
+    mutex->count = 0;
+    mutex->next_owned = NULL;
+    return mutex;
+}
+
+const char *osMutexGetName(osMutexId_t mutex_id)
+{
+    return mutex_id ? static_cast<Mutex *>(mutex_id)->name : NULL;
+}
+
+osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout)
+{
+    if (mutex_id == NULL) {
+        return osErrorParameter;
+    }
+    Mutex *mutex = static_cast<Mutex *>(mutex_id);
+    Thread *self = current_thread();
+
+    ScopedLock guard(mutex->lock);
+    if (mutex->owner == self) {
+        if (!(mutex->attr_bits & osMutexRecursive) || mutex->count == UINT32_MAX) {
+            return osErrorResource;
+        }
+        mutex->count++;
+        return osOK;
+    }
+    MutexFree unowned = { mutex };
+    bool acquired = mutex->wait(timeout, unowned);
+    if (!acquired) {
+        return timeout ? osErrorTimeout : osErrorResource;
+    }
+    mutex->owner = self;
+    mutex->count = 1;
+    mutex->next_owned = self->owned;
+    self->owned = mutex;
+    return osOK;
+}
+
+osStatus_t osMutexRelease(osMutexId_t mutex_id)
+{
+    if (mutex_id == NULL) {
+        return osErrorParameter;
+    }
+    Mutex *mutex = static_cast<Mutex *>(mutex_id);
+    Thread *self = current_thread();
+
+    ScopedLock guard(mutex->lock);
+    if (mutex->owner != self) {
+        return osErrorResource;
+    }
+    if (--mutex->count != 0) {
+        return osOK;
+    }
+    for (Mutex **link = &self->owned; *link != NULL; link = &(*link)->next_owned) {
+        if (*link == mutex) {
+            *link = mutex->next_owned;
+            break;
+        }
+    }
+    mutex->owner = NULL;
+    mutex->next_owned = NULL;
+    pthread_cond_signal(&mutex->cond);
+    return osOK;
+}
+
+osThreadId_t osMutexGetOwner(osMutexId_t mutex_id)
+{
+    if (mutex_id == NULL) {
+        return NULL;
+    }
+    Mutex *mutex = static_cast<Mutex *>(mutex_id);
+    ScopedLock guard(mutex->lock);
+    return mutex->owner;
+}
+
+osStatus_t osMutexDelete(osMutexId_t mutex_id)
+{
+    if (mutex_id == NULL) {
+        return osErrorParameter;
+    }
+    Mutex *mutex = static_cast<Mutex *>(mutex_id);
+    Thread *self = current_thread();
+    if (mutex->owner == self) {
+        for (Mutex **link = &self->owned; *link != NULL; link = &(*link)->next_owned) {
+            if (*link == mutex) {
+                *link = mutex->next_owned;
+                break;
+            }
+        }
+    }
+    delete mutex;
+    return osOK;
+}
+
+/* Semaphores */
+
+osSemaphoreId_t osSemaphoreNew(uint32_t max_count, uint32_t initial_count, const osSemaphoreAttr_t *attr)
+{
+    if (max_count == 0 || initial_count > max_count) {
+        return NULL;
+    }
+    Semaphore *semaphore = new (std::nothrow) Semaphore;
+    if (semaphore == NULL) {
+        return NULL;
+    }
+    semaphore->name = attr ? attr->name : NULL;
+    semaphore->max_count = max_count;
+    semaphore->count = initial_count;
+    return semaphore;
+}
+
+const char *osSemaphoreGetName(osSemaphoreId_t semaphore_id)
+{
+    return semaphore_id ? static_cast<Semaphore *>(semaphore_id)->name : NULL;
+}
+
+osStatus_t osSemaphoreAcquire(osSemaphoreId_t semaphore_id, uint32_t timeout)
+{
+    if (semaphore_id == NULL) {
+        return osErrorParameter;
+    }
+    Semaphore *semaphore = static_cast<Semaphore *>(semaphore_id);
+    ScopedLock guard(semaphore->lock);
+    SemaphoreToken token = { semaphore };
+    bool acquired = semaphore->wait(timeout, token);
+    if (!acquired) {
+        return timeout ? osErrorTimeout : osErrorResource;
+    }
+    semaphore->count--;
+    return osOK;
+}
+
+osStatus_t osSemaphoreRelease(osSemaphoreId_t semaphore_id)
+{
+    if (semaphore_id == NULL) {
+        return osErrorParameter;
+    }
+    Semaphore *semaphore = static_cast<Semaphore *>(semaphore_id);
+    ScopedLock guard(semaphore->lock);
+    if (semaphore->count == semaphore->max_count) {
+        return osErrorResource;
+    }
+    semaphore->count++;
+    pthread_cond_signal(&semaphore->cond);
+    return osOK;
+}
+
+uint32_t osSemaphoreGetCount(osSemaphoreId_t semaphore_id)
+{
+    if (semaphore_id == NULL) {
+        return 0;
+    }
+    Semaphore *semaphore = static_cast<Semaphore *>(semaphore_id);
+    ScopedLock guard(semaphore->lock);
+    return semaphore->count;
+}
+
+osStatus_t osSemaphoreDelete(osSemaphoreId_t semaphore_id)
+{
+    if (semaphore_id == NULL) {
+        return osErrorParameter;
+    }
+    delete static_cast<Semaphore *>(semaphore_id);
+    return osOK;
+}
+
+/* Memory pools */
+
+namespace {
+
+/* The strictest fundamental alignment, as C++98 has no max_align_t */
+struct AlignProbe {
+    char offset;
+    union {
+        long double ld;
+        long long ll;
+        double d;
+        void *p;
+    } any;
+};
+
+} // namespace
+
+osMemoryPoolId_t osMemoryPoolNew(uint32_t block_count, uint32_t block_size, const osMemoryPoolAttr_t *attr)
+{
+    if (block_count == 0 || block_size == 0) {
+        return NULL;
+    }
+    // Blocks hold any object type and, while free, the free list link
+    const uint32_t align = offsetof(AlignProbe, any);
+    block_size = (block_size + align - 1) & ~(align - 1);
+
+    MemoryPool *pool = new (std::nothrow) MemoryPool;
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->storage = new (std::nothrow) uint8_t[(size_t)block_count * block_size];
+    if (pool->storage == NULL) {
+        delete pool;
+        return NULL;
+    }
+    pool->name = attr ? attr->name : NULL;
+    pool->block_count = block_count;
+    pool->block_size = block_size;
+    pool->used = 0;
+    pool->free_list = NULL;
+    for (uint32_t i = block_count; i > 0; i--) {
+        void *block = pool->storage + (size_t)(i - 1) * block_size;
+        *static_cast<void **>(block) = pool->free_list;
+        pool->free_list = block;
+    }
+    return pool;
+}
+
+const char *osMemoryPoolGetName(osMemoryPoolId_t mp_id)
+{
+    return mp_id ? static_cast<MemoryPool *>(mp_id)->name : NULL;
+}
+
+void *osMemoryPoolAlloc(osMemoryPoolId_t mp_id, uint32_t timeout)
+{
+    if (mp_id == NULL) {
+        return NULL;
+    }
+    MemoryPool *pool = static_cast<MemoryPool *>(mp_id);
+    ScopedLock guard(pool->lock);
+    PoolBlock block_free = { pool };
+    bool available = pool->wait(timeout, block_free);
+    if (!available) {
+        return NULL;
+    }
+    void *block = pool->free_list;
+    pool->free_list = *static_cast<void **>(block);
+    pool->used++;
+    return block;
+}
+
+osStatus_t osMemoryPoolFree(osMemoryPoolId_t mp_id, void *block)
+{
+    if (mp_id == NULL || block == NULL) {
+        return osErrorParameter;
+    }
+    MemoryPool *pool = static_cast<MemoryPool *>(mp_id);
+    size_t offset = static_cast<uint8_t *>(block) - pool->storage;
+    if (static_cast<uint8_t *>(block) < pool->storage ||
+            offset >= (size_t)pool->block_count * pool->block_size ||
+            offset % pool->block_size != 0) {
+        return osErrorParameter;
+    }
+    ScopedLock guard(pool->lock);
+    if (pool->used == 0) {
+        return osErrorResource;
+    }
+    *static_cast<void **>(block) = pool->free_list;
+    pool->free_list = block;
+    pool->used--;
+    pthread_cond_signal(&pool->cond);
+    return osOK;
+}
+
+uint32_t osMemoryPoolGetCapacity(osMemoryPoolId_t mp_id)
+{
+    return mp_id ? static_cast<MemoryPool *>(mp_id)->block_count : 0;
+}
+
+uint32_t osMemoryPoolGetBlockSize(osMemoryPoolId_t mp_id)
+{
+    return mp_id ? static_cast<MemoryPool *>(mp_id)->block_size : 0;
+}
+
+uint32_t osMemoryPoolGetCount(osMemoryPoolId_t mp_id)
+{
+    if (mp_id == NULL) {
+        return 0;
+    }
+    MemoryPool *pool = static_cast<MemoryPool *>(mp_id);
+    ScopedLock guard(pool->lock);
+    return pool->used;
+}
+
+uint32_t osMemoryPoolGetSpace(osMemoryPoolId_t mp_id)
+{
+    if (mp_id == NULL) {
+        return 0;
+    }
+    MemoryPool *pool = static_cast<MemoryPool *>(mp_id);
+    ScopedLock guard(pool->lock);
+    return pool->block_count - pool->used;
+}
+
+osStatus_t osMemoryPoolDelete(osMemoryPoolId_t mp_id)
+{
+    if (mp_id == NULL) {
+        return osErrorParameter;
+    }
+    MemoryPool *pool = static_cast<MemoryPool *>(mp_id);
+    delete[] pool->storage;
+    delete pool;
+    return osOK;
+}
+
+/* Message queues */
+
+osMessageQueueId_t osMessageQueueNew(uint32_t msg_count, uint32_t msg_size, const osMessageQueueAttr_t *attr)
+{
+    if (msg_count == 0 || msg_size == 0) {
+        return NULL;
+    }
+    MessageQueue *queue = new (std::nothrow) MessageQueue;
+    if (queue == NULL) {
+        return NULL;
+    }
+    queue->storage = new (std::nothrow) uint8_t[(size_t)msg_count * msg_size];
+    queue->priorities = new (std::nothrow) uint8_t[msg_count];
+    if (queue->storage == NULL || queue->priorities == NULL) {
+        delete[] queue->storage;
+        delete[] queue->priorities;
+        delete queue;
+        return NULL;
+    }
+    queue->name = attr ? attr->name : NULL;
+    queue->msg_count = msg_count;
+    queue->msg_size = msg_size;
+    queue->head = 0;
+    queue->used = 0;
+    return queue;
+}
+
+const char *osMessageQueueGetName(osMessageQueueId_t mq_id)
+{
+    return mq_id ? static_cast<MessageQueue *>(mq_id)->name : NULL;
+}
+
+osStatus_t osMessageQueuePut(osMessageQueueId_t mq_id, const void *msg_ptr, uint8_t msg_prio, uint32_t timeout)
+{
+    if (mq_id == NULL || msg_ptr == NULL) {
+        return osErrorParameter;
+    }
+    MessageQueue *queue = static_cast<MessageQueue *>(mq_id);
+    ScopedLock guard(queue->lock);
+    QueueSpace has_space = { queue };
+    bool space = queue->wait(timeout, has_space);
+    if (!space) {
+        return timeout ? osErrorTimeout : osErrorResource;
+    }
+
+    // Like RTX, higher priorities are received first, FIFO within a priority
+    uint32_t index = queue->used;
+    while (index > 0 && queue->priorities[(queue->head + index - 1) % queue->msg_count] < msg_prio) {
+        memcpy(queue->slot(index), queue->slot(index - 1), queue->msg_size);
+        queue->priorities[(queue->head + index) % queue->msg_count] =
+            queue->priorities[(queue->head + index - 1) % queue->msg_count];
+        index--;
+    }
+    memcpy(queue->slot(index), msg_ptr, queue->msg_size);
+    queue->priorities[(queue->head + index) % queue->msg_count] = msg_prio;
+    queue->used++;
+    pthread_cond_broadcast(&queue->cond);
+    return osOK;
+}
+
+osStatus_t osMessageQueueGet(osMessageQueueId_t mq_id, void *msg_ptr, uint8_t *msg_prio, uint32_t timeout)
+{
+    if (mq_id == NULL || msg_ptr == NULL) {
+        return osErrorParameter;
+    }
+    MessageQueue *queue = static_cast<MessageQueue *>(mq_id);
+    ScopedLock guard(queue->lock);
+    QueueMessage has_message = { queue };
+    bool pending = queue->wait(timeout, has_message);
+    if (!pending) {
+        return timeout ? osErrorTimeout : osErrorResource;
+    }
+    memcpy(msg_ptr, queue->slot(0), queue->msg_size);
+    if (msg_prio != NULL) {
+        *msg_prio = queue->priorities[queue->head];
+    }
+    queue->head = (queue->head + 1) % queue->msg_count;
+    queue->used--;
+    pthread_cond_broadcast(&queue->cond);
+    return osOK;
+}
+
+uint32_t osMessageQueueGetCapacity(osMessageQueueId_t mq_id)
+{
+    return mq_id ? static_cast<MessageQueue *>(mq_id)->msg_count : 0;
+}
+
+uint32_t osMessageQueueGetMsgSize(osMessageQueueId_t mq_id)
+{
+    return mq_id ? static_cast<MessageQueue *>(mq_id)->msg_size : 0;
+}
+
+uint32_t osMessageQueueGetCount(osMessageQueueId_t mq_id)
+{
+    if (mq_id == NULL) {
+        return 0;
+    }
+    MessageQueue *queue = static_cast<MessageQueue *>(mq_id);
+    ScopedLock guard(queue->lock);
+    return queue->used;
+}
+
+uint32_t osMessageQueueGetSpace(osMessageQueueId_t mq_id)
+{
+    if (mq_id == NULL) {
+        return 0;
+    }
+    MessageQueue *queue = static_cast<MessageQueue *>(mq_id);
+    ScopedLock guard(queue->lock);
+    return queue->msg_count - queue->used;
+}
+
+osStatus_t osMessageQueueReset(osMessageQueueId_t mq_id)
+{
+    if (mq_id == NULL) {
+        return osErrorParameter;
+    }
+    MessageQueue *queue = static_cast<MessageQueue *>(mq_id);
+    ScopedLock guard(queue->lock);
+    queue->head = 0;
+    queue->used = 0;
+    pthread_cond_broadcast(&queue->cond);
+    return osOK;
+}
+
+osStatus_t osMessageQueueDelete(osMessageQueueId_t mq_id)
+{
+    if (mq_id == NULL) {
+        return osErrorParameter;
+    }
+    MessageQueue *queue = static_cast<MessageQueue *>(mq_id);
+    delete[] queue->storage;
+    delete[] queue->priorities;
+    delete queue;
+    return osOK;
+}
+
+/* Timers */
+
+osTimerId_t osTimerNew(osTimerFunc_t func, osTimerType_t type, void *argument, const osTimerAttr_t *attr)
+{
+    if (func == NULL || (type != osTimerOnce && type != osTimerPeriodic)) {
+        return NULL;
+    }
+    TimerService &service = timer_service();
+    {
+        ScopedLock guard(service.lock);
+        if (service.thread == NULL) {
+            osThreadAttr_t thread_attr = { 0 };
+            thread_attr.name = OS_TIMER_THREAD_NAME;
+            thread_attr.stack_size = OS_TIMER_THREAD_STACK_SIZE;
+            thread_attr.priority = osPriorityHigh;
+            service.thread = osThreadNew(timer_thread, &service, &thread_attr);
+            if (service.thread == NULL) {
+                return NULL;
+            }
+        }
+    }
+
+    Timer *timer = new (std::nothrow) Timer;
+    if (timer == NULL) {
+        return NULL;
+    }
+    timer->name = attr ? attr->name : NULL;
+    timer->func = func;
+    timer->argument = argument;
+    timer->type = type;
+    timer->period = 0;
+    timer->deadline = 0;
+    timer->running = false;
+    timer->deleted = false;
+    timer->next = NULL;
+    return timer;
+}
+
+const char *osTimerGetName(osTimerId_t timer_id)
+{
+    return timer_id ? static_cast<Timer *>(timer_id)->name : NULL;
+}
+
+osStatus_t osTimerStart(osTimerId_t timer_id, uint32_t ticks)
+{
+    if (timer_id == NULL || ticks == 0) {
+        return osErrorParameter;
+    }
+    Timer *timer = static_cast<Timer *>(timer_id);
+    TimerService &service = timer_service();
+    ScopedLock guard(service.lock);
+    if (timer->running) {
+        timer_remove(service, timer);
+    }
+    timer->period = ticks;
+    timer->deadline = kernel_elapsed_ns() + ticks * 1000000ULL;
+    timer->running = true;
+    timer_insert(service, timer);
+    pthread_cond_broadcast(&service.cond);
+    return osOK;
+}
+
+osStatus_t osTimerStop(osTimerId_t timer_id)
+{
+    if (timer_id == NULL) {
+        return osErrorParameter;
+    }
+    Timer *timer = static_cast<Timer *>(timer_id);
+    TimerService &service = timer_service();
+    ScopedLock guard(service.lock);
+    if (!timer->running) {
+        return osErrorResource;
+    }
+    timer_remove(service, timer);
+    timer->running = false;
+    return osOK;
+}
+
+uint32_t osTimerIsRunning(osTimerId_t timer_id)
+{
+    if (timer_id == NULL) {
+        return 0;
+    }
+    TimerService &service = timer_service();
+    ScopedLock guard(service.lock);
+    return static_cast<Timer *>(timer_id)->running;
+}
+
+osStatus_t osTimerDelete(osTimerId_t timer_id)
+{
+    if (timer_id == NULL) {
+        return osErrorParameter;
+    }
+    Timer *timer = static_cast<Timer *>(timer_id);
+    TimerService &service = timer_service();
+    ScopedLock guard(service.lock);
+    if (timer->running) {
+        timer_remove(service, timer);
+        timer->running = false;
+    }
+    if (service.executing == timer) {
+        if (current_thread() == service.thread) {
+            // Deleted from its own callback: the timer thread frees it after
+            timer->deleted = true;
+            return osOK;
+        }
+        while (service.executing == timer) {
+            pthread_cond_wait(&service.cond, &service.lock);
+        }
+    }
+    delete timer;
+    return osOK;
+}
+
+/* mbed RTOS hooks */
+
+void rtos_attach_idle_hook(void (*fptr)(void))
+{
+    // There is no idle thread on the host; the hook is never run
+    (void)fptr;
+}
+
+void rtos_attach_thread_terminate_hook(void (*fptr)(osThreadId_t id))
+{
+    terminate_hook = fptr;
+}
+
+/* Critical sections
+ *
+ * Interrupt masking becomes one process wide lock. mbed_critical.c counts
+ * nesting itself, so only the outermost enter and exit reach this layer.
+ */
+
+void hal_critical_section_enter(void)
+{
+    if (!is_owner(critical_lock)) {
+        owned_lock(critical_lock);
+    }
+}
+
+void hal_critical_section_exit(void)
+{
+    if (is_owner(critical_lock)) {
+        owned_unlock(critical_lock);
+    }
+}
+
+bool hal_in_critical_section(void)
+{
+    return is_owner(critical_lock);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_H
+#define MBED_H
+
+/* The slice of mbed.h the RTOS and network sources rely on when they are
+ * built against the POSIX backend. There are no drivers on the host.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "platform/mbed_toolchain.h"
+#include "platform/mbed_critical.h"
+#include "platform/mbed_assert.h"
+#include "platform/mbed_error.h"
+#include "platform/Callback.h"
+#include "rtos/rtos.h"
+#include "events/mbed_events.h"
+
+using namespace mbed;
+using namespace std;
+
+#endif // MBED_H
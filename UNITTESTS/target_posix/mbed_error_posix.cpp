@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * mbed_error for the POSIX backend. Warnings stay silent as they do on target,
+ * where they only reach the error history; fatal errors are reported on stderr
+ * and abort the process so they show up under the sanitizers and in ctest.
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+#include "platform/mbed_error.h"
+
+static void report(mbed_error_status_t error_status, const char *error_msg,
+                   unsigned int error_value, const char *filename, int line_number)
+{
+    fprintf(stderr, "mbed error 0x%08x: %s (value 0x%x) at %s:%d\n", (unsigned int)error_status,
+            error_msg ? error_msg : "", error_value, filename ? filename : "?", line_number);
+}
+
+mbed_error_status_t mbed_warning(mbed_error_status_t error_status, const char *error_msg,
+                                 unsigned int error_value, const char *filename, int line_number)
+{
+    return MBED_SUCCESS;
+}
+
+mbed_error_status_t mbed_error(mbed_error_status_t error_status, const char *error_msg,
+                               unsigned int error_value, const char *filename, int line_number)
+{
+    report(error_status, error_msg, error_value, filename, line_number);
+    abort();
+}
+
+void error(const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    vfprintf(stderr, format, arg);
+    va_end(arg);
+    abort();
+}
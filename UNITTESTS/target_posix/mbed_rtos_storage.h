@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_RTOS_STORAGE_H
+#define MBED_RTOS_STORAGE_H
+
+/* Backing storage types for the POSIX backend.
+ *
+ * The rtos classes still embed the RTX control blocks; the host port keeps
+ * its own state and never touches them. This header only exists so the
+ * POSIX mbed_rtx_conf.h is picked up instead of the one next to the RTX
+ * version of this file.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rtx_os.h"
+#include "mbed_rtx_conf.h"
+
+typedef osRtxMutex_t mbed_rtos_storage_mutex_t;
+typedef osRtxSemaphore_t mbed_rtos_storage_semaphore_t;
+typedef osRtxThread_t mbed_rtos_storage_thread_t;
+typedef osRtxMemoryPool_t mbed_rtos_storage_mem_pool_t;
+typedef osRtxMessageQueue_t mbed_rtos_storage_msg_queue_t;
+typedef osRtxEventFlags_t mbed_rtos_storage_event_flags_t;
+typedef osRtxMessage_t mbed_rtos_storage_message_t;
+typedef osRtxTimer_t mbed_rtos_storage_timer_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBED_RTOS_STORAGE_H */
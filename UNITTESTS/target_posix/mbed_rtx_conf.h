@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_RTX_CONF_H
+#define MBED_RTX_CONF_H
+
+/* RTOS configuration for the POSIX host backend.
+ *
+ * MBED_OS_BACKEND_RTX5 is deliberately left undefined: the host port keeps
+ * its own control blocks, so common code must not look inside the RTX ones.
+ */
+
+#ifndef OS_STACK_SIZE
+#define OS_STACK_SIZE               4096
+#endif
+
+#define OS_TIMER_THREAD_STACK_SIZE  4096
+#define OS_IDLE_THREAD_STACK_SIZE   512
+#define OS_DYNAMIC_MEM_SIZE         0
+#define OS_TICK_FREQ                1000
+
+#define OS_IDLE_THREAD_NAME         "idle_thread"
+#define OS_TIMER_THREAD_NAME        "timer_thread"
+
+#endif /* MBED_RTX_CONF_H */
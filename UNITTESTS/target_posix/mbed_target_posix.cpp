@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Target hooks for the POSIX backend: the identity and entropy a board
+ * would otherwise provide.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/random.h>
+#include <unistd.h>
+
+#include "platform/mbed_interface.h"
+
+extern "C" uint32_t arm_random_seed_get(void);
+
+uint32_t arm_random_seed_get(void)
+{
+    uint32_t seed = 0;
+    while (getrandom(&seed, sizeof(seed), 0) != sizeof(seed)) {
+    }
+    return seed;
+}
+
+void mbed_mac_address(char *mac)
+{
+    // Locally administered, unique per process so forked stacks differ
+    uint32_t pid = getpid();
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = pid >> 24;
+    mac[3] = pid >> 16;
+    mac[4] = pid >> 8;
+    mac[5] = pid;
+}
@@ -0,0 +1,1367 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "QSPIFBlockDevice.h"
+#include <string.h>
+#include "mbed_wait_api.h"
+
+#include "mbed_trace.h"
+#define TRACE_GROUP "QSPIF"
+
+using namespace mbed;
+
+/* Default QSPIF Parameters */
+/****************************/
+#define QSPIF_DEFAULT_READ_SIZE  1
+#define QSPIF_DEFAULT_PROG_SIZE  1
+#define QSPIF_DEFAULT_PAGE_SIZE  256
+#define QSPIF_DEFAULT_SE_SIZE    4096
+#define QSPI_MAX_STATUS_REGISTER_SIZE 2
+#ifndef UINT64_MAX
+#define UINT64_MAX -1
+#endif
+#define QSPI_NO_ADDRESS_COMMAND UINT64_MAX
+// Status Register Bits
+#define QSPIF_STATUS_BIT_WIP        0x1 //Write In Progress
+#define QSPIF_STATUS_BIT_WEL        0x2 // Write Enable Latch
+#define QSPIF_STATUS_BIT_QE_SR1     0x40 // Quad Enable bit 6 of Status Register 1
+#define QSPIF_STATUS_BIT_QE_SR2     0x2 // Quad Enable bit 1 of Status Register 2
+
+// Quad program instruction (1-1-4), 0 to program over a single data line
+#ifndef MBED_CONF_QSPIF_QSPI_QUAD_PROG_INST
+#define MBED_CONF_QSPIF_QSPI_QUAD_PROG_INST 0x32
+#endif
+
+/* SFDP Header Parsing */
+/***********************/
+#define QSPIF_SFDP_HEADER_SIZE 8
+#define QSPIF_PARAM_HEADER_SIZE 8
+// SFDP tables are always read in 1-1-1 mode with 3 byte addresses and 8 dummy cycles
+#define QSPIF_SFDP_DUMMY_CYCLES 8
+
+/* Basic Parameters Table Parsing */
+/**********************************/
+#define SFDP_DEFAULT_BASIC_PARAMS_TABLE_SIZE_BYTES 64 /* 16 DWORDS */
+//READ Instruction support according to BUS Configuration
+#define QSPIF_BASIC_PARAM_TABLE_FAST_READ_SUPPORT_BYTE 2
+#define QSPIF_BASIC_PARAM_TABLE_144_READ_INST_BYTE 9
+#define QSPIF_BASIC_PARAM_TABLE_114_READ_INST_BYTE 11
+#define QSPIF_BASIC_PARAM_TABLE_PAGE_SIZE_BYTE 40
+#define QSPIF_BASIC_PARAM_TABLE_QER_BYTE 58
+#define QSPIF_BASIC_PARAM_TABLE_4BYTE_ADDR_BYTE 63
+#define QSPIF_BASIC_PARAM_TABLE_144_READ_SUPPORT 0x20
+#define QSPIF_BASIC_PARAM_TABLE_114_READ_SUPPORT 0x40
+
+#define QSPIF_BASIC_PARAM_ERASE_TYPE_1_BYTE 29
+#define QSPIF_BASIC_PARAM_ERASE_TYPE_1_SIZE_BYTE 28
+#define QSPIF_BASIC_PARAM_4K_ERASE_TYPE_BYTE 1
+
+// Address Length
+#define QSPIF_ADDR_SIZE_3_BYTES_MAX_DEVICE_SIZE (16 * 1024 * 1024)
+#define QSPIF_ADDR_MODE_3_BYTES_ONLY 0
+#define QSPIF_ADDR_MODE_3_OR_4_BYTES 1
+#define QSPIF_ADDR_MODE_4_BYTES_ONLY 2
+
+// 4-byte addressing methods (_4byte_addressing_method)
+#define QSPIF_4BYTE_ADDR_NOT_REQUIRED 0
+#define QSPIF_4BYTE_ADDR_ALWAYS       1 // Device only supports 4-byte addresses
+#define QSPIF_4BYTE_ADDR_EN4B         2 // Issue instruction B7h
+#define QSPIF_4BYTE_ADDR_WREN_EN4B    3 // Issue Write Enable then instruction B7h
+
+// Erase Types Per Region BitMask
+#define ERASE_BITMASK_TYPE4 0x08
+#define ERASE_BITMASK_TYPE1 0x01
+#define ERASE_BITMASK_NONE  0x00
+#define ERASE_BITMASK_ALL   0x0F
+
+#define IS_MEM_READY_MAX_RETRIES 10000
+
+enum qspif_default_instructions {
+    QSPIF_NOP = 0x00, // No operation
+    QSPIF_PP = 0x02, // Page Program data
+    QSPIF_READ = 0x03, // Read data
+    QSPIF_SE   = 0x20, // 4KB Sector Erase
+    QSPIF_SFDP = 0x5a, // Read SFDP
+    QSPIF_WRSR = 0x01, // Write Status/Configuration Register
+    QSPIF_WRDI = 0x04, // Write Disable
+    QSPIF_RDSR = 0x05, // Read Status Register
+    QSPIF_WREN = 0x06, // Write Enable
+    QSPIF_RDSR2 = 0x35, // Read Status Register 2
+    QSPIF_WRSR2 = 0x31, // Write Status Register 2
+    QSPIF_EN4B = 0xb7, // Enter 4-byte address mode
+    QSPIF_RSTEN = 0x66, // Reset Enable
+    QSPIF_RST = 0x99, // Reset
+    QSPIF_RDID = 0x9f, // Read Manufacturer and JDEC Device ID
+};
+
+// Mutex is used for some QSPI Driver commands that must be done sequentially with no other commands in between
+// e.g. (1)Set Write Enable, (2)Program, (3)Wait Memory Ready
+SingletonPtr<PlatformMutex> QSPIFBlockDevice::_mutex;
+
+// Local Function
+static unsigned int local_math_power(int base, int exp);
+
+//***********************
+// QSPIF Block Device APIs
+//***********************
+QSPIFBlockDevice::QSPIFBlockDevice(PinName io0, PinName io1, PinName io2, PinName io3, PinName sclk, PinName csel,
+                                   int clock_mode, int freq)
+    : _qspi(io0, io1, io2, io3, sclk, csel, clock_mode), _device_size_bytes(0), _mapped_base(NULL),
+      _init_ref_count(0), _is_initialized(false), _program_pending(false)
+{
+    // Initial SFDP read tables are read with 8 dummy cycles
+    // Default Bus Setup 1_1_1 with 0 dummy and mode cycles
+    _inst_width = QSPI_CFG_BUS_SINGLE;
+    _address_width = QSPI_CFG_BUS_SINGLE;
+    _address_size = QSPI_CFG_ADDR_SIZE_24;
+    _alt_width = QSPI_CFG_BUS_SINGLE;
+    _alt_size = QSPI_CFG_ALT_SIZE_8;
+    _alt_value = -1;
+    _data_width = QSPI_CFG_BUS_SINGLE;
+    _prog_data_width = QSPI_CFG_BUS_SINGLE;
+    _dummy_and_mode_cycles = 0;
+    _quad_enabled = false;
+    _4byte_addressing_method = QSPIF_4BYTE_ADDR_NOT_REQUIRED;
+
+    _read_instruction = QSPIF_READ;
+    _prog_instruction = QSPIF_PP;
+    _erase_instruction = QSPIF_SE;
+    _erase4k_inst = QSPIF_SE;
+
+    _min_common_erase_size = 0;
+    _regions_count = 1;
+    _region_erase_types_bitfield[0] = ERASE_BITMASK_NONE;
+    _page_size_bytes = QSPIF_DEFAULT_PAGE_SIZE;
+
+    if (QSPI_STATUS_OK != _qspi_set_frequency(freq)) {
+        tr_error("ERROR: QSPI Set Frequency Failed");
+    }
+}
+
+int QSPIFBlockDevice::init()
+{
+    uint8_t vendor_device_ids[4];
+    size_t data_length = 3;
+    int status = QSPIF_BD_ERROR_OK;
+    uint32_t basic_table_addr = 0;
+    size_t basic_table_size = 0;
+    uint32_t sector_map_table_addr = 0;
+    size_t sector_map_table_size = 0;
+    qspi_status_t qspi_status = QSPI_STATUS_OK;
+
+    _mutex->lock();
+
+    if (!_is_initialized) {
+        _init_ref_count = 0;
+    }
+
+    _init_ref_count++;
+
+    if (_init_ref_count != 1) {
+        goto exit_point;
+    }
+
+    // All commands are sent in 1-1-1 mode with 3 byte addresses until the SFDP tables were parsed
+    _address_size = QSPI_CFG_ADDR_SIZE_24;
+    _program_pending = false;
+    _qspi_configure_default_format();
+
+    // Soft Reset
+    if (-1 == _reset_flash_mem()) {
+        tr_error("ERROR: init - Unable to initialize flash memory, tests failed\n");
+        status = QSPIF_BD_ERROR_DEVICE_ERROR;
+        goto exit_point;
+    } else {
+        tr_info("INFO: Initialize flash memory OK\n");
+    }
+
+    /* Read Manufacturer ID (1byte), and Device ID (2bytes)*/
+    qspi_status = _qspi_send_general_command(QSPIF_RDID, QSPI_NO_ADDRESS_COMMAND, NULL, 0, (char *)vendor_device_ids,
+                                             data_length);
+    if (qspi_status != QSPI_STATUS_OK) {
+        tr_error("ERROR: init - Read Vendor ID Failed");
+        status = QSPIF_BD_ERROR_DEVICE_ERROR;
+        goto exit_point;
+    }
+
+    //Synchronize Device
+    if (false == _is_mem_ready()) {
+        tr_error("ERROR: init - _is_mem_ready Failed");
+        status = QSPIF_BD_ERROR_READY_FAILED;
+        goto exit_point;
+    }
+
+    /**************************** Parse SFDP Header ***********************************/
+    if (0 != _sfdp_parse_sfdp_headers(basic_table_addr, basic_table_size, sector_map_table_addr, sector_map_table_size)) {
+        tr_error("ERROR: init - Parse SFDP Headers Failed");
+        status = QSPIF_BD_ERROR_PARSING_FAILED;
+        goto exit_point;
+    }
+
+    /**************************** Parse Basic Parameters Table ***********************************/
+    if (0 != _sfdp_parse_basic_param_table(basic_table_addr, basic_table_size)) {
+        tr_error("ERROR: init - Parse Basic Param Table Failed");
+        status = QSPIF_BD_ERROR_PARSING_FAILED;
+        goto exit_point;
+    }
+
+    /**************************** Parse Sector Map Table ***********************************/
+    _region_size_bytes[0] =
+        _device_size_bytes; // If there's no region map, we have a single region sized the entire device size
+    _region_high_boundary[0] = _device_size_bytes - 1;
+
+    if ((sector_map_table_addr != 0) && (0 != sector_map_table_size)) {
+        tr_info("INFO: init - Parsing Sector Map Table - addr: 0x%lxh, Size: %d", sector_map_table_addr,
+                sector_map_table_size);
+        if (0 != _sfdp_parse_sector_map_table(sector_map_table_addr, sector_map_table_size)) {
+            tr_error("ERROR: init - Parse Sector Map Table Failed");
+            status = QSPIF_BD_ERROR_PARSING_FAILED;
+            goto exit_point;
+        }
+    }
+
+    /**************************** Switch to 4-byte addressing ***********************************/
+    // Done last as SFDP tables are always read with 3 byte addresses
+    if (0 != _enter_4byte_addressing()) {
+        tr_error("ERROR: init - Enter 4-byte addressing Failed");
+        status = QSPIF_BD_ERROR_DEVICE_ERROR;
+        goto exit_point;
+    }
+
+    _is_initialized = true;
+
+exit_point:
+    _mutex->unlock();
+
+    return status;
+}
+
+int QSPIFBlockDevice::deinit()
+{
+    qspif_bd_error status = QSPIF_BD_ERROR_OK;
+
+    _mutex->lock();
+
+    if (!_is_initialized) {
+        _init_ref_count = 0;
+        goto exit_point;
+    }
+
+    _init_ref_count--;
+
+    if (_init_ref_count) {
+        goto exit_point;
+    }
+
+    // Let the last page program complete before disabling writes
+    status = _wait_for_pending_program();
+    if (status != QSPIF_BD_ERROR_OK) {
+        tr_error("ERROR: Device not ready after write");
+    }
+
+    // Disable Device for Writing
+    if (_qspi_send_general_command(QSPIF_WRDI, QSPI_NO_ADDRESS_COMMAND, NULL, 0, NULL, 0) != QSPI_STATUS_OK) {
+        tr_error("ERROR: Write Disable failed");
+        status = QSPIF_BD_ERROR_DEVICE_ERROR;
+    }
+
+    _is_initialized = false;
+
+exit_point:
+    _mutex->unlock();
+
+    return status;
+}
+
+int QSPIFBlockDevice::sync()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _mutex->lock();
+    int status = _wait_for_pending_program();
+    _mutex->unlock();
+
+    return status;
+}
+
+int QSPIFBlockDevice::read(void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    int status = QSPIF_BD_ERROR_OK;
+    tr_info("INFO Inst: 0x%xh", _read_instruction);
+
+    _mutex->lock();
+
+    status = _wait_for_pending_program();
+    if (status != QSPIF_BD_ERROR_OK) {
+        _mutex->unlock();
+        return status;
+    }
+
+    if (_mapped_base) {
+        // Execute-in-place window, the controller clocks the read command
+        memcpy(buffer, _mapped_base + addr, size);
+        _mutex->unlock();
+        return status;
+    }
+
+    // Configure Bus for the fastest Read mode
+    _qspi_configure_format(_inst_width, _address_width, _address_size, _alt_width, _alt_size, _data_width,
+                           _dummy_and_mode_cycles);
+
+    if (QSPI_STATUS_OK != _qspi_send_read_command(_read_instruction, _alt_value, buffer, addr, size)) {
+        status = QSPIF_BD_ERROR_DEVICE_ERROR;
+        tr_error("ERROR: Read failed\n");
+    }
+
+    // All other commands use 1-1-1 Bus mode with 0 dummy cycles
+    _qspi_configure_default_format();
+
+    _mutex->unlock();
+    return status;
+}
+
+int QSPIFBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    qspi_status_t result = QSPI_STATUS_OK;
+    bool program_failed = false;
+    int status = QSPIF_BD_ERROR_OK;
+    uint32_t offset = 0;
+    uint32_t chunk = 0;
+    bd_size_t written_bytes = 0;
+
+    tr_debug("DEBUG: program - Buff: 0x%lxh, addr: %llu, size: %llu", (uint32_t)buffer, addr, size);
+
+    while (size > 0) {
+
+        // Write on _page_size_bytes boundaries (Default 256 bytes a page)
+        offset = addr % _page_size_bytes;
+        chunk = (offset + size < _page_size_bytes) ? size : (_page_size_bytes - offset);
+        written_bytes = chunk;
+
+        _mutex->lock();
+
+        // The previous page must be written before the device accepts a new Write Enable
+        if (_wait_for_pending_program() != QSPIF_BD_ERROR_OK) {
+            tr_error("ERROR: Device not ready after write, failed\n");
+            program_failed = true;
+            status = QSPIF_BD_ERROR_READY_FAILED;
+            goto exit_point;
+        }
+
+        //Send WREN
+        if (_set_write_enable() != 0) {
+            tr_error("ERROR: Write Enabe failed\n");
+            program_failed = true;
+            status = QSPIF_BD_ERROR_WREN_FAILED;
+            goto exit_point;
+        }
+
+        // Data phase of the program command over the quad bus when enabled
+        _qspi_configure_format(_inst_width, QSPI_CFG_BUS_SINGLE, _address_size, QSPI_CFG_BUS_SINGLE,
+                               QSPI_CFG_ALT_SIZE_8, _prog_data_width, 0);
+        result = _qspi_send_program_command(_prog_instruction, buffer, addr, &written_bytes);
+        _qspi_configure_default_format();
+
+        if ((result != QSPI_STATUS_OK) || (chunk != written_bytes)) {
+            tr_error("ERROR: Write failed");
+            program_failed = true;
+            status = QSPIF_BD_ERROR_DEVICE_ERROR;
+            goto exit_point;
+        }
+
+        // Completion is polled before the next command, which lets the
+        // caller prepare the next page while this one is being written
+        _program_pending = true;
+
+        buffer = static_cast<const uint8_t *>(buffer) + chunk;
+        addr += chunk;
+        size -= chunk;
+
+        _mutex->unlock();
+    }
+
+exit_point:
+    if (program_failed) {
+        _mutex->unlock();
+    }
+
+    return status;
+}
+
+int QSPIFBlockDevice::erase(bd_addr_t addr, bd_size_t in_size)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    int type = 0;
+    uint32_t offset = 0;
+    uint32_t chunk = 4096;
+    unsigned int cur_erase_inst = _erase_instruction;
+    int size = (int)in_size;
+    bool erase_failed = false;
+    int status = QSPIF_BD_ERROR_OK;
+    // Find region of erased address
+    int region = _utils_find_addr_region(addr);
+    // Erase Types of selected region
+    uint8_t bitfield;
+
+    tr_info("DEBUG: erase - addr: %llu, in_size: %llu", addr, in_size);
+
+    if ((addr + in_size) > _device_size_bytes) {
+        tr_error("ERROR: erase exceeds flash device size");
+        return QSPIF_BD_ERROR_INVALID_ERASE_PARAMS;
+    }
+
+    if (((addr % get_erase_size(addr)) != 0) || (((addr + in_size) % get_erase_size(addr + in_size - 1)) != 0)) {
+        tr_error("ERROR: invalid erase - unaligned address and size");
+        return QSPIF_BD_ERROR_INVALID_ERASE_PARAMS;
+    }
+
+    bitfield = _region_erase_types_bitfield[region];
+
+    // For each iteration erase the largest section supported by current region
+    while (size > 0) {
+
+        // iterate to find next Largest erase type ( a. supported by region, b. smaller than size)
+        // find the matching instruction and erase size chunk for that type.
+        type = _utils_iterate_next_largest_erase_type(bitfield, size, (unsigned int)addr, _region_high_boundary[region]);
+        cur_erase_inst = _erase_type_inst_arr[type];
+        offset = addr % _erase_type_size_arr[type];
+        chunk = ((offset + size) < _erase_type_size_arr[type]) ? size : (_erase_type_size_arr[type] - offset);
+
+        tr_debug("DEBUG: erase - addr: %llu, size:%d, Inst: 0x%xh, chunk: %lu , ",
+                 addr, size, cur_erase_inst, chunk);
+        tr_debug("DEBUG: erase - Region: %d, Type:%d",
+                 region, type);
+
+        _mutex->lock();
+
+        if (_wait_for_pending_program() != QSPIF_BD_ERROR_OK || _set_write_enable() != 0) {
+            tr_error("ERROR: QSPI Erase Device not ready - failed");
+            erase_failed = true;
+            status = QSPIF_BD_ERROR_READY_FAILED;
+            goto exit_point;
+        }
+
+        if (QSPI_STATUS_OK != _qspi_send_erase_command(cur_erase_inst, addr, size)) {
+            tr_error("ERROR: QSPI Erase command failed!");
+            erase_failed = true;
+            status = QSPIF_BD_ERROR_DEVICE_ERROR;
+            goto exit_point;
+        }
+
+        addr += chunk;
+        size -= chunk;
+
+        if ((size > 0) && (addr > _region_high_boundary[region])) {
+            // erase crossed to next region
+            region++;
+            bitfield = _region_erase_types_bitfield[region];
+        }
+
+        if (false == _is_mem_ready()) {
+            tr_error("ERROR: QSPI After Erase Device not ready - failed\n");
+            erase_failed = true;
+            status = QSPIF_BD_ERROR_READY_FAILED;
+            goto exit_point;
+        }
+
+        _mutex->unlock();
+    }
+
+exit_point:
+    if (erase_failed) {
+        _mutex->unlock();
+    }
+
+    return status;
+}
+
+bd_size_t QSPIFBlockDevice::get_read_size() const
+{
+    // Assuming all devices support 1byte read granularity
+    return QSPIF_DEFAULT_READ_SIZE;
+}
+
+bd_size_t QSPIFBlockDevice::get_program_size() const
+{
+    // Assuming all devices support 1byte program granularity
+    return QSPIF_DEFAULT_PROG_SIZE;
+}
+
+bd_size_t QSPIFBlockDevice::get_erase_size() const
+{
+    // return minimal erase size supported by all regions (0 if none exists)
+    return _min_common_erase_size;
+}
+
+// Find minimal erase size supported by the region to which the address belongs to
+bd_size_t QSPIFBlockDevice::get_erase_size(bd_addr_t addr)
+{
+    // Find region of current address
+    int region = _utils_find_addr_region(addr);
+
+    unsigned int min_region_erase_size = _min_common_erase_size;
+    int8_t type_mask = ERASE_BITMASK_TYPE1;
+    int i_ind = 0;
+
+    if (region != -1) {
+        type_mask = 0x01;
+
+        for (i_ind = 0; i_ind < 4; i_ind++) {
+            // loop through erase types bitfield supported by region
+            if (_region_erase_types_bitfield[region] & type_mask) {
+
+                min_region_erase_size = _erase_type_size_arr[i_ind];
+                break;
+            }
+            type_mask = type_mask << 1;
+        }
+
+        if (i_ind == 4) {
+            tr_error("ERROR: no erase type was found for region addr");
+        }
+    }
+
+    return (bd_size_t)min_region_erase_size;
+}
+
+bd_size_t QSPIFBlockDevice::size() const
+{
+    if (!_is_initialized) {
+        return 0;
+    }
+
+    return _device_size_bytes;
+}
+
+int QSPIFBlockDevice::get_erase_value() const
+{
+    return 0xFF;
+}
+
+void QSPIFBlockDevice::set_memory_mapped_reads(const void *base)
+{
+    _mutex->lock();
+    _mapped_base = static_cast<const char *>(base);
+    _mutex->unlock();
+}
+
+/*********************************************************/
+/********** SFDP Parsing and Detection Functions *********/
+/*********************************************************/
+int QSPIFBlockDevice::_sfdp_parse_sector_map_table(uint32_t sector_map_table_addr, size_t sector_map_table_size)
+{
+    uint8_t sector_map_table[SFDP_DEFAULT_BASIC_PARAMS_TABLE_SIZE_BYTES]; /* Up To 16 DWORDS = 64 Bytes */
+    uint32_t tmp_region_size = 0;
+    int i_ind = 0;
+    int prev_boundary = 0;
+    // Default set to all type bits 1-4 are common
+    int min_common_erase_type_bits = ERASE_BITMASK_ALL;
+
+    if (sector_map_table_size > sizeof(sector_map_table)) {
+        tr_error("ERROR: Sector Map - Table of %d bytes is not supported", sector_map_table_size);
+        return -1;
+    }
+
+    _qspi_configure_format(QSPI_CFG_BUS_SINGLE, QSPI_CFG_BUS_SINGLE, QSPI_CFG_ADDR_SIZE_24, QSPI_CFG_BUS_SINGLE,
+                           QSPI_CFG_ALT_SIZE_8, QSPI_CFG_BUS_SINGLE, QSPIF_SFDP_DUMMY_CYCLES);
+    qspi_status_t status = _qspi_send_read_command(QSPIF_SFDP, -1, sector_map_table, sector_map_table_addr /*address*/,
+                                                   sector_map_table_size);
+    _qspi_configure_default_format();
+    if (status != QSPI_STATUS_OK) {
+        tr_error("ERROR: init - Read SFDP First Table Failed");
+        return -1;
+    }
+
+    // Currently we support only Single Map Descriptor
+    if (!((sector_map_table[0] & 0x3) == 0x03) || (sector_map_table[1] != 0x0)) {
+        tr_error("ERROR: Sector Map - Supporting Only Single! Map Descriptor (not map commands)");
+        return -1;
+    }
+
+    _regions_count = sector_map_table[2] + 1;
+    if (_regions_count > QSPIF_MAX_REGIONS || (size_t)((_regions_count + 1) * 4) > sector_map_table_size) {
+        tr_error("ERROR: Supporting up to %d regions, current setup to %d regions - fail",
+                 QSPIF_MAX_REGIONS, _regions_count);
+        return -1;
+    }
+
+    // Loop through Regions and set for each one: size, supported erase types, high boundary offset
+    // Calculate minimum Common Erase Type for all Regions
+    for (i_ind = 0; i_ind < _regions_count; i_ind++) {
+        uint8_t *region_dword = &sector_map_table[(i_ind + 1) * 4];
+        tmp_region_size = (region_dword[3] << 16) | (region_dword[2] << 8) | region_dword[1]; // bits 9-32
+        _region_size_bytes[i_ind] = (tmp_region_size + 1) * 256; // Region size is 0 based multiple of 256 bytes;
+        _region_erase_types_bitfield[i_ind] = region_dword[0] & 0x0F; // bits 1-4
+        min_common_erase_type_bits &= _region_erase_types_bitfield[i_ind];
+        _region_high_boundary[i_ind] = (_region_size_bytes[i_ind] - 1) + prev_boundary;
+        prev_boundary = _region_high_boundary[i_ind] + 1;
+    }
+
+    // Calc minimum Common Erase Size from min_common_erase_type_bits
+    uint8_t type_mask = ERASE_BITMASK_TYPE1;
+    for (i_ind = 0; i_ind < 4; i_ind++) {
+        if (min_common_erase_type_bits & type_mask) {
+            _min_common_erase_size = _erase_type_size_arr[i_ind];
+            break;
+        }
+        type_mask = type_mask << 1;
+    }
+
+    if (i_ind == 4) {
+        // No common erase type was found between regions
+        _min_common_erase_size = 0;
+    }
+
+    return 0;
+}
+
+int QSPIFBlockDevice::_sfdp_parse_basic_param_table(uint32_t basic_table_addr, size_t basic_table_size)
+{
+    uint8_t param_table[SFDP_DEFAULT_BASIC_PARAMS_TABLE_SIZE_BYTES]; /* Up To 16 DWORDS = 64 Bytes */
+    memset(param_table, 0, SFDP_DEFAULT_BASIC_PARAMS_TABLE_SIZE_BYTES);
+
+    _qspi_configure_format(QSPI_CFG_BUS_SINGLE, QSPI_CFG_BUS_SINGLE, QSPI_CFG_ADDR_SIZE_24, QSPI_CFG_BUS_SINGLE,
+                           QSPI_CFG_ALT_SIZE_8, QSPI_CFG_BUS_SINGLE, QSPIF_SFDP_DUMMY_CYCLES);
+    qspi_status_t status = _qspi_send_read_command(QSPIF_SFDP, -1, param_table, basic_table_addr /*address*/,
+                                                   basic_table_size);
+    _qspi_configure_default_format();
+    if (status != QSPI_STATUS_OK) {
+        tr_error("ERROR: init - Read SFDP First Table Failed");
+        return -1;
+    }
+
+    // Get device density (stored in bits - 1, or as 2^N bits for devices larger than 2Gbit)
+    uint32_t density_bits = (
+                                (param_table[7] << 24) |
+                                (param_table[6] << 16) |
+                                (param_table[5] << 8) |
+                                param_table[4]);
+    if (density_bits & 0x80000000) {
+        _device_size_bytes = ((bd_size_t)1) << ((density_bits & 0x7FFFFFFF) - 3);
+    } else {
+        _device_size_bytes = ((bd_size_t)density_bits + 1) / 8;
+    }
+
+    // Set Default read/program/erase Instructions
+    _read_instruction = QSPIF_READ;
+    _prog_instruction = QSPIF_PP;
+    _erase_instruction = QSPIF_SE;
+
+    // Set Page Size (QSPI write must be done on Page limits)
+    _page_size_bytes = _sfdp_detect_page_size(param_table, basic_table_size);
+
+    // Detect and Set Erase Types
+    _sfdp_detect_erase_types_inst_and_size(param_table, basic_table_size, _erase4k_inst, _erase_type_inst_arr,
+                                           _erase_type_size_arr);
+    _erase_instruction = _erase4k_inst;
+
+    // Detect and Set fastest Bus mode (default 1-1-1)
+    bool quad_mode = false;
+    _sfdp_detect_best_bus_read_mode(param_table, basic_table_size, quad_mode, _read_instruction);
+
+    _quad_enabled = false;
+    if (quad_mode) {
+        if (0 == _sfdp_set_quad_enabled(param_table)) {
+            _quad_enabled = true;
+        } else {
+            // Fall back to single line reads
+            tr_warning("WARNING: Quad Enable failed, using 1-1-1 bus mode");
+            _read_instruction = QSPIF_READ;
+            _address_width = QSPI_CFG_BUS_SINGLE;
+            _alt_width = QSPI_CFG_BUS_SINGLE;
+            _alt_value = -1;
+            _data_width = QSPI_CFG_BUS_SINGLE;
+            _dummy_and_mode_cycles = 0;
+        }
+    }
+
+    // Program pages over the quad bus when the Quad Enable bit is set
+    if (_quad_enabled && MBED_CONF_QSPIF_QSPI_QUAD_PROG_INST) {
+        _prog_instruction = MBED_CONF_QSPIF_QSPI_QUAD_PROG_INST;
+        _prog_data_width = QSPI_CFG_BUS_QUAD;
+    } else {
+        _prog_instruction = QSPIF_PP;
+        _prog_data_width = QSPI_CFG_BUS_SINGLE;
+    }
+
+    // Detect the 4-byte addressing entry method, applied at the end of init
+    return _sfdp_detect_4byte_addressing(param_table, basic_table_size);
+}
+
+int QSPIFBlockDevice::_sfdp_parse_sfdp_headers(uint32_t &basic_table_addr, size_t &basic_table_size,
+                                               uint32_t &sector_map_table_addr, size_t &sector_map_table_size)
+{
+    uint8_t sfdp_header[QSPIF_SFDP_HEADER_SIZE];
+    uint8_t param_header[QSPIF_PARAM_HEADER_SIZE];
+    size_t data_length = QSPIF_SFDP_HEADER_SIZE;
+    bd_addr_t addr = 0x0;
+    qspi_status_t status;
+
+    // Set 1-1-1 bus mode for SFDP header parsing
+    // Initial SFDP read tables are read with 8 dummy cycles
+    _qspi_configure_format(QSPI_CFG_BUS_SINGLE, QSPI_CFG_BUS_SINGLE, QSPI_CFG_ADDR_SIZE_24, QSPI_CFG_BUS_SINGLE,
+                           QSPI_CFG_ALT_SIZE_8, QSPI_CFG_BUS_SINGLE, QSPIF_SFDP_DUMMY_CYCLES);
+
+    status = _qspi_send_read_command(QSPIF_SFDP, -1, sfdp_header, addr /*address*/, data_length);
+    if (status != QSPI_STATUS_OK) {
+        tr_error("ERROR: init - Read SFDP Failed");
+        _qspi_configure_default_format();
+        return -1;
+    }
+
+    // Verify SFDP signature for sanity
+    // Also check that major/minor version is acceptable
+    if (!(memcmp(&sfdp_header[0], "SFDP", 4) == 0 && sfdp_header[5] == 1)) {
+        tr_error("ERROR: init - _verify SFDP signature and version Failed");
+        _qspi_configure_default_format();
+        return -1;
+    } else {
+        tr_info("INFO: init - verified SFDP Signature and version Successfully");
+    }
+
+    // Discover Number of Parameter Headers
+    int number_of_param_headers = (int)(sfdp_header[6]) + 1;
+    tr_debug("DEBUG: number of Param Headers: %d", number_of_param_headers);
+
+    addr += QSPIF_SFDP_HEADER_SIZE;
+    data_length = QSPIF_PARAM_HEADER_SIZE;
+
+    // Loop over Param Headers and parse them (currently supported Basic Param Table and Sector Region Map Table)
+    for (int i_ind = 0; i_ind < number_of_param_headers; i_ind++) {
+
+        status = _qspi_send_read_command(QSPIF_SFDP, -1, param_header, addr, data_length);
+        if (status != QSPI_STATUS_OK) {
+            tr_error("ERROR: init - Read Param Table %d Failed", i_ind + 1);
+            _qspi_configure_default_format();
+            return -1;
+        }
+
+        // The SFDP spec indicates the standard table is always at offset 0
+        // in the parameter headers, we check just to be safe
+        if (param_header[2] != 1) {
+            tr_error("ERROR: Param Table %d - Major Version should be 1!", i_ind + 1);
+            _qspi_configure_default_format();
+            return -1;
+        }
+
+        if ((param_header[0] == 0) && (param_header[7] == 0xFF)) {
+            // Found Basic Params Table: LSB=0x00, MSB=0xFF
+            tr_debug("DEBUG: Found Basic Param Table at Table: %d", i_ind + 1);
+            basic_table_addr = ((param_header[6] << 16) | (param_header[5] << 8) | (param_header[4]));
+            // Supporting up to 64 Bytes Table (16 DWORDS)
+            basic_table_size = ((param_header[3] * 4) < SFDP_DEFAULT_BASIC_PARAMS_TABLE_SIZE_BYTES) ? (param_header[3] * 4) : 64;
+
+        } else if ((param_header[0] == 0x81) && (param_header[7] == 0xFF)) {
+            // Found Sector Map Table: LSB=0x81, MSB=0xFF
+            tr_debug("DEBUG: Found Sector Map Table at Table: %d", i_ind + 1);
+            sector_map_table_addr = ((param_header[6] << 16) | (param_header[5] << 8) | (param_header[4]));
+            sector_map_table_size = param_header[3] * 4;
+
+        }
+        addr += QSPIF_PARAM_HEADER_SIZE;
+
+    }
+
+    _qspi_configure_default_format();
+    return 0;
+}
+
+unsigned int QSPIFBlockDevice::_sfdp_detect_page_size(uint8_t *basic_param_table_ptr, int basic_param_table_size)
+{
+    unsigned int page_size = QSPIF_DEFAULT_PAGE_SIZE;
+
+    if (basic_param_table_size > QSPIF_BASIC_PARAM_TABLE_PAGE_SIZE_BYTE) {
+        // Page Size is specified by 4 Bits (N), calculated by 2^N
+        int page_to_power_size = ((int)basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_PAGE_SIZE_BYTE]) >> 4;
+        page_size = local_math_power(2, page_to_power_size);
+        tr_debug("DEBUG: Detected Page Size: %d", page_size);
+    } else {
+        tr_debug("DEBUG: Using Default Page Size: %d", page_size);
+    }
+    return page_size;
+}
+
+int QSPIFBlockDevice::_sfdp_detect_erase_types_inst_and_size(uint8_t *basic_param_table_ptr, int basic_param_table_size,
+                                                             unsigned int &erase4k_inst,
+                                                             unsigned int *erase_type_inst_arr, unsigned int *erase_type_size_arr)
+{
+    erase4k_inst = 0xff;
+    bool found_4Kerase_type = false;
+    uint8_t bitfield = 0x01;
+
+    // Erase 4K Inst is taken either from param table legacy 4K erase or superseded by erase Instruction for type of size 4K
+    erase4k_inst = basic_param_table_ptr[QSPIF_BASIC_PARAM_4K_ERASE_TYPE_BYTE];
+
+    if (basic_param_table_size > QSPIF_BASIC_PARAM_ERASE_TYPE_1_SIZE_BYTE) {
+        // Loop Erase Types 1-4
+        for (int i_ind = 0; i_ind < 4; i_ind++) {
+            erase_type_inst_arr[i_ind] = 0xff; //0xFF default for unsupported type
+            erase_type_size_arr[i_ind] = local_math_power(2,
+                                                          basic_param_table_ptr[QSPIF_BASIC_PARAM_ERASE_TYPE_1_SIZE_BYTE + 2 * i_ind]); // Size given as 2^N
+            tr_info("DEBUG: Erase Type(A) %d - Inst: 0x%xh, Size: %d", (i_ind + 1), erase_type_inst_arr[i_ind],
+                    erase_type_size_arr[i_ind]);
+            if (erase_type_size_arr[i_ind] > 1) {
+                // if size==1 type is not supported
+                erase_type_inst_arr[i_ind] = basic_param_table_ptr[QSPIF_BASIC_PARAM_ERASE_TYPE_1_BYTE + 2 * i_ind];
+
+                if ((erase_type_size_arr[i_ind] < _min_common_erase_size) || (_min_common_erase_size == 0)) {
+                    //Set default minimal common erase for singal region
+                    _min_common_erase_size = erase_type_size_arr[i_ind];
+                }
+
+                // SFDP standard requires 4K Erase type to exist and its instruction to be identical to legacy field erase instruction
+                if (erase_type_size_arr[i_ind] == 4096) {
+                    found_4Kerase_type = true;
+                    if (erase4k_inst != erase_type_inst_arr[i_ind]) {
+                        //Verify 4KErase Type is identical to Legacy 4K erase type specified in Byte 1 of Param Table
+                        erase4k_inst = erase_type_inst_arr[i_ind];
+                        tr_warning("WARNING: _detectEraseTypesInstAndSize - Default 4K erase Inst is different than erase type Inst for 4K");
+
+                    }
+                }
+                _region_erase_types_bitfield[0] |= bitfield; // If there's no region map, set region "0" types bitfield as defualt;
+            }
+
+            tr_info("INFO: Erase Type %d - Inst: 0x%xh, Size: %d", (i_ind + 1), erase_type_inst_arr[i_ind],
+                    erase_type_size_arr[i_ind]);
+            bitfield = bitfield << 1;
+        }
+    }
+
+    if (false == found_4Kerase_type) {
+        tr_warning("WARNING: Couldn't find Erase Type for 4KB size");
+    }
+    return 0;
+}
+
+int QSPIFBlockDevice::_sfdp_detect_best_bus_read_mode(uint8_t *basic_param_table_ptr, int basic_param_table_size,
+                                                      bool &quad_mode, unsigned int &read_inst)
+{
+    uint8_t examined_byte = basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_FAST_READ_SUPPORT_BYTE];
+    unsigned int wait_cycles;
+    unsigned int mode_cycles;
+
+    // Default 1-1-1 with 0 dummy cycles
+    quad_mode = false;
+    read_inst = QSPIF_READ;
+    _address_width = QSPI_CFG_BUS_SINGLE;
+    _alt_width = QSPI_CFG_BUS_SINGLE;
+    _alt_size = QSPI_CFG_ALT_SIZE_8;
+    _alt_value = -1;
+    _data_width = QSPI_CFG_BUS_SINGLE;
+    _dummy_and_mode_cycles = 0;
+
+    do {
+        if (basic_param_table_size <= QSPIF_BASIC_PARAM_TABLE_114_READ_INST_BYTE) {
+            break;
+        }
+
+        if (examined_byte & QSPIF_BASIC_PARAM_TABLE_144_READ_SUPPORT) {
+            // Fast Read 1-4-4 Supported
+            read_inst = basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_144_READ_INST_BYTE];
+            wait_cycles = basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_144_READ_INST_BYTE - 1] & 0x1F;
+            mode_cycles = basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_144_READ_INST_BYTE - 1] >> 5;
+            _address_width = QSPI_CFG_BUS_QUAD;
+            _data_width = QSPI_CFG_BUS_QUAD;
+            if (mode_cycles == 2) {
+                // Send the mode bits as a single byte on the quad bus, cleared so
+                // the device does not enter continuous read mode
+                _alt_width = QSPI_CFG_BUS_QUAD;
+                _alt_size = QSPI_CFG_ALT_SIZE_8;
+                _alt_value = 0;
+                _dummy_and_mode_cycles = wait_cycles;
+            } else {
+                _dummy_and_mode_cycles = wait_cycles + mode_cycles;
+            }
+            quad_mode = true;
+            tr_debug("DEBUG: Read Bus Mode set to 1-4-4, Instruction: 0x%xh", read_inst);
+            break;
+        }
+
+        if (examined_byte & QSPIF_BASIC_PARAM_TABLE_114_READ_SUPPORT) {
+            // Fast Read 1-1-4 Supported
+            read_inst = basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_114_READ_INST_BYTE];
+            wait_cycles = basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_114_READ_INST_BYTE - 1] & 0x1F;
+            mode_cycles = basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_114_READ_INST_BYTE - 1] >> 5;
+            _data_width = QSPI_CFG_BUS_QUAD;
+            _dummy_and_mode_cycles = wait_cycles + mode_cycles;
+            quad_mode = true;
+            tr_debug("DEBUG: Read Bus Mode set to 1-1-4, Instruction: 0x%xh", read_inst);
+            break;
+        }
+
+        tr_debug("DEBUG: Read Bus Mode set to 1-1-1, Instruction: 0x%xh", read_inst);
+    } while (false);
+
+    return 0;
+}
+
+int QSPIFBlockDevice::_sfdp_set_quad_enabled(uint8_t *basic_param_table_ptr)
+{
+    char status_regs[QSPI_MAX_STATUS_REGISTER_SIZE] = {0};
+    unsigned int write_inst = QSPIF_WRSR;
+    size_t write_size = 1;
+    int qe_reg = 0;
+    char qe_bit = 0;
+    bool can_verify = true;
+
+    // Quad Enable Requirements are bits 20-22 of the 15th DWORD
+    int qer = (basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_QER_BYTE] >> 4) & 0x7;
+
+    switch (qer) {
+        case 0:
+            // Device has no Quad Enable bit
+            tr_debug("DEBUG: Device does not have a Quad Enable bit");
+            return 0;
+        case 1:
+        case 4:
+        case 5:
+            // QE is bit 1 of Status Register 2, written along with Status Register 1
+            if (QSPI_STATUS_OK != _qspi_send_general_command(QSPIF_RDSR, QSPI_NO_ADDRESS_COMMAND, NULL, 0,
+                                                             &status_regs[0], 1)) {
+                tr_error("ERROR: Reading Status Register failed");
+                return -1;
+            }
+            if (qer != 1) {
+                if (QSPI_STATUS_OK != _qspi_send_general_command(QSPIF_RDSR2, QSPI_NO_ADDRESS_COMMAND, NULL, 0,
+                                                                 &status_regs[1], 1)) {
+                    tr_error("ERROR: Reading Status Register 2 failed");
+                    return -1;
+                }
+            } else {
+                // Status Register 2 can not be read back
+                can_verify = false;
+            }
+            write_size = 2;
+            qe_reg = 1;
+            qe_bit = QSPIF_STATUS_BIT_QE_SR2;
+            break;
+        case 2:
+            // QE is bit 6 of Status Register 1
+            if (QSPI_STATUS_OK != _qspi_send_general_command(QSPIF_RDSR, QSPI_NO_ADDRESS_COMMAND, NULL, 0,
+                                                             &status_regs[0], 1)) {
+                tr_error("ERROR: Reading Status Register failed");
+                return -1;
+            }
+            qe_reg = 0;
+            qe_bit = QSPIF_STATUS_BIT_QE_SR1;
+            break;
+        case 6:
+            // QE is bit 1 of Status Register 2, which has its own write instruction
+            if (QSPI_STATUS_OK != _qspi_send_general_command(QSPIF_RDSR2, QSPI_NO_ADDRESS_COMMAND, NULL, 0,
+                                                             &status_regs[0], 1)) {
+                tr_error("ERROR: Reading Status Register 2 failed");
+                return -1;
+            }
+            write_inst = QSPIF_WRSR2;
+            qe_reg = 0;
+            qe_bit = QSPIF_STATUS_BIT_QE_SR2;
+            break;
+        default:
+            tr_warning("WARNING: Quad Enable Requirement %d is not supported", qer);
+            return -1;
+    }
+
+    if (status_regs[qe_reg] & qe_bit) {
+        tr_debug("DEBUG: Quad Enable bit already set");
+        return 0;
+    }
+    status_regs[qe_reg] |= qe_bit;
+
+    if (0 != _set_write_enable()) {
+        tr_error("ERROR: Write Enable failed before setting Quad Enable bit");
+        return -1;
+    }
+
+    if (QSPI_STATUS_OK != _qspi_send_general_command(write_inst, QSPI_NO_ADDRESS_COMMAND, status_regs, write_size,
+                                                     NULL, 0)) {
+        tr_error("ERROR: Writing Status Register failed");
+        return -1;
+    }
+
+    if (false == _is_mem_ready()) {
+        tr_error("ERROR: Device not ready after writing Status Register");
+        return -1;
+    }
+
+    if (can_verify) {
+        char verify_reg = 0;
+        unsigned int read_inst = (qe_bit == QSPIF_STATUS_BIT_QE_SR1) ? QSPIF_RDSR : QSPIF_RDSR2;
+        if (QSPI_STATUS_OK != _qspi_send_general_command(read_inst, QSPI_NO_ADDRESS_COMMAND, NULL, 0,
+                                                         &verify_reg, 1)) {
+            tr_error("ERROR: Reading Status Register failed");
+            return -1;
+        }
+        if ((verify_reg & qe_bit) == 0) {
+            tr_error("ERROR: Quad Enable bit was not set");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int QSPIFBlockDevice::_sfdp_detect_4byte_addressing(uint8_t *basic_param_table_ptr, int basic_param_table_size)
+{
+    int address_mode = (basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_FAST_READ_SUPPORT_BYTE] >> 1) & 0x3;
+
+    _4byte_addressing_method = QSPIF_4BYTE_ADDR_NOT_REQUIRED;
+
+    if (address_mode == QSPIF_ADDR_MODE_4_BYTES_ONLY) {
+        _4byte_addressing_method = QSPIF_4BYTE_ADDR_ALWAYS;
+        return 0;
+    }
+
+    if (_device_size_bytes <= QSPIF_ADDR_SIZE_3_BYTES_MAX_DEVICE_SIZE) {
+        return 0;
+    }
+
+    if (address_mode != QSPIF_ADDR_MODE_3_OR_4_BYTES) {
+        tr_error("ERROR: init - device larger than 16MB does not support 4-byte addressing");
+        return -1;
+    }
+
+    // Enter 4-byte addressing methods are bits 24-31 of the 16th DWORD
+    if (basic_param_table_size > QSPIF_BASIC_PARAM_TABLE_4BYTE_ADDR_BYTE) {
+        uint8_t methods = basic_param_table_ptr[QSPIF_BASIC_PARAM_TABLE_4BYTE_ADDR_BYTE];
+        if (methods & 0x01) {
+            _4byte_addressing_method = QSPIF_4BYTE_ADDR_EN4B;
+            return 0;
+        }
+        if (methods & 0x02) {
+            _4byte_addressing_method = QSPIF_4BYTE_ADDR_WREN_EN4B;
+            return 0;
+        }
+    }
+
+    tr_error("ERROR: init - no supported method to enter 4-byte addressing");
+    return -1;
+}
+
+int QSPIFBlockDevice::_enter_4byte_addressing()
+{
+    switch (_4byte_addressing_method) {
+        case QSPIF_4BYTE_ADDR_NOT_REQUIRED:
+            return 0;
+        case QSPIF_4BYTE_ADDR_WREN_EN4B:
+            if (0 != _set_write_enable()) {
+                return -1;
+            }
+        // Fall through
+        case QSPIF_4BYTE_ADDR_EN4B:
+            if (QSPI_STATUS_OK != _qspi_send_general_command(QSPIF_EN4B, QSPI_NO_ADDRESS_COMMAND, NULL, 0,
+                                                             NULL, 0)) {
+                return -1;
+            }
+            break;
+        default:
+            break;
+    }
+
+    tr_debug("DEBUG: Using 4-byte addressing");
+    _address_size = QSPI_CFG_ADDR_SIZE_32;
+    _qspi_configure_default_format();
+    return 0;
+}
+
+/***************************************************/
+/*********** QSPI Driver API Functions *************/
+/***************************************************/
+qspi_status_t QSPIFBlockDevice::_qspi_set_frequency(int freq)
+{
+    return _qspi.set_frequency(freq);
+}
+
+qspi_status_t QSPIFBlockDevice::_qspi_configure_format(qspi_bus_width_t inst_width, qspi_bus_width_t address_width,
+                                                       qspi_address_size_t address_size, qspi_bus_width_t alt_width,
+                                                       qspi_alt_size_t alt_size, qspi_bus_width_t data_width,
+                                                       int dummy_cycles)
+{
+    // Configure QSPI driver Bus format
+    return _qspi.configure_format(inst_width, address_width, address_size, alt_width, alt_size, data_width,
+                                  dummy_cycles);
+}
+
+qspi_status_t QSPIFBlockDevice::_qspi_configure_default_format()
+{
+    // 1-1-1 Bus mode with 0 dummy cycles
+    return _qspi_configure_format(_inst_width, QSPI_CFG_BUS_SINGLE, _address_size, QSPI_CFG_BUS_SINGLE,
+                                  QSPI_CFG_ALT_SIZE_8, QSPI_CFG_BUS_SINGLE, 0);
+}
+
+qspi_status_t QSPIFBlockDevice::_qspi_send_read_command(unsigned int read_inst, int alt, void *buffer,
+                                                        bd_addr_t addr, bd_size_t size)
+{
+    // Send Read command to device driver
+    size_t buf_len = size;
+
+    if (_qspi.read(read_inst, alt, (unsigned int)addr, (char *)buffer, &buf_len) != QSPI_STATUS_OK) {
+        tr_error("ERROR: Read failed");
+        return QSPI_STATUS_ERROR;
+    }
+
+    return QSPI_STATUS_OK;
+}
+
+qspi_status_t QSPIFBlockDevice::_qspi_send_program_command(unsigned int prog_inst, const void *buffer,
+                                                           bd_addr_t addr, bd_size_t *size)
+{
+    // Send Program (write) command to device driver
+    qspi_status_t result = QSPI_STATUS_OK;
+    size_t buf_len = *size;
+
+    result = _qspi.write(prog_inst, -1, addr, (char *)buffer, &buf_len);
+    *size = buf_len;
+
+    if (result != QSPI_STATUS_OK) {
+        tr_error("ERROR: QSPI Write failed");
+    }
+
+    return result;
+}
+
+qspi_status_t QSPIFBlockDevice::_qspi_send_erase_command(unsigned int erase_inst, bd_addr_t addr, bd_size_t size)
+{
+    // Send Erase Instruction command to driver
+    qspi_status_t result = QSPI_STATUS_OK;
+
+    tr_info("INFO: Erase Inst: 0x%xh, addr: %llu, size: %llu", erase_inst, addr, size);
+
+    result = _qspi.command_transfer(erase_inst, // command to send
+                                    (((int)addr) & 0xFFFFF000), // Align addr to 4096
+                                    NULL,                 // do not transmit
+                                    0,              // do not transmit
+                                    NULL,                 // just receive two bytes of data
+                                    0); // store received values in status_value
+
+    if (QSPI_STATUS_OK != result) {
+        tr_error("ERROR: QSPI Erase failed");
+    }
+
+    return result;
+}
+
+qspi_status_t QSPIFBlockDevice::_qspi_send_general_command(unsigned int instruction, bd_addr_t addr,
+                                                           const char *tx_buffer,
+                                                           size_t tx_length, const char *rx_buffer, size_t rx_length)
+{
+    // Send a general command Instruction to driver
+    qspi_status_t status = _qspi.command_transfer(instruction, (addr == QSPI_NO_ADDRESS_COMMAND) ? -1 : (int)addr,
+                                                  tx_buffer, tx_length, rx_buffer, rx_length);
+
+    if (QSPI_STATUS_OK != status) {
+        tr_error("ERROR:Sending Generic command: %x", instruction);
+    }
+
+    return status;
+}
+
+/*********************************************/
+/************* Flash Configuration ***********/
+/*********************************************/
+int QSPIFBlockDevice::_reset_flash_mem()
+{
+    // Perform Soft Reset of the Device prior to initialization
+    int status = 0;
+    char status_value[QSPI_MAX_STATUS_REGISTER_SIZE] = {0};
+    tr_info("INFO: _reset_flash_mem:\n");
+    //Read the Status Register from device
+    if (QSPI_STATUS_OK == _qspi_send_general_command(QSPIF_RDSR, QSPI_NO_ADDRESS_COMMAND, NULL, 0, status_value, 1)) {
+        // store received values in status_value
+        tr_debug("DEBUG: Reading Status Register Success: value = 0x%x\n", (int)status_value[0]);
+    } else {
+        tr_debug("ERROR: Reading Status Register failed\n");
+        status = -1;
+    }
+
+    if (0 == status) {
+        //Send Reset Enable
+        if (QSPI_STATUS_OK == _qspi_send_general_command(QSPIF_RSTEN, QSPI_NO_ADDRESS_COMMAND, NULL, 0, NULL, 0)) {
+            // store received values in status_value
+            tr_debug("DEBUG: Sending RSTEN Success\n");
+        } else {
+            tr_error("ERROR: Sending RSTEN failed\n");
+            status = -1;
+        }
+
+        if (0 == status) {
+            //Send Reset
+            if (QSPI_STATUS_OK == _qspi_send_general_command(QSPIF_RST, QSPI_NO_ADDRESS_COMMAND, NULL, 0, NULL, 0)) {
+                // store received values in status_value
+                tr_debug("DEBUG: Sending RST Success\n");
+            } else {
+                tr_error("ERROR: Sending RST failed\n");
+                status = -1;
+            }
+            // Give the device its reset recovery time before polling the status register
+            wait_ms(1);
+            _is_mem_ready();
+        }
+    }
+
+    return status;
+}
+
+bool QSPIFBlockDevice::_is_mem_ready()
+{
+    // Check Status Register Busy Bit to Verify the Device isn't Busy
+    char status_value[QSPI_MAX_STATUS_REGISTER_SIZE];
+    int retries = 0;
+    bool mem_ready = true;
+
+    do {
+        if (retries++) {
+            // Only sleep when the device is actually busy, most commands complete well within a poll
+            wait_ms(1);
+        }
+        //Read the Status Register from device
+        if (QSPI_STATUS_OK != _qspi_send_general_command(QSPIF_RDSR, QSPI_NO_ADDRESS_COMMAND, NULL, 0, status_value,
+                                                         1)) {   // store received values in status_value
+            tr_error("ERROR: Reading Status Register failed\n");
+        }
+    } while ((status_value[0] & QSPIF_STATUS_BIT_WIP) != 0 && retries < IS_MEM_READY_MAX_RETRIES);
+
+    if ((status_value[0] & QSPIF_STATUS_BIT_WIP) != 0) {
+        tr_error("ERROR: _is_mem_ready FALSE\n");
+        mem_ready = false;
+    }
+    return mem_ready;
+}
+
+qspif_bd_error QSPIFBlockDevice::_wait_for_pending_program()
+{
+    if (!_program_pending) {
+        return QSPIF_BD_ERROR_OK;
+    }
+
+    _program_pending = false;
+    if (false == _is_mem_ready()) {
+        tr_error("ERROR: Device not ready after write, failed\n");
+        return QSPIF_BD_ERROR_READY_FAILED;
+    }
+    return QSPIF_BD_ERROR_OK;
+}
+
+int QSPIFBlockDevice::_set_write_enable()
+{
+    // Check Status Register Busy Bit to Verify the Device isn't Busy
+    char status_value[QSPI_MAX_STATUS_REGISTER_SIZE];
+    int status = -1;
+
+    do {
+        if (QSPI_STATUS_OK != _qspi_send_general_command(QSPIF_WREN, QSPI_NO_ADDRESS_COMMAND, NULL, 0, NULL, 0)) {
+            tr_error("ERROR:Sending WREN command FAILED\n");
+            break;
+        }
+
+        if (false == _is_mem_ready()) {
+            tr_error("ERROR: Device not ready, write failed");
+            break;
+        }
+
+        memset(status_value, 0, QSPI_MAX_STATUS_REGISTER_SIZE);
+        if (QSPI_STATUS_OK != _qspi_send_general_command(QSPIF_RDSR, QSPI_NO_ADDRESS_COMMAND, NULL, 0,
+                                                         status_value, 1)) {   // store received values in status_value
+            tr_error("ERROR: Reading Status Register failed\n");
+            break;
+        }
+
+        if ((status_value[0] & QSPIF_STATUS_BIT_WEL) == 0) {
+            tr_error("ERROR: _set_write_enable failed\n");
+            break;
+        }
+        status = 0;
+    } while (false);
+    return status;
+}
+
+/*********************************************/
+/************* Utility Functions *************/
+/*********************************************/
+int QSPIFBlockDevice::_utils_find_addr_region(bd_size_t offset)
+{
+    //Find the region to which the given offset belong to
+    if ((offset > _device_size_bytes) || (_regions_count == 0)) {
+        return -1;
+    }
+
+    if (_regions_count == 1) {
+        return 0;
+    }
+
+    for (int i_ind = _regions_count - 2; i_ind >= 0; i_ind--) {
+
+        if (offset > _region_high_boundary[i_ind]) {
+            return (i_ind + 1);
+        }
+    }
+    return 0;
+
+}
+
+int QSPIFBlockDevice::_utils_iterate_next_largest_erase_type(uint8_t &bitfield, int size, int offset, int boundry)
+{
+    // Iterate on all supported Erase Types of the Region to which the offset belong to.
+    // Iterates from highest type to lowest
+    uint8_t type_mask = ERASE_BITMASK_TYPE4;
+    int i_ind  = 0;
+    int largest_erase_type = 0;
+    for (i_ind = 3; i_ind >= 0; i_ind--) {
+        if (bitfield & type_mask) {
+            largest_erase_type = i_ind;
+            if ((size > (int)(_erase_type_size_arr[largest_erase_type])) &&
+                    ((boundry - offset) > (int)(_erase_type_size_arr[largest_erase_type]))) {
+                break;
+            } else {
+                bitfield &= ~type_mask;
+            }
+        }
+        type_mask = type_mask >> 1;
+    }
+
+    if (i_ind == 4) {
+        tr_error("ERROR: no erase type was found for current region addr");
+    }
+    return largest_erase_type;
+
+}
+
+/*********************************************/
+/************** Local Functions **************/
+/*********************************************/
+static unsigned int local_math_power(int base, int exp)
+{
+    // Integer X^Y function, used to calculate size fields given in 2^N format
+    int result = 1;
+    while (exp) {
+        result *= base;
+        exp--;
+    }
+    return result;
+}
@@ -82,10 +82,11 @@
  * just always use the Standard Capacity cards with a block size of 512 bytes.
  * This is set with CMD16.
  *
- * You can read and write single blocks (CMD17, CMD25) or multiple blocks
- * (CMD18, CMD25). For simplicity, I'll just use single block accesses. When
- * the card gets a read command, it responds with a response token, and then
- * a data token or an error.
+ * You can read and write single blocks (CMD17, CMD24) or multiple blocks
+ * (CMD18, CMD25). Any access spanning more than one block is streamed as a
+ * multiple block transfer, so the command overhead is paid once per access
+ * rather than once per block. When the card gets a read command, it responds
+ * with a response token, and then a data token or an error.
  *
  * SPI Command Format
  * ------------------
@@ -133,6 +134,26 @@
  * +------+---------+---------+- -  - -+---------+-----------+----------+
  * | 0xFE | data[0] | data[1] |        | data[n] | crc[15:8] | crc[7:0] |
  * +------+---------+---------+- -  - -+---------+-----------+----------+
+ *
+ * Multiple Block Read and Write
+ * -----------------------------
+ *
+ * The data of a block is clocked with a single SPI transfer, or with a
+ * non-blocking transfer when the sd.SPI_ASYNC option is enabled. While the
+ * next block of a multiple block read is clocked in, the CRC16 of the
+ * previous one is verified. While the card is busy programming a block of a
+ * multiple block write, the CRC16 of the next one is computed. Large writes
+ * are preceded by the number of blocks to pre-erase (ACMD23).
+ *
+ * Queued Requests
+ * ---------------
+ *
+ * Requests queued with submit() are served from an event queue, one command
+ * or block per event. The busy state of the card after a block is written or
+ * an erase is started is polled from separate events, every millisecond once
+ * a few polls found it busy, so the event queue is free while the card
+ * programs. A multiple block write stays open between blocks; the blocking
+ * functions close it before sending their own commands.
  */
 
 /* If the target has no SPI support then SDCard is not supported */
@@ -141,6 +162,7 @@
 #include "SDBlockDevice.h"
 #include "platform/mbed_debug.h"
 #include "platform/mbed_wait_api.h"
+#include "events/mbed_shared_queues.h"
 #include <errno.h>
 
 #ifndef MBED_CONF_SD_CMD_TIMEOUT
@@ -155,11 +177,18 @@
 #define MBED_CONF_SD_INIT_FREQUENCY              100000 /*!< Initialization frequency Range (100KHz-400KHz) */
 #endif
 
+#ifndef MBED_CONF_SD_PRE_ERASE_MIN_BLOCKS
+#define MBED_CONF_SD_PRE_ERASE_MIN_BLOCKS        8      /*!< Smallest multiple block write preceded by ACMD23 */
+#endif
+
 
 #define SD_COMMAND_TIMEOUT                       MBED_CONF_SD_CMD_TIMEOUT
 #define SD_CMD0_GO_IDLE_STATE_RETRIES            MBED_CONF_SD_CMD0_IDLE_STATE_RETRIES
 #define SD_DBG                                   0      /*!< 1 - Enable debugging */
 #define SD_CMD_TRACE                             0      /*!< 1 - Enable SD command tracing */
+#define SD_BUSY_POLL_SIZE                        8      /*!< Bytes clocked per poll while the card is busy */
+#define SD_BUSY_YIELD_POLLS                      16     /*!< Busy polls of a request before polling every 1ms */
+#define SD_PRE_ERASE_MAX_BLOCKS                  0x7FFFFF /*!< ACMD23 block count is 23 bits wide */
 
 #define SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK        -5001  /*!< operation would block */
 #define SD_BLOCK_DEVICE_ERROR_UNSUPPORTED        -5002  /*!< unsupported operation */
@@ -242,7 +271,9 @@
 
 SDBlockDevice::SDBlockDevice(PinName mosi, PinName miso, PinName sclk, PinName cs, uint64_t hz, bool crc_on)
     : _sectors(0), _spi(mosi, miso, sclk), _cs(cs), _is_initialized(0),
-      _crc_on(crc_on), _init_ref_count(0), _crc16(0, 0, false, false)
+      _crc_on(crc_on), _init_ref_count(0), _crc16(0, 0, false, false), _async_queue(NULL),
+      _async_request(NULL), _async_segment(NULL), _async_addr(0), _async_polls(0), _async_scheduled(false),
+      _async_busy(false), _async_writing(false)
 {
     _cs = 1;
     _card_type = SDCARD_NONE;
@@ -418,6 +449,7 @@ int SDBlockDevice::deinit()
         goto end;
     }
 
+    _end_write();
     _is_initialized = false;
     _sectors = 0;
 
@@ -438,10 +470,10 @@ int SDBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
         unlock();
         return SD_BLOCK_DEVICE_ERROR_NO_INIT;
     }
+    _end_write();
 
     const uint8_t *buffer = static_cast<const uint8_t *>(b);
     int status = BD_ERROR_OK;
-    uint8_t response;
 
     // Get block count
     bd_addr_t blockCnt = size / _block_size;
@@ -461,16 +493,13 @@ int SDBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
         }
 
         // Write data
-        response = _write(buffer, SPI_START_BLOCK, _block_size);
-
-        // Only CRC and general write error are communicated via response token
-        if (response != SPI_DATA_ACCEPTED) {
-            debug_if(SD_DBG, "Single Block Write failed: 0x%x \n", response);
-            status = SD_BLOCK_DEVICE_ERROR_WRITE;
-        }
+        status = _write(buffer, SPI_START_BLOCK, 1);
     } else {
-        // Pre-erase setting prior to multiple block write operation
-        _cmd(ACMD23_SET_WR_BLK_ERASE_COUNT, blockCnt, 1);
+        // Pre-erase setting prior to large multiple block write operations
+        if (blockCnt >= MBED_CONF_SD_PRE_ERASE_MIN_BLOCKS) {
+            _cmd(ACMD23_SET_WR_BLK_ERASE_COUNT,
+                 blockCnt < SD_PRE_ERASE_MAX_BLOCKS ? blockCnt : SD_PRE_ERASE_MAX_BLOCKS, 1);
+        }
 
         // Multiple block write command
         if (BD_ERROR_OK != (status = _cmd(CMD25_WRITE_MULTIPLE_BLOCK, addr))) {
@@ -478,15 +507,8 @@ int SDBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
             return status;
         }
 
-        // Write the data: one block at a time
-        do {
-            response = _write(buffer, SPI_START_BLK_MUL_WRITE, _block_size);
-            if (response != SPI_DATA_ACCEPTED) {
-                debug_if(SD_DBG, "Multiple Block Write failed: 0x%x \n", response);
-                break;
-            }
-            buffer += _block_size;
-        } while (--blockCnt);     // Receive all blocks of data
+        // Write the data: all blocks are streamed in one transaction
+        status = _write(buffer, SPI_START_BLK_MUL_WRITE, blockCnt);
 
         /* In a Multiple Block write operation, the stop transmission will be done by
          * sending 'Stop Tran' token instead of 'Start Block' token at the beginning
@@ -511,6 +533,7 @@ int SDBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
         unlock();
         return SD_BLOCK_DEVICE_ERROR_PARAMETER;
     }
+    _end_write();
 
     uint8_t *buffer = static_cast<uint8_t *>(b);
     int status = BD_ERROR_OK;
@@ -533,20 +556,16 @@ int SDBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
         return status;
     }
 
-    // receive the data : one block at a time
-    while (blockCnt) {
-        if (0 != _read(buffer, _block_size)) {
-            status = SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
-            break;
-        }
-        buffer += _block_size;
-        --blockCnt;
-    }
+    // receive the data : all blocks are streamed in one transaction
+    status = _read(buffer, _block_size, blockCnt);
     _deselect();
 
     // Send CMD12(0x00000000) to stop the transmission for multi-block transfer
     if (size > _block_size) {
-        status = _cmd(CMD12_STOP_TRANSMISSION, 0x0);
+        int stop_status = _cmd(CMD12_STOP_TRANSMISSION, 0x0);
+        if (BD_ERROR_OK == status) {
+            status = stop_status;
+        }
     }
     unlock();
     return status;
@@ -571,6 +590,7 @@ int SDBlockDevice::trim(bd_addr_t addr, bd_size_t size)
         unlock();
         return SD_BLOCK_DEVICE_ERROR_NO_INIT;
     }
+    _end_write();
     int status = BD_ERROR_OK;
 
     size -= _block_size;
@@ -626,7 +646,264 @@ int SDBlockDevice::frequency(uint64_t freq)
     return err;
 }
 
+void SDBlockDevice::set_event_queue(events::EventQueue *queue)
+{
+    lock();
+    _async_queue = queue;
+    unlock();
+}
+
+int SDBlockDevice::submit(bd_request_t *request)
+{
+    if (!_is_initialized) {
+        return SD_BLOCK_DEVICE_ERROR_NO_INIT;
+    }
+
+    bool valid = false;
+    switch (request->type) {
+        case BD_REQUEST_READ:
+            valid = request->buffer && is_valid_read(request->addr, request->size);
+            break;
+        case BD_REQUEST_PROGRAM:
+            valid = request->buffer && is_valid_program(request->addr, request->size);
+            break;
+        case BD_REQUEST_ERASE:
+            valid = is_valid_erase(request->addr, request->size);
+            break;
+        case BD_REQUEST_TRIM:
+            valid = _is_valid_trim(request->addr, request->size);
+            break;
+        case BD_REQUEST_SYNC:
+            valid = true;
+            break;
+    }
+    if (!valid) {
+        return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+    }
+
+    lock();
+    if (!_async_queue) {
+        _async_queue = mbed::mbed_event_queue();
+    }
+    if (!_async_scheduled && !_async_schedule(0)) {
+        unlock();
+        return SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK;
+    }
+    _async_requests.push(request);
+    unlock();
+
+    return BD_ERROR_OK;
+}
+
 // PRIVATE FUNCTIONS
+void SDBlockDevice::_async_step()
+{
+    int status = BD_ERROR_OK;
+    bool done = false;
+
+    lock();
+
+    if (!_async_request) {
+        _async_request = _async_requests.pop();
+        if (!_async_request) {
+            _async_scheduled = false;
+            unlock();
+            return;
+        }
+
+        _async_segment = _async_request;
+        _async_addr = _async_request->addr;
+        _async_polls = 0;
+    }
+
+    if (!_is_initialized) {
+        status = SD_BLOCK_DEVICE_ERROR_NO_INIT;
+        done = true;
+    } else if (_async_busy && _is_card_busy()) {
+        // Poll again after the other events, then every millisecond, instead of waiting for the card
+        _async_polls++;
+        if (_async_polls < SD_BUSY_YIELD_POLLS + SD_COMMAND_TIMEOUT &&
+                _async_schedule(_async_polls < SD_BUSY_YIELD_POLLS ? 0 : 1)) {
+            unlock();
+            return;
+        }
+        debug_if(SD_DBG, "Card not ready yet \n");
+        status = SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+        done = true;
+    } else {
+        _async_busy = false;
+        _async_polls = 0;
+        status = _async_serve(done);
+        if (status != BD_ERROR_OK) {
+            done = true;
+        }
+    }
+
+    // Carry on with this request or the next one
+    bd_request_t *request = _async_request;
+    if (!_async_schedule(0) && !done) {
+        status = SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK;
+        done = true;
+    }
+    if (done) {
+        _async_request = NULL;
+    }
+
+    unlock();
+
+    if (done) {
+        BlockDeviceRequestQueue::complete(request, status);
+    }
+}
+
+int SDBlockDevice::_async_serve(bool &done)
+{
+    int status = BD_ERROR_OK;
+
+    switch (_async_request->type) {
+        case BD_REQUEST_READ: {
+            // Merged requests follow each other on the card, a single command reads them all
+            bool multiple = _async_request->span > _block_size;
+            status = _cmd(multiple ? CMD18_READ_MULTIPLE_BLOCK : CMD17_READ_SINGLE_BLOCK, _card_addr(_async_addr));
+            if (BD_ERROR_OK != status) {
+                return status;
+            }
+            for (bd_request_t *segment = _async_request; segment && status == BD_ERROR_OK; segment = segment->merged) {
+                status = _read(static_cast<uint8_t *>(segment->buffer), _block_size, segment->size / _block_size);
+            }
+            _deselect();
+
+            if (multiple) {
+                int stop_status = _cmd(CMD12_STOP_TRANSMISSION, 0x0);
+                if (BD_ERROR_OK == status) {
+                    status = stop_status;
+                }
+            }
+            done = true;
+            break;
+        }
+
+        case BD_REQUEST_PROGRAM: {
+            // Stop the transmission once the card is ready after the last block
+            if (!_async_segment) {
+                _end_write();
+                done = true;
+                break;
+            }
+
+            // A block per step, the multiple block write stays open in between
+            if (!_async_writing) {
+                bd_size_t blocks = (_async_request->addr + _async_request->span - _async_addr) / _block_size;
+                if (blocks >= MBED_CONF_SD_PRE_ERASE_MIN_BLOCKS) {
+                    _cmd(ACMD23_SET_WR_BLK_ERASE_COUNT,
+                         blocks < SD_PRE_ERASE_MAX_BLOCKS ? blocks : SD_PRE_ERASE_MAX_BLOCKS, 1);
+                }
+                if (BD_ERROR_OK != (status = _cmd(CMD25_WRITE_MULTIPLE_BLOCK, _card_addr(_async_addr)))) {
+                    return status;
+                }
+                _async_writing = true;
+            } else {
+                _select();
+            }
+
+            const uint8_t *buffer = static_cast<const uint8_t *>(_async_segment->buffer) +
+                                    (_async_addr - _async_segment->addr);
+            status = _write_block(buffer, SPI_START_BLK_MUL_WRITE, _compute_crc16(buffer, _block_size));
+            if (BD_ERROR_OK != status) {
+                _spi.write(SPI_STOP_TRAN);
+                _async_writing = false;
+            }
+            _deselect();
+            _async_busy = true;
+
+            _async_addr += _block_size;
+            if (_async_addr == _async_segment->addr + _async_segment->size) {
+                _async_segment = _async_segment->merged;
+            }
+            break;
+        }
+
+        case BD_REQUEST_TRIM: {
+            bd_addr_t end = _async_request->addr + _async_request->span - _block_size;
+            if (BD_ERROR_OK != (status = _cmd(CMD32_ERASE_WR_BLK_START_ADDR, _card_addr(_async_addr)))) {
+                return status;
+            }
+            if (BD_ERROR_OK != (status = _cmd(CMD33_ERASE_WR_BLK_END_ADDR, _card_addr(end)))) {
+                return status;
+            }
+
+            // Unlike _cmd(), does not wait for the card to finish the erase
+            _select();
+            uint8_t response = _cmd_spi(CMD38_ERASE, 0x0);
+            _deselect();
+            if (R1_NO_RESPONSE == response) {
+                return SD_BLOCK_DEVICE_ERROR_NO_DEVICE;
+            }
+            if ((response & R1_ERASE_RESET) || (response & R1_ERASE_SEQUENCE_ERROR)) {
+                return SD_BLOCK_DEVICE_ERROR_ERASE;
+            }
+            _async_busy = true;
+            done = true;
+            break;
+        }
+
+        case BD_REQUEST_ERASE:
+        case BD_REQUEST_SYNC:
+            // Erase is not needed before program, sync completes once the card is ready
+            done = true;
+            break;
+    }
+
+    return status;
+}
+
+bool SDBlockDevice::_async_schedule(int ms)
+{
+    int id;
+    if (ms) {
+        id = _async_queue->call_in(ms, this, &SDBlockDevice::_async_step);
+    } else {
+        id = _async_queue->call(this, &SDBlockDevice::_async_step);
+    }
+
+    _async_scheduled = (id != 0);
+    return _async_scheduled;
+}
+
+void SDBlockDevice::_end_write()
+{
+    if (!_async_writing) {
+        return;
+    }
+
+    // The card may still program the last block of the open write
+    _select();
+    if (false == _wait_ready(SD_COMMAND_TIMEOUT)) {
+        debug_if(SD_DBG, "Card not ready yet \n");
+    }
+    _spi.write(SPI_STOP_TRAN);
+    _deselect();
+    _async_writing = false;
+    _async_busy = true;
+}
+
+bool SDBlockDevice::_is_card_busy()
+{
+    uint8_t response[SD_BUSY_POLL_SIZE];
+
+    _select();
+    _spi.write(NULL, 0, (char *)response, sizeof(response));
+    _deselect();
+    return response[sizeof(response) - 1] != 0xFF;
+}
+
+bd_addr_t SDBlockDevice::_card_addr(bd_addr_t addr)
+{
+    // SDSC Card (CCS=0) uses byte unit address
+    // SDHC and SDXC Cards (CCS=1) use block unit address (512 Bytes unit)
+    return (SDCARD_V2HC == _card_type) ? addr / _block_size : addr;
+}
+
 int SDBlockDevice::_freq(void)
 {
     // Max frequency supported is 25MHZ
@@ -673,9 +950,7 @@ uint8_t SDBlockDevice::_cmd_spi(SDBlockDevice::cmdSupported cmd, uint32_t arg)
     }
 
     // send a command
-    for (int i = 0; i < PACKET_SIZE; i++) {
-        _spi.write(cmdPacket[i]);
-    }
+    _spi.write(cmdPacket, PACKET_SIZE, NULL, 0);
 
     // The received byte immediataly following CMD12 is a stuff byte,
     // it should be discarded before receive the response of the CMD12.
@@ -770,13 +1045,16 @@ int SDBlockDevice::_cmd(SDBlockDevice::cmdSupported cmd, uint32_t arg, bool isAc
             debug_if(_dbg, "V2-Version Card\n");
             _card_type = SDCARD_V2;
         // Note: No break here, need to read rest of the response
-        case CMD58_READ_OCR:                // Response R3
-            response  = (_spi.write(SPI_FILL_CHAR) << 24);
-            response |= (_spi.write(SPI_FILL_CHAR) << 16);
-            response |= (_spi.write(SPI_FILL_CHAR) << 8);
-            response |= _spi.write(SPI_FILL_CHAR);
+        case CMD58_READ_OCR: {              // Response R3
+            uint8_t r3_r7[R3_R7_RESPONSE_SIZE - R1_RESPONSE_SIZE];
+            _spi.write(NULL, 0, (char *)r3_r7, sizeof(r3_r7));
+            response  = (r3_r7[0] << 24);
+            response |= (r3_r7[1] << 16);
+            response |= (r3_r7[2] << 8);
+            response |= r3_r7[3];
             debug_if(_dbg, "R3/R7: 0x%x \n", response);
             break;
+        }
 
         case CMD12_STOP_TRANSMISSION:       // Response R1b
         case CMD38_ERASE:
@@ -851,104 +1129,161 @@ uint32_t SDBlockDevice::_go_idle_state()
 
 int SDBlockDevice::_read_bytes(uint8_t *buffer, uint32_t length)
 {
-    uint16_t crc;
+    int status = _read(buffer, length, 1);
+    _deselect();
+    return status;
+}
+
+int SDBlockDevice::_read(uint8_t *buffer, uint32_t length, bd_size_t count)
+{
+    uint8_t crc[2];
+    const uint8_t *check_buffer = NULL;
+    uint16_t check_crc = 0;
+    int status;
+
+    while (count--) {
+        // read until start byte (0xFE)
+        if (false == _wait_token(SPI_START_BLOCK)) {
+            debug_if(SD_DBG, "Read timeout\n");
+            return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+        }
 
-    // read until start byte (0xFE)
-    if (false == _wait_token(SPI_START_BLOCK)) {
-        debug_if(SD_DBG, "Read timeout\n");
-        _deselect();
-        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
-    }
+        // read data
+        _spi_transfer_start(NULL, buffer, length);
+
+        // Verify the previous block while this one is clocked in
+        if (check_buffer && (0 != (status = _check_crc16(check_buffer, length, check_crc)))) {
+            _spi_transfer_wait();
+            return status;
+        }
+
+        if (0 != (status = _spi_transfer_wait())) {
+            return status;
+        }
 
-    // read data
-    for (uint32_t i = 0; i < length; i++) {
-        buffer[i] = _spi.write(SPI_FILL_CHAR);
+        // Read the CRC16 checksum for the data block
+        _spi.write(NULL, 0, (char *)crc, sizeof(crc));
+        check_buffer = buffer;
+        check_crc = (crc[0] << 8) | crc[1];
+        buffer += length;
     }
 
-    // Read the CRC16 checksum for the data block
-    crc = (_spi.write(SPI_FILL_CHAR) << 8);
-    crc |= _spi.write(SPI_FILL_CHAR);
+    return check_buffer ? _check_crc16(check_buffer, length, check_crc) : 0;
+}
 
-    if (_crc_on) {
-        uint32_t crc_result;
-        // Compute and verify checksum
-        _crc16.compute((void *)buffer, length, &crc_result);
-        if ((uint16_t)crc_result != crc) {
-            debug_if(SD_DBG, "_read_bytes: Invalid CRC received 0x%x result of computation 0x%x\n",
-                     crc, crc_result);
-            _deselect();
-            return SD_BLOCK_DEVICE_ERROR_CRC;
+int SDBlockDevice::_write(const uint8_t *buffer, uint8_t token, bd_size_t count)
+{
+    uint32_t crc = _compute_crc16(buffer, _block_size);
+    int status;
+
+    while (count--) {
+        if (0 != (status = _write_block(buffer, token, crc))) {
+            return status;
+        }
+
+        // Compute the CRC of the next block while the card programs this one
+        buffer += _block_size;
+        if (count) {
+            crc = _compute_crc16(buffer, _block_size);
+        }
+
+        // Wait for last block to be written
+        if (false == _wait_ready(SD_COMMAND_TIMEOUT)) {
+            debug_if(SD_DBG, "Card not ready yet \n");
         }
     }
 
-    _deselect();
-    return 0;
+    return BD_ERROR_OK;
 }
 
-int SDBlockDevice::_read(uint8_t *buffer, uint32_t length)
+int SDBlockDevice::_write_block(const uint8_t *buffer, uint8_t token, uint32_t crc)
 {
-    uint16_t crc;
+    // indicate start of block
+    _spi.write(token);
 
-    // read until start byte (0xFE)
-    if (false == _wait_token(SPI_START_BLOCK)) {
-        debug_if(SD_DBG, "Read timeout\n");
-        _deselect();
-        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+    // write the data
+    _spi_transfer_start(buffer, NULL, _block_size);
+    int status = _spi_transfer_wait();
+    if (0 != status) {
+        return status;
     }
 
-    // read data
-    _spi.write(NULL, 0, (char *)buffer, length);
+    // write the checksum CRC16 and check the response token
+    char tail[3] = { (char)(crc >> 8), (char)crc, (char)SPI_FILL_CHAR };
+    uint8_t response[3];
+    _spi.write(tail, sizeof(tail), (char *)response, sizeof(response));
 
-    // Read the CRC16 checksum for the data block
-    crc = (_spi.write(SPI_FILL_CHAR) << 8);
-    crc |= _spi.write(SPI_FILL_CHAR);
+    // Only CRC and general write error are communicated via response token
+    if ((response[2] & SPI_DATA_RESPONSE_MASK) != SPI_DATA_ACCEPTED) {
+        debug_if(SD_DBG, "Block Write failed: 0x%x \n", response[2]);
+        return SD_BLOCK_DEVICE_ERROR_WRITE;
+    }
+
+    return BD_ERROR_OK;
+}
+
+uint32_t SDBlockDevice::_compute_crc16(const uint8_t *buffer, uint32_t length)
+{
+    uint32_t crc = (~0);
 
+    if (_crc_on) {
+        _crc16.compute((void *)buffer, length, &crc);
+    }
+    return crc;
+}
+
+int SDBlockDevice::_check_crc16(const uint8_t *buffer, uint32_t length, uint16_t crc)
+{
     if (_crc_on) {
         uint32_t crc_result;
         // Compute and verify checksum
         _crc16.compute((void *)buffer, length, &crc_result);
         if ((uint16_t)crc_result != crc) {
-            debug_if(SD_DBG, "_read_bytes: Invalid CRC received 0x%x result of computation 0x%x\n",
+            debug_if(SD_DBG, "_read: Invalid CRC received 0x%x result of computation 0x%x\n",
                      crc, crc_result);
             return SD_BLOCK_DEVICE_ERROR_CRC;
         }
     }
-
     return 0;
 }
 
-uint8_t SDBlockDevice::_write(const uint8_t *buffer, uint8_t token, uint32_t length)
+void SDBlockDevice::_spi_transfer_start(const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t length)
 {
-
-    uint32_t crc = (~0);
-    uint8_t response = 0xFF;
-
-    // indicate start of block
-    _spi.write(token);
-
-    // write the data
-    _spi.write((char *)buffer, length, NULL, 0);
-
-    if (_crc_on) {
-        // Compute CRC
-        _crc16.compute((void *)buffer, length, &crc);
+#if SD_ASYNC_TRANSFERS
+    // Clock the block in the background, completion is collected by _spi_transfer_wait()
+    _transfer_event = 0;
+    if (0 != _spi.transfer(tx_buffer, tx_buffer ? (int)length : 0, rx_buffer, rx_buffer ? (int)length : 0,
+                           mbed::callback(this, &SDBlockDevice::_spi_transfer_done), SPI_EVENT_ALL)) {
+        _transfer_event = SPI_EVENT_ERROR;
+        _transfer_done.release();
     }
+#else
+    // A single driver call for the whole block
+    _spi.write((const char *)tx_buffer, tx_buffer ? (int)length : 0, (char *)rx_buffer, rx_buffer ? (int)length : 0);
+#endif
+}
 
-    // write the checksum CRC16
-    _spi.write(crc >> 8);
-    _spi.write(crc);
-
-
-    // check the response token
-    response = _spi.write(SPI_FILL_CHAR);
+int SDBlockDevice::_spi_transfer_wait()
+{
+#if SD_ASYNC_TRANSFERS
+    // the thread sleeps until the completion callback
+    _transfer_done.wait();
 
-    // Wait for last block to be written
-    if (false == _wait_ready(SD_COMMAND_TIMEOUT)) {
-        debug_if(SD_DBG, "Card not ready yet \n");
+    if ((_transfer_event & SPI_EVENT_COMPLETE) == 0) {
+        debug_if(SD_DBG, "SPI transfer failed: 0x%x\n", _transfer_event);
+        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
     }
+#endif
+    return 0;
+}
 
-    return (response & SPI_DATA_RESPONSE_MASK);
+#if SD_ASYNC_TRANSFERS
+void SDBlockDevice::_spi_transfer_done(int event)
+{
+    _transfer_event = event;
+    _transfer_done.release();
 }
+#endif
 
 static uint32_t ext_bits(unsigned char *data, int msb, int lsb)
 {
@@ -1045,12 +1380,17 @@ bool SDBlockDevice::_wait_token(uint8_t token)
 // The host controller should wait for end of the process until DO goes high (a 0xFF is received).
 bool SDBlockDevice::_wait_ready(uint16_t ms)
 {
-    uint8_t response;
+    uint8_t response[SD_BUSY_POLL_SIZE];
+    if (_spi.write(SPI_FILL_CHAR) == 0xFF) {
+        return true;
+    }
+
+    // Busy: clock several bytes per poll, the card keeps DO high once it is ready
     _spi_timer.reset();
     _spi_timer.start();
     do {
-        response = _spi.write(SPI_FILL_CHAR);
-        if (response == 0xFF) {
+        _spi.write(NULL, 0, (char *)response, sizeof(response));
+        if (response[sizeof(response) - 1] == 0xFF) {
             _spi_timer.stop();
             return true;
         }
@@ -21,6 +21,8 @@
 #ifdef DEVICE_SPI
 
 #include "BlockDevice.h"
+#include "AsyncBlockDevice.h"
+#include "BlockDeviceRequestQueue.h"
 #include "drivers/SPI.h"
 #include "drivers/Timer.h"
 #include "drivers/MbedCRC.h"
@@ -28,11 +30,26 @@
 #include "platform/platform.h"
 #include "platform/PlatformMutex.h"
 
+// Data blocks are clocked with non-blocking SPI transfers when enabled
+#if DEVICE_SPI_ASYNCH && MBED_CONF_SD_SPI_ASYNC
+#define SD_ASYNC_TRANSFERS 1
+#else
+#define SD_ASYNC_TRANSFERS 0
+#endif
+
+#if SD_ASYNC_TRANSFERS
+#include "rtos/Semaphore.h"
+#endif
+
+namespace events {
+class EventQueue;
+}
+
 /** SDBlockDevice class
  *
  * Access an SD Card using SPI
  */
-class SDBlockDevice : public BlockDevice {
+class SDBlockDevice : public BlockDevice, public AsyncBlockDevice {
 public:
     /** Lifetime of an SD card
      */
@@ -116,6 +133,29 @@ public:
      */
     virtual int frequency(uint64_t freq);
 
+    /** Queue a request, served from an event queue
+     *
+     *  Each command and each block of a write is sent from an event, and the
+     *  card is then polled from timed events until it is ready for the next
+     *  one, so neither the caller nor the event queue waits for the card.
+     *  Merged reads and writes are served with a single multiple block command.
+     *
+     *  @param request  Request to queue, the device owns it until its callback is called
+     *  @return         0 on success, negative error code if the request is invalid
+     *                  or the device is not initialized
+     */
+    virtual int submit(bd_request_t *request);
+
+    /** Set the event queue requests are served from
+     *
+     *  Completion callbacks run on this queue. Requests are served from the
+     *  shared event queue, mbed_event_queue(), unless another one is set
+     *  before the first request is submitted.
+     *
+     *  @param queue    Event queue to serve requests from
+     */
+    void set_event_queue(events::EventQueue *queue);
+
 
 private:
     /* Commands : Listed below are commands supported
@@ -193,11 +233,35 @@ private:
 
     bool _wait_token(uint8_t token);        /**< Wait for token */
     bool _wait_ready(uint16_t ms = 300);    /**< 300ms default wait for card to be ready */
-    int _read(uint8_t *buffer, uint32_t length);
+    /* Read count data packets of length bytes, the CRC of each one is checked while the next is clocked in */
+    int _read(uint8_t *buffer, uint32_t length, bd_size_t count);
     int _read_bytes(uint8_t *buffer, uint32_t length);
-    uint8_t _write(const uint8_t *buffer, uint8_t token, uint32_t length);
+    /* Write count blocks, the CRC of each one is computed while the card programs the previous */
+    int _write(const uint8_t *buffer, uint8_t token, bd_size_t count);
+    /* Write a single block and check the data response, the card is busy programming it afterwards */
+    int _write_block(const uint8_t *buffer, uint8_t token, uint32_t crc);
+    uint32_t _compute_crc16(const uint8_t *buffer, uint32_t length);
+    int _check_crc16(const uint8_t *buffer, uint32_t length, uint16_t crc);
+
+    /* Clock a data block, in the background with non-blocking transfers */
+    void _spi_transfer_start(const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t length);
+    /* Wait for the block started by _spi_transfer_start() */
+    int _spi_transfer_wait();
+#if SD_ASYNC_TRANSFERS
+    void _spi_transfer_done(int event);
+    volatile int _transfer_event;           /**< Event of the last transfer */
+    rtos::Semaphore _transfer_done;         /**< Released when the last transfer completes */
+#endif
     int _freq(void);
 
+    /* Requests queued with submit() */
+    void _async_step();                     /**< Serve queued requests from the event queue, one step per call */
+    int _async_serve(bool &done);           /**< Serve a step of the current request, done is set once it completes */
+    bool _async_schedule(int ms);           /**< Call _async_step after ms milliseconds, false if the queue is full */
+    void _end_write();                      /**< Stop the multiple block write left open by a queued program */
+    bool _is_card_busy();                   /**< Poll the busy state of the card once */
+    bd_addr_t _card_addr(bd_addr_t addr);   /**< Address of a block in command arguments */
+
     /* Chip Select and SPI mode select */
     mbed::DigitalOut _cs;
     void _select();
@@ -223,6 +287,16 @@ private:
 
     mbed::MbedCRC<POLY_7BIT_SD, 7> _crc7;
     mbed::MbedCRC<POLY_16BIT_CCITT, 16> _crc16;
+
+    events::EventQueue *_async_queue;
+    BlockDeviceRequestQueue _async_requests;
+    bd_request_t *_async_request;           /**< Request being served, NULL when none */
+    bd_request_t *_async_segment;           /**< Merged request of the current one being served */
+    bd_addr_t _async_addr;                  /**< Address the current request continues at */
+    unsigned _async_polls;                  /**< Busy polls since the last step */
+    bool _async_scheduled;                  /**< An event of _async_step is posted */
+    bool _async_busy;                       /**< The card may be busy with a block or erase of a queued request */
+    bool _async_writing;                    /**< A multiple block write is open between steps */
 };
 
 #endif  /* DEVICE_SPI */
@@ -16,6 +16,7 @@
 
 #include "SPIFBlockDevice.h"
 #include "mbed_critical.h"
+#include "events/mbed_shared_queues.h"
 
 #include <string.h>
 #include "mbed_wait_api.h"
@@ -31,6 +32,8 @@ using namespace mbed;
 #define SPIF_DEFAULT_PAGE_SIZE  256
 #define SPIF_DEFAULT_SE_SIZE    4096
 #define SPI_MAX_STATUS_REGISTER_SIZE 2
+// Instruction (1 byte), Address (up to 4 bytes) and Dummy Cycles (up to 32 cycles)
+#define SPIF_MAX_COMMAND_HEADER_SIZE 9
 #ifndef UINT64_MAX
 #define UINT64_MAX -1
 #endif
@@ -102,7 +105,9 @@ static unsigned int local_math_power(int base, int exp);
 //***********************
 SPIFBlockDevice::SPIFBlockDevice(
     PinName mosi, PinName miso, PinName sclk, PinName csel, int freq)
-    : _spi(mosi, miso, sclk), _cs(csel), _device_size_bytes(0), _is_initialized(false), _init_ref_count(0)
+    : _spi(mosi, miso, sclk), _cs(csel), _device_size_bytes(0), _init_ref_count(0), _is_initialized(false),
+      _program_pending(false), _async_queue(NULL), _async_request(NULL), _async_segment(NULL), _async_addr(0),
+      _async_left(0), _async_region(0), _async_bitfield(0), _async_polls(0), _async_scheduled(false)
 {
     _address_size = SPIF_ADDR_SIZE_3_BYTES;
     // Initial SFDP read tables are read with 8 dummy cycles
@@ -239,10 +244,16 @@ int SPIFBlockDevice::deinit()
         goto exit_point;
     }
 
-    // Disable Device for Writing
-    status = _spi_send_general_command(SPIF_WRDI, SPI_NO_ADDRESS_COMMAND, NULL, 0, NULL, 0);
+    // Let the last page program complete before disabling writes
+    status = _wait_for_pending_program();
     if (status != SPIF_BD_ERROR_OK)  {
+        tr_error("ERROR: Device not ready after write");
+    }
+
+    // Disable Device for Writing
+    if (_spi_send_general_command(SPIF_WRDI, SPI_NO_ADDRESS_COMMAND, NULL, 0, NULL, 0) != SPIF_BD_ERROR_OK)  {
         tr_error("ERROR: Write Disable failed");
+        status = SPIF_BD_ERROR_DEVICE_ERROR;
     }
     _is_initialized = false;
 
@@ -262,6 +273,12 @@ int SPIFBlockDevice::read(void *buffer, bd_addr_t addr, bd_size_t size)
     tr_info("INFO Read - Inst: 0x%xh", _read_instruction);
     _mutex->lock();
 
+    status = _wait_for_pending_program();
+    if (status != SPIF_BD_ERROR_OK) {
+        _mutex->unlock();
+        return status;
+    }
+
     // Set Dummy Cycles for Specific Read Command Mode
     _dummy_and_mode_cycles = _read_dummy_and_mode_cycles;
 
@@ -274,6 +291,19 @@ int SPIFBlockDevice::read(void *buffer, bd_addr_t addr, bd_size_t size)
     return status;
 }
 
+int SPIFBlockDevice::sync()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _mutex->lock();
+    int status = _wait_for_pending_program();
+    _mutex->unlock();
+
+    return status;
+}
+
 int SPIFBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size)
 {
     if (!_is_initialized) {
@@ -295,6 +325,14 @@ int SPIFBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size)
 
         _mutex->lock();
 
+        // The previous page must be written before the device accepts a new Write Enable
+        if (_wait_for_pending_program() != SPIF_BD_ERROR_OK) {
+            tr_error("ERROR: Device not ready after write, failed\n");
+            program_failed = true;
+            status = SPIF_BD_ERROR_READY_FAILED;
+            goto exit_point;
+        }
+
         //Send WREN
         if (_set_write_enable() != 0) {
             tr_error("ERROR: Write Enabe failed\n");
@@ -303,18 +341,21 @@ int SPIFBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size)
             goto exit_point;
         }
 
-        _spi_send_program_command(_prog_instruction, buffer, addr, chunk);
+        if (_spi_send_program_command(_prog_instruction, buffer, addr, chunk) != SPIF_BD_ERROR_OK) {
+            tr_error("ERROR: Page program failed\n");
+            program_failed = true;
+            status = SPIF_BD_ERROR_DEVICE_ERROR;
+            goto exit_point;
+        }
+
+        // Completion is polled before the next command, which lets the
+        // caller prepare the next page while this one is being written
+        _program_pending = true;
 
         buffer = static_cast<const uint8_t *>(buffer) + chunk;
         addr += chunk;
         size -= chunk;
 
-        if ( false == _is_mem_ready()) {
-            tr_error("ERROR: Device not ready after write, failed\n");
-            program_failed = true;
-            status = SPIF_BD_ERROR_READY_FAILED;
-            goto exit_point;
-        }
         _mutex->unlock();
     }
 
@@ -332,10 +373,6 @@ int SPIFBlockDevice::erase(bd_addr_t addr, bd_size_t in_size)
         return BD_ERROR_DEVICE_ERROR;
     }
 
-    int type = 0;
-    uint32_t offset = 0;
-    uint32_t chunk = 4096;
-    int cur_erase_inst = _erase_instruction;
     int size = (int)in_size;
     bool erase_failed = false;
     int status = SPIF_BD_ERROR_OK;
@@ -346,49 +383,27 @@ int SPIFBlockDevice::erase(bd_addr_t addr, bd_size_t in_size)
 
     tr_info("DEBUG: erase - addr: %llu, in_size: %llu", addr, in_size);
 
-    if ((addr + in_size) > _device_size_bytes) {
-        tr_error("ERROR: erase exceeds flash device size");
-        return SPIF_BD_ERROR_INVALID_ERASE_PARAMS;
-    }
-
-    if ( ((addr % get_erase_size(addr)) != 0 ) ||  (((addr + in_size) % get_erase_size(addr + in_size - 1)) != 0 ) ) {
-        tr_error("ERROR: invalid erase - unaligned address and size");
-        return SPIF_BD_ERROR_INVALID_ERASE_PARAMS;
+    status = _check_erase_range(addr, in_size);
+    if (status != SPIF_BD_ERROR_OK) {
+        return status;
     }
 
     // For each iteration erase the largest section supported by current region
     while (size > 0) {
 
-        // iterate to find next Largest erase type ( a. supported by region, b. smaller than size)
-        // find the matching instruction and erase size chunk for that type.
-        type = _utils_iterate_next_largest_erase_type(bitfield, size, (unsigned int)addr, _region_high_boundary[region]);
-        cur_erase_inst = _erase_type_inst_arr[type];
-        offset = addr % _erase_type_size_arr[type];
-        chunk = ( (offset + size) < _erase_type_size_arr[type]) ? size : (_erase_type_size_arr[type] - offset);
-
-        tr_debug("DEBUG: erase - addr: %llu, size:%d, Inst: 0x%xh, chunk: %lu , ",
-                 addr, size, cur_erase_inst, chunk);
-        tr_debug("DEBUG: erase - Region: %d, Type:%d",
-                 region, type);
-
         _mutex->lock();
 
-        if (_set_write_enable() != 0) {
+        if (_wait_for_pending_program() != SPIF_BD_ERROR_OK) {
             tr_error("ERROR: SPI Erase Device not ready - failed");
             erase_failed = true;
             status = SPIF_BD_ERROR_READY_FAILED;
             goto exit_point;
         }
 
-        _spi_send_erase_command(cur_erase_inst, addr, size);
-
-        addr += chunk;
-        size -= chunk;
-
-        if ( (size > 0) && (addr > _region_high_boundary[region]) ) {
-            // erase crossed to next region
-            region++;
-            bitfield = _region_erase_types_bitfield[region];
+        status = _send_next_erase(addr, size, region, bitfield);
+        if (status != SPIF_BD_ERROR_OK) {
+            erase_failed = true;
+            goto exit_point;
         }
 
         if ( false == _is_mem_ready()) {
@@ -472,117 +487,323 @@ int SPIFBlockDevice::get_erase_value() const
     return 0xFF;
 }
 
-/***************************************************/
-/*********** SPI Driver API Functions **************/
-/***************************************************/
-spif_bd_error SPIFBlockDevice::_spi_set_frequency(int freq)
+/*********************************/
+/* Requests queued with submit() */
+/*********************************/
+void SPIFBlockDevice::set_event_queue(events::EventQueue *queue)
 {
-    _spi.frequency(freq);
+    _mutex->lock();
+    _async_queue = queue;
+    _mutex->unlock();
+}
+
+int SPIFBlockDevice::submit(bd_request_t *request)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    int status = SPIF_BD_ERROR_OK;
+    switch (request->type) {
+        case BD_REQUEST_READ:
+        case BD_REQUEST_PROGRAM:
+            if (!request->buffer || request->addr + request->size > _device_size_bytes) {
+                status = SPIF_BD_ERROR_DEVICE_ERROR;
+            }
+            break;
+        case BD_REQUEST_ERASE:
+        case BD_REQUEST_TRIM:
+            status = _check_erase_range(request->addr, request->size);
+            break;
+        case BD_REQUEST_SYNC:
+            break;
+        default:
+            status = SPIF_BD_ERROR_DEVICE_ERROR;
+            break;
+    }
+    if (status != SPIF_BD_ERROR_OK) {
+        return status;
+    }
+
+    _mutex->lock();
+    if (!_async_queue) {
+        _async_queue = mbed_event_queue();
+    }
+    if (!_async_scheduled && !_async_schedule(0)) {
+        _mutex->unlock();
+        return SPIF_BD_ERROR_DEVICE_ERROR;
+    }
+    _async_requests.push(request);
+    _mutex->unlock();
+
     return SPIF_BD_ERROR_OK;
 }
 
-spif_bd_error SPIFBlockDevice::_spi_send_read_command(int read_inst, uint8_t *buffer, bd_addr_t addr, bd_size_t size)
+void SPIFBlockDevice::_async_step()
 {
-    uint32_t dummy_bytes = _dummy_and_mode_cycles / 8;
-    int dummy_byte = 0;
+    int status = SPIF_BD_ERROR_OK;
+    bool done = false;
 
-    // csel must go low for the entire command (Inst, Address and Data)
-    _cs = 0;
+    _mutex->lock();
 
-    // Write 1 byte Instruction
-    _spi.write(read_inst);
+    if (!_async_request) {
+        _async_request = _async_requests.pop();
+        if (!_async_request) {
+            _async_scheduled = false;
+            _mutex->unlock();
+            return;
+        }
 
-    // Write Address (can be either 3 or 4 bytes long)
-    for (int address_shift = ((_address_size - 1) * 8); address_shift >= 0; address_shift -= 8) {
-        _spi.write((addr >> address_shift) & 0xFF);
+        _async_segment = _async_request;
+        _async_addr = _async_request->addr;
+        _async_left = _async_request->span;
+        _async_polls = 0;
+        if (_async_request->type == BD_REQUEST_ERASE) {
+            _async_region = _utils_find_addr_region(_async_addr);
+            _async_bitfield = _region_erase_types_bitfield[_async_region];
+        }
     }
 
-    // Write Dummy Cycles Bytes
-    for (uint32_t i = 0; i < dummy_bytes; i++) {
-        _spi.write(dummy_byte);
+    if (!_is_initialized) {
+        status = SPIF_BD_ERROR_DEVICE_ERROR;
+        done = true;
+    } else if (_program_pending && _is_mem_busy()) {
+        // Poll again later instead of waiting for the device
+        if (++_async_polls < IS_MEM_READY_MAX_RETRIES && _async_schedule(1)) {
+            _mutex->unlock();
+            return;
+        }
+        tr_error("ERROR: Device not ready after write, failed\n");
+        status = SPIF_BD_ERROR_READY_FAILED;
+        done = true;
+    } else {
+        _program_pending = false;
+        _async_polls = 0;
+        status = _async_serve(done);
+        if (status != SPIF_BD_ERROR_OK) {
+            done = true;
+        }
     }
 
-    // Read Data
-    for (bd_size_t i = 0; i < size; i++) {
-        buffer[i] = _spi.write(0);
+    // Carry on with this request or the next one
+    bd_request_t *request = _async_request;
+    if (!_async_schedule(0) && !done) {
+        status = SPIF_BD_ERROR_DEVICE_ERROR;
+        done = true;
+    }
+    if (done) {
+        _async_request = NULL;
     }
 
-    // csel back to high
-    _cs = 1;
-    return SPIF_BD_ERROR_OK;
+    _mutex->unlock();
+
+    if (done) {
+        BlockDeviceRequestQueue::complete(request, status);
+    }
 }
 
-spif_bd_error SPIFBlockDevice::_spi_send_program_command(int prog_inst, const void *buffer, bd_addr_t addr,
-        bd_size_t size)
+int SPIFBlockDevice::_async_serve(bool &done)
 {
-    // Send Program (write) command to device driver
-    uint32_t dummy_bytes = _dummy_and_mode_cycles / 8;
-    int dummy_byte = 0;
-    uint8_t *data = (uint8_t *)buffer;
+    spif_bd_error status = SPIF_BD_ERROR_OK;
 
-    // csel must go low for the entire command (Inst, Address and Data)
-    _cs = 0;
+    switch (_async_request->type) {
+        case BD_REQUEST_READ:
+            // Merged requests follow each other on the device, a single command reads them all
+            _dummy_and_mode_cycles = _read_dummy_and_mode_cycles;
+            _spi_send_command_header(_read_instruction, _async_addr);
+            for (bd_request_t *segment = _async_request; segment && status == SPIF_BD_ERROR_OK; segment = segment->merged) {
+                status = _spi_transfer_data(NULL, static_cast<uint8_t *>(segment->buffer), segment->size,
+                                            segment->merged == NULL);
+            }
+            _cs = 1;
+            _dummy_and_mode_cycles = _write_dummy_and_mode_cycles;
+            done = true;
+            break;
 
-    // Write 1 byte Instruction
-    _spi.write(prog_inst);
+        case BD_REQUEST_PROGRAM: {
+            // A page per step, on _page_size_bytes boundaries
+            bd_size_t offset = _async_addr - _async_segment->addr;
+            bd_size_t chunk = _page_size_bytes - (_async_addr % _page_size_bytes);
+            if (chunk > _async_segment->size - offset) {
+                chunk = _async_segment->size - offset;
+            }
 
-    // Write Address (can be either 3 or 4 bytes long)
-    for (int address_shift = ((_address_size - 1) * 8); address_shift >= 0; address_shift -= 8) {
-        _spi.write((addr >> address_shift) & 0xFF);
-    }
+            if (chunk) {
+                if (_set_write_enable() != 0) {
+                    tr_error("ERROR: Write Enabe failed\n");
+                    return SPIF_BD_ERROR_WREN_FAILED;
+                }
 
-    // Write Dummy Cycles Bytes
-    for (uint32_t i = 0; i < dummy_bytes; i++) {
-        _spi.write(dummy_byte);
-    }
+                if (_spi_send_program_command(_prog_instruction, static_cast<uint8_t *>(_async_segment->buffer) + offset,
+                                              _async_addr, chunk) != SPIF_BD_ERROR_OK) {
+                    tr_error("ERROR: Page program failed\n");
+                    return SPIF_BD_ERROR_DEVICE_ERROR;
+                }
+                _program_pending = true;
+                _async_addr += chunk;
+            }
 
-    // Write Data
-    for (bd_size_t i = 0; i < size; i++) {
-        _spi.write(data[i]);
+            // Like program(), completes once the last page was sent
+            while (_async_segment && _async_addr == _async_segment->addr + _async_segment->size) {
+                _async_segment = _async_segment->merged;
+            }
+            done = (_async_segment == NULL);
+            break;
+        }
+
+        case BD_REQUEST_ERASE: {
+            // Like erase(), completes once the device is ready after the last erase
+            if (_async_left == 0) {
+                done = true;
+                break;
+            }
+
+            int size = (int)_async_left;
+            status = _send_next_erase(_async_addr, size, _async_region, _async_bitfield);
+            _async_left = size;
+            _program_pending = true;
+            break;
+        }
+
+        case BD_REQUEST_TRIM:
+        case BD_REQUEST_SYNC:
+            done = true;
+            break;
     }
 
-    // csel back to high
-    _cs = 1;
+    return status;
+}
 
-    return SPIF_BD_ERROR_OK;
+bool SPIFBlockDevice::_async_schedule(int ms)
+{
+    int id;
+    if (ms) {
+        id = _async_queue->call_in(ms, this, &SPIFBlockDevice::_async_step);
+    } else {
+        id = _async_queue->call(this, &SPIFBlockDevice::_async_step);
+    }
+
+    _async_scheduled = (id != 0);
+    return _async_scheduled;
 }
 
-spif_bd_error SPIFBlockDevice::_spi_send_erase_command(int erase_inst, bd_addr_t addr, bd_size_t size)
+/***************************************************/
+/*********** SPI Driver API Functions **************/
+/***************************************************/
+spif_bd_error SPIFBlockDevice::_spi_set_frequency(int freq)
 {
-    tr_info("INFO: Erase Inst: 0x%xh, addr: %llu, size: %llu", erase_inst, addr, size);
-    addr = (((int)addr) & 0x00FFF000);
-    _spi_send_general_command(erase_inst, addr, NULL, 0, NULL, 0);
+    _spi.frequency(freq);
     return SPIF_BD_ERROR_OK;
 }
 
-spif_bd_error SPIFBlockDevice::_spi_send_general_command(int instruction, bd_addr_t addr, char *tx_buffer,
-        size_t tx_length, char *rx_buffer, size_t rx_length)
+void SPIFBlockDevice::_spi_send_command_header(int instruction, bd_addr_t addr)
 {
-    // Send a general command Instruction to driver
+    char header[SPIF_MAX_COMMAND_HEADER_SIZE];
     uint32_t dummy_bytes = _dummy_and_mode_cycles / 8;
-    uint8_t dummy_byte = 0x00;
-
-    // csel must go low for the entire command (Inst, Address and Data)
-    _cs = 0;
+    int header_size = 0;
 
     // Write 1 byte Instruction
-    _spi.write(instruction);
+    header[header_size++] = instruction;
 
     // Reading SPI Bus registers does not require Flash Address
     if (addr != SPI_NO_ADDRESS_COMMAND) {
         // Write Address (can be either 3 or 4 bytes long)
         for (int address_shift = ((_address_size - 1) * 8); address_shift >= 0; address_shift -= 8) {
-            _spi.write((addr >> address_shift) & 0xFF);
+            header[header_size++] = (addr >> address_shift) & 0xFF;
         }
 
         // Write Dummy Cycles Bytes
         for (uint32_t i = 0; i < dummy_bytes; i++) {
-            _spi.write(dummy_byte);
+            header[header_size++] = 0x00;
         }
     }
 
+    // csel must go low for the entire command (Inst, Address and Data)
+    _cs = 0;
+
+    _spi.write(header, header_size, NULL, 0);
+}
+
+spif_bd_error SPIFBlockDevice::_spi_transfer_data(const uint8_t *tx_buffer, uint8_t *rx_buffer, bd_size_t size,
+        bool deselect)
+{
+#if SPIF_ASYNC_TRANSFERS
+    // Clock the data phase in the background, csel is released by the completion callback
+    _transfer_event = 0;
+    _transfer_deselect = deselect;
+    if (0 != _spi.transfer(tx_buffer, tx_buffer ? (int)size : 0, rx_buffer, rx_buffer ? (int)size : 0,
+                           callback(this, &SPIFBlockDevice::_spi_transfer_done), SPI_EVENT_ALL)) {
+        _cs = 1;
+        return SPIF_BD_ERROR_DEVICE_ERROR;
+    }
+
+    // the thread sleeps until the completion callback
+    _transfer_done.wait();
+
+    if ((_transfer_event & SPI_EVENT_COMPLETE) == 0) {
+        return SPIF_BD_ERROR_DEVICE_ERROR;
+    }
+#else
+    // A single driver call for the whole data phase
+    _spi.write((const char *)tx_buffer, tx_buffer ? (int)size : 0, (char *)rx_buffer, rx_buffer ? (int)size : 0);
+
+    // csel back to high
+    if (deselect) {
+        _cs = 1;
+    }
+#endif
+
+    return SPIF_BD_ERROR_OK;
+}
+
+#if SPIF_ASYNC_TRANSFERS
+void SPIFBlockDevice::_spi_transfer_done(int event)
+{
+    // csel back to high
+    if (_transfer_deselect) {
+        _cs = 1;
+    }
+    _transfer_event = event;
+    _transfer_done.release();
+}
+#endif
+
+spif_bd_error SPIFBlockDevice::_spi_send_read_command(int read_inst, uint8_t *buffer, bd_addr_t addr, bd_size_t size)
+{
+    _spi_send_command_header(read_inst, addr);
+
+    // Read Data
+    return _spi_transfer_data(NULL, buffer, size);
+}
+
+spif_bd_error SPIFBlockDevice::_spi_send_program_command(int prog_inst, const void *buffer, bd_addr_t addr,
+        bd_size_t size)
+{
+    // Send Program (write) command to device driver
+    _spi_send_command_header(prog_inst, addr);
+
+    // Write Data
+    return _spi_transfer_data(static_cast<const uint8_t *>(buffer), NULL, size);
+}
+
+spif_bd_error SPIFBlockDevice::_spi_send_erase_command(int erase_inst, bd_addr_t addr, bd_size_t size)
+{
+    tr_info("INFO: Erase Inst: 0x%xh, addr: %llu, size: %llu", erase_inst, addr, size);
+    addr = (((int)addr) & 0x00FFF000);
+    _spi_send_general_command(erase_inst, addr, NULL, 0, NULL, 0);
+    return SPIF_BD_ERROR_OK;
+}
+
+spif_bd_error SPIFBlockDevice::_spi_send_general_command(int instruction, bd_addr_t addr, char *tx_buffer,
+        size_t tx_length, char *rx_buffer, size_t rx_length)
+{
+    // Send a general command Instruction to driver
+    _spi_send_command_header(instruction, addr);
+
     // Read/Write Data
-    _spi.write(tx_buffer, (int)tx_length, rx_buffer, (int)rx_length);
+    if (tx_length != 0 || rx_length != 0) {
+        _spi.write(tx_buffer, (int)tx_length, rx_buffer, (int)rx_length);
+    }
 
     // csel back to high
     _cs = 1;
@@ -602,6 +823,10 @@ int SPIFBlockDevice::_sfdp_parse_sector_map_table(uint32_t sector_map_table_addr
     // Default set to all type bits 1-4 are common
     int min_common_erase_type_bits = ERASE_BITMASK_ALL;
 
+    if (sector_map_table_size > sizeof(sector_map_table)) {
+        tr_error("ERROR: Sector Map - Table of %d bytes is not supported", sector_map_table_size);
+        return -1;
+    }
 
     spif_bd_error status = _spi_send_read_command(SPIF_SFDP, sector_map_table, sector_map_table_addr /*address*/,
                            sector_map_table_size);
@@ -611,13 +836,13 @@ int SPIFBlockDevice::_sfdp_parse_sector_map_table(uint32_t sector_map_table_addr
     }
 
     // Currently we support only Single Map Descriptor
-    if (! ( (sector_map_table[0] & 0x3) == 0x03 ) && (sector_map_table[1]  == 0x0) ) {
+    if (!((sector_map_table[0] & 0x3) == 0x03) || (sector_map_table[1] != 0x0)) {
         tr_error("ERROR: Sector Map - Supporting Only Single! Map Descriptor (not map commands)");
         return -1;
     }
 
     _regions_count = sector_map_table[2] + 1;
-    if (_regions_count > SPIF_MAX_REGIONS) {
+    if (_regions_count > SPIF_MAX_REGIONS || (size_t)((_regions_count + 1) * 4) > sector_map_table_size) {
         tr_error("ERROR: Supporting up to %d regions, current setup to %d regions - fail",
                  SPIF_MAX_REGIONS, _regions_count);
         return -1;
@@ -756,7 +981,7 @@ int SPIFBlockDevice::_sfdp_parse_sfdp_headers(uint32_t& basic_table_addr, size_t
             // Supporting up to 64 Bytes Table (16 DWORDS)
             basic_table_size = ((param_header[3] * 4) < SFDP_DEFAULT_BASIC_PARAMS_TABLE_SIZE_BYTES) ? (param_header[3] * 4) : 64;
 
-        } else if ((param_header[0] == 81) && (param_header[7] == 0xFF)) {
+        } else if ((param_header[0] == 0x81) && (param_header[7] == 0xFF)) {
             // Found Sector Map Table: LSB=0x81, MSB=0xFF
             tr_debug("DEBUG: Found Sector Map Table at Table: %d", i_ind + 1);
             sector_map_table_addr = ( (param_header[6] << 16) | (param_header[5] << 8) | (param_header[4]) );
@@ -916,6 +1141,8 @@ int SPIFBlockDevice::_reset_flash_mem()
                 tr_error("ERROR: Sending RST failed\n");
                 status = -1;
             }
+            // Give the device its reset recovery time before polling the status register
+            wait_ms(1);
             _is_mem_ready();
         }
     }
@@ -931,8 +1158,10 @@ bool SPIFBlockDevice::_is_mem_ready()
     bool mem_ready = true;
 
     do {
-        wait_ms(1);
-        retries++;
+        if (retries++) {
+            // Only sleep when the device is actually busy, most commands complete well within a poll
+            wait_ms(1);
+        }
         //Read the Status Register from device
         if (SPIF_BD_ERROR_OK != _spi_send_general_command(SPIF_RDSR, SPI_NO_ADDRESS_COMMAND, NULL, 0, status_value,
                 1)) {   // store received values in status_value
@@ -947,6 +1176,78 @@ bool SPIFBlockDevice::_is_mem_ready()
     return mem_ready;
 }
 
+spif_bd_error SPIFBlockDevice::_wait_for_pending_program()
+{
+    if (!_program_pending) {
+        return SPIF_BD_ERROR_OK;
+    }
+
+    _program_pending = false;
+    if (false == _is_mem_ready()) {
+        tr_error("ERROR: Device not ready after write, failed\n");
+        return SPIF_BD_ERROR_READY_FAILED;
+    }
+    return SPIF_BD_ERROR_OK;
+}
+
+bool SPIFBlockDevice::_is_mem_busy()
+{
+    char status_value[2] = { 0 };
+
+    if (SPIF_BD_ERROR_OK != _spi_send_general_command(SPIF_RDSR, SPI_NO_ADDRESS_COMMAND, NULL, 0, status_value, 1)) {
+        tr_error("ERROR: Reading Status Register failed\n");
+    }
+    return (status_value[0] & SPIF_STATUS_BIT_WIP) != 0;
+}
+
+spif_bd_error SPIFBlockDevice::_check_erase_range(bd_addr_t addr, bd_size_t size)
+{
+    if ((addr + size) > _device_size_bytes) {
+        tr_error("ERROR: erase exceeds flash device size");
+        return SPIF_BD_ERROR_INVALID_ERASE_PARAMS;
+    }
+
+    if ( ((addr % get_erase_size(addr)) != 0 ) ||  (((addr + size) % get_erase_size(addr + size - 1)) != 0 ) ) {
+        tr_error("ERROR: invalid erase - unaligned address and size");
+        return SPIF_BD_ERROR_INVALID_ERASE_PARAMS;
+    }
+
+    return SPIF_BD_ERROR_OK;
+}
+
+spif_bd_error SPIFBlockDevice::_send_next_erase(bd_addr_t &addr, int &size, int &region, uint8_t &bitfield)
+{
+    // iterate to find next Largest erase type ( a. supported by region, b. smaller than size)
+    // find the matching instruction and erase size chunk for that type.
+    int type = _utils_iterate_next_largest_erase_type(bitfield, size, (unsigned int)addr, _region_high_boundary[region]);
+    int cur_erase_inst = _erase_type_inst_arr[type];
+    uint32_t offset = addr % _erase_type_size_arr[type];
+    uint32_t chunk = ( (offset + size) < _erase_type_size_arr[type]) ? size : (_erase_type_size_arr[type] - offset);
+
+    tr_debug("DEBUG: erase - addr: %llu, size:%d, Inst: 0x%xh, chunk: %lu , ",
+             addr, size, cur_erase_inst, chunk);
+    tr_debug("DEBUG: erase - Region: %d, Type:%d",
+             region, type);
+
+    if (_set_write_enable() != 0) {
+        tr_error("ERROR: SPI Erase Device not ready - failed");
+        return SPIF_BD_ERROR_READY_FAILED;
+    }
+
+    _spi_send_erase_command(cur_erase_inst, addr, size);
+
+    addr += chunk;
+    size -= chunk;
+
+    if ( (size > 0) && (addr > _region_high_boundary[region]) ) {
+        // erase crossed to next region
+        region++;
+        bitfield = _region_erase_types_bitfield[region];
+    }
+
+    return SPIF_BD_ERROR_OK;
+}
+
 int SPIFBlockDevice::_set_write_enable()
 {
     // Check Status Register Busy Bit to Verify the Device isn't Busy
@@ -1000,7 +1301,7 @@ int SPIFBlockDevice::_utils_find_addr_region(bd_size_t offset)
             return (i_ind + 1);
         }
     }
-    return -1;
+    return 0;
 
 }
 
@@ -1014,10 +1315,11 @@ int SPIFBlockDevice::_utils_iterate_next_largest_erase_type(uint8_t& bitfield, i
     for (i_ind = 3; i_ind >= 0; i_ind--) {
         if (bitfield & type_mask) {
             largest_erase_type = i_ind;
-            if ( (size > (int)(_erase_type_size_arr[largest_erase_type])) &&
-                    ((boundry - offset) > (int)(_erase_type_size_arr[largest_erase_type])) ) {
+            int type_size = (int)_erase_type_size_arr[largest_erase_type];
+            if ( (size >= type_size) && ((boundry - offset + 1) >= type_size) && (offset % type_size == 0) ) {
                 break;
-            } else {
+            } else if (size < type_size) {
+                // The rest of the erase only gets smaller
                 bitfield &= ~type_mask;
             }
         }
@@ -19,6 +19,10 @@
 #include "SPI.h"
 #include "DigitalOut.h"
 #include "BlockDevice.h"
+#include "AsyncBlockDevice.h"
+#include "BlockDeviceRequestQueue.h"
+#include "events/EventQueue.h"
+#include "rtos/Semaphore.h"
 
 /** Enum spif standard error codes
  *
@@ -37,6 +41,13 @@ enum spif_bd_error {
 #define SPIF_MAX_REGIONS	10
 #define MAX_NUM_OF_ERASE_TYPES 4
 
+// Data phase of read and program commands uses non-blocking SPI transfers when enabled
+#if DEVICE_SPI_ASYNCH && MBED_CONF_SPIF_DRIVER_SPI_ASYNC
+#define SPIF_ASYNC_TRANSFERS 1
+#else
+#define SPIF_ASYNC_TRANSFERS 0
+#endif
+
 /** BlockDevice for SFDP based flash devices over SPI bus
  *
  *  @code
@@ -72,7 +83,7 @@ enum spif_bd_error {
  *  }
  *  @endcode
  */
-class SPIFBlockDevice : public BlockDevice {
+class SPIFBlockDevice : public BlockDevice, public AsyncBlockDevice {
 public:
     /** Creates a SPIFBlockDevice on a SPI bus specified by pins
      *
@@ -113,10 +124,22 @@ public:
      */
     virtual int read(void *buffer, bd_addr_t addr, bd_size_t size);
 
+    /** Ensure data on storage is in sync with the driver
+     *
+     *  Waits for the page program started by the last call to program()
+     *
+     *  @return         SPIF_BD_ERROR_OK(0) - success
+     *                  SPIF_BD_ERROR_READY_FAILED - Waiting for Memory ready failed or timed out
+     */
+    virtual int sync();
+
     /** Program blocks to a block device
      *
      *  The blocks must have been erased prior to being programmed
      *
+     *  Returns as soon as the last page has been sent to the device, the
+     *  device is polled for completion by the next command or by sync()
+     *
      *  @param buffer   Buffer of data to write to blocks
      *  @param addr     Address of block to begin writing to
      *  @param size     Size to write in bytes, must be a multiple of program block size
@@ -186,6 +209,30 @@ public:
      */
     virtual bd_size_t size() const;
 
+    /** Queue a request, served from an event queue
+     *
+     *  Each page program and erase is started from an event, and the device
+     *  is then polled from timed events until it is ready for the next one,
+     *  so neither the caller nor the event queue waits for the flash. Merged
+     *  reads are served with a single read command.
+     *
+     *  @param request  Request to queue, the device owns it until its callback is called
+     *  @return         SPIF_BD_ERROR_OK(0) - request queued
+     *                  SPIF_BD_ERROR_DEVICE_ERROR - device not initialized or invalid request
+     *                  SPIF_BD_ERROR_INVALID_ERASE_PARAMS - Trying to erase unaligned address or size
+     */
+    virtual int submit(bd_request_t *request);
+
+    /** Set the event queue requests are served from
+     *
+     *  Completion callbacks run on this queue. Requests are served from the
+     *  shared event queue, mbed_event_queue(), unless another one is set
+     *  before the first request is submitted.
+     *
+     *  @param queue    Event queue to serve requests from
+     */
+    void set_event_queue(events::EventQueue *queue);
+
 private:
 
     // Internal functions
@@ -227,6 +274,19 @@ private:
     /********************************/
     /*   Calls to SPI Driver APIs   */
     /********************************/
+    // Send Instruction, Address and Dummy Cycles Bytes in a single transfer, leaves csel low
+    void _spi_send_command_header(int instruction, bd_addr_t addr);
+
+    // Clock the data phase of a command, either blocking or through a non-blocking transfer,
+    // csel stays low after it unless deselect is set
+    spif_bd_error _spi_transfer_data(const uint8_t *tx_buffer, uint8_t *rx_buffer, bd_size_t size,
+                                     bool deselect = true);
+
+#if SPIF_ASYNC_TRANSFERS
+    // Non-blocking transfer completion, ends the command
+    void _spi_transfer_done(int event);
+#endif
+
     // Send Program => Write command to Driver
     spif_bd_error _spi_send_program_command(int prog_inst, const void *buffer, bd_addr_t addr, bd_size_t size);
 
@@ -254,6 +314,30 @@ private:
     // Wait on status register until write not-in-progress
     bool _is_mem_ready();
 
+    // Wait for the completion of the last page program, if any
+    spif_bd_error _wait_for_pending_program();
+
+    // Read the Status Register once, true if a write or erase is in progress
+    bool _is_mem_busy();
+
+    // Send Write Enable and the erase command for the largest erase type that fits at addr, and move past it
+    spif_bd_error _send_next_erase(bd_addr_t &addr, int &size, int &region, uint8_t &bitfield);
+
+    // Check the address range of an erase
+    spif_bd_error _check_erase_range(bd_addr_t addr, bd_size_t size);
+
+    /*********************************/
+    /* Requests queued with submit() */
+    /*********************************/
+    // Serve queued requests from the event queue, one command per call
+    void _async_step();
+
+    // Serve a step of the current request, done is set once it completes
+    int _async_serve(bool &done);
+
+    // Call _async_step from the event queue after ms milliseconds, false if the queue is full
+    bool _async_schedule(int ms);
+
 private:
     // Master side hardware
     mbed::SPI _spi;
@@ -292,6 +376,32 @@ private:
     unsigned int _dummy_and_mode_cycles; // Number of Dummy and Mode Bits required by Current Bus Mode
     uint32_t _init_ref_count;
     bool _is_initialized;
+
+    // A page program or erase was sent and the device was not yet polled for its completion
+    bool _program_pending;
+
+    // Requests queued with submit()
+    events::EventQueue *_async_queue;
+    BlockDeviceRequestQueue _async_requests;
+    // Request being served and its merged request being served, NULL when none
+    bd_request_t *_async_request;
+    bd_request_t *_async_segment;
+    // Progress of the current request: address and bytes left, erase region
+    bd_addr_t _async_addr;
+    bd_size_t _async_left;
+    int _async_region;
+    uint8_t _async_bitfield;
+    unsigned _async_polls;
+    // An event of _async_step is posted
+    bool _async_scheduled;
+
+#if SPIF_ASYNC_TRANSFERS
+    // Event of the last non-blocking transfer, released to the waiting thread
+    volatile int _transfer_event;
+    rtos::Semaphore _transfer_done;
+    // csel is released when the transfer completes
+    bool _transfer_deselect;
+#endif
 };
 
 #endif  /* MBED_SPIF_BLOCK_DEVICE_H */
@@ -20,12 +20,14 @@
 #include "UARTSerial.h"
 #include "platform/mbed_poll.h"
 
-#if MBED_CONF_RTOS_PRESENT
-#include "rtos/Thread.h"
-#else
-#include "platform/mbed_wait_api.h"
+#if !MBED_CONF_RTOS_PRESENT
+#include "platform/mbed_power_mgmt.h"
 #endif
 
+#define UART_SERIAL_EVENT_RX_READY  (1UL << 0)  // RX buffer became non-empty
+#define UART_SERIAL_EVENT_TX_SPACE  (1UL << 1)  // TX buffer drained to half its size
+#define UART_SERIAL_EVENT_TX_EMPTY  (1UL << 2)  // All of the TX buffer was handed to the peripheral
+
 namespace mbed {
 
 UARTSerial::UARTSerial(PinName tx, PinName rx, int baud) :
@@ -35,6 +37,13 @@ UARTSerial::UARTSerial(PinName tx, PinName rx, int baud) :
     _rx_irq_enabled(true),
     _dcd_irq(NULL)
 {
+    _rx_waiters = 0;
+    _tx_waiters = 0;
+    _sync_waiters = 0;
+#if !MBED_CONF_RTOS_PRESENT
+    _event_flags = 0;
+#endif
+
     /* Attatch IRQ routines to the serial device. */
     SerialBase::attach(callback(this, &UARTSerial::rx_irq), RxIrq);
 }
@@ -110,10 +119,12 @@ int UARTSerial::sync()
     api_lock();
 
     while (!_txbuf.empty()) {
-        api_unlock();
-        // Doing better than wait would require TxIRQ to also do wake() when becoming empty. Worth it?
-        wait_ms(1);
-        api_lock();
+        wait_event(UART_SERIAL_EVENT_TX_EMPTY, _sync_waiters);
+    }
+
+    // The interrupt signals once for all callers, pass it on
+    if (_sync_waiters) {
+        signal_event(UART_SERIAL_EVENT_TX_EMPTY);
     }
 
     api_unlock();
@@ -155,9 +166,7 @@ ssize_t UARTSerial::write(const void *buffer, size_t length)
                 break;
             }
             do {
-                api_unlock();
-                wait_ms(1); // XXX todo - proper wait, WFE for non-rtos ?
-                api_lock();
+                wait_event(UART_SERIAL_EVENT_TX_SPACE, _tx_waiters);
             } while (_txbuf.full());
         }
 
@@ -177,6 +186,11 @@ ssize_t UARTSerial::write(const void *buffer, size_t length)
         core_util_critical_section_exit();
     }
 
+    // The interrupt signals once for all callers, pass it on while there is room
+    if (_tx_waiters && !_txbuf.full()) {
+        signal_event(UART_SERIAL_EVENT_TX_SPACE);
+    }
+
     api_unlock();
 
     return data_written != 0 ? (ssize_t) data_written : (ssize_t) - EAGAIN;
@@ -199,9 +213,7 @@ ssize_t UARTSerial::read(void *buffer, size_t length)
             api_unlock();
             return -EAGAIN;
         }
-        api_unlock();
-        wait_ms(1);  // XXX todo - proper wait, WFE for non-rtos ?
-        api_lock();
+        wait_event(UART_SERIAL_EVENT_RX_READY, _rx_waiters);
     }
 
     while (data_read < length && !_rxbuf.empty()) {
@@ -219,6 +231,11 @@ ssize_t UARTSerial::read(void *buffer, size_t length)
     }
     core_util_critical_section_exit();
 
+    // The interrupt signals once for all callers, pass it on while data is left
+    if (_rx_waiters && !_rxbuf.empty()) {
+        signal_event(UART_SERIAL_EVENT_RX_READY);
+    }
+
     api_unlock();
 
     return data_read;
@@ -234,6 +251,7 @@ void UARTSerial::wake()
     if (_sigio_cb) {
         _sigio_cb();
     }
+    poll_change(this);
 }
 
 short UARTSerial::poll(short events) const
@@ -281,15 +299,50 @@ void UARTSerial::api_unlock(void)
     _mutex.unlock();
 }
 
+void UARTSerial::wait_event(uint32_t events, uint8_t &waiters)
+{
+    waiters++;
+    api_unlock();
+
+#if MBED_CONF_RTOS_PRESENT
+    _event_flags.wait_any(events);
+#else
+    core_util_critical_section_enter();
+    while (!(_event_flags & events)) {
+        // A pending interrupt wakes the core even inside the critical section,
+        // it is serviced as soon as the critical section is left
+        sleep();
+        core_util_critical_section_exit();
+        core_util_critical_section_enter();
+    }
+    _event_flags &= ~events;
+    core_util_critical_section_exit();
+#endif
+
+    api_lock();
+    waiters--;
+}
+
+void UARTSerial::signal_event(uint32_t events)
+{
+#if MBED_CONF_RTOS_PRESENT
+    _event_flags.set(events);
+#else
+    core_util_critical_section_enter();
+    _event_flags |= events;
+    core_util_critical_section_exit();
+#endif
+}
+
 void UARTSerial::rx_irq(void)
 {
     bool was_empty = _rxbuf.empty();
 
     /* Fill in the receive buffer if the peripheral is readable
-     * and receive buffer is not full. */
-    while (!_rxbuf.full() && SerialBase::readable()) {
-        char data = SerialBase::_base_getc();
-        _rxbuf.push(data);
+     * and receive buffer is not full. Interrupt context, so the
+     * HAL is used directly instead of the locking SerialBase calls. */
+    while (!_rxbuf.full() && serial_readable(&_serial)) {
+        _rxbuf.push(serial_getc(&_serial));
     }
 
     if (_rx_irq_enabled && _rxbuf.full()) {
@@ -299,6 +352,7 @@ void UARTSerial::rx_irq(void)
 
     /* Report the File handler that data is ready to be read from the buffer. */
     if (was_empty && !_rxbuf.empty()) {
+        signal_event(UART_SERIAL_EVENT_RX_READY);
         wake();
     }
 }
@@ -307,12 +361,15 @@ void UARTSerial::rx_irq(void)
 void UARTSerial::tx_irq(void)
 {
     bool was_full = _txbuf.full();
+    bool was_above_half = _txbuf.size() > MBED_CONF_DRIVERS_UART_SERIAL_TXBUF_SIZE / 2;
+    bool was_empty = _txbuf.empty();
     char data;
 
     /* Write to the peripheral if there is something to write
-     * and if the peripheral is available to write. */
-    while (SerialBase::writeable() && _txbuf.pop(data)) {
-        SerialBase::_base_putc(data);
+     * and if the peripheral is available to write. Interrupt context,
+     * so the HAL is used directly instead of the locking SerialBase calls. */
+    while (serial_writable(&_serial) && _txbuf.pop(data)) {
+        serial_putc(&_serial, data);
     }
 
     if (_tx_irq_enabled && _txbuf.empty()) {
@@ -320,23 +377,21 @@ void UARTSerial::tx_irq(void)
         _tx_irq_enabled = false;
     }
 
+    /* Wake a blocked write once there is room for a batch of data, rather
+     * than for every byte, and a blocked sync once everything was sent. */
+    if (was_above_half && _txbuf.size() <= MBED_CONF_DRIVERS_UART_SERIAL_TXBUF_SIZE / 2) {
+        signal_event(UART_SERIAL_EVENT_TX_SPACE);
+    }
+
+    if (!was_empty && _txbuf.empty()) {
+        signal_event(UART_SERIAL_EVENT_TX_EMPTY);
+    }
+
     /* Report the File handler that data can be written to peripheral. */
     if (was_full && !_txbuf.full() && !hup()) {
         wake();
     }
 }
-
-void UARTSerial::wait_ms(uint32_t millisec)
-{
-    /* wait_ms implementation for RTOS spins until exact microseconds - we
-     * want to just sleep until next tick.
-     */
-#if MBED_CONF_RTOS_PRESENT
-    rtos::Thread::wait(millisec);
-#else
-    ::wait_ms(millisec);
-#endif
-}
 } //namespace mbed
 
 #endif //(DEVICE_SERIAL && DEVICE_INTERRUPTIN)
@@ -29,6 +29,10 @@
 #include "platform/CircularBuffer.h"
 #include "platform/NonCopyable.h"
 
+#if MBED_CONF_RTOS_PRESENT
+#include "rtos/EventFlags.h"
+#endif
+
 #ifndef MBED_CONF_DRIVERS_UART_SERIAL_RXBUF_SIZE
 #define MBED_CONF_DRIVERS_UART_SERIAL_RXBUF_SIZE  256
 #endif
@@ -42,6 +46,9 @@ namespace mbed {
 /** \addtogroup drivers */
 
 /** Class providing buffered UART communication functionality using separate circular buffer for send and receive channels
+ *
+ * Blocking reads and writes sleep until the serial interrupt makes progress
+ * on the buffers, so the calling thread is not woken periodically to poll.
  *
  * @ingroup drivers
  */
@@ -224,7 +231,20 @@ public:
 
 private:
 
-    void wait_ms(uint32_t millisec);
+    /** Sleep until one of the events was signalled by the serial interrupt
+     *
+     *  Called with the API lock held, which is released while sleeping.
+     *  The caller is counted in waiters meanwhile. Clears the events it
+     *  returns on. An event may be signalled before the caller starts
+     *  waiting, so the condition must be checked again.
+     *
+     *  The interrupt signals an event once for all waiters, so a caller
+     *  that leaves the condition true signals it again for the next one.
+     */
+    void wait_event(uint32_t events, uint8_t &waiters);
+
+    /** Signal events to a blocked read, write or sync */
+    void signal_event(uint32_t events);
 
     /** SerialBase lock override */
     virtual void lock(void);
@@ -253,6 +273,17 @@ private:
     bool _rx_irq_enabled;
     InterruptIn *_dcd_irq;
 
+#if MBED_CONF_RTOS_PRESENT
+    rtos::EventFlags _event_flags;
+#else
+    volatile uint32_t _event_flags;
+#endif
+
+    /** Callers blocked in read, write and sync, counted under the API lock */
+    uint8_t _rx_waiters;
+    uint8_t _tx_waiters;
+    uint8_t _sync_waiters;
+
     /** Device Hanged up
      *  Determines if the device hanged up on us.
      *
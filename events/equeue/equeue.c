@@ -231,6 +231,9 @@ static int equeue_enqueue(equeue_t *q, struct equeue_event *e, unsigned tick) {
 
         e->sibling = *p;
         e->sibling->ref = &e->sibling;
+        // only the head of a slot links to the next slot, equeue_unqueue
+        // relies on this when removing a sibling
+        e->sibling->next = 0;
     } else {
         e->next = *p;
         if (e->next) {
@@ -310,6 +313,11 @@ static struct equeue_event *equeue_dequeue(equeue_t *q, unsigned target) {
     struct equeue_event *head = q->queue;
     struct equeue_event **p = &head;
     while (*p && equeue_tickdiff((*p)->target, target) <= 0) {
+        // mark as in-flight, the 8-bit generation of an event that waited
+        // a multiple of 256 generations would match the current one
+        for (struct equeue_event *e = *p; e; e = e->sibling) {
+            e->generation = q->generation - 1;
+        }
         p = &(*p)->next;
     }
 
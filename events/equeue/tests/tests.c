@@ -356,6 +356,42 @@ void cancel_unnecessarily_test(void) {
     equeue_destroy(&q);
 }
 
+void cancel_sibling_test(void) {
+    equeue_t q;
+    int err = equeue_create(&q, 2048);
+    test_assert(!err);
+
+    int touched[4] = {0};
+
+    // siblings share a slot, cancelling them must not touch later slots
+    int c = equeue_call_in(&q, 200, simple_func, &touched[2]);
+    int a = equeue_call_in(&q, 100, simple_func, &touched[0]);
+    int b = equeue_call_in(&q, 100, simple_func, &touched[1]);
+    test_assert(a && b && c);
+
+    equeue_cancel(&q, c);
+    equeue_cancel(&q, a);
+    equeue_call_in(&q, 200, simple_func, &touched[3]);
+
+    equeue_dispatch(&q, 300);
+    test_assert(touched[0] == 0);
+    test_assert(touched[1] == 1);
+    test_assert(touched[2] == 0);
+    test_assert(touched[3] == 1);
+
+    // every chunk must have been freed exactly once
+    void *e[4];
+    for (int i = 0; i < 4; i++) {
+        e[i] = equeue_alloc(&q, 1);
+        test_assert(e[i]);
+        for (int j = 0; j < i; j++) {
+            test_assert(e[i] != e[j]);
+        }
+    }
+
+    equeue_destroy(&q);
+}
+
 void loop_protect_test(void) {
     equeue_t q;
     int err = equeue_create(&q, 2048);
@@ -757,6 +793,7 @@ int main() {
     test_run(cancel_test, 20);
     test_run(cancel_inflight_test);
     test_run(cancel_unnecessarily_test);
+    test_run(cancel_sibling_test);
     test_run(loop_protect_test);
     test_run(break_test);
     test_run(break_no_windup_test);
@@ -0,0 +1,100 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_BLE_ADVERTISING_DUPLICATE_FILTER
+#define MBED_BLE_ADVERTISING_DUPLICATE_FILTER
+
+#include "ble/BLETypes.h"
+#include "ble/ArrayView.h"
+#include "platform/NonCopyable.h"
+
+namespace ble {
+namespace generic {
+
+/**
+ * Filter of advertising reports repeating a report received recently.
+ *
+ * Reports are identified by a hash of the advertiser address and of the
+ * content advertised; a report is a duplicate if an identical one has been
+ * let through less than a window ago.
+ */
+class AdvertisingDuplicateFilter : mbed::NonCopyable<AdvertisingDuplicateFilter> {
+public:
+    /**
+     * Construct a filter.
+     *
+     * @param capacity Number of reports remembered, rounded up to a power of
+     * two.
+     */
+    AdvertisingDuplicateFilter(size_t capacity);
+
+    ~AdvertisingDuplicateFilter();
+
+    /**
+     * Set the duration during which identical reports are filtered.
+     *
+     * @param window_ms Duration in milliseconds, 0 disables the filter.
+     */
+    void set_window(uint32_t window_ms);
+
+    /**
+     * Return the duration during which identical reports are filtered.
+     */
+    uint32_t get_window() const
+    {
+        return _window;
+    }
+
+    /**
+     * Check a report and remember it if it is let through.
+     *
+     * @param[in] address Address of the advertiser.
+     * @param[in] address_type Type of the advertiser address.
+     * @param[in] advertising_type Type of the report.
+     * @param[in] data Content of the report.
+     * @param[in] now_ms Current time in milliseconds.
+     *
+     * @return true if the report should be dropped.
+     */
+    bool is_duplicate(
+        const address_t &address,
+        uint8_t address_type,
+        uint8_t advertising_type,
+        const ArrayView<const uint8_t> &data,
+        uint32_t now_ms
+    );
+
+    /**
+     * Forget the reports received.
+     */
+    void clear();
+
+private:
+    struct entry_t {
+        /* hash of the report, 0 if the entry is free */
+        uint32_t key;
+        uint32_t time;
+    };
+
+    entry_t *_entries;
+    size_t _mask;
+    uint32_t _window;
+};
+
+} // namespace generic
+} // namespace ble
+
+#endif /* MBED_BLE_ADVERTISING_DUPLICATE_FILTER */
@@ -32,6 +32,8 @@ private:
         SecurityDistributionFlags_t flags;
         sign_count_t peer_sign_counter;
         size_t file_offset;
+        size_t gatt_cache_offset;
+        uint16_t gatt_cache_size;
     };
 
     static const size_t MAX_ENTRIES = 5;
@@ -118,6 +120,17 @@ public:
         sign_count_t sign_counter
     );
 
+    /* attribute cache */
+
+    virtual ArrayView<const uint8_t> get_entry_gatt_cache(
+        entry_handle_t db_handle
+    );
+
+    virtual void set_entry_gatt_cache(
+        entry_handle_t db_handle,
+        const ArrayView<const uint8_t> &cache
+    );
+
     /* saving and loading from nvm */
 
     virtual void restore();
@@ -127,9 +140,9 @@ public:
     virtual void set_restore(bool reload);
 
 private:
-    virtual uint8_t get_entry_count();
+    virtual size_t get_entry_count();
 
-    virtual SecurityDistributionFlags_t* get_entry_handle_by_index(uint8_t index);
+    virtual SecurityDistributionFlags_t* get_entry_handle_by_index(size_t index);
 
     virtual void reset_entry(entry_handle_t db_handle);
 
@@ -145,10 +158,18 @@ private:
      */
     static FILE* erase_db_file(FILE* db_file);
 
+    /**
+     * Upgrade a version 1 db file by appending empty attribute caches.
+     * @param db_file filehandle for file to upgrade
+     * @return true when successful
+     */
+    static bool append_gatt_caches(FILE* db_file);
+
 private:
     entry_t _entries[MAX_ENTRIES];
     FILE *_db_file;
     uint8_t _buffer[sizeof(SecurityEntryKeys_t)];
+    uint8_t _gatt_cache[MAX_GATT_CACHE_SIZE];
 };
 
 } /* namespace pal */
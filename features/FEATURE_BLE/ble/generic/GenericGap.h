@@ -30,6 +30,9 @@
 #include "ble/pal/GenericAccessService.h"
 #include "ble/pal/EventQueue.h"
 #include "ble/pal/ConnectionEventMonitor.h"
+#include "ble/pal/AddressResolutionMonitor.h"
+#include "ble/generic/ResolvedAddressCache.h"
+#include "ble/generic/AdvertisingDuplicateFilter.h"
 
 #include "drivers/Timeout.h"
 
@@ -44,6 +47,7 @@ namespace generic {
  */
 class GenericGap : public ::Gap,
                    public pal::ConnectionEventMonitor,
+                   public pal::AddressResolutionMonitor,
                    public pal::Gap::EventHandler {
 
 public:
@@ -346,6 +350,65 @@ public:
         DisconnectionReason_t reason
     );
 
+    /**
+     * Counters of the advertising reports processed.
+     */
+    struct AdvertisingReportStatistics_t {
+        /** Reports received from the controller. */
+        uint32_t received;
+        /** Reports delivered to the application. */
+        uint32_t delivered;
+        /** Reports dropped by the duplicate filter. */
+        uint32_t duplicates_filtered;
+        /** Reports dropped because their private address did not resolve. */
+        uint32_t unresolved_filtered;
+        /** Private addresses found in the resolution cache. */
+        uint32_t resolution_cache_hits;
+        /** Private addresses submitted to the resolution handler. */
+        uint32_t resolutions;
+    };
+
+    /**
+     * Handler receiving the advertising reports of a controller event at once.
+     *
+     * The reports are valid for the duration of the call. The deprecated
+     * addressType member of the reports is not set.
+     */
+    typedef mbed::Callback<void(const AdvertisementCallbackParams_t *reports, size_t count)>
+        AdvertisementReportBatchHandler_t;
+
+    /**
+     * Drop advertising reports identical to a report received recently.
+     *
+     * Reports are identical if they come from the same address with the same
+     * type and content.
+     *
+     * @param window_ms Duration during which identical reports are dropped;
+     * 0 disables the filter.
+     */
+    void set_advertising_duplicate_filter(uint32_t window_ms);
+
+    /**
+     * Deliver advertising reports in batches rather than through the
+     * handlers registered with startScan().
+     *
+     * @param handler The handler receiving the reports; an empty callback
+     * restores the delivery to the startScan() handlers.
+     */
+    void set_advertising_report_batch_handler(
+        const AdvertisementReportBatchHandler_t &handler
+    );
+
+    /**
+     * Return the counters of the advertising reports processed.
+     */
+    const AdvertisingReportStatistics_t &get_advertising_report_statistics() const;
+
+    /**
+     * Set the counters of the advertising reports processed to 0.
+     */
+    void reset_advertising_report_statistics();
+
 private:
     /** @note Implements ConnectionEventMonitor.
      *  @copydoc ConnectionEventMonitor::set_connection_event_handler
@@ -395,6 +458,28 @@ private:
 
     void on_address_rotation_timeout();
 
+    /**
+     * Replace a private resolvable address by the identity of its owner.
+     *
+     * @return true if the address has been resolved.
+     */
+    bool resolve_private_address(
+        ble::address_t &address,
+        peer_address_type_t &address_type
+    );
+
+    /** @note Implements AddressResolutionMonitor.
+     *  @copydoc AddressResolutionMonitor::set_address_resolution_event_handler
+     */
+    virtual void set_address_resolution_event_handler(
+        pal::AddressResolutionMonitor::EventHandler *address_resolution_event_handler
+    );
+
+    /** @note Implements AddressResolutionMonitor.
+     *  @copydoc AddressResolutionMonitor::on_resolvable_identities_changed
+     */
+    virtual void on_resolvable_identities_changed(bool identities_removed);
+
     /* implements pal::Gap::EventHandler */
 private:
     virtual void on_read_phy(
@@ -433,6 +518,11 @@ private:
     mbed::Timeout _scan_timeout;
     mbed::Ticker _address_rotation_ticker;
     pal::ConnectionEventMonitor::EventHandler *_connection_event_handler;
+    pal::AddressResolutionMonitor::EventHandler *_address_resolution_event_handler;
+    ResolvedAddressCache _resolved_address_cache;
+    AdvertisingDuplicateFilter _advertising_duplicate_filter;
+    AdvertisementReportBatchHandler_t _advertising_report_batch_handler;
+    AdvertisingReportStatistics_t _advertising_report_statistics;
 };
 
 }
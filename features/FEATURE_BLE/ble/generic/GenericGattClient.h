@@ -21,19 +21,43 @@
 #include "ble/GattClient.h"
 #include "ble/pal/PalGattClient.h"
 #include "ble/pal/SigningEventMonitor.h"
+#include "ble/pal/AttributeCacheMonitor.h"
+#include "platform/Callback.h"
+
+#ifndef MBED_CONF_BLE_GATT_CLIENT_MAX_CONNECTIONS
+#define MBED_CONF_BLE_GATT_CLIENT_MAX_CONNECTIONS 5
+#endif
 
 // IMPORTANT: private header. Not part of the public interface.
 
 namespace ble {
 namespace generic {
 
+class AttributeCache;
+
 /**
  * Generic implementation of the GattClient.
  * It requires a pal::GattClient injected at construction site.
+ *
+ * Procedures launched on a connection already running one are queued and
+ * started in order once the ATT bearer is free. When a queued procedure
+ * starts, the ones following it may be merged into the same exchange:
+ *   - reads of values with a known fixed size are grouped into a single
+ *     Read Multiple request.
+ *   - long writes share the same prepare queue and a single Execute Write.
+ * Write commands do not wait for a response and are sent immediately.
+ *
+ * When an attribute cache handler is registered, the attributes found by a
+ * complete discovery of a peer are cached. Following discoveries of that
+ * peer, including the ones made on later connections if the peer is bonded,
+ * complete from the cache without any exchange over the air. The cache is
+ * dropped when the peer indicates a change of its services.
+ *
  * @attention: Not part of the public interface of BLE API.
  */
 class GenericGattClient : public GattClient,
-                          public pal::SigningEventMonitor {
+                          public pal::SigningEventMonitor,
+                          public pal::AttributeCacheMonitor {
 public:
     /**
      * Create a GenericGattClient from a pal::GattClient
@@ -121,16 +145,101 @@ public:
      */
     virtual void set_signing_event_handler(pal::SigningEventMonitor::EventHandler *signing_event_handler);
 
+    /**
+     * @see ble::pal::AttributeCacheMonitor::set_attribute_cache_event_handler
+     */
+    virtual void set_attribute_cache_event_handler(
+        pal::AttributeCacheMonitor::EventHandler *attribute_cache_event_handler
+    );
+
+    /**
+     * Verify the attribute cache in the background when a discovery completes
+     * from it: the primary services of the peer are discovered again and
+     * compared to the ones cached.
+     *
+     * @param enable true to verify the cache, false otherwise. Disabled by
+     * default.
+     */
+    void set_attribute_cache_verification(bool enable);
+
+    /**
+     * Register the function called when the attribute cache of a peer has
+     * been dropped because it is out of date. Services, characteristics and
+     * descriptors previously discovered on that connection must be discovered
+     * again.
+     *
+     * @param callback function called with the handle of the connection.
+     */
+    void when_attribute_cache_invalidated(
+        const mbed::Callback<void(Gap::Handle_t)> &callback
+    );
+
+    /**
+     * Release the state kept for a connection once it is closed. Registered
+     * with Gap::onDisconnection() by the BLE instance.
+     *
+     * @param params Parameters of the disconnection.
+     */
+    void on_disconnection(const Gap::DisconnectionCallbackParams_t* params);
+
 private:
     struct ProcedureControlBlock;
     struct DiscoveryControlBlock;
     struct ReadControlBlock;
     struct WriteControlBlock;
     struct DescriptorDiscoveryControlBlock;
+    struct CacheVerificationControlBlock;
+
+    /*
+     * Discovery completing synchronously from the attribute cache. They are
+     * stacked as their callbacks may launch other discoveries.
+     */
+    struct CachedDiscovery {
+        const DiscoveredCharacteristic* characteristic;
+        bool done;
+        CachedDiscovery* previous;
+    };
+
+    static const size_t MAX_CONNECTIONS = MBED_CONF_BLE_GATT_CLIENT_MAX_CONNECTIONS;
+    static const size_t MAX_VALUE_LENGTHS = 64;
 
-    ProcedureControlBlock* get_control_block(Gap::Handle_t connection);
-    const ProcedureControlBlock* get_control_block(Gap::Handle_t connection) const;
+    /*
+     * Procedures of a connection, in launch order. The first one owns the ATT
+     * bearer once started. The length of the values discovered with a size
+     * fixed by the specifications is kept to batch their reads; that table
+     * is allocated on first use and dropped when the connection closes or
+     * the peer database changes.
+     */
+    struct ConnectionControlBlock {
+        ConnectionControlBlock();
+        ~ConnectionControlBlock();
+
+        bool is_idle() const;
+        bool get_fixed_value_length(GattAttribute::Handle_t handle, uint16_t& length) const;
+        void set_value_length(GattAttribute::Handle_t handle, uint16_t length);
+        void clear_value_length(GattAttribute::Handle_t handle);
+        void clear();
+
+        struct value_length_t {
+            GattAttribute::Handle_t handle;
+            uint16_t length;
+        };
+
+        Gap::Handle_t connection_handle;
+        bool in_use;
+        ProcedureControlBlock* active;
+        ProcedureControlBlock* procedures;
+        ProcedureControlBlock* procedures_tail;
+        value_length_t* value_lengths;
+        GattAttribute::Handle_t service_changed_handle;
+    };
+
+    ConnectionControlBlock* get_connection(Gap::Handle_t connection) const;
+    ConnectionControlBlock* acquire_connection(Gap::Handle_t connection) const;
+    ble_error_t launch_procedure(ProcedureControlBlock* cb);
+    void process_queue(ConnectionControlBlock* connection);
     void insert_control_block(ProcedureControlBlock* cb) const;
+    void requeue_control_blocks(ProcedureControlBlock* first) const;
     void remove_control_block(ProcedureControlBlock* cb) const;
 
     void on_termination(Gap::Handle_t connection_handle);
@@ -141,10 +250,52 @@ private:
 
     uint16_t get_mtu(Gap::Handle_t connection) const;
 
+    bool load_attribute_cache(Gap::Handle_t connection, AttributeCache& cache);
+    bool discover_from_cache(
+        Gap::Handle_t connection_handle,
+        ServiceDiscovery::ServiceCallback_t service_callback,
+        ServiceDiscovery::CharacteristicCallback_t characteristic_callback,
+        const UUID& matching_service_uuid,
+        const UUID& matching_characteristic_uuid
+    );
+    bool discover_descriptors_from_cache(
+        const DiscoveredCharacteristic& characteristic,
+        const CharacteristicDescriptorDiscovery::DiscoveryCallback_t& discoveryCallback,
+        const CharacteristicDescriptorDiscovery::TerminationCallback_t& terminationCallback
+    );
+    void store_attribute_cache(Gap::Handle_t connection, const AttributeCache& cache);
+    void store_descriptors(
+        Gap::Handle_t connection,
+        const DiscoveredCharacteristic& characteristic,
+        uint8_t count,
+        const AttributeCache& descriptors
+    );
+    void invalidate_attribute_cache(Gap::Handle_t connection);
+    void on_indication(Gap::Handle_t connection, GattAttribute::Handle_t handle);
+    void on_characteristic_discovered(
+        Gap::Handle_t connection,
+        const UUID& uuid,
+        GattAttribute::Handle_t value_handle
+    ) const;
+    void on_descriptor_discovered(
+        Gap::Handle_t connection,
+        const UUID& uuid,
+        GattAttribute::Handle_t handle
+    ) const;
+    void on_value_discovered(
+        Gap::Handle_t connection,
+        const UUID& uuid,
+        GattAttribute::Handle_t handle
+    ) const;
+
     pal::GattClient* const _pal_client;
     ServiceDiscovery::TerminationCallback_t _termination_callback;
     pal::SigningEventMonitor::EventHandler* _signing_event_handler;
-    mutable ProcedureControlBlock* control_blocks;
+    pal::AttributeCacheMonitor::EventHandler* _attribute_cache_handler;
+    mbed::Callback<void(Gap::Handle_t)> _attribute_cache_invalidated;
+    CachedDiscovery* _cached_discoveries;
+    bool _verify_attribute_cache;
+    mutable ConnectionControlBlock _connections[MAX_CONNECTIONS];
     bool _is_reseting;
 };
 
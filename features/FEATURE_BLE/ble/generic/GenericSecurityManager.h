@@ -23,6 +23,8 @@
 #include "platform/Callback.h"
 #include "ble/pal/ConnectionEventMonitor.h"
 #include "ble/pal/SigningEventMonitor.h"
+#include "ble/pal/AttributeCacheMonitor.h"
+#include "ble/pal/AddressResolutionMonitor.h"
 #include "ble/generic/GenericGap.h"
 #include "ble/pal/PalSecurityManager.h"
 #include "ble/ArrayView.h"
@@ -35,7 +37,9 @@ typedef SecurityManager::SecurityIOCapabilities_t SecurityIOCapabilities_t;
 class GenericSecurityManager : public SecurityManager,
                                public pal::SecurityManager::EventHandler,
                                public pal::ConnectionEventMonitor::EventHandler,
-                               public pal::SigningEventMonitor::EventHandler {
+                               public pal::SigningEventMonitor::EventHandler,
+                               public pal::AttributeCacheMonitor::EventHandler,
+                               public pal::AddressResolutionMonitor::EventHandler {
 public:
 
     /* implements SecurityManager */
@@ -238,11 +242,17 @@ public:
     GenericSecurityManager(
         pal::SecurityManager &palImpl,
         pal::ConnectionEventMonitor &connMonitorImpl,
-        pal::SigningEventMonitor &signingMonitorImpl
+        pal::SigningEventMonitor &signingMonitorImpl,
+        pal::AttributeCacheMonitor *attributeCacheMonitorImpl = NULL,
+        pal::AddressResolutionMonitor *addressResolutionMonitorImpl = NULL
     ) : _pal(palImpl),
         _connection_monitor(connMonitorImpl),
         _signing_monitor(signingMonitorImpl),
+        _attribute_cache_monitor(attributeCacheMonitorImpl),
+        _address_resolution_monitor(addressResolutionMonitorImpl),
         _db(NULL),
+        _resolvable_identities(NULL),
+        _resolvable_identity_count(0),
         _default_authentication(0),
         _default_key_distribution(pal::KeyDistribution::KEY_DISTRIBUTION_ALL),
         _pairing_authorisation_required(false),
@@ -258,6 +268,7 @@ public:
 
     ~GenericSecurityManager() {
         delete _db;
+        delete [] _resolvable_identities;
     }
 
     ////////////////////////////////////////////////////////////////////////////
@@ -493,9 +504,15 @@ private:
     pal::SecurityManager &_pal;
     pal::ConnectionEventMonitor &_connection_monitor;
     pal::SigningEventMonitor &_signing_monitor;
+    pal::AttributeCacheMonitor *_attribute_cache_monitor;
+    pal::AddressResolutionMonitor *_address_resolution_monitor;
 
     SecurityDb *_db;
 
+    /* identities resolved in software, beyond the controller resolving list */
+    SecurityEntryIdentity_t *_resolvable_identities;
+    size_t _resolvable_identity_count;
+
     /* OOB data */
     address_t _oob_local_address;
     address_t _oob_peer_address;
@@ -729,6 +746,48 @@ public:
 
     /* end implements ble::pal::SecurityManager::EventHandler */
 
+    /* implements ble::pal::AttributeCacheMonitor::EventHandler */
+
+    /** @copydoc ble::pal::AttributeCacheMonitor::EventHandler::get_attribute_cache
+     */
+    virtual ArrayView<const uint8_t> get_attribute_cache(
+        connection_handle_t connection
+    );
+
+    /** @copydoc ble::pal::AttributeCacheMonitor::EventHandler::on_attribute_cache_updated
+     */
+    virtual void on_attribute_cache_updated(
+        connection_handle_t connection,
+        const ArrayView<const uint8_t> &cache
+    );
+
+    /**
+     * Return the database entry of a bonded peer; attributes of peers which
+     * are not bonded cannot be trusted across connections.
+     */
+    SecurityDb::entry_handle_t get_bonded_entry(connection_handle_t connection);
+
+    /* end implements ble::pal::AttributeCacheMonitor::EventHandler */
+
+    /* implements ble::pal::AddressResolutionMonitor::EventHandler */
+
+    /** @copydoc ble::pal::AddressResolutionMonitor::EventHandler::resolve_private_address
+     */
+    virtual bool resolve_private_address(
+        const address_t &address,
+        address_t &identity_address,
+        bool &identity_address_is_public
+    );
+
+    /**
+     * Add an identity to the ones resolved in software.
+     *
+     * @return true if the identities held changed.
+     */
+    bool add_resolvable_identity(const SecurityEntryIdentity_t &identity);
+
+    /* end implements ble::pal::AddressResolutionMonitor::EventHandler */
+
     /* list management */
 
     ControlBlock_t* acquire_control_block(connection_handle_t connection);
@@ -0,0 +1,329 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GENERIC_INDEXED_FILE_SECURITY_DB_H_
+#define GENERIC_INDEXED_FILE_SECURITY_DB_H_
+
+#include "SecurityDb.h"
+
+#include <stdio.h>
+
+namespace ble {
+namespace generic {
+
+/**
+ * Filesystem implementation for a large number of bonds.
+ *
+ * Entries are located through hash indexes of their peer and identity
+ * addresses held in RAM. Updates are kept in RAM until sync() which writes
+ * every modified entry in a single transaction: the records are written to a
+ * journal then to their place in the file. A transaction interrupted after
+ * its journal was committed is completed by restore().
+ *
+ * The database is accessed through the C library file API; it can be stored
+ * on any mounted FileSystem.
+ */
+class IndexedFileSecurityDb : public SecurityDb {
+public:
+    /**
+     * Maximum number of entries the database can hold.
+     */
+    static const size_t MAX_ENTRIES = 0xFFFE;
+
+    /**
+     * Maximum number of modified entries held in RAM; modifying another
+     * entry writes all of them to the file.
+     */
+    static const size_t MAX_DIRTY_ENTRIES = 8;
+
+    /**
+     * Create a database stored in a file.
+     * @param db_file file returned by open_db_file
+     * @param max_entries number of entries the file was opened with
+     */
+    IndexedFileSecurityDb(FILE *db_file, size_t max_entries);
+    virtual ~IndexedFileSecurityDb();
+
+    /**
+     * Validates or creates a file for the security database.
+     * @param db_path path to the file
+     * @param max_entries number of entries held by the database
+     * @return FILE handle open and ready for use by the database or NULL if unavailable
+     */
+    static FILE* open_db_file(const char *db_path, size_t max_entries);
+
+    virtual SecurityDistributionFlags_t* get_distribution_flags(
+        entry_handle_t db_handle
+    );
+
+    /* local keys */
+
+    /* set */
+    virtual void set_entry_local_ltk(
+        entry_handle_t db_handle,
+        const ltk_t &ltk
+    );
+
+    virtual void set_entry_local_ediv_rand(
+        entry_handle_t db_handle,
+        const ediv_t &ediv,
+        const rand_t &rand
+    );
+
+    /* peer's keys */
+
+    /* set */
+
+    virtual void set_entry_peer_ltk(
+        entry_handle_t db_handle,
+        const ltk_t &ltk
+    );
+
+    virtual void set_entry_peer_ediv_rand(
+        entry_handle_t db_handle,
+        const ediv_t &ediv,
+        const rand_t &rand
+    );
+
+    virtual void set_entry_peer_irk(
+        entry_handle_t db_handle,
+        const irk_t &irk
+    );
+
+    virtual void set_entry_peer_bdaddr(
+        entry_handle_t db_handle,
+        bool address_is_public,
+        const address_t &peer_address
+    );
+
+    virtual void set_entry_peer_csrk(
+        entry_handle_t db_handle,
+        const csrk_t &csrk
+    );
+
+    virtual void set_entry_peer_sign_counter(
+        entry_handle_t db_handle,
+        sign_count_t sign_counter
+    );
+
+    /* attribute cache */
+
+    virtual ArrayView<const uint8_t> get_entry_gatt_cache(
+        entry_handle_t db_handle
+    );
+
+    virtual void set_entry_gatt_cache(
+        entry_handle_t db_handle,
+        const ArrayView<const uint8_t> &cache
+    );
+
+    /* local csrk */
+
+    virtual void set_local_csrk(const csrk_t &csrk);
+
+    virtual void set_local_sign_counter(sign_count_t sign_counter);
+
+    /* list management */
+
+    virtual entry_handle_t open_entry(
+        peer_address_type_t peer_address_type,
+        const address_t &peer_address
+    );
+
+    virtual entry_handle_t find_entry_by_peer_address(
+        peer_address_type_t peer_address_type,
+        const address_t &peer_address
+    );
+
+    virtual void close_entry(entry_handle_t db_handle);
+
+    virtual void clear_entries();
+
+    /* saving and loading from nvm */
+
+    virtual void restore();
+
+    virtual void sync(entry_handle_t db_handle);
+
+    virtual void set_restore(bool reload);
+
+private:
+    static const uint16_t NO_ENTRY = 0xFFFF;
+
+    /** Entry as stored in the file. */
+    struct record_t {
+        SecurityDistributionFlags_t flags;
+        SecurityEntryKeys_t local_keys;
+        SecurityEntryKeys_t peer_keys;
+        SecurityEntryIdentity_t peer_identity;
+        SecurityEntrySigning_t peer_signing;
+        /** identifies the attribute cache written for this bond */
+        uint32_t gatt_cache_tag;
+    };
+
+    /** Record copy waiting to be written, also the layout of the journal. */
+    struct dirty_record_t {
+        uint32_t index;
+        record_t record;
+    };
+
+    /** Entry state held in RAM, the handle points to it. */
+    struct entry_t {
+        SecurityDistributionFlags_t flags;
+        sign_count_t peer_sign_counter;
+        uint32_t gatt_cache_tag;
+        uint32_t last_used;
+        /** identity address, valid if irk_stored */
+        address_t identity_address;
+        uint8_t identity_address_is_public:1;
+        /** entry holds a bond or is opened */
+        uint8_t used:1;
+        uint8_t opened:1;
+        /** a record for this entry exists in the file */
+        uint8_t persisted:1;
+        uint8_t in_identity_index:1;
+        /** bucket the entry is chained in by peer address */
+        uint16_t address_bucket;
+        /** next entry in the address bucket, or in the free list */
+        uint16_t next_by_address;
+        uint16_t next_by_identity;
+        uint16_t identity_bucket;
+        uint16_t next_opened;
+    };
+
+    static entry_t* as_entry(entry_handle_t db_handle) {
+        return reinterpret_cast<entry_t*>(db_handle);
+    }
+
+    template<class T>
+    bool db_read(T *value, long int offset) {
+        if (!_db_file) {
+            return false;
+        }
+        fseek(_db_file, offset, SEEK_SET);
+        return fread(value, sizeof(T), 1, _db_file) == 1;
+    }
+
+    template<class T>
+    bool db_write(const T *value, long int offset) {
+        if (!_db_file) {
+            return false;
+        }
+        fseek(_db_file, offset, SEEK_SET);
+        return fwrite(value, sizeof(T), 1, _db_file) == 1;
+    }
+
+    virtual size_t get_entry_count();
+
+    virtual SecurityDistributionFlags_t* get_entry_handle_by_index(size_t index);
+
+    virtual void reset_entry(entry_handle_t db_handle);
+
+    virtual SecurityEntryIdentity_t* read_in_entry_peer_identity(entry_handle_t db_handle);
+    virtual SecurityEntryKeys_t* read_in_entry_peer_keys(entry_handle_t db_handle);
+    virtual SecurityEntryKeys_t* read_in_entry_local_keys(entry_handle_t db_handle);
+    virtual SecurityEntrySigning_t* read_in_entry_peer_signing(entry_handle_t db_handle);
+
+    /**
+     * Zero the db file.
+     * @param db_file filehandle for file to erase
+     * @param max_entries number of entries held by the database
+     * @return filehandle when successful, otherwise NULL
+     */
+    static FILE* erase_db_file(FILE* db_file, size_t max_entries);
+
+    entry_t* get_entry(size_t index) {
+        return &_entries[index];
+    }
+
+    size_t index_of(const entry_t *entry) const {
+        return entry - _entries;
+    }
+
+    size_t hash_address(const address_t &address, bool is_public) const;
+
+    void index_address(size_t index);
+    void unindex_address(size_t index);
+    void index_identity(size_t index);
+    void unindex_identity(size_t index);
+
+    /**
+     * Move opened entries whose peer address was changed through their flags
+     * to the matching bucket.
+     */
+    void reindex_opened_entries();
+
+    void remove_opened(entry_t *entry);
+
+    /**
+     * Take an entry out of the free list, or recycle the least recently used
+     * disconnected one.
+     */
+    entry_t* allocate_entry();
+    void release_entry(entry_t *entry);
+
+    /**
+     * Return the record of an entry for modification, it will be written
+     * at the next flush.
+     */
+    record_t* modify_record(entry_t *entry);
+
+    /**
+     * Return the current content of an entry's record.
+     */
+    const record_t* read_record(entry_t *entry);
+
+    dirty_record_t* find_dirty(size_t index);
+
+    /**
+     * Write all the modified records and local data as one transaction.
+     */
+    void flush();
+
+    /**
+     * Apply a journal committed but not applied before reset.
+     */
+    void replay_journal();
+
+    void load_entries();
+
+    void reset_ram();
+
+    long int record_offset(size_t index) const;
+    long int gatt_cache_offset(size_t index) const;
+
+private:
+    FILE *_db_file;
+    const size_t _max_entries;
+    entry_t *_entries;
+    uint16_t *_address_index;
+    uint16_t *_identity_index;
+    size_t _index_mask;
+    uint16_t _free_list;
+    uint16_t _opened_list;
+    uint32_t _use_counter;
+    uint32_t _gatt_cache_tag;
+    dirty_record_t _dirty[MAX_DIRTY_ENTRIES];
+    size_t _dirty_count;
+    bool _local_dirty;
+    record_t _buffer;
+    uint8_t _gatt_cache[MAX_GATT_CACHE_SIZE];
+};
+
+} /* namespace pal */
+} /* namespace ble */
+
+#endif /*GENERIC_INDEXED_FILE_SECURITY_DB_H_*/
@@ -19,6 +19,9 @@
 
 #include "SecurityDb.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 namespace ble {
 namespace generic {
 
@@ -26,12 +29,14 @@ namespace generic {
 class MemorySecurityDb : public SecurityDb {
 private:
     struct entry_t {
-        entry_t() { };
+        entry_t() : gatt_cache(NULL), gatt_cache_size(0) { };
         SecurityDistributionFlags_t flags;
         SecurityEntryKeys_t local_keys;
         SecurityEntryKeys_t peer_keys;
         SecurityEntryIdentity_t peer_identity;
         SecurityEntrySigning_t peer_signing;
+        uint8_t *gatt_cache;
+        uint16_t gatt_cache_size;
     };
 
     static const size_t MAX_ENTRIES = 5;
@@ -43,7 +48,11 @@ private:
 
 public:
     MemorySecurityDb() : SecurityDb() { }
-    virtual ~MemorySecurityDb() { }
+    virtual ~MemorySecurityDb() {
+        for (size_t i = 0; i < MAX_ENTRIES; i++) {
+            free(_entries[i].gatt_cache);
+        }
+    }
 
     virtual SecurityDistributionFlags_t* get_distribution_flags(
         entry_handle_t db_handle
@@ -148,12 +157,47 @@ public:
         }
     }
 
+    /* attribute cache */
+
+    virtual ArrayView<const uint8_t> get_entry_gatt_cache(
+        entry_handle_t db_handle
+    ) {
+        entry_t *entry = as_entry(db_handle);
+        if (!entry || !entry->gatt_cache) {
+            return ArrayView<const uint8_t>();
+        }
+        return ArrayView<const uint8_t>(entry->gatt_cache, entry->gatt_cache_size);
+    }
+
+    virtual void set_entry_gatt_cache(
+        entry_handle_t db_handle,
+        const ArrayView<const uint8_t> &cache
+    ) {
+        entry_t *entry = as_entry(db_handle);
+        if (!entry || cache.size() > MAX_GATT_CACHE_SIZE) {
+            return;
+        }
+
+        uint8_t *gatt_cache = NULL;
+        if (cache.size()) {
+            /* a stale cache must not survive a failed update */
+            gatt_cache = (uint8_t*) malloc(cache.size());
+            if (gatt_cache) {
+                memcpy(gatt_cache, cache.data(), cache.size());
+            }
+        }
+
+        free(entry->gatt_cache);
+        entry->gatt_cache = gatt_cache;
+        entry->gatt_cache_size = gatt_cache ? cache.size() : 0;
+    }
+
 private:
-    virtual uint8_t get_entry_count() {
+    virtual size_t get_entry_count() {
         return MAX_ENTRIES;
     }
 
-    virtual SecurityDistributionFlags_t* get_entry_handle_by_index(uint8_t index) {
+    virtual SecurityDistributionFlags_t* get_entry_handle_by_index(size_t index) {
         if (index < MAX_ENTRIES) {
             return &_entries[index].flags;
         } else {
@@ -163,6 +207,7 @@ private:
 
     virtual void reset_entry(entry_handle_t db_entry) {
         entry_t *entry = reinterpret_cast<entry_t*>(db_entry);
+        free(entry->gatt_cache);
         *entry = entry_t();
     }
 
@@ -0,0 +1,112 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_BLE_RESOLVED_ADDRESS_CACHE
+#define MBED_BLE_RESOLVED_ADDRESS_CACHE
+
+#include "ble/BLETypes.h"
+#include "platform/NonCopyable.h"
+
+namespace ble {
+namespace generic {
+
+/**
+ * Cache of the results of private resolvable address resolutions.
+ *
+ * Addresses which did not resolve are cached as well; a peer rotates its
+ * private address at a slow pace, results are valid until they expire.
+ */
+class ResolvedAddressCache : mbed::NonCopyable<ResolvedAddressCache> {
+public:
+    /**
+     * Result of a resolution.
+     */
+    struct identity_t {
+        identity_t() : address(), is_public(false), resolved(false) { }
+
+        /** identity address of the peer */
+        address_t address;
+        /** true if the identity address is public */
+        bool is_public;
+        /** false if the address did not resolve to any identity */
+        bool resolved;
+    };
+
+    /**
+     * Construct a cache.
+     *
+     * @param capacity Number of addresses held, rounded up to a power of two.
+     * @param timeout_ms Lifetime of a result in milliseconds.
+     */
+    ResolvedAddressCache(size_t capacity, uint32_t timeout_ms);
+
+    ~ResolvedAddressCache();
+
+    /**
+     * Look up the result of a previous resolution.
+     *
+     * @param[in] address The private resolvable address.
+     * @param[in] now_ms Current time in milliseconds.
+     * @param[out] identity The result cached.
+     *
+     * @return true if a result which has not expired is cached.
+     */
+    bool find(const address_t &address, uint32_t now_ms, identity_t &identity);
+
+    /**
+     * Store the result of a resolution, it replaces the oldest result if
+     * there is no room left.
+     *
+     * @param[in] address The private resolvable address.
+     * @param[in] identity The result of the resolution.
+     * @param[in] now_ms Current time in milliseconds.
+     */
+    void add(const address_t &address, const identity_t &identity, uint32_t now_ms);
+
+    /**
+     * Drop the addresses which did not resolve.
+     */
+    void remove_unresolved();
+
+    /**
+     * Drop all the results.
+     */
+    void clear();
+
+private:
+    struct entry_t {
+        address_t address;
+        address_t identity_address;
+        uint32_t time;
+        uint8_t used:1;
+        uint8_t resolved:1;
+        uint8_t identity_is_public:1;
+    };
+
+    size_t slot(const address_t &address) const;
+
+    bool expired(const entry_t &entry, uint32_t now_ms) const;
+
+    entry_t *_entries;
+    size_t _mask;
+    size_t _probes;
+    uint32_t _timeout;
+};
+
+} // namespace generic
+} // namespace ble
+
+#endif /* MBED_BLE_RESOLVED_ADDRESS_CACHE */
@@ -113,6 +113,11 @@ public:
      */
     typedef void* entry_handle_t;
 
+    /**
+     * Maximum size of the GATT attribute cache stored per entry.
+     */
+    static const size_t MAX_GATT_CACHE_SIZE = 512;
+
     /* callbacks for asynchronous data retrieval from the security db */
 
     typedef mbed::Callback<void(entry_handle_t, const SecurityEntryKeys_t*)>
@@ -383,6 +388,36 @@ public:
         sign_count_t sign_counter
     ) = 0;
 
+    /* attribute cache */
+
+    /**
+     * Return the GATT attribute cache of a bonded peer.
+     *
+     * The content is opaque to the database; it is produced and consumed by
+     * the GATT client. The view returned is valid until the next call to the
+     * database.
+     *
+     * @param[in] db_handle handle of the entry being queried.
+     * @return the cache stored or an empty view if there is none.
+     */
+    virtual ArrayView<const uint8_t> get_entry_gatt_cache(
+        entry_handle_t db_handle
+    ) {
+        return ArrayView<const uint8_t>();
+    }
+
+    /**
+     * Update the GATT attribute cache of a bonded peer.
+     *
+     * @param[in] db_handle handle of the entry being updated.
+     * @param[in] cache new cache content, an empty view erases the cache.
+     * Caches larger than MAX_GATT_CACHE_SIZE are not stored.
+     */
+    virtual void set_entry_gatt_cache(
+        entry_handle_t db_handle,
+        const ArrayView<const uint8_t> &cache
+    ) { };
+
     /* local csrk */
 
     /**
@@ -697,14 +732,14 @@ private:
      * How many entries can be stored in the databes.
      * @return max number of entries
      */
-    virtual uint8_t get_entry_count() = 0;
+    virtual size_t get_entry_count() = 0;
 
     /**
      * Return database entry based on its index.
      * @param index index from 0 to get_entry_count()
      * @return databse entry stored at index
      */
-    virtual SecurityDistributionFlags_t* get_entry_handle_by_index(uint8_t index) = 0;
+    virtual SecurityDistributionFlags_t* get_entry_handle_by_index(size_t index) = 0;
 
     /**
      * Delete all the information.
@@ -0,0 +1,77 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_BLE_ADDRESS_RESOLUTION_MONITOR
+#define MBED_BLE_ADDRESS_RESOLUTION_MONITOR
+
+#include "ble/BLETypes.h"
+
+namespace ble {
+namespace pal {
+
+/**
+ * Implemented by GAP implementations receiving private resolvable addresses
+ * the controller did not resolve. The resolution is delegated to the event
+ * handler registered.
+ */
+class AddressResolutionMonitor {
+public:
+    /**
+     * Implemented by classes holding the identities of bonded peers.
+     */
+    class EventHandler {
+    public:
+        /**
+         * Resolve a private resolvable address.
+         *
+         * @param[in] address The address to resolve.
+         * @param[out] identity_address Identity address of the peer owning
+         * the address.
+         * @param[out] identity_address_is_public True if the identity address
+         * is public, false if it is static random.
+         *
+         * @return true if one of the identities known resolves the address.
+         */
+        virtual bool resolve_private_address(
+            const address_t &address,
+            address_t &identity_address,
+            bool &identity_address_is_public
+        ) = 0;
+    };
+
+    /**
+     * Register the handler resolving addresses.
+     *
+     * @param[in] address_resolution_event_handler Event handler being registered.
+     */
+    virtual void set_address_resolution_event_handler(
+        EventHandler *address_resolution_event_handler
+    ) = 0;
+
+    /**
+     * Called by the event handler when the identities it holds changed;
+     * addresses which could not be resolved before may now be resolvable.
+     *
+     * @param[in] identities_removed True if identities have been removed,
+     * addresses resolved before may not be resolvable anymore.
+     */
+    virtual void on_resolvable_identities_changed(bool identities_removed) = 0;
+};
+
+} // namespace pal
+} // namespace ble
+
+#endif /* MBED_BLE_ADDRESS_RESOLUTION_MONITOR */
@@ -558,6 +558,13 @@ struct AttReadMultipleResponse : public AttServerMessage {
         return _data[index];
     }
 
+    /**
+     * Return the pointer to the actual data
+     */
+    const uint8_t* data() const {
+        return _data.data();
+    }
+
 private:
     const ArrayView<const uint8_t> _data;
 };
@@ -0,0 +1,75 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_BLE_ATTRIBUTE_CACHE_MONITOR
+#define MBED_BLE_ATTRIBUTE_CACHE_MONITOR
+
+#include "ble/BLETypes.h"
+#include "ble/ArrayView.h"
+
+namespace ble {
+namespace pal {
+
+/**
+ * Implemented by GATT clients able to cache the attributes discovered on a
+ * peer. The storage of the cache is delegated to the event handler registered.
+ */
+class AttributeCacheMonitor {
+public:
+    /**
+     * Implemented by classes storing the attribute cache of peers.
+     */
+    class EventHandler {
+    public:
+        /**
+         * Return the attribute cache of the peer connected.
+         *
+         * @param[in] connection connection handle
+         *
+         * @return The cache of the peer or an empty view if the peer is not
+         * bonded or nothing has been cached. The view is valid until the next
+         * call to the handler.
+         */
+        virtual ArrayView<const uint8_t> get_attribute_cache(
+            connection_handle_t connection
+        ) = 0;
+
+        /**
+         * Store a new attribute cache for the peer connected.
+         *
+         * @param[in] connection connection handle
+         * @param[in] cache content to store, an empty view erases the cache.
+         */
+        virtual void on_attribute_cache_updated(
+            connection_handle_t connection,
+            const ArrayView<const uint8_t> &cache
+        ) = 0;
+    };
+
+    /**
+     * Register the handler storing attribute caches.
+     *
+     * @param[in] attribute_cache_event_handler Event handler being registered.
+     */
+    virtual void set_attribute_cache_event_handler(
+        EventHandler *attribute_cache_event_handler
+    ) = 0;
+};
+
+} // namespace pal
+} // namespace ble
+
+#endif /* MBED_BLE_ATTRIBUTE_CACHE_MONITOR */
@@ -0,0 +1,119 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <new>
+
+#include "ble/generic/AdvertisingDuplicateFilter.h"
+
+namespace ble {
+namespace generic {
+
+namespace {
+
+uint32_t hash(const uint8_t *data, size_t size, uint32_t value = 2166136261UL)
+{
+    /* FNV-1a */
+    for (size_t i = 0; i < size; ++i) {
+        value = (value ^ data[i]) * 16777619UL;
+    }
+    return value;
+}
+
+}
+
+AdvertisingDuplicateFilter::AdvertisingDuplicateFilter(size_t capacity) :
+    _entries(NULL),
+    _mask(0),
+    _window(0)
+{
+    size_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+
+    _entries = new (std::nothrow) entry_t[slots];
+    if (_entries) {
+        _mask = slots - 1;
+    }
+
+    clear();
+}
+
+AdvertisingDuplicateFilter::~AdvertisingDuplicateFilter()
+{
+    delete [] _entries;
+}
+
+void AdvertisingDuplicateFilter::set_window(uint32_t window_ms)
+{
+    _window = window_ms;
+    clear();
+}
+
+bool AdvertisingDuplicateFilter::is_duplicate(
+    const address_t &address,
+    uint8_t address_type,
+    uint8_t advertising_type,
+    const ArrayView<const uint8_t> &data,
+    uint32_t now_ms
+) {
+    if (!_window || !_entries) {
+        return false;
+    }
+
+    const uint8_t types[] = { address_type, advertising_type };
+    uint32_t key = hash(address.data(), address.size());
+    key = hash(types, sizeof(types), key);
+    key = hash(data.data(), data.size(), key);
+    if (key == 0) {
+        key = 1;
+    }
+
+    /* two slots per report, the oldest one is replaced */
+    entry_t &first = _entries[key & _mask];
+    entry_t &second = _entries[(key >> 16) & _mask];
+
+    entry_t *entry = NULL;
+    if (first.key == key) {
+        entry = &first;
+    } else if (second.key == key) {
+        entry = &second;
+    }
+
+    if (entry && (now_ms - entry->time) < _window) {
+        return true;
+    }
+
+    if (!entry) {
+        entry = (first.key && (!second.key || (now_ms - first.time) < (now_ms - second.time))) ?
+            &second : &first;
+    }
+
+    entry->key = key;
+    entry->time = now_ms;
+    return false;
+}
+
+void AdvertisingDuplicateFilter::clear()
+{
+    for (size_t i = 0; _entries && i <= _mask; ++i) {
+        _entries[i].key = 0;
+        _entries[i].time = 0;
+    }
+}
+
+} // namespace generic
+} // namespace ble
@@ -19,7 +19,9 @@
 namespace ble {
 namespace generic {
 
-const uint16_t DB_VERSION = 1;
+const uint16_t DB_VERSION = 2;
+/* version 1 files lack the attribute caches appended to the stores */
+const uint16_t DB_VERSION_WITHOUT_GATT_CACHE = 1;
 
 #define DB_STORE_OFFSET_FLAGS         (0)
 #define DB_STORE_OFFSET_LOCAL_KEYS    (DB_STORE_OFFSET_FLAGS + sizeof(SecurityDistributionFlags_t))
@@ -41,6 +43,9 @@ const uint16_t DB_VERSION = 1;
 
 #define DB_STORE_OFFSET_PEER_SIGNING_COUNT (DB_STORE_OFFSET_PEER_SIGNING + sizeof(csrk_t))
 
+#define DB_GATT_CACHE_OFFSET_SIZE (0)
+#define DB_GATT_CACHE_OFFSET_DATA (DB_GATT_CACHE_OFFSET_SIZE + sizeof(uint16_t))
+
 /* make size multiple of 4 */
 #define PAD4(value) ((((value - 1) / 4) * 4) + 4)
 
@@ -62,7 +67,17 @@ const uint16_t DB_VERSION = 1;
 #define DB_OFFSET_LOCAL_CSRK       (DB_OFFSET_LOCAL_IDENTITY + sizeof(SecurityEntryIdentity_t))
 #define DB_OFFSET_LOCAL_SIGN_COUNT (DB_OFFSET_LOCAL_CSRK + sizeof(csrk_t))
 #define DB_OFFSET_STORES           (DB_OFFSET_LOCAL_SIGN_COUNT + sizeof(sign_count_t))
-#define DB_OFFSET_MAX              (DB_OFFSET_STORES + DB_SIZE_STORES)
+#define DB_OFFSET_MAX_V1           (DB_OFFSET_STORES + DB_SIZE_STORES)
+#define DB_SIZE_V1                 PAD4(DB_OFFSET_MAX_V1)
+
+#define DB_SIZE_GATT_CACHE \
+    PAD4(sizeof(uint16_t) + SecurityDb::MAX_GATT_CACHE_SIZE)
+
+#define DB_SIZE_GATT_CACHES \
+    (FileSecurityDb::MAX_ENTRIES * DB_SIZE_GATT_CACHE)
+
+#define DB_OFFSET_GATT_CACHES      (DB_SIZE_V1)
+#define DB_OFFSET_MAX              (DB_OFFSET_GATT_CACHES + DB_SIZE_GATT_CACHES)
 #define DB_SIZE                    PAD4(DB_OFFSET_MAX)
 
 typedef SecurityDb::entry_handle_t entry_handle_t;
@@ -73,6 +88,8 @@ FileSecurityDb::FileSecurityDb(FILE *db_file)
     /* init the offset in entries so they point to file positions */
     for (size_t i = 0; i < get_entry_count(); i++) {
         _entries[i].file_offset = DB_OFFSET_STORES + i * DB_SIZE_STORE;
+        _entries[i].gatt_cache_offset = DB_OFFSET_GATT_CACHES + i * DB_SIZE_GATT_CACHE;
+        _entries[i].gatt_cache_size = 0;
     }
 }
 
@@ -105,13 +122,20 @@ FILE* FileSecurityDb::open_db_file(const char *db_path) {
 
     fseek(db_file, DB_OFFSET_VERSION, SEEK_SET);
 
-    if ((fread(&version, sizeof(version), 1, db_file) == 1) &&
-        (version == DB_VERSION)) {
+    if (fread(&version, sizeof(version), 1, db_file) != 1) {
+        init = true;
+    } else if (version == DB_VERSION) {
         /* if file size differs from database size init the file */
         fseek(db_file, 0, SEEK_END);
         if (ftell(db_file) != DB_SIZE) {
             init = true;
         }
+    } else if (version == DB_VERSION_WITHOUT_GATT_CACHE) {
+        /* keep the bonds, the stores are laid out the same */
+        fseek(db_file, 0, SEEK_END);
+        if (ftell(db_file) != DB_SIZE_V1 || !append_gatt_caches(db_file)) {
+            init = true;
+        }
     } else {
         init = true;
     }
@@ -123,6 +147,25 @@ FILE* FileSecurityDb::open_db_file(const char *db_path) {
     return db_file;
 }
 
+bool FileSecurityDb::append_gatt_caches(FILE* db_file) {
+    /* empty caches follow the stores */
+    fseek(db_file, DB_OFFSET_GATT_CACHES, SEEK_SET);
+    const uint32_t zero = 0;
+    size_t count = (DB_SIZE - DB_OFFSET_GATT_CACHES) / 4;
+    while (count--) {
+        if (fwrite(&zero, sizeof(zero), 1, db_file) != 1) {
+            return false;
+        }
+    }
+
+    fseek(db_file, DB_OFFSET_VERSION, SEEK_SET);
+    if (fwrite(&DB_VERSION, sizeof(DB_VERSION), 1, db_file) != 1) {
+        return false;
+    }
+
+    return fflush(db_file) == 0;
+}
+
 FILE* FileSecurityDb::erase_db_file(FILE* db_file) {
     fseek(db_file, 0, SEEK_SET);
 
@@ -265,6 +308,47 @@ void FileSecurityDb::set_entry_peer_sign_counter(
     }
 }
 
+/* attribute cache */
+
+ArrayView<const uint8_t> FileSecurityDb::get_entry_gatt_cache(
+    entry_handle_t db_handle
+) {
+    entry_t *entry = as_entry(db_handle);
+    if (!entry || !entry->gatt_cache_size) {
+        return ArrayView<const uint8_t>();
+    }
+
+    fseek(_db_file, entry->gatt_cache_offset + DB_GATT_CACHE_OFFSET_DATA, SEEK_SET);
+    if (fread(_gatt_cache, entry->gatt_cache_size, 1, _db_file) != 1) {
+        return ArrayView<const uint8_t>();
+    }
+
+    return ArrayView<const uint8_t>(_gatt_cache, entry->gatt_cache_size);
+}
+
+void FileSecurityDb::set_entry_gatt_cache(
+    entry_handle_t db_handle,
+    const ArrayView<const uint8_t> &cache
+) {
+    entry_t *entry = as_entry(db_handle);
+    if (!entry) {
+        return;
+    }
+
+    /* a cache that doesn't fit is dropped rather than left stale */
+    uint16_t size = cache.size() > MAX_GATT_CACHE_SIZE ? 0 : cache.size();
+
+    if (size) {
+        fseek(_db_file, entry->gatt_cache_offset + DB_GATT_CACHE_OFFSET_DATA, SEEK_SET);
+        if (fwrite(cache.data(), size, 1, _db_file) != 1) {
+            size = 0;
+        }
+    }
+
+    entry->gatt_cache_size = size;
+    db_write(&size, entry->gatt_cache_offset + DB_GATT_CACHE_OFFSET_SIZE);
+}
+
 /* saving and loading from nvm */
 
 void FileSecurityDb::restore() {
@@ -287,6 +371,10 @@ void FileSecurityDb::restore() {
     for (size_t i = 0; i < get_entry_count(); i++) {
         db_read(&_entries[i].flags, _entries[i].file_offset + DB_STORE_OFFSET_FLAGS);
         db_read(&_entries[i].peer_sign_counter, _entries[i].file_offset + DB_STORE_OFFSET_PEER_SIGNING_COUNT);
+        db_read(&_entries[i].gatt_cache_size, _entries[i].gatt_cache_offset + DB_GATT_CACHE_OFFSET_SIZE);
+        if (_entries[i].gatt_cache_size > MAX_GATT_CACHE_SIZE) {
+            _entries[i].gatt_cache_size = 0;
+        }
     }
 
 }
@@ -307,11 +395,11 @@ void FileSecurityDb::set_restore(bool reload) {
 
 /* helper functions */
 
-uint8_t FileSecurityDb::get_entry_count() {
+size_t FileSecurityDb::get_entry_count() {
     return MAX_ENTRIES;
 }
 
-SecurityDistributionFlags_t* FileSecurityDb::get_entry_handle_by_index(uint8_t index) {
+SecurityDistributionFlags_t* FileSecurityDb::get_entry_handle_by_index(size_t index) {
     if (index < MAX_ENTRIES) {
         return &_entries[index].flags;
     } else {
@@ -334,6 +422,7 @@ void FileSecurityDb::reset_entry(entry_handle_t db_entry) {
 
     entry->flags = SecurityDistributionFlags_t();
     entry->peer_sign_counter = 0;
+    entry->gatt_cache_size = 0;
 }
 
 SecurityEntryIdentity_t* FileSecurityDb::read_in_entry_peer_identity(entry_handle_t db_entry) {
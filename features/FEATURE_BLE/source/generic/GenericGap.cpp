@@ -27,6 +27,19 @@
 #include "ble/generic/GenericGap.h"
 
 #include "drivers/Timeout.h"
+#include "hal/us_ticker_api.h"
+
+#ifndef MBED_CONF_BLE_RESOLUTION_CACHE_SIZE
+#define MBED_CONF_BLE_RESOLUTION_CACHE_SIZE 16
+#endif
+
+#ifndef MBED_CONF_BLE_RESOLUTION_CACHE_TIMEOUT
+#define MBED_CONF_BLE_RESOLUTION_CACHE_TIMEOUT 900000
+#endif
+
+#ifndef MBED_CONF_BLE_ADVERTISING_DUPLICATE_FILTER_SIZE
+#define MBED_CONF_BLE_ADVERTISING_DUPLICATE_FILTER_SIZE 32
+#endif
 
 namespace ble {
 namespace generic {
@@ -415,7 +428,15 @@ GenericGap::GenericGap(
     _random_address_rotating(false),
     _advertising_timeout(),
     _scan_timeout(),
-    _connection_event_handler(NULL)
+    _connection_event_handler(NULL),
+    _address_resolution_event_handler(NULL),
+    _resolved_address_cache(
+        MBED_CONF_BLE_RESOLUTION_CACHE_SIZE,
+        MBED_CONF_BLE_RESOLUTION_CACHE_TIMEOUT
+    ),
+    _advertising_duplicate_filter(MBED_CONF_BLE_ADVERTISING_DUPLICATE_FILTER_SIZE),
+    _advertising_report_batch_handler(),
+    _advertising_report_statistics()
 {
     _pal_gap.initialize();
 
@@ -950,6 +971,9 @@ ble_error_t GenericGap::startRadioScan(const GapScanningParams &scanningParams)
         return err;
     }
 
+    // a new scan reports every advertiser again
+    _advertising_duplicate_filter.clear();
+
     _scan_timeout.detach();
     uint16_t timeout = scanningParams.getTimeout();
     if (timeout) {
@@ -1232,34 +1256,111 @@ void GenericGap::on_gap_event_received(const pal::GapEvent& e)
 
 void GenericGap::on_advertising_report(const pal::GapAdvertisingReportEvent& e)
 {
+    static const size_t max_batch_size = 8;
+    AdvertisementCallbackParams_t batch[max_batch_size];
+    size_t batch_size = 0;
+
+    const uint32_t now_ms = ticker_read_us(get_us_ticker_data()) / 1000;
+
     for (size_t i = 0; i < e.size(); ++i) {
         pal::GapAdvertisingReportEvent::advertising_t advertising = e[i];
+        ++_advertising_report_statistics.received;
+
+        // note 1-to-1 conversion between connection_peer_address_type_t and
+        // peer_address_type_t
+        peer_address_type_t peer_address_type =
+            static_cast<peer_address_type_t::type>(advertising.address_type.value());
+        ble::address_t peer_address = advertising.address;
 
         // Check if the address hasn't been resolved
-        if(_privacy_enabled &&
-            _central_privacy_configuration.resolution_strategy == CentralPrivacyConfiguration_t::RESOLVE_AND_FILTER &&
+        if (_privacy_enabled &&
+            _central_privacy_configuration.resolution_strategy != CentralPrivacyConfiguration_t::DO_NOT_RESOLVE &&
             advertising.address_type == pal::connection_peer_address_type_t::RANDOM_ADDRESS &&
-            is_random_private_resolvable_address(advertising.address.data())
+            is_random_private_resolvable_address(advertising.address.data()) &&
+            !resolve_private_address(peer_address, peer_address_type) &&
+            _central_privacy_configuration.resolution_strategy == CentralPrivacyConfiguration_t::RESOLVE_AND_FILTER
         ) {
             // Filter it out
+            ++_advertising_report_statistics.unresolved_filtered;
             continue;
         }
 
-        // note 1-to-1 conversion between connection_peer_address_type_t and
-        // peer_address_type_t
-        peer_address_type_t peer_address_type =
-            static_cast<peer_address_type_t::type>(advertising.address_type.value());
+        if (_advertising_duplicate_filter.is_duplicate(
+                peer_address,
+                peer_address_type.value(),
+                advertising.type.value(),
+                advertising.data,
+                now_ms
+            )
+        ) {
+            ++_advertising_report_statistics.duplicates_filtered;
+            continue;
+        }
+
+        ++_advertising_report_statistics.delivered;
+
+        if (!_advertising_report_batch_handler) {
+            processAdvertisementReport(
+                peer_address.data(),
+                advertising.rssi,
+                advertising.type == pal::received_advertising_type_t::SCAN_RESPONSE,
+                (GapAdvertisingParams::AdvertisingType_t) advertising.type.value(),
+                advertising.data.size(),
+                advertising.data.data(),
+                peer_address_type
+            );
+            continue;
+        }
+
+        AdvertisementCallbackParams_t &params = batch[batch_size++];
+        memcpy(params.peerAddr, peer_address.data(), peer_address.size());
+        params.rssi = advertising.rssi;
+        params.isScanResponse =
+            advertising.type == pal::received_advertising_type_t::SCAN_RESPONSE;
+        params.type = (GapAdvertisingParams::AdvertisingType_t) advertising.type.value();
+        params.advertisingDataLen = advertising.data.size();
+        params.advertisingData = advertising.data.data();
+        params.peerAddrType = peer_address_type;
+
+        if (batch_size == max_batch_size) {
+            _advertising_report_batch_handler(batch, batch_size);
+            batch_size = 0;
+        }
+    }
+
+    if (batch_size) {
+        _advertising_report_batch_handler(batch, batch_size);
+    }
+}
 
-        processAdvertisementReport(
-            advertising.address.data(),
-            advertising.rssi,
-            advertising.type == pal::received_advertising_type_t::SCAN_RESPONSE,
-            (GapAdvertisingParams::AdvertisingType_t) advertising.type.value(),
-            advertising.data.size(),
-            advertising.data.data(),
-            peer_address_type
+bool GenericGap::resolve_private_address(
+    ble::address_t &address,
+    peer_address_type_t &address_type
+) {
+    const uint32_t now_ms = ticker_read_us(get_us_ticker_data()) / 1000;
+    ResolvedAddressCache::identity_t identity;
+
+    if (_resolved_address_cache.find(address, now_ms, identity)) {
+        ++_advertising_report_statistics.resolution_cache_hits;
+    } else if (_address_resolution_event_handler) {
+        ++_advertising_report_statistics.resolutions;
+        identity.resolved = _address_resolution_event_handler->resolve_private_address(
+            address,
+            identity.address,
+            identity.is_public
         );
+        _resolved_address_cache.add(address, identity, now_ms);
     }
+
+    if (!identity.resolved) {
+        return false;
+    }
+
+    address = identity.address;
+    address_type = identity.is_public ?
+        peer_address_type_t::PUBLIC_IDENTITY :
+        peer_address_type_t::RANDOM_STATIC_IDENTITY;
+    return true;
 }
 
 void GenericGap::on_connection_complete(const pal::GapConnectionCompleteEvent& e)
@@ -1555,5 +1656,43 @@ void GenericGap::set_connection_event_handler(pal::ConnectionEventMonitor::Event
     _connection_event_handler = connection_event_handler;
 }
 
+void GenericGap::set_address_resolution_event_handler(
+    pal::AddressResolutionMonitor::EventHandler *address_resolution_event_handler
+) {
+    _address_resolution_event_handler = address_resolution_event_handler;
+    _resolved_address_cache.clear();
+}
+
+void GenericGap::on_resolvable_identities_changed(bool identities_removed)
+{
+    if (identities_removed) {
+        _resolved_address_cache.clear();
+    } else {
+        // only addresses which did not resolve may resolve now
+        _resolved_address_cache.remove_unresolved();
+    }
+}
+
+void GenericGap::set_advertising_duplicate_filter(uint32_t window_ms)
+{
+    _advertising_duplicate_filter.set_window(window_ms);
+}
+
+void GenericGap::set_advertising_report_batch_handler(
+    const AdvertisementReportBatchHandler_t &handler
+) {
+    _advertising_report_batch_handler = handler;
+}
+
+const GenericGap::AdvertisingReportStatistics_t &GenericGap::get_advertising_report_statistics() const
+{
+    return _advertising_report_statistics;
+}
+
+void GenericGap::reset_advertising_report_statistics()
+{
+    _advertising_report_statistics = AdvertisingReportStatistics_t();
+}
+
 } // namespace generic
 } // namespace ble
@@ -16,6 +16,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <ble/DiscoveredService.h>
 #include <ble/DiscoveredCharacteristic.h>
@@ -28,6 +29,7 @@
 using ble::pal::AttServerMessage;
 using ble::pal::AttReadResponse;
 using ble::pal::AttReadBlobResponse;
+using ble::pal::AttReadMultipleResponse;
 using ble::pal::AttReadByTypeResponse;
 using ble::pal::AttReadByGroupTypeResponse;
 using ble::pal::AttFindByTypeValueResponse;
@@ -44,6 +46,8 @@ using ble::pal::AttFindInformationResponse;
 #define WRITE_HEADER_LENGTH 3
 #define CMAC_LENGTH 8
 #define MAC_COUNTER_LENGTH 4
+#define READ_MULTIPLE_HEADER_LENGTH 1
+#define READ_MULTIPLE_MAX_HANDLES 16
 
 namespace ble {
 namespace generic {
@@ -55,7 +59,310 @@ enum procedure_type_t {
 	COMPLETE_DISCOVERY_PROCEDURE,
 	READ_PROCEDURE,
 	WRITE_PROCEDURE,
-	DESCRIPTOR_DISCOVERY_PROCEDURE
+	DESCRIPTOR_DISCOVERY_PROCEDURE,
+	CACHE_VERIFICATION_PROCEDURE
+};
+
+/*
+ * Length of the values which the Bluetooth specifications define with a
+ * fixed size, 0 for the other values. Only values of such attributes can
+ * be told apart in a Read Multiple Response.
+ */
+static uint16_t get_specified_value_length(const UUID& uuid) {
+	if (uuid.shortOrLong() != UUID::UUID_TYPE_SHORT) {
+		return 0;
+	}
+
+	switch (uuid.getShortUUID()) {
+		case GattCharacteristic::UUID_ALERT_LEVEL_CHAR:
+		case GattCharacteristic::UUID_BATTERY_LEVEL_CHAR:
+		case GattCharacteristic::UUID_BODY_SENSOR_LOCATION_CHAR:
+		case GattCharacteristic::UUID_DAY_OF_WEEK_CHAR:
+		case GattCharacteristic::UUID_DST_OFFSET_CHAR:
+		case GattCharacteristic::UUID_TX_POWER_LEVEL_CHAR:
+		case BLE_UUID_GAP_CHARACTERISTIC_PPF:
+			return 1;
+
+		case BLE_UUID_DESCRIPTOR_CHAR_EXT_PROP:
+		case BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG:
+		case BLE_UUID_DESCRIPTOR_SERVER_CHAR_CONFIG:
+		case BLE_UUID_GAP_CHARACTERISTIC_APPEARANCE:
+			return 2;
+
+		case BLE_UUID_GATT_CHARACTERISTIC_SERVICE_CHANGED:
+			return 4;
+
+		case BLE_UUID_GAP_CHARACTERISTIC_RECONN_ADDR:
+			return 6;
+
+		case BLE_UUID_DESCRIPTOR_CHAR_PRESENTATION_FORMAT:
+		case GattCharacteristic::UUID_PNP_ID_CHAR:
+			return 7;
+
+		case BLE_UUID_GAP_CHARACTERISTIC_PPCP:
+		case GattCharacteristic::UUID_SYSTEM_ID_CHAR:
+			return 8;
+
+		default:
+			return 0;
+	}
+}
+
+/*
+ * Attributes discovered on a peer, serialised as a version byte followed by
+ * a sequence of records:
+ *   - service: 'S' | begin | end | uuid
+ *   - characteristic: 'C' | declaration | value | last | properties | uuid
+ *   - descriptors: 'D' | characteristic value handle | count | (handle | uuid)*
+ * Handles are 16 bit little endian values and uuid are prefixed by their
+ * length. Characteristics follow the service containing them.
+ */
+class AttributeCache {
+public:
+	enum record_type_t {
+		SERVICE = 'S',
+		CHARACTERISTIC = 'C',
+		DESCRIPTORS = 'D'
+	};
+
+	struct record_t {
+		uint8_t type;
+		uint16_t begin;
+		uint16_t end;
+		uint16_t value_handle;
+		uint8_t properties;
+		uint8_t count;
+		size_t descriptors;
+		UUID uuid;
+	};
+
+	static const uint8_t VERSION = 1;
+	static const size_t MAX_SIZE = SecurityDb::MAX_GATT_CACHE_SIZE;
+
+	AttributeCache() : _buffer(NULL), _size(0), _overflow(false) { }
+
+	~AttributeCache() {
+		free(_buffer);
+	}
+
+	/*
+	 * Replace the content with a copy of a serialised cache; return false if
+	 * it is absent or in another format.
+	 */
+	bool load(const ArrayView<const uint8_t>& cache) {
+		clear();
+		if (cache.size() == 0 || cache.size() > MAX_SIZE || cache[0] != VERSION) {
+			return false;
+		}
+		append(cache.data(), cache.size());
+		return !_overflow;
+	}
+
+	/*
+	 * Start a new cache.
+	 */
+	void initialize() {
+		clear();
+		write_u8(VERSION);
+	}
+
+	void clear() {
+		free(_buffer);
+		_buffer = NULL;
+		_size = 0;
+		_overflow = false;
+	}
+
+	bool has_overflowed() const {
+		return _overflow;
+	}
+
+	ArrayView<const uint8_t> data() const {
+		return ArrayView<const uint8_t>(_buffer, _size);
+	}
+
+	void write_service(uint16_t begin, uint16_t end, const UUID& uuid) {
+		write_u8(SERVICE);
+		write_u16(begin);
+		write_u16(end);
+		write_uuid(uuid);
+	}
+
+	void write_characteristic(const DiscoveredCharacteristic& characteristic) {
+		const DiscoveredCharacteristic::Properties_t& properties =
+			characteristic.getProperties();
+		uint8_t raw_properties =
+			(properties.broadcast() << 0) |
+			(properties.read() << 1) |
+			(properties.writeWoResp() << 2) |
+			(properties.write() << 3) |
+			(properties.notify() << 4) |
+			(properties.indicate() << 5) |
+			(properties.authSignedWrite() << 6);
+
+		write_u8(CHARACTERISTIC);
+		write_u16(characteristic.getDeclHandle());
+		write_u16(characteristic.getValueHandle());
+		write_u16(characteristic.getLastHandle());
+		write_u8(raw_properties);
+		write_uuid(characteristic.getUUID());
+	}
+
+	void write_descriptors(
+		uint16_t value_handle, uint8_t count, const ArrayView<const uint8_t>& descriptors
+	) {
+		write_u8(DESCRIPTORS);
+		write_u16(value_handle);
+		write_u8(count);
+		append(descriptors.data(), descriptors.size());
+	}
+
+	void write_descriptor(uint16_t handle, const UUID& uuid) {
+		write_u16(handle);
+		write_uuid(uuid);
+	}
+
+	/*
+	 * Read the record at offset and move offset to the next one.
+	 */
+	bool read_record(size_t& offset, record_t& record) const {
+		if (!read_u8(offset, record.type)) {
+			return false;
+		}
+
+		switch (record.type) {
+			case SERVICE:
+				return read_u16(offset, record.begin) &&
+					read_u16(offset, record.end) &&
+					read_uuid(offset, record.uuid);
+
+			case CHARACTERISTIC:
+				return read_u16(offset, record.begin) &&
+					read_u16(offset, record.value_handle) &&
+					read_u16(offset, record.end) &&
+					read_u8(offset, record.properties) &&
+					read_uuid(offset, record.uuid);
+
+			case DESCRIPTORS: {
+				if (!read_u16(offset, record.value_handle) ||
+					!read_u8(offset, record.count)) {
+					return false;
+				}
+				record.descriptors = offset;
+				uint16_t handle;
+				UUID uuid;
+				for (size_t i = 0; i < record.count; ++i) {
+					if (!read_descriptor(offset, handle, uuid)) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			default:
+				return false;
+		}
+	}
+
+	bool read_descriptor(size_t& offset, uint16_t& handle, UUID& uuid) const {
+		return read_u16(offset, handle) && read_uuid(offset, uuid);
+	}
+
+	/*
+	 * Find the descriptors record of a characteristic.
+	 */
+	bool find_descriptors(uint16_t value_handle, record_t& record) const {
+		size_t offset = 1;
+		while (read_record(offset, record)) {
+			if (record.type == DESCRIPTORS && record.value_handle == value_handle) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	void append(const uint8_t* data, size_t size) {
+		if (_overflow || size == 0) {
+			return;
+		}
+
+		if (_size + size > MAX_SIZE) {
+			_overflow = true;
+			return;
+		}
+
+		uint8_t* buffer = (uint8_t*) realloc(_buffer, _size + size);
+		if (buffer == NULL) {
+			_overflow = true;
+			return;
+		}
+
+		memcpy(buffer + _size, data, size);
+		_buffer = buffer;
+		_size += size;
+	}
+
+	void write_u8(uint8_t value) {
+		append(&value, 1);
+	}
+
+	void write_u16(uint16_t value) {
+		uint8_t bytes[2] = { (uint8_t) value, (uint8_t) (value >> 8) };
+		append(bytes, sizeof(bytes));
+	}
+
+	void write_uuid(const UUID& uuid) {
+		if (uuid.shortOrLong() == UUID::UUID_TYPE_SHORT) {
+			write_u8(2);
+			write_u16(uuid.getShortUUID());
+		} else {
+			write_u8(UUID::LENGTH_OF_LONG_UUID);
+			append(uuid.getBaseUUID(), UUID::LENGTH_OF_LONG_UUID);
+		}
+	}
+
+	bool read_u8(size_t& offset, uint8_t& value) const {
+		if (offset + 1 > _size) {
+			return false;
+		}
+		value = _buffer[offset++];
+		return true;
+	}
+
+	bool read_u16(size_t& offset, uint16_t& value) const {
+		if (offset + 2 > _size) {
+			return false;
+		}
+		value = _buffer[offset] | (_buffer[offset + 1] << 8);
+		offset += 2;
+		return true;
+	}
+
+	bool read_uuid(size_t& offset, UUID& uuid) const {
+		uint8_t length;
+		if (!read_u8(offset, length) || offset + length > _size) {
+			return false;
+		}
+
+		if (length == 2) {
+			uuid = UUID(_buffer[offset] | (_buffer[offset + 1] << 8));
+		} else if (length == UUID::LENGTH_OF_LONG_UUID) {
+			uuid = UUID(_buffer + offset, UUID::LSB);
+		} else {
+			return false;
+		}
+		offset += length;
+		return true;
+	}
+
+	// not copyable
+	AttributeCache(const AttributeCache&);
+	AttributeCache& operator=(const AttributeCache&);
+
+	uint8_t* _buffer;
+	size_t _size;
+	bool _overflow;
 };
 
 
@@ -71,6 +378,12 @@ struct GenericGattClient::ProcedureControlBlock {
 
 	virtual ~ProcedureControlBlock() { }
 
+	/*
+	 * Send the first request of the procedure; called once the procedure
+	 * owns the ATT bearer of the connection.
+	 */
+	virtual ble_error_t start(GenericGattClient* client) = 0;
+
 	/*
 	 * Entry point of the control block stack machine.
 	 */
@@ -108,6 +421,7 @@ struct GenericGattClient::DiscoveryControlBlock : public ProcedureControlBlock {
 		matching_service_uuid(matching_service_uuid),
 		matching_characteristic_uuid(matching_characteristic_uuid),
 		services_discovered(NULL),
+		cache(NULL),
 		done(false) {
 	}
 
@@ -117,6 +431,38 @@ struct GenericGattClient::DiscoveryControlBlock : public ProcedureControlBlock {
 			delete services_discovered;
 			services_discovered = tmp;
 		}
+		delete cache;
+	}
+
+	virtual ble_error_t start(GenericGattClient* client) {
+		// discovery terminated while waiting in the queue
+		if (done) {
+			return BLE_ERROR_INVALID_STATE;
+		}
+
+		// only a discovery reporting every attribute fills the cache
+		if (client->_attribute_cache_handler &&
+			characteristic_callback &&
+			matching_service_uuid == UUID() &&
+			matching_characteristic_uuid == UUID()) {
+			cache = new (std::nothrow) AttributeCache();
+			if (cache) {
+				cache->initialize();
+			}
+		}
+
+		if (matching_service_uuid == UUID()) {
+			return client->_pal_client->discover_primary_service(
+				connection_handle,
+				0x0001
+			);
+		} else {
+			return client->_pal_client->discover_primary_service_by_service_uuid(
+				connection_handle,
+				0x0001,
+				matching_service_uuid
+			);
+		}
 	}
 
 	virtual void handle_timeout_error(GenericGattClient* client) {
@@ -231,6 +577,14 @@ struct GenericGattClient::DiscoveryControlBlock : public ProcedureControlBlock {
 			return;
 		}
 
+		if (cache) {
+			cache->write_service(
+				services_discovered->begin,
+				services_discovered->end,
+				services_discovered->uuid
+			);
+		}
+
 		if (service_callback) {
 			DiscoveredService discovered_service;
 			discovered_service.setup(
@@ -255,6 +609,7 @@ struct GenericGattClient::DiscoveryControlBlock : public ProcedureControlBlock {
 		for (size_t i = 0; i < response.size(); ++i) {
 			if (last_characteristic.is_valid() == false) {
 				last_characteristic.set_last_handle(response[i].handle - 1);
+				cache_characteristic();
 				if (matching_characteristic_uuid == UUID()
 				|| last_characteristic.getUUID() == matching_characteristic_uuid) {
 					characteristic_callback(&last_characteristic);
@@ -264,6 +619,11 @@ struct GenericGattClient::DiscoveryControlBlock : public ProcedureControlBlock {
 			last_characteristic = characteristic_t(
 				client, connection_handle, response[i].handle, response[i].value
 			);
+			client->on_characteristic_discovered(
+				connection_handle,
+				last_characteristic.getUUID(),
+				last_characteristic.getValueHandle()
+			);
 		}
 
 		// check if all the characteristics of the service has been discovered
@@ -286,9 +646,10 @@ struct GenericGattClient::DiscoveryControlBlock : public ProcedureControlBlock {
 
 	void handle_all_characteristics_discovered(GenericGattClient* client) {
 		if (last_characteristic.is_valid() == false) {
+			last_characteristic.set_last_handle(services_discovered->end);
+			cache_characteristic();
 			if (matching_characteristic_uuid == UUID()
 				|| matching_characteristic_uuid == last_characteristic.getUUID()) {
-				last_characteristic.set_last_handle(services_discovered->end);
 				characteristic_callback(&last_characteristic);
 			}
 		}
@@ -298,12 +659,30 @@ struct GenericGattClient::DiscoveryControlBlock : public ProcedureControlBlock {
 		delete old;
 
 		if (!services_discovered) {
+			// every service has been walked through
+			if (cache && !done && !cache->has_overflowed()) {
+				client->store_attribute_cache(connection_handle, *cache);
+			}
 			terminate(client);
 		} else {
 			start_characteristic_discovery(client);
 		}
 	}
 
+	void cache_characteristic() {
+		if (cache) {
+			cache->write_characteristic(last_characteristic);
+		}
+	}
+
+	/*
+	 * Stop caching the attributes discovered, they are out of date.
+	 */
+	void discard_cache() {
+		delete cache;
+		cache = NULL;
+	}
+
 	void terminate(GenericGattClient* client) {
 		// unknown error, terminate the procedure immediately
 		client->remove_control_block(this);
@@ -369,6 +748,20 @@ struct GenericGattClient::DiscoveryControlBlock : public ProcedureControlBlock {
 			connHandle = connection_handle;
 		}
 
+		characteristic_t(
+			GattClient* client,
+			Gap::Handle_t connection_handle,
+			const AttributeCache::record_t& record
+		) : DiscoveredCharacteristic() {
+			gattc = client;
+			uuid = record.uuid;
+			props = get_properties(ArrayView<const uint8_t>(&record.properties, 1));
+			declHandle = record.begin;
+			valueHandle = record.value_handle;
+			lastHandle = record.end;
+			connHandle = connection_handle;
+		}
+
 		static UUID get_uuid(const ArrayView<const uint8_t>& value) {
 			if (value.size() == 5) {
 				return UUID(value[3] | (value[4] << 8));
@@ -422,6 +815,7 @@ struct GenericGattClient::DiscoveryControlBlock : public ProcedureControlBlock {
 	UUID matching_characteristic_uuid;
 	service_t* services_discovered;
 	characteristic_t last_characteristic;
+	AttributeCache* cache;
 	bool done;
 };
 
@@ -431,7 +825,8 @@ struct GenericGattClient::ReadControlBlock : public ProcedureControlBlock {
 		Gap::Handle_t connection_handle, uint16_t attribute_handle, uint16_t offset
 	) : ProcedureControlBlock(READ_PROCEDURE, connection_handle),
 		attribute_handle(attribute_handle),
-		offset(offset), current_offset(offset), data(NULL) {
+		offset(offset), current_offset(offset), data(NULL),
+		batch(NULL), value_length(0), fixed_length(false), batch_allowed(true) {
 	}
 
 	virtual ~ReadControlBlock() {
@@ -440,6 +835,100 @@ struct GenericGattClient::ReadControlBlock : public ProcedureControlBlock {
 		}
 	}
 
+	virtual ble_error_t start(GenericGattClient* client) {
+		if (start_read_multiple(client)) {
+			return BLE_ERROR_NONE;
+		}
+
+		if (offset == 0) {
+			return client->_pal_client->read_attribute_value(
+				connection_handle, attribute_handle
+			);
+		} else {
+			return client->_pal_client->read_attribute_blob(
+				connection_handle, attribute_handle, offset
+			);
+		}
+	}
+
+	/*
+	 * Merge the reads queued behind this one in a Read Multiple request.
+	 * Values are concatenated in the response therefore only values with a
+	 * length fixed by the specifications are merged, followed by at most one
+	 * value of any length which gets the rest of the response. The fixed
+	 * values are kept shorter than the maximum response size so a value
+	 * which grew cannot hide behind the truncation of the response.
+	 */
+	bool start_read_multiple(GenericGattClient* client) {
+		ConnectionControlBlock* connection = client->get_connection(connection_handle);
+		if (!batch_allowed || offset != 0 || connection == NULL ||
+			!connection->get_fixed_value_length(attribute_handle, value_length)) {
+			return false;
+		}
+		fixed_length = true;
+
+		uint16_t mtu_size = client->get_mtu(connection_handle);
+		attribute_handle_t handles[READ_MULTIPLE_MAX_HANDLES] = { attribute_handle };
+		size_t count = 1;
+		size_t response_size = value_length;
+
+		ProcedureControlBlock* it = next;
+		ReadControlBlock* last = NULL;
+		while (it && it->type == READ_PROCEDURE && count < READ_MULTIPLE_MAX_HANDLES) {
+			ReadControlBlock* read = static_cast<ReadControlBlock*>(it);
+			if (read->offset != 0 || !read->batch_allowed ||
+				(READ_MULTIPLE_HEADER_LENGTH + (count + 1) * sizeof(attribute_handle_t)) > mtu_size) {
+				break;
+			}
+
+			read->fixed_length = connection->get_fixed_value_length(
+				read->attribute_handle, read->value_length
+			);
+			if (read->fixed_length &&
+				(response_size + read->value_length) >= (size_t) (mtu_size - 1)) {
+				break;
+			}
+			if (!read->fixed_length) {
+				read->value_length = 0;
+			}
+
+			handles[count++] = read->attribute_handle;
+			response_size += read->value_length;
+			it = it->next;
+
+			// move the read from the queue into the batch
+			client->remove_control_block(read);
+			if (last) {
+				last->next = read;
+			} else {
+				batch = read;
+			}
+			last = read;
+
+			// the length of this value is what remains of the response
+			if (!read->fixed_length) {
+				break;
+			}
+		}
+
+		if (batch == NULL) {
+			return false;
+		}
+
+		ble_error_t err = client->_pal_client->read_multiple_characteristic_values(
+			connection_handle,
+			make_const_ArrayView(handles, count)
+		);
+
+		if (err) {
+			client->requeue_control_blocks(batch);
+			batch = NULL;
+			return false;
+		}
+
+		return true;
+	}
+
 	virtual void handle_timeout_error(GenericGattClient* client) {
 		GattReadCallbackParams response = {
 			connection_handle,
@@ -469,13 +958,31 @@ struct GenericGattClient::ReadControlBlock : public ProcedureControlBlock {
 	void terminate(GenericGattClient* client, const GattReadCallbackParams& response) {
 		client->remove_control_block(this);
 		client->processReadResponse(&response);
+
+		// reads merged with this one share its fate
+		while (batch) {
+			ReadControlBlock* read = batch;
+			batch = static_cast<ReadControlBlock*>(read->next);
+			read->next = NULL;
+
+			GattReadCallbackParams read_response = response;
+			read_response.handle = read->attribute_handle;
+			read_response.offset = read->offset;
+			read->terminate(client, read_response);
+		}
+
 		delete this;
 	}
 
 	virtual void handle(GenericGattClient* client, const AttServerMessage& message) {
 		switch(message.opcode) {
 			case AttributeOpcode::ERROR_RESPONSE:
-				handle_error(client, static_cast<const AttErrorResponse&>(message));
+				if (batch) {
+					// the error applies to a single value, read them one by one
+					restart_unbatched(client);
+				} else {
+					handle_error(client, static_cast<const AttErrorResponse&>(message));
+				}
 				break;
 
 			case AttributeOpcode::READ_RESPONSE:
@@ -486,6 +993,12 @@ struct GenericGattClient::ReadControlBlock : public ProcedureControlBlock {
 				handle_read_response(client, static_cast<const AttReadBlobResponse&>(message));
 				break;
 
+			case AttributeOpcode::READ_MULTIPLE_RESPONSE:
+				if (batch) {
+					handle_read_multiple_response(client, static_cast<const AttReadMultipleResponse&>(message));
+					break;
+				}
+				// fall through
 			default: {
 				// should not happen, terminate the procedure and notify client with an error
 				// in such case
@@ -503,6 +1016,106 @@ struct GenericGattClient::ReadControlBlock : public ProcedureControlBlock {
 		}
 	}
 
+	void handle_read_multiple_response(GenericGattClient* client, const AttReadMultipleResponse& read_response) {
+		size_t expected_size = value_length;
+		ReadControlBlock* previous = NULL;
+		ReadControlBlock* variable = NULL;
+		for (ProcedureControlBlock* it = batch; it; it = it->next) {
+			ReadControlBlock* read = static_cast<ReadControlBlock*>(it);
+			if (read->fixed_length) {
+				expected_size += read->value_length;
+				previous = read;
+			} else {
+				variable = read;
+			}
+		}
+
+		// the peer does not follow the specified sizes, the response cannot be split
+		if (variable ? read_response.size() < expected_size : read_response.size() != expected_size) {
+			ConnectionControlBlock* connection = client->get_connection(connection_handle);
+			if (connection) {
+				connection->clear_value_length(attribute_handle);
+				for (ProcedureControlBlock* it = batch; it; it = it->next) {
+					connection->clear_value_length(static_cast<ReadControlBlock*>(it)->attribute_handle);
+				}
+			}
+			restart_unbatched(client);
+			return;
+		}
+
+		if (variable) {
+			variable->value_length = read_response.size() - expected_size;
+
+			// the last value may have been truncated, read it again on its own
+			if (read_response.size() >= (size_t) (client->get_mtu(connection_handle) - 1)) {
+				if (previous) {
+					previous->next = NULL;
+				} else {
+					batch = NULL;
+				}
+				variable->batch_allowed = false;
+				client->requeue_control_blocks(variable);
+			}
+		}
+
+		const uint8_t* value = read_response.data();
+		ReadControlBlock* reads = batch;
+		batch = NULL;
+
+		GattReadCallbackParams response = {
+			connection_handle,
+			attribute_handle,
+			offset,
+			value_length,
+			value,
+			BLE_ERROR_NONE
+		};
+		value += value_length;
+		terminate(client, response);
+
+		while (reads) {
+			ReadControlBlock* read = reads;
+			reads = static_cast<ReadControlBlock*>(read->next);
+			read->next = NULL;
+
+			GattReadCallbackParams read_params = {
+				read->connection_handle,
+				read->attribute_handle,
+				read->offset,
+				read->value_length,
+				value,
+				BLE_ERROR_NONE
+			};
+			value += read->value_length;
+			read->terminate(client, read_params);
+		}
+	}
+
+	/*
+	 * Put the merged reads back in the queue and read this value alone.
+	 */
+	void restart_unbatched(GenericGattClient* client) {
+		for (ProcedureControlBlock* it = batch; it; it = it->next) {
+			static_cast<ReadControlBlock*>(it)->batch_allowed = false;
+		}
+		client->requeue_control_blocks(batch);
+		batch = NULL;
+		batch_allowed = false;
+
+		ble_error_t err = start(client);
+		if (err) {
+			GattReadCallbackParams response = {
+				connection_handle,
+				attribute_handle,
+				AttErrorResponse::UNLIKELY_ERROR,
+				0, // size of 0
+				NULL, // no data
+				err,
+			};
+			terminate(client, response);
+		}
+	}
+
 	template<typename ResponseType>
 	void handle_read_response(GenericGattClient* client, const ResponseType& read_response) {
 		uint16_t mtu_size = client->get_mtu(connection_handle);
@@ -618,6 +1231,10 @@ struct GenericGattClient::ReadControlBlock : public ProcedureControlBlock {
 	uint16_t offset;
 	uint16_t current_offset;
 	uint8_t* data;
+	ReadControlBlock* batch;
+	uint16_t value_length;
+	bool fixed_length;
+	bool batch_allowed;
 };
 
 /*
@@ -629,26 +1246,96 @@ struct GenericGattClient::WriteControlBlock : public ProcedureControlBlock {
 		uint8_t* data, uint16_t len
 	) : ProcedureControlBlock(WRITE_PROCEDURE, connection_handle),
 		attribute_handle(attribute_handle), len(len), offset(0), data(data),
-		prepare_success(false), status(BLE_ERROR_UNSPECIFIED), error_code(0xFF) {
+		batch(NULL), current(NULL), prepare_success(false), batch_allowed(true),
+		restart(false), status(BLE_ERROR_UNSPECIFIED), error_code(0xFF) {
 	}
 
 	virtual ~WriteControlBlock() {
 		free(data);
 	}
 
-	virtual void handle_timeout_error(GenericGattClient* client) {
-		GattWriteCallbackParams response = {
-			connection_handle,
-			attribute_handle,
-			GattWriteCallbackParams::OP_WRITE_REQ,
-			BLE_ERROR_UNSPECIFIED,
-			0x00
-		};
-		terminate(client, response);
+	virtual ble_error_t start(GenericGattClient* client) {
+		uint16_t mtu_size = client->get_mtu(connection_handle);
+
+		if (len <= (uint16_t) (mtu_size - WRITE_HEADER_LENGTH)) {
+			return client->_pal_client->write_attribute(
+				connection_handle,
+				attribute_handle,
+				make_const_ArrayView(data, len)
+			);
+		}
+
+		if (batch_allowed) {
+			batch_long_writes(client, mtu_size);
+		}
+
+		prepare_success = false;
+		status = BLE_ERROR_UNSPECIFIED;
+		error_code = 0xFF;
+		offset = 0;
+		current = this;
+		ble_error_t err = queue_prepare_write(client, mtu_size);
+
+		if (err && batch) {
+			client->requeue_control_blocks(batch);
+			batch = NULL;
+		}
+
+		return err;
 	}
 
-	virtual void abort(GenericGattClient *client) {
-		GattWriteCallbackParams response = {
+	/*
+	 * Long writes queued behind this one share its prepare queue; all of them
+	 * are committed with a single Execute Write Request.
+	 */
+	void batch_long_writes(GenericGattClient* client, uint16_t mtu_size) {
+		ProcedureControlBlock* it = next;
+		WriteControlBlock* last = NULL;
+
+		while (it && it->type == WRITE_PROCEDURE) {
+			WriteControlBlock* write = static_cast<WriteControlBlock*>(it);
+			if (!write->batch_allowed ||
+				write->len <= (uint16_t) (mtu_size - WRITE_HEADER_LENGTH)) {
+				break;
+			}
+			it = it->next;
+
+			client->remove_control_block(write);
+			write->offset = 0;
+			if (last) {
+				last->next = write;
+			} else {
+				batch = write;
+			}
+			last = write;
+		}
+	}
+
+	ble_error_t queue_prepare_write(GenericGattClient* client, uint16_t mtu_size) {
+		return client->_pal_client->queue_prepare_write(
+			connection_handle,
+			current->attribute_handle,
+			make_const_ArrayView(
+				current->data + current->offset,
+				std::min((current->len - current->offset), (mtu_size - PREPARE_WRITE_HEADER_LENGTH))
+			),
+			current->offset
+		);
+	}
+
+	virtual void handle_timeout_error(GenericGattClient* client) {
+		GattWriteCallbackParams response = {
+			connection_handle,
+			attribute_handle,
+			GattWriteCallbackParams::OP_WRITE_REQ,
+			BLE_ERROR_UNSPECIFIED,
+			0x00
+		};
+		terminate(client, response);
+	}
+
+	virtual void abort(GenericGattClient *client) {
+		GattWriteCallbackParams response = {
 			connection_handle,
 			attribute_handle,
 			GattWriteCallbackParams::OP_WRITE_REQ,
@@ -661,6 +1348,18 @@ struct GenericGattClient::WriteControlBlock : public ProcedureControlBlock {
 	void terminate(GenericGattClient* client, const GattWriteCallbackParams& response) {
 		client->remove_control_block(this);
 		client->processWriteResponse(&response);
+
+		// writes sharing the prepare queue share its outcome
+		while (batch) {
+			WriteControlBlock* write = batch;
+			batch = static_cast<WriteControlBlock*>(write->next);
+			write->next = NULL;
+
+			GattWriteCallbackParams write_response = response;
+			write_response.handle = write->attribute_handle;
+			write->terminate(client, write_response);
+		}
+
 		delete this;
 	}
 
@@ -710,17 +1409,15 @@ struct GenericGattClient::WriteControlBlock : public ProcedureControlBlock {
 		ble_error_t err = BLE_ERROR_UNSPECIFIED;
 
 		uint16_t mtu_size = client->get_mtu(connection_handle);
-		offset = write_response.offset + write_response.partial_value.size();
-		if (offset < len) {
-			err = client->_pal_client->queue_prepare_write(
-				connection_handle, attribute_handle,
-				make_const_ArrayView(
-					data + offset,
-					std::min((len - offset), (mtu_size - 5))
-				),
-				offset
-			);
+		current->offset = write_response.offset + write_response.partial_value.size();
+		if (current->offset >= current->len) {
+			current = (current == this) ? batch : static_cast<WriteControlBlock*>(current->next);
+		}
+
+		if (current) {
+			err = queue_prepare_write(client, mtu_size);
 		} else {
+			prepare_success = true;
 			err = client->_pal_client->execute_write_queue(
 				connection_handle, true
 			);
@@ -732,6 +1429,11 @@ struct GenericGattClient::WriteControlBlock : public ProcedureControlBlock {
 	}
 
 	void handle_execute_write_response(GenericGattClient* client, const AttExecuteWriteResponse& execute_response) {
+		if (restart) {
+			restart_unbatched(client);
+			return;
+		}
+
 		if (prepare_success) {
 			status = BLE_ERROR_NONE;
 			error_code = 0x00;
@@ -748,6 +1450,33 @@ struct GenericGattClient::WriteControlBlock : public ProcedureControlBlock {
 		terminate(client, response);
 	}
 
+	/*
+	 * Put the writes which shared the prepare queue back in the queue and
+	 * write this value alone.
+	 */
+	void restart_unbatched(GenericGattClient* client) {
+		for (ProcedureControlBlock* it = batch; it; it = it->next) {
+			static_cast<WriteControlBlock*>(it)->batch_allowed = false;
+		}
+		client->requeue_control_blocks(batch);
+		batch = NULL;
+		batch_allowed = false;
+		restart = false;
+
+		ble_error_t err = start(client);
+		if (err) {
+			GattWriteCallbackParams response = {
+				connection_handle,
+				attribute_handle,
+				GattWriteCallbackParams::OP_WRITE_REQ,
+				err,
+				AttErrorResponse::UNLIKELY_ERROR
+			};
+
+			terminate(client, response);
+		}
+	}
+
 	void clear_prepare_queue(GenericGattClient* client, ble_error_t s, uint8_t e) {
 		prepare_success = false;
 		status = s;
@@ -800,6 +1529,11 @@ struct GenericGattClient::WriteControlBlock : public ProcedureControlBlock {
 		}
 
 		if (error.request_opcode == AttributeOpcode(AttributeOpcode::PREPARE_WRITE_REQUEST)) {
+			// the error applies to one of the writes sharing the queue, cancel
+			// the queue then write the values one by one
+			if (batch) {
+				restart = true;
+			}
 			clear_prepare_queue(client, status, error.error_code);
 		} else {
 			GattWriteCallbackParams response = {
@@ -818,7 +1552,11 @@ struct GenericGattClient::WriteControlBlock : public ProcedureControlBlock {
 	uint16_t len;
 	uint16_t offset;
 	uint8_t* data;
+	WriteControlBlock* batch;
+	WriteControlBlock* current;
 	bool prepare_success;
+	bool batch_allowed;
+	bool restart;
 	ble_error_t status;
 	uint8_t error_code;
 };
@@ -836,12 +1574,27 @@ struct GenericGattClient::DescriptorDiscoveryControlBlock : public ProcedureCont
 		discovery_cb(discoveryCallback),
 		termination_cb(terminationCallback),
 		next_handle(characteristic.getValueHandle() + 1),
+		descriptors(NULL),
+		descriptor_count(0),
 		done(false) {
 	}
 
-	virtual ~DescriptorDiscoveryControlBlock() { }
+	virtual ~DescriptorDiscoveryControlBlock() {
+		delete descriptors;
+	}
+
+	virtual ble_error_t start(GenericGattClient* client) {
+		// discovery terminated while waiting in the queue
+		if (done) {
+			return BLE_ERROR_INVALID_STATE;
+		}
+
+		if (client->_attribute_cache_handler &&
+			descriptors == NULL &&
+			next_handle == characteristic.getValueHandle() + 1) {
+			descriptors = new (std::nothrow) AttributeCache();
+		}
 
-	ble_error_t start(GenericGattClient* client) {
 		return client->_pal_client->discover_characteristics_descriptors(
 			connection_handle,
 			attribute_handle_range(
@@ -856,7 +1609,7 @@ struct GenericGattClient::DescriptorDiscoveryControlBlock : public ProcedureCont
 	}
 
 	virtual void abort(GenericGattClient *client) {
-		terminate(client, BLE_ERROR_INVALID_STATE);
+		terminate(client, done ? BLE_ERROR_NONE : BLE_ERROR_INVALID_STATE);
 	}
 
 	virtual void handle(GenericGattClient* client, const AttServerMessage& message) {
@@ -892,6 +1645,8 @@ struct GenericGattClient::DescriptorDiscoveryControlBlock : public ProcedureCont
 			DiscoveredCharacteristicDescriptor descriptor(
 				client, connection_handle, response[i].handle, response[i].uuid
 			);
+			cache_descriptor(response[i].handle, response[i].uuid);
+			client->on_descriptor_discovered(connection_handle, response[i].uuid, response[i].handle);
 			CharacteristicDescriptorDiscovery::DiscoveryCallbackParams_t params = {
 				characteristic,
 				descriptor
@@ -915,7 +1670,40 @@ struct GenericGattClient::DescriptorDiscoveryControlBlock : public ProcedureCont
 		}
 	}
 
+	void cache_descriptor(uint16_t handle, const UUID& uuid) {
+		if (descriptors == NULL) {
+			return;
+		}
+
+		if (descriptor_count == 0xFF) {
+			discard_cache();
+			return;
+		}
+
+		descriptors->write_descriptor(handle, uuid);
+		++descriptor_count;
+	}
+
+	/*
+	 * Stop caching the descriptors discovered, they are out of date.
+	 */
+	void discard_cache() {
+		delete descriptors;
+		descriptors = NULL;
+	}
+
 	void terminate(GenericGattClient* client, ble_error_t status, uint8_t error_code = 0x00) {
+		// all the descriptors of the characteristic have been discovered
+		if (status == BLE_ERROR_NONE && !done &&
+			descriptors && !descriptors->has_overflowed()) {
+			client->store_descriptors(
+				connection_handle,
+				characteristic,
+				descriptor_count,
+				*descriptors
+			);
+		}
+
 		client->remove_control_block(this);
 		CharacteristicDescriptorDiscovery::TerminationCallbackParams_t params = {
 			characteristic,
@@ -930,15 +1718,217 @@ struct GenericGattClient::DescriptorDiscoveryControlBlock : public ProcedureCont
 	CharacteristicDescriptorDiscovery::DiscoveryCallback_t discovery_cb;
 	CharacteristicDescriptorDiscovery::TerminationCallback_t termination_cb;
 	uint16_t next_handle;
+	AttributeCache* descriptors;
+	uint8_t descriptor_count;
 	bool done;
 };
 
 
+/*
+ * Discover the primary services of a peer and compare them to the ones
+ * present in its attribute cache; the cache is dropped if they differ.
+ */
+struct GenericGattClient::CacheVerificationControlBlock : public ProcedureControlBlock {
+	CacheVerificationControlBlock(Gap::Handle_t handle) :
+		ProcedureControlBlock(CACHE_VERIFICATION_PROCEDURE, handle),
+		cache(),
+		offset(1),
+		done(false) {
+	}
+
+	virtual ~CacheVerificationControlBlock() { }
+
+	virtual ble_error_t start(GenericGattClient* client) {
+		if (done) {
+			return BLE_ERROR_INVALID_STATE;
+		}
+
+		return client->_pal_client->discover_primary_service(
+			connection_handle,
+			0x0001
+		);
+	}
+
+	virtual void handle_timeout_error(GenericGattClient* client) {
+		terminate(client);
+	}
+
+	virtual void abort(GenericGattClient *client) {
+		terminate(client);
+	}
+
+	virtual void handle(GenericGattClient* client, const AttServerMessage& message) {
+		if (done) {
+			terminate(client);
+			return;
+		}
+
+		switch (message.opcode) {
+			case AttributeOpcode::READ_BY_GROUP_TYPE_RESPONSE:
+				handle_services(
+					client, static_cast<const AttReadByGroupTypeResponse&>(message)
+				);
+				return;
+
+			case AttributeOpcode::ERROR_RESPONSE: {
+				const AttErrorResponse& error = static_cast<const AttErrorResponse&>(message);
+				// other errors are inconclusive, the cache is kept
+				if (error.error_code == AttErrorResponse::ATTRIBUTE_NOT_FOUND) {
+					AttributeCache::record_t service;
+					if (next_service(service)) {
+						client->invalidate_attribute_cache(connection_handle);
+					}
+				}
+				terminate(client);
+			}	return;
+
+			default:
+				terminate(client);
+				return;
+		}
+	}
+
+	void handle_services(GenericGattClient* client, const AttReadByGroupTypeResponse& response) {
+		if (!response.size()) {
+			terminate(client);
+			return;
+		}
+
+		uint16_t end_handle = 0x0000;
+		for (size_t i = 0; i < response.size(); ++i) {
+			AttributeCache::record_t service;
+			end_handle = response[i].group_range.end;
+			if (!next_service(service) ||
+				service.begin != response[i].group_range.begin ||
+				service.end != end_handle ||
+				!(service.uuid == get_uuid(response[i]))) {
+				client->invalidate_attribute_cache(connection_handle);
+				terminate(client);
+				return;
+			}
+		}
+
+		if (end_handle == 0xFFFF) {
+			AttributeCache::record_t service;
+			if (next_service(service)) {
+				client->invalidate_attribute_cache(connection_handle);
+			}
+			terminate(client);
+			return;
+		}
+
+		if (client->_pal_client->discover_primary_service(connection_handle, end_handle + 1)) {
+			terminate(client);
+		}
+	}
+
+	bool next_service(AttributeCache::record_t& service) {
+		while (cache.read_record(offset, service)) {
+			if (service.type == AttributeCache::SERVICE) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static UUID get_uuid(const AttReadByGroupTypeResponse::attribute_data_t& data) {
+		if (data.value.size() == 2) {
+			return UUID(data.value[0] | data.value[1] << 8);
+		} else {
+			return UUID(data.value.data(), UUID::LSB);
+		}
+	}
+
+	void terminate(GenericGattClient* client) {
+		client->remove_control_block(this);
+		delete this;
+	}
+
+	AttributeCache cache;
+	size_t offset;
+	bool done;
+};
+
+
+GenericGattClient::ConnectionControlBlock::ConnectionControlBlock() :
+	connection_handle(0),
+	in_use(false),
+	active(NULL),
+	procedures(NULL),
+	procedures_tail(NULL),
+	value_lengths(NULL),
+	service_changed_handle(0x0000) {
+}
+
+GenericGattClient::ConnectionControlBlock::~ConnectionControlBlock() {
+	clear();
+}
+
+bool GenericGattClient::ConnectionControlBlock::is_idle() const {
+	return procedures == NULL;
+}
+
+bool GenericGattClient::ConnectionControlBlock::get_fixed_value_length(
+	GattAttribute::Handle_t handle,
+	uint16_t& length
+) const {
+	if (value_lengths == NULL) {
+		return false;
+	}
+
+	const value_length_t& entry = value_lengths[handle % MAX_VALUE_LENGTHS];
+	if (handle == 0x0000 || entry.handle != handle) {
+		return false;
+	}
+	length = entry.length;
+	return true;
+}
+
+void GenericGattClient::ConnectionControlBlock::set_value_length(
+	GattAttribute::Handle_t handle,
+	uint16_t length
+) {
+	if (value_lengths == NULL) {
+		value_lengths = new (std::nothrow) value_length_t[MAX_VALUE_LENGTHS];
+		if (value_lengths == NULL) {
+			return;
+		}
+		for (size_t i = 0; i < MAX_VALUE_LENGTHS; ++i) {
+			value_lengths[i].handle = 0x0000;
+		}
+	}
+
+	value_length_t& entry = value_lengths[handle % MAX_VALUE_LENGTHS];
+	entry.handle = handle;
+	entry.length = length;
+}
+
+void GenericGattClient::ConnectionControlBlock::clear_value_length(
+	GattAttribute::Handle_t handle
+) {
+	if (value_lengths == NULL) {
+		return;
+	}
+
+	value_length_t& entry = value_lengths[handle % MAX_VALUE_LENGTHS];
+	if (entry.handle == handle) {
+		entry.handle = 0x0000;
+	}
+}
+
+void GenericGattClient::ConnectionControlBlock::clear() {
+	delete[] value_lengths;
+	value_lengths = NULL;
+}
+
 GenericGattClient::GenericGattClient(pal::GattClient* pal_client) :
 	_pal_client(pal_client),
 	_termination_callback(),
 	_signing_event_handler(NULL),
-	 control_blocks(NULL),
+	_attribute_cache_handler(NULL),
+	_attribute_cache_invalidated(),
+	_cached_discoveries(NULL),
+	_verify_attribute_cache(false),
 	_is_reseting(false) {
 	_pal_client->when_server_message_received(
 		mbed::callback(this, &GenericGattClient::on_server_message_received)
@@ -955,8 +1945,7 @@ ble_error_t GenericGattClient::launchServiceDiscovery(
 	const UUID& matching_service_uuid,
 	const UUID& matching_characteristic_uuid
 ) {
-	// verify that there is no other procedures going on this connection
-	if (_is_reseting || get_control_block(connection_handle)) {
+	if (_is_reseting) {
 		return BLE_ERROR_INVALID_STATE;
 	}
 
@@ -966,53 +1955,68 @@ ble_error_t GenericGattClient::launchServiceDiscovery(
 		return BLE_ERROR_NONE;
 	}
 
-	DiscoveryControlBlock* discovery_pcb = new(std::nothrow) DiscoveryControlBlock(
+	if (discover_from_cache(
 		connection_handle,
 		service_callback,
 		characteristic_callback,
 		matching_service_uuid,
 		matching_characteristic_uuid
-	);
+	)) {
+		on_termination(connection_handle);
 
-	if (discovery_pcb == NULL) {
-		return BLE_ERROR_NO_MEM;
-	}
+		if (_verify_attribute_cache && !_is_reseting) {
+			// a single verification per connection is enough
+			ConnectionControlBlock* connection = get_connection(connection_handle);
+			ProcedureControlBlock* pcb = connection ? connection->procedures : NULL;
+			while (pcb && pcb->type != CACHE_VERIFICATION_PROCEDURE) {
+				pcb = pcb->next;
+			}
 
-	// note: control block inserted prior the request because they are part of
-	// of the transaction and the callback can be call synchronously
-	insert_control_block(discovery_pcb);
+			if (pcb == NULL) {
+				CacheVerificationControlBlock* verification_pcb =
+					new (std::nothrow) CacheVerificationControlBlock(connection_handle);
+				if (verification_pcb &&
+					load_attribute_cache(connection_handle, verification_pcb->cache)) {
+					launch_procedure(verification_pcb);
+				} else {
+					delete verification_pcb;
+				}
+			}
+		}
 
-	// launch the request
-	ble_error_t err = BLE_ERROR_UNSPECIFIED;
-	if (matching_service_uuid == UUID()) {
-		err = _pal_client->discover_primary_service(
-			connection_handle,
-			0x0001
-		);
-	} else {
-		err = _pal_client->discover_primary_service_by_service_uuid(
-			connection_handle,
-			0x0001,
-			matching_service_uuid
-		);
+		return BLE_ERROR_NONE;
 	}
 
-	if (err) {
-		remove_control_block(discovery_pcb);
-		delete discovery_pcb;
+	DiscoveryControlBlock* discovery_pcb = new(std::nothrow) DiscoveryControlBlock(
+		connection_handle,
+		service_callback,
+		characteristic_callback,
+		matching_service_uuid,
+		matching_characteristic_uuid
+	);
+
+	if (discovery_pcb == NULL) {
+		return BLE_ERROR_NO_MEM;
 	}
 
-	return err;
+	return launch_procedure(discovery_pcb);
 }
 
 bool GenericGattClient::isServiceDiscoveryActive() const {
-	ProcedureControlBlock* pcb = control_blocks;
-
-	while (pcb) {
-		if (pcb->type == COMPLETE_DISCOVERY_PROCEDURE) {
+	for (CachedDiscovery* it = _cached_discoveries; it; it = it->previous) {
+		if (it->characteristic == NULL && !it->done) {
 			return true;
 		}
-		pcb = pcb->next;
+	}
+
+	for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+		ProcedureControlBlock* pcb = _connections[i].procedures;
+		while (pcb) {
+			if (pcb->type == COMPLETE_DISCOVERY_PROCEDURE) {
+				return true;
+			}
+			pcb = pcb->next;
+		}
 	}
 
 	return false;
@@ -1020,12 +2024,21 @@ bool GenericGattClient::isServiceDiscoveryActive() const {
 
 void GenericGattClient::terminateServiceDiscovery()
 {
-	ProcedureControlBlock* pcb = control_blocks;
-	while (pcb) {
-		if (pcb->type == COMPLETE_DISCOVERY_PROCEDURE) {
-			static_cast<DiscoveryControlBlock*>(pcb)->done = true;
+	for (CachedDiscovery* it = _cached_discoveries; it; it = it->previous) {
+		if (it->characteristic == NULL) {
+			it->done = true;
+		}
+	}
+
+	// Discoveries waiting in the queue terminate when they reach the bearer.
+	for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+		ProcedureControlBlock* pcb = _connections[i].procedures;
+		while (pcb) {
+			if (pcb->type == COMPLETE_DISCOVERY_PROCEDURE) {
+				static_cast<DiscoveryControlBlock*>(pcb)->done = true;
+			}
+			pcb = pcb->next;
 		}
-		pcb = pcb->next;
 	}
 }
 
@@ -1034,8 +2047,7 @@ ble_error_t GenericGattClient::read(
 	GattAttribute::Handle_t attribute_handle,
 	uint16_t offset) const
 {
-	// verify that there is no other procedures going on this connection
-	if (_is_reseting || get_control_block(connection_handle)) {
+	if (_is_reseting) {
 		return BLE_ERROR_INVALID_STATE;
 	}
 
@@ -1049,26 +2061,7 @@ ble_error_t GenericGattClient::read(
 		return BLE_ERROR_NO_MEM;
 	}
 
-	insert_control_block(read_pcb);
-
-	ble_error_t err = BLE_ERROR_NONE;
-
-	if (offset == 0) {
-		err = _pal_client->read_attribute_value(
-			connection_handle, attribute_handle
-		);
-	} else {
-		err = _pal_client->read_attribute_blob(
-			connection_handle, attribute_handle, offset
-		);
-	}
-
-	if (err) {
-		remove_control_block(read_pcb);
-		delete read_pcb;
-	}
-
-	return err;
+	return const_cast<GenericGattClient*>(this)->launch_procedure(read_pcb);
 }
 
 ble_error_t GenericGattClient::write(
@@ -1078,8 +2071,7 @@ ble_error_t GenericGattClient::write(
 	size_t length,
 	const uint8_t* value
 ) const {
-	// verify that there is no other procedures going on this connection
-	if (_is_reseting || get_control_block(connection_handle)) {
+	if (_is_reseting) {
 		return BLE_ERROR_INVALID_STATE;
 	}
 
@@ -1099,6 +2091,8 @@ ble_error_t GenericGattClient::write(
         }
     }
 
+    // commands do not expect a response, they are not queued behind the
+    // procedures running on the connection.
     if (cmd == GattClient::GATT_OP_WRITE_CMD) {
         if (length > (uint16_t) (mtu - WRITE_HEADER_LENGTH)) {
             return BLE_ERROR_PARAM_OUT_OF_RANGE;
@@ -1122,15 +2116,12 @@ ble_error_t GenericGattClient::write(
         }
         return status;
     } else {
-        uint8_t* data = NULL;
-
-        if (length > (uint16_t) (mtu - WRITE_HEADER_LENGTH)) {
-            data = (uint8_t*) malloc(length);
-            if (data == NULL) {
-                return BLE_ERROR_NO_MEM;
-            }
-            memcpy(data, value, length);
+        // the value is sent once the procedure reaches the bearer
+        uint8_t* data = (uint8_t*) malloc(length ? length : 1);
+        if (data == NULL) {
+            return BLE_ERROR_NO_MEM;
         }
+        memcpy(data, value, length);
 
         WriteControlBlock* write_pcb = new (std::nothrow) WriteControlBlock(
             connection_handle,
@@ -1144,30 +2135,7 @@ ble_error_t GenericGattClient::write(
             return BLE_ERROR_NO_MEM;
         }
 
-        insert_control_block(write_pcb);
-
-        ble_error_t err = BLE_ERROR_UNSPECIFIED;
-        if (data) {
-            err = _pal_client->queue_prepare_write(
-                connection_handle,
-                attribute_handle,
-                make_const_ArrayView(value, mtu - PREPARE_WRITE_HEADER_LENGTH),
-                /* offset */0
-            );
-        } else {
-            err = _pal_client->write_attribute(
-                connection_handle,
-                attribute_handle,
-                make_const_ArrayView(value, length)
-            );
-        }
-
-        if (err) {
-            remove_control_block(write_pcb);
-            delete write_pcb;
-        }
-
-        return err;
+        return const_cast<GenericGattClient*>(this)->launch_procedure(write_pcb);
     }
 
     return BLE_ERROR_NOT_IMPLEMENTED;
@@ -1184,8 +2152,7 @@ ble_error_t GenericGattClient::discoverCharacteristicDescriptors(
 	const CharacteristicDescriptorDiscovery::DiscoveryCallback_t& discoveryCallback,
 	const CharacteristicDescriptorDiscovery::TerminationCallback_t& terminationCallback
 ) {
-	// verify that there is no other procedures going on this connection
-	if (_is_reseting || get_control_block(characteristic.getConnectionHandle())) {
+	if (_is_reseting) {
 		return BLE_ERROR_INVALID_STATE;
 	}
 
@@ -1200,6 +2167,10 @@ ble_error_t GenericGattClient::discoverCharacteristicDescriptors(
 		return BLE_ERROR_NONE;
 	}
 
+	if (discover_descriptors_from_cache(characteristic, discoveryCallback, terminationCallback)) {
+		return BLE_ERROR_NONE;
+	}
+
 	DescriptorDiscoveryControlBlock* discovery_pcb =
 		new(std::nothrow) DescriptorDiscoveryControlBlock(
 			characteristic,
@@ -1211,22 +2182,20 @@ ble_error_t GenericGattClient::discoverCharacteristicDescriptors(
 		return BLE_ERROR_NO_MEM;
 	}
 
-	insert_control_block(discovery_pcb);
-
-	ble_error_t err = discovery_pcb->start(this);
-
-	if (err) {
-		remove_control_block(discovery_pcb);
-		delete discovery_pcb;
-	}
-
-	return err;
+	return launch_procedure(discovery_pcb);
 }
 
 bool GenericGattClient::isCharacteristicDescriptorDiscoveryActive(
 	const DiscoveredCharacteristic& characteristic
 ) const {
-	ProcedureControlBlock* pcb = control_blocks;
+	for (CachedDiscovery* it = _cached_discoveries; it; it = it->previous) {
+		if (it->characteristic && *it->characteristic == characteristic && !it->done) {
+			return true;
+		}
+	}
+
+	ConnectionControlBlock* connection = get_connection(characteristic.getConnectionHandle());
+	ProcedureControlBlock* pcb = connection ? connection->procedures : NULL;
 
 	while (pcb) {
 		if (pcb->type == DESCRIPTOR_DISCOVERY_PROCEDURE &&
@@ -1242,7 +2211,14 @@ bool GenericGattClient::isCharacteristicDescriptorDiscoveryActive(
 void GenericGattClient::terminateCharacteristicDescriptorDiscovery(
 	const DiscoveredCharacteristic& characteristic
 ) {
-	ProcedureControlBlock* pcb = control_blocks;
+	for (CachedDiscovery* it = _cached_discoveries; it; it = it->previous) {
+		if (it->characteristic && *it->characteristic == characteristic) {
+			it->done = true;
+		}
+	}
+
+	ConnectionControlBlock* connection = get_connection(characteristic.getConnectionHandle());
+	ProcedureControlBlock* pcb = connection ? connection->procedures : NULL;
 
 	while (pcb) {
 		if (pcb->type == DESCRIPTOR_DISCOVERY_PROCEDURE) {
@@ -1265,8 +2241,13 @@ ble_error_t GenericGattClient::reset(void) {
 	// otherwise new procedures can be launched from callbacks generated by the
 	// reset.
 	_is_reseting = true;
-	while (control_blocks) {
-		control_blocks->abort(this);
+	for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+		while (_connections[i].procedures) {
+			_connections[i].procedures->abort(this);
+		}
+		_connections[i].clear();
+		_connections[i].service_changed_handle = 0x0000;
+		_connections[i].in_use = false;
 	}
 	_is_reseting = false;
 
@@ -1274,11 +2255,27 @@ ble_error_t GenericGattClient::reset(void) {
 }
 
 void GenericGattClient::set_signing_event_handler(
-    EventHandler *signing_event_handler
+    pal::SigningEventMonitor::EventHandler *signing_event_handler
 ) {
     _signing_event_handler = signing_event_handler;
 }
 
+void GenericGattClient::set_attribute_cache_event_handler(
+	pal::AttributeCacheMonitor::EventHandler *attribute_cache_event_handler
+) {
+	_attribute_cache_handler = attribute_cache_event_handler;
+}
+
+void GenericGattClient::set_attribute_cache_verification(bool enable) {
+	_verify_attribute_cache = enable;
+}
+
+void GenericGattClient::when_attribute_cache_invalidated(
+	const mbed::Callback<void(Gap::Handle_t)> &callback
+) {
+	_attribute_cache_invalidated = callback;
+}
+
 void GenericGattClient::on_termination(Gap::Handle_t connection_handle) {
 	if (_termination_callback) {
 		_termination_callback(connection_handle);
@@ -1320,12 +2317,15 @@ void GenericGattClient::on_server_response(
 	connection_handle_t connection,
 	const AttServerMessage& message
 ) {
-	ProcedureControlBlock* pcb = get_control_block(connection);
-	if (pcb == NULL) {
+	ConnectionControlBlock* connection_cb = get_connection(connection);
+	if (connection_cb == NULL || connection_cb->active == NULL) {
 		return;
 	}
 
-	pcb->handle(this, message);
+	connection_cb->active->handle(this, message);
+
+	// the bearer is free once the procedure terminates, start the next one
+	process_queue(connection_cb);
 }
 
 void GenericGattClient::on_server_event(connection_handle_t connection, const AttServerMessage& message) {
@@ -1346,6 +2346,7 @@ void GenericGattClient::on_server_event(connection_handle_t connection, const At
 		case AttributeOpcode::HANDLE_VALUE_INDICATION: {
 			const AttHandleValueIndication& indication =
 				static_cast<const AttHandleValueIndication&>(message);
+			on_indication(connection, indication.attribute_handle);
 			callbacks_params.handle = indication.attribute_handle;
 			callbacks_params.type = BLE_HVX_INDICATION;
 			callbacks_params.len = indication.attribute_value.size();
@@ -1360,63 +2361,176 @@ void GenericGattClient::on_server_event(connection_handle_t connection, const At
 }
 
 void GenericGattClient::on_transaction_timeout(connection_handle_t connection) {
-	ProcedureControlBlock* pcb = get_control_block(connection);
-	if (pcb == NULL) {
+	ConnectionControlBlock* connection_cb = get_connection(connection);
+	if (connection_cb == NULL) {
 		return;
 	}
 
-	pcb->handle_timeout_error(this);
+	// No more requests can be sent on the bearer, the procedures waiting in
+	// the queue are detached and fail with the one running.
+	ProcedureControlBlock* pcb = connection_cb->procedures;
+	connection_cb->procedures = NULL;
+	connection_cb->procedures_tail = NULL;
+	connection_cb->active = NULL;
+	connection_cb->clear();
+
+	while (pcb) {
+		ProcedureControlBlock* next = pcb->next;
+		pcb->next = NULL;
+		pcb->handle_timeout_error(this);
+		pcb = next;
+	}
 }
 
-GenericGattClient::ProcedureControlBlock* GenericGattClient::get_control_block(Gap::Handle_t connection) {
-	ProcedureControlBlock* it = control_blocks;
-	while (it && it->connection_handle != connection) {
-		it = it->next;
+GenericGattClient::ConnectionControlBlock* GenericGattClient::get_connection(
+	Gap::Handle_t connection
+) const {
+	// connection handles are allocated from 0 by the controller: the slot
+	// matching the handle is almost always the one used.
+	for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+		ConnectionControlBlock& cb = _connections[(connection + i) % MAX_CONNECTIONS];
+		if (cb.in_use && cb.connection_handle == connection) {
+			return &cb;
+		}
 	}
-	return it;
+	return NULL;
 }
 
-const GenericGattClient::ProcedureControlBlock* GenericGattClient::get_control_block(Gap::Handle_t connection) const {
-	ProcedureControlBlock* it = control_blocks;
-	while (it && it->connection_handle != connection) {
-		it = it->next;
+GenericGattClient::ConnectionControlBlock* GenericGattClient::acquire_connection(
+	Gap::Handle_t connection
+) const {
+	ConnectionControlBlock* cb = get_connection(connection);
+	if (cb) {
+		return cb;
+	}
+
+	// reuse a free slot or the one of an idle connection
+	for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+		ConnectionControlBlock& it = _connections[(connection + i) % MAX_CONNECTIONS];
+		if (!it.in_use) {
+			cb = &it;
+			break;
+		}
+		if (cb == NULL && it.is_idle()) {
+			cb = &it;
+		}
+	}
+
+	if (cb) {
+		cb->clear();
+		cb->service_changed_handle = 0x0000;
+		cb->in_use = true;
+		cb->connection_handle = connection;
+	}
+	return cb;
+}
+
+ble_error_t GenericGattClient::launch_procedure(ProcedureControlBlock* pcb) {
+	ConnectionControlBlock* connection = acquire_connection(pcb->connection_handle);
+	if (connection == NULL) {
+		delete pcb;
+		return BLE_ERROR_NO_MEM;
+	}
+
+	// note: control block inserted prior the request because they are part of
+	// of the transaction and the callback can be call synchronously
+	bool busy = !connection->is_idle();
+	insert_control_block(pcb);
+	if (busy) {
+		return BLE_ERROR_NONE;
+	}
+
+	connection->active = pcb;
+	ble_error_t err = pcb->start(this);
+	if (err) {
+		remove_control_block(pcb);
+		delete pcb;
+	}
+
+	return err;
+}
+
+void GenericGattClient::process_queue(ConnectionControlBlock* connection) {
+	while (connection->active == NULL && connection->procedures) {
+		ProcedureControlBlock* pcb = connection->procedures;
+		connection->active = pcb;
+		if (pcb->start(this)) {
+			pcb->abort(this);
+		}
 	}
-	return it;
 }
 
 void GenericGattClient::insert_control_block(ProcedureControlBlock* cb) const {
-	if (control_blocks == NULL) {
-		control_blocks = cb;
+	ConnectionControlBlock* connection = get_connection(cb->connection_handle);
+	if (connection == NULL) {
 		return;
 	}
 
-	ProcedureControlBlock* current = control_blocks;
-	while (current->next) {
-		current = current->next;
+	cb->next = NULL;
+	if (connection->procedures_tail) {
+		connection->procedures_tail->next = cb;
+	} else {
+		connection->procedures = cb;
 	}
-	current->next = cb;
+	connection->procedures_tail = cb;
 }
 
-void GenericGattClient::remove_control_block(ProcedureControlBlock* cb) const {
-	if (control_blocks == NULL) {
+void GenericGattClient::requeue_control_blocks(ProcedureControlBlock* first) const {
+	if (first == NULL) {
 		return;
 	}
 
-	if (cb == control_blocks) {
-		control_blocks = control_blocks->next;
+	ConnectionControlBlock* connection = get_connection(first->connection_handle);
+	if (connection == NULL) {
 		return;
 	}
 
-	ProcedureControlBlock* current = control_blocks;
-	while (current->next && current->next != cb) {
+	ProcedureControlBlock* last = first;
+	while (last->next) {
+		last = last->next;
+	}
+
+	// the procedures resume right after the one running
+	ProcedureControlBlock** position = connection->active ?
+		&connection->active->next : &connection->procedures;
+	last->next = *position;
+	*position = first;
+	if (last->next == NULL) {
+		connection->procedures_tail = last;
+	}
+}
+
+void GenericGattClient::remove_control_block(ProcedureControlBlock* cb) const {
+	ConnectionControlBlock* connection = get_connection(cb->connection_handle);
+	if (connection == NULL) {
+		return;
+	}
+
+	ProcedureControlBlock* previous = NULL;
+	ProcedureControlBlock* current = connection->procedures;
+	while (current && current != cb) {
+		previous = current;
 		current = current->next;
 	}
 
-	if (current->next == NULL) {
+	if (current == NULL) {
 		return;
 	}
 
-	current->next = cb->next;
+	if (previous) {
+		previous->next = cb->next;
+	} else {
+		connection->procedures = cb->next;
+	}
+
+	if (connection->procedures_tail == cb) {
+		connection->procedures_tail = previous;
+	}
+
+	if (connection->active == cb) {
+		connection->active = NULL;
+	}
+
 	cb->next = NULL;
 }
 
@@ -1428,5 +2542,276 @@ uint16_t GenericGattClient::get_mtu(Gap::Handle_t connection) const {
 	return result;
 }
 
+bool GenericGattClient::load_attribute_cache(
+	Gap::Handle_t connection,
+	AttributeCache& cache
+) {
+	if (_attribute_cache_handler == NULL) {
+		return false;
+	}
+
+	// the view returned by the handler is only valid until its next call,
+	// callbacks operate on a copy.
+	return cache.load(_attribute_cache_handler->get_attribute_cache(connection));
+}
+
+bool GenericGattClient::discover_from_cache(
+	Gap::Handle_t connection_handle,
+	ServiceDiscovery::ServiceCallback_t service_callback,
+	ServiceDiscovery::CharacteristicCallback_t characteristic_callback,
+	const UUID& matching_service_uuid,
+	const UUID& matching_characteristic_uuid
+) {
+	AttributeCache cache;
+	if (!load_attribute_cache(connection_handle, cache)) {
+		return false;
+	}
+
+	CachedDiscovery discovery = { NULL, false, _cached_discoveries };
+	_cached_discoveries = &discovery;
+
+	bool service_matched = false;
+	size_t offset = 1;
+	AttributeCache::record_t record;
+	while (!discovery.done && cache.read_record(offset, record)) {
+		if (record.type == AttributeCache::SERVICE) {
+			service_matched = matching_service_uuid == UUID() ||
+				matching_service_uuid == record.uuid;
+			if (service_matched && service_callback) {
+				DiscoveredService service;
+				service.setup(record.uuid, record.begin, record.end);
+				service_callback(&service);
+			}
+		} else if (record.type == AttributeCache::CHARACTERISTIC) {
+			on_characteristic_discovered(connection_handle, record.uuid, record.value_handle);
+			if (service_matched && characteristic_callback &&
+				(matching_characteristic_uuid == UUID() ||
+				 matching_characteristic_uuid == record.uuid)) {
+				DiscoveryControlBlock::characteristic_t characteristic(
+					this, connection_handle, record
+				);
+				characteristic_callback(&characteristic);
+			}
+		}
+	}
+
+	_cached_discoveries = discovery.previous;
+	return true;
+}
+
+bool GenericGattClient::discover_descriptors_from_cache(
+	const DiscoveredCharacteristic& characteristic,
+	const CharacteristicDescriptorDiscovery::DiscoveryCallback_t& discoveryCallback,
+	const CharacteristicDescriptorDiscovery::TerminationCallback_t& terminationCallback
+) {
+	Gap::Handle_t connection_handle = characteristic.getConnectionHandle();
+	AttributeCache cache;
+	AttributeCache::record_t record;
+	if (!load_attribute_cache(connection_handle, cache) ||
+		!cache.find_descriptors(characteristic.getValueHandle(), record)) {
+		return false;
+	}
+
+	CachedDiscovery discovery = { &characteristic, false, _cached_discoveries };
+	_cached_discoveries = &discovery;
+
+	size_t offset = record.descriptors;
+	uint16_t handle;
+	UUID uuid;
+	for (size_t i = 0; i < record.count && !discovery.done; ++i) {
+		if (!cache.read_descriptor(offset, handle, uuid)) {
+			break;
+		}
+
+		on_descriptor_discovered(connection_handle, uuid, handle);
+		DiscoveredCharacteristicDescriptor descriptor(
+			this, connection_handle, handle, uuid
+		);
+		CharacteristicDescriptorDiscovery::DiscoveryCallbackParams_t params = {
+			characteristic,
+			descriptor
+		};
+		discoveryCallback(&params);
+	}
+
+	_cached_discoveries = discovery.previous;
+
+	CharacteristicDescriptorDiscovery::TerminationCallbackParams_t params = {
+		characteristic,
+		BLE_ERROR_NONE,
+		/* error code */ 0x00
+	};
+	terminationCallback(&params);
+	return true;
+}
+
+void GenericGattClient::store_attribute_cache(
+	Gap::Handle_t connection,
+	const AttributeCache& cache
+) {
+	if (_attribute_cache_handler) {
+		_attribute_cache_handler->on_attribute_cache_updated(connection, cache.data());
+	}
+}
+
+void GenericGattClient::store_descriptors(
+	Gap::Handle_t connection,
+	const DiscoveredCharacteristic& characteristic,
+	uint8_t count,
+	const AttributeCache& descriptors
+) {
+	AttributeCache cache;
+	if (!load_attribute_cache(connection, cache)) {
+		return;
+	}
+
+	// descriptors are only cached for a characteristic present in the cache
+	bool found = false;
+	size_t offset = 1;
+	AttributeCache::record_t record;
+	while (cache.read_record(offset, record)) {
+		if (record.type == AttributeCache::DESCRIPTORS &&
+			record.value_handle == characteristic.getValueHandle()) {
+			return;
+		}
+
+		if (record.type == AttributeCache::CHARACTERISTIC &&
+			record.value_handle == characteristic.getValueHandle() &&
+			record.end == characteristic.getLastHandle()) {
+			found = true;
+		}
+	}
+
+	if (!found) {
+		return;
+	}
+
+	cache.write_descriptors(characteristic.getValueHandle(), count, descriptors.data());
+	if (!cache.has_overflowed()) {
+		store_attribute_cache(connection, cache);
+	}
+}
+
+void GenericGattClient::invalidate_attribute_cache(Gap::Handle_t connection) {
+	if (_attribute_cache_handler) {
+		_attribute_cache_handler->on_attribute_cache_updated(
+			connection, ArrayView<const uint8_t>()
+		);
+	}
+
+	// procedures running would cache or verify attributes which are out of date
+	ConnectionControlBlock* connection_cb = get_connection(connection);
+	if (connection_cb) {
+		connection_cb->clear();
+	}
+	ProcedureControlBlock* pcb = connection_cb ? connection_cb->procedures : NULL;
+	while (pcb) {
+		switch (pcb->type) {
+			case COMPLETE_DISCOVERY_PROCEDURE:
+				static_cast<DiscoveryControlBlock*>(pcb)->discard_cache();
+				break;
+			case DESCRIPTOR_DISCOVERY_PROCEDURE:
+				static_cast<DescriptorDiscoveryControlBlock*>(pcb)->discard_cache();
+				break;
+			case CACHE_VERIFICATION_PROCEDURE:
+				static_cast<CacheVerificationControlBlock*>(pcb)->done = true;
+				break;
+			default:
+				break;
+		}
+		pcb = pcb->next;
+	}
+
+	if (_attribute_cache_invalidated) {
+		_attribute_cache_invalidated(connection);
+	}
+}
+
+void GenericGattClient::on_indication(
+	Gap::Handle_t connection,
+	GattAttribute::Handle_t handle
+) {
+	ConnectionControlBlock* connection_cb = get_connection(connection);
+	if (connection_cb && connection_cb->service_changed_handle != 0x0000 &&
+		connection_cb->service_changed_handle == handle) {
+		invalidate_attribute_cache(connection);
+		return;
+	}
+
+	AttributeCache cache;
+	if (!load_attribute_cache(connection, cache)) {
+		return;
+	}
+
+	const UUID service_changed(BLE_UUID_GATT_CHARACTERISTIC_SERVICE_CHANGED);
+	size_t offset = 1;
+	AttributeCache::record_t record;
+	while (cache.read_record(offset, record)) {
+		if (record.type == AttributeCache::CHARACTERISTIC &&
+			record.value_handle == handle &&
+			record.uuid == service_changed) {
+			invalidate_attribute_cache(connection);
+			return;
+		}
+	}
+}
+
+void GenericGattClient::on_characteristic_discovered(
+	Gap::Handle_t connection,
+	const UUID& uuid,
+	GattAttribute::Handle_t value_handle
+) const {
+	// remember where the Service Changed indications come from, the attribute
+	// cache may not be present.
+	if (uuid == UUID(BLE_UUID_GATT_CHARACTERISTIC_SERVICE_CHANGED)) {
+		ConnectionControlBlock* connection_cb = get_connection(connection);
+		if (connection_cb) {
+			connection_cb->service_changed_handle = value_handle;
+		}
+	}
+
+	on_value_discovered(connection, uuid, value_handle);
+}
+
+void GenericGattClient::on_descriptor_discovered(
+	Gap::Handle_t connection,
+	const UUID& uuid,
+	GattAttribute::Handle_t handle
+) const {
+	on_value_discovered(connection, uuid, handle);
+}
+
+void GenericGattClient::on_value_discovered(
+	Gap::Handle_t connection,
+	const UUID& uuid,
+	GattAttribute::Handle_t handle
+) const {
+	uint16_t length = get_specified_value_length(uuid);
+	if (length == 0) {
+		return;
+	}
+
+	// discovery from the cache may run while no procedure holds the slot
+	ConnectionControlBlock* connection_cb = acquire_connection(connection);
+	if (connection_cb) {
+		connection_cb->set_value_length(handle, length);
+	}
+}
+
+void GenericGattClient::on_disconnection(const Gap::DisconnectionCallbackParams_t* params) {
+	ConnectionControlBlock* connection_cb = get_connection(params->handle);
+	if (connection_cb == NULL) {
+		return;
+	}
+
+	// the handle may be given to another peer, nothing learnt from this one
+	// applies to it. Procedures still queued fail and release the slot later.
+	connection_cb->clear();
+	connection_cb->service_changed_handle = 0x0000;
+	if (connection_cb->is_idle()) {
+		connection_cb->in_use = false;
+	}
+}
+
 } // namespace pal
 } // namespace ble
@@ -19,6 +19,24 @@
 #include "ble/generic/GenericSecurityManager.h"
 #include "ble/generic/MemorySecurityDb.h"
 #include "ble/generic/FileSecurityDb.h"
+#include "ble/generic/IndexedFileSecurityDb.h"
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_AES_C)
+#include "mbedtls/aes.h"
+#endif
+
+/* software resolution of private addresses requires AES */
+#if defined(MBED_CONF_BLE_SOFTWARE_RESOLVING_LIST_SIZE) && defined(MBEDTLS_AES_C)
+#define SOFTWARE_RESOLVING_LIST_SIZE MBED_CONF_BLE_SOFTWARE_RESOLVING_LIST_SIZE
+#else
+#define SOFTWARE_RESOLVING_LIST_SIZE 0
+#endif
 
 using ble::pal::advertising_peer_address_type_t;
 using ble::pal::AuthenticationMask;
@@ -82,6 +100,12 @@ ble_error_t GenericSecurityManager::init(
 
     _connection_monitor.set_connection_event_handler(this);
     _signing_monitor.set_signing_event_handler(this);
+    if (_attribute_cache_monitor) {
+        _attribute_cache_monitor->set_attribute_cache_event_handler(this);
+    }
+    if (_address_resolution_monitor && SOFTWARE_RESOLVING_LIST_SIZE) {
+        _address_resolution_monitor->set_address_resolution_event_handler(this);
+    }
     _pal.set_event_handler(this);
 
     result = init_resolving_list();
@@ -136,6 +160,14 @@ ble_error_t GenericSecurityManager::preserveBondingStateOnReset(bool enabled) {
 ble_error_t GenericSecurityManager::purgeAllBondingState(void) {
     if (!_db) return BLE_ERROR_INITIALIZATION_INCOMPLETE;
     _db->clear_entries();
+
+    if (_resolvable_identity_count) {
+        _resolvable_identity_count = 0;
+        if (_address_resolution_monitor) {
+            _address_resolution_monitor->on_resolvable_identities_changed(true);
+        }
+    }
+
     return BLE_ERROR_NONE;
 }
 
@@ -777,11 +809,25 @@ ble_error_t GenericSecurityManager::init_database(
 ) {
     delete _db;
 
+#if defined(MBED_CONF_BLE_SECURITY_DATABASE_MAX_ENTRIES)
+    FILE* db_file = IndexedFileSecurityDb::open_db_file(
+        db_path,
+        MBED_CONF_BLE_SECURITY_DATABASE_MAX_ENTRIES
+    );
+
+    if (db_file) {
+        _db = new (std::nothrow) IndexedFileSecurityDb(
+            db_file,
+            MBED_CONF_BLE_SECURITY_DATABASE_MAX_ENTRIES
+        );
+    } else {
+#else
     FILE* db_file = FileSecurityDb::open_db_file(db_path);
 
     if (db_file) {
         _db = new (std::nothrow) FileSecurityDb(db_file);
     } else {
+#endif
         _db = new (std::nothrow) MemorySecurityDb();
     }
 
@@ -797,8 +843,17 @@ ble_error_t GenericSecurityManager::init_database(
 ble_error_t GenericSecurityManager::init_resolving_list() {
     if (!_db) return BLE_ERROR_INITIALIZATION_INCOMPLETE;
 
-    /* match the resolving list to the currently stored set of IRKs */
-    uint8_t resolving_list_capacity = _pal.read_resolving_list_capacity();
+    if (SOFTWARE_RESOLVING_LIST_SIZE && !_resolvable_identities) {
+        _resolvable_identities = new (std::nothrow)
+            SecurityEntryIdentity_t[SOFTWARE_RESOLVING_LIST_SIZE];
+    }
+
+    /* match the resolving list to the currently stored set of IRKs; the
+     * identities which do not fit in the controller are resolved in software */
+    size_t resolving_list_capacity = _pal.read_resolving_list_capacity();
+    if (_resolvable_identities && resolving_list_capacity < SOFTWARE_RESOLVING_LIST_SIZE) {
+        resolving_list_capacity = SOFTWARE_RESOLVING_LIST_SIZE;
+    }
     SecurityEntryIdentity_t* identity_list_p =
         new (std::nothrow) SecurityEntryIdentity_t[resolving_list_capacity];
 
@@ -1105,6 +1160,10 @@ void GenericSecurityManager::on_security_entry_retrieved(
         identity->identity_address,
         identity->irk
     );
+
+    if (add_resolvable_identity(*identity) && _address_resolution_monitor) {
+        _address_resolution_monitor->on_resolvable_identities_changed(false);
+    }
 }
 
 void GenericSecurityManager::on_identity_list_retrieved(
@@ -1113,8 +1172,10 @@ void GenericSecurityManager::on_identity_list_retrieved(
 ) {
     typedef advertising_peer_address_type_t address_type_t;
 
+    size_t resolving_list_capacity = _pal.read_resolving_list_capacity();
+
     _pal.clear_resolving_list();
-    for (size_t i = 0; i < count; ++i) {
+    for (size_t i = 0; i < count && i < resolving_list_capacity; ++i) {
         _pal.add_device_to_resolving_list(
             identity_list[i].identity_address_is_public ?
                 address_type_t::PUBLIC_ADDRESS :
@@ -1124,6 +1185,17 @@ void GenericSecurityManager::on_identity_list_retrieved(
         );
     }
 
+    if (_resolvable_identities) {
+        _resolvable_identity_count = 0;
+        for (size_t i = 0; i < count; ++i) {
+            add_resolvable_identity(identity_list[i]);
+        }
+
+        if (_address_resolution_monitor) {
+            _address_resolution_monitor->on_resolvable_identities_changed(true);
+        }
+    }
+
     delete [] identity_list.data();
 }
 
@@ -1261,6 +1333,130 @@ void GenericSecurityManager::on_signed_write() {
     _db->set_local_sign_counter(_db->get_local_sign_counter() + 1);
 }
 
+////////////////////////////////////////////////////////////////////////////
+// Attribute cache
+//
+
+ArrayView<const uint8_t> GenericSecurityManager::get_attribute_cache(
+    connection_handle_t connection
+) {
+    SecurityDb::entry_handle_t entry = get_bonded_entry(connection);
+    if (!entry) {
+        return ArrayView<const uint8_t>();
+    }
+    return _db->get_entry_gatt_cache(entry);
+}
+
+void GenericSecurityManager::on_attribute_cache_updated(
+    connection_handle_t connection,
+    const ArrayView<const uint8_t> &cache
+) {
+    SecurityDb::entry_handle_t entry = get_bonded_entry(connection);
+    if (!entry) {
+        return;
+    }
+    _db->set_entry_gatt_cache(entry, cache);
+}
+
+SecurityDb::entry_handle_t GenericSecurityManager::get_bonded_entry(
+    connection_handle_t connection
+) {
+    if (!_db) {
+        return NULL;
+    }
+
+    ControlBlock_t *cb = get_control_block(connection);
+    if (!cb) {
+        return NULL;
+    }
+
+    SecurityDistributionFlags_t* flags = _db->get_distribution_flags(cb->db_entry);
+    if (!flags || !flags->ltk_stored) {
+        return NULL;
+    }
+
+    return cb->db_entry;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Address resolution
+//
+
+bool GenericSecurityManager::resolve_private_address(
+    const address_t &address,
+    address_t &identity_address,
+    bool &identity_address_is_public
+) {
+#if SOFTWARE_RESOLVING_LIST_SIZE
+    /* ah(k, r) = e(k, padding || prand), see BT Core 5.0 Vol 3, Part H 2.2.2;
+     * e() and the address use opposite byte orders */
+    uint8_t plaintext[16] = { 0 };
+    plaintext[13] = address[5];
+    plaintext[14] = address[4];
+    plaintext[15] = address[3];
+
+    mbedtls_aes_context context;
+    mbedtls_aes_init(&context);
+
+    bool resolved = false;
+    for (size_t i = 0; i < _resolvable_identity_count && !resolved; ++i) {
+        const SecurityEntryIdentity_t &identity = _resolvable_identities[i];
+
+        uint8_t key[16];
+        for (size_t j = 0; j < sizeof(key); ++j) {
+            key[j] = identity.irk[sizeof(key) - 1 - j];
+        }
+
+        uint8_t ciphertext[16];
+        if (mbedtls_aes_setkey_enc(&context, key, 128) ||
+            mbedtls_aes_crypt_ecb(&context, MBEDTLS_AES_ENCRYPT, plaintext, ciphertext)
+        ) {
+            break;
+        }
+
+        if (ciphertext[15] == address[0] &&
+            ciphertext[14] == address[1] &&
+            ciphertext[13] == address[2]
+        ) {
+            identity_address = identity.identity_address;
+            identity_address_is_public = identity.identity_address_is_public;
+            resolved = true;
+        }
+    }
+
+    mbedtls_aes_free(&context);
+    return resolved;
+#else
+    (void) address;
+    (void) identity_address;
+    (void) identity_address_is_public;
+    return false;
+#endif
+}
+
+bool GenericSecurityManager::add_resolvable_identity(
+    const SecurityEntryIdentity_t &identity
+) {
+    if (!_resolvable_identities) {
+        return false;
+    }
+
+    for (size_t i = 0; i < _resolvable_identity_count; ++i) {
+        SecurityEntryIdentity_t &entry = _resolvable_identities[i];
+        if (entry.identity_address == identity.identity_address) {
+            entry = identity;
+            return true;
+        }
+    }
+
+    if (_resolvable_identity_count == SOFTWARE_RESOLVING_LIST_SIZE) {
+        return false;
+    }
+
+    _resolvable_identities[_resolvable_identity_count++] = identity;
+    return true;
+}
+
 void GenericSecurityManager::on_slave_security_request(
     connection_handle_t connection,
     AuthenticationMask authentication
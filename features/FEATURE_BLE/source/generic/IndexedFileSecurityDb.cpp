@@ -0,0 +1,1032 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "IndexedFileSecurityDb.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <new>
+
+namespace ble {
+namespace generic {
+
+const uint16_t INDEXED_DB_VERSION = 1;
+
+/* file layout:
+ * header | local data | journal header | journal local data | journal records
+ * | records | attribute caches */
+
+struct db_header_t {
+    uint16_t version;
+    uint8_t restore;
+    uint8_t reserved;
+    uint32_t max_entries;
+};
+
+struct db_local_t {
+    SecurityEntryIdentity_t identity;
+    csrk_t csrk;
+    sign_count_t sign_counter;
+    /* last tag given to an entry */
+    uint32_t gatt_cache_tag;
+};
+
+struct db_journal_t {
+    /* number of records in the journal, 0 if there is nothing to apply */
+    uint32_t count;
+    uint32_t checksum;
+};
+
+struct db_gatt_cache_header_t {
+    /* tag of the record the cache belongs to */
+    uint32_t tag;
+    uint16_t size;
+    uint16_t reserved;
+    uint32_t checksum;
+};
+
+#define DB_OFFSET_HEADER          (0)
+#define DB_OFFSET_RESTORE         (DB_OFFSET_HEADER + offsetof(db_header_t, restore))
+#define DB_OFFSET_LOCAL           (DB_OFFSET_HEADER + sizeof(db_header_t))
+#define DB_OFFSET_JOURNAL         (DB_OFFSET_LOCAL + sizeof(db_local_t))
+#define DB_OFFSET_JOURNAL_LOCAL   (DB_OFFSET_JOURNAL + sizeof(db_journal_t))
+#define DB_OFFSET_JOURNAL_RECORDS (DB_OFFSET_JOURNAL_LOCAL + sizeof(db_local_t))
+#define DB_OFFSET_RECORDS \
+    (DB_OFFSET_JOURNAL_RECORDS + IndexedFileSecurityDb::MAX_DIRTY_ENTRIES * sizeof(dirty_record_t))
+
+#define DB_SIZE_GATT_CACHE \
+    (sizeof(db_gatt_cache_header_t) + SecurityDb::MAX_GATT_CACHE_SIZE)
+
+#define DB_OFFSET_GATT_CACHES(max_entries) \
+    (DB_OFFSET_RECORDS + (max_entries) * sizeof(record_t))
+
+#define DB_SIZE(max_entries) \
+    (DB_OFFSET_GATT_CACHES(max_entries) + (max_entries) * DB_SIZE_GATT_CACHE)
+
+typedef SecurityDb::entry_handle_t entry_handle_t;
+
+static uint32_t checksum(const void *data, size_t size, uint32_t hash = 2166136261UL) {
+    /* FNV-1a */
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+static bool has_keys(const SecurityDistributionFlags_t &flags) {
+    return flags.csrk_stored || flags.ltk_stored || flags.ltk_sent || flags.irk_stored;
+}
+
+IndexedFileSecurityDb::IndexedFileSecurityDb(FILE *db_file, size_t max_entries)
+    : SecurityDb(),
+      _db_file(db_file),
+      _max_entries(max_entries > MAX_ENTRIES ? MAX_ENTRIES : max_entries),
+      _entries(NULL),
+      _address_index(NULL),
+      _identity_index(NULL),
+      _index_mask(0),
+      _dirty_count(0),
+      _local_dirty(false) {
+    /* one bucket per entry, rounded to a power of two */
+    size_t buckets = 1;
+    while (buckets < _max_entries) {
+        buckets <<= 1;
+    }
+    _index_mask = buckets - 1;
+
+    _entries = new (std::nothrow) entry_t[_max_entries];
+    _address_index = new (std::nothrow) uint16_t[buckets];
+    _identity_index = new (std::nothrow) uint16_t[buckets];
+
+    reset_ram();
+}
+
+IndexedFileSecurityDb::~IndexedFileSecurityDb() {
+    flush();
+    if (_db_file) {
+        fclose(_db_file);
+    }
+    delete [] _entries;
+    delete [] _address_index;
+    delete [] _identity_index;
+}
+
+FILE* IndexedFileSecurityDb::open_db_file(const char *db_path, size_t max_entries) {
+    if (!db_path || !max_entries || max_entries > MAX_ENTRIES) {
+        return NULL;
+    }
+
+    /* try to open an existing file */
+    FILE *db_file = fopen(db_path, "rb+");
+
+    if (!db_file) {
+        /* file doesn't exist, create it */
+        db_file = fopen(db_path, "wb+");
+    }
+
+    if (!db_file) {
+        /* failed to create a file, abort */
+        return NULL;
+    }
+
+    /* we will check the db file and if the version or size doesn't match
+     * what we expect we will blank it */
+    bool init = false;
+    db_header_t header;
+
+    fseek(db_file, DB_OFFSET_HEADER, SEEK_SET);
+
+    if ((fread(&header, sizeof(header), 1, db_file) == 1) &&
+        (header.version == INDEXED_DB_VERSION) &&
+        (header.max_entries == max_entries)) {
+        /* if file size differs from database size init the file */
+        fseek(db_file, 0, SEEK_END);
+        if (ftell(db_file) != (long int) DB_SIZE(max_entries)) {
+            init = true;
+        }
+    } else {
+        init = true;
+    }
+
+    if (init) {
+        return erase_db_file(db_file, max_entries);
+    }
+
+    return db_file;
+}
+
+FILE* IndexedFileSecurityDb::erase_db_file(FILE* db_file, size_t max_entries) {
+    fseek(db_file, 0, SEEK_SET);
+
+    /* zero the file */
+    uint8_t zero[64] = { 0 };
+    size_t size = DB_SIZE(max_entries);
+    while (size) {
+        size_t chunk = size < sizeof(zero) ? size : sizeof(zero);
+        if (fwrite(zero, chunk, 1, db_file) != 1) {
+            fclose(db_file);
+            return NULL;
+        }
+        size -= chunk;
+    }
+
+    db_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.version = INDEXED_DB_VERSION;
+    header.max_entries = max_entries;
+
+    fseek(db_file, DB_OFFSET_HEADER, SEEK_SET);
+    if (fwrite(&header, sizeof(header), 1, db_file) != 1 || fflush(db_file)) {
+        fclose(db_file);
+        return NULL;
+    }
+
+    return db_file;
+}
+
+SecurityDistributionFlags_t* IndexedFileSecurityDb::get_distribution_flags(
+    entry_handle_t db_handle
+) {
+    return reinterpret_cast<SecurityDistributionFlags_t*>(db_handle);
+}
+
+/* local keys */
+
+/* set */
+void IndexedFileSecurityDb::set_entry_local_ltk(
+    entry_handle_t db_handle,
+    const ltk_t &ltk
+) {
+    entry_t *entry = as_entry(db_handle);
+    record_t *record = modify_record(entry);
+    if (!record) {
+        return;
+    }
+
+    entry->flags.ltk_sent = true;
+    record->local_keys.ltk = ltk;
+}
+
+void IndexedFileSecurityDb::set_entry_local_ediv_rand(
+    entry_handle_t db_handle,
+    const ediv_t &ediv,
+    const rand_t &rand
+) {
+    record_t *record = modify_record(as_entry(db_handle));
+    if (!record) {
+        return;
+    }
+
+    record->local_keys.ediv = ediv;
+    record->local_keys.rand = rand;
+}
+
+/* peer's keys */
+
+/* set */
+
+void IndexedFileSecurityDb::set_entry_peer_ltk(
+    entry_handle_t db_handle,
+    const ltk_t &ltk
+) {
+    entry_t *entry = as_entry(db_handle);
+    record_t *record = modify_record(entry);
+    if (!record) {
+        return;
+    }
+
+    entry->flags.ltk_stored = true;
+    record->peer_keys.ltk = ltk;
+}
+
+void IndexedFileSecurityDb::set_entry_peer_ediv_rand(
+    entry_handle_t db_handle,
+    const ediv_t &ediv,
+    const rand_t &rand
+) {
+    record_t *record = modify_record(as_entry(db_handle));
+    if (!record) {
+        return;
+    }
+
+    record->peer_keys.ediv = ediv;
+    record->peer_keys.rand = rand;
+}
+
+void IndexedFileSecurityDb::set_entry_peer_irk(
+    entry_handle_t db_handle,
+    const irk_t &irk
+) {
+    entry_t *entry = as_entry(db_handle);
+    record_t *record = modify_record(entry);
+    if (!record) {
+        return;
+    }
+
+    entry->flags.irk_stored = true;
+    record->peer_identity.irk = irk;
+
+    if (!entry->in_identity_index) {
+        index_identity(index_of(entry));
+    }
+}
+
+void IndexedFileSecurityDb::set_entry_peer_bdaddr(
+    entry_handle_t db_handle,
+    bool address_is_public,
+    const address_t &peer_address
+) {
+    entry_t *entry = as_entry(db_handle);
+    record_t *record = modify_record(entry);
+    if (!record) {
+        return;
+    }
+
+    record->peer_identity.identity_address = peer_address;
+    record->peer_identity.identity_address_is_public = address_is_public;
+
+    if (entry->in_identity_index) {
+        unindex_identity(index_of(entry));
+    }
+    entry->identity_address = peer_address;
+    entry->identity_address_is_public = address_is_public;
+    if (entry->flags.irk_stored) {
+        index_identity(index_of(entry));
+    }
+}
+
+void IndexedFileSecurityDb::set_entry_peer_csrk(
+    entry_handle_t db_handle,
+    const csrk_t &csrk
+) {
+    entry_t *entry = as_entry(db_handle);
+    record_t *record = modify_record(entry);
+    if (!record) {
+        return;
+    }
+
+    entry->flags.csrk_stored = true;
+    record->peer_signing.csrk = csrk;
+}
+
+void IndexedFileSecurityDb::set_entry_peer_sign_counter(
+    entry_handle_t db_handle,
+    sign_count_t sign_counter
+) {
+    /* held in memory until the entry is synced */
+    entry_t *entry = as_entry(db_handle);
+    if (entry) {
+        entry->peer_sign_counter = sign_counter;
+    }
+}
+
+/* attribute cache */
+
+ArrayView<const uint8_t> IndexedFileSecurityDb::get_entry_gatt_cache(
+    entry_handle_t db_handle
+) {
+    entry_t *entry = as_entry(db_handle);
+    if (!entry || !entry->used) {
+        return ArrayView<const uint8_t>();
+    }
+
+    const long int offset = gatt_cache_offset(index_of(entry));
+    db_gatt_cache_header_t header;
+
+    /* a cache left by a previous bond in this entry carries another tag */
+    if (!db_read(&header, offset) ||
+        header.tag != entry->gatt_cache_tag ||
+        header.size == 0 ||
+        header.size > MAX_GATT_CACHE_SIZE) {
+        return ArrayView<const uint8_t>();
+    }
+
+    if (fread(_gatt_cache, header.size, 1, _db_file) != 1 ||
+        checksum(_gatt_cache, header.size, header.tag) != header.checksum) {
+        return ArrayView<const uint8_t>();
+    }
+
+    return ArrayView<const uint8_t>(_gatt_cache, header.size);
+}
+
+void IndexedFileSecurityDb::set_entry_gatt_cache(
+    entry_handle_t db_handle,
+    const ArrayView<const uint8_t> &cache
+) {
+    entry_t *entry = as_entry(db_handle);
+    if (!entry || !entry->used) {
+        return;
+    }
+
+    /* the tag must be in the file before the cache refers to it */
+    if (!entry->persisted || find_dirty(index_of(entry))) {
+        modify_record(entry);
+        flush();
+    }
+
+    const long int offset = gatt_cache_offset(index_of(entry));
+
+    db_gatt_cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.tag = entry->gatt_cache_tag;
+
+    /* a cache that doesn't fit is dropped rather than left stale */
+    if (cache.size() && cache.size() <= MAX_GATT_CACHE_SIZE) {
+        fseek(_db_file, offset + sizeof(header), SEEK_SET);
+        if (fwrite(cache.data(), cache.size(), 1, _db_file) == 1) {
+            header.size = cache.size();
+            header.checksum = checksum(cache.data(), cache.size(), header.tag);
+        }
+    }
+
+    /* a torn update fails the checksum */
+    db_write(&header, offset);
+    fflush(_db_file);
+}
+
+/* local csrk */
+
+void IndexedFileSecurityDb::set_local_csrk(const csrk_t &csrk) {
+    _local_csrk = csrk;
+    _local_dirty = true;
+}
+
+void IndexedFileSecurityDb::set_local_sign_counter(sign_count_t sign_counter) {
+    _local_sign_counter = sign_counter;
+    _local_dirty = true;
+}
+
+/* list management */
+
+entry_handle_t IndexedFileSecurityDb::open_entry(
+    peer_address_type_t peer_address_type,
+    const address_t &peer_address
+) {
+    entry_t *entry = as_entry(find_entry_by_peer_address(peer_address_type, peer_address));
+
+    if (!entry) {
+        entry = allocate_entry();
+        if (!entry) {
+            return NULL;
+        }
+
+        /* we need some address to store, so we store even random ones
+         * this address will be used as an id, possibly replaced later
+         * by identity address */
+        entry->flags.peer_address = peer_address;
+        entry->flags.peer_address_is_public =
+            (peer_address_type == peer_address_type_t::PUBLIC) ||
+            (peer_address_type == peer_address_type_t::PUBLIC_IDENTITY);
+        index_address(index_of(entry));
+    }
+
+    /* the peer address may be changed through the flags while opened */
+    if (!entry->opened) {
+        entry->opened = true;
+        entry->next_opened = _opened_list;
+        _opened_list = index_of(entry);
+    }
+    entry->last_used = ++_use_counter;
+
+    return &entry->flags;
+}
+
+entry_handle_t IndexedFileSecurityDb::find_entry_by_peer_address(
+    peer_address_type_t peer_address_type,
+    const address_t &peer_address
+) {
+    if (!_entries) {
+        return NULL;
+    }
+
+    reindex_opened_entries();
+
+    const bool peer_address_public =
+        (peer_address_type == peer_address_type_t::PUBLIC) ||
+        (peer_address_type == peer_address_type_t::PUBLIC_IDENTITY);
+    const size_t bucket = hash_address(peer_address, peer_address_public);
+
+    /* lookup for connection address used during bonding */
+    for (uint16_t i = _address_index[bucket]; i != NO_ENTRY; i = _entries[i].next_by_address) {
+        entry_t &entry = _entries[i];
+
+        /* only look among disconnected entries */
+        if (entry.flags.connected) {
+            continue;
+        }
+
+        if (peer_address_type == peer_address_type_t::PUBLIC_IDENTITY &&
+            entry.flags.irk_stored == false) {
+            continue;
+        }
+
+        if (entry.flags.peer_address == peer_address &&
+            entry.flags.peer_address_is_public == peer_address_public) {
+            return &entry.flags;
+        }
+    }
+
+    /* look for the identity address */
+    for (uint16_t i = _identity_index[bucket]; i != NO_ENTRY; i = _entries[i].next_by_identity) {
+        entry_t &entry = _entries[i];
+
+        if (!entry.flags.connected &&
+            entry.identity_address == peer_address &&
+            entry.identity_address_is_public == peer_address_public) {
+            return &entry.flags;
+        }
+    }
+
+    return NULL;
+}
+
+void IndexedFileSecurityDb::close_entry(entry_handle_t db_handle) {
+    entry_t *entry = as_entry(db_handle);
+    if (!entry || !entry->used) {
+        return;
+    }
+
+    entry->flags.connected = false;
+
+    reindex_opened_entries();
+    remove_opened(entry);
+
+    /* entries without a bond are not kept */
+    if (has_keys(entry->flags)) {
+        modify_record(entry);
+    } else {
+        reset_entry(entry);
+    }
+
+    flush();
+}
+
+void IndexedFileSecurityDb::clear_entries() {
+    reset_ram();
+
+    _local_identity = SecurityEntryIdentity_t();
+    _local_csrk = csrk_t();
+
+    db_header_t header;
+    db_read(&header, DB_OFFSET_HEADER);
+
+    if (!erase_db_file(_db_file, _max_entries)) {
+        /* the file is closed on failure */
+        _db_file = NULL;
+        return;
+    }
+
+    db_write(&header.restore, DB_OFFSET_RESTORE);
+    fflush(_db_file);
+}
+
+/* saving and loading from nvm */
+
+void IndexedFileSecurityDb::restore() {
+    reset_ram();
+
+    /* restore if requested */
+    db_header_t header;
+    if (!_entries || !db_read(&header, DB_OFFSET_HEADER)) {
+        return;
+    }
+
+    if (!header.restore) {
+        if (!erase_db_file(_db_file, _max_entries)) {
+            _db_file = NULL;
+        }
+        return;
+    }
+
+    replay_journal();
+
+    db_local_t local;
+    if (db_read(&local, DB_OFFSET_LOCAL)) {
+        _local_identity = local.identity;
+        _local_csrk = local.csrk;
+        _local_sign_counter = local.sign_counter;
+        _gatt_cache_tag = local.gatt_cache_tag;
+    }
+
+    load_entries();
+}
+
+void IndexedFileSecurityDb::sync(entry_handle_t db_handle) {
+    entry_t *entry = as_entry(db_handle);
+    if (entry && entry->used) {
+        modify_record(entry);
+    }
+
+    flush();
+}
+
+void IndexedFileSecurityDb::set_restore(bool reload) {
+    const uint8_t restore = reload;
+    db_write(&restore, DB_OFFSET_RESTORE);
+    fflush(_db_file);
+}
+
+/* helper functions */
+
+size_t IndexedFileSecurityDb::get_entry_count() {
+    return _entries ? _max_entries : 0;
+}
+
+SecurityDistributionFlags_t* IndexedFileSecurityDb::get_entry_handle_by_index(size_t index) {
+    if (index < get_entry_count()) {
+        return &_entries[index].flags;
+    } else {
+        return NULL;
+    }
+}
+
+void IndexedFileSecurityDb::reset_entry(entry_handle_t db_entry) {
+    entry_t *entry = as_entry(db_entry);
+    if (!entry || !entry->used) {
+        return;
+    }
+
+    const size_t index = index_of(entry);
+
+    if (entry->persisted || find_dirty(index)) {
+        record_t *record = modify_record(entry);
+        if (record) {
+            memset(static_cast<void*>(record), 0, sizeof(record_t));
+        }
+    }
+
+    unindex_address(index);
+    if (entry->in_identity_index) {
+        unindex_identity(index);
+    }
+    remove_opened(entry);
+
+    release_entry(entry);
+}
+
+SecurityEntryIdentity_t* IndexedFileSecurityDb::read_in_entry_peer_identity(entry_handle_t db_entry) {
+    const record_t *record = read_record(as_entry(db_entry));
+    if (!record) {
+        return NULL;
+    }
+
+    _buffer.peer_identity = record->peer_identity;
+    return &_buffer.peer_identity;
+};
+
+SecurityEntryKeys_t* IndexedFileSecurityDb::read_in_entry_peer_keys(entry_handle_t db_entry) {
+    const record_t *record = read_record(as_entry(db_entry));
+    if (!record) {
+        return NULL;
+    }
+
+    _buffer.peer_keys = record->peer_keys;
+    return &_buffer.peer_keys;
+};
+
+SecurityEntryKeys_t* IndexedFileSecurityDb::read_in_entry_local_keys(entry_handle_t db_entry) {
+    const record_t *record = read_record(as_entry(db_entry));
+    if (!record) {
+        return NULL;
+    }
+
+    _buffer.local_keys = record->local_keys;
+    return &_buffer.local_keys;
+};
+
+SecurityEntrySigning_t* IndexedFileSecurityDb::read_in_entry_peer_signing(entry_handle_t db_entry) {
+    entry_t *entry = as_entry(db_entry);
+    const record_t *record = read_record(entry);
+    if (!record) {
+        return NULL;
+    }
+
+    /* use the counter held in memory */
+    _buffer.peer_signing = record->peer_signing;
+    _buffer.peer_signing.counter = entry->peer_sign_counter;
+    return &_buffer.peer_signing;
+};
+
+size_t IndexedFileSecurityDb::hash_address(const address_t &address, bool is_public) const {
+    const uint8_t address_type = is_public;
+    uint32_t hash = checksum(address.data(), address.size());
+    return checksum(&address_type, sizeof(address_type), hash) & _index_mask;
+}
+
+void IndexedFileSecurityDb::index_address(size_t index) {
+    entry_t &entry = _entries[index];
+    entry.address_bucket = hash_address(
+        entry.flags.peer_address,
+        entry.flags.peer_address_is_public
+    );
+    entry.next_by_address = _address_index[entry.address_bucket];
+    _address_index[entry.address_bucket] = index;
+}
+
+void IndexedFileSecurityDb::unindex_address(size_t index) {
+    uint16_t *link = &_address_index[_entries[index].address_bucket];
+    while (*link != NO_ENTRY) {
+        if (*link == index) {
+            *link = _entries[index].next_by_address;
+            break;
+        }
+        link = &_entries[*link].next_by_address;
+    }
+    _entries[index].next_by_address = NO_ENTRY;
+}
+
+void IndexedFileSecurityDb::index_identity(size_t index) {
+    entry_t &entry = _entries[index];
+    entry.identity_bucket = hash_address(
+        entry.identity_address,
+        entry.identity_address_is_public
+    );
+    entry.next_by_identity = _identity_index[entry.identity_bucket];
+    _identity_index[entry.identity_bucket] = index;
+    entry.in_identity_index = true;
+}
+
+void IndexedFileSecurityDb::unindex_identity(size_t index) {
+    uint16_t *link = &_identity_index[_entries[index].identity_bucket];
+    while (*link != NO_ENTRY) {
+        if (*link == index) {
+            *link = _entries[index].next_by_identity;
+            break;
+        }
+        link = &_entries[*link].next_by_identity;
+    }
+    _entries[index].next_by_identity = NO_ENTRY;
+    _entries[index].in_identity_index = false;
+}
+
+void IndexedFileSecurityDb::reindex_opened_entries() {
+    for (uint16_t i = _opened_list; i != NO_ENTRY; i = _entries[i].next_opened) {
+        const entry_t &entry = _entries[i];
+        const size_t bucket = hash_address(
+            entry.flags.peer_address,
+            entry.flags.peer_address_is_public
+        );
+        if (bucket != entry.address_bucket) {
+            unindex_address(i);
+            index_address(i);
+        }
+    }
+}
+
+void IndexedFileSecurityDb::remove_opened(entry_t *entry) {
+    if (!entry->opened) {
+        return;
+    }
+
+    const size_t index = index_of(entry);
+    uint16_t *link = &_opened_list;
+    while (*link != NO_ENTRY) {
+        if (*link == index) {
+            *link = entry->next_opened;
+            break;
+        }
+        link = &_entries[*link].next_opened;
+    }
+    entry->next_opened = NO_ENTRY;
+    entry->opened = false;
+}
+
+IndexedFileSecurityDb::entry_t* IndexedFileSecurityDb::allocate_entry() {
+    if (!_entries) {
+        return NULL;
+    }
+
+    if (_free_list == NO_ENTRY) {
+        /* recycle the least recently used bond */
+        entry_t *oldest = NULL;
+        for (size_t i = 0; i < _max_entries; i++) {
+            entry_t &entry = _entries[i];
+            if (entry.opened || entry.flags.connected) {
+                continue;
+            }
+            if (!oldest || (int32_t)(entry.last_used - oldest->last_used) < 0) {
+                oldest = &entry;
+            }
+        }
+
+        if (!oldest) {
+            return NULL;
+        }
+
+        reset_entry(oldest);
+    }
+
+    entry_t *entry = &_entries[_free_list];
+    _free_list = entry->next_by_address;
+
+    entry->next_by_address = NO_ENTRY;
+    entry->used = true;
+    entry->gatt_cache_tag = ++_gatt_cache_tag;
+    entry->last_used = ++_use_counter;
+
+    return entry;
+}
+
+void IndexedFileSecurityDb::release_entry(entry_t *entry) {
+    entry->flags = SecurityDistributionFlags_t();
+    entry->peer_sign_counter = 0;
+    entry->gatt_cache_tag = 0;
+    entry->last_used = 0;
+    entry->identity_address = address_t();
+    entry->identity_address_is_public = false;
+    entry->used = false;
+    entry->opened = false;
+    entry->persisted = false;
+    entry->in_identity_index = false;
+    entry->address_bucket = 0;
+    entry->identity_bucket = 0;
+    entry->next_by_identity = NO_ENTRY;
+    entry->next_opened = NO_ENTRY;
+
+    entry->next_by_address = _free_list;
+    _free_list = index_of(entry);
+}
+
+IndexedFileSecurityDb::record_t* IndexedFileSecurityDb::modify_record(entry_t *entry) {
+    if (!entry || !entry->used) {
+        return NULL;
+    }
+
+    const size_t index = index_of(entry);
+    dirty_record_t *dirty = find_dirty(index);
+    if (dirty) {
+        return &dirty->record;
+    }
+
+    if (_dirty_count == MAX_DIRTY_ENTRIES) {
+        flush();
+    }
+
+    dirty = &_dirty[_dirty_count];
+    if (!entry->persisted || !db_read(&dirty->record, record_offset(index))) {
+        memset(static_cast<void*>(&dirty->record), 0, sizeof(record_t));
+    }
+    dirty->index = index;
+    _dirty_count++;
+
+    return &dirty->record;
+}
+
+const IndexedFileSecurityDb::record_t* IndexedFileSecurityDb::read_record(entry_t *entry) {
+    if (!entry || !entry->used) {
+        return NULL;
+    }
+
+    const size_t index = index_of(entry);
+    dirty_record_t *dirty = find_dirty(index);
+    if (dirty) {
+        return &dirty->record;
+    }
+
+    if (!entry->persisted || !db_read(&_buffer, record_offset(index))) {
+        memset(static_cast<void*>(&_buffer), 0, sizeof(record_t));
+    }
+
+    return &_buffer;
+}
+
+IndexedFileSecurityDb::dirty_record_t* IndexedFileSecurityDb::find_dirty(size_t index) {
+    for (size_t i = 0; i < _dirty_count; i++) {
+        if (_dirty[i].index == index) {
+            return &_dirty[i];
+        }
+    }
+    return NULL;
+}
+
+void IndexedFileSecurityDb::flush() {
+    if (!_db_file || (!_dirty_count && !_local_dirty)) {
+        return;
+    }
+
+    /* bring the records up to date with the state held in memory */
+    for (size_t i = 0; i < _dirty_count; i++) {
+        entry_t &entry = _entries[_dirty[i].index];
+        record_t &record = _dirty[i].record;
+        if (entry.used) {
+            record.flags = entry.flags;
+            record.flags.connected = false;
+            record.peer_signing.counter = entry.peer_sign_counter;
+            record.gatt_cache_tag = entry.gatt_cache_tag;
+        }
+    }
+
+    db_local_t local;
+    memset(static_cast<void*>(&local), 0, sizeof(local));
+    local.identity = _local_identity;
+    local.csrk = _local_csrk;
+    local.sign_counter = _local_sign_counter;
+    local.gatt_cache_tag = _gatt_cache_tag;
+
+    /* write the journal then commit it */
+    db_journal_t journal;
+    journal.count = _dirty_count;
+    journal.checksum = checksum(&local, sizeof(local));
+    journal.checksum = checksum(_dirty, _dirty_count * sizeof(dirty_record_t), journal.checksum);
+
+    bool success = db_write(&local, DB_OFFSET_JOURNAL_LOCAL);
+    if (_dirty_count) {
+        success = success && fwrite(_dirty, sizeof(dirty_record_t), _dirty_count, _db_file) == _dirty_count;
+    }
+    success = success && !fflush(_db_file);
+    success = success && db_write(&journal, DB_OFFSET_JOURNAL) && !fflush(_db_file);
+
+    if (!success) {
+        /* the file content is unchanged, keep the records for a retry */
+        return;
+    }
+
+    /* apply the transaction */
+    db_write(&local, DB_OFFSET_LOCAL);
+    for (size_t i = 0; i < _dirty_count; i++) {
+        db_write(&_dirty[i].record, record_offset(_dirty[i].index));
+        _entries[_dirty[i].index].persisted = _entries[_dirty[i].index].used;
+    }
+    fflush(_db_file);
+
+    /* the journal is not needed anymore */
+    journal.count = 0;
+    journal.checksum = 0;
+    db_write(&journal, DB_OFFSET_JOURNAL);
+    fflush(_db_file);
+
+    _dirty_count = 0;
+    _local_dirty = false;
+}
+
+void IndexedFileSecurityDb::replay_journal() {
+    db_journal_t journal;
+    if (!db_read(&journal, DB_OFFSET_JOURNAL) || journal.count == 0) {
+        return;
+    }
+
+    db_local_t local;
+    bool valid = journal.count <= MAX_DIRTY_ENTRIES && db_read(&local, DB_OFFSET_JOURNAL_LOCAL);
+    if (valid && journal.count) {
+        valid = fread(_dirty, sizeof(dirty_record_t), journal.count, _db_file) == journal.count;
+    }
+
+    /* an incomplete journal was never committed */
+    if (valid) {
+        uint32_t sum = checksum(&local, sizeof(local));
+        sum = checksum(_dirty, journal.count * sizeof(dirty_record_t), sum);
+        valid = (sum == journal.checksum);
+    }
+
+    if (valid) {
+        db_write(&local, DB_OFFSET_LOCAL);
+        for (size_t i = 0; i < journal.count; i++) {
+            if (_dirty[i].index < _max_entries) {
+                db_write(&_dirty[i].record, record_offset(_dirty[i].index));
+            }
+        }
+        fflush(_db_file);
+    }
+
+    journal.count = 0;
+    journal.checksum = 0;
+    db_write(&journal, DB_OFFSET_JOURNAL);
+    fflush(_db_file);
+}
+
+void IndexedFileSecurityDb::load_entries() {
+    /* entries are read in order, the free list is rebuilt from the end */
+    _free_list = NO_ENTRY;
+    fseek(_db_file, record_offset(0), SEEK_SET);
+
+    for (size_t i = 0; i < _max_entries; i++) {
+        if (fread(&_buffer, sizeof(record_t), 1, _db_file) != 1) {
+            memset(static_cast<void*>(&_buffer), 0, sizeof(record_t));
+        }
+
+        entry_t &entry = _entries[i];
+        if (!has_keys(_buffer.flags)) {
+            continue;
+        }
+
+        entry.flags = _buffer.flags;
+        entry.flags.connected = false;
+        entry.peer_sign_counter = _buffer.peer_signing.counter;
+        entry.gatt_cache_tag = _buffer.gatt_cache_tag;
+        entry.used = true;
+        entry.persisted = true;
+        entry.last_used = i;
+        entry.identity_address = _buffer.peer_identity.identity_address;
+        entry.identity_address_is_public = _buffer.peer_identity.identity_address_is_public;
+    }
+
+    _use_counter = _max_entries;
+
+    /* index the bonds; index_address uses the position in the file */
+    for (size_t i = _max_entries; i--;) {
+        entry_t &entry = _entries[i];
+        if (entry.used) {
+            index_address(i);
+            if (entry.flags.irk_stored) {
+                index_identity(i);
+            }
+        } else {
+            entry.next_by_address = _free_list;
+            _free_list = i;
+        }
+    }
+}
+
+void IndexedFileSecurityDb::reset_ram() {
+    _free_list = NO_ENTRY;
+    _opened_list = NO_ENTRY;
+    _use_counter = 0;
+    _gatt_cache_tag = 0;
+    _dirty_count = 0;
+    _local_dirty = false;
+
+    if (!_entries || !_address_index || !_identity_index) {
+        delete [] _entries;
+        delete [] _address_index;
+        delete [] _identity_index;
+        _entries = NULL;
+        _address_index = NULL;
+        _identity_index = NULL;
+        return;
+    }
+
+    for (size_t i = 0; i <= _index_mask; i++) {
+        _address_index[i] = NO_ENTRY;
+        _identity_index[i] = NO_ENTRY;
+    }
+
+    for (size_t i = _max_entries; i--;) {
+        _entries[i].used = true;
+        release_entry(&_entries[i]);
+    }
+}
+
+long int IndexedFileSecurityDb::record_offset(size_t index) const {
+    return DB_OFFSET_RECORDS + index * sizeof(record_t);
+}
+
+long int IndexedFileSecurityDb::gatt_cache_offset(size_t index) const {
+    return DB_OFFSET_GATT_CACHES(_max_entries) + index * DB_SIZE_GATT_CACHE;
+}
+
+} /* namespace pal */
+} /* namespace ble */
@@ -0,0 +1,149 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <new>
+
+#include "ble/generic/ResolvedAddressCache.h"
+
+namespace ble {
+namespace generic {
+
+namespace {
+
+/* number of slots where an address may be stored */
+const size_t MAX_PROBES = 4;
+
+}
+
+ResolvedAddressCache::ResolvedAddressCache(size_t capacity, uint32_t timeout_ms) :
+    _entries(NULL),
+    _mask(0),
+    _probes(0),
+    _timeout(timeout_ms)
+{
+    size_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+
+    _entries = new (std::nothrow) entry_t[slots];
+    if (_entries) {
+        _mask = slots - 1;
+        _probes = slots < MAX_PROBES ? slots : MAX_PROBES;
+    }
+
+    clear();
+}
+
+ResolvedAddressCache::~ResolvedAddressCache()
+{
+    delete [] _entries;
+}
+
+bool ResolvedAddressCache::find(
+    const address_t &address,
+    uint32_t now_ms,
+    identity_t &identity
+) {
+    size_t index = slot(address);
+    for (size_t i = 0; i < _probes; ++i, index = (index + 1) & _mask) {
+        entry_t &entry = _entries[index];
+        if (!entry.used || entry.address != address) {
+            continue;
+        }
+
+        if (expired(entry, now_ms)) {
+            entry.used = false;
+            return false;
+        }
+
+        identity.address = entry.identity_address;
+        identity.is_public = entry.identity_is_public;
+        identity.resolved = entry.resolved;
+        return true;
+    }
+
+    return false;
+}
+
+void ResolvedAddressCache::add(
+    const address_t &address,
+    const identity_t &identity,
+    uint32_t now_ms
+) {
+    /* replace the same address, a free slot or the oldest result */
+    entry_t *victim = NULL;
+    uint32_t victim_age = 0;
+
+    size_t index = slot(address);
+    for (size_t i = 0; i < _probes; ++i, index = (index + 1) & _mask) {
+        entry_t &entry = _entries[index];
+
+        if (entry.used && entry.address == address) {
+            victim = &entry;
+            break;
+        }
+
+        uint32_t age = (!entry.used || expired(entry, now_ms)) ?
+            0xFFFFFFFF : now_ms - entry.time;
+        if (!victim || age > victim_age) {
+            victim = &entry;
+            victim_age = age;
+        }
+    }
+
+    if (!victim) {
+        return;
+    }
+
+    victim->address = address;
+    victim->identity_address = identity.address;
+    victim->identity_is_public = identity.is_public;
+    victim->resolved = identity.resolved;
+    victim->time = now_ms;
+    victim->used = true;
+}
+
+void ResolvedAddressCache::remove_unresolved()
+{
+    for (size_t i = 0; _entries && i <= _mask; ++i) {
+        if (!_entries[i].resolved) {
+            _entries[i].used = false;
+        }
+    }
+}
+
+void ResolvedAddressCache::clear()
+{
+    for (size_t i = 0; _entries && i <= _mask; ++i) {
+        _entries[i].used = false;
+    }
+}
+
+size_t ResolvedAddressCache::slot(const address_t &address) const
+{
+    /* the low bytes of a private resolvable address hold its hash */
+    const uint8_t *bytes = address.data();
+    return (bytes[0] | (bytes[1] << 8) | (bytes[3] << 16)) & _mask;
+}
+
+bool ResolvedAddressCache::expired(const entry_t &entry, uint32_t now_ms) const
+{
+    return (now_ms - entry.time) >= _timeout;
+}
+
+} // namespace generic
+} // namespace ble
@@ -209,7 +209,9 @@ SecurityManager& BLE::getSecurityManager()
     static generic::GenericSecurityManager m_instance(
         pal::vendor::cordio::CordioSecurityManager::get_security_manager(),
         getGap(),
-        signing_event_monitor
+        signing_event_monitor,
+        &getGattClient(),
+        &getGap()
     );
 
     return m_instance;
@@ -260,6 +262,10 @@ void BLE::processEvents()
                 BLE_ERROR_NONE
             };
             deviceInstance().getGattServer().initialize();
+            deviceInstance().getGap().onDisconnection(
+                &deviceInstance().getGattClient(),
+                &generic::GenericGattClient::on_disconnection
+            );
             deviceInstance().initialization_status = INITIALIZED;
             _init_callback.call(&context);
         }   break;
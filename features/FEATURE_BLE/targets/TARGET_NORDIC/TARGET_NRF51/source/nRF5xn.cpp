@@ -132,6 +132,8 @@ ble_error_t nRF5xn::init(BLE::InstanceID_t instanceID, FunctionPointerWithContex
         return BLE_ERROR_INTERNAL_STACK_FAILURE;
     }
 
+    gapInstance.onDisconnection(&gattClient, &ble::generic::GenericGattClient::on_disconnection);
+
     initialized = true;
     BLE::InitializationCompleteCallbackContext context = {
         BLE::Instance(instanceID),
@@ -147,6 +147,11 @@ FileHandle *ATHandler::get_file_handle()
     return _fileHandle;
 }
 
+events::EventQueue *ATHandler::get_event_queue() const
+{
+    return &_queue;
+}
+
 void ATHandler::set_file_handle(FileHandle *fh)
 {
     _fileHandle = fh;
@@ -83,6 +83,12 @@ public:
      */
     FileHandle *get_file_handle();
 
+    /** Return the event queue used by this handler.
+     *
+     *  @return event queue to which sigio events are transferred
+     */
+    events::EventQueue *get_event_queue() const;
+
     /** Locks the mutex for file handle if AT_HANDLER_MUTEX is defined.
      */
     void lock();
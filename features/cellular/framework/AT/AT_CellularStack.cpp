@@ -22,13 +22,22 @@
 using namespace mbed_cellular_util;
 using namespace mbed;
 
-AT_CellularStack::AT_CellularStack(ATHandler &at, int cid, nsapi_ip_stack_t stack_type) : AT_CellularBase(at), _socket(NULL), _socket_count(0), _cid(cid), _stack_type(stack_type)
+// interval in milliseconds between attempts to send queued data the modem did not accept
+#define SOCKET_SEND_RETRY_INTERVAL 100
+
+AT_CellularStack::AT_CellularStack(ATHandler &at, int cid, nsapi_ip_stack_t stack_type) : AT_CellularBase(at), _socket(NULL), _socket_count(0), _cid(cid), _stack_type(stack_type),
+    _flush_event_id(0), _flush_pending(false)
 {
     memset(_ip, 0, PDP_IPV6_SIZE);
 }
 
 AT_CellularStack::~AT_CellularStack()
 {
+    if (_flush_event_id) {
+        _at.get_event_queue()->cancel(_flush_event_id);
+        _flush_event_id = 0;
+    }
+
     for (int i = 0; i < _socket_count; i++) {
         if (_socket[i]) {
             delete _socket[i];
@@ -87,6 +96,16 @@ nsapi_error_t AT_CellularStack::socket_stack_init()
     return NSAPI_ERROR_OK;
 }
 
+nsapi_size_t AT_CellularStack::get_socket_rx_buffer_size()
+{
+    return 0;
+}
+
+nsapi_size_t AT_CellularStack::get_socket_tx_buffer_size()
+{
+    return 0;
+}
+
 nsapi_error_t AT_CellularStack::socket_open(nsapi_socket_t *handle, nsapi_protocol_t proto)
 {
     if (!is_protocol_supported(proto) || !handle) {
@@ -134,11 +153,20 @@ nsapi_error_t AT_CellularStack::socket_open(nsapi_socket_t *handle, nsapi_protoc
     _socket[index] = new CellularSocket;
     CellularSocket *psock;
     psock = _socket[index];
-    memset(psock, 0, sizeof(CellularSocket));
     SocketAddress addr(0, get_dynamic_ip_port());
     psock->id = index;
     psock->localAddress = addr;
     psock->proto = proto;
+
+    nsapi_size_t rx_buffer_size = get_socket_rx_buffer_size();
+    if (rx_buffer_size) {
+        psock->rx_buffer = new uint8_t[rx_buffer_size];
+    }
+    // datagrams are not coalesced, only stream sockets queue their sends
+    nsapi_size_t tx_buffer_size = get_socket_tx_buffer_size();
+    if (tx_buffer_size && proto == NSAPI_TCP) {
+        psock->tx_buffer = new uint8_t[tx_buffer_size];
+    }
     *handle = psock;
 
     _socket_mutex.unlock();
@@ -178,6 +206,10 @@ nsapi_error_t AT_CellularStack::socket_close(nsapi_socket_t handle)
     // Close the socket on the modem if it was created
     _at.lock();
     if (sock_created) {
+        // queued data is sent before closing
+        _socket_mutex.lock();
+        flush_socket(socket);
+        _socket_mutex.unlock();
         err = socket_close_impl(sock_id);
     }
 
@@ -272,6 +304,10 @@ nsapi_size_or_error_t AT_CellularStack::socket_sendto(nsapi_socket_t handle, con
         return NSAPI_ERROR_DEVICE_ERROR;
     }
 
+    if (socket->tx_buffer) {
+        return queue_send(socket, data, size);
+    }
+
     _at.lock();
 
     ret_val = socket_sendto_impl(socket, addr, data, size);
@@ -312,13 +348,45 @@ nsapi_size_or_error_t AT_CellularStack::socket_recvfrom(nsapi_socket_t handle, S
         }
     }
 
-    _at.lock();
+    if (!socket->rx_buffer) {
+        _at.lock();
 
-    ret_val = socket_recvfrom_impl(socket, addr, buffer, size);
+        ret_val = socket_recvfrom_impl(socket, addr, buffer, size);
 
-    _at.unlock();
+        _at.unlock();
 
-    return ret_val;
+        return ret_val;
+    }
+
+    if (!socket->rx_len) {
+        _at.lock();
+
+        ret_val = socket_recvfrom_impl(socket, &socket->rx_address, socket->rx_buffer, get_socket_rx_buffer_size());
+
+        _at.unlock();
+
+        if (ret_val <= 0) {
+            return ret_val;
+        }
+        socket->rx_pos = 0;
+        socket->rx_len = ret_val;
+    }
+
+    nsapi_size_t len = socket->rx_len < size ? socket->rx_len : size;
+    memcpy(buffer, socket->rx_buffer + socket->rx_pos, len);
+    if (addr) {
+        *addr = socket->rx_address;
+    }
+
+    if (socket->proto == NSAPI_UDP) {
+        // rest of the datagram is discarded
+        socket->rx_len = 0;
+    } else {
+        socket->rx_pos += len;
+        socket->rx_len -= len;
+    }
+
+    return len;
 }
 
 void AT_CellularStack::socket_attach(nsapi_socket_t handle, void (*callback)(void *), void *data)
@@ -330,3 +398,132 @@ void AT_CellularStack::socket_attach(nsapi_socket_t handle, void (*callback)(voi
     socket->_cb = callback;
     socket->_data = data;
 }
+
+nsapi_size_or_error_t AT_CellularStack::queue_send(CellularSocket *socket, const void *data, nsapi_size_t size)
+{
+    nsapi_size_t buffer_size = get_socket_tx_buffer_size();
+
+    _socket_mutex.lock();
+
+    if (socket->tx_error != NSAPI_ERROR_OK) {
+        nsapi_error_t err = socket->tx_error;
+        socket->tx_error = NSAPI_ERROR_OK;
+        _socket_mutex.unlock();
+        return err;
+    }
+
+    nsapi_size_t len = buffer_size - socket->tx_len;
+    if (len > size) {
+        len = size;
+    }
+    if (!len) {
+        // socket callback is called when the queue drains
+        _socket_mutex.unlock();
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+
+    // data is appended behind the bytes that may be being sent
+    nsapi_size_t tail = (socket->tx_head + socket->tx_len) % buffer_size;
+    nsapi_size_t first = buffer_size - tail;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(socket->tx_buffer + tail, data, first);
+    memcpy(socket->tx_buffer, (const uint8_t *)data + first, len - first);
+    socket->tx_len += len;
+
+    // the event id is written under the mutex as the flush may already run and clear it
+    bool flush_now = false;
+    if (!_flush_pending) {
+        _flush_pending = true;
+        _flush_event_id = _at.get_event_queue()->call(mbed::Callback<void()>(this, &AT_CellularStack::flush_sockets));
+        flush_now = !_flush_event_id;
+    }
+
+    _socket_mutex.unlock();
+
+    if (flush_now) {
+        // no room in the event queue, send from this thread instead
+        flush_sockets();
+    }
+
+    return len;
+}
+
+void AT_CellularStack::flush_sockets()
+{
+    _at.lock();
+    _socket_mutex.lock();
+
+    _flush_event_id = 0;
+
+    // sockets which got more data while others were being sent are visited again
+    bool sent = true;
+    bool queued = false;
+    while (sent) {
+        sent = false;
+        queued = false;
+        for (int i = 0; i < _socket_count; i++) {
+            CellularSocket *socket = _socket[i];
+            if (!socket || !socket->tx_len) {
+                continue;
+            }
+            sent = flush_socket(socket) || sent;
+            queued = queued || socket->tx_len;
+        }
+    }
+
+    if (queued) {
+        // modem did not take all the data, try again later
+        _flush_event_id = _at.get_event_queue()->call_in(SOCKET_SEND_RETRY_INTERVAL,
+                                                          mbed::Callback<void()>(this, &AT_CellularStack::flush_sockets));
+    }
+    _flush_pending = (_flush_event_id != 0);
+
+    _socket_mutex.unlock();
+    _at.unlock();
+}
+
+bool AT_CellularStack::flush_socket(CellularSocket *socket)
+{
+    nsapi_size_t buffer_size = get_socket_tx_buffer_size();
+    bool sent = false;
+
+    while (socket->tx_len && socket->tx_error == NSAPI_ERROR_OK) {
+        const uint8_t *data = socket->tx_buffer + socket->tx_head;
+        nsapi_size_t len = buffer_size - socket->tx_head;
+        if (len > socket->tx_len) {
+            len = socket->tx_len;
+        }
+
+        // the queue is not locked while waiting for the modem, so the application can
+        // queue its next data while this chunk is being sent
+        _socket_mutex.unlock();
+        nsapi_size_or_error_t ret_val = socket_sendto_impl(socket, socket->remoteAddress, data, len);
+        _socket_mutex.lock();
+
+        if (ret_val == NSAPI_ERROR_WOULD_BLOCK || ret_val == 0) {
+            break;
+        }
+
+        if (ret_val < 0) {
+            tr_error("Error sending queued data error code: %d", ret_val);
+            socket->tx_error = ret_val;
+            socket->tx_head = 0;
+            socket->tx_len = 0;
+        } else {
+            socket->tx_head = (socket->tx_head + ret_val) % buffer_size;
+            socket->tx_len -= ret_val;
+            sent = true;
+        }
+
+        // wake up a sender waiting for room in the queue
+        if (socket->_cb) {
+            _socket_mutex.unlock();
+            socket->_cb(socket->_data);
+            _socket_mutex.lock();
+        }
+    }
+
+    return sent;
+}
@@ -95,9 +95,22 @@ protected:
             started(false),
             tx_ready(false),
             rx_avail(false),
-            pending_bytes(0)
+            pending_bytes(0),
+            rx_buffer(NULL),
+            rx_pos(0),
+            rx_len(0),
+            rx_address("", 0),
+            tx_buffer(NULL),
+            tx_head(0),
+            tx_len(0),
+            tx_error(NSAPI_ERROR_OK)
         {
         }
+        ~CellularSocket()
+        {
+            delete [] rx_buffer;
+            delete [] tx_buffer;
+        }
         // Socket id from cellular device
         int id;
         // Being connected means remote ip address and port are set
@@ -112,8 +125,35 @@ protected:
         bool tx_ready; // socket is ready for sending on modem stack
         bool rx_avail; // socket has data for reading on modem stack
         nsapi_size_t pending_bytes; // The number of received bytes pending
+        uint8_t *rx_buffer; // data read ahead from modem stack, NULL if read-ahead is disabled
+        nsapi_size_t rx_pos; // offset of the first unread byte in rx_buffer
+        nsapi_size_t rx_len; // number of unread bytes in rx_buffer
+        SocketAddress rx_address; // source of the data in rx_buffer
+        uint8_t *tx_buffer; // ring of data queued for sending, NULL if send queue is disabled
+        nsapi_size_t tx_head; // offset of the first queued byte in tx_buffer
+        nsapi_size_t tx_len; // number of queued bytes, including the ones being sent
+        nsapi_error_t tx_error; // error of a queued send, returned by the next send
     };
 
+    /**
+    * Gets the size of the receive buffer of each socket. Data is read from the modem
+    * in chunks of this size so that small reads do not each cost a command exchange;
+    * should match the most the modem returns in a single read command.
+    *
+    * @return buffer size in bytes, 0 to read only what the application asks for
+    */
+    virtual nsapi_size_t get_socket_rx_buffer_size();
+
+    /**
+    * Gets the size of the send queue of each TCP socket. Sends are copied to the queue
+    * and written to the modem from the event queue, coalescing the small writes queued
+    * while the previous one was being sent; should match the most the modem accepts in
+    * a single send command.
+    *
+    * @return queue size in bytes, 0 to send synchronously
+    */
+    virtual nsapi_size_t get_socket_tx_buffer_size();
+
     /**
     * Gets maximum number of sockets modem supports
     */
@@ -182,8 +222,21 @@ protected:
     nsapi_ip_stack_t _stack_type;
 
 private:
+    nsapi_size_or_error_t queue_send(CellularSocket *socket, const void *data, nsapi_size_t size);
+
+    // Writes the send queues of all sockets to the modem, run from the event queue
+    void flush_sockets();
+
+    // Writes the send queue of a socket to the modem, called with _at and _socket_mutex locked.
+    // Returns true if the modem took some of the data.
+    bool flush_socket(CellularSocket *socket);
+
     // mutex for write/read to a _socket array, needed when multiple threads may open sockets simultaneously
     PlatformMutex _socket_mutex;
+
+    // id of the pending flush_sockets event, 0 if none is pending
+    int _flush_event_id;
+    bool _flush_pending;
 };
 
 } // namespace mbed
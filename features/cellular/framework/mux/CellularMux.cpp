@@ -0,0 +1,762 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include "CellularMux.h"
+#include "CellularLog.h"
+#include "mbed_poll.h"
+#include "mbed_assert.h"
+#include "Kernel.h"
+
+using namespace mbed;
+using namespace events;
+
+// 3GPP TS 27.010 basic option framing
+#define FLAG 0xF9
+#define EA 0x01
+#define CR 0x02
+#define PF 0x10
+
+// frame types, without the poll/final bit
+#define SABM 0x2F
+#define UA 0x63
+#define DM 0x0F
+#define DISC 0x43
+#define UIH 0xEF
+#define UI 0x03
+
+// control channel message types, with EA set and C/R cleared
+#define MSG_PN 0x81
+#define MSG_CLD 0xC1
+#define MSG_TEST 0x21
+#define MSG_FCON 0xA1
+#define MSG_FCOFF 0x61
+#define MSG_MSC 0xE1
+#define MSG_NSC 0x11
+
+// modem status command signals
+#define MSC_FC 0x02
+#define MSC_RTC 0x04
+#define MSC_RTR 0x08
+#define MSC_DV 0x80
+
+// FCS of a frame received intact, TS 27.010 annex B
+#define FCS_GOOD 0xCF
+
+// event flags: answer to a request, input from the modem, and a read and a write flag per channel
+#define REQUEST_FLAG 0x01
+#define RX_FLAG 0x02
+#define CHANNEL_READ_FLAG(index) (0x04 << (2 * (index)))
+#define CHANNEL_WRITE_FLAG(index) (0x08 << (2 * (index)))
+
+// the top bit of event flags is reserved
+MBED_STATIC_ASSERT(MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT <= 14, "Mux channel count must not exceed 14");
+
+// flag, address, control, two length octets, FCS and flag
+#define FRAME_OVERHEAD 7
+
+// longest control message answered
+#define CONTROL_MESSAGE_MAX 16
+
+static const uint8_t crc_table[256] = {
+    0x00, 0x91, 0xE3, 0x72, 0x07, 0x96, 0xE4, 0x75, 0x0E, 0x9F, 0xED, 0x7C, 0x09, 0x98, 0xEA, 0x7B,
+    0x1C, 0x8D, 0xFF, 0x6E, 0x1B, 0x8A, 0xF8, 0x69, 0x12, 0x83, 0xF1, 0x60, 0x15, 0x84, 0xF6, 0x67,
+    0x38, 0xA9, 0xDB, 0x4A, 0x3F, 0xAE, 0xDC, 0x4D, 0x36, 0xA7, 0xD5, 0x44, 0x31, 0xA0, 0xD2, 0x43,
+    0x24, 0xB5, 0xC7, 0x56, 0x23, 0xB2, 0xC0, 0x51, 0x2A, 0xBB, 0xC9, 0x58, 0x2D, 0xBC, 0xCE, 0x5F,
+    0x70, 0xE1, 0x93, 0x02, 0x77, 0xE6, 0x94, 0x05, 0x7E, 0xEF, 0x9D, 0x0C, 0x79, 0xE8, 0x9A, 0x0B,
+    0x6C, 0xFD, 0x8F, 0x1E, 0x6B, 0xFA, 0x88, 0x19, 0x62, 0xF3, 0x81, 0x10, 0x65, 0xF4, 0x86, 0x17,
+    0x48, 0xD9, 0xAB, 0x3A, 0x4F, 0xDE, 0xAC, 0x3D, 0x46, 0xD7, 0xA5, 0x34, 0x41, 0xD0, 0xA2, 0x33,
+    0x54, 0xC5, 0xB7, 0x26, 0x53, 0xC2, 0xB0, 0x21, 0x5A, 0xCB, 0xB9, 0x28, 0x5D, 0xCC, 0xBE, 0x2F,
+    0xE0, 0x71, 0x03, 0x92, 0xE7, 0x76, 0x04, 0x95, 0xEE, 0x7F, 0x0D, 0x9C, 0xE9, 0x78, 0x0A, 0x9B,
+    0xFC, 0x6D, 0x1F, 0x8E, 0xFB, 0x6A, 0x18, 0x89, 0xF2, 0x63, 0x11, 0x80, 0xF5, 0x64, 0x16, 0x87,
+    0xD8, 0x49, 0x3B, 0xAA, 0xDF, 0x4E, 0x3C, 0xAD, 0xD6, 0x47, 0x35, 0xA4, 0xD1, 0x40, 0x32, 0xA3,
+    0xC4, 0x55, 0x27, 0xB6, 0xC3, 0x52, 0x20, 0xB1, 0xCA, 0x5B, 0x29, 0xB8, 0xCD, 0x5C, 0x2E, 0xBF,
+    0x90, 0x01, 0x73, 0xE2, 0x97, 0x06, 0x74, 0xE5, 0x9E, 0x0F, 0x7D, 0xEC, 0x99, 0x08, 0x7A, 0xEB,
+    0x8C, 0x1D, 0x6F, 0xFE, 0x8B, 0x1A, 0x68, 0xF9, 0x82, 0x13, 0x61, 0xF0, 0x85, 0x14, 0x66, 0xF7,
+    0xA8, 0x39, 0x4B, 0xDA, 0xAF, 0x3E, 0x4C, 0xDD, 0xA6, 0x37, 0x45, 0xD4, 0xA1, 0x30, 0x42, 0xD3,
+    0xB4, 0x25, 0x57, 0xC6, 0xB3, 0x22, 0x50, 0xC1, 0xBA, 0x2B, 0x59, 0xC8, 0xBD, 0x2C, 0x5E, 0xCF
+};
+
+static uint8_t crc(uint8_t fcs, uint8_t byte)
+{
+    return crc_table[fcs ^ byte];
+}
+
+CellularMuxChannel::CellularMuxChannel(CellularMux &mux, uint8_t dlci, int index) :
+    _mux(mux),
+    _dlci(dlci),
+    _read_flag(CHANNEL_READ_FLAG(index)),
+    _write_flag(CHANNEL_WRITE_FLAG(index)),
+    _open(false),
+    _blocking(true),
+    _tx_stopped(false),
+    _rx_stopped(false)
+{
+}
+
+ssize_t CellularMuxChannel::write(const void *buffer, size_t length)
+{
+    return _mux.channel_write(this, (const uint8_t *)buffer, length);
+}
+
+ssize_t CellularMuxChannel::read(void *buffer, size_t length)
+{
+    return _mux.channel_read(this, (uint8_t *)buffer, length);
+}
+
+off_t CellularMuxChannel::seek(off_t offset, int whence)
+{
+    return -ESPIPE;
+}
+
+int CellularMuxChannel::close()
+{
+    return _mux.close_channel(this) == NSAPI_ERROR_OK ? 0 : -EIO;
+}
+
+int CellularMuxChannel::isatty()
+{
+    return true;
+}
+
+int CellularMuxChannel::set_blocking(bool blocking)
+{
+    _blocking = blocking;
+    return 0;
+}
+
+bool CellularMuxChannel::is_blocking() const
+{
+    return _blocking;
+}
+
+short CellularMuxChannel::poll(short events) const
+{
+    // pick up what the modem has sent, in case no other thread processes the input
+    _mux.process(0);
+
+    short revents = 0;
+    if (!_rx_buffer.empty()) {
+        revents |= POLLIN;
+    }
+    if (_open && !_tx_stopped) {
+        revents |= POLLOUT;
+    }
+    if (!_open) {
+        revents |= POLLHUP;
+    }
+    return revents;
+}
+
+void CellularMuxChannel::sigio(Callback<void()> func)
+{
+    _sigio_cb = func;
+    if (func && poll(POLLIN | POLLOUT)) {
+        func();
+    }
+}
+
+uint8_t CellularMuxChannel::get_dlci() const
+{
+    return _dlci;
+}
+
+void CellularMuxChannel::receive(const uint8_t *data, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++) {
+        if (_rx_buffer.full()) {
+            tr_warn("Mux channel %d overflow, %d bytes dropped", _dlci, length - i);
+            break;
+        }
+        _rx_buffer.push(data[i]);
+    }
+
+    // ask the modem to stop before the next frame would not fit
+    if (!_rx_stopped && MBED_CONF_CELLULAR_MUX_CHANNEL_RX_BUFFER_SIZE - _rx_buffer.size() < _mux._frame_size) {
+        _rx_stopped = true;
+        _mux.send_modem_status(_dlci, true, true);
+    }
+
+    wake();
+}
+
+void CellularMuxChannel::wake()
+{
+    _mux._flags.set(_read_flag | _write_flag);
+    if (_sigio_cb) {
+        _sigio_cb();
+    }
+    poll_change(this);
+}
+
+CellularMux::CellularMux(FileHandle *serial, EventQueue &queue, uint16_t frame_size) :
+    _serial(serial),
+    _queue(queue),
+    _frame_size(frame_size),
+    _started(false),
+    _rx_event_pending(false),
+    _rx_event_id(0),
+    _rx_state(RxFlag),
+    _rx_address(0),
+    _rx_control(0),
+    _rx_length(0),
+    _rx_pos(0),
+    _rx_fcs(0xFF),
+    _rx_data(NULL),
+    _tx_frame(NULL)
+{
+    for (int i = 0; i < MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT; i++) {
+        _channels[i] = NULL;
+    }
+    _request.dlci = -1;
+    _request.answered = false;
+    _request.accepted = false;
+
+    _rx_data = new uint8_t[_frame_size];
+    _tx_frame = new uint8_t[_frame_size + FRAME_OVERHEAD];
+
+    _serial->sigio(Callback<void()>(this, &CellularMux::sigio_event));
+}
+
+CellularMux::~CellularMux()
+{
+    _serial->sigio(NULL);
+    if (_rx_event_id) {
+        _queue.cancel(_rx_event_id);
+    }
+
+    for (int i = 0; i < MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT; i++) {
+        delete _channels[i];
+    }
+    delete [] _rx_data;
+    delete [] _tx_frame;
+}
+
+nsapi_error_t CellularMux::start(int timeout)
+{
+    if (_started) {
+        return NSAPI_ERROR_OK;
+    }
+
+    nsapi_error_t err = request(0, SABM | PF, timeout);
+    if (err == NSAPI_ERROR_OK) {
+        _started = true;
+    }
+    tr_info("Mux start error: %d", err);
+
+    return err;
+}
+
+nsapi_error_t CellularMux::stop()
+{
+    if (!_started) {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+
+    const uint8_t close_down[] = { MSG_CLD | CR, EA };
+    send_frame(0, UIH, true, close_down, sizeof(close_down));
+
+    _mutex.lock();
+    _started = false;
+    for (int i = 0; i < MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT; i++) {
+        if (_channels[i] && _channels[i]->_open) {
+            _channels[i]->_open = false;
+            _channels[i]->wake();
+        }
+    }
+    _mutex.unlock();
+
+    return NSAPI_ERROR_OK;
+}
+
+CellularMuxChannel *CellularMux::open_channel(uint8_t dlci, int timeout)
+{
+    if (!_started || dlci == 0 || dlci > 63) {
+        return NULL;
+    }
+
+    _mutex.lock();
+    CellularMuxChannel *channel = find_channel(dlci);
+    if (!channel) {
+        for (int i = 0; i < MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT; i++) {
+            if (!_channels[i]) {
+                channel = new CellularMuxChannel(*this, dlci, i);
+                _channels[i] = channel;
+                break;
+            }
+        }
+    } else if (channel->_open) {
+        channel = NULL;
+    }
+    _mutex.unlock();
+
+    if (!channel) {
+        tr_error("Mux channel %d not available", dlci);
+        return NULL;
+    }
+
+    nsapi_error_t err = request(dlci, SABM | PF, timeout);
+    if (err != NSAPI_ERROR_OK) {
+        tr_error("Mux channel %d open error: %d", dlci, err);
+        return NULL;
+    }
+
+    _mutex.lock();
+    channel->_open = true;
+    channel->_tx_stopped = false;
+    channel->_rx_stopped = false;
+    channel->_rx_buffer.reset();
+    _mutex.unlock();
+
+    // tell the modem the channel is ready for data
+    send_modem_status(dlci, false, true);
+
+    return channel;
+}
+
+nsapi_error_t CellularMux::close_channel(CellularMuxChannel *channel)
+{
+    _mutex.lock();
+    bool open = channel->_open;
+    channel->_open = false;
+    if (open) {
+        channel->wake();
+    }
+    _mutex.unlock();
+
+    if (!open) {
+        return NSAPI_ERROR_OK;
+    }
+
+    return request(channel->_dlci, DISC | PF, CELLULAR_MUX_TIMEOUT);
+}
+
+void CellularMux::process(int timeout)
+{
+    if (timeout) {
+        pollfh fhs;
+        fhs.fh = _serial;
+        fhs.events = POLLIN;
+        (void)poll(&fhs, 1, timeout);
+    }
+
+    _mutex.lock();
+
+    uint8_t buffer[32];
+    while (_serial->readable()) {
+        ssize_t len = _serial->read(buffer, sizeof(buffer));
+        if (len <= 0) {
+            break;
+        }
+
+        for (ssize_t i = 0; i < len; i++) {
+            uint8_t byte = buffer[i];
+            switch (_rx_state) {
+                case RxFlag:
+                    if (byte == FLAG) {
+                        _rx_state = RxAddress;
+                    }
+                    break;
+                case RxAddress:
+                    if (byte == FLAG) {
+                        // closing flag of the previous frame or fill
+                        break;
+                    }
+                    // basic option uses one octet addresses
+                    _rx_state = (byte & EA) ? RxControl : RxFlag;
+                    _rx_address = byte;
+                    _rx_fcs = crc(0xFF, byte);
+                    break;
+                case RxControl:
+                    _rx_control = byte;
+                    _rx_fcs = crc(_rx_fcs, byte);
+                    _rx_state = RxLength;
+                    break;
+                case RxLength:
+                case RxLength2:
+                    _rx_fcs = crc(_rx_fcs, byte);
+                    if (_rx_state == RxLength) {
+                        _rx_length = byte >> 1;
+                        if (!(byte & EA)) {
+                            _rx_state = RxLength2;
+                            break;
+                        }
+                    } else {
+                        _rx_length |= (uint16_t)byte << 7;
+                    }
+                    _rx_pos = 0;
+                    if (_rx_length > _frame_size) {
+                        tr_warn("Mux frame of %d bytes dropped", _rx_length);
+                        _rx_state = RxFlag;
+                    } else {
+                        _rx_state = _rx_length ? RxData : RxFcs;
+                    }
+                    break;
+                case RxData:
+                    _rx_data[_rx_pos++] = byte;
+                    // FCS covers the data of UI frames only
+                    if ((_rx_control & ~PF) == UI) {
+                        _rx_fcs = crc(_rx_fcs, byte);
+                    }
+                    if (_rx_pos == _rx_length) {
+                        _rx_state = RxFcs;
+                    }
+                    break;
+                case RxFcs:
+                    _rx_fcs = crc(_rx_fcs, byte);
+                    _rx_state = RxClosingFlag;
+                    break;
+                case RxClosingFlag:
+                    if (byte == FLAG) {
+                        if (_rx_fcs == FCS_GOOD) {
+                            handle_frame();
+                        } else {
+                            tr_warn("Mux frame FCS error");
+                        }
+                        _rx_state = RxAddress;
+                    } else {
+                        _rx_state = RxFlag;
+                    }
+                    break;
+            }
+        }
+    }
+
+    _mutex.unlock();
+}
+
+CellularMuxChannel *CellularMux::find_channel(uint8_t dlci)
+{
+    for (int i = 0; i < MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT; i++) {
+        if (_channels[i] && _channels[i]->_dlci == dlci) {
+            return _channels[i];
+        }
+    }
+    return NULL;
+}
+
+nsapi_error_t CellularMux::request(uint8_t dlci, uint8_t control, int timeout)
+{
+    _request_mutex.lock();
+
+    _mutex.lock();
+    _request.dlci = dlci;
+    _request.answered = false;
+    _request.accepted = false;
+    _flags.clear(REQUEST_FLAG);
+    _mutex.unlock();
+
+    send_frame(dlci, control, true, NULL, 0);
+
+    nsapi_error_t err = NSAPI_ERROR_TIMEOUT;
+    uint64_t start_time = rtos::Kernel::get_ms_count();
+    for (;;) {
+        _mutex.lock();
+        if (_request.answered) {
+            err = _request.accepted ? NSAPI_ERROR_OK : NSAPI_ERROR_CONNECTION_LOST;
+            break;
+        }
+        _mutex.unlock();
+
+        uint64_t elapsed = rtos::Kernel::get_ms_count() - start_time;
+        if (elapsed >= (uint64_t)timeout) {
+            _mutex.lock();
+            break;
+        }
+        wait(REQUEST_FLAG, timeout - elapsed);
+    }
+    _request.dlci = -1;
+    _mutex.unlock();
+
+    _request_mutex.unlock();
+
+    return err;
+}
+
+void CellularMux::handle_frame()
+{
+    uint8_t dlci = _rx_address >> 2;
+    uint8_t control = _rx_control & ~PF;
+    CellularMuxChannel *channel = find_channel(dlci);
+
+    switch (control) {
+        case UA:
+        case DM:
+            if (_request.dlci == dlci) {
+                _request.answered = true;
+                _request.accepted = (control == UA);
+                _flags.set(REQUEST_FLAG);
+            } else if (control == DM && channel && channel->_open) {
+                channel->_open = false;
+                channel->wake();
+            }
+            break;
+        case DISC:
+            send_frame(dlci, UA | PF, false, NULL, 0);
+            if (dlci == 0) {
+                _started = false;
+                for (int i = 0; i < MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT; i++) {
+                    if (_channels[i] && _channels[i]->_open) {
+                        _channels[i]->_open = false;
+                        _channels[i]->wake();
+                    }
+                }
+            } else if (channel && channel->_open) {
+                channel->_open = false;
+                channel->wake();
+            }
+            break;
+        case SABM:
+            // channels are only opened by this end
+            send_frame(dlci, DM | PF, false, NULL, 0);
+            break;
+        case UIH:
+        case UI:
+            if (dlci == 0) {
+                handle_control_message(_rx_data, _rx_length);
+            } else if (channel && channel->_open) {
+                channel->receive(_rx_data, _rx_length);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void CellularMux::handle_control_message(const uint8_t *data, uint16_t length)
+{
+    if (length < 2 || !(data[1] & EA)) {
+        return;
+    }
+
+    uint8_t type = data[0] & ~CR;
+    bool command = data[0] & CR;
+    uint8_t value_length = data[1] >> 1;
+    const uint8_t *value = data + 2;
+    if (value_length > length - 2) {
+        return;
+    }
+
+    if (!command) {
+        // answers to the modem status commands sent by the channels
+        return;
+    }
+
+    switch (type) {
+        case MSG_MSC:
+            if (value_length >= 2) {
+                CellularMuxChannel *channel = find_channel(value[0] >> 2);
+                if (channel) {
+                    bool stopped = value[1] & MSC_FC;
+                    bool released = channel->_tx_stopped && !stopped;
+                    channel->_tx_stopped = stopped;
+                    if (released) {
+                        channel->wake();
+                    }
+                }
+            }
+            break;
+        case MSG_FCON:
+        case MSG_FCOFF:
+            for (int i = 0; i < MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT; i++) {
+                if (_channels[i]) {
+                    _channels[i]->_tx_stopped = (type == MSG_FCOFF);
+                    if (type == MSG_FCON) {
+                        _channels[i]->wake();
+                    }
+                }
+            }
+            break;
+        case MSG_CLD:
+        case MSG_TEST:
+        case MSG_PN:
+            break;
+        default: {
+            const uint8_t not_supported[] = { MSG_NSC, (1 << 1) | EA, data[0] };
+            send_frame(0, UIH, true, not_supported, sizeof(not_supported));
+            return;
+        }
+    }
+
+    // the response repeats the values of the command
+    uint8_t response[CONTROL_MESSAGE_MAX];
+    if (length > sizeof(response)) {
+        return;
+    }
+    memcpy(response, data, length);
+    response[0] = type;
+    send_frame(0, UIH, true, response, length);
+
+    if (type == MSG_CLD) {
+        _started = false;
+        for (int i = 0; i < MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT; i++) {
+            if (_channels[i] && _channels[i]->_open) {
+                _channels[i]->_open = false;
+                _channels[i]->wake();
+            }
+        }
+    }
+}
+
+void CellularMux::send_frame(uint8_t dlci, uint8_t control, bool command, const uint8_t *data, uint16_t length)
+{
+    _tx_mutex.lock();
+
+    uint8_t *frame = _tx_frame;
+    uint16_t pos = 0;
+    frame[pos++] = FLAG;
+    // this end is the initiator, which sets C/R in commands
+    frame[pos++] = (dlci << 2) | (command ? CR : 0) | EA;
+    frame[pos++] = control;
+    if (length > 127) {
+        frame[pos++] = (length << 1) & 0xFE;
+        frame[pos++] = length >> 7;
+    } else {
+        frame[pos++] = (length << 1) | EA;
+    }
+
+    uint8_t fcs = 0xFF;
+    for (uint16_t i = 1; i < pos; i++) {
+        fcs = crc(fcs, frame[i]);
+    }
+    if (length) {
+        memcpy(frame + pos, data, length);
+        if (control == UI) {
+            for (uint16_t i = 0; i < length; i++) {
+                fcs = crc(fcs, data[i]);
+            }
+        }
+        pos += length;
+    }
+    frame[pos++] = 0xFF - fcs;
+    frame[pos++] = FLAG;
+
+    uint16_t written = 0;
+    while (written < pos) {
+        ssize_t ret = _serial->write(frame + written, pos - written);
+        if (ret <= 0) {
+            tr_error("Mux write error: %d", ret);
+            break;
+        }
+        written += ret;
+    }
+
+    _tx_mutex.unlock();
+}
+
+void CellularMux::send_modem_status(uint8_t dlci, bool flow_stopped, bool command)
+{
+    const uint8_t modem_status[] = {
+        (uint8_t)(MSG_MSC | (command ? CR : 0)),
+        (2 << 1) | EA,
+        (uint8_t)((dlci << 2) | CR | EA),
+        (uint8_t)(MSC_DV | MSC_RTR | MSC_RTC | (flow_stopped ? MSC_FC : 0) | EA)
+    };
+    send_frame(0, UIH, true, modem_status, sizeof(modem_status));
+}
+
+ssize_t CellularMux::channel_write(CellularMuxChannel *channel, const uint8_t *data, size_t length)
+{
+    size_t written = 0;
+    while (written < length) {
+        if (!channel->_open) {
+            return written ? (ssize_t)written : -ENOTCONN;
+        }
+        if (channel->_tx_stopped) {
+            if (!channel->_blocking) {
+                return written ? (ssize_t)written : -EAGAIN;
+            }
+            wait(channel->_write_flag, osWaitForever);
+            continue;
+        }
+
+        uint16_t len = (length - written) < _frame_size ? (length - written) : _frame_size;
+        send_frame(channel->_dlci, UIH, true, data + written, len);
+        written += len;
+    }
+
+    return written;
+}
+
+ssize_t CellularMux::channel_read(CellularMuxChannel *channel, uint8_t *data, size_t length)
+{
+    bool processed = false;
+    for (;;) {
+        _mutex.lock();
+        if (!channel->_rx_buffer.empty()) {
+            size_t len = 0;
+            while (len < length && channel->_rx_buffer.pop(data[len])) {
+                len++;
+            }
+
+            // let the modem send again once half of the buffer is free
+            if (channel->_rx_stopped && channel->_rx_buffer.size() <= MBED_CONF_CELLULAR_MUX_CHANNEL_RX_BUFFER_SIZE / 2) {
+                channel->_rx_stopped = false;
+                send_modem_status(channel->_dlci, false, true);
+            }
+            _mutex.unlock();
+            return len;
+        }
+        bool open = channel->_open;
+        _mutex.unlock();
+
+        if (!open) {
+            return -ENOTCONN;
+        }
+        if (!processed) {
+            // pick up what the modem has sent, in case no other thread processes the input
+            process(0);
+            processed = true;
+            continue;
+        }
+        if (!channel->_blocking) {
+            return -EAGAIN;
+        }
+        wait(channel->_read_flag, osWaitForever);
+    }
+}
+
+void CellularMux::wait(uint32_t flags, uint32_t timeout)
+{
+    // the waiting thread processes the input when the serial port signals it, as the event
+    // queue may not be dispatched; processing sets the flags of the channels it wakes
+    uint32_t ret = _flags.wait_any(flags | RX_FLAG, timeout);
+    if (!(ret & osFlagsError) && (ret & RX_FLAG)) {
+        process(0);
+    }
+}
+
+void CellularMux::sigio_event()
+{
+    // may be called in interrupt context, the input is processed in the event queue
+    // or by a thread waiting for it
+    _flags.set(RX_FLAG);
+    if (!_rx_event_pending) {
+        _rx_event_pending = true;
+        _rx_event_id = _queue.call(Callback<void()>(this, &CellularMux::rx_event));
+        if (!_rx_event_id) {
+            _rx_event_pending = false;
+        }
+    }
+}
+
+void CellularMux::rx_event()
+{
+    _rx_event_pending = false;
+    _rx_event_id = 0;
+    process(0);
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2018, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CELLULAR_MUX_H_
+#define CELLULAR_MUX_H_
+
+#include "FileHandle.h"
+#include "EventQueue.h"
+#include "CircularBuffer.h"
+#include "PlatformMutex.h"
+#include "NonCopyable.h"
+#include "nsapi_types.h"
+#include "rtos/EventFlags.h"
+
+namespace mbed {
+
+#ifndef MBED_CONF_CELLULAR_MUX_FRAME_SIZE
+#define MBED_CONF_CELLULAR_MUX_FRAME_SIZE 127
+#endif
+
+#ifndef MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT
+#define MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT 3
+#endif
+
+#ifndef MBED_CONF_CELLULAR_MUX_CHANNEL_RX_BUFFER_SIZE
+#define MBED_CONF_CELLULAR_MUX_CHANNEL_RX_BUFFER_SIZE 1024
+#endif
+
+// default timeout in milliseconds for the modem to answer a channel request
+#define CELLULAR_MUX_TIMEOUT 3000
+
+class CellularMux;
+
+/**
+ * Class CellularMuxChannel.
+ *
+ * Virtual serial port carried by one data link connection (DLC) of a CellularMux.
+ * Can be given to ATHandler or to PPP like the serial port of the modem.
+ */
+class CellularMuxChannel : public FileHandle, private NonCopyable<CellularMuxChannel> {
+public:
+    /** Write the contents of a buffer to the channel
+     *
+     *  Data is sent in frames of at most the frame size of the multiplexer.
+     *
+     *  * if the modem has stopped the channel and blocking set, wait until it is released
+     *  * if the modem has stopped the channel and non-blocking set, return -EAGAIN
+     *
+     *  @param buffer   The buffer to write from
+     *  @param length   The number of bytes to write
+     *  @return         The number of bytes written, negative error on failure
+     */
+    virtual ssize_t write(const void *buffer, size_t length);
+
+    /** Read the contents of the channel into a buffer
+     *
+     *  * if no data is available, and non-blocking set return -EAGAIN
+     *  * if no data is available, and blocking set, wait until data is available
+     *  * If any data is available, call returns immediately
+     *
+     *  @param buffer   The buffer to read in to
+     *  @param length   The number of bytes to read
+     *  @return         The number of bytes read, negative error on failure
+     */
+    virtual ssize_t read(void *buffer, size_t length);
+
+    /** Not valid for a channel, returns -ESPIPE
+     */
+    virtual off_t seek(off_t offset, int whence = SEEK_SET);
+
+    /** Close the data link connection of the channel
+     *
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int close();
+
+    /** Channel is an interactive terminal device
+     *
+     *  @return         True
+     */
+    virtual int isatty();
+
+    /** Set blocking or non-blocking mode
+     *  The default is blocking.
+     *
+     *  @param blocking true for blocking mode, false for non-blocking mode.
+     */
+    virtual int set_blocking(bool blocking);
+
+    /** Check current blocking or non-blocking mode for file operations.
+     *
+     *  @return             true for blocking mode, false for non-blocking mode.
+     */
+    virtual bool is_blocking() const;
+
+    /** Equivalent to POSIX poll(). Derived from FileHandle.
+     *  Provides a mechanism to multiplex input/output over a set of file handles.
+     */
+    virtual short poll(short events) const;
+
+    /** Register a callback on state change of the channel.
+     *
+     *  Called when data is received and when the modem releases the channel, from the
+     *  thread processing the input of the multiplexer.
+     *
+     *  @param func     Function to call on state change
+     */
+    virtual void sigio(Callback<void()> func);
+
+    /** Get the data link connection identifier of the channel
+     *
+     *  @return DLCI of the channel
+     */
+    uint8_t get_dlci() const;
+
+private:
+    friend class CellularMux;
+
+    CellularMuxChannel(CellularMux &mux, uint8_t dlci, int index);
+
+    // called by the multiplexer with its mutex locked
+    void receive(const uint8_t *data, uint16_t length);
+    void wake();
+
+    CellularMux &_mux;
+    uint8_t _dlci;
+    // event flags of the multiplexer set when the channel may be read or written
+    uint32_t _read_flag;
+    uint32_t _write_flag;
+    bool _open;
+    bool _blocking;
+    // modem has asked the channel to stop sending
+    bool _tx_stopped;
+    // channel has asked the modem to stop sending
+    bool _rx_stopped;
+    Callback<void()> _sigio_cb;
+    CircularBuffer<uint8_t, MBED_CONF_CELLULAR_MUX_CHANNEL_RX_BUFFER_SIZE> _rx_buffer;
+};
+
+/**
+ * Class CellularMux.
+ *
+ * 3GPP TS 27.010 multiplexer, basic option. Carries several virtual serial ports over
+ * the serial port of the modem so that for example PPP data, AT commands and URCs
+ * can be used at the same time.
+ *
+ * The modem is switched to multiplexer mode with AT+CMUX=0,0,<port speed>,<frame size>
+ * before start() is called; the frame size must match the one given to the multiplexer.
+ * Input from the modem is processed from the event queue, or by the thread waiting on
+ * a channel when the serial port signals it.
+ */
+class CellularMux : private NonCopyable<CellularMux> {
+public:
+    /** Constructor
+     *
+     *  @param serial       file handle of the serial port of the modem, read only when readable
+     *  @param queue        event queue where the input from the modem is processed
+     *  @param frame_size   maximum number of data bytes in a frame (N1)
+     */
+    CellularMux(FileHandle *serial, events::EventQueue &queue, uint16_t frame_size = MBED_CONF_CELLULAR_MUX_FRAME_SIZE);
+    virtual ~CellularMux();
+
+    /** Open the control channel, DLCI 0
+     *
+     *  @param timeout  milliseconds to wait for the modem to answer
+     *  @return         NSAPI_ERROR_OK on success
+     *                  NSAPI_ERROR_TIMEOUT if the modem did not answer
+     *                  NSAPI_ERROR_CONNECTION_LOST if the modem refused
+     */
+    nsapi_error_t start(int timeout = CELLULAR_MUX_TIMEOUT);
+
+    /** Close the multiplexer; the modem returns to AT command mode on its serial port.
+     *  Channels are closed and may no longer be used.
+     *
+     *  @return         NSAPI_ERROR_OK on success, NSAPI_ERROR_NO_CONNECTION if not started
+     */
+    nsapi_error_t stop();
+
+    /** Open a channel
+     *
+     *  @param dlci     data link connection identifier, 1 to 63
+     *  @param timeout  milliseconds to wait for the modem to answer
+     *  @return         the channel, NULL on failure
+     */
+    CellularMuxChannel *open_channel(uint8_t dlci, int timeout = CELLULAR_MUX_TIMEOUT);
+
+    /** Process the input from the modem
+     *
+     *  @param timeout  milliseconds to wait for input, 0 to only process what has been received
+     */
+    void process(int timeout = 0);
+
+private:
+    friend class CellularMuxChannel;
+
+    enum RxState {
+        RxFlag,
+        RxAddress,
+        RxControl,
+        RxLength,
+        RxLength2,
+        RxData,
+        RxFcs,
+        RxClosingFlag
+    };
+
+    // a request waiting for an answer, DLCI of -1 if none
+    struct Request {
+        int dlci;
+        bool answered;
+        bool accepted;
+    };
+
+    CellularMuxChannel *find_channel(uint8_t dlci);
+    nsapi_error_t request(uint8_t dlci, uint8_t control, int timeout);
+    void handle_frame();
+    void handle_control_message(const uint8_t *data, uint16_t length);
+    void send_frame(uint8_t dlci, uint8_t control, bool command, const uint8_t *data, uint16_t length);
+    void send_modem_status(uint8_t dlci, bool flow_stopped, bool command);
+    nsapi_error_t close_channel(CellularMuxChannel *channel);
+    ssize_t channel_write(CellularMuxChannel *channel, const uint8_t *data, size_t length);
+    ssize_t channel_read(CellularMuxChannel *channel, uint8_t *data, size_t length);
+    void wait(uint32_t flags, uint32_t timeout);
+    void sigio_event();
+    void rx_event();
+
+    FileHandle *_serial;
+    events::EventQueue &_queue;
+    uint16_t _frame_size;
+    bool _started;
+    volatile bool _rx_event_pending;
+    int _rx_event_id;
+
+    CellularMuxChannel *_channels[MBED_CONF_CELLULAR_MUX_CHANNEL_COUNT];
+    Request _request;
+
+    // frame being received
+    RxState _rx_state;
+    uint8_t _rx_address;
+    uint8_t _rx_control;
+    uint16_t _rx_length;
+    uint16_t _rx_pos;
+    uint8_t _rx_fcs;
+    uint8_t *_rx_data;
+
+    // encoded frame being sent
+    uint8_t *_tx_frame;
+
+    // protects the receive state and the channels
+    PlatformMutex _mutex;
+    // keeps frames written to the serial port whole
+    PlatformMutex _tx_mutex;
+    // one request at a time waits for an answer
+    PlatformMutex _request_mutex;
+    // wakes the threads waiting for an answer, for input or on a channel
+    rtos::EventFlags _flags;
+};
+
+} // namespace mbed
+
+#endif // CELLULAR_MUX_H_
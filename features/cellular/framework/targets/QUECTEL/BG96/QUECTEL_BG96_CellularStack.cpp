@@ -134,6 +134,16 @@ bool QUECTEL_BG96_CellularStack::is_protocol_supported(nsapi_protocol_t protocol
     return (protocol == NSAPI_UDP || protocol == NSAPI_TCP);
 }
 
+nsapi_size_t QUECTEL_BG96_CellularStack::get_socket_rx_buffer_size()
+{
+    return BG96_SOCKET_RX_BUFFER_SIZE;
+}
+
+nsapi_size_t QUECTEL_BG96_CellularStack::get_socket_tx_buffer_size()
+{
+    return BG96_SOCKET_TX_BUFFER_SIZE;
+}
+
 nsapi_error_t QUECTEL_BG96_CellularStack::socket_close_impl(int sock_id)
 {
     _at.set_at_timeout(BG96_CLOSE_SOCKET_TIMEOUT);
@@ -25,6 +25,8 @@ namespace mbed {
 #define BG96_SOCKET_MAX 12
 #define BG96_CREATE_SOCKET_TIMEOUT 150000 //150 seconds
 #define BG96_CLOSE_SOCKET_TIMEOUT 20000 // TCP socket max timeout is >10sec
+#define BG96_SOCKET_RX_BUFFER_SIZE 1500 // AT+QIRD reads at most 1500 bytes
+#define BG96_SOCKET_TX_BUFFER_SIZE 1460 // AT+QISEND sends at most 1460 bytes
 
 class QUECTEL_BG96_CellularStack : public AT_CellularStack {
 public:
@@ -46,6 +48,10 @@ protected: // AT_CellularStack
 
     virtual bool is_protocol_supported(nsapi_protocol_t protocol);
 
+    virtual nsapi_size_t get_socket_rx_buffer_size();
+
+    virtual nsapi_size_t get_socket_tx_buffer_size();
+
     virtual nsapi_error_t socket_close_impl(int sock_id);
 
     virtual nsapi_error_t create_socket_impl(CellularSocket *socket);
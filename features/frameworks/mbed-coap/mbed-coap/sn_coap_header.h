@@ -312,6 +312,45 @@ typedef struct sn_nsdl_addr_ {
  */
 extern sn_coap_hdr_s *sn_coap_parser(struct coap_s *handle, uint16_t packet_data_len, uint8_t *packet_data_ptr, coap_version_e *coap_version_ptr);
 
+/**
+ * \brief Alignment of the structures placed in a parser arena
+ */
+#define SN_COAP_PARSER_ARENA_ALIGN  sizeof(void *)
+
+/**
+ * \brief Size of an arena large enough to parse any packet of the given length
+ */
+#define SN_COAP_PARSER_ARENA_SIZE(packet_data_len) \
+    (sizeof(sn_coap_hdr_s) + sizeof(sn_coap_options_list_s) + (packet_data_len) + 2 * SN_COAP_PARSER_ARENA_ALIGN)
+
+/**
+ * \fn sn_coap_hdr_s *sn_coap_parser_arena(uint16_t packet_data_len, uint8_t *packet_data_ptr, coap_version_e *coap_version_ptr, uint8_t *arena_ptr, uint16_t arena_len)
+ *
+ * \brief Parses CoAP message from given Packet data without allocating memory
+ *
+ *        The message and its options are placed in the given arena, option values
+ *        and payload point to the Packet data when they can. The message stays valid
+ *        as long as both the arena and the Packet data do; it must not be released
+ *        with sn_coap_parser_release_allocated_coap_msg_mem() nor handed over to the
+ *        CoAP protocol, which keeps and frees messages.
+ *
+ * \param packet_data_len is length of given Packet data to be parsed to CoAP message
+ *
+ * \param *packet_data_ptr is source for Packet data to be parsed to CoAP message
+ *
+ * \param *coap_version_ptr is destination for parsed CoAP specification version
+ *
+ * \param *arena_ptr is memory where the parsed message is placed
+ *
+ * \param arena_len is size of the arena, SN_COAP_PARSER_ARENA_SIZE(packet_data_len) is always enough
+ *
+ * \return Return value is pointer to parsed CoAP message.\n
+ *         In following failure cases NULL is returned:\n
+ *          -Failure in given pointer (= NULL)\n
+ *          -Arena too small
+ */
+extern sn_coap_hdr_s *sn_coap_parser_arena(uint16_t packet_data_len, uint8_t *packet_data_ptr, coap_version_e *coap_version_ptr, uint8_t *arena_ptr, uint16_t arena_len);
+
 /**
  * \fn void sn_coap_parser_release_allocated_coap_msg_mem(struct coap_s *handle, sn_coap_hdr_s *freed_coap_msg_ptr)
  *
@@ -384,6 +423,28 @@ extern int16_t sn_coap_builder_2(uint8_t *dst_packet_data_ptr, sn_coap_hdr_s *sr
  */
 extern uint16_t sn_coap_builder_calc_needed_packet_data_size_2(sn_coap_hdr_s *src_coap_msg_ptr, uint16_t blockwise_payload_size);
 
+/**
+ * \fn int16_t sn_coap_builder_3(uint8_t *dst_packet_data_ptr, uint16_t dst_packet_data_len, sn_coap_hdr_s *src_coap_msg_ptr)
+ *
+ * \brief Builds an outgoing message buffer from a CoAP header structure in a single pass.
+ *
+ *        Unlike sn_coap_builder_2(), the size of the message is not calculated
+ *        beforehand; the message is validated while it is written and the build
+ *        fails if it does not fit in the destination. The payload is not cut to
+ *        the blockwise payload size.
+ *
+ * \param *dst_packet_data_ptr is pointer to allocated destination to built CoAP packet
+ *
+ * \param dst_packet_data_len is size of the destination
+ *
+ * \param *src_coap_msg_ptr is pointer to source structure for building Packet data
+ *
+ * \return Return value is byte count of built Packet data. In failure cases:\n
+ *          -1 = Failure in given CoAP header structure or destination too small\n
+ *          -2 = Failure in given pointer (= NULL)
+ */
+extern int16_t sn_coap_builder_3(uint8_t *dst_packet_data_ptr, uint16_t dst_packet_data_len, sn_coap_hdr_s *src_coap_msg_ptr);
+
 /**
  * \fn sn_coap_hdr_s *sn_coap_build_response(struct coap_s *handle, sn_coap_hdr_s *coap_packet_ptr, uint8_t msg_code)
  *
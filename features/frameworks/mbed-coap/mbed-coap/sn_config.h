@@ -176,6 +176,15 @@
  */
 #undef SN_COAP_MAX_INCOMING_BLOCK_MESSAGE_SIZE
 
+/**
+ * \def SN_COAP_LOOKUP_INDEX_SIZE
+ * \brief Number of hash buckets indexing the messages stored for duplicate detection,
+ * resending and blockwise reception. Must be a power of two, a larger value speeds up
+ * lookups when many messages are stored, each bucket costs two pointers of RAM per table.
+ * By default value is 8.
+ */
+#undef SN_COAP_LOOKUP_INDEX_SIZE                /* 8 */
+
 #ifdef MBED_CLIENT_USER_CONFIG_FILE
 #include MBED_CLIENT_USER_CONFIG_FILE
 #endif
@@ -140,6 +140,24 @@ struct sn_coap_hdr_;
 #define SN_COAP_MAX_INCOMING_BLOCK_MESSAGE_SIZE UINT16_MAX
 #endif
 
+/* * For message lookups * */
+
+/* Number of hash buckets indexing the stored duplication infos, resending messages and         */
+/* received blockwise payloads of a handle. Must be a power of two.                             */
+#ifdef YOTTA_CFG_COAP_LOOKUP_INDEX_SIZE
+#define SN_COAP_LOOKUP_INDEX_SIZE YOTTA_CFG_COAP_LOOKUP_INDEX_SIZE
+#elif defined MBED_CONF_MBED_CLIENT_SN_COAP_LOOKUP_INDEX_SIZE
+#define SN_COAP_LOOKUP_INDEX_SIZE MBED_CONF_MBED_CLIENT_SN_COAP_LOOKUP_INDEX_SIZE
+#endif
+
+#ifndef SN_COAP_LOOKUP_INDEX_SIZE
+#define SN_COAP_LOOKUP_INDEX_SIZE                   8
+#endif
+
+#if (SN_COAP_LOOKUP_INDEX_SIZE == 0) || (SN_COAP_LOOKUP_INDEX_SIZE & (SN_COAP_LOOKUP_INDEX_SIZE - 1))
+#error "SN_COAP_LOOKUP_INDEX_SIZE must be a power of two"
+#endif
+
 /* * For Option handling * */
 #define COAP_OPTION_MAX_AGE_DEFAULT                 60 /**< Default value of Max-Age if option not present */
 #define COAP_OPTION_URI_PORT_NONE                   (-1) /**< Internal value to represent no Uri-Port option */
@@ -158,10 +176,12 @@ typedef struct coap_send_msg_ {
     struct coap_s       *coap;              /* CoAP library handle */
     void                *param;             /* Extra parameter that will be passed to TX/RX callback functions */
 
-    ns_list_link_t      link;
+    ns_list_link_t      link;               /* Link in the list ordered by resending time */
+    ns_list_link_t      index_link;         /* Link in the bucket of the message ID */
 } coap_send_msg_s;
 
 typedef NS_LIST_HEAD(coap_send_msg_s, link) coap_send_msg_list_t;
+typedef NS_LIST_HEAD(coap_send_msg_s, index_link) coap_send_msg_index_t;
 
 /* Structure which is stored to Linked list for message duplication detection purposes */
 typedef struct coap_duplication_info_ {
@@ -172,10 +192,12 @@ typedef struct coap_duplication_info_ {
     struct coap_s       *coap;  /* CoAP library handle */
     sn_nsdl_addr_s      *address;
     void                *param;
-    ns_list_link_t      link;
+    ns_list_link_t      link;       /* Link in the list ordered by timestamp */
+    ns_list_link_t      index_link; /* Link in the bucket of the address, port and message ID */
 } coap_duplication_info_s;
 
 typedef NS_LIST_HEAD(coap_duplication_info_s, link) coap_duplication_info_list_t;
+typedef NS_LIST_HEAD(coap_duplication_info_s, index_link) coap_duplication_info_index_t;
 
 /* Structure which is stored to Linked list for blockwise messages sending purposes */
 typedef struct coap_blockwise_msg_ {
@@ -207,10 +229,12 @@ typedef struct coap_blockwise_payload_ {
     uint8_t             *payload_ptr;
     struct coap_s       *coap;  /* CoAP library handle */
 
-    ns_list_link_t     link;
+    ns_list_link_t     link;        /* Link in the list ordered by timestamp */
+    ns_list_link_t     index_link;  /* Link in the bucket of the token */
 } coap_blockwise_payload_s;
 
 typedef NS_LIST_HEAD(coap_blockwise_payload_s, link) coap_blockwise_payload_list_t;
+typedef NS_LIST_HEAD(coap_blockwise_payload_s, index_link) coap_blockwise_payload_index_t;
 
 struct coap_s {
     void *(*sn_coap_protocol_malloc)(uint16_t);
@@ -221,26 +245,30 @@ struct coap_s {
 
     #if ENABLE_RESENDINGS /* If Message resending is not used at all, this part of code will not be compiled */
         coap_send_msg_list_t linked_list_resent_msgs; /* Active resending messages are stored to this Linked list */
+        coap_send_msg_index_t index_resent_msgs[SN_COAP_LOOKUP_INDEX_SIZE]; /* Active resending messages by message ID */
         uint16_t count_resent_msgs;
+        uint32_t size_resent_msgs; /* Total length of the resending messages packets */
     #endif
 
     #if SN_COAP_DUPLICATION_MAX_MSGS_COUNT /* If Message duplication detection is not used at all, this part of code will not be compiled */
         coap_duplication_info_list_t  linked_list_duplication_msgs; /* Messages for duplicated messages detection is stored to this Linked list */
+        coap_duplication_info_index_t index_duplication_msgs[SN_COAP_LOOKUP_INDEX_SIZE]; /* Duplication infos by address, port and message ID */
         uint16_t                      count_duplication_msgs;
     #endif
 
     #if SN_COAP_BLOCKWISE_ENABLED || SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE /* If Message blockwise is not enabled, this part of code will not be compiled */
         coap_blockwise_msg_list_t     linked_list_blockwise_sent_msgs; /* Blockwise message to to be sent is stored to this Linked list */
         coap_blockwise_payload_list_t linked_list_blockwise_received_payloads; /* Blockwise payload to to be received is stored to this Linked list */
+        coap_blockwise_payload_index_t index_blockwise_received_payloads[SN_COAP_LOOKUP_INDEX_SIZE]; /* Blockwise payloads by token */
     #endif
 
     uint32_t system_time;    /* System time seconds */
     uint16_t sn_coap_block_data_size;
-    uint8_t sn_coap_resending_queue_msgs;
+    uint16_t sn_coap_resending_queue_msgs;
     uint32_t sn_coap_resending_queue_bytes;
     uint8_t sn_coap_resending_count;
     uint8_t sn_coap_resending_intervall;
-    uint8_t sn_coap_duplication_buffer_size;
+    uint16_t sn_coap_duplication_buffer_size;
     uint8_t sn_coap_internal_block2_resp_handling; /* If this is set then coap itself sends a next GET request automatically */
 };
 
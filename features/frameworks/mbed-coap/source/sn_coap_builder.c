@@ -38,15 +38,16 @@
 #define TRACE_GROUP "coap"
 /* * * * LOCAL FUNCTION PROTOTYPES * * * */
 static int8_t   sn_coap_builder_header_build(uint8_t **dst_packet_data_pptr, sn_coap_hdr_s *src_coap_msg_ptr);
-static int8_t   sn_coap_builder_options_build(uint8_t **dst_packet_data_pptr, sn_coap_hdr_s *src_coap_msg_ptr);
+static int8_t   sn_coap_builder_options_build(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, sn_coap_hdr_s *src_coap_msg_ptr);
+static int8_t   sn_coap_builder_options_check_values(sn_coap_hdr_s *src_coap_msg_ptr);
 static uint16_t sn_coap_builder_options_calc_option_size(uint16_t query_len, uint8_t *query_ptr, sn_coap_option_numbers_e option);
-static int16_t  sn_coap_builder_options_build_add_one_option(uint8_t **dst_packet_data_pptr, uint16_t option_len, uint8_t *option_ptr, sn_coap_option_numbers_e option_number, uint16_t *previous_option_number);
-static int16_t  sn_coap_builder_options_build_add_multiple_option(uint8_t **dst_packet_data_pptr, uint8_t **src_pptr, uint16_t *src_len_ptr, sn_coap_option_numbers_e option, uint16_t *previous_option_number);
-static uint8_t  sn_coap_builder_options_build_add_uint_option(uint8_t **dst_packet_data_pptr, uint32_t value, sn_coap_option_numbers_e option_number, uint16_t *previous_option_number);
+static int16_t  sn_coap_builder_options_build_add_one_option(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, uint16_t option_len, uint8_t *option_ptr, sn_coap_option_numbers_e option_number, uint16_t *previous_option_number);
+static int16_t  sn_coap_builder_options_build_add_multiple_option(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, uint8_t **src_pptr, uint16_t *src_len_ptr, sn_coap_option_numbers_e option, uint16_t *previous_option_number);
+static int16_t  sn_coap_builder_options_build_add_uint_option(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, uint32_t value, sn_coap_option_numbers_e option_number, uint16_t *previous_option_number);
 static uint8_t  sn_coap_builder_options_get_option_part_count(uint16_t query_len, uint8_t *query_ptr, sn_coap_option_numbers_e option);
 static uint16_t sn_coap_builder_options_get_option_part_length_from_whole_option_string(uint16_t query_len, uint8_t *query_ptr, uint8_t query_index, sn_coap_option_numbers_e option);
 static int16_t  sn_coap_builder_options_get_option_part_position(uint16_t query_len, uint8_t *query_ptr, uint8_t query_index, sn_coap_option_numbers_e option);
-static void     sn_coap_builder_payload_build(uint8_t **dst_packet_data_pptr, sn_coap_hdr_s *src_coap_msg_ptr);
+static int8_t   sn_coap_builder_payload_build(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, sn_coap_hdr_s *src_coap_msg_ptr);
 static uint8_t  sn_coap_builder_options_calculate_jump_need(sn_coap_hdr_s *src_coap_msg_ptr/*, uint8_t block_option*/);
 
 sn_coap_hdr_s *sn_coap_build_response(struct coap_s *handle, sn_coap_hdr_s *coap_packet_ptr, uint8_t msg_code)
@@ -137,16 +138,53 @@ int16_t sn_coap_builder_2(uint8_t *dst_packet_data_ptr, sn_coap_hdr_s *src_coap_
         /* * * * * * * * * * * * * * * * * * */
         /* * * * Options part building * * * */
         /* * * * * * * * * * * * * * * * * * */
-        sn_coap_builder_options_build(&dst_packet_data_ptr, src_coap_msg_ptr);
+        sn_coap_builder_options_build(&dst_packet_data_ptr, NULL, src_coap_msg_ptr);
 
         /* * * * * * * * * * * * * * * * * * */
         /* * * * Payload part building * * * */
         /* * * * * * * * * * * * * * * * * * */
-        sn_coap_builder_payload_build(&dst_packet_data_ptr, src_coap_msg_ptr);
+        sn_coap_builder_payload_build(&dst_packet_data_ptr, NULL, src_coap_msg_ptr);
     }
     /* * * * Return built Packet data length * * * */
     return (dst_packet_data_ptr - base_packet_data_ptr);
 }
+
+int16_t sn_coap_builder_3(uint8_t *dst_packet_data_ptr, uint16_t dst_packet_data_len, sn_coap_hdr_s *src_coap_msg_ptr)
+{
+    uint8_t *base_packet_data_ptr = dst_packet_data_ptr;
+    uint8_t *dst_end_ptr = dst_packet_data_ptr + dst_packet_data_len;
+
+    /* * * * Check given pointers  * * * */
+    if (dst_packet_data_ptr == NULL || src_coap_msg_ptr == NULL) {
+        return -2;
+    }
+
+    if (dst_packet_data_len < COAP_HEADER_LENGTH) {
+        tr_error("sn_coap_builder_3 - no room for header!");
+        return -1;
+    }
+
+    /* Header bits are added to the first byte */
+    *dst_packet_data_ptr = 0;
+
+    if (sn_coap_builder_header_build(&dst_packet_data_ptr, src_coap_msg_ptr) != 0) {
+        tr_error("sn_coap_builder_3 - header building failed!");
+        return -1;
+    }
+
+    /* If else than Reset message because Reset message must be empty */
+    if (src_coap_msg_ptr->msg_type != COAP_MSG_TYPE_RESET) {
+        if (sn_coap_builder_options_check_values(src_coap_msg_ptr) != 0 ||
+            sn_coap_builder_options_build(&dst_packet_data_ptr, dst_end_ptr, src_coap_msg_ptr) != 0 ||
+            sn_coap_builder_payload_build(&dst_packet_data_ptr, dst_end_ptr, src_coap_msg_ptr) != 0) {
+            tr_error("sn_coap_builder_3 - invalid message or no room left!");
+            return -1;
+        }
+    }
+
+    /* * * * Return built Packet data length * * * */
+    return (dst_packet_data_ptr - base_packet_data_ptr);
+}
 uint16_t sn_coap_builder_calc_needed_packet_data_size(sn_coap_hdr_s *src_coap_msg_ptr)
 {
     return sn_coap_builder_calc_needed_packet_data_size_2(src_coap_msg_ptr, SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE);
@@ -199,7 +237,7 @@ uint16_t sn_coap_builder_calc_needed_packet_data_size_2(sn_coap_hdr_s *src_coap_
                 return 0;
             }
 
-            returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, src_coap_msg_ptr->content_format, COAP_OPTION_CONTENT_FORMAT, &tempInt);
+            returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, NULL, src_coap_msg_ptr->content_format, COAP_OPTION_CONTENT_FORMAT, &tempInt);
         }
         /* If options list pointer exists */
         if (src_coap_msg_ptr->options_list_ptr != NULL) {
@@ -210,11 +248,11 @@ uint16_t sn_coap_builder_calc_needed_packet_data_size_2(sn_coap_hdr_s *src_coap_
                     return 0;
                 }
 
-                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, src_coap_msg_ptr->options_list_ptr->accept, COAP_OPTION_ACCEPT, &tempInt);
+                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, NULL, src_coap_msg_ptr->options_list_ptr->accept, COAP_OPTION_ACCEPT, &tempInt);
             }
             /* MAX AGE - An integer option, omitted for default. Up to 4 bytes */
             if (src_coap_msg_ptr->options_list_ptr->max_age != COAP_OPTION_MAX_AGE_DEFAULT) {
-                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, src_coap_msg_ptr->options_list_ptr->max_age, COAP_OPTION_MAX_AGE, &tempInt);
+                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, NULL, src_coap_msg_ptr->options_list_ptr->max_age, COAP_OPTION_MAX_AGE, &tempInt);
             }
             /* PROXY URI - Length of this option is  1-1034 bytes */
             if (src_coap_msg_ptr->options_list_ptr->proxy_uri_ptr != NULL) {
@@ -283,7 +321,7 @@ uint16_t sn_coap_builder_calc_needed_packet_data_size_2(sn_coap_hdr_s *src_coap_
                     tr_error("sn_coap_builder_calc_needed_packet_data_size_2 - uri port too large!");
                     return 0;
                 }
-                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, src_coap_msg_ptr->options_list_ptr->uri_port, COAP_OPTION_URI_PORT, &tempInt);
+                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, NULL, src_coap_msg_ptr->options_list_ptr->uri_port, COAP_OPTION_URI_PORT, &tempInt);
             }
             /* lOCATION QUERY - Repeatable option. Length of this option is 0-255 bytes */
             if (src_coap_msg_ptr->options_list_ptr->location_query_ptr != NULL) {
@@ -301,7 +339,7 @@ uint16_t sn_coap_builder_calc_needed_packet_data_size_2(sn_coap_hdr_s *src_coap_
                 if ((uint32_t) src_coap_msg_ptr->options_list_ptr->observe > 0xffffff) {
                     return 0;
                 }
-                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, src_coap_msg_ptr->options_list_ptr->observe, COAP_OPTION_OBSERVE, &tempInt);
+                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, NULL, src_coap_msg_ptr->options_list_ptr->observe, COAP_OPTION_OBSERVE, &tempInt);
             }
             /* URI QUERY - Repeatable option. Length of this option is 1-255 */
             if (src_coap_msg_ptr->options_list_ptr->uri_query_ptr != NULL) {
@@ -321,11 +359,11 @@ uint16_t sn_coap_builder_calc_needed_packet_data_size_2(sn_coap_hdr_s *src_coap_
                     tr_error("sn_coap_builder_calc_needed_packet_data_size_2 - block1 too large!");
                     return 0;
                 }
-                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, src_coap_msg_ptr->options_list_ptr->block1, COAP_OPTION_BLOCK1, &tempInt);
+                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, NULL, src_coap_msg_ptr->options_list_ptr->block1, COAP_OPTION_BLOCK1, &tempInt);
             }
             /* SIZE1 - Length of this option is 0-4 bytes */
             if (src_coap_msg_ptr->options_list_ptr->use_size1) {
-                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, src_coap_msg_ptr->options_list_ptr->size1, COAP_OPTION_SIZE1, &tempInt);
+                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, NULL, src_coap_msg_ptr->options_list_ptr->size1, COAP_OPTION_SIZE1, &tempInt);
             }
             /* BLOCK 2 - An integer option, up to 3 bytes */
             if (src_coap_msg_ptr->options_list_ptr->block2 != COAP_OPTION_BLOCK_NONE) {
@@ -333,11 +371,11 @@ uint16_t sn_coap_builder_calc_needed_packet_data_size_2(sn_coap_hdr_s *src_coap_
                     tr_error("sn_coap_builder_calc_needed_packet_data_size_2 - block2 too large!");
                     return 0;
                 }
-                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, src_coap_msg_ptr->options_list_ptr->block2, COAP_OPTION_BLOCK2, &tempInt);
+                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, NULL, src_coap_msg_ptr->options_list_ptr->block2, COAP_OPTION_BLOCK2, &tempInt);
             }
             /* SIZE2 - Length of this option is 0-4 bytes */
             if (src_coap_msg_ptr->options_list_ptr->use_size2) {
-                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, src_coap_msg_ptr->options_list_ptr->size2, COAP_OPTION_SIZE2, &tempInt);
+                returned_byte_count += sn_coap_builder_options_build_add_uint_option(NULL, NULL, src_coap_msg_ptr->options_list_ptr->size2, COAP_OPTION_SIZE2, &tempInt);
             }
         }
 #if SN_COAP_BLOCKWISE_ENABLED || SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE
@@ -532,17 +570,66 @@ static int8_t sn_coap_builder_header_build(uint8_t **dst_packet_data_pptr, sn_co
 }
 
 /**
- * \fn static int8_t sn_coap_builder_options_build(uint8_t **dst_packet_data_pptr, sn_coap_hdr_s *src_coap_msg_ptr)
+ * \fn static int8_t sn_coap_builder_options_check_values(sn_coap_hdr_s *src_coap_msg_ptr)
+ *
+ * \brief Checks the options which are not checked while they are built
+ *
+ * \param *src_coap_msg_ptr is source for building Packet data
+ *
+ * \return Return value is 0 in ok case and -1 in failure case
+ */
+static int8_t sn_coap_builder_options_check_values(sn_coap_hdr_s *src_coap_msg_ptr)
+{
+    sn_coap_options_list_s *options_list_ptr = src_coap_msg_ptr->options_list_ptr;
+
+    if (src_coap_msg_ptr->token_ptr != NULL &&
+            (src_coap_msg_ptr->token_len > 8 || src_coap_msg_ptr->token_len < 1)) {
+        return -1;
+    }
+
+    if (src_coap_msg_ptr->content_format != COAP_CT_NONE && (uint32_t) src_coap_msg_ptr->content_format > 0xffff) {
+        return -1;
+    }
+
+    if (options_list_ptr == NULL) {
+        return 0;
+    }
+
+    if ((options_list_ptr->accept != COAP_CT_NONE && (uint32_t) options_list_ptr->accept > 0xffff) ||
+            (options_list_ptr->uri_port != COAP_OPTION_URI_PORT_NONE && (uint32_t) options_list_ptr->uri_port > 0xffff) ||
+            (options_list_ptr->observe != COAP_OBSERVE_NONE && (uint32_t) options_list_ptr->observe > 0xffffff) ||
+            (options_list_ptr->block1 != COAP_OPTION_BLOCK_NONE && (uint32_t) options_list_ptr->block1 > 0xffffff) ||
+            (options_list_ptr->block2 != COAP_OPTION_BLOCK_NONE && (uint32_t) options_list_ptr->block2 > 0xffffff)) {
+        return -1;
+    }
+
+    if (options_list_ptr->proxy_uri_ptr != NULL &&
+            (options_list_ptr->proxy_uri_len < 1 || options_list_ptr->proxy_uri_len > 1034)) {
+        return -1;
+    }
+
+    if (options_list_ptr->uri_host_ptr != NULL &&
+            (options_list_ptr->uri_host_len < 1 || options_list_ptr->uri_host_len > 255)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * \fn static int8_t sn_coap_builder_options_build(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, sn_coap_hdr_s *src_coap_msg_ptr)
  *
  * \brief Builds Options part of Packet data
  *
  * \param **dst_packet_data_pptr is destination for built Packet data
  *
+ * \param *dst_end_ptr is end of the destination, NULL if its size has been calculated
+ *
  * \param *src_coap_msg_ptr is source for building Packet data
  *
- * \return Return value is 0 in every case
+ * \return Return value is 0 in ok case and -1 if an option is not valid or does not fit
  */
-static int8_t sn_coap_builder_options_build(uint8_t **dst_packet_data_pptr, sn_coap_hdr_s *src_coap_msg_ptr)
+static int8_t sn_coap_builder_options_build(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, sn_coap_hdr_s *src_coap_msg_ptr)
 {
     /* * * * Check if Options are used at all  * * * */
     if (src_coap_msg_ptr->uri_path_ptr == NULL && src_coap_msg_ptr->token_ptr == NULL &&
@@ -552,6 +639,9 @@ static int8_t sn_coap_builder_options_build(uint8_t **dst_packet_data_pptr, sn_c
     }
 
     /* * * * First add Token option  * * * */
+    if (dst_end_ptr && src_coap_msg_ptr->token_len > dst_end_ptr - *dst_packet_data_pptr) {
+        return -1;
+    }
     if (src_coap_msg_ptr->token_len && src_coap_msg_ptr->token_ptr) {
         memcpy(*dst_packet_data_pptr, src_coap_msg_ptr->token_ptr, src_coap_msg_ptr->token_len);
     }
@@ -567,89 +657,121 @@ static int8_t sn_coap_builder_options_build(uint8_t **dst_packet_data_pptr, sn_c
     /* Check if less used options are used at all */
     if (src_coap_msg_ptr->options_list_ptr != NULL) {
         /* * * * Build Uri-Host option * * * */
-        sn_coap_builder_options_build_add_one_option(dst_packet_data_pptr, src_coap_msg_ptr->options_list_ptr->uri_host_len,
-                     src_coap_msg_ptr->options_list_ptr->uri_host_ptr, COAP_OPTION_URI_HOST, &previous_option_number);
+        if (sn_coap_builder_options_build_add_one_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->options_list_ptr->uri_host_len,
+                         src_coap_msg_ptr->options_list_ptr->uri_host_ptr, COAP_OPTION_URI_HOST, &previous_option_number) < 0) {
+            return -1;
+        }
 
         /* * * * Build ETag option  * * * */
-        sn_coap_builder_options_build_add_multiple_option(dst_packet_data_pptr, &src_coap_msg_ptr->options_list_ptr->etag_ptr,
-                     (uint16_t *)&src_coap_msg_ptr->options_list_ptr->etag_len, COAP_OPTION_ETAG, &previous_option_number);
+        if (sn_coap_builder_options_build_add_multiple_option(dst_packet_data_pptr, dst_end_ptr, &src_coap_msg_ptr->options_list_ptr->etag_ptr,
+                         (uint16_t *)&src_coap_msg_ptr->options_list_ptr->etag_len, COAP_OPTION_ETAG, &previous_option_number) < 0) {
+            return -1;
+        }
 
         /* * * * Build Observe option  * * * * */
         if (src_coap_msg_ptr->options_list_ptr->observe != COAP_OBSERVE_NONE) {
-            sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, src_coap_msg_ptr->options_list_ptr->observe,
-                         COAP_OPTION_OBSERVE, &previous_option_number);
+            if (sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->options_list_ptr->observe,
+                             COAP_OPTION_OBSERVE, &previous_option_number) < 0) {
+                return -1;
+            }
         }
 
         /* * * * Build Uri-Port option * * * */
         if (src_coap_msg_ptr->options_list_ptr->uri_port != COAP_OPTION_URI_PORT_NONE) {
-            sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, src_coap_msg_ptr->options_list_ptr->uri_port,
-                         COAP_OPTION_URI_PORT, &previous_option_number);
+            if (sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->options_list_ptr->uri_port,
+                             COAP_OPTION_URI_PORT, &previous_option_number) < 0) {
+                return -1;
+            }
         }
 
         /* * * * Build Location-Path option  * * * */
-        sn_coap_builder_options_build_add_multiple_option(dst_packet_data_pptr, &src_coap_msg_ptr->options_list_ptr->location_path_ptr,
-                     &src_coap_msg_ptr->options_list_ptr->location_path_len, COAP_OPTION_LOCATION_PATH, &previous_option_number);
+        if (sn_coap_builder_options_build_add_multiple_option(dst_packet_data_pptr, dst_end_ptr, &src_coap_msg_ptr->options_list_ptr->location_path_ptr,
+                         &src_coap_msg_ptr->options_list_ptr->location_path_len, COAP_OPTION_LOCATION_PATH, &previous_option_number) < 0) {
+            return -1;
+        }
     }
     /* * * * Build Uri-Path option * * * */
-    sn_coap_builder_options_build_add_multiple_option(dst_packet_data_pptr, &src_coap_msg_ptr->uri_path_ptr,
-             &src_coap_msg_ptr->uri_path_len, COAP_OPTION_URI_PATH, &previous_option_number);
+    if (sn_coap_builder_options_build_add_multiple_option(dst_packet_data_pptr, dst_end_ptr, &src_coap_msg_ptr->uri_path_ptr,
+                 &src_coap_msg_ptr->uri_path_len, COAP_OPTION_URI_PATH, &previous_option_number) < 0) {
+        return -1;
+    }
 
     /* * * * Build Content-Type option * * * */
     if (src_coap_msg_ptr->content_format != COAP_CT_NONE) {
-        sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, src_coap_msg_ptr->content_format,
-                     COAP_OPTION_CONTENT_FORMAT, &previous_option_number);
+        if (sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->content_format,
+                         COAP_OPTION_CONTENT_FORMAT, &previous_option_number) < 0) {
+            return -1;
+        }
     }
 
     if (src_coap_msg_ptr->options_list_ptr != NULL) {
         /* * * * Build Max-Age option  * * * */
         if (src_coap_msg_ptr->options_list_ptr->max_age != COAP_OPTION_MAX_AGE_DEFAULT) {
-            sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, src_coap_msg_ptr->options_list_ptr->max_age,
-                         COAP_OPTION_MAX_AGE, &previous_option_number);
+            if (sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->options_list_ptr->max_age,
+                             COAP_OPTION_MAX_AGE, &previous_option_number) < 0) {
+                return -1;
+            }
         }
 
         /* * * * Build Uri-Query option  * * * * */
-        sn_coap_builder_options_build_add_multiple_option(dst_packet_data_pptr, &src_coap_msg_ptr->options_list_ptr->uri_query_ptr,
-                     &src_coap_msg_ptr->options_list_ptr->uri_query_len, COAP_OPTION_URI_QUERY, &previous_option_number);
+        if (sn_coap_builder_options_build_add_multiple_option(dst_packet_data_pptr, dst_end_ptr, &src_coap_msg_ptr->options_list_ptr->uri_query_ptr,
+                         &src_coap_msg_ptr->options_list_ptr->uri_query_len, COAP_OPTION_URI_QUERY, &previous_option_number) < 0) {
+            return -1;
+        }
 
         /* * * * Build Accept option  * * * * */
         if (src_coap_msg_ptr->options_list_ptr->accept != COAP_CT_NONE) {
-            sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, src_coap_msg_ptr->options_list_ptr->accept,
-                         COAP_OPTION_ACCEPT, &previous_option_number);
+            if (sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->options_list_ptr->accept,
+                             COAP_OPTION_ACCEPT, &previous_option_number) < 0) {
+                return -1;
+            }
         }
     }
 
     if (src_coap_msg_ptr->options_list_ptr != NULL) {
         /* * * * Build Location-Query option * * * */
-        sn_coap_builder_options_build_add_multiple_option(dst_packet_data_pptr, &src_coap_msg_ptr->options_list_ptr->location_query_ptr,
-                     &src_coap_msg_ptr->options_list_ptr->location_query_len, COAP_OPTION_LOCATION_QUERY, &previous_option_number);
+        if (sn_coap_builder_options_build_add_multiple_option(dst_packet_data_pptr, dst_end_ptr, &src_coap_msg_ptr->options_list_ptr->location_query_ptr,
+                         &src_coap_msg_ptr->options_list_ptr->location_query_len, COAP_OPTION_LOCATION_QUERY, &previous_option_number) < 0) {
+            return -1;
+        }
 
         /* * * * Build Block2 option * * * * */
         if (src_coap_msg_ptr->options_list_ptr->block2 != COAP_OPTION_BLOCK_NONE) {
-            sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, src_coap_msg_ptr->options_list_ptr->block2,
-                         COAP_OPTION_BLOCK2, &previous_option_number);
+            if (sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->options_list_ptr->block2,
+                             COAP_OPTION_BLOCK2, &previous_option_number) < 0) {
+                return -1;
+            }
         }
 
         /* * * * Build Block1 option * * * * */
         if (src_coap_msg_ptr->options_list_ptr->block1 != COAP_OPTION_BLOCK_NONE) {
-            sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, src_coap_msg_ptr->options_list_ptr->block1,
-                         COAP_OPTION_BLOCK1, &previous_option_number);
+            if (sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->options_list_ptr->block1,
+                             COAP_OPTION_BLOCK1, &previous_option_number) < 0) {
+                return -1;
+            }
         }
 
         /* * * * Build Size2 option * * * */
         if (src_coap_msg_ptr->options_list_ptr->use_size2) {
-            sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, src_coap_msg_ptr->options_list_ptr->size2,
-                         COAP_OPTION_SIZE2, &previous_option_number);
+            if (sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->options_list_ptr->size2,
+                             COAP_OPTION_SIZE2, &previous_option_number) < 0) {
+                return -1;
+            }
         }
 
         /* * * * Build Proxy-Uri option * * * */
-        sn_coap_builder_options_build_add_one_option(dst_packet_data_pptr, src_coap_msg_ptr->options_list_ptr->proxy_uri_len,
-                     src_coap_msg_ptr->options_list_ptr->proxy_uri_ptr, COAP_OPTION_PROXY_URI, &previous_option_number);
+        if (sn_coap_builder_options_build_add_one_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->options_list_ptr->proxy_uri_len,
+                         src_coap_msg_ptr->options_list_ptr->proxy_uri_ptr, COAP_OPTION_PROXY_URI, &previous_option_number) < 0) {
+            return -1;
+        }
 
 
         /* * * * Build Size1 option * * * */
         if (src_coap_msg_ptr->options_list_ptr->use_size1) {
-            sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, src_coap_msg_ptr->options_list_ptr->size1,
-                         COAP_OPTION_SIZE1, &previous_option_number);
+            if (sn_coap_builder_options_build_add_uint_option(dst_packet_data_pptr, dst_end_ptr, src_coap_msg_ptr->options_list_ptr->size1,
+                             COAP_OPTION_SIZE1, &previous_option_number) < 0) {
+                return -1;
+            }
         }
     }
 
@@ -664,15 +786,17 @@ static int8_t sn_coap_builder_options_build(uint8_t **dst_packet_data_pptr, sn_c
  *
  * \param **dst_packet_data_pptr is destination for built Packet data
  *
+ * \param *dst_end_ptr is end of the destination, NULL if its size has been calculated
+ *
  * \param option_value_len is Option value length to be added
  *
  * \param *option_value_ptr is pointer to Option value data to be added
  *
  * \param option_number is Option number to be added
  *
- * \return Return value is 0 if option was not added, 1 if added
+ * \return Return value is 0 if option was not added, 1 if added, -1 if it does not fit
  */
-static int16_t sn_coap_builder_options_build_add_one_option(uint8_t **dst_packet_data_pptr, uint16_t option_len,
+static int16_t sn_coap_builder_options_build_add_one_option(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, uint16_t option_len,
         uint8_t *option_ptr, sn_coap_option_numbers_e option_number, uint16_t *previous_option_number)
 {
     /* Check if there is option at all */
@@ -681,6 +805,16 @@ static int16_t sn_coap_builder_options_build_add_one_option(uint8_t **dst_packet
 
         option_delta = (option_number - *previous_option_number);
 
+        /* Check that option header and value fit */
+        if (dst_end_ptr) {
+            uint16_t option_size = 1 + option_len;
+            option_size += (option_delta > 12) + (option_delta >= 269);
+            option_size += (option_len > 12) + (option_len >= 269);
+            if (option_size > dst_end_ptr - *dst_packet_data_pptr) {
+                return -1;
+            }
+        }
+
         /* * * Build option header * * */
 
         /* First option length without extended part */
@@ -752,13 +886,15 @@ static int16_t sn_coap_builder_options_build_add_one_option(uint8_t **dst_packet
  * \param **dst_packet_data_pptr is destination for built Packet data; NULL
  *        to compute size only.
  *
+ * \param *dst_end_ptr is end of the destination, NULL if its size has been calculated
+ *
  * \param option_value is Option value to be added
  *
  * \param option_number is Option number to be added
  *
  * \return Return value is total option size, or -1 in write failure case
  */
-static uint8_t sn_coap_builder_options_build_add_uint_option(uint8_t **dst_packet_data_pptr, uint32_t option_value, sn_coap_option_numbers_e option_number, uint16_t *previous_option_number)
+static int16_t sn_coap_builder_options_build_add_uint_option(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, uint32_t option_value, sn_coap_option_numbers_e option_number, uint16_t *previous_option_number)
 {
     uint8_t payload[4];
     uint8_t len = 0;
@@ -772,7 +908,7 @@ static uint8_t sn_coap_builder_options_build_add_uint_option(uint8_t **dst_packe
 
     /* If output pointer isn't NULL, write it out */
     if (dst_packet_data_pptr) {
-        int16_t ret = sn_coap_builder_options_build_add_one_option(dst_packet_data_pptr, len, payload, option_number, previous_option_number);
+        int16_t ret = sn_coap_builder_options_build_add_one_option(dst_packet_data_pptr, dst_end_ptr, len, payload, option_number, previous_option_number);
         /* Allow for failure returns when writing (why even permit failure returns?) */
         if (ret < 0) {
             return ret;
@@ -790,15 +926,17 @@ static uint8_t sn_coap_builder_options_build_add_uint_option(uint8_t **dst_packe
  *
  * \param **dst_packet_data_pptr is destination for built Packet data
  *
+ * \param *dst_end_ptr is end of the destination, NULL if its size has been calculated
+ *
  * \param uint8_t **src_pptr
  *
  *  \param uint16_t *src_len_ptr
  *
  *  \paramsn_coap_option_numbers_e option option to be added
  *
- * \return Return value is 0 always
+ * \return Return value is 0 in ok case and -1 if an option is not valid or does not fit
  */
-static int16_t sn_coap_builder_options_build_add_multiple_option(uint8_t **dst_packet_data_pptr, uint8_t **src_pptr, uint16_t *src_len_ptr, sn_coap_option_numbers_e option, uint16_t *previous_option_number)
+static int16_t sn_coap_builder_options_build_add_multiple_option(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, uint8_t **src_pptr, uint16_t *src_len_ptr, sn_coap_option_numbers_e option, uint16_t *previous_option_number)
 {
     /* Check if there is option at all */
     if (*src_pptr != NULL) {
@@ -819,8 +957,19 @@ static int16_t sn_coap_builder_options_build_add_multiple_option(uint8_t **dst_p
             /* Get position of query part */
             query_part_offset = sn_coap_builder_options_get_option_part_position(query_len, query_ptr, i, option);
 
+            /* Check option length, the size of the message has not been calculated */
+            if (dst_end_ptr) {
+                uint16_t min_len = (option == COAP_OPTION_ETAG || option == COAP_OPTION_URI_QUERY) ? 1 : 0;
+                uint16_t max_len = (option == COAP_OPTION_ETAG) ? 8 : 255;
+                if (one_query_part_len < min_len || one_query_part_len > max_len) {
+                    return -1;
+                }
+            }
+
             /* Add Uri-query's one part to Options */
-            sn_coap_builder_options_build_add_one_option(dst_packet_data_pptr, one_query_part_len, *src_pptr + query_part_offset, option, previous_option_number);
+            if (sn_coap_builder_options_build_add_one_option(dst_packet_data_pptr, dst_end_ptr, one_query_part_len, *src_pptr + query_part_offset, option, previous_option_number) < 0) {
+                return -1;
+            }
         }
     }
     /* Success */
@@ -1065,18 +1214,26 @@ static int16_t sn_coap_builder_options_get_option_part_position(uint16_t query_l
 
 
 /**
- * \fn static void sn_coap_builder_payload_build(uint8_t **dst_packet_data_pptr, sn_coap_hdr_s *src_coap_msg_ptr)
+ * \fn static int8_t sn_coap_builder_payload_build(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, sn_coap_hdr_s *src_coap_msg_ptr)
  *
  * \brief Builds Options part of Packet data
  *
  * \param **dst_packet_data_pptr is destination for built Packet data
  *
+ * \param *dst_end_ptr is end of the destination, NULL if its size has been calculated
+ *
  * \param *src_coap_msg_ptr is source for building Packet data
+ *
+ * \return Return value is 0 in ok case and -1 if the payload does not fit
  */
-static void sn_coap_builder_payload_build(uint8_t **dst_packet_data_pptr, sn_coap_hdr_s *src_coap_msg_ptr)
+static int8_t sn_coap_builder_payload_build(uint8_t **dst_packet_data_pptr, uint8_t *dst_end_ptr, sn_coap_hdr_s *src_coap_msg_ptr)
 {
     /* Check if Payload is used at all */
     if (src_coap_msg_ptr->payload_len && src_coap_msg_ptr->payload_ptr != NULL) {
+        if (dst_end_ptr && src_coap_msg_ptr->payload_len >= dst_end_ptr - *dst_packet_data_pptr) {
+            return -1;
+        }
+
         /* Write Payload marker */
 
         **dst_packet_data_pptr = 0xff;
@@ -1088,4 +1245,6 @@ static void sn_coap_builder_payload_build(uint8_t **dst_packet_data_pptr, sn_coa
         /* Increase destination Packet data pointer */
         (*dst_packet_data_pptr) += src_coap_msg_ptr->payload_len;
     }
+
+    return 0;
 }
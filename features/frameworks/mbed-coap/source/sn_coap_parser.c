@@ -38,13 +38,29 @@
 #include "mbed-trace/mbed_trace.h"
 
 #define TRACE_GROUP "coap"
+
+/**
+ * \brief Source of the memory of a parsed message: the heap of the CoAP
+ *        library handle, or an arena given by the caller.
+ */
+typedef struct sn_coap_parser_alloc_ {
+    struct coap_s  *handle;         /**< Used when arena_ptr is NULL */
+    uint8_t        *arena_ptr;
+    uint16_t        arena_len;
+    uint16_t        arena_used;
+} sn_coap_parser_alloc_s;
+
 /* * * * * * * * * * * * * * * * * * * * */
 /* * * * LOCAL FUNCTION PROTOTYPES * * * */
 /* * * * * * * * * * * * * * * * * * * * */
 
+static void    *sn_coap_parser_malloc(sn_coap_parser_alloc_s *alloc, uint16_t size, uint8_t align);
+static sn_coap_options_list_s *sn_coap_parser_options_alloc(sn_coap_parser_alloc_s *alloc, sn_coap_hdr_s *coap_msg_ptr);
+static sn_coap_hdr_s *sn_coap_parser_parse(sn_coap_parser_alloc_s *alloc, uint16_t packet_data_len, uint8_t *packet_data_ptr, coap_version_e *coap_version_ptr);
 static void     sn_coap_parser_header_parse(uint8_t **packet_data_pptr, sn_coap_hdr_s *dst_coap_msg_ptr, coap_version_e *coap_version_ptr);
-static int8_t   sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **packet_data_pptr, sn_coap_hdr_s *dst_coap_msg_ptr, uint8_t *packet_data_start_ptr, uint16_t packet_len);
-static int8_t   sn_coap_parser_options_parse_multiple_options(struct coap_s *handle, uint8_t **packet_data_pptr, uint16_t packet_left_len,  uint8_t **dst_pptr, uint16_t *dst_len_ptr, sn_coap_option_numbers_e option, uint16_t option_number_len);
+static int8_t   sn_coap_parser_options_parse(sn_coap_parser_alloc_s *alloc, uint8_t **packet_data_pptr, sn_coap_hdr_s *dst_coap_msg_ptr, uint8_t *packet_data_start_ptr, uint16_t packet_len);
+static int8_t   sn_coap_parser_options_parse_bytes(sn_coap_parser_alloc_s *alloc, uint8_t **packet_data_pptr, uint8_t **dst_pptr, uint16_t option_len);
+static int8_t   sn_coap_parser_options_parse_multiple_options(sn_coap_parser_alloc_s *alloc, uint8_t **packet_data_pptr, uint16_t packet_left_len,  uint8_t **dst_pptr, uint16_t *dst_len_ptr, sn_coap_option_numbers_e option, uint16_t option_number_len);
 static int16_t  sn_coap_parser_options_count_needed_memory_multiple_option(uint8_t *packet_data_ptr, uint16_t packet_left_len, sn_coap_option_numbers_e option, uint16_t option_number_len);
 static int8_t   sn_coap_parser_payload_parse(uint16_t packet_data_len, uint8_t *packet_data_start_ptr, uint8_t **packet_data_pptr, sn_coap_hdr_s *dst_coap_msg_ptr);
 
@@ -81,18 +97,54 @@ sn_coap_hdr_s *sn_coap_parser_alloc_message(struct coap_s *handle)
 
 sn_coap_options_list_s *sn_coap_parser_alloc_options(struct coap_s *handle, sn_coap_hdr_s *coap_msg_ptr)
 {
+    sn_coap_parser_alloc_s alloc = { handle, NULL, 0, 0 };
+
     /* * * * Check given pointers * * * */
     if (handle == NULL || coap_msg_ptr == NULL) {
         return NULL;
     }
 
+    return sn_coap_parser_options_alloc(&alloc, coap_msg_ptr);
+}
+
+/**
+ * \brief Allocates memory for a parsed message from the heap or the arena
+ *
+ * \param align is alignment of the memory in the arena, 1 for strings
+ *
+ * \return Return value is pointer to the memory, NULL if there is none left
+ */
+static void *sn_coap_parser_malloc(sn_coap_parser_alloc_s *alloc, uint16_t size, uint8_t align)
+{
+    uintptr_t start;
+    uintptr_t end;
+
+    if (alloc->arena_ptr == NULL) {
+        return alloc->handle->sn_coap_protocol_malloc(size);
+    }
+
+    start = (uintptr_t)(alloc->arena_ptr + alloc->arena_used);
+    start = (start + align - 1) & ~(uintptr_t)(align - 1);
+    end = start + size;
+
+    if (end > (uintptr_t)(alloc->arena_ptr + alloc->arena_len)) {
+        tr_error("sn_coap_parser_malloc - arena full!");
+        return NULL;
+    }
+
+    alloc->arena_used = end - (uintptr_t)alloc->arena_ptr;
+    return (void *)start;
+}
+
+static sn_coap_options_list_s *sn_coap_parser_options_alloc(sn_coap_parser_alloc_s *alloc, sn_coap_hdr_s *coap_msg_ptr)
+{
     /* * * * If the message already has options, return them * * * */
     if (coap_msg_ptr->options_list_ptr) {
         return coap_msg_ptr->options_list_ptr;
     }
 
     /* * * * Allocate memory for options and initialize allocated memory with with default values  * * * */
-    coap_msg_ptr->options_list_ptr = handle->sn_coap_protocol_malloc(sizeof(sn_coap_options_list_s));
+    coap_msg_ptr->options_list_ptr = sn_coap_parser_malloc(alloc, sizeof(sn_coap_options_list_s), SN_COAP_PARSER_ARENA_ALIGN);
 
     if (coap_msg_ptr->options_list_ptr == NULL) {
         tr_error("sn_coap_parser_alloc_options - failed to allocate options list!");
@@ -114,16 +166,35 @@ sn_coap_options_list_s *sn_coap_parser_alloc_options(struct coap_s *handle, sn_c
 
 sn_coap_hdr_s *sn_coap_parser(struct coap_s *handle, uint16_t packet_data_len, uint8_t *packet_data_ptr, coap_version_e *coap_version_ptr)
 {
-    uint8_t       *data_temp_ptr                    = packet_data_ptr;
-    sn_coap_hdr_s *parsed_and_returned_coap_msg_ptr = NULL;
+    sn_coap_parser_alloc_s alloc = { handle, NULL, 0, 0 };
 
     /* * * * Check given pointer * * * */
     if (packet_data_ptr == NULL || packet_data_len < 4 || handle == NULL) {
         return NULL;
     }
 
+    return sn_coap_parser_parse(&alloc, packet_data_len, packet_data_ptr, coap_version_ptr);
+}
+
+sn_coap_hdr_s *sn_coap_parser_arena(uint16_t packet_data_len, uint8_t *packet_data_ptr, coap_version_e *coap_version_ptr, uint8_t *arena_ptr, uint16_t arena_len)
+{
+    sn_coap_parser_alloc_s alloc = { NULL, arena_ptr, arena_len, 0 };
+
+    /* * * * Check given pointer * * * */
+    if (packet_data_ptr == NULL || packet_data_len < 4 || arena_ptr == NULL) {
+        return NULL;
+    }
+
+    return sn_coap_parser_parse(&alloc, packet_data_len, packet_data_ptr, coap_version_ptr);
+}
+
+static sn_coap_hdr_s *sn_coap_parser_parse(sn_coap_parser_alloc_s *alloc, uint16_t packet_data_len, uint8_t *packet_data_ptr, coap_version_e *coap_version_ptr)
+{
+    uint8_t       *data_temp_ptr                    = packet_data_ptr;
+    sn_coap_hdr_s *parsed_and_returned_coap_msg_ptr = NULL;
+
     /* * * * Allocate and initialize CoAP message  * * * */
-    parsed_and_returned_coap_msg_ptr = sn_coap_parser_alloc_message(handle);
+    parsed_and_returned_coap_msg_ptr = sn_coap_parser_init_message(sn_coap_parser_malloc(alloc, sizeof(sn_coap_hdr_s), SN_COAP_PARSER_ARENA_ALIGN));
 
     if (parsed_and_returned_coap_msg_ptr == NULL) {
         tr_error("sn_coap_parser - failed to allocate message!");
@@ -134,7 +205,7 @@ sn_coap_hdr_s *sn_coap_parser(struct coap_s *handle, uint16_t packet_data_len, u
     sn_coap_parser_header_parse(&data_temp_ptr, parsed_and_returned_coap_msg_ptr, coap_version_ptr);
 
     /* * * * Options parsing, move pointer over the options... * * * */
-    if (sn_coap_parser_options_parse(handle, &data_temp_ptr, parsed_and_returned_coap_msg_ptr, packet_data_ptr, packet_data_len) != 0) {
+    if (sn_coap_parser_options_parse(alloc, &data_temp_ptr, parsed_and_returned_coap_msg_ptr, packet_data_ptr, packet_data_len) != 0) {
         parsed_and_returned_coap_msg_ptr->coap_status = COAP_STATUS_PARSER_ERROR_IN_HEADER;
         return parsed_and_returned_coap_msg_ptr;
     }
@@ -253,7 +324,7 @@ static uint32_t sn_coap_parser_options_parse_uint(uint8_t **packet_data_pptr, ui
  *
  * \return Return value is 0 in ok case and -1 in failure case
  */
-static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **packet_data_pptr, sn_coap_hdr_s *dst_coap_msg_ptr, uint8_t *packet_data_start_ptr, uint16_t packet_len)
+static int8_t sn_coap_parser_options_parse(sn_coap_parser_alloc_s *alloc, uint8_t **packet_data_pptr, sn_coap_hdr_s *dst_coap_msg_ptr, uint8_t *packet_data_start_ptr, uint16_t packet_len)
 {
     uint8_t previous_option_number = 0;
     uint8_t i                      = 0;
@@ -269,15 +340,10 @@ static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **pack
             return -1;
         }
 
-        dst_coap_msg_ptr->token_ptr = handle->sn_coap_protocol_malloc(dst_coap_msg_ptr->token_len);
-
-        if (dst_coap_msg_ptr->token_ptr == NULL) {
+        if (sn_coap_parser_options_parse_bytes(alloc, packet_data_pptr, &dst_coap_msg_ptr->token_ptr, dst_coap_msg_ptr->token_len) != 0) {
             tr_error("sn_coap_parser_options_parse - failed to allocate token!");
             return -1;
         }
-
-        memcpy(dst_coap_msg_ptr->token_ptr, *packet_data_pptr, dst_coap_msg_ptr->token_len);
-        (*packet_data_pptr) += dst_coap_msg_ptr->token_len;
     }
 
     message_left = packet_len - ((*packet_data_pptr) - packet_data_start_ptr);
@@ -344,7 +410,7 @@ static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **pack
             case COAP_OPTION_ACCEPT:
             case COAP_OPTION_SIZE1:
             case COAP_OPTION_SIZE2:
-                if (sn_coap_parser_alloc_options(handle, dst_coap_msg_ptr) == NULL) {
+                if (sn_coap_parser_options_alloc(alloc, dst_coap_msg_ptr) == NULL) {
                     tr_error("sn_coap_parser_options_parse - failed to allocate options!");
                     return -1;
                 }
@@ -379,22 +445,17 @@ static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **pack
                 dst_coap_msg_ptr->options_list_ptr->proxy_uri_len = option_len;
                 (*packet_data_pptr)++;
 
-                dst_coap_msg_ptr->options_list_ptr->proxy_uri_ptr = handle->sn_coap_protocol_malloc(option_len);
-
-                if (dst_coap_msg_ptr->options_list_ptr->proxy_uri_ptr == NULL) {
+                if (sn_coap_parser_options_parse_bytes(alloc, packet_data_pptr, &dst_coap_msg_ptr->options_list_ptr->proxy_uri_ptr, option_len) != 0) {
                     tr_error("sn_coap_parser_options_parse - COAP_OPTION_PROXY_URI allocation failed!");
                     return -1;
                 }
 
-                memcpy(dst_coap_msg_ptr->options_list_ptr->proxy_uri_ptr, *packet_data_pptr, option_len);
-                (*packet_data_pptr) += option_len;
-
                 break;
 
             case COAP_OPTION_ETAG:
                 /* This is managed independently because User gives this option in one character table */
 
-                ret_status = sn_coap_parser_options_parse_multiple_options(handle, packet_data_pptr,
+                ret_status = sn_coap_parser_options_parse_multiple_options(alloc, packet_data_pptr,
                              message_left,
                              &dst_coap_msg_ptr->options_list_ptr->etag_ptr,
                              (uint16_t *)&dst_coap_msg_ptr->options_list_ptr->etag_len,
@@ -415,14 +476,10 @@ static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **pack
                 dst_coap_msg_ptr->options_list_ptr->uri_host_len = option_len;
                 (*packet_data_pptr)++;
 
-                dst_coap_msg_ptr->options_list_ptr->uri_host_ptr = handle->sn_coap_protocol_malloc(option_len);
-
-                if (dst_coap_msg_ptr->options_list_ptr->uri_host_ptr == NULL) {
+                if (sn_coap_parser_options_parse_bytes(alloc, packet_data_pptr, &dst_coap_msg_ptr->options_list_ptr->uri_host_ptr, option_len) != 0) {
                     tr_error("sn_coap_parser_options_parse - COAP_OPTION_URI_HOST allocation failed!");
                     return -1;
                 }
-                memcpy(dst_coap_msg_ptr->options_list_ptr->uri_host_ptr, *packet_data_pptr, option_len);
-                (*packet_data_pptr) += option_len;
 
                 break;
 
@@ -432,7 +489,7 @@ static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **pack
                     return -1;
                 }
                 /* This is managed independently because User gives this option in one character table */
-                ret_status = sn_coap_parser_options_parse_multiple_options(handle, packet_data_pptr, message_left,
+                ret_status = sn_coap_parser_options_parse_multiple_options(alloc, packet_data_pptr, message_left,
                              &dst_coap_msg_ptr->options_list_ptr->location_path_ptr, &dst_coap_msg_ptr->options_list_ptr->location_path_len,
                              COAP_OPTION_LOCATION_PATH, option_len);
                 if (ret_status >= 0) {
@@ -456,7 +513,7 @@ static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **pack
                 break;
 
             case COAP_OPTION_LOCATION_QUERY:
-                ret_status = sn_coap_parser_options_parse_multiple_options(handle, packet_data_pptr, message_left,
+                ret_status = sn_coap_parser_options_parse_multiple_options(alloc, packet_data_pptr, message_left,
                              &dst_coap_msg_ptr->options_list_ptr->location_query_ptr, &dst_coap_msg_ptr->options_list_ptr->location_query_len,
                              COAP_OPTION_LOCATION_QUERY, option_len);
                 if (ret_status >= 0) {
@@ -469,7 +526,7 @@ static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **pack
                 break;
 
             case COAP_OPTION_URI_PATH:
-                ret_status = sn_coap_parser_options_parse_multiple_options(handle, packet_data_pptr, message_left,
+                ret_status = sn_coap_parser_options_parse_multiple_options(alloc, packet_data_pptr, message_left,
                              &dst_coap_msg_ptr->uri_path_ptr, &dst_coap_msg_ptr->uri_path_len,
                              COAP_OPTION_URI_PATH, option_len);
                 if (ret_status >= 0) {
@@ -494,7 +551,7 @@ static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **pack
                 break;
 
             case COAP_OPTION_URI_QUERY:
-                ret_status = sn_coap_parser_options_parse_multiple_options(handle, packet_data_pptr, message_left,
+                ret_status = sn_coap_parser_options_parse_multiple_options(alloc, packet_data_pptr, message_left,
                              &dst_coap_msg_ptr->options_list_ptr->uri_query_ptr, &dst_coap_msg_ptr->options_list_ptr->uri_query_len,
                              COAP_OPTION_URI_QUERY, option_len);
                 if (ret_status >= 0) {
@@ -577,6 +634,36 @@ static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **pack
 }
 
 
+/**
+ * \brief Parses an option holding a string of bytes
+ *
+ * When parsing into an arena the option value is not copied, it is pointed
+ * to in the packet data.
+ *
+ * \param **packet_data_pptr is source of option data to be parsed
+ * \param **dst_pptr is destination for the option value
+ * \param option_len is length of option data
+ *
+ * \return Return value is 0 in ok case and -1 in failure case
+ */
+static int8_t sn_coap_parser_options_parse_bytes(sn_coap_parser_alloc_s *alloc, uint8_t **packet_data_pptr, uint8_t **dst_pptr, uint16_t option_len)
+{
+    if (alloc->arena_ptr) {
+        *dst_pptr = *packet_data_pptr;
+    } else {
+        *dst_pptr = alloc->handle->sn_coap_protocol_malloc(option_len);
+
+        if (*dst_pptr == NULL) {
+            return -1;
+        }
+
+        memcpy(*dst_pptr, *packet_data_pptr, option_len);
+    }
+
+    (*packet_data_pptr) += option_len;
+    return 0;
+}
+
 /**
  * \fn static int8_t sn_coap_parser_options_parse_multiple_options(uint8_t **packet_data_pptr, uint8_t options_count_left, uint8_t *previous_option_number_ptr, uint8_t **dst_pptr,
  *                                                                  uint16_t *dst_len_ptr, sn_coap_option_numbers_e option, uint16_t option_number_len)
@@ -593,7 +680,7 @@ static int8_t sn_coap_parser_options_parse(struct coap_s *handle, uint8_t **pack
  *
  * \return Return value is count of Uri-query optios parsed. In failure case -1 is returned.
 */
-static int8_t sn_coap_parser_options_parse_multiple_options(struct coap_s *handle, uint8_t **packet_data_pptr, uint16_t packet_left_len,  uint8_t **dst_pptr, uint16_t *dst_len_ptr, sn_coap_option_numbers_e option, uint16_t option_number_len)
+static int8_t sn_coap_parser_options_parse_multiple_options(sn_coap_parser_alloc_s *alloc, uint8_t **packet_data_pptr, uint16_t packet_left_len,  uint8_t **dst_pptr, uint16_t *dst_len_ptr, sn_coap_option_numbers_e option, uint16_t option_number_len)
 {
     int16_t     uri_query_needed_heap       = sn_coap_parser_options_count_needed_memory_multiple_option(*packet_data_pptr, packet_left_len, option, option_number_len);
     uint8_t    *temp_parsed_uri_query_ptr   = NULL;
@@ -603,8 +690,15 @@ static int8_t sn_coap_parser_options_parse_multiple_options(struct coap_s *handl
         return -1;
     }
 
+    /* A single option needs no separators, it can be pointed to in the packet data */
+    if (alloc->arena_ptr && uri_query_needed_heap && uri_query_needed_heap == option_number_len) {
+        *dst_len_ptr = uri_query_needed_heap;
+        (*packet_data_pptr)++;
+        return sn_coap_parser_options_parse_bytes(alloc, packet_data_pptr, dst_pptr, option_number_len) == 0 ? 1 : -1;
+    }
+
     if (uri_query_needed_heap) {
-        *dst_pptr = (uint8_t *) handle->sn_coap_protocol_malloc(uri_query_needed_heap);
+        *dst_pptr = (uint8_t *) sn_coap_parser_malloc(alloc, uri_query_needed_heap, 1);
 
         if (*dst_pptr == NULL) {
             tr_error("sn_coap_parser_options_parse_multiple_options - failed to allocate options!");
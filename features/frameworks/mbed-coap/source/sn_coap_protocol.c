@@ -47,14 +47,19 @@
 /* * * * LOCAL FUNCTION PROTOTYPES * * * */
 /* * * * * * * * * * * * * * * * * * * * */
 
+#if SN_COAP_DUPLICATION_MAX_MSGS_COUNT || SN_COAP_BLOCKWISE_ENABLED || SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE
+static uint32_t              sn_coap_protocol_hash(const uint8_t *data_ptr, uint16_t data_len, uint32_t hash);
+#endif
 #if SN_COAP_DUPLICATION_MAX_MSGS_COUNT/* If Message duplication detection is not used at all, this part of code will not be compiled */
+static coap_duplication_info_index_t *sn_coap_protocol_duplication_info_bucket(struct coap_s *handle, const sn_nsdl_addr_s *addr_ptr, uint16_t msg_id);
 static void                  sn_coap_protocol_linked_list_duplication_info_store(struct coap_s *handle, sn_nsdl_addr_s *src_addr_ptr, uint16_t msg_id, void *param);
 static coap_duplication_info_s *sn_coap_protocol_linked_list_duplication_info_search(struct coap_s *handle, sn_nsdl_addr_s *scr_addr_ptr, uint16_t msg_id);
-static void                  sn_coap_protocol_linked_list_duplication_info_remove(struct coap_s *handle, uint8_t *scr_addr_ptr, uint16_t port, uint16_t msg_id);
+static void                  sn_coap_protocol_linked_list_duplication_info_remove(struct coap_s *handle, coap_duplication_info_s *removed_duplication_info_ptr);
 static void                  sn_coap_protocol_linked_list_duplication_info_remove_old_ones(struct coap_s *handle);
 #endif
 #if SN_COAP_BLOCKWISE_ENABLED || SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE /* If Message blockwising is not enabled, this part of code will not be compiled */
 static void                  sn_coap_protocol_linked_list_blockwise_msg_remove(struct coap_s *handle, coap_blockwise_msg_s *removed_msg_ptr);
+static coap_blockwise_payload_index_t *sn_coap_protocol_blockwise_payload_bucket(struct coap_s *handle, const uint8_t *token_ptr, uint8_t token_len);
 static void                  sn_coap_protocol_linked_list_blockwise_payload_store(struct coap_s *handle, sn_nsdl_addr_s *addr_ptr, uint16_t stored_payload_len, uint8_t *stored_payload_ptr, uint8_t *token_ptr, uint8_t token_len, uint32_t block_number);
 static uint8_t              *sn_coap_protocol_linked_list_blockwise_payload_search(struct coap_s *handle, sn_nsdl_addr_s *src_addr_ptr, uint16_t *payload_length, uint8_t *token_ptr, uint8_t token_len);
 static bool                  sn_coap_protocol_linked_list_blockwise_payload_compare_block_number(struct coap_s *handle, sn_nsdl_addr_s *src_addr_ptr, uint8_t *token_ptr, uint8_t token_len, uint32_t block_number);
@@ -66,12 +71,15 @@ static sn_coap_hdr_s        *sn_coap_handle_blockwise_message(struct coap_s *han
 static sn_coap_hdr_s        *sn_coap_protocol_copy_header(struct coap_s *handle, sn_coap_hdr_s *source_header_ptr);
 #endif
 #if ENABLE_RESENDINGS
+static uint16_t              sn_coap_protocol_send_msg_id(const coap_send_msg_s *msg_ptr);
+static coap_send_msg_index_t *sn_coap_protocol_send_msg_bucket(struct coap_s *handle, uint16_t msg_id);
+static void                  sn_coap_protocol_linked_list_send_msg_schedule(struct coap_s *handle, coap_send_msg_s *msg_ptr);
+static void                  sn_coap_protocol_linked_list_send_msg_unlink(struct coap_s *handle, coap_send_msg_s *msg_ptr);
 static uint8_t               sn_coap_protocol_linked_list_send_msg_store(struct coap_s *handle, sn_nsdl_addr_s *dst_addr_ptr, uint16_t send_packet_data_len, uint8_t *send_packet_data_ptr, uint32_t sending_time, void *param);
 static sn_nsdl_transmit_s   *sn_coap_protocol_linked_list_send_msg_search(struct coap_s *handle,sn_nsdl_addr_s *src_addr_ptr, uint16_t msg_id);
 static void                  sn_coap_protocol_linked_list_send_msg_remove(struct coap_s *handle, sn_nsdl_addr_s *src_addr_ptr, uint16_t msg_id);
 static coap_send_msg_s      *sn_coap_protocol_allocate_mem_for_msg(struct coap_s *handle, sn_nsdl_addr_s *dst_addr_ptr, uint16_t packet_data_len);
 static void                  sn_coap_protocol_release_allocated_send_msg_mem(struct coap_s *handle, coap_send_msg_s *freed_send_msg_ptr);
-static uint16_t              sn_coap_count_linked_list_size(const coap_send_msg_list_t *linked_list_ptr);
 static uint32_t              sn_coap_calculate_new_resend_time(const uint32_t current_time, const uint8_t interval, const uint8_t counter);
 #endif
 
@@ -94,22 +102,7 @@ int8_t sn_coap_protocol_destroy(struct coap_s *handle)
 #if SN_COAP_DUPLICATION_MAX_MSGS_COUNT /* If Message duplication detection is not used at all, this part of code will not be compiled */
     ns_list_foreach_safe(coap_duplication_info_s, tmp, &handle->linked_list_duplication_msgs) {
         if (tmp->coap == handle) {
-            if (tmp->address) {
-                if (tmp->address->addr_ptr) {
-                    handle->sn_coap_protocol_free(tmp->address->addr_ptr);
-                    tmp->address->addr_ptr = 0;
-                }
-                handle->sn_coap_protocol_free(tmp->address);
-                tmp->address = 0;
-            }
-            if (tmp->packet_ptr) {
-                handle->sn_coap_protocol_free(tmp->packet_ptr);
-                tmp->packet_ptr = 0;
-            }
-            ns_list_remove(&handle->linked_list_duplication_msgs, tmp);
-            handle->count_duplication_msgs--;
-            handle->sn_coap_protocol_free(tmp);
-            tmp = 0;
+            sn_coap_protocol_linked_list_duplication_info_remove(handle, tmp);
         }
     }
 
@@ -173,6 +166,9 @@ struct coap_s *sn_coap_protocol_init(void *(*used_malloc_func_ptr)(uint16_t), vo
 #if ENABLE_RESENDINGS  /* If Message resending is not used at all, this part of code will not be compiled */
     /* * * * Create Linked list for storing active resending messages  * * * */
     ns_list_init(&handle->linked_list_resent_msgs);
+    for (uint16_t i = 0; i < SN_COAP_LOOKUP_INDEX_SIZE; i++) {
+        ns_list_init(&handle->index_resent_msgs[i]);
+    }
     handle->sn_coap_resending_queue_msgs = SN_COAP_RESENDING_QUEUE_SIZE_MSGS;
     handle->sn_coap_resending_queue_bytes = SN_COAP_RESENDING_QUEUE_SIZE_BYTES;
     handle->sn_coap_resending_intervall = DEFAULT_RESPONSE_TIMEOUT;
@@ -184,6 +180,9 @@ struct coap_s *sn_coap_protocol_init(void *(*used_malloc_func_ptr)(uint16_t), vo
 #if SN_COAP_DUPLICATION_MAX_MSGS_COUNT /* If Message duplication detection is not used at all, this part of code will not be compiled */
     /* * * * Create Linked list for storing Duplication info * * * */
     ns_list_init(&handle->linked_list_duplication_msgs);
+    for (uint16_t i = 0; i < SN_COAP_LOOKUP_INDEX_SIZE; i++) {
+        ns_list_init(&handle->index_duplication_msgs[i]);
+    }
     handle->sn_coap_duplication_buffer_size = SN_COAP_DUPLICATION_MAX_MSGS_COUNT;
 #endif
 
@@ -191,6 +190,9 @@ struct coap_s *sn_coap_protocol_init(void *(*used_malloc_func_ptr)(uint16_t), vo
 
     ns_list_init(&handle->linked_list_blockwise_sent_msgs);
     ns_list_init(&handle->linked_list_blockwise_received_payloads);
+    for (uint16_t i = 0; i < SN_COAP_LOOKUP_INDEX_SIZE; i++) {
+        ns_list_init(&handle->index_blockwise_received_payloads[i]);
+    }
     handle->sn_coap_block_data_size = SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE;
 
 #endif /* ENABLE_RESENDINGS */
@@ -336,9 +338,8 @@ void sn_coap_protocol_clear_retransmission_buffer(struct coap_s *handle)
         return;
     }
     ns_list_foreach_safe(coap_send_msg_s, tmp, &handle->linked_list_resent_msgs) {
-        ns_list_remove(&handle->linked_list_resent_msgs, tmp);
+        sn_coap_protocol_linked_list_send_msg_unlink(handle, tmp);
         sn_coap_protocol_release_allocated_send_msg_mem(handle, tmp);
-        --handle->count_resent_msgs;
     }
 #endif
 }
@@ -349,16 +350,11 @@ int8_t sn_coap_protocol_delete_retransmission(struct coap_s *handle, uint16_t ms
     if (handle == NULL) {
         return -1;
     }
-    ns_list_foreach_safe(coap_send_msg_s, tmp, &handle->linked_list_resent_msgs) {
-        if (tmp->send_msg_ptr && tmp->send_msg_ptr->packet_ptr ) {
-            uint16_t temp_msg_id = (tmp->send_msg_ptr->packet_ptr[2] << 8);
-            temp_msg_id += (uint16_t)tmp->send_msg_ptr->packet_ptr[3];
-            if(temp_msg_id == msg_id){
-                ns_list_remove(&handle->linked_list_resent_msgs, tmp);
-                --handle->count_resent_msgs;
-                sn_coap_protocol_release_allocated_send_msg_mem(handle, tmp);
-                return 0;
-            }
+    ns_list_foreach(coap_send_msg_s, tmp, sn_coap_protocol_send_msg_bucket(handle, msg_id)) {
+        if (sn_coap_protocol_send_msg_id(tmp) == msg_id) {
+            sn_coap_protocol_linked_list_send_msg_unlink(handle, tmp);
+            sn_coap_protocol_release_allocated_send_msg_mem(handle, tmp);
+            return 0;
         }
     }
 #endif
@@ -379,11 +375,8 @@ int8_t sn_coap_protocol_delete_retransmission_by_token(struct coap_s *handle, ui
             uint8_t stored_token[8];
             memcpy(stored_token, &stored_msg->send_msg_ptr->packet_ptr[4], stored_token_len);
             if (memcmp(stored_token, token, stored_token_len) == 0) {
-                uint16_t temp_msg_id = (stored_msg->send_msg_ptr->packet_ptr[2] << 8);
-                temp_msg_id += (uint16_t)stored_msg->send_msg_ptr->packet_ptr[3];
-                tr_debug("sn_coap_protocol_delete_retransmission_by_token - removed msg_id: %d", temp_msg_id);
-                ns_list_remove(&handle->linked_list_resent_msgs, stored_msg);
-                --handle->count_resent_msgs;
+                tr_debug("sn_coap_protocol_delete_retransmission_by_token - removed msg_id: %d", sn_coap_protocol_send_msg_id(stored_msg));
+                sn_coap_protocol_linked_list_send_msg_unlink(handle, stored_msg);
 
                 /* Free memory of stored message */
                 sn_coap_protocol_release_allocated_send_msg_mem(handle, stored_msg);
@@ -707,10 +700,7 @@ sn_coap_hdr_s *sn_coap_protocol_parse(struct coap_s *handle, sn_nsdl_addr_s *src
                 coap_duplication_info_s *stored_duplication_info_ptr = ns_list_get_first(&handle->linked_list_duplication_msgs);
 
                 /* Remove oldest stored duplication message for getting room for new duplication message */
-                sn_coap_protocol_linked_list_duplication_info_remove(handle,
-                                                                     stored_duplication_info_ptr->address->addr_ptr,
-                                                                     stored_duplication_info_ptr->address->port,
-                                                                     stored_duplication_info_ptr->msg_id);
+                sn_coap_protocol_linked_list_duplication_info_remove(handle, stored_duplication_info_ptr);
             }
 
             /* Store Duplication info to Linked list */
@@ -839,59 +829,49 @@ int8_t sn_coap_protocol_exec(struct coap_s *handle, uint32_t current_time)
 #endif
 
 #if ENABLE_RESENDINGS
-    /* Check if there is ongoing active message sendings */
-    /* foreach_safe isn't sufficient because callback routine could cancel messages. */
-rescan:
-    ns_list_foreach(coap_send_msg_s, stored_msg_ptr, &handle->linked_list_resent_msgs) {
-        // First check that msg belongs to handle
-        if( stored_msg_ptr->coap == handle ){
-            /* Check if it is time to send this message */
-            if (current_time >= stored_msg_ptr->resending_time) {
-                /* * * Increase Resending counter  * * */
-                stored_msg_ptr->resending_counter++;
-
-                /* Check if all re-sendings have been done */
-                if (stored_msg_ptr->resending_counter > handle->sn_coap_resending_count) {
-                    coap_version_e coap_version = COAP_VERSION_UNKNOWN;
-
-                    /* Get message ID from stored sending message */
-                    uint16_t temp_msg_id = (stored_msg_ptr->send_msg_ptr->packet_ptr[2] << 8);
-                    temp_msg_id += (uint16_t)stored_msg_ptr->send_msg_ptr->packet_ptr[3];
-
-                    /* Remove message from Linked list */
-                    ns_list_remove(&handle->linked_list_resent_msgs, stored_msg_ptr);
-                    --handle->count_resent_msgs;
-
-                    /* If RX callback have been defined.. */
-                    if (stored_msg_ptr->coap->sn_coap_rx_callback != 0) {
-                        sn_coap_hdr_s *tmp_coap_hdr_ptr;
-                        /* Parse CoAP message, set status and call RX callback */
-                        tmp_coap_hdr_ptr = sn_coap_parser(stored_msg_ptr->coap, stored_msg_ptr->send_msg_ptr->packet_len, stored_msg_ptr->send_msg_ptr->packet_ptr, &coap_version);
-
-                        if (tmp_coap_hdr_ptr != 0) {
-                            tmp_coap_hdr_ptr->coap_status = COAP_STATUS_BUILDER_MESSAGE_SENDING_FAILED;
-                            stored_msg_ptr->coap->sn_coap_rx_callback(tmp_coap_hdr_ptr, stored_msg_ptr->send_msg_ptr->dst_addr_ptr, stored_msg_ptr->param);
-
-                            sn_coap_parser_release_allocated_coap_msg_mem(stored_msg_ptr->coap, tmp_coap_hdr_ptr);
-                        }
-                    }
-
-                    /* Free memory of stored message */
-                    sn_coap_protocol_release_allocated_send_msg_mem(handle, stored_msg_ptr);
-                } else {
-                    /* Send message  */
-                    stored_msg_ptr->coap->sn_coap_tx_callback(stored_msg_ptr->send_msg_ptr->packet_ptr,
-                            stored_msg_ptr->send_msg_ptr->packet_len, stored_msg_ptr->send_msg_ptr->dst_addr_ptr, stored_msg_ptr->param);
-
-                    /* * * Count new Resending time  * * */
-                    stored_msg_ptr->resending_time = sn_coap_calculate_new_resend_time(current_time,
-                                                                                       handle->sn_coap_resending_intervall,
-                                                                                       stored_msg_ptr->resending_counter);
+    /* Resending messages are kept in order of resending time, only the due ones are visited. */
+    /* Callback routine could have wiped the list (eg as a response to sending failed), */
+    /* so the first message is fetched again after each one. */
+    coap_send_msg_s *stored_msg_ptr;
+    while ((stored_msg_ptr = ns_list_get_first(&handle->linked_list_resent_msgs)) != NULL &&
+            current_time >= stored_msg_ptr->resending_time) {
+        /* * * Increase Resending counter  * * */
+        stored_msg_ptr->resending_counter++;
+
+        /* Check if all re-sendings have been done */
+        if (stored_msg_ptr->resending_counter > handle->sn_coap_resending_count) {
+            coap_version_e coap_version = COAP_VERSION_UNKNOWN;
+
+            /* Remove message from Linked list */
+            sn_coap_protocol_linked_list_send_msg_unlink(handle, stored_msg_ptr);
+
+            /* If RX callback have been defined.. */
+            if (stored_msg_ptr->coap->sn_coap_rx_callback != 0) {
+                sn_coap_hdr_s *tmp_coap_hdr_ptr;
+                /* Parse CoAP message, set status and call RX callback */
+                tmp_coap_hdr_ptr = sn_coap_parser(stored_msg_ptr->coap, stored_msg_ptr->send_msg_ptr->packet_len, stored_msg_ptr->send_msg_ptr->packet_ptr, &coap_version);
+
+                if (tmp_coap_hdr_ptr != 0) {
+                    tmp_coap_hdr_ptr->coap_status = COAP_STATUS_BUILDER_MESSAGE_SENDING_FAILED;
+                    stored_msg_ptr->coap->sn_coap_rx_callback(tmp_coap_hdr_ptr, stored_msg_ptr->send_msg_ptr->dst_addr_ptr, stored_msg_ptr->param);
+
+                    sn_coap_parser_release_allocated_coap_msg_mem(stored_msg_ptr->coap, tmp_coap_hdr_ptr);
                 }
-                /* Callback routine could have wiped the list (eg as a response to sending failed) */
-                /* Be super cautious and rescan from the start */
-                goto rescan;
             }
+
+            /* Free memory of stored message */
+            sn_coap_protocol_release_allocated_send_msg_mem(handle, stored_msg_ptr);
+        } else {
+            /* * * Count new Resending time and move the message after the ones sent before it * * */
+            stored_msg_ptr->resending_time = sn_coap_calculate_new_resend_time(current_time,
+                                                                               handle->sn_coap_resending_intervall,
+                                                                               stored_msg_ptr->resending_counter);
+            ns_list_remove(&handle->linked_list_resent_msgs, stored_msg_ptr);
+            sn_coap_protocol_linked_list_send_msg_schedule(handle, stored_msg_ptr);
+
+            /* Send message  */
+            stored_msg_ptr->coap->sn_coap_tx_callback(stored_msg_ptr->send_msg_ptr->packet_ptr,
+                    stored_msg_ptr->send_msg_ptr->packet_len, stored_msg_ptr->send_msg_ptr->dst_addr_ptr, stored_msg_ptr->param);
         }
     }
 
@@ -938,9 +918,9 @@ static uint8_t sn_coap_protocol_linked_list_send_msg_store(struct coap_s *handle
         }
     }
 
-    /* Count resending queue size, if buffer size is defined */
+    /* Check resending queue size, if buffer size is defined */
     if (handle->sn_coap_resending_queue_bytes > 0) {
-        if ((sn_coap_count_linked_list_size(&handle->linked_list_resent_msgs) + send_packet_data_len) > handle->sn_coap_resending_queue_bytes) {
+        if ((handle->size_resent_msgs + send_packet_data_len) > handle->sn_coap_resending_queue_bytes) {
             tr_error("sn_coap_protocol_linked_list_send_msg_store - resend buffer size reached!");
             return 0;
         }
@@ -973,11 +953,83 @@ static uint8_t sn_coap_protocol_linked_list_send_msg_store(struct coap_s *handle
     stored_msg_ptr->param = param;
 
     /* Storing Resending message to Linked list */
-    ns_list_add_to_end(&handle->linked_list_resent_msgs, stored_msg_ptr);
+    sn_coap_protocol_linked_list_send_msg_schedule(handle, stored_msg_ptr);
+    ns_list_add_to_end(sn_coap_protocol_send_msg_bucket(handle, sn_coap_protocol_send_msg_id(stored_msg_ptr)), stored_msg_ptr);
     ++handle->count_resent_msgs;
+    handle->size_resent_msgs += send_packet_data_len;
     return 1;
 }
 
+/**************************************************************************//**
+ * \fn static uint16_t sn_coap_protocol_send_msg_id(const coap_send_msg_s *msg_ptr)
+ *
+ * \brief Reads Message ID of stored resending message
+ *
+ * \param *msg_ptr is stored resending message
+ *
+ * \return Message ID of the message
+ *****************************************************************************/
+
+static uint16_t sn_coap_protocol_send_msg_id(const coap_send_msg_s *msg_ptr)
+{
+    return (uint16_t)((msg_ptr->send_msg_ptr->packet_ptr[2] << 8) | msg_ptr->send_msg_ptr->packet_ptr[3]);
+}
+
+/**************************************************************************//**
+ * \fn static coap_send_msg_index_t *sn_coap_protocol_send_msg_bucket(struct coap_s *handle, uint16_t msg_id)
+ *
+ * \brief Gets bucket of resending messages holding given Message ID
+ *
+ * Message IDs are allocated in sequence, so they are used as hash as is.
+ * Messages can be cancelled by Message ID alone, address is not part of the key.
+ *
+ * \param msg_id is Message ID of searched message
+ *
+ * \return Bucket of resending messages
+ *****************************************************************************/
+
+static coap_send_msg_index_t *sn_coap_protocol_send_msg_bucket(struct coap_s *handle, uint16_t msg_id)
+{
+    return &handle->index_resent_msgs[msg_id & (SN_COAP_LOOKUP_INDEX_SIZE - 1)];
+}
+
+/**************************************************************************//**
+ * \fn static void sn_coap_protocol_linked_list_send_msg_schedule(struct coap_s *handle, coap_send_msg_s *msg_ptr)
+ *
+ * \brief Inserts resending message to Linked list in order of resending time
+ *
+ * New resending times are usually the latest ones, so list is scanned from the end.
+ *
+ * \param *msg_ptr is inserted resending message
+ *****************************************************************************/
+
+static void sn_coap_protocol_linked_list_send_msg_schedule(struct coap_s *handle, coap_send_msg_s *msg_ptr)
+{
+    ns_list_foreach_reverse(coap_send_msg_s, stored_msg_ptr, &handle->linked_list_resent_msgs) {
+        if (stored_msg_ptr->resending_time <= msg_ptr->resending_time) {
+            ns_list_add_after(&handle->linked_list_resent_msgs, stored_msg_ptr, msg_ptr);
+            return;
+        }
+    }
+    ns_list_add_to_start(&handle->linked_list_resent_msgs, msg_ptr);
+}
+
+/**************************************************************************//**
+ * \fn static void sn_coap_protocol_linked_list_send_msg_unlink(struct coap_s *handle, coap_send_msg_s *msg_ptr)
+ *
+ * \brief Removes resending message from Linked list and from its bucket, memory is not released
+ *
+ * \param *msg_ptr is removed resending message
+ *****************************************************************************/
+
+static void sn_coap_protocol_linked_list_send_msg_unlink(struct coap_s *handle, coap_send_msg_s *msg_ptr)
+{
+    ns_list_remove(&handle->linked_list_resent_msgs, msg_ptr);
+    ns_list_remove(sn_coap_protocol_send_msg_bucket(handle, sn_coap_protocol_send_msg_id(msg_ptr)), msg_ptr);
+    --handle->count_resent_msgs;
+    handle->size_resent_msgs -= msg_ptr->send_msg_ptr->packet_len;
+}
+
 /**************************************************************************//**
  * \fn static sn_nsdl_transmit_s *sn_coap_protocol_linked_list_send_msg_search(sn_nsdl_addr_s *src_addr_ptr, uint16_t msg_id)
  *
@@ -994,14 +1046,10 @@ static uint8_t sn_coap_protocol_linked_list_send_msg_store(struct coap_s *handle
 static sn_nsdl_transmit_s *sn_coap_protocol_linked_list_send_msg_search(struct coap_s *handle,
         sn_nsdl_addr_s *src_addr_ptr, uint16_t msg_id)
 {
-    /* Loop all stored resending messages Linked list */
-    ns_list_foreach(coap_send_msg_s, stored_msg_ptr, &handle->linked_list_resent_msgs) {
-        /* Get message ID from stored resending message */
-        uint16_t temp_msg_id = (stored_msg_ptr->send_msg_ptr->packet_ptr[2] << 8);
-        temp_msg_id += (uint16_t)stored_msg_ptr->send_msg_ptr->packet_ptr[3];
-
+    /* Loop stored resending messages having same Message ID hash */
+    ns_list_foreach(coap_send_msg_s, stored_msg_ptr, sn_coap_protocol_send_msg_bucket(handle, msg_id)) {
         /* If message's Message ID is same than is searched */
-        if (temp_msg_id == msg_id) {
+        if (sn_coap_protocol_send_msg_id(stored_msg_ptr) == msg_id) {
             /* If message's Source address is same than is searched */
             if (0 == memcmp(src_addr_ptr->addr_ptr, stored_msg_ptr->send_msg_ptr->dst_addr_ptr->addr_ptr, src_addr_ptr->addr_len)) {
                 /* If message's Source address port is same than is searched */
@@ -1027,14 +1075,10 @@ static sn_nsdl_transmit_s *sn_coap_protocol_linked_list_send_msg_search(struct c
 
 static void sn_coap_protocol_linked_list_send_msg_remove(struct coap_s *handle, sn_nsdl_addr_s *src_addr_ptr, uint16_t msg_id)
 {
-    /* Loop all stored resending messages in Linked list */
-    ns_list_foreach(coap_send_msg_s, stored_msg_ptr, &handle->linked_list_resent_msgs) {
-        /* Get message ID from stored resending message */
-        uint16_t temp_msg_id = (stored_msg_ptr->send_msg_ptr->packet_ptr[2] << 8);
-        temp_msg_id += (uint16_t)stored_msg_ptr->send_msg_ptr->packet_ptr[3];
-
+    /* Loop stored resending messages having same Message ID hash */
+    ns_list_foreach(coap_send_msg_s, stored_msg_ptr, sn_coap_protocol_send_msg_bucket(handle, msg_id)) {
         /* If message's Message ID is same than is searched */
-        if (temp_msg_id == msg_id) {
+        if (sn_coap_protocol_send_msg_id(stored_msg_ptr) == msg_id) {
             /* If message's Source address is same than is searched */
             if (0 == memcmp(src_addr_ptr->addr_ptr, stored_msg_ptr->send_msg_ptr->dst_addr_ptr->addr_ptr, src_addr_ptr->addr_len)) {
                 /* If message's Source address port is same than is searched */
@@ -1042,8 +1086,7 @@ static void sn_coap_protocol_linked_list_send_msg_remove(struct coap_s *handle,
                     /* * * Message found * * */
 
                     /* Remove message from Linked list */
-                    ns_list_remove(&handle->linked_list_resent_msgs, stored_msg_ptr);
-                    --handle->count_resent_msgs;
+                    sn_coap_protocol_linked_list_send_msg_unlink(handle, stored_msg_ptr);
 
                     /* Free memory of stored message */
                     sn_coap_protocol_release_allocated_send_msg_mem(handle, stored_msg_ptr);
@@ -1089,6 +1132,28 @@ uint16_t sn_coap_protocol_get_configured_blockwise_size(struct coap_s *handle)
     return handle->sn_coap_block_data_size;
 }
 
+#if SN_COAP_DUPLICATION_MAX_MSGS_COUNT || SN_COAP_BLOCKWISE_ENABLED || SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE
+/**************************************************************************//**
+ * \fn static uint32_t sn_coap_protocol_hash(const uint8_t *data_ptr, uint16_t data_len, uint32_t hash)
+ *
+ * \brief Hashes data for indexing stored messages (FNV-1a)
+ *
+ * \param *data_ptr is pointer to hashed data
+ * \param data_len is length of hashed data
+ * \param hash is hash of the preceding data, or 2166136261 for the first one
+ *
+ * \return Hash of the data
+ *****************************************************************************/
+
+static uint32_t sn_coap_protocol_hash(const uint8_t *data_ptr, uint16_t data_len, uint32_t hash)
+{
+    for (uint16_t i = 0; i < data_len; i++) {
+        hash = (hash ^ data_ptr[i]) * 16777619UL;
+    }
+    return hash;
+}
+#endif
+
 #if SN_COAP_DUPLICATION_MAX_MSGS_COUNT /* If Message duplication detection is not used at all, this part of code will not be compiled */
 
 /**************************************************************************//**
@@ -1150,9 +1215,30 @@ static void sn_coap_protocol_linked_list_duplication_info_store(struct coap_s *h
     /* * * * Storing Duplication info to Linked list * * * */
 
     ns_list_add_to_end(&handle->linked_list_duplication_msgs, stored_duplication_info_ptr);
+    ns_list_add_to_end(sn_coap_protocol_duplication_info_bucket(handle, addr_ptr, msg_id), stored_duplication_info_ptr);
     ++handle->count_duplication_msgs;
 }
 
+/**************************************************************************//**
+ * \fn static coap_duplication_info_index_t *sn_coap_protocol_duplication_info_bucket(struct coap_s *handle, const sn_nsdl_addr_s *addr_ptr, uint16_t msg_id)
+ *
+ * \brief Gets bucket of Duplication infos holding given Address and Message ID
+ *
+ * \param *addr_ptr is pointer to Address key
+ * \param msg_id is Message ID key
+ *
+ * \return Bucket of Duplication infos
+ *****************************************************************************/
+
+static coap_duplication_info_index_t *sn_coap_protocol_duplication_info_bucket(struct coap_s *handle, const sn_nsdl_addr_s *addr_ptr, uint16_t msg_id)
+{
+    const uint8_t key[4] = { addr_ptr->port >> 8, (uint8_t)addr_ptr->port, msg_id >> 8, (uint8_t)msg_id };
+    uint32_t hash = sn_coap_protocol_hash(addr_ptr->addr_ptr, addr_ptr->addr_len, 2166136261UL);
+    hash = sn_coap_protocol_hash(key, sizeof(key), hash);
+
+    return &handle->index_duplication_msgs[(hash ^ (hash >> 16)) & (SN_COAP_LOOKUP_INDEX_SIZE - 1)];
+}
+
 /**************************************************************************//**
  * \fn static int8_t sn_coap_protocol_linked_list_duplication_info_search(sn_nsdl_addr_s *addr_ptr, uint16_t msg_id)
  *
@@ -1167,8 +1253,8 @@ static void sn_coap_protocol_linked_list_duplication_info_store(struct coap_s *h
 static coap_duplication_info_s* sn_coap_protocol_linked_list_duplication_info_search(struct coap_s *handle,
         sn_nsdl_addr_s *addr_ptr, uint16_t msg_id)
 {
-    /* Loop all nodes in Linked list for searching Message ID */
-    ns_list_foreach(coap_duplication_info_s, stored_duplication_info_ptr, &handle->linked_list_duplication_msgs) {
+    /* Loop Duplication infos having same Address and Message ID hash */
+    ns_list_foreach(coap_duplication_info_s, stored_duplication_info_ptr, sn_coap_protocol_duplication_info_bucket(handle, addr_ptr, msg_id)) {
         /* If message's Message ID is same than is searched */
         if (stored_duplication_info_ptr->msg_id == msg_id) {
             /* If message's Source address is same than is searched */
@@ -1185,74 +1271,50 @@ static coap_duplication_info_s* sn_coap_protocol_linked_list_duplication_info_se
 }
 
 /**************************************************************************//**
- * \fn static void sn_coap_protocol_linked_list_duplication_info_remove(struct coap_s *handle, uint8_t *addr_ptr, uint16_t port, uint16_t msg_id)
+ * \fn static void sn_coap_protocol_linked_list_duplication_info_remove(struct coap_s *handle, coap_duplication_info_s *removed_duplication_info_ptr)
  *
  * \brief Removes stored Duplication info from Linked list
  *
- * \param *addr_ptr is pointer to Address key to be removed
- *
- * \param port is Port key to be removed
- *
- * \param msg_id is Message ID key to be removed
+ * \param *removed_duplication_info_ptr is Duplication info to be removed
  *****************************************************************************/
 
-static void sn_coap_protocol_linked_list_duplication_info_remove(struct coap_s *handle, uint8_t *addr_ptr, uint16_t port, uint16_t msg_id)
+static void sn_coap_protocol_linked_list_duplication_info_remove(struct coap_s *handle, coap_duplication_info_s *removed_duplication_info_ptr)
 {
-    /* Loop all stored duplication messages in Linked list */
-    ns_list_foreach(coap_duplication_info_s, removed_duplication_info_ptr, &handle->linked_list_duplication_msgs) {
-        /* If message's Address is same than is searched */
-        if (handle == removed_duplication_info_ptr->coap && 0 == memcmp(addr_ptr,
-                                                                        removed_duplication_info_ptr->address->addr_ptr,
-                                                                        removed_duplication_info_ptr->address->addr_len)) {
-            /* If message's Address prt is same than is searched */
-            if (removed_duplication_info_ptr->address->port == port) {
-                /* If Message ID is same than is searched */
-                if (removed_duplication_info_ptr->msg_id == msg_id) {
-                    /* * * * Correct Duplication info found, remove it from Linked list * * * */
-                    ns_list_remove(&handle->linked_list_duplication_msgs, removed_duplication_info_ptr);
-                    --handle->count_duplication_msgs;
-
-                    /* Free memory of stored Duplication info */
-                    handle->sn_coap_protocol_free(removed_duplication_info_ptr->address->addr_ptr);
-                    removed_duplication_info_ptr->address->addr_ptr = 0;
-                    handle->sn_coap_protocol_free(removed_duplication_info_ptr->address);
-                    removed_duplication_info_ptr->address = 0;
-                    handle->sn_coap_protocol_free(removed_duplication_info_ptr->packet_ptr);
-                    removed_duplication_info_ptr->packet_ptr = 0;
-                    handle->sn_coap_protocol_free(removed_duplication_info_ptr);
-                    removed_duplication_info_ptr = 0;
-                    return;
-                }
-            }
-        }
-    }
+    ns_list_remove(&handle->linked_list_duplication_msgs, removed_duplication_info_ptr);
+    ns_list_remove(sn_coap_protocol_duplication_info_bucket(handle,
+                                                            removed_duplication_info_ptr->address,
+                                                            removed_duplication_info_ptr->msg_id),
+                   removed_duplication_info_ptr);
+    --handle->count_duplication_msgs;
+
+    /* Free memory of stored Duplication info */
+    handle->sn_coap_protocol_free(removed_duplication_info_ptr->address->addr_ptr);
+    removed_duplication_info_ptr->address->addr_ptr = 0;
+    handle->sn_coap_protocol_free(removed_duplication_info_ptr->address);
+    removed_duplication_info_ptr->address = 0;
+    handle->sn_coap_protocol_free(removed_duplication_info_ptr->packet_ptr);
+    removed_duplication_info_ptr->packet_ptr = 0;
+    handle->sn_coap_protocol_free(removed_duplication_info_ptr);
 }
 
 /**************************************************************************//**
  * \fn static void sn_coap_protocol_linked_list_duplication_info_remove_old_ones(struct coap_s *handle)
  *
  * \brief Removes old stored Duplication detection infos from Linked list
+ *
+ * Duplication infos are stored in order of timestamp, so only old ones and
+ * the first one still valid are visited.
  *****************************************************************************/
 
 static void sn_coap_protocol_linked_list_duplication_info_remove_old_ones(struct coap_s *handle)
 {
-    /* Loop all stored duplication messages in Linked list */
+    /* Loop stored duplication messages in Linked list until a valid one */
     ns_list_foreach_safe(coap_duplication_info_s, removed_duplication_info_ptr, &handle->linked_list_duplication_msgs) {
-        if ((handle->system_time - removed_duplication_info_ptr->timestamp)  > SN_COAP_DUPLICATION_MAX_TIME_MSGS_STORED) {
-            /* * * * Old Duplication info found, remove it from Linked list * * * */
-            ns_list_remove(&handle->linked_list_duplication_msgs, removed_duplication_info_ptr);
-            --handle->count_duplication_msgs;
-
-            /* Free memory of stored Duplication info */
-            handle->sn_coap_protocol_free(removed_duplication_info_ptr->address->addr_ptr);
-            removed_duplication_info_ptr->address->addr_ptr = 0;
-            handle->sn_coap_protocol_free(removed_duplication_info_ptr->address);
-            removed_duplication_info_ptr->address = 0;
-            handle->sn_coap_protocol_free(removed_duplication_info_ptr->packet_ptr);
-            removed_duplication_info_ptr->packet_ptr = 0;
-            handle->sn_coap_protocol_free(removed_duplication_info_ptr);
-            removed_duplication_info_ptr = 0;
+        if ((handle->system_time - removed_duplication_info_ptr->timestamp) <= SN_COAP_DUPLICATION_MAX_TIME_MSGS_STORED) {
+            break;
         }
+        /* * * * Old Duplication info found, remove it from Linked list * * * */
+        sn_coap_protocol_linked_list_duplication_info_remove(handle, removed_duplication_info_ptr);
     }
 }
 
@@ -1308,7 +1370,7 @@ static void sn_coap_protocol_linked_list_blockwise_payload_store(struct coap_s *
     }
 
     // Do not add duplicates to list, this could happen if server needs to retransmit block message again
-    ns_list_foreach(coap_blockwise_payload_s, payload_info_ptr, &handle->linked_list_blockwise_received_payloads) {
+    ns_list_foreach(coap_blockwise_payload_s, payload_info_ptr, sn_coap_protocol_blockwise_payload_bucket(handle, token_ptr, token_len)) {
         if ((0 == memcmp(addr_ptr->addr_ptr, payload_info_ptr->addr_ptr, addr_ptr->addr_len)) && (payload_info_ptr->port == addr_ptr->port)) {
             if (token_ptr) {
                 if (!payload_info_ptr->token_ptr || (payload_info_ptr->token_len != token_len) || (memcmp(payload_info_ptr->token_ptr, token_ptr, token_len))) {
@@ -1393,6 +1455,32 @@ static void sn_coap_protocol_linked_list_blockwise_payload_store(struct coap_s *
 
     /* * * * Storing Payload to Linked list  * * * */
     ns_list_add_to_end(&handle->linked_list_blockwise_received_payloads, stored_blockwise_payload_ptr);
+    ns_list_add_to_end(sn_coap_protocol_blockwise_payload_bucket(handle, stored_blockwise_payload_ptr->token_ptr, stored_blockwise_payload_ptr->token_len),
+                       stored_blockwise_payload_ptr);
+}
+
+/**************************************************************************//**
+ * \fn static coap_blockwise_payload_index_t *sn_coap_protocol_blockwise_payload_bucket(struct coap_s *handle, const uint8_t *token_ptr, uint8_t token_len)
+ *
+ * \brief Gets bucket of stored blockwise payloads holding given Token
+ *
+ * Payloads are searched by Token alone when the oldest one is removed, so
+ * address is not part of the key.
+ *
+ * \param *token_ptr is pointer to Token key, NULL if none
+ * \param token_len is length of Token key
+ *
+ * \return Bucket of stored blockwise payloads
+ *****************************************************************************/
+
+static coap_blockwise_payload_index_t *sn_coap_protocol_blockwise_payload_bucket(struct coap_s *handle, const uint8_t *token_ptr, uint8_t token_len)
+{
+    uint32_t hash = 2166136261UL;
+    if (token_ptr) {
+        hash = sn_coap_protocol_hash(token_ptr, token_len, hash);
+    }
+
+    return &handle->index_blockwise_received_payloads[(hash ^ (hash >> 16)) & (SN_COAP_LOOKUP_INDEX_SIZE - 1)];
 }
 
 /**************************************************************************//**
@@ -1409,8 +1497,8 @@ static void sn_coap_protocol_linked_list_blockwise_payload_store(struct coap_s *
 
 static uint8_t *sn_coap_protocol_linked_list_blockwise_payload_search(struct coap_s *handle, sn_nsdl_addr_s *src_addr_ptr, uint16_t *payload_length, uint8_t *token_ptr, uint8_t token_len)
 {
-    /* Loop all stored blockwise payloads in Linked list */
-    ns_list_foreach(coap_blockwise_payload_s, stored_payload_info_ptr, &handle->linked_list_blockwise_received_payloads) {
+    /* Loop stored blockwise payloads having same Token hash */
+    ns_list_foreach(coap_blockwise_payload_s, stored_payload_info_ptr, sn_coap_protocol_blockwise_payload_bucket(handle, token_ptr, token_len)) {
         /* If payload's Source address and port is same than is searched */
         if ((0 == memcmp(src_addr_ptr->addr_ptr, stored_payload_info_ptr->addr_ptr, src_addr_ptr->addr_len)) && (stored_payload_info_ptr->port == src_addr_ptr->port)) {
             /* Check token */
@@ -1436,8 +1524,8 @@ static bool sn_coap_protocol_linked_list_blockwise_payload_compare_block_number(
                                                                                    uint8_t token_len,
                                                                                    uint32_t block_number)
 {
-    /* Loop all stored blockwise payloads in Linked list */
-    ns_list_foreach(coap_blockwise_payload_s, stored_payload_info_ptr, &handle->linked_list_blockwise_received_payloads) {
+    /* Loop stored blockwise payloads having same Token hash */
+    ns_list_foreach(coap_blockwise_payload_s, stored_payload_info_ptr, sn_coap_protocol_blockwise_payload_bucket(handle, token_ptr, token_len)) {
         /* If payload's Source address and port is same than is searched */
         if ((0 == memcmp(src_addr_ptr->addr_ptr, stored_payload_info_ptr->addr_ptr, src_addr_ptr->addr_len)) && (stored_payload_info_ptr->port == src_addr_ptr->port)) {
             /* Check token number */
@@ -1466,16 +1554,17 @@ static bool sn_coap_protocol_linked_list_blockwise_payload_compare_block_number(
 
 static void sn_coap_protocol_linked_list_blockwise_payload_remove_oldest(struct coap_s *handle, uint8_t *token_ptr, uint8_t token_len)
 {
-    /* Remove oldest node in Linked list*/
+    /* Remove oldest node in Linked list, payloads are kept in storing order in their bucket too */
+    coap_blockwise_payload_index_t *bucket = sn_coap_protocol_blockwise_payload_bucket(handle, token_ptr, token_len);
     if (token_ptr) {
-        ns_list_foreach(coap_blockwise_payload_s, removed_payload_ptr, &handle->linked_list_blockwise_received_payloads) {
+        ns_list_foreach(coap_blockwise_payload_s, removed_payload_ptr, bucket) {
             if ((token_len == removed_payload_ptr->token_len) && !memcmp(removed_payload_ptr->token_ptr, token_ptr, token_len)) {
                 sn_coap_protocol_linked_list_blockwise_payload_remove(handle, removed_payload_ptr);
                 return;
             }
         }
     } else {
-        ns_list_foreach(coap_blockwise_payload_s, removed_payload_ptr, &handle->linked_list_blockwise_received_payloads) {
+        ns_list_foreach(coap_blockwise_payload_s, removed_payload_ptr, bucket) {
             if (!removed_payload_ptr->token_ptr) {
                 sn_coap_protocol_linked_list_blockwise_payload_remove(handle, removed_payload_ptr);
                 return;
@@ -1497,6 +1586,8 @@ static void sn_coap_protocol_linked_list_blockwise_payload_remove(struct coap_s
                                                                   coap_blockwise_payload_s *removed_payload_ptr)
 {
     ns_list_remove(&handle->linked_list_blockwise_received_payloads, removed_payload_ptr);
+    ns_list_remove(sn_coap_protocol_blockwise_payload_bucket(handle, removed_payload_ptr->token_ptr, removed_payload_ptr->token_len),
+                   removed_payload_ptr);
     /* Free memory of stored payload */
     if (removed_payload_ptr->addr_ptr != NULL) {
         handle->sn_coap_protocol_free(removed_payload_ptr->addr_ptr);
@@ -1530,8 +1621,8 @@ static void sn_coap_protocol_linked_list_blockwise_payload_remove(struct coap_s
 static uint32_t sn_coap_protocol_linked_list_blockwise_payloads_get_len(struct coap_s *handle, sn_nsdl_addr_s *src_addr_ptr, uint8_t *token_ptr, uint8_t token_len)
 {
     uint32_t ret_whole_payload_len = 0;
-    /* Loop all stored blockwise payloads in Linked list */
-    ns_list_foreach(coap_blockwise_payload_s, searched_payload_info_ptr, &handle->linked_list_blockwise_received_payloads) {
+    /* Loop stored blockwise payloads having same Token hash */
+    ns_list_foreach(coap_blockwise_payload_s, searched_payload_info_ptr, sn_coap_protocol_blockwise_payload_bucket(handle, token_ptr, token_len)) {
         /* If payload's Source address and port is same than is searched */
         if ((0 == memcmp(src_addr_ptr->addr_ptr, searched_payload_info_ptr->addr_ptr, src_addr_ptr->addr_len)) && (searched_payload_info_ptr->port == src_addr_ptr->port)) {
             /* Check token */
@@ -1560,39 +1651,43 @@ static uint32_t sn_coap_protocol_linked_list_blockwise_payloads_get_len(struct c
 
 static void sn_coap_protocol_handle_blockwise_timout(struct coap_s *handle)
 {
-    /* Loop all outgoing blockwise messages */
+    /* Messages and payloads are stored in order of timestamp, loops stop at first one not timed out */
+
+    /* Loop outgoing blockwise messages */
     ns_list_foreach_safe(coap_blockwise_msg_s, removed_blocwise_msg_ptr, &handle->linked_list_blockwise_sent_msgs) {
-        if ((handle->system_time - removed_blocwise_msg_ptr->timestamp)  > SN_COAP_BLOCKWISE_MAX_TIME_DATA_STORED) {
-
-            // Item must be removed from the list before calling the rx_callback function.
-            // Callback could actually clear the list and free the item and cause a use after free when callback returns.
-            ns_list_remove(&handle->linked_list_blockwise_sent_msgs, removed_blocwise_msg_ptr);
-
-            /* * * * This messages has timed out, remove it from Linked list * * * */
-            if( removed_blocwise_msg_ptr->coap_msg_ptr ){
-                if (handle->sn_coap_rx_callback) {
-                    /* Notify the application about the time out */
-                    removed_blocwise_msg_ptr->coap_msg_ptr->coap_status = COAP_STATUS_BUILDER_BLOCK_SENDING_FAILED;
-                    removed_blocwise_msg_ptr->coap_msg_ptr->msg_id = removed_blocwise_msg_ptr->msg_id;
-                    sn_coap_protocol_delete_retransmission(handle, removed_blocwise_msg_ptr->msg_id);
-                    handle->sn_coap_rx_callback(removed_blocwise_msg_ptr->coap_msg_ptr, NULL, removed_blocwise_msg_ptr->param);
-                }
+        if ((handle->system_time - removed_blocwise_msg_ptr->timestamp) <= SN_COAP_BLOCKWISE_MAX_TIME_DATA_STORED) {
+            break;
+        }
 
-                handle->sn_coap_protocol_free(removed_blocwise_msg_ptr->coap_msg_ptr->payload_ptr);
-                sn_coap_parser_release_allocated_coap_msg_mem(handle, removed_blocwise_msg_ptr->coap_msg_ptr);
+        // Item must be removed from the list before calling the rx_callback function.
+        // Callback could actually clear the list and free the item and cause a use after free when callback returns.
+        ns_list_remove(&handle->linked_list_blockwise_sent_msgs, removed_blocwise_msg_ptr);
+
+        /* * * * This messages has timed out, remove it from Linked list * * * */
+        if( removed_blocwise_msg_ptr->coap_msg_ptr ){
+            if (handle->sn_coap_rx_callback) {
+                /* Notify the application about the time out */
+                removed_blocwise_msg_ptr->coap_msg_ptr->coap_status = COAP_STATUS_BUILDER_BLOCK_SENDING_FAILED;
+                removed_blocwise_msg_ptr->coap_msg_ptr->msg_id = removed_blocwise_msg_ptr->msg_id;
+                sn_coap_protocol_delete_retransmission(handle, removed_blocwise_msg_ptr->msg_id);
+                handle->sn_coap_rx_callback(removed_blocwise_msg_ptr->coap_msg_ptr, NULL, removed_blocwise_msg_ptr->param);
             }
 
-            handle->sn_coap_protocol_free(removed_blocwise_msg_ptr);
+            handle->sn_coap_protocol_free(removed_blocwise_msg_ptr->coap_msg_ptr->payload_ptr);
+            sn_coap_parser_release_allocated_coap_msg_mem(handle, removed_blocwise_msg_ptr->coap_msg_ptr);
         }
+
+        handle->sn_coap_protocol_free(removed_blocwise_msg_ptr);
     }
 
 
-    /* Loop all incoming Blockwise messages */
+    /* Loop incoming Blockwise messages */
     ns_list_foreach_safe(coap_blockwise_payload_s, removed_blocwise_payload_ptr, &handle->linked_list_blockwise_received_payloads) {
-        if ((handle->system_time - removed_blocwise_payload_ptr->timestamp)  > SN_COAP_BLOCKWISE_MAX_TIME_DATA_STORED) {
-            /* * * * This messages has timed out, remove it from Linked list * * * */
-            sn_coap_protocol_linked_list_blockwise_payload_remove(handle, removed_blocwise_payload_ptr);
+        if ((handle->system_time - removed_blocwise_payload_ptr->timestamp) <= SN_COAP_BLOCKWISE_MAX_TIME_DATA_STORED) {
+            break;
         }
+        /* * * * This messages has timed out, remove it from Linked list * * * */
+        sn_coap_protocol_linked_list_blockwise_payload_remove(handle, removed_blocwise_payload_ptr);
     }
 }
 
@@ -1669,26 +1764,6 @@ static void sn_coap_protocol_release_allocated_send_msg_mem(struct coap_s *handl
     }
 }
 
-/**************************************************************************//**
- * \fn static uint16_t sn_coap_count_linked_list_size(const coap_send_msg_list_t *linked_list_ptr)
- *
- * \brief Counts total message size of all messages in linked list
- *
- * \param const coap_send_msg_list_t *linked_list_ptr pointer to linked list
- *****************************************************************************/
-static uint16_t sn_coap_count_linked_list_size(const coap_send_msg_list_t *linked_list_ptr)
-{
-    uint16_t total_size = 0;
-
-    ns_list_foreach(coap_send_msg_s, stored_msg_ptr, linked_list_ptr) {
-        if (stored_msg_ptr->send_msg_ptr) {
-            total_size += stored_msg_ptr->send_msg_ptr->packet_len;
-        }
-    }
-
-    return total_size;
-}
-
 #endif
 
 #if SN_COAP_BLOCKWISE_ENABLED || SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE
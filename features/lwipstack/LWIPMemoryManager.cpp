@@ -122,7 +122,7 @@ void LWIPMemoryManager::align_memory(struct pbuf *pbuf, uint32_t align)
     struct pbuf *pbuf_start = pbuf;
 
     while (pbuf) {
-        uint32_t remainder = reinterpret_cast<uint32_t>(pbuf->payload) % align;
+        uint32_t remainder = reinterpret_cast<uintptr_t>(pbuf->payload) % align;
         if (remainder) {
             uint32_t offset = align - remainder;
             if (offset >= align) {
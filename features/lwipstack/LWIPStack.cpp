@@ -41,6 +41,10 @@
     #define LWIP_SOCKET_MAX_MEMBERSHIPS 4
 #endif
 
+#if MBED_CONF_LWIP_SOCKET_FAST_PATH && !LWIP_TCPIP_CORE_LOCKING
+    #error "lwip.socket-fast-path requires LWIP_TCPIP_CORE_LOCKING"
+#endif
+
 void LWIP::socket_callback(struct netconn *nc, enum netconn_evt eh, u16_t len)
 {
     // Filter send minus events
@@ -52,11 +56,12 @@ void LWIP::socket_callback(struct netconn *nc, enum netconn_evt eh, u16_t len)
 
     lwip.adaptation.lock();
 
-    for (int i = 0; i < MEMP_NUM_NETCONN; i++) {
-        if (lwip.arena[i].in_use
-            && lwip.arena[i].conn == nc
-            && lwip.arena[i].cb) {
-            lwip.arena[i].cb(lwip.arena[i].data);
+    // Netconns point back to their socket once it owns them
+    struct mbed_lwip_socket *s = (struct mbed_lwip_socket *)netconn_get_callback_arg(nc);
+    if (s && s->in_use) {
+        s->stats.events++;
+        if (s->cb) {
+            s->cb(s->data);
         }
     }
 
@@ -283,7 +288,11 @@ nsapi_error_t LWIP::socket_open(nsapi_socket_t *handle, nsapi_protocol_t proto)
         return NSAPI_ERROR_NO_SOCKET;
     }
 
+    netconn_set_callback_arg(s->conn, s);
     netconn_set_recvtimeout(s->conn, 1);
+#if MBED_CONF_LWIP_SOCKET_FAST_PATH
+    netconn_set_nonblocking(s->conn, true);
+#endif
     *(struct mbed_lwip_socket **)handle = s;
     return 0;
 }
@@ -376,6 +385,7 @@ nsapi_error_t LWIP::socket_accept(nsapi_socket_t server, nsapi_socket_t *handle,
         return err_remap(err);
     }
 
+    netconn_set_callback_arg(ns->conn, ns);
     netconn_set_recvtimeout(ns->conn, 1);
     *(struct mbed_lwip_socket **)handle = ns;
 
@@ -408,6 +418,8 @@ nsapi_size_or_error_t LWIP::socket_send(nsapi_socket_t handle, const void *data,
         return err_remap(err);
     }
 
+    s->stats.bytes_sent += bytes_written;
+
     return (nsapi_size_or_error_t)bytes_written;
 }
 
@@ -426,6 +438,7 @@ nsapi_size_or_error_t LWIP::socket_recv(nsapi_socket_t handle, void *data, nsapi
 
     u16_t recv = netbuf_copy_partial(s->buf, data, (u16_t)size, s->offset);
     s->offset += recv;
+    s->stats.bytes_received += recv;
 
     if (s->offset >= netbuf_len(s->buf)) {
         netbuf_delete(s->buf);
@@ -445,6 +458,12 @@ nsapi_size_or_error_t LWIP::socket_sendto(nsapi_socket_t handle, const SocketAdd
         return NSAPI_ERROR_PARAMETER;
     }
 
+#if MBED_CONF_LWIP_SOCKET_FAST_PATH
+    if (NETCONNTYPE_GROUP(s->conn->type) == NETCONN_UDP) {
+        return socket_sendto_direct(s, &ip_addr, address.get_port(), data, size);
+    }
+#endif
+
     struct netbuf *buf = netbuf_new();
 
     err_t err = netbuf_ref(buf, data, (u16_t)size);
@@ -459,9 +478,49 @@ nsapi_size_or_error_t LWIP::socket_sendto(nsapi_socket_t handle, const SocketAdd
         return err_remap(err);
     }
 
+    s->stats.bytes_sent += size;
+
     return size;
 }
 
+#if MBED_CONF_LWIP_SOCKET_FAST_PATH
+nsapi_size_or_error_t LWIP::socket_sendto_direct(struct mbed_lwip_socket *s, const ip_addr_t *ip_addr, u16_t port, const void *data, nsapi_size_t size)
+{
+    // The largest payload that fits a UDP datagram in an IPv4 packet
+    if (size > 0xFFFF - IP_HLEN - UDP_HLEN) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    // Copy into a single buffer with room for the headers, so the EMAC is
+    // handed one contiguous pbuf rather than a header chained to the data
+    LOCK_TCPIP_CORE();
+
+    if (!s->conn->pcb.udp) {
+        UNLOCK_TCPIP_CORE();
+        return err_remap(ERR_CONN);
+    }
+
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)size, PBUF_RAM);
+    if (!p) {
+        UNLOCK_TCPIP_CORE();
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+    memcpy(p->payload, data, size);
+
+    err_t err = udp_sendto(s->conn->pcb.udp, p, ip_addr, port);
+    pbuf_free(p);
+
+    UNLOCK_TCPIP_CORE();
+
+    if (err != ERR_OK) {
+        return err_remap(err);
+    }
+
+    s->stats.bytes_sent += size;
+    return size;
+}
+#endif
+
 nsapi_size_or_error_t LWIP::socket_recvfrom(nsapi_socket_t handle, SocketAddress *address, void *data, nsapi_size_t size)
 {
     struct mbed_lwip_socket *s = (struct mbed_lwip_socket *)handle;
@@ -480,6 +539,10 @@ nsapi_size_or_error_t LWIP::socket_recvfrom(nsapi_socket_t handle, SocketAddress
     }
 
     u16_t recv = netbuf_copy(buf, data, (u16_t)size);
+    s->stats.bytes_received += recv;
+    if (recv < netbuf_len(buf)) {
+        s->stats.drops++;
+    }
     netbuf_delete(buf);
 
     return recv;
@@ -650,7 +713,25 @@ nsapi_error_t LWIP::setsockopt(nsapi_socket_t handle, int level, int optname, co
 
 nsapi_error_t LWIP::getsockopt(nsapi_socket_t handle, int level, int optname, void *optval, unsigned *optlen)
 {
-    return NSAPI_ERROR_UNSUPPORTED;
+    struct mbed_lwip_socket *s = (struct mbed_lwip_socket *)handle;
+
+    switch (optname) {
+        case NSAPI_SOCKET_STATS:
+            if (*optlen < sizeof(nsapi_socket_stats_t)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+
+            // Events are counted from the tcpip thread
+            adaptation.lock();
+            memcpy(optval, &s->stats, sizeof(nsapi_socket_stats_t));
+            adaptation.unlock();
+
+            *optlen = sizeof(nsapi_socket_stats_t);
+            return 0;
+
+        default:
+            return NSAPI_ERROR_UNSUPPORTED;
+    }
 }
 
 
@@ -462,6 +462,8 @@ private:
         void (*cb)(void *);
         void *data;
 
+        nsapi_socket_stats_t stats;
+
         // Track multicast addresses subscribed to by this socket
         nsapi_ip_mreq_t *multicast_memberships;
         uint32_t         multicast_memberships_count;
@@ -508,6 +510,11 @@ private:
 
     static void socket_callback(struct netconn *nc, enum netconn_evt eh, u16_t len);
 
+#if MBED_CONF_LWIP_SOCKET_FAST_PATH
+    nsapi_size_or_error_t socket_sendto_direct(struct mbed_lwip_socket *s, const ip_addr_t *ip_addr, u16_t port,
+                                               const void *data, nsapi_size_t size);
+#endif
+
     static void tcpip_init_irq(void *handle);
     static void tcpip_thread_callback(void *ptr);
 
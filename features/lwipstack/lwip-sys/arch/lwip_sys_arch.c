@@ -151,6 +151,7 @@ err_t sys_mbox_new(sys_mbox_t *mbox, int queue_sz) {
 void sys_mbox_free(sys_mbox_t *mbox) {
     if (mbox->post_idx != mbox->fetch_idx)
         MBED_ERROR1(MBED_MAKE_ERROR(MBED_MODULE_NETWORK_STACK, MBED_ERROR_CODE_INVALID_INDEX), "sys_mbox_free error\n", (u32_t)mbox->fetch_idx);
+    osEventFlagsDelete(mbox->id);
 }
 
 /*---------------------------------------------------------------------------*
@@ -375,7 +376,9 @@ void sys_sem_signal(sys_sem_t *data) {
  * Inputs:
  *      sys_sem_t sem           -- Semaphore to free
  *---------------------------------------------------------------------------*/
-void sys_sem_free(sys_sem_t *sem) {}
+void sys_sem_free(sys_sem_t *sem) {
+    osSemaphoreDelete(sem->id);
+}
 
 /** Create a new mutex
  * @param mutex pointer to the mutex to create
@@ -410,7 +413,9 @@ void sys_mutex_unlock(sys_mutex_t *mutex) {
 
 /** Delete a mutex
  * @param mutex the mutex to delete */
-void sys_mutex_free(sys_mutex_t *mutex) {}
+void sys_mutex_free(sys_mutex_t *mutex) {
+    osMutexDelete(mutex->id);
+}
 
 /*---------------------------------------------------------------------------*
  * Routine:  sys_init
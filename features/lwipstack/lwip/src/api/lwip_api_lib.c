@@ -523,21 +523,39 @@ netconn_recv_data(struct netconn *conn, void **new_buf)
   }
 #endif /* LWIP_TCP */
 
-#if LWIP_SO_RCVTIMEO
-  if (sys_arch_mbox_fetch(&conn->recvmbox, &buf, conn->recv_timeout) == SYS_ARCH_TIMEOUT) {
+#if MBED_CONF_LWIP_SOCKET_FAST_PATH
+  if (netconn_is_nonblocking(conn)) {
+    /* non-blocking netconns return at once when nothing has been received */
+    if (sys_arch_mbox_tryfetch(&conn->recvmbox, &buf) == SYS_MBOX_EMPTY) {
 #if LWIP_TCP
 #if (LWIP_UDP || LWIP_RAW)
-    if (NETCONNTYPE_GROUP(conn->type) == NETCONN_TCP)
+      if (NETCONNTYPE_GROUP(conn->type) == NETCONN_TCP)
 #endif /* (LWIP_UDP || LWIP_RAW) */
-    {
-      API_MSG_VAR_FREE(msg);
+      {
+        API_MSG_VAR_FREE(msg);
+      }
+#endif /* LWIP_TCP */
+      return ERR_WOULDBLOCK;
     }
+  } else
+#endif /* MBED_CONF_LWIP_SOCKET_FAST_PATH */
+  {
+#if LWIP_SO_RCVTIMEO
+    if (sys_arch_mbox_fetch(&conn->recvmbox, &buf, conn->recv_timeout) == SYS_ARCH_TIMEOUT) {
+#if LWIP_TCP
+#if (LWIP_UDP || LWIP_RAW)
+      if (NETCONNTYPE_GROUP(conn->type) == NETCONN_TCP)
+#endif /* (LWIP_UDP || LWIP_RAW) */
+      {
+        API_MSG_VAR_FREE(msg);
+      }
 #endif /* LWIP_TCP */
-    return ERR_TIMEOUT;
-  }
+      return ERR_TIMEOUT;
+    }
 #else
-  sys_arch_mbox_fetch(&conn->recvmbox, &buf, 0);
+    sys_arch_mbox_fetch(&conn->recvmbox, &buf, 0);
 #endif /* LWIP_SO_RCVTIMEO*/
+  }
 
 #if LWIP_TCP
 #if (LWIP_UDP || LWIP_RAW)
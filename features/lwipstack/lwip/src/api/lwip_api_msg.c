@@ -694,6 +694,7 @@ netconn_alloc(enum netconn_type t, netconn_callback callback)
   conn->socket       = -1;
 #endif /* LWIP_SOCKET */
   conn->callback     = callback;
+  conn->callback_arg = NULL;
 #if LWIP_TCP
   conn->current_msg  = NULL;
   conn->write_offset = 0;
@@ -268,6 +268,8 @@ struct netconn {
 #endif /* LWIP_TCP */
   /** A callback function that is informed about events for this netconn */
   netconn_callback callback;
+  /** User data for the callback, not used by the netconn API itself */
+  void *callback_arg;
 };
 
 /** Register an Network connection event */
@@ -370,6 +372,11 @@ err_t   netconn_gethostbyname(const char *name, ip_addr_t *addr);
 /** Get the send timeout in milliseconds */
 #define netconn_get_sendtimeout(conn)               ((conn)->send_timeout)
 #endif /* LWIP_SO_SNDTIMEO */
+/** Set the user data passed along with the netconn to its callback */
+#define netconn_set_callback_arg(conn, arg)         ((conn)->callback_arg = (arg))
+/** Get the user data passed along with the netconn to its callback */
+#define netconn_get_callback_arg(conn)              ((conn)->callback_arg)
+
 #if LWIP_SO_RCVTIMEO
 /** Set the receive timeout in milliseconds */
 #define netconn_set_recvtimeout(conn, timeout)      ((conn)->recv_timeout = (timeout))
@@ -84,6 +84,9 @@
 
 #define LWIP_RAW                    0
 
+// API calls run under the core lock instead of being posted to the tcpip thread
+#define LWIP_TCPIP_CORE_LOCKING     1
+
 #define TCPIP_MBOX_SIZE             8
 #define DEFAULT_TCP_RECVMBOX_SIZE   8
 #define DEFAULT_UDP_RECVMBOX_SIZE   8
@@ -134,8 +137,12 @@
 
 #endif
 
-// 32-bit alignment
+// Pointer alignment: 32-bit on targets, 64-bit on host builds
+#if defined(__SIZEOF_POINTER__) && (__SIZEOF_POINTER__ == 8)
+#define MEM_ALIGNMENT               8
+#else
 #define MEM_ALIGNMENT               4
+#endif
 
 #define LWIP_RAM_HEAP_POINTER       lwip_ram_heap
 
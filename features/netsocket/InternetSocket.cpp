@@ -78,7 +78,9 @@ nsapi_error_t InternetSocket::close()
     _lock.unlock();
 
     // When allocated by accept() call, will self desctruct on close();
+    // the destructor closes again, so it must not come back here
     if (_factory_allocated) {
+        _factory_allocated = false;
         delete this;
     }
     return ret;
@@ -347,7 +347,7 @@ static void nsapi_dns_cache_add(const char *host, nsapi_addr_t *address, uint32_
     if (!dns_cache[index]) {
         dns_cache[index] = new (std::nothrow) DNS_CACHE;
     } else {
-        delete dns_cache[index]->host;
+        delete[] dns_cache[index]->host;
     }
 
     if (dns_cache[index]) {
@@ -375,7 +375,7 @@ static nsapi_error_t nsapi_dns_cache_find(const char *host, nsapi_version_t vers
             uint64_t ms_count = rtos::Kernel::get_ms_count();
             // Checks all entries for expired entries
             if (ms_count > dns_cache[i]->expires) {
-                delete dns_cache[i]->host;
+                delete[] dns_cache[i]->host;
                 delete dns_cache[i];
                 dns_cache[i] = NULL;
             } else if ((version == NSAPI_UNSPEC || version == dns_cache[i]->address.version) &&
@@ -697,7 +697,7 @@ nsapi_value_or_error_t nsapi_dns_query_multiple_async(NetworkStack *stack, const
 
     if (!dns_timer_running) {
         if (nsapi_dns_call_in(query->call_in_cb, DNS_TIMER_TIMEOUT, mbed::callback(nsapi_dns_query_async_timeout)) != NSAPI_ERROR_OK) {
-            delete query->host;
+            delete[] query->host;
             delete query;
             dns_mutex->unlock();
             return NSAPI_ERROR_NO_MEMORY;
@@ -824,7 +824,7 @@ static void nsapi_dns_query_async_create(void *ptr)
 {
     dns_mutex->lock();
 
-    int unique_id = reinterpret_cast<int>(ptr);
+    int unique_id = static_cast<int>(reinterpret_cast<intptr_t>(ptr));
 
     DNS_QUERY *query = NULL;
 
@@ -923,7 +923,7 @@ static nsapi_error_t nsapi_dns_query_async_delete(int unique_id)
         delete[] query->addrs;
     }
 
-    delete query->host;
+    delete[] query->host;
     delete query;
     dns_query_queue[index] = NULL;
 
@@ -947,7 +947,7 @@ static void nsapi_dns_query_async_send(void *ptr)
 {
     dns_mutex->lock();
 
-    int unique_id = reinterpret_cast<int>(ptr);
+    int unique_id = static_cast<int>(reinterpret_cast<intptr_t>(ptr));
 
     DNS_QUERY *query = NULL;
 
@@ -1102,7 +1102,7 @@ static void nsapi_dns_query_async_response(void *ptr)
 {
     dns_mutex->lock();
 
-    int unique_id = reinterpret_cast<int>(ptr);
+    int unique_id = static_cast<int>(reinterpret_cast<intptr_t>(ptr));
 
     DNS_QUERY *query = NULL;
 
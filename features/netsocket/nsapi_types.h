@@ -254,6 +254,7 @@ typedef enum nsapi_socket_option {
     NSAPI_RCVBUF,            /*!< Sets recv buffer size */
     NSAPI_ADD_MEMBERSHIP,    /*!< Add membership to multicast address */
     NSAPI_DROP_MEMBERSHIP,   /*!< Drop membership to multicast address */
+    NSAPI_SOCKET_STATS,      /*!< Gets event and traffic counters of the socket, see nsapi_socket_stats_t */
 } nsapi_socket_option_t;
 
 /** Supported IP protocol versions of IP stack
@@ -312,6 +313,18 @@ typedef struct nsapi_ip_mreq {
     nsapi_addr_t imr_interface; /* local IP address of interface */
 } nsapi_ip_mreq_t;
 
+/** nsapi_socket_stats structure
+ *
+ *  Counters of a socket, read with the NSAPI_SOCKET_STATS socket option.
+ *  They start from zero when the socket is opened.
+ */
+typedef struct nsapi_socket_stats {
+    uint32_t events;         /* stack events raised on the socket */
+    uint32_t bytes_sent;     /* bytes accepted by send and sendto */
+    uint32_t bytes_received; /* bytes returned by recv and recvfrom */
+    uint32_t drops;          /* received datagrams truncated to fit the buffer */
+} nsapi_socket_stats_t;
+
 /** nsapi_stack_api structure
  *
  *  Common api structure for network stack operations. A network stack
@@ -63,6 +63,9 @@ void nfc_tech_iso7816_init(nfc_tech_iso7816_t *pIso7816, nfc_transceiver_t *pTra
     ac_buffer_builder_init(&pIso7816->txBldr, pIso7816->txBuf, 2); //Just enough to fit sw
 
     ac_buffer_builder_init(&pIso7816->rxBldr, pIso7816->rxBuf, ISO7816_RX_BUFFER_SIZE);
+    pIso7816->rxOverflow = false;
+    ac_buffer_init(&pIso7816->rxBlock, NULL, 0);
+    pIso7816->pRx = ac_buffer_builder_buffer(&pIso7816->rxBldr);
 
     pIso7816->pUserData = pUserData;
 }
@@ -131,26 +134,35 @@ nfc_err_t iso7816_parse(nfc_tech_iso7816_t *pIso7816)
     ac_buffer_init(&pIso7816->rApdu.dataOut, NULL, 0);
     pIso7816->rApdu.sw = ISO7816_SW_OK;
 
-    NFC_DBG_BLOCK(ac_buffer_dump(ac_buffer_builder_buffer(&pIso7816->rxBldr));)
+    ac_buffer_t *pRx = pIso7816->pRx;
 
-    if (ac_buffer_reader_readable(ac_buffer_builder_buffer(&pIso7816->rxBldr)) < 4) {
+    NFC_DBG_BLOCK(ac_buffer_dump(pRx);)
+
+    if (pIso7816->rxOverflow) {
+        NFC_ERR("C-APDU is too large");
+        pIso7816->rApdu.sw = ISO7816_SW_WRONG_LENGTH;
+        nfc_tech_iso7816_reply(pIso7816);
+        return NFC_ERR_BUFFER_TOO_SMALL;
+    }
+
+    if (ac_buffer_reader_readable(pRx) < 4) {
         NFC_ERR("C-APDU is too small");
         pIso7816->rApdu.sw = ISO7816_SW_INVALID_CLASS;
         nfc_tech_iso7816_reply(pIso7816);
         return NFC_ERR_PROTOCOL;
     }
 
-    pIso7816->cApdu.cla = ac_buffer_read_nu8(ac_buffer_builder_buffer(&pIso7816->rxBldr));
-    pIso7816->cApdu.ins = ac_buffer_read_nu8(ac_buffer_builder_buffer(&pIso7816->rxBldr));
-    pIso7816->cApdu.p1 = ac_buffer_read_nu8(ac_buffer_builder_buffer(&pIso7816->rxBldr));
-    pIso7816->cApdu.p2 = ac_buffer_read_nu8(ac_buffer_builder_buffer(&pIso7816->rxBldr));
+    pIso7816->cApdu.cla = ac_buffer_read_nu8(pRx);
+    pIso7816->cApdu.ins = ac_buffer_read_nu8(pRx);
+    pIso7816->cApdu.p1 = ac_buffer_read_nu8(pRx);
+    pIso7816->cApdu.p2 = ac_buffer_read_nu8(pRx);
     ac_buffer_init(&pIso7816->cApdu.dataIn, NULL, 0);
     pIso7816->cApdu.maxRespLength = 0;
 
-    if (ac_buffer_reader_readable(ac_buffer_builder_buffer(&pIso7816->rxBldr)) > 1) {
-        size_t lc = ac_buffer_read_nu8(ac_buffer_builder_buffer(&pIso7816->rxBldr));
-        if (ac_buffer_reader_readable(ac_buffer_builder_buffer(&pIso7816->rxBldr)) >= lc) {
-            ac_buffer_split(&pIso7816->cApdu.dataIn, ac_buffer_builder_buffer(&pIso7816->rxBldr), ac_buffer_builder_buffer(&pIso7816->rxBldr), lc);
+    if (ac_buffer_reader_readable(pRx) > 1) {
+        size_t lc = ac_buffer_read_nu8(pRx);
+        if (ac_buffer_reader_readable(pRx) >= lc) {
+            ac_buffer_split(&pIso7816->cApdu.dataIn, pRx, pRx, lc);
         } else {
             pIso7816->rApdu.sw = ISO7816_SW_WRONG_LENGTH;
             nfc_tech_iso7816_reply(pIso7816);
@@ -158,14 +170,14 @@ nfc_err_t iso7816_parse(nfc_tech_iso7816_t *pIso7816)
         }
     }
 
-    if (ac_buffer_reader_readable(ac_buffer_builder_buffer(&pIso7816->rxBldr)) >= 1) {
-        pIso7816->cApdu.maxRespLength = ac_buffer_read_nu8(ac_buffer_builder_buffer(&pIso7816->rxBldr));
+    if (ac_buffer_reader_readable(pRx) >= 1) {
+        pIso7816->cApdu.maxRespLength = ac_buffer_read_nu8(pRx);
     }
 
     NFC_DBG("C-APDU: CLA:%02X INS:%02X P1:%02X P2:%02X LC:%02X LE:%02X", pIso7816->cApdu.cla, pIso7816->cApdu.ins, pIso7816->cApdu.p1, pIso7816->cApdu.p2,
             ac_buffer_reader_readable(&pIso7816->cApdu.dataIn), pIso7816->cApdu.maxRespLength);
 
-    if (ac_buffer_reader_readable(ac_buffer_builder_buffer(&pIso7816->rxBldr)) > 0) {
+    if (ac_buffer_reader_readable(pRx) > 0) {
         pIso7816->rApdu.sw = ISO7816_SW_WRONG_LENGTH;
         nfc_tech_iso7816_reply(pIso7816);
         return NFC_ERR_LENGTH; //Not a valid frame
@@ -192,6 +204,8 @@ nfc_err_t iso7816_parse(nfc_tech_iso7816_t *pIso7816)
 void iso7816_receive(nfc_tech_iso7816_t *pIso7816)
 {
     ac_buffer_builder_reset(&pIso7816->rxBldr);
+    pIso7816->rxOverflow = false;
+    pIso7816->pRx = ac_buffer_builder_buffer(&pIso7816->rxBldr);
     nfc_tech_isodep_target_receive(&pIso7816->isoDepTarget, &pIso7816->outputStream, iso_dep_received_cb, pIso7816);
 }
 
@@ -331,13 +345,20 @@ void iso_dep_stream_receive_cb(ac_buffer_t *pDataOut, bool closed, void *pUserPa
 {
     nfc_tech_iso7816_t *pIso7816 = (nfc_tech_iso7816_t *) pUserParam;
 
-    (void) closed;
+    if (closed && ac_buffer_builder_empty(&pIso7816->rxBldr)) {
+        //Unchained C-APDU: parse it where the transceiver received it, its buffer is not reused before the R-APDU is sent
+        ac_buffer_dup(&pIso7816->rxBlock, pDataOut);
+        pIso7816->pRx = &pIso7816->rxBlock;
+        return;
+    }
 
     if (ac_buffer_reader_readable(pDataOut) > ac_buffer_builder_writable(&pIso7816->rxBldr)) {
         NFC_ERR("Frame will not fit (%u > %u)", ac_buffer_reader_readable(pDataOut), ac_buffer_builder_writable(&pIso7816->rxBldr));
+        pIso7816->rxOverflow = true;
+        return;
     }
 
-    //Feed rx buffer
+    //Feed rx buffer with the next block of a chain
     ac_buffer_builder_copy_n_bytes(&pIso7816->rxBldr, pDataOut, ac_buffer_reader_readable(pDataOut));
 }
 
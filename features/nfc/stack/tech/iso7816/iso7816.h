@@ -83,9 +83,16 @@ struct nfc_tech_iso7816 {
     uint8_t txBuf[2];
     ac_buffer_builder_t txBldr;
 
-    //Receive buffer
+    //Receive buffer, gathers C-APDUs chained over several I-blocks
     uint8_t rxBuf[ISO7816_RX_BUFFER_SIZE];
     ac_buffer_builder_t rxBldr;
+    bool rxOverflow;
+
+    //C-APDU received in a single I-block, parsed in place from the transceiver buffer
+    ac_buffer_t rxBlock;
+
+    //C-APDU being parsed, either rxBlock or the receive buffer
+    ac_buffer_t *pRx;
 };
 
 void nfc_tech_iso7816_init(nfc_tech_iso7816_t *pIso7816, nfc_transceiver_t *pTransceiver, nfc_tech_iso7816_disconnected_cb disconnectedCb, void *pUserData);
@@ -199,6 +199,11 @@ bool dep_ready(nfc_tech_isodep_target_t *pIsodepTarget)
         return true;
     }
 
+    //Acknowledge chained block so that the initiator sends the next one
+    if (pIsodepTarget->dep.chaining) {
+        return true;
+    }
+
     if ((pIsodepTarget->dep.pResStream != NULL)) {
         return true;
     } else {
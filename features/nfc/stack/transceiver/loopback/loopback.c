@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) 2018, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * \file loopback.c
+ * \copyright Copyright (c) ARM Ltd 2018
+ * \details Loopback implementation of the transceiver interface
+ */
+
+#define __DEBUG__ 0
+#ifndef __MODULE__
+#define __MODULE__ "loopback.c"
+#endif
+#include "stack/nfc_errors.h"
+
+#include "acore/ac_buffer.h"
+
+#include "transceiver/transceiver.h"
+#include "transceiver/transceiver_internal.h"
+
+#include "loopback.h"
+
+//Bits on air for a frame of n bytes: odd parity bit per byte, CRC_A, start and end of communication
+#define FRAME_BITS(n) ((((n) + 2) * 9) + 2)
+//Minimum frame delay time between a frame and its answer, ~1236/fc
+#define FRAME_DELAY_US 91
+
+static void loopback_set_protocols(nfc_transceiver_t *pTransceiver, nfc_tech_t initiators, nfc_tech_t targets, polling_options_t options);
+static void loopback_poll(nfc_transceiver_t *pTransceiver);
+static void loopback_set_crc(nfc_transceiver_t *pTransceiver, bool crc_out, bool crc_in);
+static void loopback_set_timeout(nfc_transceiver_t *pTransceiver, int timeout);
+static void loopback_set_transceive_options(nfc_transceiver_t *pTransceiver, bool transmit, bool receive, bool repoll);
+static void loopback_set_transceive_framing(nfc_transceiver_t *pTransceiver, nfc_framing_t framing);
+static void loopback_set_write(nfc_transceiver_t *pTransceiver, ac_buffer_t *pWriteBuf);
+static ac_buffer_t *loopback_get_read(nfc_transceiver_t *pTransceiver);
+static void loopback_set_last_byte_length(nfc_transceiver_t *pTransceiver, size_t lastByteLength);
+static size_t loopback_get_last_byte_length(nfc_transceiver_t *pTransceiver);
+static void loopback_set_first_byte_align(nfc_transceiver_t *pTransceiver, size_t firstByteAlign);
+static void loopback_transceive(nfc_transceiver_t *pTransceiver);
+static void loopback_abort(nfc_transceiver_t *pTransceiver);
+static void loopback_close(nfc_transceiver_t *pTransceiver);
+static void loopback_sleep(nfc_transceiver_t *pTransceiver, bool sleep);
+
+static void loopback_wait(loopback_t *pLoopback);
+static void loopback_complete(loopback_t *pLoopback, nfc_err_t ret);
+static void loopback_deliver(loopback_t *pLoopback, const ac_buffer_t *pFrame, size_t length);
+static void loopback_task(uint32_t events, void *pUserData);
+
+/** \addtogroup Loopback
+ *  @{
+ *  \name Transceiver
+ *  \details Implementation of the transceiver interface exchanging frames in memory, to exercise the stack without hardware
+ *  @{
+ */
+
+//Loopback VTABLE
+
+static const transceiver_impl_t loopback_impl = {
+    .set_protocols = loopback_set_protocols,
+    .poll = loopback_poll,
+    .transceive = loopback_transceive,
+    .abort = loopback_abort,
+    .set_crc = loopback_set_crc,
+    .set_timeout = loopback_set_timeout,
+    .set_transceive_options = loopback_set_transceive_options,
+    .set_transceive_framing = loopback_set_transceive_framing,
+    .set_write = loopback_set_write,
+    .get_read = loopback_get_read,
+    .set_last_byte_length = loopback_set_last_byte_length,
+    .get_last_byte_length = loopback_get_last_byte_length,
+    .set_first_byte_align = loopback_set_first_byte_align,
+    .close = loopback_close,
+    .sleep = loopback_sleep
+};
+
+/** Initialize loopback transceiver
+ * \param pLoopback pointer to loopback_t structure to initialize
+ * \param pTimer pointer to the timer of the scheduler
+ * \param bitrate simulated bit rate on air in bit/s, used to account the air time of frames
+ * \param frameSize longest frame that can be exchanged, up to LOOPBACK_FRAME_SIZE_MAX bytes
+ * \return NFC_OK (0) on success or NFC_ERR_* error on failure
+ */
+nfc_err_t loopback_init(loopback_t *pLoopback, nfc_scheduler_timer_t *pTimer, uint32_t bitrate, size_t frameSize)
+{
+    if ((bitrate == 0) || (frameSize == 0) || (frameSize > LOOPBACK_FRAME_SIZE_MAX)) {
+        return NFC_ERR_PARAMS;
+    }
+
+    //Init transceiver
+    transceiver_init((nfc_transceiver_t *)pLoopback, NULL, pTimer);
+    pLoopback->transceiver.fn = &loopback_impl;
+    pLoopback->transceiver.initiator_ntarget = false;
+    pLoopback->transceiver.remote_targets_count = 0;
+    memset(&pLoopback->transceiver.active_tech, 0, sizeof(nfc_tech_t));
+    task_init(&pLoopback->transceiver.task, 0, 0, loopback_task, pLoopback);
+
+    pLoopback->pPeer = NULL;
+    pLoopback->bitrate = bitrate;
+    pLoopback->frameSize = frameSize;
+    pLoopback->timeout = -1;
+
+    memset(&pLoopback->config.initiators, 0, sizeof(nfc_tech_t));
+    memset(&pLoopback->config.targets, 0, sizeof(nfc_tech_t));
+
+    pLoopback->transmit = true;
+    pLoopback->receive = true;
+    pLoopback->repoll = false;
+
+    pLoopback->polling = false;
+    pLoopback->waiting = false;
+    pLoopback->frameReceived = false;
+
+    ac_buffer_builder_init(&pLoopback->readBufBldr, pLoopback->payload, frameSize);
+    ac_buffer_init(&pLoopback->writeBuf, NULL, 0);
+
+    pLoopback->result = NFC_OK;
+
+    pLoopback->irqCb = NULL;
+    pLoopback->pIrqUserData = NULL;
+
+    pLoopback->stats.frames = 0;
+    pLoopback->stats.bytes = 0;
+    pLoopback->stats.airTimeUs = 0;
+
+    return NFC_OK;
+}
+
+/** Connect two loopback transceivers, one being configured as initiator and the other one as target
+ * \param pLoopback1 pointer to first loopback_t instance
+ * \param pLoopback2 pointer to second loopback_t instance
+ */
+void loopback_pair(loopback_t *pLoopback1, loopback_t *pLoopback2)
+{
+    pLoopback1->pPeer = pLoopback2;
+    pLoopback2->pPeer = pLoopback1;
+}
+
+/** Set the function called in place of the interrupt line of a controller; it must run the scheduler with EVENT_HW_INTERRUPT
+ * \param pLoopback pointer to loopback_t instance
+ * \param cb callback, called from the context of the peer or of the caller of the transceiver
+ * \param pUserData parameter passed to the callback
+ */
+void loopback_set_irq_callback(loopback_t *pLoopback, loopback_irq_cb_t cb, void *pUserData)
+{
+    pLoopback->irqCb = cb;
+    pLoopback->pIrqUserData = pUserData;
+}
+
+/** Get pointer to nfc_transceiver_t structure
+ * \param pLoopback pointer to loopback_t instance
+ * \return pointer to initialized nfc_transceiver_t instance
+ */
+nfc_transceiver_t *loopback_get_transceiver(loopback_t *pLoopback)
+{
+    return &pLoopback->transceiver;
+}
+
+void loopback_set_protocols(nfc_transceiver_t *pTransceiver, nfc_tech_t initiators, nfc_tech_t targets, polling_options_t options)
+{
+    loopback_t *pLoopback = (loopback_t *) pTransceiver;
+    nfc_tech_t none;
+    memset(&none, 0, sizeof(nfc_tech_t));
+
+    (void) options;
+
+    pLoopback->config.initiators = initiators;
+    pLoopback->config.targets = targets;
+    pTransceiver->initiator_ntarget = (memcmp(&initiators, &none, sizeof(nfc_tech_t)) != 0);
+    memset(&pTransceiver->active_tech, 0, sizeof(nfc_tech_t));
+}
+
+void loopback_poll(nfc_transceiver_t *pTransceiver)
+{
+    loopback_t *pLoopback = (loopback_t *) pTransceiver;
+    loopback_t *pPeer = pLoopback->pPeer;
+
+    pLoopback->transmit = true;
+    pLoopback->receive = true;
+    pLoopback->repoll = false;
+
+    if (!pTransceiver->initiator_ntarget) {
+        //Listen until the initiator sends its first frame
+        pLoopback->frameReceived = false;
+        pLoopback->polling = true;
+        loopback_wait(pLoopback);
+        return;
+    }
+
+    if ((pPeer == NULL) || !pPeer->polling) {
+        loopback_complete(pLoopback, NFC_ERR_NOPEER);
+        return;
+    }
+
+    //The peer is listening, it is found at once
+    memset(&pTransceiver->remote_targets[0], 0, sizeof(nfc_info_t));
+    pTransceiver->remote_targets[0].type = pPeer->config.targets;
+    pTransceiver->remote_targets_count = 1;
+    pTransceiver->active_tech = pPeer->config.targets;
+    loopback_complete(pLoopback, NFC_OK);
+}
+
+void loopback_set_crc(nfc_transceiver_t *pTransceiver, bool crc_out, bool crc_in)
+{
+    //Frames are never corrupted
+    (void) pTransceiver;
+    (void) crc_out;
+    (void) crc_in;
+}
+
+void loopback_set_timeout(nfc_transceiver_t *pTransceiver, int timeout)
+{
+    loopback_t *pLoopback = (loopback_t *) pTransceiver;
+    pLoopback->timeout = timeout;
+}
+
+void loopback_set_transceive_options(nfc_transceiver_t *pTransceiver, bool transmit, bool receive, bool repoll)
+{
+    loopback_t *pLoopback = (loopback_t *) pTransceiver;
+    pLoopback->transmit = transmit;
+    pLoopback->receive = receive;
+    pLoopback->repoll = repoll;
+}
+
+void loopback_set_transceive_framing(nfc_transceiver_t *pTransceiver, nfc_framing_t framing)
+{
+    (void) pTransceiver;
+    (void) framing;
+}
+
+void loopback_set_write(nfc_transceiver_t *pTransceiver, ac_buffer_t *pWriteBuf)
+{
+    loopback_t *pLoopback = (loopback_t *) pTransceiver;
+    if (pWriteBuf == NULL) {
+        ac_buffer_init(&pLoopback->writeBuf, NULL, 0);
+        return;
+    }
+    ac_buffer_dup(&pLoopback->writeBuf, pWriteBuf);
+}
+
+ac_buffer_t *loopback_get_read(nfc_transceiver_t *pTransceiver)
+{
+    loopback_t *pLoopback = (loopback_t *) pTransceiver;
+    return ac_buffer_builder_buffer(&pLoopback->readBufBldr);
+}
+
+void loopback_set_last_byte_length(nfc_transceiver_t *pTransceiver, size_t lastByteLength)
+{
+    //Only whole bytes are exchanged
+    (void) pTransceiver;
+    (void) lastByteLength;
+}
+
+size_t loopback_get_last_byte_length(nfc_transceiver_t *pTransceiver)
+{
+    (void) pTransceiver;
+    return 8;
+}
+
+void loopback_set_first_byte_align(nfc_transceiver_t *pTransceiver, size_t firstByteAlign)
+{
+    (void) pTransceiver;
+    (void) firstByteAlign;
+}
+
+void loopback_transceive(nfc_transceiver_t *pTransceiver)
+{
+    loopback_t *pLoopback = (loopback_t *) pTransceiver;
+    loopback_t *pPeer = pLoopback->pPeer;
+
+    bool transmit = pLoopback->transmit;
+    bool receive = pLoopback->receive || pLoopback->repoll;
+    bool repoll = pLoopback->repoll;
+
+    //Reset options for next frame
+    pLoopback->transmit = true;
+    pLoopback->receive = true;
+    pLoopback->repoll = false;
+
+    size_t length = ac_buffer_reader_readable(&pLoopback->writeBuf);
+    if (transmit && (length > 0)) {
+        if (pPeer == NULL) {
+            loopback_complete(pLoopback, NFC_ERR_NOPEER);
+            return;
+        }
+        if (length > pPeer->frameSize) {
+            NFC_ERR("Frame too long (%u bytes)", length);
+            loopback_complete(pLoopback, NFC_ERR_BUFFER_TOO_SMALL);
+            return;
+        }
+
+        //The answer to this frame is the next frame from the peer
+        pLoopback->frameReceived = false;
+        pLoopback->polling = repoll;
+
+        pLoopback->stats.frames++;
+        pLoopback->stats.bytes += length;
+        pLoopback->stats.airTimeUs += ((uint64_t)FRAME_BITS(length) * 1000000) / pLoopback->bitrate + FRAME_DELAY_US;
+
+        loopback_deliver(pPeer, &pLoopback->writeBuf, length);
+    }
+
+    if (!receive) {
+        loopback_complete(pLoopback, NFC_OK);
+        return;
+    }
+
+    if (pLoopback->frameReceived) {
+        //Frame was received before this call
+        loopback_complete(pLoopback, NFC_OK);
+        return;
+    }
+
+    loopback_wait(pLoopback);
+}
+
+void loopback_abort(nfc_transceiver_t *pTransceiver)
+{
+    loopback_t *pLoopback = (loopback_t *) pTransceiver;
+    nfc_scheduler_dequeue_task(&pTransceiver->scheduler, true, &pLoopback->transceiver.task);
+}
+
+void loopback_close(nfc_transceiver_t *pTransceiver)
+{
+    loopback_t *pLoopback = (loopback_t *) pTransceiver;
+    nfc_scheduler_dequeue_task(&pTransceiver->scheduler, false, &pLoopback->transceiver.task);
+    pLoopback->polling = false;
+    pLoopback->waiting = false;
+}
+
+void loopback_sleep(nfc_transceiver_t *pTransceiver, bool sleep)
+{
+    (void) pTransceiver;
+    (void) sleep;
+}
+
+/** Wait for the next frame of the peer
+ * \param pLoopback pointer to loopback_t instance
+ */
+void loopback_wait(loopback_t *pLoopback)
+{
+    nfc_scheduler_t *pScheduler = &pLoopback->transceiver.scheduler;
+    nfc_task_t *pTask = &pLoopback->transceiver.task;
+
+    pLoopback->waiting = true;
+
+    nfc_scheduler_dequeue_task(pScheduler, false, pTask);
+    if (pLoopback->timeout >= 0) {
+        task_init(pTask, EVENT_HW_INTERRUPT | EVENT_TIMEOUT, pLoopback->timeout, loopback_task, pLoopback);
+    } else {
+        task_init(pTask, EVENT_HW_INTERRUPT, 0, loopback_task, pLoopback);
+    }
+    nfc_scheduler_queue_task(pScheduler, pTask);
+}
+
+/** Report the result of the operation in progress and raise the emulated interrupt
+ * \param pLoopback pointer to loopback_t instance
+ * \param ret result passed to the upper layer
+ */
+void loopback_complete(loopback_t *pLoopback, nfc_err_t ret)
+{
+    nfc_scheduler_t *pScheduler = &pLoopback->transceiver.scheduler;
+    nfc_task_t *pTask = &pLoopback->transceiver.task;
+
+    pLoopback->waiting = false;
+    pLoopback->result = ret;
+
+    nfc_scheduler_dequeue_task(pScheduler, false, pTask);
+    task_init(pTask, EVENT_HW_INTERRUPT, 0, loopback_task, pLoopback);
+    nfc_scheduler_queue_task(pScheduler, pTask);
+
+    if (pLoopback->irqCb != NULL) {
+        pLoopback->irqCb(pLoopback, pLoopback->pIrqUserData);
+    }
+}
+
+/** Put a frame sent by the peer into the incoming buffer
+ * \param pLoopback pointer to loopback_t instance receiving the frame
+ * \param pFrame frame, left untouched
+ * \param length length of the frame
+ */
+void loopback_deliver(loopback_t *pLoopback, const ac_buffer_t *pFrame, size_t length)
+{
+    ac_buffer_t frame;
+    ac_buffer_dup(&frame, pFrame);
+
+    ac_buffer_builder_reset(&pLoopback->readBufBldr);
+    ac_buffer_builder_copy_n_bytes(&pLoopback->readBufBldr, &frame, length);
+    pLoopback->frameReceived = true;
+
+    if (pLoopback->polling) {
+        //Activated by the initiator
+        pLoopback->polling = false;
+        pLoopback->transceiver.active_tech = pLoopback->config.targets;
+    }
+
+    if (pLoopback->waiting) {
+        loopback_complete(pLoopback, NFC_OK);
+    }
+}
+
+void loopback_task(uint32_t events, void *pUserData)
+{
+    loopback_t *pLoopback = (loopback_t *) pUserData;
+    nfc_err_t ret = pLoopback->result;
+
+    if (events & EVENT_ABORTED) {
+        ret = NFC_ERR_ABORTED;
+    } else if (pLoopback->waiting) {
+        if (!(events & EVENT_TIMEOUT)) {
+            //Interrupt raised for another reason, keep waiting
+            nfc_scheduler_queue_task(&pLoopback->transceiver.scheduler, &pLoopback->transceiver.task);
+            return;
+        }
+        //Nothing received in time
+        ret = NFC_ERR_TIMEOUT;
+    }
+
+    pLoopback->waiting = false;
+    pLoopback->polling = false;
+
+    NFC_DBG("Operation completed with result %d", ret);
+    transceiver_callback(&pLoopback->transceiver, ret);
+}
+
+/**
+ * @}
+ * @}
+ * */
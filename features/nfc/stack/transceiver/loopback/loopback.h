@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2018, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * \file loopback.h
+ * \copyright Copyright (c) ARM Ltd 2018
+ * \details Software transceiver exchanging frames with a paired transceiver in memory
+ */
+
+#ifndef LOOPBACK_H_
+#define LOOPBACK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stack/nfc_common.h"
+#include "transceiver/transceiver.h"
+
+#define LOOPBACK_FRAME_SIZE_MAX 256
+
+typedef struct __loopback loopback_t;
+
+typedef void (*loopback_irq_cb_t)(loopback_t *pLoopback, void *pUserData);
+
+struct __loopback {
+    nfc_transceiver_t transceiver;
+    //Impl specific
+    loopback_t *pPeer;
+
+    uint32_t bitrate; //Simulated bit rate on air, in bit/s
+    size_t frameSize; //Longest frame that can be exchanged, in bytes
+    int timeout;
+
+    struct {
+        nfc_tech_t initiators;
+        nfc_tech_t targets;
+    } config;
+
+    //Transceive options
+    bool transmit;
+    bool receive;
+    bool repoll;
+
+    bool polling;
+    bool waiting; //Waiting for a frame from the peer
+    bool frameReceived; //A frame from the peer is in the incoming buffer
+
+    uint8_t payload[LOOPBACK_FRAME_SIZE_MAX]; //Incoming buffer
+    ac_buffer_builder_t readBufBldr;
+    ac_buffer_t writeBuf;
+
+    nfc_err_t result; //Result reported by the deferred task
+
+    loopback_irq_cb_t irqCb; //Emulated interrupt line, raised when an operation completes
+    void *pIrqUserData;
+
+    //Statistics of the frames sent by this end
+    struct {
+        uint32_t frames;
+        uint32_t bytes;
+        uint64_t airTimeUs;
+    } stats;
+};
+
+nfc_err_t loopback_init(loopback_t *pLoopback, nfc_scheduler_timer_t *pTimer, uint32_t bitrate, size_t frameSize);
+
+void loopback_pair(loopback_t *pLoopback1, loopback_t *pLoopback2);
+
+void loopback_set_irq_callback(loopback_t *pLoopback, loopback_irq_cb_t cb, void *pUserData);
+
+nfc_transceiver_t *loopback_get_transceiver(loopback_t *pLoopback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOOPBACK_H_ */
@@ -0,0 +1,122 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed.h"
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+
+#include "QueuedBlockDevice.h"
+#include "HeapBlockDevice.h"
+#include <stdlib.h>
+
+using namespace utest::v1;
+
+#define BLOCK_SIZE 512
+#define BLOCK_COUNT 16
+
+static Semaphore completed;
+static volatile int errors;
+
+static void done(bd_request_t *request, int err)
+{
+    if (err) {
+        errors++;
+    }
+    completed.release();
+}
+
+// Simple test for all APIs
+void functionality_test()
+{
+    uint8_t *dummy = new (std::nothrow) uint8_t[BLOCK_COUNT * BLOCK_SIZE * 3];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    HeapBlockDevice heap(BLOCK_COUNT * BLOCK_SIZE, BLOCK_SIZE);
+    QueuedBlockDevice bd(&heap);
+
+    int err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    TEST_ASSERT_EQUAL(BLOCK_SIZE, bd.get_read_size());
+    TEST_ASSERT_EQUAL(BLOCK_SIZE, bd.get_program_size());
+    TEST_ASSERT_EQUAL(BLOCK_SIZE, bd.get_erase_size());
+    TEST_ASSERT_EQUAL(BLOCK_COUNT * BLOCK_SIZE, bd.size());
+
+    uint8_t *write_block = new uint8_t[BLOCK_COUNT * BLOCK_SIZE];
+    uint8_t *read_block = new uint8_t[BLOCK_COUNT * BLOCK_SIZE];
+    for (int i = 0; i < BLOCK_COUNT * BLOCK_SIZE; i++) {
+        write_block[i] = 0xff & rand();
+    }
+
+    // Queue a request per block, in reverse order, and a sync
+    bd_request_t programs[BLOCK_COUNT], reads[BLOCK_COUNT], sync;
+    errors = 0;
+    for (int i = BLOCK_COUNT - 1; i >= 0; i--) {
+        programs[i].type = BD_REQUEST_PROGRAM;
+        programs[i].buffer = &write_block[i * BLOCK_SIZE];
+        programs[i].addr = i * BLOCK_SIZE;
+        programs[i].size = BLOCK_SIZE;
+        programs[i].callback = done;
+        err = bd.submit(&programs[i]);
+        TEST_ASSERT_EQUAL(0, err);
+    }
+    sync.type = BD_REQUEST_SYNC;
+    sync.callback = done;
+    err = bd.submit(&sync);
+    TEST_ASSERT_EQUAL(0, err);
+
+    for (int i = 0; i < BLOCK_COUNT; i++) {
+        reads[i].type = BD_REQUEST_READ;
+        reads[i].buffer = &read_block[i * BLOCK_SIZE];
+        reads[i].addr = i * BLOCK_SIZE;
+        reads[i].size = BLOCK_SIZE;
+        reads[i].callback = done;
+        err = bd.submit(&reads[i]);
+        TEST_ASSERT_EQUAL(0, err);
+    }
+
+    for (int i = 0; i < 2 * BLOCK_COUNT + 1; i++) {
+        TEST_ASSERT(completed.wait(1000) > 0);
+    }
+    TEST_ASSERT_EQUAL(0, errors);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(write_block, read_block, BLOCK_COUNT * BLOCK_SIZE);
+
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+
+    delete[] write_block;
+    delete[] read_block;
+}
+
+
+// Test setup
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(30, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("QueuedBlockDevice functionality test", functionality_test),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
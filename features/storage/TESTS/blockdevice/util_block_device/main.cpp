@@ -22,6 +22,8 @@
 #include "SlicingBlockDevice.h"
 #include "ChainingBlockDevice.h"
 #include "ProfilingBlockDevice.h"
+#include "StripingBlockDevice.h"
+#include "MirroringBlockDevice.h"
 #include <stdlib.h>
 
 using namespace utest::v1;
@@ -210,6 +212,143 @@ end:
     delete[] read_block;
 }
 
+// Simple test which read/writes blocks striped over block devices
+void test_striping() {
+    uint8_t *dummy = new (std::nothrow) uint8_t[BLOCK_COUNT * BLOCK_SIZE];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    int err;
+
+    HeapBlockDevice bd1((BLOCK_COUNT/2)*BLOCK_SIZE, BLOCK_SIZE);
+    HeapBlockDevice bd2((BLOCK_COUNT/2)*BLOCK_SIZE, BLOCK_SIZE);
+
+    // Test with stripes of two blocks
+    BlockDevice *bds[] = {&bd1, &bd2};
+    StripingBlockDevice stripe(bds, 2, 2*BLOCK_SIZE);
+
+    uint8_t *write_block = new (std::nothrow) uint8_t[4*BLOCK_SIZE];
+    uint8_t *read_block = new (std::nothrow) uint8_t[4*BLOCK_SIZE];
+
+    if (!write_block || !read_block) {
+        printf("Not enough memory for test");
+        goto end;
+    }
+
+    err = stripe.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    TEST_ASSERT_EQUAL(BLOCK_SIZE, stripe.get_program_size());
+    TEST_ASSERT_EQUAL(BLOCK_SIZE, stripe.get_erase_size());
+    TEST_ASSERT_EQUAL(2*BLOCK_SIZE, stripe.get_stripe_size());
+    TEST_ASSERT_EQUAL(BLOCK_COUNT*BLOCK_SIZE, stripe.size());
+
+    // Fill with random sequence
+    srand(1);
+    for (int i = 0; i < 4*BLOCK_SIZE; i++) {
+        write_block[i] = 0xff & rand();
+    }
+
+    // Write and read blocks across both devices
+    err = stripe.program(write_block, BLOCK_SIZE, 4*BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = stripe.read(read_block, BLOCK_SIZE, 4*BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+
+    // Check that the data was unmodified
+    srand(1);
+    for (int i = 0; i < 4*BLOCK_SIZE; i++) {
+        TEST_ASSERT_EQUAL(0xff & rand(), read_block[i]);
+    }
+
+    // Check that the third block landed on the second device
+    err = bd2.read(read_block, 0, BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&write_block[BLOCK_SIZE], read_block, BLOCK_SIZE);
+
+    err = stripe.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+
+end:
+    delete[] write_block;
+    delete[] read_block;
+}
+
+// Simple test which read/writes blocks mirrored on block devices
+void test_mirroring() {
+    uint8_t *dummy = new (std::nothrow) uint8_t[BLOCK_COUNT * BLOCK_SIZE * 2];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    int err;
+
+    HeapBlockDevice bd1(BLOCK_COUNT*BLOCK_SIZE, BLOCK_SIZE);
+    HeapBlockDevice bd2(BLOCK_COUNT*BLOCK_SIZE, BLOCK_SIZE);
+
+    // Test with mirror of block devices
+    BlockDevice *bds[] = {&bd1, &bd2};
+    MirroringBlockDevice mirror(bds);
+
+    uint8_t *write_block = new (std::nothrow) uint8_t[BLOCK_SIZE];
+    uint8_t *read_block = new (std::nothrow) uint8_t[BLOCK_SIZE];
+
+    if (!write_block || !read_block) {
+        printf("Not enough memory for test");
+        goto end;
+    }
+
+    err = mirror.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    TEST_ASSERT_EQUAL(BLOCK_SIZE, mirror.get_program_size());
+    TEST_ASSERT_EQUAL(BLOCK_SIZE, mirror.get_erase_size());
+    TEST_ASSERT_EQUAL(BLOCK_COUNT*BLOCK_SIZE, mirror.size());
+
+    // Fill with random sequence
+    srand(1);
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        write_block[i] = 0xff & rand();
+    }
+
+    // Write, sync, and read the block
+    err = mirror.program(write_block, BLOCK_SIZE, BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = mirror.sync();
+    TEST_ASSERT_EQUAL(0, err);
+
+    // Reads take turns on the devices
+    for (int j = 0; j < 2; j++) {
+        err = mirror.read(read_block, BLOCK_SIZE, BLOCK_SIZE);
+        TEST_ASSERT_EQUAL(0, err);
+
+        // Check that the data was unmodified
+        srand(1);
+        for (int i = 0; i < BLOCK_SIZE; i++) {
+            TEST_ASSERT_EQUAL(0xff & rand(), read_block[i]);
+        }
+    }
+    TEST_ASSERT_EQUAL(1, mirror.get_read_count(0));
+    TEST_ASSERT_EQUAL(1, mirror.get_read_count(1));
+
+    // Check with both original block devices
+    err = bd1.read(read_block, BLOCK_SIZE, BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(write_block, read_block, BLOCK_SIZE);
+
+    err = bd2.read(read_block, BLOCK_SIZE, BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(write_block, read_block, BLOCK_SIZE);
+
+    err = mirror.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+
+end:
+    delete[] write_block;
+    delete[] read_block;
+}
+
 // Simple test which read/writes blocks on a chain of block devices
 void test_profiling() {
     uint8_t *dummy = new (std::nothrow) uint8_t[BLOCK_COUNT * BLOCK_SIZE];
@@ -296,6 +435,8 @@ Case cases[] = {
     Case("Testing slicing of a block device", test_slicing),
     Case("Testing chaining of block devices", test_chaining),
     Case("Testing profiling of block devices", test_profiling),
+    Case("Testing striping of block devices", test_striping),
+    Case("Testing mirroring of block devices", test_mirroring),
 };
 
 Specification specification(test_setup, cases);
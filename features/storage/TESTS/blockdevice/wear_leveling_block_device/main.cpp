@@ -0,0 +1,123 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed.h"
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+
+#include "WearLevelingBlockDevice.h"
+#include "FlashSimBlockDevice.h"
+#include "HeapBlockDevice.h"
+#include <stdlib.h>
+
+using namespace utest::v1;
+
+static const bd_size_t read_size = 1;
+static const bd_size_t prog_size = 8;
+static const bd_size_t erase_size = 4096;
+static const bd_size_t num_blocks = 8;
+static const bd_size_t sector_size = 512;
+static const uint32_t  rewrites = 200;
+
+static void fill(uint8_t *buf, unsigned seed)
+{
+    srand(seed);
+    for (bd_size_t i = 0; i < sector_size; i++) {
+        buf[i] = 0xff & rand();
+    }
+}
+
+// Simple test for all APIs
+void functionality_test()
+{
+    uint8_t *dummy = new (std::nothrow) uint8_t[num_blocks * erase_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    HeapBlockDevice heap_bd(num_blocks * erase_size, read_size, prog_size, erase_size);
+    FlashSimBlockDevice flash_bd(&heap_bd);
+    WearLevelingBlockDevice bd(&flash_bd, sector_size);
+
+    int err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    uint8_t read_buf[sector_size], write_buf[sector_size];
+
+    TEST_ASSERT_EQUAL(sector_size, bd.get_read_size());
+    TEST_ASSERT_EQUAL(sector_size, bd.get_program_size());
+    TEST_ASSERT_EQUAL(sector_size, bd.get_erase_size());
+    TEST_ASSERT_EQUAL(-1, bd.get_erase_value());
+    TEST_ASSERT(bd.size() > 0);
+    TEST_ASSERT(bd.size() < num_blocks * erase_size);
+    bd_size_t num_sectors = bd.size() / sector_size;
+
+    // Sectors can be rewritten without an erase, far more often than the device holds
+    for (uint32_t i = 0; i < rewrites; i++) {
+        fill(write_buf, i);
+        err = bd.program(write_buf, (i % 3) * sector_size, sector_size);
+        TEST_ASSERT_EQUAL(0, err);
+    }
+    fill(write_buf, 7);
+    err = bd.program(write_buf, (num_sectors - 1) * sector_size, sector_size);
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    // Make sure data lives across inits
+    for (uint32_t i = rewrites - 3; i < rewrites; i++) {
+        fill(write_buf, i);
+        err = bd.read(read_buf, (i % 3) * sector_size, sector_size);
+        TEST_ASSERT_EQUAL(0, err);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(write_buf, read_buf, sector_size);
+    }
+    fill(write_buf, 7);
+    err = bd.read(read_buf, (num_sectors - 1) * sector_size, sector_size);
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(write_buf, read_buf, sector_size);
+
+    // Rewrites are spread over all blocks
+    uint32_t min, max;
+    err = bd.get_erase_counts(min, max);
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT(min > 0);
+    TEST_ASSERT(max - min <= 2);
+
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
+
+// Test setup
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(30, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("WearLevelingBlockDevice functionality test", functionality_test),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
@@ -0,0 +1,129 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef MBED_ASYNC_BLOCK_DEVICE_H
+#define MBED_ASYNC_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+#include "platform/Callback.h"
+
+
+/** Enum of block device request types
+ *
+ *  @enum bd_request_type_t
+ */
+enum bd_request_type_t {
+    BD_REQUEST_READ,            /*!< read into buffer */
+    BD_REQUEST_PROGRAM,         /*!< program from buffer */
+    BD_REQUEST_ERASE,           /*!< erase */
+    BD_REQUEST_TRIM,            /*!< mark as unused */
+    BD_REQUEST_SYNC,            /*!< complete every earlier request, see BlockDevice::sync */
+};
+
+/** A request to an asynchronous block device
+ *
+ *  The request and its buffer belong to the device from a successful call
+ *  to AsyncBlockDevice::submit until its callback is called.
+ */
+struct bd_request_t {
+    /** Type of the request */
+    bd_request_type_t type;
+
+    /** Buffer read into, or programmed from, for reads and programs */
+    void *buffer;
+
+    /** Address the request starts at, ignored for syncs */
+    bd_addr_t addr;
+
+    /** Size of the request in bytes, ignored for syncs */
+    bd_size_t size;
+
+    /** Called once with the request and 0 or a negative error code when the request completes
+     *
+     *  The callback runs in the context of the device, so it must not block.
+     *  It may submit further requests, and may reuse or free the request.
+     */
+    mbed::Callback<void(bd_request_t *, int)> callback;
+
+    /* Owned by the device while the request is queued */
+    bd_request_t *next;         /**< Next request in the queue */
+    bd_request_t *merged;       /**< Request merged in at the end of this one */
+    bd_size_t span;             /**< Size of this request and the ones merged in */
+    uint32_t batch;             /**< Requests are only reordered within a batch */
+
+    bd_request_t()
+        : type(BD_REQUEST_SYNC), buffer(0), addr(0), size(0), next(0), merged(0), span(0), batch(0)
+    {
+    }
+};
+
+
+/** Interface of a block device that accepts requests without blocking
+ *
+ *  Requests are queued, and the device is free to reorder and merge queued
+ *  requests that do not overlap. A request is never moved ahead of an
+ *  earlier request to an overlapping range, unless both are reads, or ahead
+ *  of an earlier sync request.
+ *
+ *  Synchronous calls to the device are not ordered with queued requests.
+ *  Submit a sync request and wait for its callback first when they have to be.
+ *
+ *  @code
+ *  #include "QueuedBlockDevice.h"
+ *
+ *  QueuedBlockDevice async(BlockDevice::get_default_instance());
+ *  EventQueue queue;
+ *  bd_request_t request;
+ *
+ *  void done(bd_request_t *request, int err) {
+ *      // Runs on the event queue rather than on the device thread
+ *  }
+ *
+ *  int main() {
+ *      async.init();
+ *      request.type = BD_REQUEST_READ;
+ *      request.buffer = buffer;
+ *      request.addr = 0;
+ *      request.size = sizeof(buffer);
+ *      request.callback = queue.event(done);
+ *      async.submit(&request);
+ *      queue.dispatch_forever();
+ *  }
+ *  @endcode
+ */
+class AsyncBlockDevice {
+public:
+    /** Lifetime of an asynchronous block device
+     */
+    virtual ~AsyncBlockDevice() {};
+
+    /** Queue a request
+     *
+     *  @param request  Request to queue, the device owns it until its callback is called
+     *  @return         0 if the request was queued, or a negative error code if it
+     *                  is invalid or the device is not initialized, in which
+     *                  case the callback is not called
+     */
+    virtual int submit(bd_request_t *request) = 0;
+};
+
+
+#endif
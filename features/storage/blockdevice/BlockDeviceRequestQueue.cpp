@@ -0,0 +1,183 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BlockDeviceRequestQueue.h"
+
+
+static bool overlaps(const bd_request_t *a, const bd_request_t *b)
+{
+    return a->addr < b->addr + b->size && b->addr < a->addr + a->span;
+}
+
+BlockDeviceRequestQueue::BlockDeviceRequestQueue(bd_size_t max_merge_size)
+    : _head(0), _tail(0), _max_merge_size(max_merge_size), _position(0), _batch(0),
+      _after_sync(false), _merge_count(0)
+{
+}
+
+void BlockDeviceRequestQueue::push(bd_request_t *request)
+{
+    request->next = 0;
+    request->merged = 0;
+    request->span = request->size;
+
+    bool new_batch = _after_sync || request->type == BD_REQUEST_SYNC;
+    bd_request_t *before = 0;
+    bd_request_t *after = 0;
+    bd_request_t *after_prev = 0;
+
+    for (bd_request_t *prev = 0, *p = _head; p && !new_batch; prev = p, p = p->next) {
+        if (p->batch != _batch) {
+            continue;
+        }
+
+        if (overlaps(p, request) && (p->type != BD_REQUEST_READ || request->type != BD_REQUEST_READ)) {
+            new_batch = true;
+        } else if (p->type == request->type &&
+                   (!_max_merge_size || p->span + request->size <= _max_merge_size)) {
+            if (p->addr + p->span == request->addr) {
+                before = p;
+            } else if (request->addr + request->size == p->addr) {
+                after = p;
+                after_prev = prev;
+            }
+        }
+    }
+
+    _after_sync = request->type == BD_REQUEST_SYNC;
+
+    if (new_batch) {
+        if (_head) {
+            _batch++;
+        }
+    } else if (before) {
+        // Appended to the end of a queued request
+        bd_request_t *last = before;
+        while (last->merged) {
+            last = last->merged;
+        }
+        last->merged = request;
+        before->span += request->size;
+        _merge_count++;
+
+        // and joins the request that starts where it ends, if any
+        if (after && (!_max_merge_size || before->span + after->span <= _max_merge_size)) {
+            if (after_prev) {
+                after_prev->next = after->next;
+            } else {
+                _head = after->next;
+            }
+            if (_tail == after) {
+                _tail = after_prev;
+            }
+            after->next = 0;
+            request->merged = after;
+            before->span += after->span;
+            _merge_count++;
+        }
+        return;
+    } else if (after) {
+        // Takes the place of the queued request it precedes
+        request->merged = after;
+        request->span += after->span;
+        request->batch = after->batch;
+        request->next = after->next;
+        after->next = 0;
+        if (after_prev) {
+            after_prev->next = request;
+        } else {
+            _head = request;
+        }
+        if (_tail == after) {
+            _tail = request;
+        }
+        _merge_count++;
+        return;
+    }
+
+    request->batch = _batch;
+    if (_tail) {
+        _tail->next = request;
+    } else {
+        _head = request;
+    }
+    _tail = request;
+}
+
+bd_request_t *BlockDeviceRequestQueue::pop()
+{
+    if (!_head) {
+        return 0;
+    }
+
+    // Elevator order within the oldest batch, the batches are queued in order
+    bd_request_t *ahead = 0, *ahead_prev = 0;
+    bd_request_t *lowest = 0, *lowest_prev = 0;
+    for (bd_request_t *prev = 0, *p = _head; p && p->batch == _head->batch; prev = p, p = p->next) {
+        if (p->addr >= _position && (!ahead || p->addr < ahead->addr)) {
+            ahead = p;
+            ahead_prev = prev;
+        }
+        if (!lowest || p->addr < lowest->addr) {
+            lowest = p;
+            lowest_prev = prev;
+        }
+    }
+
+    bd_request_t *request = ahead ? ahead : lowest;
+    bd_request_t *prev = ahead ? ahead_prev : lowest_prev;
+    if (prev) {
+        prev->next = request->next;
+    } else {
+        _head = request->next;
+    }
+    if (_tail == request) {
+        _tail = prev;
+    }
+    request->next = 0;
+
+    if (request->type != BD_REQUEST_SYNC) {
+        _position = request->addr + request->span;
+    }
+    if (!_head) {
+        _after_sync = false;
+    }
+    return request;
+}
+
+bool BlockDeviceRequestQueue::empty() const
+{
+    return !_head;
+}
+
+uint32_t BlockDeviceRequestQueue::get_merge_count() const
+{
+    return _merge_count;
+}
+
+void BlockDeviceRequestQueue::complete(bd_request_t *request, int err)
+{
+    while (request) {
+        // The callback may reuse the request
+        bd_request_t *merged = request->merged;
+        mbed::Callback<void(bd_request_t *, int)> callback = request->callback;
+        request->merged = 0;
+        if (callback) {
+            callback(request, err);
+        }
+        request = merged;
+    }
+}
@@ -0,0 +1,94 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef MBED_BLOCK_DEVICE_REQUEST_QUEUE_H
+#define MBED_BLOCK_DEVICE_REQUEST_QUEUE_H
+
+#include "AsyncBlockDevice.h"
+
+
+/** Queue of pending block device requests, for implementations of AsyncBlockDevice
+ *
+ *  A request that starts where a queued request of the same type ends, or
+ *  ends where it starts, is merged into it, so the device can serve both with
+ *  one command. Requests are taken out in elevator order: the lowest address
+ *  at or after the end of the last request, wrapping around to the lowest
+ *  address once none is left ahead.
+ *
+ *  Reordering and merging only happen within a batch. A request that overlaps
+ *  a request of the current batch, unless both are reads, and any request
+ *  following a sync, starts a new batch; a sync request forms a batch of its own.
+ *
+ *  The queue is not thread safe, and the device has to complete each request
+ *  before taking out the next.
+ */
+class BlockDeviceRequestQueue {
+public:
+    /** Create an empty queue
+     *
+     *  @param max_merge_size   Largest size requests are merged up to, 0 for no limit
+     */
+    BlockDeviceRequestQueue(bd_size_t max_merge_size = 0);
+
+    /** Add a request to the queue
+     *
+     *  @param request  Request to add, merged into a queued request if possible
+     */
+    void push(bd_request_t *request);
+
+    /** Take the next request out of the queue
+     *
+     *  @return         Request to serve, followed by the requests merged into it
+     *                  through the merged member, or NULL if the queue is empty
+     */
+    bd_request_t *pop();
+
+    /** Check if the queue is empty
+     *
+     *  @return         True if no request is queued
+     */
+    bool empty() const;
+
+    /** Get the number of requests merged into others since the queue was created
+     *
+     *  @return         Number of merged requests
+     */
+    uint32_t get_merge_count() const;
+
+    /** Call the callbacks of a request taken out of the queue and of the requests merged into it
+     *
+     *  @param request  Request returned by pop
+     *  @param err      0 on success or a negative error code on failure
+     */
+    static void complete(bd_request_t *request, int err);
+
+protected:
+    bd_request_t *_head;
+    bd_request_t *_tail;
+    bd_size_t _max_merge_size;
+    bd_addr_t _position;
+    uint32_t _batch;
+    bool _after_sync;
+    uint32_t _merge_count;
+};
+
+
+#endif
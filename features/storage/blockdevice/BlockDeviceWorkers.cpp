@@ -0,0 +1,113 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BlockDeviceWorkers.h"
+
+
+BlockDeviceWorkers::BlockDeviceWorkers(osPriority priority, uint32_t stack_size)
+    : _priority(priority), _stack_size(stack_size), _workers(0), _count(0), _stopping(false)
+{
+}
+
+BlockDeviceWorkers::~BlockDeviceWorkers()
+{
+    stop();
+}
+
+int BlockDeviceWorkers::start(size_t count)
+{
+    _mutex.lock();
+    if (_workers) {
+        _mutex.unlock();
+        return BD_ERROR_OK;
+    }
+
+    _workers = new worker[count];
+    _count = 0;
+    _stopping = false;
+    while (_count < count) {
+        worker &w = _workers[_count];
+        w.owner = this;
+        w.index = _count;
+        w.err = 0;
+        w.thread = new rtos::Thread(_priority, _stack_size, NULL, "bd_worker");
+        if (w.thread->start(mbed::callback(&w, &worker::main)) != osOK) {
+            delete w.thread;
+            _mutex.unlock();
+            stop();
+            return BD_ERROR_DEVICE_ERROR;
+        }
+        _count++;
+    }
+
+    _mutex.unlock();
+    return BD_ERROR_OK;
+}
+
+void BlockDeviceWorkers::stop()
+{
+    _mutex.lock();
+    if (!_workers) {
+        _mutex.unlock();
+        return;
+    }
+
+    _stopping = true;
+    for (size_t i = 0; i < _count; i++) {
+        _workers[i].start.release();
+    }
+    for (size_t i = 0; i < _count; i++) {
+        _workers[i].thread->join();
+        delete _workers[i].thread;
+    }
+
+    delete[] _workers;
+    _workers = 0;
+    _count = 0;
+    _mutex.unlock();
+}
+
+int BlockDeviceWorkers::run(mbed::Callback<int(size_t)> job)
+{
+    _mutex.lock();
+    _job = job;
+    for (size_t i = 0; i < _count; i++) {
+        _workers[i].start.release();
+    }
+    for (size_t i = 0; i < _count; i++) {
+        _done.wait();
+    }
+
+    int err = BD_ERROR_OK;
+    for (size_t i = 0; i < _count && !err; i++) {
+        err = _workers[i].err;
+    }
+    _mutex.unlock();
+    return err;
+}
+
+void BlockDeviceWorkers::worker::main()
+{
+    while (true) {
+        start.wait();
+        if (owner->_stopping) {
+            return;
+        }
+
+        err = owner->_job(index);
+        owner->_done.release();
+    }
+}
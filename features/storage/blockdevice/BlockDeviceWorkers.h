@@ -0,0 +1,95 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef MBED_BLOCK_DEVICE_WORKERS_H
+#define MBED_BLOCK_DEVICE_WORKERS_H
+
+#include "BlockDevice.h"
+#include "platform/Callback.h"
+#include "platform/NonCopyable.h"
+#include "rtos/Thread.h"
+#include "rtos/Mutex.h"
+#include "rtos/Semaphore.h"
+
+
+/** Threads that call the child devices of a composite block device in parallel
+ *
+ *  Each child device gets a worker thread. A job runs on all workers at once
+ *  and is passed the index of the worker, so it can call the child device of
+ *  the same index.
+ */
+class BlockDeviceWorkers : private mbed::NonCopyable<BlockDeviceWorkers> {
+public:
+    /** Create workers, the threads are started by start
+     *
+     *  @param priority     Priority of the worker threads
+     *  @param stack_size   Stack size of each worker thread in bytes
+     */
+    BlockDeviceWorkers(osPriority priority = osPriorityNormal, uint32_t stack_size = OS_STACK_SIZE);
+
+    /** Stop the workers
+     */
+    ~BlockDeviceWorkers();
+
+    /** Start the worker threads
+     *
+     *  @param count        Number of workers
+     *  @return             0 on success or BD_ERROR_DEVICE_ERROR if a thread cannot be started
+     */
+    int start(size_t count);
+
+    /** Stop the worker threads once they are idle
+     */
+    void stop();
+
+    /** Run a job on every worker and wait for all of them
+     *
+     *  Jobs run one at a time, the calls from other threads wait.
+     *
+     *  @param job          Called on each worker with the index of the worker
+     *  @return             0 on success, or the first error code returned by a
+     *                      worker in the order of their indices
+     */
+    int run(mbed::Callback<int(size_t)> job);
+
+private:
+    struct worker {
+        BlockDeviceWorkers *owner;
+        size_t index;
+        rtos::Thread *thread;
+        rtos::Semaphore start;
+        int err;
+
+        void main();
+    };
+
+    osPriority _priority;
+    uint32_t _stack_size;
+    worker *_workers;
+    size_t _count;
+    rtos::Mutex _mutex;
+    rtos::Semaphore _done;
+    mbed::Callback<int(size_t)> _job;
+    bool _stopping;
+};
+
+
+#endif
@@ -0,0 +1,300 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MirroringBlockDevice.h"
+#include "platform/mbed_critical.h"
+
+
+MirroringBlockDevice::MirroringBlockDevice(BlockDevice **bds, size_t bd_count,
+                                           osPriority priority, uint32_t stack_size)
+    : _bds(bds), _bd_count(bd_count)
+    , _read_size(0), _program_size(0), _erase_size(0), _size(0)
+    , _erase_value(-1), _init_ref_count(0), _is_initialized(false)
+    , _bd_mutexes(0), _busy(0), _reads(0), _next(0), _workers(priority, stack_size)
+{
+}
+
+MirroringBlockDevice::~MirroringBlockDevice()
+{
+    _workers.stop();
+    delete[] _bd_mutexes;
+    delete[] _busy;
+    delete[] _reads;
+}
+
+static bool is_aligned(uint64_t x, uint64_t alignment)
+{
+    return (x / alignment) * alignment == x;
+}
+
+int MirroringBlockDevice::init()
+{
+    int err;
+    uint32_t val = core_util_atomic_incr_u32(&_init_ref_count, 1);
+
+    if (val != 1) {
+        return BD_ERROR_OK;
+    }
+
+    _read_size = 0;
+    _program_size = 0;
+    _erase_size = 0;
+    _erase_value = -1;
+    bd_size_t smallest = 0;
+
+    // Initialize children block devices, find all sizes and
+    // assert that block sizes are similar
+    for (size_t i = 0; i < _bd_count; i++) {
+        err = _bds[i]->init();
+        if (err) {
+            goto fail;
+        }
+
+        bd_size_t read = _bds[i]->get_read_size();
+        if (i == 0 || (read >= _read_size && is_aligned(read, _read_size))) {
+            _read_size = read;
+        } else {
+            MBED_ASSERT(_read_size > read && is_aligned(_read_size, read));
+        }
+
+        bd_size_t program = _bds[i]->get_program_size();
+        if (i == 0 || (program >= _program_size && is_aligned(program, _program_size))) {
+            _program_size = program;
+        } else {
+            MBED_ASSERT(_program_size > program && is_aligned(_program_size, program));
+        }
+
+        bd_size_t erase = _bds[i]->get_erase_size();
+        if (i == 0 || (erase >= _erase_size && is_aligned(erase, _erase_size))) {
+            _erase_size = erase;
+        } else {
+            MBED_ASSERT(_erase_size > erase && is_aligned(_erase_size, erase));
+        }
+
+        int value = _bds[i]->get_erase_value();
+        if (i == 0 || value == _erase_value) {
+            _erase_value = value;
+        } else {
+            _erase_value = -1;
+        }
+
+        if (i == 0 || _bds[i]->size() < smallest) {
+            smallest = _bds[i]->size();
+        }
+    }
+
+    _size = (smallest / _erase_size) * _erase_size;
+
+    if (!_bd_mutexes) {
+        _bd_mutexes = new rtos::Mutex[_bd_count];
+        _busy = new uint32_t[_bd_count];
+        _reads = new uint32_t[_bd_count];
+    }
+    for (size_t i = 0; i < _bd_count; i++) {
+        _busy[i] = 0;
+        _reads[i] = 0;
+    }
+
+    err = _workers.start(_bd_count);
+    if (err) {
+        goto fail;
+    }
+
+    _is_initialized = true;
+    return BD_ERROR_OK;
+
+fail:
+    _is_initialized = false;
+    _init_ref_count = 0;
+    return err;
+}
+
+int MirroringBlockDevice::deinit()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_OK;
+    }
+
+    uint32_t val = core_util_atomic_decr_u32(&_init_ref_count, 1);
+
+    if (val) {
+        return BD_ERROR_OK;
+    }
+
+    _workers.stop();
+
+    for (size_t i = 0; i < _bd_count; i++) {
+        int err = _bds[i]->deinit();
+        if (err) {
+            return err;
+        }
+    }
+
+    _is_initialized = false;
+    return BD_ERROR_OK;
+}
+
+int MirroringBlockDevice::sync()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return dispatch(OP_SYNC, NULL, 0, 0);
+}
+
+int MirroringBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_read(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    // Least busy device, devices that are as busy take turns
+    uint32_t first = core_util_atomic_incr_u32(&_next, 1);
+    size_t index = first % _bd_count;
+    for (size_t i = 1; i < _bd_count; i++) {
+        size_t candidate = (first + i) % _bd_count;
+        if (_busy[candidate] < _busy[index]) {
+            index = candidate;
+        }
+    }
+
+    // Any other device holds the same data if the read fails
+    int err = BD_ERROR_DEVICE_ERROR;
+    for (size_t i = 0; i < _bd_count; i++) {
+        size_t device = (index + i) % _bd_count;
+        core_util_atomic_incr_u32(&_busy[device], 1);
+        _bd_mutexes[device].lock();
+        err = _bds[device]->read(b, addr, size);
+        if (!err) {
+            _reads[device]++;
+        }
+        _bd_mutexes[device].unlock();
+        core_util_atomic_decr_u32(&_busy[device], 1);
+
+        if (!err) {
+            break;
+        }
+    }
+
+    return err;
+}
+
+int MirroringBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_program(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return dispatch(OP_PROGRAM, b, addr, size);
+}
+
+int MirroringBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return dispatch(OP_ERASE, NULL, addr, size);
+}
+
+int MirroringBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return dispatch(OP_TRIM, NULL, addr, size);
+}
+
+bd_size_t MirroringBlockDevice::get_read_size() const
+{
+    return _read_size;
+}
+
+bd_size_t MirroringBlockDevice::get_program_size() const
+{
+    return _program_size;
+}
+
+bd_size_t MirroringBlockDevice::get_erase_size() const
+{
+    return _erase_size;
+}
+
+bd_size_t MirroringBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return _erase_size;
+}
+
+int MirroringBlockDevice::get_erase_value() const
+{
+    return _erase_value;
+}
+
+bd_size_t MirroringBlockDevice::size() const
+{
+    return _size;
+}
+
+uint32_t MirroringBlockDevice::get_read_count(size_t index) const
+{
+    MBED_ASSERT(index < _bd_count);
+    return _reads ? _reads[index] : 0;
+}
+
+int MirroringBlockDevice::dispatch(op_t op, const void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    // Writes are applied to all devices in the same order
+    _mutex.lock();
+    _op = op;
+    _op_buffer = buffer;
+    _op_addr = addr;
+    _op_size = size;
+    int err = _workers.run(mbed::callback(this, &MirroringBlockDevice::serve));
+    _mutex.unlock();
+    return err;
+}
+
+int MirroringBlockDevice::serve(size_t index)
+{
+    core_util_atomic_incr_u32(&_busy[index], 1);
+    _bd_mutexes[index].lock();
+
+    int err;
+    switch (_op) {
+        case OP_PROGRAM:
+            err = _bds[index]->program(_op_buffer, _op_addr, _op_size);
+            break;
+        case OP_ERASE:
+            err = _bds[index]->erase(_op_addr, _op_size);
+            break;
+        case OP_TRIM:
+            err = _bds[index]->trim(_op_addr, _op_size);
+            break;
+        default:
+            err = _bds[index]->sync();
+            break;
+    }
+
+    _bd_mutexes[index].unlock();
+    core_util_atomic_decr_u32(&_busy[index], 1);
+    return err;
+}
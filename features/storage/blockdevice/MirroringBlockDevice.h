@@ -0,0 +1,238 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef MBED_MIRRORING_BLOCK_DEVICE_H
+#define MBED_MIRRORING_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+#include "BlockDeviceWorkers.h"
+#include "platform/mbed_assert.h"
+#include "rtos/Mutex.h"
+
+
+/** Block device for mirroring data on multiple block devices
+ *
+ *  Programs, erases and trims go to all devices at once, each from its own
+ *  worker thread, and complete once every device completed them. A read goes
+ *  to the device with the fewest operations in progress, so reads from
+ *  several threads are served by several devices at once, and is retried on
+ *  the other devices if it fails.
+ *
+ *  The size is the size of the smallest device, rounded down to the erase size.
+ *
+ *  @code
+ *  #include "mbed.h"
+ *  #include "SDBlockDevice.h"
+ *  #include "MirroringBlockDevice.h"
+ *
+ *  SDBlockDevice sd1(PTE3, PTE1, PTE2, PTE4);
+ *  SDBlockDevice sd2(PTD2, PTD3, PTD1, PTD0);
+ *
+ *  // Keep the same data on both cards
+ *  BlockDevice *bds[] = {&sd1, &sd2};
+ *  MirroringBlockDevice mirrored(bds);
+ *  @endcode
+ */
+class MirroringBlockDevice : public BlockDevice {
+public:
+    /** Lifetime of the mirroring block device
+     *
+     *  @param bds          Array of block devices to mirror data on
+     *  @param bd_count     Number of block devices
+     *  @param priority     Priority of the worker threads
+     *  @param stack_size   Stack size of each worker thread in bytes
+     *  @note The block sizes of the devices must be multiples of each other
+     */
+    MirroringBlockDevice(BlockDevice **bds, size_t bd_count,
+                         osPriority priority = osPriorityNormal, uint32_t stack_size = OS_STACK_SIZE);
+
+    /** Lifetime of the mirroring block device
+     *
+     *  @param bds          Array of block devices to mirror data on
+     *  @note The block sizes of the devices must be multiples of each other
+     */
+    template <size_t Size>
+    MirroringBlockDevice(BlockDevice *(&bds)[Size])
+        : _bds(bds), _bd_count(sizeof(bds) / sizeof(bds[0]))
+        , _read_size(0), _program_size(0), _erase_size(0), _size(0)
+        , _erase_value(-1), _init_ref_count(0), _is_initialized(false)
+        , _bd_mutexes(0), _busy(0), _reads(0), _next(0)
+    {
+    }
+
+    /** Lifetime of the mirroring block device
+     */
+    virtual ~MirroringBlockDevice();
+
+    /** Initialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int init();
+
+    /** Deinitialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int deinit();
+
+    /** Ensure data on storage is in sync with the driver
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int sync();
+
+    /** Read blocks from a block device
+     *
+     *  @param buffer   Buffer to read blocks into
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Program blocks to a block device
+     *
+     *  The blocks must have been erased prior to being programmed
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Erase blocks on a block device
+     *
+     *  The state of an erased block is undefined until it has been programmed,
+     *  unless get_erase_value returns a non-negative byte value
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int erase(bd_addr_t addr, bd_size_t size);
+
+    /** Mark blocks as no longer in use
+     *
+     *  @param addr     Address of block to mark as unused
+     *  @param size     Size to mark as unused in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int trim(bd_addr_t addr, bd_size_t size);
+
+    /** Get the size of a readable block
+     *
+     *  @return         Size of a readable block in bytes
+     */
+    virtual bd_size_t get_read_size() const;
+
+    /** Get the size of a programmable block
+     *
+     *  @return         Size of a programmable block in bytes
+     *  @note Must be a multiple of the read size
+     */
+    virtual bd_size_t get_program_size() const;
+
+    /** Get the size of an erasable block
+     *
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size() const;
+
+    /** Get the size of an erasable block given address
+     *
+     *  @param addr     Address within the erasable block
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size(bd_addr_t addr) const;
+
+    /** Get the value of storage when erased
+     *
+     *  @return         The value of storage when erased, or -1 if you can't
+     *                  rely on the value of erased storage
+     */
+    virtual int get_erase_value() const;
+
+    /** Get the total size of the underlying device
+     *
+     *  @return         Size of the underlying device in bytes
+     */
+    virtual bd_size_t size() const;
+
+    /** Get the number of reads served by a device
+     *
+     *  @param index    Index of the device
+     *  @return         Number of reads served since the device was initialized
+     */
+    uint32_t get_read_count(size_t index) const;
+
+protected:
+    enum op_t {
+        OP_PROGRAM,
+        OP_ERASE,
+        OP_TRIM,
+        OP_SYNC,
+    };
+
+    BlockDevice **_bds;
+    size_t _bd_count;
+    bd_size_t _read_size;
+    bd_size_t _program_size;
+    bd_size_t _erase_size;
+    bd_size_t _size;
+    int _erase_value;
+    uint32_t _init_ref_count;
+    bool _is_initialized;
+
+    // Each device is called by one thread at a time
+    rtos::Mutex *_bd_mutexes;
+    // Operations in progress or waiting for each device, and reads served by each
+    volatile uint32_t *_busy;
+    uint32_t *_reads;
+    uint32_t _next;
+
+    // Write operation being served, protected by _mutex
+    rtos::Mutex _mutex;
+    BlockDeviceWorkers _workers;
+    op_t _op;
+    const void *_op_buffer;
+    bd_addr_t _op_addr;
+    bd_size_t _op_size;
+
+    /** Serve a write operation on all devices
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int dispatch(op_t op, const void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Serve the current write operation on one device
+     *
+     *  @param index    Index of the device
+     *  @return         0 on success or a negative error code on failure
+     */
+    int serve(size_t index);
+};
+
+
+#endif
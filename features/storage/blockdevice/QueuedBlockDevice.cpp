@@ -0,0 +1,298 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "QueuedBlockDevice.h"
+#include "platform/mbed_assert.h"
+
+
+QueuedBlockDevice::QueuedBlockDevice(BlockDevice *bd, osPriority priority, uint32_t stack_size)
+    : _bd(bd), _priority(priority), _stack_size(stack_size), _thread(0), _stopping(false),
+      _init_ref_count(0), _is_initialized(false)
+{
+}
+
+QueuedBlockDevice::~QueuedBlockDevice()
+{
+    deinit();
+}
+
+int QueuedBlockDevice::init()
+{
+    // Held until the worker runs, so a concurrent init() returns once the device is usable
+    _init_mutex.lock();
+    if (_init_ref_count) {
+        _init_ref_count++;
+        _init_mutex.unlock();
+        return BD_ERROR_OK;
+    }
+
+    int err = _bd->init();
+    if (err) {
+        _init_mutex.unlock();
+        return err;
+    }
+
+    _stopping = false;
+    _thread = new rtos::Thread(_priority, _stack_size, NULL, "bd_queue");
+    if (_thread->start(mbed::callback(this, &QueuedBlockDevice::worker)) != osOK) {
+        delete _thread;
+        _thread = 0;
+        _bd->deinit();
+        _init_mutex.unlock();
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _init_ref_count = 1;
+    _queue_mutex.lock();
+    _is_initialized = true;
+    _queue_mutex.unlock();
+    _init_mutex.unlock();
+    return BD_ERROR_OK;
+}
+
+int QueuedBlockDevice::deinit()
+{
+    _init_mutex.lock();
+    if (!_init_ref_count) {
+        _init_mutex.unlock();
+        return BD_ERROR_OK;
+    }
+
+    if (--_init_ref_count) {
+        _init_mutex.unlock();
+        return BD_ERROR_OK;
+    }
+
+    // Requests already queued are still served
+    _queue_mutex.lock();
+    _is_initialized = false;
+    _stopping = true;
+    _queue_mutex.unlock();
+
+    _pending.release();
+    _thread->join();
+    delete _thread;
+    _thread = 0;
+
+    int err = _bd->deinit();
+    _init_mutex.unlock();
+    return err;
+}
+
+int QueuedBlockDevice::submit(bd_request_t *request)
+{
+    bool valid;
+    switch (request->type) {
+        case BD_REQUEST_READ:
+            valid = request->buffer && is_valid_read(request->addr, request->size);
+            break;
+        case BD_REQUEST_PROGRAM:
+            valid = request->buffer && is_valid_program(request->addr, request->size);
+            break;
+        case BD_REQUEST_ERASE:
+        case BD_REQUEST_TRIM:
+            valid = is_valid_erase(request->addr, request->size);
+            break;
+        case BD_REQUEST_SYNC:
+            valid = true;
+            break;
+        default:
+            valid = false;
+            break;
+    }
+    if (!valid) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _queue_mutex.lock();
+    if (!_is_initialized) {
+        _queue_mutex.unlock();
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    _queue.push(request);
+    _queue_mutex.unlock();
+
+    _pending.release();
+    return BD_ERROR_OK;
+}
+
+void QueuedBlockDevice::worker()
+{
+    while (true) {
+        _pending.wait();
+
+        bool stopping;
+        while (true) {
+            _queue_mutex.lock();
+            bd_request_t *request = _queue.pop();
+            stopping = _stopping;
+            _queue_mutex.unlock();
+
+            if (!request) {
+                break;
+            }
+
+            int err = execute(request);
+            BlockDeviceRequestQueue::complete(request, err);
+        }
+
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+int QueuedBlockDevice::execute(bd_request_t *request)
+{
+    int err = BD_ERROR_OK;
+
+    _bd_mutex.lock();
+    switch (request->type) {
+        case BD_REQUEST_READ:
+        case BD_REQUEST_PROGRAM:
+            // One call for each run of merged requests with contiguous buffers
+            for (bd_request_t *start = request; start && !err;) {
+                bd_request_t *end = start;
+                bd_size_t size = start->size;
+                while (end->merged && static_cast<uint8_t *>(start->buffer) + size == end->merged->buffer) {
+                    end = end->merged;
+                    size += end->size;
+                }
+
+                if (request->type == BD_REQUEST_READ) {
+                    err = _bd->read(start->buffer, start->addr, size);
+                } else {
+                    err = _bd->program(start->buffer, start->addr, size);
+                }
+                start = end->merged;
+            }
+            break;
+        case BD_REQUEST_ERASE:
+            err = _bd->erase(request->addr, request->span);
+            break;
+        case BD_REQUEST_TRIM:
+            err = _bd->trim(request->addr, request->span);
+            break;
+        case BD_REQUEST_SYNC:
+            err = _bd->sync();
+            break;
+    }
+    _bd_mutex.unlock();
+
+    return err;
+}
+
+uint32_t QueuedBlockDevice::get_merge_count()
+{
+    _queue_mutex.lock();
+    uint32_t count = _queue.get_merge_count();
+    _queue_mutex.unlock();
+    return count;
+}
+
+int QueuedBlockDevice::sync()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _bd_mutex.lock();
+    int err = _bd->sync();
+    _bd_mutex.unlock();
+    return err;
+}
+
+int QueuedBlockDevice::read(void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_read(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _bd_mutex.lock();
+    int err = _bd->read(buffer, addr, size);
+    _bd_mutex.unlock();
+    return err;
+}
+
+int QueuedBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_program(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _bd_mutex.lock();
+    int err = _bd->program(buffer, addr, size);
+    _bd_mutex.unlock();
+    return err;
+}
+
+int QueuedBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _bd_mutex.lock();
+    int err = _bd->erase(addr, size);
+    _bd_mutex.unlock();
+    return err;
+}
+
+int QueuedBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _bd_mutex.lock();
+    int err = _bd->trim(addr, size);
+    _bd_mutex.unlock();
+    return err;
+}
+
+bd_size_t QueuedBlockDevice::get_read_size() const
+{
+    return _bd->get_read_size();
+}
+
+bd_size_t QueuedBlockDevice::get_program_size() const
+{
+    return _bd->get_program_size();
+}
+
+bd_size_t QueuedBlockDevice::get_erase_size() const
+{
+    return _bd->get_erase_size();
+}
+
+bd_size_t QueuedBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return _bd->get_erase_size(addr);
+}
+
+int QueuedBlockDevice::get_erase_value() const
+{
+    return _bd->get_erase_value();
+}
+
+bd_size_t QueuedBlockDevice::size() const
+{
+    return _bd->size();
+}
@@ -0,0 +1,200 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef MBED_QUEUED_BLOCK_DEVICE_H
+#define MBED_QUEUED_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+#include "AsyncBlockDevice.h"
+#include "BlockDeviceRequestQueue.h"
+#include "rtos/Thread.h"
+#include "rtos/Mutex.h"
+#include "rtos/Semaphore.h"
+
+
+/** Asynchronous adapter for any block device, which serves queued requests
+ *  with the synchronous calls of the device on a worker thread
+ *
+ *  Completion callbacks run on the worker thread. Merged reads and programs
+ *  are served with one call each if their buffers happen to be contiguous,
+ *  merged erases and trims always are.
+ *
+ *  Drivers that can overlap operations with the CPU without a thread, such
+ *  as SPIFBlockDevice and SDBlockDevice, implement AsyncBlockDevice themselves.
+ */
+class QueuedBlockDevice : public BlockDevice, public AsyncBlockDevice {
+public:
+    /** Lifetime of the queued block device
+     *
+     *  @param bd           Block device to serve requests with
+     *  @param priority     Priority of the worker thread
+     *  @param stack_size   Stack size of the worker thread in bytes
+     */
+    QueuedBlockDevice(BlockDevice *bd, osPriority priority = osPriorityNormal,
+                      uint32_t stack_size = OS_STACK_SIZE);
+
+    /** Lifetime of a block device
+     */
+    virtual ~QueuedBlockDevice();
+
+    /** Initialize a block device and start the worker thread
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int init();
+
+    /** Deinitialize a block device
+     *
+     *  Completes the queued requests and stops the worker thread
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int deinit();
+
+    /** Queue a request
+     *
+     *  @param request  Request to queue, the device owns it until its callback is called
+     *  @return         0 if the request was queued, or a negative error code if it
+     *                  is invalid or the device is not initialized
+     */
+    virtual int submit(bd_request_t *request);
+
+    /** Ensure data on storage is in sync with the driver
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int sync();
+
+    /** Read blocks from a block device
+     *
+     *  @param buffer   Buffer to read blocks into
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Program blocks to a block device
+     *
+     *  The blocks must have been erased prior to being programmed
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Erase blocks on a block device
+     *
+     *  The state of an erased block is undefined until it has been programmed,
+     *  unless get_erase_value returns a non-negative byte value
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int erase(bd_addr_t addr, bd_size_t size);
+
+    /** Mark blocks as no longer in use
+     *
+     *  @param addr     Address of block to mark as unused
+     *  @param size     Size to mark as unused in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int trim(bd_addr_t addr, bd_size_t size);
+
+    /** Get the size of a readable block
+     *
+     *  @return         Size of a readable block in bytes
+     */
+    virtual bd_size_t get_read_size() const;
+
+    /** Get the size of a programmable block
+     *
+     *  @return         Size of a programmable block in bytes
+     *  @note Must be a multiple of the read size
+     */
+    virtual bd_size_t get_program_size() const;
+
+    /** Get the size of an erasable block
+     *
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size() const;
+
+    /** Get the size of an erasable block given address
+     *
+     *  @param addr     Address within the erasable block
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size(bd_addr_t addr) const;
+
+    /** Get the value of storage when erased
+     *
+     *  @return         The value of storage when erased, or -1 if you can't
+     *                  rely on the value of erased storage
+     */
+    virtual int get_erase_value() const;
+
+    /** Get the total size of the underlying device
+     *
+     *  @return         Size of the underlying device in bytes
+     */
+    virtual bd_size_t size() const;
+
+    /** Get the number of requests merged into others
+     *
+     *  @return         Number of merged requests since the device was created
+     */
+    uint32_t get_merge_count();
+
+protected:
+    BlockDevice *_bd;
+    osPriority _priority;
+    uint32_t _stack_size;
+    rtos::Thread *_thread;
+    // Protects the reference count while the device and the worker start and stop
+    rtos::Mutex _init_mutex;
+    // Protects the queue, and the device while it is called
+    rtos::Mutex _queue_mutex;
+    rtos::Mutex _bd_mutex;
+    rtos::Semaphore _pending;
+    BlockDeviceRequestQueue _queue;
+    bool _stopping;
+    uint32_t _init_ref_count;
+    bool _is_initialized;
+
+    /** Serve queued requests until deinit
+     */
+    void worker();
+
+    /** Serve a request and the requests merged into it
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int execute(bd_request_t *request);
+};
+
+
+#endif
@@ -0,0 +1,302 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StripingBlockDevice.h"
+#include "platform/mbed_critical.h"
+
+
+StripingBlockDevice::StripingBlockDevice(BlockDevice **bds, size_t bd_count, bd_size_t stripe_size,
+                                         osPriority priority, uint32_t stack_size)
+    : _bds(bds), _bd_count(bd_count), _stripe_size(stripe_size)
+    , _unit_size(0), _read_size(0), _program_size(0), _erase_size(0), _size(0)
+    , _erase_value(-1), _init_ref_count(0), _is_initialized(false), _workers(priority, stack_size)
+{
+}
+
+StripingBlockDevice::~StripingBlockDevice()
+{
+    _workers.stop();
+}
+
+static bool is_aligned(uint64_t x, uint64_t alignment)
+{
+    return (x / alignment) * alignment == x;
+}
+
+int StripingBlockDevice::init()
+{
+    int err;
+    uint32_t val = core_util_atomic_incr_u32(&_init_ref_count, 1);
+
+    if (val != 1) {
+        return BD_ERROR_OK;
+    }
+
+    _read_size = 0;
+    _program_size = 0;
+    _erase_size = 0;
+    _erase_value = -1;
+    bd_size_t smallest = 0;
+
+    // Initialize children block devices, find all sizes and
+    // assert that block sizes are similar
+    for (size_t i = 0; i < _bd_count; i++) {
+        err = _bds[i]->init();
+        if (err) {
+            goto fail;
+        }
+
+        bd_size_t read = _bds[i]->get_read_size();
+        if (i == 0 || (read >= _read_size && is_aligned(read, _read_size))) {
+            _read_size = read;
+        } else {
+            MBED_ASSERT(_read_size > read && is_aligned(_read_size, read));
+        }
+
+        bd_size_t program = _bds[i]->get_program_size();
+        if (i == 0 || (program >= _program_size && is_aligned(program, _program_size))) {
+            _program_size = program;
+        } else {
+            MBED_ASSERT(_program_size > program && is_aligned(_program_size, program));
+        }
+
+        bd_size_t erase = _bds[i]->get_erase_size();
+        if (i == 0 || (erase >= _erase_size && is_aligned(erase, _erase_size))) {
+            _erase_size = erase;
+        } else {
+            MBED_ASSERT(_erase_size > erase && is_aligned(_erase_size, erase));
+        }
+
+        int value = _bds[i]->get_erase_value();
+        if (i == 0 || value == _erase_value) {
+            _erase_value = value;
+        } else {
+            _erase_value = -1;
+        }
+
+        if (i == 0 || _bds[i]->size() < smallest) {
+            smallest = _bds[i]->size();
+        }
+    }
+
+    // A unit erases whole blocks on every device
+    _unit_size = _stripe_size ? _stripe_size : _erase_size;
+    MBED_ASSERT(is_aligned(_unit_size, _erase_size));
+    _size = (smallest / _unit_size) * _unit_size * _bd_count;
+
+    if (_bd_count > 1) {
+        err = _workers.start(_bd_count);
+        if (err) {
+            goto fail;
+        }
+    }
+
+    _is_initialized = true;
+    return BD_ERROR_OK;
+
+fail:
+    _is_initialized = false;
+    _init_ref_count = 0;
+    return err;
+}
+
+int StripingBlockDevice::deinit()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_OK;
+    }
+
+    uint32_t val = core_util_atomic_decr_u32(&_init_ref_count, 1);
+
+    if (val) {
+        return BD_ERROR_OK;
+    }
+
+    _workers.stop();
+
+    for (size_t i = 0; i < _bd_count; i++) {
+        int err = _bds[i]->deinit();
+        if (err) {
+            return err;
+        }
+    }
+
+    _is_initialized = false;
+    return BD_ERROR_OK;
+}
+
+int StripingBlockDevice::sync()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return dispatch(OP_SYNC, NULL, 0, _size);
+}
+
+int StripingBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_read(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return dispatch(OP_READ, b, addr, size);
+}
+
+int StripingBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_program(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return dispatch(OP_PROGRAM, const_cast<void *>(b), addr, size);
+}
+
+int StripingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return dispatch(OP_ERASE, NULL, addr, size);
+}
+
+int StripingBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return dispatch(OP_TRIM, NULL, addr, size);
+}
+
+bd_size_t StripingBlockDevice::get_read_size() const
+{
+    return _read_size;
+}
+
+bd_size_t StripingBlockDevice::get_program_size() const
+{
+    return _program_size;
+}
+
+bd_size_t StripingBlockDevice::get_erase_size() const
+{
+    return _erase_size;
+}
+
+bd_size_t StripingBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return _erase_size;
+}
+
+int StripingBlockDevice::get_erase_value() const
+{
+    return _erase_value;
+}
+
+bd_size_t StripingBlockDevice::size() const
+{
+    return _size;
+}
+
+bd_size_t StripingBlockDevice::get_stripe_size() const
+{
+    return _unit_size;
+}
+
+int StripingBlockDevice::dispatch(op_t op, void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    if (size == 0) {
+        return BD_ERROR_OK;
+    }
+
+    _mutex.lock();
+    _op = op;
+    _op_buffer = static_cast<uint8_t *>(buffer);
+    _op_addr = addr;
+    _op_size = size;
+
+    // Within a single unit, only one device is involved
+    int err;
+    if (op != OP_SYNC && addr / _unit_size == (addr + size - 1) / _unit_size) {
+        err = serve((addr / _unit_size) % _bd_count);
+    } else if (_bd_count > 1) {
+        err = _workers.run(mbed::callback(this, &StripingBlockDevice::serve));
+    } else {
+        err = serve(0);
+    }
+
+    _mutex.unlock();
+    return err;
+}
+
+int StripingBlockDevice::serve(size_t index)
+{
+    BlockDevice *bd = _bds[index];
+    if (_op == OP_SYNC) {
+        return bd->sync();
+    }
+
+    // First unit of this device at or after the one the operation starts in
+    bd_addr_t end = _op_addr + _op_size;
+    bd_addr_t unit = _op_addr / _unit_size;
+    unit += (index + _bd_count - unit % _bd_count) % _bd_count;
+
+    // The units of a device follow each other on it, erases and trims take a single call
+    bd_addr_t run_addr = 0;
+    bd_size_t run_size = 0;
+
+    for (; unit * _unit_size < end; unit += _bd_count) {
+        bd_addr_t start = unit * _unit_size;
+        bd_addr_t stop = start + _unit_size;
+        if (start < _op_addr) {
+            start = _op_addr;
+        }
+        if (stop > end) {
+            stop = end;
+        }
+        bd_addr_t child_addr = (unit / _bd_count) * _unit_size + start % _unit_size;
+
+        int err = BD_ERROR_OK;
+        switch (_op) {
+            case OP_READ:
+                err = bd->read(_op_buffer + (start - _op_addr), child_addr, stop - start);
+                break;
+            case OP_PROGRAM:
+                err = bd->program(_op_buffer + (start - _op_addr), child_addr, stop - start);
+                break;
+            default:
+                if (!run_size) {
+                    run_addr = child_addr;
+                }
+                run_size += stop - start;
+                break;
+        }
+        if (err) {
+            return err;
+        }
+    }
+
+    if (!run_size) {
+        return BD_ERROR_OK;
+    }
+    return _op == OP_ERASE ? bd->erase(run_addr, run_size) : bd->trim(run_addr, run_size);
+}
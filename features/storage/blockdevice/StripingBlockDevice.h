@@ -0,0 +1,237 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef MBED_STRIPING_BLOCK_DEVICE_H
+#define MBED_STRIPING_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+#include "BlockDeviceWorkers.h"
+#include "platform/mbed_assert.h"
+#include "rtos/Mutex.h"
+
+
+/** Block device for striping data over multiple block devices
+ *
+ *  Consecutive stripe units go to the block devices in turn, so a read or
+ *  program that spans several units is served by several devices at once,
+ *  each from its own worker thread. Accesses within a single unit are served
+ *  on the calling thread.
+ *
+ *  The size is the number of devices times the size of the smallest one,
+ *  rounded down to the stripe unit. Losing one device loses the data of
+ *  all of them.
+ *
+ *  @code
+ *  #include "mbed.h"
+ *  #include "SDBlockDevice.h"
+ *  #include "SPIFBlockDevice.h"
+ *  #include "StripingBlockDevice.h"
+ *
+ *  SDBlockDevice sd(MBED_CONF_SD_SPI_MOSI, MBED_CONF_SD_SPI_MISO, MBED_CONF_SD_SPI_CLK, MBED_CONF_SD_SPI_CS);
+ *  SPIFBlockDevice spif(PTE2, PTE4, PTE1, PTE5);
+ *
+ *  // Stripe 16KB units over both devices
+ *  BlockDevice *bds[] = {&sd, &spif};
+ *  StripingBlockDevice striped(bds, 16 * 1024);
+ *  @endcode
+ */
+class StripingBlockDevice : public BlockDevice {
+public:
+    /** Lifetime of the striping block device
+     *
+     *  @param bds          Array of block devices to stripe data over
+     *  @param bd_count     Number of block devices
+     *  @param stripe_size  Size of a stripe unit, a multiple of the erase size
+     *                      of every device, or 0 for the largest erase size
+     *  @param priority     Priority of the worker threads
+     *  @param stack_size   Stack size of each worker thread in bytes
+     *  @note The block sizes of the devices must be multiples of each other
+     */
+    StripingBlockDevice(BlockDevice **bds, size_t bd_count, bd_size_t stripe_size = 0,
+                        osPriority priority = osPriorityNormal, uint32_t stack_size = OS_STACK_SIZE);
+
+    /** Lifetime of the striping block device
+     *
+     *  @param bds          Array of block devices to stripe data over
+     *  @note The stripe unit is the largest erase size of the devices
+     *  @note The block sizes of the devices must be multiples of each other
+     */
+    template <size_t Size>
+    StripingBlockDevice(BlockDevice *(&bds)[Size])
+        : _bds(bds), _bd_count(sizeof(bds) / sizeof(bds[0])), _stripe_size(0)
+        , _unit_size(0), _read_size(0), _program_size(0), _erase_size(0), _size(0)
+        , _erase_value(-1), _init_ref_count(0), _is_initialized(false)
+    {
+    }
+
+    /** Lifetime of the striping block device
+     */
+    virtual ~StripingBlockDevice();
+
+    /** Initialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int init();
+
+    /** Deinitialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int deinit();
+
+    /** Ensure data on storage is in sync with the driver
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int sync();
+
+    /** Read blocks from a block device
+     *
+     *  @param buffer   Buffer to read blocks into
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Program blocks to a block device
+     *
+     *  The blocks must have been erased prior to being programmed
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Erase blocks on a block device
+     *
+     *  The state of an erased block is undefined until it has been programmed,
+     *  unless get_erase_value returns a non-negative byte value
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int erase(bd_addr_t addr, bd_size_t size);
+
+    /** Mark blocks as no longer in use
+     *
+     *  @param addr     Address of block to mark as unused
+     *  @param size     Size to mark as unused in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int trim(bd_addr_t addr, bd_size_t size);
+
+    /** Get the size of a readable block
+     *
+     *  @return         Size of a readable block in bytes
+     */
+    virtual bd_size_t get_read_size() const;
+
+    /** Get the size of a programmable block
+     *
+     *  @return         Size of a programmable block in bytes
+     *  @note Must be a multiple of the read size
+     */
+    virtual bd_size_t get_program_size() const;
+
+    /** Get the size of an erasable block
+     *
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size() const;
+
+    /** Get the size of an erasable block given address
+     *
+     *  @param addr     Address within the erasable block
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size(bd_addr_t addr) const;
+
+    /** Get the value of storage when erased
+     *
+     *  @return         The value of storage when erased, or -1 if you can't
+     *                  rely on the value of erased storage
+     */
+    virtual int get_erase_value() const;
+
+    /** Get the total size of the underlying device
+     *
+     *  @return         Size of the underlying device in bytes
+     */
+    virtual bd_size_t size() const;
+
+    /** Get the size of a stripe unit
+     *
+     *  @return         Size of the units consecutive addresses are striped in
+     */
+    bd_size_t get_stripe_size() const;
+
+protected:
+    enum op_t {
+        OP_READ,
+        OP_PROGRAM,
+        OP_ERASE,
+        OP_TRIM,
+        OP_SYNC,
+    };
+
+    BlockDevice **_bds;
+    size_t _bd_count;
+    bd_size_t _stripe_size;
+    bd_size_t _unit_size;
+    bd_size_t _read_size;
+    bd_size_t _program_size;
+    bd_size_t _erase_size;
+    bd_size_t _size;
+    int _erase_value;
+    uint32_t _init_ref_count;
+    bool _is_initialized;
+
+    // Operation being served, protected by _mutex
+    rtos::Mutex _mutex;
+    BlockDeviceWorkers _workers;
+    op_t _op;
+    uint8_t *_op_buffer;
+    bd_addr_t _op_addr;
+    bd_size_t _op_size;
+
+    /** Serve an operation spread over the devices
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int dispatch(op_t op, void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Serve the part of the current operation on one device
+     *
+     *  @param index    Index of the device
+     *  @return         0 on success or a negative error code on failure
+     */
+    int serve(size_t index);
+};
+
+
+#endif
@@ -0,0 +1,699 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WearLevelingBlockDevice.h"
+#include "platform/mbed_assert.h"
+#include "platform/mbed_critical.h"
+#include <algorithm>
+#include <stddef.h>
+#include <string.h>
+
+/* Layout of a physical block, every part starting on a program unit:
+ *
+ *   | erase header | allocation header | tag 0 .. tag N-1 | sector 0 .. sector N-1 |
+ *
+ * The erase header is written right after the block is erased, the allocation
+ * header when the block starts receiving sectors, and each tag after its
+ * sector. A tag's magic is the allocation sequence of its block, so tags left
+ * over from an earlier use of the block are never taken for current ones.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t value;
+    uint32_t crc;
+} meta_t;
+
+static const uint32_t erase_magic = 0x57454152;
+static const uint32_t alloc_magic = 0x414C4F43;
+
+static const uint32_t unmapped = 0xFFFFFFFF;
+static const uint32_t no_block = 0xFFFFFFFF;
+static const uint32_t unknown_erase_count = 0xFFFFFFFF;
+
+static const uint32_t min_slots_per_block = 4;
+static const uint32_t min_reserved_blocks = 3;
+
+enum {
+    BLOCK_FREE,     // erased, with an erase header
+    BLOCK_DIRTY,    // must be erased before use
+    BLOCK_USED,     // allocated, holds sectors
+};
+
+static inline uint32_t align_up(bd_size_t val, bd_size_t size)
+{
+    return (((val - 1) / size) + 1) * size;
+}
+
+static uint32_t crc32(const void *data, uint32_t size)
+{
+    const uint8_t *buf = static_cast<const uint8_t *>(data);
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static void make_meta(meta_t &meta, uint32_t magic, uint32_t value)
+{
+    meta.magic = magic;
+    meta.value = value;
+    meta.crc = crc32(&meta, offsetof(meta_t, crc));
+}
+
+static bool check_meta(const meta_t &meta, uint32_t magic)
+{
+    return meta.magic == magic && meta.crc == crc32(&meta, offsetof(meta_t, crc));
+}
+
+// Fill for the unused bytes of metadata, leaving them erased where possible
+int WearLevelingBlockDevice::pad_value() const
+{
+    return _erase_value < 0 ? 0xFF : _erase_value;
+}
+
+WearLevelingBlockDevice::WearLevelingBlockDevice(BlockDevice *bd, bd_size_t sector_size, uint32_t wear_leveling_threshold)
+    : _bd(bd), _sector_size(sector_size), _wl_threshold(wear_leveling_threshold), _block_size(0), _num_blocks(0)
+    , _slots_per_block(0), _num_sectors(0), _header_size(0), _tag_size(0), _data_offset(0), _erase_value(-1)
+    , _map(0), _blocks(0), _tag_buf(0), _sector_buf(0), _meta_buf(0), _active_block(no_block), _active_slot(0)
+    , _next_seq(1), _free_blocks(0), _last_gc_moved_cold(false), _init_ref_count(0), _is_initialized(false)
+{
+}
+
+WearLevelingBlockDevice::~WearLevelingBlockDevice()
+{
+    deinit();
+}
+
+int WearLevelingBlockDevice::init()
+{
+    uint32_t val = core_util_atomic_incr_u32(&_init_ref_count, 1);
+
+    if (val != 1) {
+        return BD_ERROR_OK;
+    }
+
+    int err = _bd->init();
+    if (err) {
+        goto fail;
+    }
+
+    err = setup_geometry();
+    if (err) {
+        goto fail_bd;
+    }
+
+    _map = new uint32_t[_num_sectors];
+    _blocks = new block_info_t[_num_blocks];
+    _tag_buf = new uint8_t[_slots_per_block * _tag_size];
+    _sector_buf = new uint8_t[_sector_size];
+    _meta_buf = new uint8_t[_header_size];
+
+    err = mount();
+    if (err) {
+        release();
+        goto fail_bd;
+    }
+
+    _is_initialized = true;
+    return BD_ERROR_OK;
+
+fail_bd:
+    _bd->deinit();
+fail:
+    _init_ref_count = 0;
+    return err;
+}
+
+int WearLevelingBlockDevice::deinit()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_OK;
+    }
+
+    uint32_t val = core_util_atomic_decr_u32(&_init_ref_count, 1);
+
+    if (val) {
+        return BD_ERROR_OK;
+    }
+
+    release();
+    _is_initialized = false;
+    return _bd->deinit();
+}
+
+void WearLevelingBlockDevice::release()
+{
+    delete[] _map;
+    delete[] _blocks;
+    delete[] _tag_buf;
+    delete[] _sector_buf;
+    delete[] _meta_buf;
+    _map = 0;
+    _blocks = 0;
+    _tag_buf = 0;
+    _sector_buf = 0;
+    _meta_buf = 0;
+}
+
+int WearLevelingBlockDevice::setup_geometry()
+{
+    bd_size_t read_size = _bd->get_read_size();
+    bd_size_t program_size = _bd->get_program_size();
+    bd_size_t erase_size = _bd->get_erase_size();
+
+    if (!_sector_size || (_sector_size % program_size) || (_sector_size % read_size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _erase_value = _bd->get_erase_value();
+    _header_size = align_up(sizeof(meta_t), program_size);
+    _tag_size = _header_size;
+
+    // Group erase units until a block holds enough sectors for garbage collection to pay off
+    bd_size_t data_align = std::max(program_size, read_size);
+    _slots_per_block = 0;
+    for (_block_size = erase_size; _block_size <= _bd->size(); _block_size += erase_size) {
+        if (_block_size <= 2 * _header_size) {
+            continue;
+        }
+        uint32_t slots = (_block_size - 2 * _header_size) / (_sector_size + _tag_size);
+        while (slots && align_up(2 * _header_size + slots * _tag_size, data_align) + slots * _sector_size > _block_size) {
+            slots--;
+        }
+        if (slots >= min_slots_per_block) {
+            _slots_per_block = std::min<uint32_t>(slots, 0xFFFF);
+            _data_offset = align_up(2 * _header_size + _slots_per_block * _tag_size, data_align);
+            break;
+        }
+    }
+    if (!_slots_per_block) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _num_blocks = _bd->size() / _block_size;
+    uint32_t reserved = min_reserved_blocks + _num_blocks / 16;
+    if (_num_blocks <= reserved) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    _num_sectors = (_num_blocks - reserved) * _slots_per_block;
+    return BD_ERROR_OK;
+}
+
+bool WearLevelingBlockDevice::is_blank(bd_addr_t addr, bd_size_t size)
+{
+    if (_erase_value < 0) {
+        return true;
+    }
+    while (size) {
+        bd_size_t chunk = std::min<bd_size_t>(size, _sector_size);
+        if (_bd->read(_sector_buf, addr, chunk)) {
+            return false;
+        }
+        for (bd_size_t i = 0; i < chunk; i++) {
+            if (_sector_buf[i] != (uint8_t)_erase_value) {
+                return false;
+            }
+        }
+        addr += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+int WearLevelingBlockDevice::read_tags(uint32_t block)
+{
+    return _bd->read(_tag_buf, (bd_addr_t)block * _block_size + 2 * _header_size,
+                     _slots_per_block * _tag_size);
+}
+
+bool WearLevelingBlockDevice::decode_tag(uint32_t block, uint32_t slot, uint32_t &lsn) const
+{
+    meta_t tag;
+    memcpy(&tag, _tag_buf + slot * _tag_size, sizeof(tag));
+    if (!check_meta(tag, _blocks[block].seq) || (tag.value >= _num_sectors)) {
+        return false;
+    }
+    lsn = tag.value;
+    return true;
+}
+
+int WearLevelingBlockDevice::mount()
+{
+    uint64_t known_sum = 0;
+    uint32_t known = 0;
+    uint32_t newest = no_block;
+    meta_t meta;
+    int err;
+
+    for (uint32_t b = 0; b < _num_blocks; b++) {
+        bd_addr_t addr = (bd_addr_t)b * _block_size;
+        _blocks[b].erase_count = unknown_erase_count;
+        _blocks[b].seq = 0;
+        _blocks[b].valid = 0;
+        _blocks[b].state = BLOCK_DIRTY;
+
+        err = _bd->read(_meta_buf, addr, _header_size);
+        if (err) {
+            return err;
+        }
+        memcpy(&meta, _meta_buf, sizeof(meta));
+        if (!check_meta(meta, erase_magic)) {
+            continue;
+        }
+        _blocks[b].erase_count = meta.value;
+        known_sum += meta.value;
+        known++;
+
+        err = _bd->read(_meta_buf, addr + _header_size, _header_size);
+        if (err) {
+            return err;
+        }
+        memcpy(&meta, _meta_buf, sizeof(meta));
+        if (check_meta(meta, alloc_magic)) {
+            _blocks[b].state = BLOCK_USED;
+            _blocks[b].seq = meta.value;
+            if (newest == no_block || (int32_t)(meta.value - _blocks[newest].seq) > 0) {
+                newest = b;
+            }
+        } else if (is_blank(addr + _header_size, _header_size)) {
+            _blocks[b].state = BLOCK_FREE;
+        }
+    }
+
+    // Blocks caught mid-erase lost their count; assume average wear
+    uint32_t average = known ? known_sum / known : 0;
+    _free_blocks = 0;
+    for (uint32_t b = 0; b < _num_blocks; b++) {
+        if (_blocks[b].erase_count == unknown_erase_count) {
+            _blocks[b].erase_count = average;
+        }
+        if (_blocks[b].state != BLOCK_USED) {
+            _free_blocks++;
+        }
+    }
+
+    // The copy in the newest block wins, and within a block the last one
+    for (uint32_t lsn = 0; lsn < _num_sectors; lsn++) {
+        _map[lsn] = unmapped;
+    }
+    for (uint32_t b = 0; b < _num_blocks; b++) {
+        if (_blocks[b].state != BLOCK_USED) {
+            continue;
+        }
+        err = read_tags(b);
+        if (err) {
+            return err;
+        }
+        for (uint32_t slot = 0; slot < _slots_per_block; slot++) {
+            uint32_t lsn;
+            if (!decode_tag(b, slot, lsn)) {
+                continue;
+            }
+            uint32_t current = _map[lsn];
+            if (current == unmapped || current / _slots_per_block == b ||
+                    (int32_t)(_blocks[b].seq - _blocks[current / _slots_per_block].seq) > 0) {
+                _map[lsn] = b * _slots_per_block + slot;
+            }
+        }
+    }
+    for (uint32_t lsn = 0; lsn < _num_sectors; lsn++) {
+        if (_map[lsn] != unmapped) {
+            _blocks[_map[lsn] / _slots_per_block].valid++;
+        }
+    }
+
+    _active_block = newest;
+    _active_slot = _slots_per_block;
+    _next_seq = 1;
+    _last_gc_moved_cold = false;
+    if (newest == no_block) {
+        return BD_ERROR_OK;
+    }
+    _next_seq = _blocks[newest].seq + 1;
+
+    // Writing resumes after the last tag of the newest block, past a sector that may have been cut short
+    err = read_tags(newest);
+    if (err) {
+        return err;
+    }
+    _active_slot = 0;
+    for (uint32_t slot = 0; slot < _slots_per_block; slot++) {
+        uint32_t lsn;
+        bool blank = true;
+        if (_erase_value < 0) {
+            blank = !decode_tag(newest, slot, lsn);
+        } else {
+            for (uint32_t i = 0; i < _tag_size; i++) {
+                if (_tag_buf[slot * _tag_size + i] != (uint8_t)_erase_value) {
+                    blank = false;
+                    break;
+                }
+            }
+        }
+        if (!blank) {
+            _active_slot = slot + 1;
+        }
+    }
+    if (_active_slot < _slots_per_block &&
+            !is_blank((bd_addr_t)newest * _block_size + _data_offset + _active_slot * _sector_size, _sector_size)) {
+        _active_slot++;
+    }
+    return BD_ERROR_OK;
+}
+
+int WearLevelingBlockDevice::format_block(uint32_t block)
+{
+    bd_addr_t addr = (bd_addr_t)block * _block_size;
+
+    int err = _bd->erase(addr, _block_size);
+    if (err) {
+        return err;
+    }
+    _blocks[block].erase_count++;
+
+    meta_t meta;
+    make_meta(meta, erase_magic, _blocks[block].erase_count);
+    memset(_meta_buf, pad_value(), _header_size);
+    memcpy(_meta_buf, &meta, sizeof(meta));
+    err = _bd->program(_meta_buf, addr, _header_size);
+    if (err) {
+        return err;
+    }
+    _blocks[block].state = BLOCK_FREE;
+    return BD_ERROR_OK;
+}
+
+int WearLevelingBlockDevice::allocate_block()
+{
+    uint32_t block = no_block;
+    for (uint32_t b = 0; b < _num_blocks; b++) {
+        if (_blocks[b].state != BLOCK_USED &&
+                (block == no_block || _blocks[b].erase_count < _blocks[block].erase_count)) {
+            block = b;
+        }
+    }
+    if (block == no_block) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    int err;
+    if (_blocks[block].state == BLOCK_DIRTY) {
+        err = format_block(block);
+        if (err) {
+            return err;
+        }
+    }
+
+    meta_t meta;
+    make_meta(meta, alloc_magic, _next_seq);
+    memset(_meta_buf, pad_value(), _header_size);
+    memcpy(_meta_buf, &meta, sizeof(meta));
+    err = _bd->program(_meta_buf, (bd_addr_t)block * _block_size + _header_size, _header_size);
+    if (err) {
+        _blocks[block].state = BLOCK_DIRTY;
+        return err;
+    }
+
+    _blocks[block].state = BLOCK_USED;
+    _blocks[block].seq = _next_seq++;
+    _blocks[block].valid = 0;
+    _free_blocks--;
+    _active_block = block;
+    _active_slot = 0;
+    return BD_ERROR_OK;
+}
+
+void WearLevelingBlockDevice::unmap(uint32_t lsn)
+{
+    if (_map[lsn] != unmapped) {
+        _blocks[_map[lsn] / _slots_per_block].valid--;
+        _map[lsn] = unmapped;
+    }
+}
+
+int WearLevelingBlockDevice::append(uint32_t lsn, const void *data)
+{
+    int err;
+
+    if (_active_block == no_block || _active_slot >= _slots_per_block) {
+        err = allocate_block();
+        if (err) {
+            return err;
+        }
+    }
+
+    // A slot is used up even if writing it fails
+    uint32_t slot = _active_slot++;
+    bd_addr_t addr = (bd_addr_t)_active_block * _block_size;
+    err = _bd->program(data, addr + _data_offset + slot * _sector_size, _sector_size);
+    if (err) {
+        return err;
+    }
+
+    meta_t tag;
+    make_meta(tag, _blocks[_active_block].seq, lsn);
+    memset(_meta_buf, pad_value(), _tag_size);
+    memcpy(_meta_buf, &tag, sizeof(tag));
+    err = _bd->program(_meta_buf, addr + 2 * _header_size + slot * _tag_size, _tag_size);
+    if (err) {
+        return err;
+    }
+
+    unmap(lsn);
+    _map[lsn] = _active_block * _slots_per_block + slot;
+    _blocks[_active_block].valid++;
+    return BD_ERROR_OK;
+}
+
+int WearLevelingBlockDevice::garbage_collect()
+{
+    uint32_t greedy = no_block;
+    uint32_t cold = no_block;
+    uint32_t max_erase_count = 0;
+
+    // Without a free block the live sectors must fit in the active block
+    uint32_t room = _slots_per_block;
+    if (_free_blocks == 0) {
+        room = (_active_block == no_block) ? 0 : _slots_per_block - _active_slot;
+    }
+
+    for (uint32_t b = 0; b < _num_blocks; b++) {
+        max_erase_count = std::max(max_erase_count, _blocks[b].erase_count);
+        if (_blocks[b].state != BLOCK_USED || b == _active_block || _blocks[b].valid > room) {
+            continue;
+        }
+        if (greedy == no_block || _blocks[b].valid < _blocks[greedy].valid ||
+                (_blocks[b].valid == _blocks[greedy].valid && _blocks[b].erase_count < _blocks[greedy].erase_count)) {
+            greedy = b;
+        }
+        if (cold == no_block || _blocks[b].erase_count < _blocks[cold].erase_count) {
+            cold = b;
+        }
+    }
+    if (greedy == no_block) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    // Moving a block of cold data frees nothing, so alternate it with a reclaiming collection
+    uint32_t victim = greedy;
+    _last_gc_moved_cold = !_last_gc_moved_cold && (max_erase_count - _blocks[cold].erase_count > _wl_threshold);
+    if (_last_gc_moved_cold) {
+        victim = cold;
+    }
+
+    int err = read_tags(victim);
+    if (err) {
+        return err;
+    }
+    bd_addr_t addr = (bd_addr_t)victim * _block_size;
+    for (uint32_t slot = 0; slot < _slots_per_block && _blocks[victim].valid; slot++) {
+        uint32_t lsn;
+        if (!decode_tag(victim, slot, lsn) || _map[lsn] != victim * _slots_per_block + slot) {
+            continue;
+        }
+        err = _bd->read(_sector_buf, addr + _data_offset + slot * _sector_size, _sector_size);
+        if (err) {
+            return err;
+        }
+        err = append(lsn, _sector_buf);
+        if (err) {
+            return err;
+        }
+    }
+
+    err = format_block(victim);
+    if (err) {
+        _blocks[victim].state = BLOCK_DIRTY;
+    }
+    _free_blocks++;
+    return err;
+}
+
+int WearLevelingBlockDevice::make_room()
+{
+    // Power loss during garbage collection can leave no free block behind,
+    // so first collect into the room left in the active block
+    while (_free_blocks == 0) {
+        int err = garbage_collect();
+        if (err) {
+            return err;
+        }
+    }
+
+    while (_active_block == no_block || _active_slot >= _slots_per_block) {
+        // The last free block is kept for garbage collection to copy into
+        if (_free_blocks > 1) {
+            return allocate_block();
+        }
+        int err = garbage_collect();
+        if (err) {
+            return err;
+        }
+    }
+    return BD_ERROR_OK;
+}
+
+int WearLevelingBlockDevice::sync()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return _bd->sync();
+}
+
+int WearLevelingBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_read(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    uint8_t *buf = static_cast<uint8_t *>(b);
+    for (uint32_t lsn = addr / _sector_size; size; lsn++) {
+        uint32_t phys = _map[lsn];
+        if (phys == unmapped) {
+            memset(buf, 0xFF, _sector_size);
+        } else {
+            bd_addr_t phys_addr = (bd_addr_t)(phys / _slots_per_block) * _block_size + _data_offset +
+                                  (phys % _slots_per_block) * _sector_size;
+            int err = _bd->read(buf, phys_addr, _sector_size);
+            if (err) {
+                return err;
+            }
+        }
+        buf += _sector_size;
+        size -= _sector_size;
+    }
+
+    return 0;
+}
+
+int WearLevelingBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_program(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    const uint8_t *buf = static_cast<const uint8_t *>(b);
+    for (uint32_t lsn = addr / _sector_size; size; lsn++) {
+        int err = make_room();
+        if (err) {
+            return err;
+        }
+        err = append(lsn, buf);
+        if (err) {
+            return err;
+        }
+        buf += _sector_size;
+        size -= _sector_size;
+    }
+
+    return 0;
+}
+
+int WearLevelingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    for (uint32_t lsn = addr / _sector_size; size; lsn++) {
+        unmap(lsn);
+        size -= _sector_size;
+    }
+
+    return 0;
+}
+
+int WearLevelingBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    return erase(addr, size);
+}
+
+bd_size_t WearLevelingBlockDevice::get_read_size() const
+{
+    return _sector_size;
+}
+
+bd_size_t WearLevelingBlockDevice::get_program_size() const
+{
+    return _sector_size;
+}
+
+bd_size_t WearLevelingBlockDevice::get_erase_size() const
+{
+    return _sector_size;
+}
+
+bd_size_t WearLevelingBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return _sector_size;
+}
+
+int WearLevelingBlockDevice::get_erase_value() const
+{
+    return -1;
+}
+
+bd_size_t WearLevelingBlockDevice::size() const
+{
+    if (!_is_initialized) {
+        return 0;
+    }
+
+    return (bd_size_t)_num_sectors * _sector_size;
+}
+
+int WearLevelingBlockDevice::get_erase_counts(uint32_t &min, uint32_t &max) const
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    min = max = _blocks[0].erase_count;
+    for (uint32_t b = 1; b < _num_blocks; b++) {
+        min = std::min(min, _blocks[b].erase_count);
+        max = std::max(max, _blocks[b].erase_count);
+    }
+    return 0;
+}
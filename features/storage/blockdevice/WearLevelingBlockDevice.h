@@ -0,0 +1,291 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef MBED_WEAR_LEVELING_BLOCK_DEVICE_H
+#define MBED_WEAR_LEVELING_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+
+
+/** Flash translation layer presenting small, freely rewritable sectors on top of
+ *  a flash block device, for file systems such as FATFileSystem on NOR flash.
+ *
+ *  Every sector write goes to the next free slot of a log of physical blocks,
+ *  and the previous copy of the sector is merely forgotten, so rewriting a
+ *  512-byte sector never erases or rewrites the rest of its erase block. When
+ *  no free block is left, garbage collection moves the live sectors out of the
+ *  block with the fewest of them and erases it. Blocks are allocated least worn
+ *  first, and a block holding rarely written data is moved once its erase
+ *  count falls too far behind, so wear spreads over the whole device.
+ *
+ *  Each physical block (one or more erase units) starts with its erase count
+ *  and an allocation sequence number, followed by a tag per slot naming the
+ *  logical sector stored there. A tag is programmed after its data, so a write
+ *  interrupted by power loss leaves the previous copy of the sector in place.
+ *
+ *  Erasing or trimming sectors only drops them from the map, and the content
+ *  of a dropped sector is undefined, so get_erase_value returns -1. The map
+ *  takes 4 bytes of RAM per logical sector. About one block in sixteen, and
+ *  at least three, is kept back for garbage collection.
+ *
+ *  @code
+ *  #include "SPIFBlockDevice.h"
+ *  #include "WearLevelingBlockDevice.h"
+ *  #include "FATFileSystem.h"
+ *
+ *  SPIFBlockDevice spif(PTE2, PTE4, PTE1, PTE5);
+ *  WearLevelingBlockDevice ftl(&spif);
+ *  FATFileSystem fs("fs", &ftl);
+ *  @endcode
+ */
+class WearLevelingBlockDevice : public BlockDevice {
+public:
+    /** Lifetime of the wear leveling block device
+     *
+     *  @param bd           Block device to back the WearLevelingBlockDevice
+     *  @param sector_size  Size of the sectors presented, a multiple of the
+     *                      program and read sizes of the underlying device
+     *  @param wear_leveling_threshold  Difference in erase counts at which a
+     *                      block of rarely written data is moved
+     */
+    WearLevelingBlockDevice(BlockDevice *bd, bd_size_t sector_size = 512, uint32_t wear_leveling_threshold = 32);
+
+    /** Lifetime of a block device
+     */
+    virtual ~WearLevelingBlockDevice();
+
+    /** Initialize a block device, rebuilding the sector map from the underlying device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int init();
+
+    /** Deinitialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int deinit();
+
+    /** Ensure data on storage is in sync with the driver
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int sync();
+
+    /** Read blocks from a block device
+     *
+     *  @param buffer   Buffer to read blocks into
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Program blocks to a block device
+     *
+     *  Sectors are written out of place, so they need not be erased first
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Erase blocks on a block device
+     *
+     *  Drops the sectors from the map, without touching the underlying device
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int erase(bd_addr_t addr, bd_size_t size);
+
+    /** Mark blocks as no longer in use
+     *
+     *  Dropped sectors are not copied by garbage collection
+     *
+     *  @param addr     Address of block to mark as unused
+     *  @param size     Size to mark as unused in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int trim(bd_addr_t addr, bd_size_t size);
+
+    /** Get the size of a readable block
+     *
+     *  @return         Size of a readable block in bytes
+     */
+    virtual bd_size_t get_read_size() const;
+
+    /** Get the size of a programmable block
+     *
+     *  @return         Size of a programmable block in bytes
+     *  @note Must be a multiple of the read size
+     */
+    virtual bd_size_t get_program_size() const;
+
+    /** Get the size of an erasable block
+     *
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size() const;
+
+    /** Get the size of an erasable block given address
+     *
+     *  @param addr     Address within the erasable block
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size(bd_addr_t addr) const;
+
+    /** Get the value of storage when erased
+     *
+     *  @return         -1, as erased sectors are only dropped from the map
+     */
+    virtual int get_erase_value() const;
+
+    /** Get the total size of the logical sectors
+     *
+     *  @return         Size of the device in bytes, less the space kept back
+     *                  for metadata and garbage collection
+     */
+    virtual bd_size_t size() const;
+
+    /** Get the lowest and highest erase counts of the underlying blocks
+     *
+     *  @param min      Lowest erase count
+     *  @param max      Highest erase count
+     *  @return         0 on success, negative error code on failure
+     */
+    int get_erase_counts(uint32_t &min, uint32_t &max) const;
+
+protected:
+    struct block_info_t {
+        uint32_t erase_count;
+        uint32_t seq;
+        uint16_t valid;
+        uint8_t state;
+    };
+
+    BlockDevice *_bd;
+    bd_size_t _sector_size;
+    uint32_t _wl_threshold;
+    bd_size_t _block_size;
+    uint32_t _num_blocks;
+    uint32_t _slots_per_block;
+    uint32_t _num_sectors;
+    uint32_t _header_size;
+    uint32_t _tag_size;
+    uint32_t _data_offset;
+    int _erase_value;
+    uint32_t *_map;
+    block_info_t *_blocks;
+    uint8_t *_tag_buf;
+    uint8_t *_sector_buf;
+    uint8_t *_meta_buf;
+    uint32_t _active_block;
+    uint32_t _active_slot;
+    uint32_t _next_seq;
+    uint32_t _free_blocks;
+    bool _last_gc_moved_cold;
+    uint32_t _init_ref_count;
+    bool _is_initialized;
+
+    /** Compute the layout of a physical block from the underlying geometry
+     *
+     *  @return         0 on success, negative error code if the device is too small
+     */
+    int setup_geometry();
+
+    /** Read the headers and tags of all blocks, and rebuild the sector map
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int mount();
+
+    /** Read the tags of a block into the tag buffer
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int read_tags(uint32_t block);
+
+    /** Decode a tag read by read_tags
+     *
+     *  @param block    Block the tags were read from
+     *  @param slot     Slot of the tag
+     *  @param lsn      Logical sector stored in the slot
+     *  @return         True if the tag is intact and belongs to the current use of the block
+     */
+    bool decode_tag(uint32_t block, uint32_t slot, uint32_t &lsn) const;
+
+    /** Check that a range of the underlying device is erased
+     *
+     *  @return         True if erased, or if the erase value is unknown
+     */
+    bool is_blank(bd_addr_t addr, bd_size_t size);
+
+    /** Erase a block and record its new erase count on it
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int format_block(uint32_t block);
+
+    /** Make the least worn free block the active one
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int allocate_block();
+
+    /** Make room for at least one sector in the active block
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int make_room();
+
+    /** Move the live sectors out of a block and erase it
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int garbage_collect();
+
+    /** Append a sector to the active block and point the map at it
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int append(uint32_t lsn, const void *data);
+
+    /** Drop a sector from the map
+     */
+    void unmap(uint32_t lsn);
+
+    /** Free the memory allocated by init
+     */
+    void release();
+
+    /** Get the byte used to pad metadata
+     */
+    int pad_value() const;
+};
+
+
+#endif
@@ -0,0 +1,1075 @@
+/*
+ * Copyright (c) 2018 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// ----------------------------------------------------------- Includes -----------------------------------------------------------
+
+#include "JournalKVStore.h"
+
+#include <algorithm>
+#include <new>
+#include <string.h>
+
+// --------------------------------------------------------- Definitions ----------------------------------------------------------
+
+/*
+ * Record layout in an area, every part starting on a program unit:
+ *
+ *   | header | key | value | padding |
+ *
+ * The header is programmed last and commits the record. Its CRC covers the
+ * header fields before the version, the key and the value. The version
+ * stamps the record with its area's version, and is left out of the CRC so
+ * garbage collection can copy records without reading them twice.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t header_size;
+    uint16_t key_size;
+    uint32_t flags;
+    uint32_t data_size;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t crc;
+} record_header_t;
+
+typedef struct {
+    uint16_t version;
+    uint16_t reserved;
+} master_record_data_t;
+
+static const uint32_t record_magic = 0x4A4B5653;
+
+static const uint32_t crc_covered_size = offsetof(record_header_t, version);
+
+// Internal flags live in the upper bits, user flags in the lower ones
+static const uint32_t master_flag     = 0x80000000UL;
+static const uint32_t delete_flag     = 0x40000000UL;
+static const uint32_t user_flags_mask = JournalKVStore::WRITE_ONCE_FLAG;
+
+static const uint32_t min_work_buf_size = 64;
+static const size_t initial_ram_table_size = 16;
+
+static const uint8_t blank_flash_val = 0xFF;
+
+static const uint32_t initial_crc = 0xFFFFFFFF;
+
+// -------------------------------------------------- Functions Implementation ----------------------------------------------------
+
+// Align a value to a specified size.
+// Parameters :
+// val           - [IN]   Value.
+// size          - [IN]   Size.
+// Return        : Aligned value.
+static inline uint32_t align_up(uint32_t val, uint32_t size)
+{
+    return (((val + size - 1) / size)) * size;
+}
+
+// CRC32 calculation, four bits at a time. Supports "rolling" calculation (using the initial value).
+// Parameters :
+// init_crc      - [IN]   Initial CRC.
+// data_size     - [IN]   Buffer's data size.
+// data_buf      - [IN]   Data buffer.
+// Return        : CRC.
+static uint32_t crc32(uint32_t init_crc, uint32_t data_size, const void *data_buf)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint8_t *data = static_cast<const uint8_t *>(data_buf);
+    uint32_t crc = init_crc;
+
+    for (uint32_t i = 0; i < data_size; i++) {
+        crc = (crc >> 4) ^ table[(crc ^ data[i]) & 0xF];
+        crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 4)) & 0xF];
+    }
+    return crc;
+}
+
+// FNV-1a hash of a key, used to order the RAM index.
+// Parameters :
+// key           - [IN]   Null terminated key.
+// Return        : Hash.
+static uint32_t key_hash(const char *key)
+{
+    uint32_t hash = 2166136261UL;
+
+    while (*key) {
+        hash = (hash ^ (uint8_t) *key++) * 16777619UL;
+    }
+    return hash;
+}
+
+JournalKVStore::JournalKVStore(BlockDevice *bd) :
+    _bd(bd), _is_initialized(false), _active_area(0), _active_area_version(0), _area_size(0),
+    _free_space_offset(0), _prog_size(0), _read_size(0), _header_slot_size(0), _master_record_size(0),
+    _erase_value(-1), _ram_table(0), _num_keys(0), _ram_table_size(0), _work_buf(0), _write_buf(0),
+    _read_buf(0), _work_buf_size(0), _key_buf(0)
+{
+    _area_addr[0] = _area_addr[1] = 0;
+    memset(&_inc_set, 0, sizeof(_inc_set));
+}
+
+JournalKVStore::~JournalKVStore()
+{
+    deinit();
+}
+
+int JournalKVStore::read_area(uint8_t area, uint32_t offset, uint32_t size, void *buf)
+{
+    uint8_t *out = static_cast<uint8_t *>(buf);
+    bd_addr_t addr = _area_addr[area] + offset;
+
+    // Reads on devices with a read unit go through a bounce buffer at the unaligned ends
+    while (size) {
+        uint32_t misalign = addr % _read_size;
+        if (!misalign && size >= _read_size) {
+            uint32_t chunk = size - size % _read_size;
+            if (_bd->read(out, addr, chunk)) {
+                return JOURNAL_KV_READ_ERROR;
+            }
+            addr += chunk;
+            out += chunk;
+            size -= chunk;
+            continue;
+        }
+        if (_bd->read(_read_buf, addr - misalign, _read_size)) {
+            return JOURNAL_KV_READ_ERROR;
+        }
+        uint32_t chunk = std::min(size, _read_size - misalign);
+        memcpy(out, _read_buf + misalign, chunk);
+        addr += chunk;
+        out += chunk;
+        size -= chunk;
+    }
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::write_area(uint8_t area, uint32_t offset, uint32_t size, const void *buf)
+{
+    if (_bd->program(buf, _area_addr[area] + offset, size)) {
+        return JOURNAL_KV_WRITE_ERROR;
+    }
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::erase_area(uint8_t area)
+{
+    if (_bd->erase(_area_addr[area], _area_size)) {
+        return JOURNAL_KV_WRITE_ERROR;
+    }
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::check_blank(uint8_t area, uint32_t offset, bool &blank)
+{
+    blank = true;
+
+    // Without a known erase value, stale bytes are told apart by the version stamp instead
+    if (_erase_value < 0) {
+        return JOURNAL_KV_SUCCESS;
+    }
+
+    while (offset < _area_size) {
+        uint32_t chunk = std::min(_work_buf_size, _area_size - offset);
+        int ret = read_area(area, offset, chunk, _work_buf);
+        if (ret) {
+            return ret;
+        }
+        for (uint32_t i = 0; i < chunk; i++) {
+            if (_work_buf[i] != (uint8_t) _erase_value) {
+                blank = false;
+                return JOURNAL_KV_SUCCESS;
+            }
+        }
+        offset += chunk;
+    }
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::read_header(uint8_t area, uint32_t offset, void *header, bool &valid)
+{
+    record_header_t *hdr = static_cast<record_header_t *>(header);
+
+    valid = false;
+    if (offset + _header_slot_size > _area_size) {
+        return JOURNAL_KV_SUCCESS;
+    }
+    int ret = read_area(area, offset, sizeof(record_header_t), hdr);
+    if (ret) {
+        return ret;
+    }
+    if ((hdr->magic != record_magic) || (hdr->header_size != sizeof(record_header_t)) ||
+            (hdr->key_size > max_key_size)) {
+        return JOURNAL_KV_SUCCESS;
+    }
+    // Widen before adding, so a corrupt size cannot wrap around
+    uint64_t record_size = (uint64_t) _header_slot_size + hdr->key_size + hdr->data_size;
+    if (offset + record_size > _area_size) {
+        return JOURNAL_KV_SUCCESS;
+    }
+    valid = true;
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::read_record(uint8_t area, uint32_t offset, uint16_t version, char *key,
+                                uint32_t &header_flags, uint32_t &data_size, uint32_t &next_offset, bool &valid)
+{
+    record_header_t hdr;
+
+    int ret = read_header(area, offset, &hdr, valid);
+    if (ret || !valid) {
+        return ret;
+    }
+    valid = false;
+    if (!(hdr.flags & master_flag) && (hdr.version != version)) {
+        return JOURNAL_KV_SUCCESS;
+    }
+
+    uint32_t crc = crc32(initial_crc, crc_covered_size, &hdr);
+    uint32_t data_offset = offset + _header_slot_size;
+    ret = read_area(area, data_offset, hdr.key_size, key);
+    if (ret) {
+        return ret;
+    }
+    key[hdr.key_size] = '\0';
+    crc = crc32(crc, hdr.key_size, key);
+    data_offset += hdr.key_size;
+
+    uint32_t left = hdr.data_size;
+    while (left) {
+        uint32_t chunk = std::min(left, _work_buf_size);
+        ret = read_area(area, data_offset, chunk, _work_buf);
+        if (ret) {
+            return ret;
+        }
+        crc = crc32(crc, chunk, _work_buf);
+        data_offset += chunk;
+        left -= chunk;
+    }
+
+    next_offset = offset + _header_slot_size + align_up(hdr.key_size + hdr.data_size, _prog_size);
+    if (crc != hdr.crc) {
+        return JOURNAL_KV_DATA_CORRUPT;
+    }
+    header_flags = hdr.flags;
+    data_size = hdr.data_size;
+    valid = true;
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::write_master_record(uint8_t area, uint16_t version)
+{
+    record_header_t hdr;
+    master_record_data_t data;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = record_magic;
+    hdr.header_size = sizeof(record_header_t);
+    hdr.flags = master_flag;
+    hdr.data_size = sizeof(data);
+    hdr.version = version;
+    data.version = version;
+    data.reserved = 0;
+    hdr.crc = crc32(crc32(initial_crc, crc_covered_size, &hdr), sizeof(data), &data);
+
+    memset(_write_buf, blank_flash_val, _master_record_size);
+    memcpy(_write_buf, &hdr, sizeof(hdr));
+    memcpy(_write_buf + _header_slot_size, &data, sizeof(data));
+    int ret = write_area(area, 0, _master_record_size, _write_buf);
+    if (ret) {
+        return ret;
+    }
+
+    // The master record commits the area, so make sure it reached the device
+    uint16_t read_version;
+    bool valid;
+    ret = read_master_record(area, read_version, valid);
+    if (ret) {
+        return ret;
+    }
+    if (!valid || (read_version != version)) {
+        return JOURNAL_KV_WRITE_ERROR;
+    }
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::read_master_record(uint8_t area, uint16_t &version, bool &valid)
+{
+    record_header_t hdr;
+    master_record_data_t data;
+
+    int ret = read_header(area, 0, &hdr, valid);
+    if (ret || !valid) {
+        return ret;
+    }
+    valid = false;
+    if (!(hdr.flags & master_flag) || (hdr.key_size != 0) || (hdr.data_size != sizeof(data))) {
+        return JOURNAL_KV_SUCCESS;
+    }
+    ret = read_area(area, _header_slot_size, sizeof(data), &data);
+    if (ret) {
+        return ret;
+    }
+    if (crc32(crc32(initial_crc, crc_covered_size, &hdr), sizeof(data), &data) != hdr.crc) {
+        return JOURNAL_KV_SUCCESS;
+    }
+    version = data.version;
+    valid = true;
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::copy_record(uint8_t from_area, uint32_t from_offset, uint32_t to_offset,
+                                uint16_t to_version, uint32_t &next_offset)
+{
+    record_header_t hdr;
+    bool valid;
+
+    int ret = read_header(from_area, from_offset, &hdr, valid);
+    if (ret) {
+        return ret;
+    }
+    if (!valid) {
+        return JOURNAL_KV_DATA_CORRUPT;
+    }
+
+    // Key, value and padding are copied as they are; the CRC stays valid
+    uint32_t left = align_up(hdr.key_size + hdr.data_size, _prog_size);
+    uint32_t from = from_offset + _header_slot_size;
+    uint32_t to = to_offset + _header_slot_size;
+    while (left) {
+        uint32_t chunk = std::min(left, _work_buf_size);
+        ret = read_area(from_area, from, chunk, _work_buf);
+        if (ret) {
+            return ret;
+        }
+        ret = write_area(1 - from_area, to, chunk, _work_buf);
+        if (ret) {
+            return ret;
+        }
+        from += chunk;
+        to += chunk;
+        left -= chunk;
+    }
+
+    hdr.version = to_version;
+    memset(_write_buf, blank_flash_val, _header_slot_size);
+    memcpy(_write_buf, &hdr, sizeof(hdr));
+    ret = write_area(1 - from_area, to_offset, _header_slot_size, _write_buf);
+    if (ret) {
+        return ret;
+    }
+    next_offset = to;
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::do_garbage_collection()
+{
+    uint8_t to_area = 1 - _active_area;
+    uint16_t to_version = _active_area_version + 1;
+    uint32_t offset = _master_record_size;
+    int ret;
+
+    ret = erase_area(to_area);
+    if (ret) {
+        return ret;
+    }
+
+    for (size_t i = 0; i < _num_keys; i++) {
+        ret = copy_record(_active_area, _ram_table[i].offset, offset, to_version, offset);
+        if (ret) {
+            return ret;
+        }
+    }
+
+    // Check the copies before committing them, as some devices drop writes to worn blocks
+    char key[max_key_size + 1];
+    uint32_t verify_offset = _master_record_size;
+    for (size_t i = 0; i < _num_keys; i++) {
+        uint32_t flags, data_size;
+        bool valid;
+        ret = read_record(to_area, verify_offset, to_version, key, flags, data_size, verify_offset, valid);
+        if (ret == JOURNAL_KV_DATA_CORRUPT) {
+            return JOURNAL_KV_WRITE_ERROR;
+        }
+        if (ret) {
+            return ret;
+        }
+        if (!valid) {
+            return JOURNAL_KV_WRITE_ERROR;
+        }
+    }
+
+    // Nothing changes until the master record commits the new area
+    ret = write_master_record(to_area, to_version);
+    if (ret) {
+        return ret;
+    }
+
+    // Copies keep the index order, so the new offsets follow from the record sizes
+    uint32_t new_offset = _master_record_size;
+    for (size_t i = 0; i < _num_keys; i++) {
+        record_header_t hdr;
+        bool valid;
+        ret = read_header(_active_area, _ram_table[i].offset, &hdr, valid);
+        if (ret) {
+            return ret;
+        }
+        _ram_table[i].offset = new_offset;
+        new_offset += _header_slot_size + align_up(hdr.key_size + hdr.data_size, _prog_size);
+    }
+
+    _active_area = to_area;
+    _active_area_version = to_version;
+    _free_space_offset = offset;
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::find_record(const char *key, uint32_t hash, size_t &index)
+{
+    size_t key_size = strlen(key);
+    size_t low = 0, high = _num_keys;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (_ram_table[mid].hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    // Keys sharing a hash sit next to each other; compare them on the device
+    for (index = low; (index < _num_keys) && (_ram_table[index].hash == hash); index++) {
+        record_header_t hdr;
+        bool valid;
+        int ret = read_header(_active_area, _ram_table[index].offset, &hdr, valid);
+        if (ret) {
+            return ret;
+        }
+        if (!valid) {
+            return JOURNAL_KV_DATA_CORRUPT;
+        }
+        if (hdr.key_size != key_size) {
+            continue;
+        }
+        ret = read_area(_active_area, _ram_table[index].offset + _header_slot_size, key_size, _key_buf);
+        if (ret) {
+            return ret;
+        }
+        if (!memcmp(_key_buf, key, key_size)) {
+            return JOURNAL_KV_SUCCESS;
+        }
+    }
+    return JOURNAL_KV_NOT_FOUND;
+}
+
+int JournalKVStore::update_ram_table(const char *key, uint32_t hash, uint32_t offset, bool remove)
+{
+    size_t index;
+
+    int ret = find_record(key, hash, index);
+    if (ret == JOURNAL_KV_SUCCESS) {
+        if (remove) {
+            memmove(&_ram_table[index], &_ram_table[index + 1], (_num_keys - index - 1) * sizeof(ram_entry_t));
+            _num_keys--;
+        } else {
+            _ram_table[index].offset = offset;
+        }
+        return JOURNAL_KV_SUCCESS;
+    }
+    if (ret != JOURNAL_KV_NOT_FOUND) {
+        return ret;
+    }
+    if (remove) {
+        return JOURNAL_KV_SUCCESS;
+    }
+
+    if (_num_keys == _ram_table_size) {
+        ram_entry_t *table = new (std::nothrow) ram_entry_t[_ram_table_size * 2];
+        if (!table) {
+            return JOURNAL_KV_NO_MEMORY;
+        }
+        memcpy(table, _ram_table, _num_keys * sizeof(ram_entry_t));
+        delete[] _ram_table;
+        _ram_table = table;
+        _ram_table_size *= 2;
+    }
+    memmove(&_ram_table[index + 1], &_ram_table[index], (_num_keys - index) * sizeof(ram_entry_t));
+    _ram_table[index].hash = hash;
+    _ram_table[index].offset = offset;
+    _num_keys++;
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::build_ram_table(bool &needs_recovery)
+{
+    char key[max_key_size + 1];
+    uint32_t offset = _master_record_size;
+    bool corrupt = false;
+    int ret;
+
+    _num_keys = 0;
+    for (;;) {
+        uint32_t flags, data_size, next_offset;
+        bool valid;
+        ret = read_record(_active_area, offset, _active_area_version, key, flags, data_size, next_offset, valid);
+        if (ret == JOURNAL_KV_DATA_CORRUPT) {
+            // Only a device dropping writes leaves a committed record broken; skip it and compact
+            corrupt = true;
+            offset = next_offset;
+            continue;
+        }
+        if (ret) {
+            return ret;
+        }
+        if (!valid || (flags & master_flag)) {
+            break;
+        }
+        ret = update_ram_table(key, key_hash(key), offset, flags & delete_flag);
+        if (ret) {
+            return ret;
+        }
+        offset = next_offset;
+    }
+    _free_space_offset = offset;
+
+    // Anything but erased space after the last record is an interrupted write
+    bool blank;
+    ret = check_blank(_active_area, offset, blank);
+    if (ret) {
+        return ret;
+    }
+    needs_recovery = corrupt || !blank;
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::init()
+{
+    int ret = JOURNAL_KV_SUCCESS;
+
+    _mutex.lock();
+
+    if (_is_initialized) {
+        goto end;
+    }
+
+    if (_bd->init()) {
+        ret = JOURNAL_KV_READ_ERROR;
+        goto end;
+    }
+
+    {
+        bd_size_t erase_size = _bd->get_erase_size();
+        bd_size_t units = erase_size ? _bd->size() / erase_size : 0;
+        if (units < 2) {
+            ret = JOURNAL_KV_BAD_VALUE;
+            goto fail;
+        }
+        _area_size = (units / 2) * erase_size;
+        _area_addr[0] = 0;
+        _area_addr[1] = _area_size;
+        _prog_size = _bd->get_program_size();
+        _read_size = _bd->get_read_size();
+        _erase_value = _bd->get_erase_value();
+        _header_slot_size = align_up(sizeof(record_header_t), _prog_size);
+        _master_record_size = _header_slot_size + align_up(sizeof(master_record_data_t), _prog_size);
+        _work_buf_size = align_up(min_work_buf_size, std::max(_prog_size, _read_size));
+        if (_master_record_size > _area_size) {
+            ret = JOURNAL_KV_BAD_VALUE;
+            goto fail;
+        }
+    }
+
+    _work_buf = new (std::nothrow) uint8_t[_work_buf_size];
+    _write_buf = new (std::nothrow) uint8_t[std::max(_work_buf_size, _master_record_size)];
+    _read_buf = new (std::nothrow) uint8_t[_read_size];
+    _key_buf = new (std::nothrow) char[max_key_size + 1];
+    _ram_table = new (std::nothrow) ram_entry_t[initial_ram_table_size];
+    _ram_table_size = initial_ram_table_size;
+    if (!_work_buf || !_write_buf || !_read_buf || !_key_buf || !_ram_table) {
+        ret = JOURNAL_KV_NO_MEMORY;
+        goto fail;
+    }
+
+    {
+        uint16_t versions[2];
+        bool valid[2];
+        for (uint8_t area = 0; area < 2; area++) {
+            ret = read_master_record(area, versions[area], valid[area]);
+            if (ret) {
+                goto fail;
+            }
+        }
+
+        if (!valid[0] && !valid[1]) {
+            // Fresh device
+            _active_area = 0;
+            _active_area_version = 1;
+            ret = erase_area(0);
+            if (!ret) {
+                ret = write_master_record(0, 1);
+            }
+            if (ret) {
+                goto fail;
+            }
+        } else if (valid[0] && valid[1]) {
+            // An interrupted garbage collection never commits, so both valid means the newer wins
+            _active_area = ((int16_t)(versions[1] - versions[0]) > 0) ? 1 : 0;
+            _active_area_version = versions[_active_area];
+        } else {
+            _active_area = valid[0] ? 0 : 1;
+            _active_area_version = versions[_active_area];
+        }
+    }
+
+    {
+        bool needs_recovery;
+        ret = build_ram_table(needs_recovery);
+        if (ret) {
+            goto fail;
+        }
+        if (needs_recovery) {
+            ret = do_garbage_collection();
+            if (ret) {
+                goto fail;
+            }
+        }
+    }
+
+    _is_initialized = true;
+    goto end;
+
+fail:
+    delete[] _work_buf;
+    delete[] _write_buf;
+    delete[] _read_buf;
+    delete[] _key_buf;
+    delete[] _ram_table;
+    _work_buf = _write_buf = _read_buf = 0;
+    _key_buf = 0;
+    _ram_table = 0;
+    _num_keys = 0;
+    _bd->deinit();
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+int JournalKVStore::deinit()
+{
+    _mutex.lock();
+    if (_is_initialized) {
+        _is_initialized = false;
+        _inc_set.in_progress = false;
+        delete[] _work_buf;
+        delete[] _write_buf;
+        delete[] _read_buf;
+        delete[] _key_buf;
+        delete[] _ram_table;
+        _work_buf = _write_buf = _read_buf = 0;
+        _key_buf = 0;
+        _ram_table = 0;
+        _num_keys = 0;
+        _bd->deinit();
+    }
+    _mutex.unlock();
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::reset()
+{
+    int ret;
+
+    _mutex.lock();
+    if (!_is_initialized) {
+        _mutex.unlock();
+        return JOURNAL_KV_NOT_INITIALIZED;
+    }
+
+    // Commit an empty area first, then clear the old one
+    uint8_t to_area = 1 - _active_area;
+    ret = erase_area(to_area);
+    if (!ret) {
+        ret = write_master_record(to_area, _active_area_version + 1);
+    }
+    if (!ret) {
+        ret = erase_area(_active_area);
+        _active_area = to_area;
+        _active_area_version++;
+        _free_space_offset = _master_record_size;
+        _num_keys = 0;
+    }
+    _mutex.unlock();
+    return ret;
+}
+
+int JournalKVStore::write_buffered(const void *data, size_t size)
+{
+    const uint8_t *in = static_cast<const uint8_t *>(data);
+    int ret;
+
+    while (size) {
+        // Whole program units go straight to the device when nothing is staged
+        if (!_inc_set.buffered && (size >= _prog_size)) {
+            uint32_t chunk = size - size % _prog_size;
+            ret = write_area(_active_area, _inc_set.write_offset, chunk, in);
+            if (ret) {
+                return ret;
+            }
+            _inc_set.write_offset += chunk;
+            in += chunk;
+            size -= chunk;
+            continue;
+        }
+        uint32_t chunk = std::min((uint32_t) size, _work_buf_size - _inc_set.buffered);
+        memcpy(_write_buf + _inc_set.buffered, in, chunk);
+        _inc_set.buffered += chunk;
+        in += chunk;
+        size -= chunk;
+        if (_inc_set.buffered == _work_buf_size) {
+            ret = write_area(_active_area, _inc_set.write_offset, _work_buf_size, _write_buf);
+            if (ret) {
+                return ret;
+            }
+            _inc_set.write_offset += _work_buf_size;
+            _inc_set.buffered = 0;
+        }
+    }
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::do_set_start(const char *key, size_t final_data_size, uint32_t header_flags)
+{
+    size_t key_size;
+    size_t index;
+    int ret;
+
+    if (!_is_initialized) {
+        return JOURNAL_KV_NOT_INITIALIZED;
+    }
+    if (!key || _inc_set.in_progress) {
+        return JOURNAL_KV_BAD_VALUE;
+    }
+    key_size = strlen(key);
+    if (!key_size || (key_size > max_key_size) || (header_flags & ~(user_flags_mask | delete_flag))) {
+        return JOURNAL_KV_BAD_VALUE;
+    }
+
+    uint32_t hash = key_hash(key);
+    ret = find_record(key, hash, index);
+    if (ret == JOURNAL_KV_SUCCESS) {
+        record_header_t hdr;
+        bool valid;
+        ret = read_header(_active_area, _ram_table[index].offset, &hdr, valid);
+        if (ret) {
+            return ret;
+        }
+        if (hdr.flags & WRITE_ONCE_FLAG) {
+            return JOURNAL_KV_WRITE_PROTECTED;
+        }
+    } else if (ret != JOURNAL_KV_NOT_FOUND) {
+        return ret;
+    } else if (header_flags & delete_flag) {
+        return JOURNAL_KV_NOT_FOUND;
+    }
+
+    if (final_data_size > _area_size) {
+        return JOURNAL_KV_MEDIA_FULL;
+    }
+    uint32_t record_size = _header_slot_size + align_up(key_size + final_data_size, _prog_size);
+    if (_free_space_offset + record_size > _area_size) {
+        ret = do_garbage_collection();
+        if (ret) {
+            return ret;
+        }
+        if (_free_space_offset + record_size > _area_size) {
+            return JOURNAL_KV_MEDIA_FULL;
+        }
+    }
+
+    record_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = record_magic;
+    hdr.header_size = sizeof(record_header_t);
+    hdr.key_size = key_size;
+    hdr.flags = header_flags;
+    hdr.data_size = final_data_size;
+
+    memcpy(_inc_set.key, key, key_size + 1);
+    _inc_set.key_hash = hash;
+    _inc_set.header_flags = header_flags;
+    _inc_set.data_size = final_data_size;
+    _inc_set.data_left = final_data_size;
+    _inc_set.record_offset = _free_space_offset;
+    _inc_set.write_offset = _free_space_offset + _header_slot_size;
+    _inc_set.buffered = 0;
+    _inc_set.crc = crc32(crc32(initial_crc, crc_covered_size, &hdr), key_size, key);
+    _inc_set.in_progress = true;
+
+    ret = write_buffered(key, key_size);
+    if (ret) {
+        _inc_set.in_progress = false;
+        do_garbage_collection();
+    }
+    return ret;
+}
+
+int JournalKVStore::do_set_finalize()
+{
+    int ret = JOURNAL_KV_SUCCESS;
+
+    _inc_set.in_progress = false;
+
+    if (_inc_set.data_left) {
+        // The partial record is not committed, but its space is dirty: compact it away
+        ret = do_garbage_collection();
+        return ret ? ret : JOURNAL_KV_BAD_VALUE;
+    }
+
+    if (_inc_set.buffered) {
+        uint32_t size = align_up(_inc_set.buffered, _prog_size);
+        memset(_write_buf + _inc_set.buffered, blank_flash_val, size - _inc_set.buffered);
+        ret = write_area(_active_area, _inc_set.write_offset, size, _write_buf);
+        _inc_set.write_offset += size;
+    }
+
+    record_header_t hdr;
+    if (!ret) {
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = record_magic;
+        hdr.header_size = sizeof(record_header_t);
+        hdr.key_size = strlen(_inc_set.key);
+        hdr.flags = _inc_set.header_flags;
+        hdr.data_size = _inc_set.data_size;
+        hdr.version = _active_area_version;
+        hdr.crc = _inc_set.crc;
+        memset(_write_buf, blank_flash_val, _header_slot_size);
+        memcpy(_write_buf, &hdr, sizeof(hdr));
+        ret = write_area(_active_area, _inc_set.record_offset, _header_slot_size, _write_buf);
+    }
+
+    // The header commits the record; read it back so a device that drops writes is caught here
+    if (!ret) {
+        record_header_t written;
+        ret = read_area(_active_area, _inc_set.record_offset, sizeof(written), &written);
+        if (!ret && memcmp(&written, &hdr, sizeof(hdr))) {
+            ret = JOURNAL_KV_WRITE_ERROR;
+        }
+    }
+
+    if (ret) {
+        do_garbage_collection();
+        return ret;
+    }
+
+    _free_space_offset = _inc_set.write_offset;
+    return update_ram_table(_inc_set.key, _inc_set.key_hash, _inc_set.record_offset,
+                            _inc_set.header_flags & delete_flag);
+}
+
+int JournalKVStore::set_start(set_handle_t *handle, const char *key, size_t final_data_size, uint32_t flags)
+{
+    if (!handle || (flags & ~user_flags_mask)) {
+        return JOURNAL_KV_BAD_VALUE;
+    }
+
+    // Held until set_finalize()
+    _mutex.lock();
+    int ret = do_set_start(key, final_data_size, flags);
+    if (ret) {
+        _mutex.unlock();
+        return ret;
+    }
+    *handle = &_inc_set;
+    return JOURNAL_KV_SUCCESS;
+}
+
+int JournalKVStore::set_add_data(set_handle_t handle, const void *value_data, size_t data_size)
+{
+    if ((handle != &_inc_set) || !_inc_set.in_progress || (!value_data && data_size)) {
+        return JOURNAL_KV_BAD_VALUE;
+    }
+    if (data_size > _inc_set.data_left) {
+        return JOURNAL_KV_BAD_VALUE;
+    }
+
+    _mutex.lock();
+    _inc_set.crc = crc32(_inc_set.crc, data_size, value_data);
+    _inc_set.data_left -= data_size;
+    int ret = write_buffered(value_data, data_size);
+    _mutex.unlock();
+    return ret;
+}
+
+int JournalKVStore::set_finalize(set_handle_t handle)
+{
+    if ((handle != &_inc_set) || !_inc_set.in_progress) {
+        return JOURNAL_KV_BAD_VALUE;
+    }
+
+    int ret = do_set_finalize();
+    _mutex.unlock();
+    return ret;
+}
+
+int JournalKVStore::set(const char *key, const void *buffer, size_t size, uint32_t flags)
+{
+    if ((!buffer && size) || (flags & ~user_flags_mask)) {
+        return JOURNAL_KV_BAD_VALUE;
+    }
+
+    _mutex.lock();
+    int ret = do_set_start(key, size, flags);
+    if (!ret) {
+        _inc_set.crc = crc32(_inc_set.crc, size, buffer);
+        _inc_set.data_left = 0;
+        ret = write_buffered(buffer, size);
+        if (ret) {
+            _inc_set.in_progress = false;
+            do_garbage_collection();
+        } else {
+            ret = do_set_finalize();
+        }
+    }
+    _mutex.unlock();
+    return ret;
+}
+
+int JournalKVStore::remove(const char *key)
+{
+    _mutex.lock();
+    int ret = do_set_start(key, 0, delete_flag);
+    if (!ret) {
+        ret = do_set_finalize();
+    }
+    _mutex.unlock();
+    return ret;
+}
+
+int JournalKVStore::get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size, size_t offset)
+{
+    record_header_t hdr;
+    size_t index;
+    bool valid;
+    int ret;
+
+    if (!key || (!buffer && buffer_size)) {
+        return JOURNAL_KV_BAD_VALUE;
+    }
+
+    _mutex.lock();
+    if (!_is_initialized) {
+        ret = JOURNAL_KV_NOT_INITIALIZED;
+        goto end;
+    }
+
+    ret = find_record(key, key_hash(key), index);
+    if (ret) {
+        goto end;
+    }
+    ret = read_header(_active_area, _ram_table[index].offset, &hdr, valid);
+    if (ret) {
+        goto end;
+    }
+    if (offset > hdr.data_size) {
+        ret = JOURNAL_KV_BAD_VALUE;
+        goto end;
+    }
+
+    {
+        uint32_t data_offset = _ram_table[index].offset + _header_slot_size + hdr.key_size;
+        size_t size = std::min(buffer_size, (size_t)(hdr.data_size - offset));
+        ret = read_area(_active_area, data_offset + offset, size, buffer);
+        if (ret) {
+            goto end;
+        }
+
+        // A read of the whole value is checked against the record CRC
+        if (!offset && (size == hdr.data_size)) {
+            uint32_t crc = crc32(initial_crc, crc_covered_size, &hdr);
+            crc = crc32(crc, hdr.key_size, _key_buf);
+            crc = crc32(crc, size, buffer);
+            if (crc != hdr.crc) {
+                ret = JOURNAL_KV_DATA_CORRUPT;
+                goto end;
+            }
+        }
+        if (actual_size) {
+            *actual_size = size;
+        }
+    }
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+int JournalKVStore::get_info(const char *key, size_t *size, uint32_t *flags)
+{
+    record_header_t hdr;
+    size_t index;
+    bool valid;
+    int ret;
+
+    if (!key) {
+        return JOURNAL_KV_BAD_VALUE;
+    }
+
+    _mutex.lock();
+    if (!_is_initialized) {
+        ret = JOURNAL_KV_NOT_INITIALIZED;
+        goto end;
+    }
+    ret = find_record(key, key_hash(key), index);
+    if (ret) {
+        goto end;
+    }
+    ret = read_header(_active_area, _ram_table[index].offset, &hdr, valid);
+    if (ret) {
+        goto end;
+    }
+    if (size) {
+        *size = hdr.data_size;
+    }
+    if (flags) {
+        *flags = hdr.flags & user_flags_mask;
+    }
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+int JournalKVStore::garbage_collection()
+{
+    _mutex.lock();
+    int ret = _is_initialized ? do_garbage_collection() : JOURNAL_KV_NOT_INITIALIZED;
+    _mutex.unlock();
+    return ret;
+}
+
+size_t JournalKVStore::num_keys() const
+{
+    return _num_keys;
+}
+
+size_t JournalKVStore::free_space() const
+{
+    return _is_initialized ? _area_size - _free_space_offset : 0;
+}
@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2018 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_JOURNAL_KV_STORE_H
+#define MBED_JOURNAL_KV_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "BlockDevice.h"
+#include "platform/NonCopyable.h"
+#include "PlatformMutex.h"
+
+typedef enum {
+    JOURNAL_KV_SUCCESS              =  0,
+    JOURNAL_KV_READ_ERROR           = -1,
+    JOURNAL_KV_WRITE_ERROR          = -2,
+    JOURNAL_KV_NOT_FOUND            = -3,
+    JOURNAL_KV_DATA_CORRUPT         = -4,
+    JOURNAL_KV_BAD_VALUE            = -5,
+    JOURNAL_KV_MEDIA_FULL           = -6,
+    JOURNAL_KV_WRITE_PROTECTED      = -7,
+    JOURNAL_KV_NOT_INITIALIZED      = -8,
+    JOURNAL_KV_NO_MEMORY            = -9,
+} journal_kv_status_e;
+
+/** JournalKVStore class
+ *
+ *  Log-structured key-value store on top of any block device.
+ *
+ *  The device is split into two areas of whole erase units. Every set or
+ *  remove appends a CRC protected record to the active area and only
+ *  becomes visible once its header, which is programmed last, is on the
+ *  device, so a power loss leaves either the old value or the new one.
+ *  When the active area fills up, garbage collection copies the live
+ *  records to the other area and commits it by writing its master record,
+ *  so its cost is bounded by the size of the live data.
+ *
+ *  A RAM index sorted by key hash maps each key to its newest record,
+ *  so a get costs a binary search and one read of the record.
+ */
+class JournalKVStore : private mbed::NonCopyable<JournalKVStore> {
+public:
+    /** Record flags */
+    enum {
+        WRITE_ONCE_FLAG = 0x1,   ///< The key can neither be set again nor removed
+    };
+
+    /** Handle of an incremental set, see set_start() */
+    typedef void *set_handle_t;
+
+    /** Maximum key length, not counting the terminating null */
+    static const size_t max_key_size = 128;
+
+    /**
+     * @brief Create a store on a block device.
+     *
+     * @param[in]  bd                   Block device, it must have at least two erase units.
+     */
+    JournalKVStore(BlockDevice *bd);
+
+    virtual ~JournalKVStore();
+
+    /**
+     * @brief Initialize the block device, then rebuild the index from the active area,
+     *        recovering from an interrupted write if needed.
+     *
+     * @returns JOURNAL_KV_SUCCESS          Initialization completed successfully.
+     *          JOURNAL_KV_READ_ERROR       Physical error reading data.
+     *          JOURNAL_KV_WRITE_ERROR      Physical error writing data (on recovery).
+     *          JOURNAL_KV_BAD_VALUE        Block device too small or unsupported geometry.
+     *          JOURNAL_KV_NO_MEMORY        Index could not be allocated.
+     */
+    int init();
+
+    /**
+     * @brief Deinitialize the store and the block device.
+     *
+     * @returns JOURNAL_KV_SUCCESS          Deinitialization completed successfully.
+     */
+    int deinit();
+
+    /**
+     * @brief Erase all keys.
+     *
+     * @returns JOURNAL_KV_SUCCESS          Reset completed successfully.
+     *          JOURNAL_KV_WRITE_ERROR      Physical error writing data.
+     */
+    int reset();
+
+    /**
+     * @brief Set the value of a key, replacing any previous value.
+     *
+     * @param[in]  key                  Null terminated key.
+     * @param[in]  buffer               Value.
+     * @param[in]  size                 Value size in bytes, may be 0.
+     * @param[in]  flags                Record flags.
+     *
+     * @returns JOURNAL_KV_SUCCESS          Value was committed.
+     *          JOURNAL_KV_WRITE_ERROR      Physical error writing data.
+     *          JOURNAL_KV_BAD_VALUE        Bad value in any of the parameters.
+     *          JOURNAL_KV_MEDIA_FULL       Not enough space even after garbage collection.
+     *          JOURNAL_KV_WRITE_PROTECTED  Key was set with WRITE_ONCE_FLAG.
+     */
+    int set(const char *key, const void *buffer, size_t size, uint32_t flags = 0);
+
+    /**
+     * @brief Read the value of a key, or a part of it.
+     *
+     * @param[in]  key                  Null terminated key.
+     * @param[in]  buffer               Output buffer.
+     * @param[in]  buffer_size          Output buffer size in bytes.
+     * @param[out] actual_size          Number of bytes read, may be NULL.
+     * @param[in]  offset               Offset in the value to read from.
+     *
+     * @returns JOURNAL_KV_SUCCESS          Value was read. A read of the whole value is CRC checked.
+     *          JOURNAL_KV_READ_ERROR       Physical error reading data.
+     *          JOURNAL_KV_NOT_FOUND        Key does not exist.
+     *          JOURNAL_KV_DATA_CORRUPT     Record failed its CRC check.
+     *          JOURNAL_KV_BAD_VALUE        Bad value in any of the parameters.
+     */
+    int get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size = NULL, size_t offset = 0);
+
+    /**
+     * @brief Return the size and flags of a key's value.
+     *
+     * @param[in]  key                  Null terminated key.
+     * @param[out] size                 Value size in bytes, may be NULL.
+     * @param[out] flags                Record flags, may be NULL.
+     *
+     * @returns JOURNAL_KV_SUCCESS          Key exists.
+     *          JOURNAL_KV_READ_ERROR       Physical error reading data.
+     *          JOURNAL_KV_NOT_FOUND        Key does not exist.
+     *          JOURNAL_KV_BAD_VALUE        Bad value in any of the parameters.
+     */
+    int get_info(const char *key, size_t *size, uint32_t *flags = NULL);
+
+    /**
+     * @brief Remove a key.
+     *
+     * @param[in]  key                  Null terminated key.
+     *
+     * @returns JOURNAL_KV_SUCCESS          Key was removed.
+     *          JOURNAL_KV_WRITE_ERROR      Physical error writing data.
+     *          JOURNAL_KV_NOT_FOUND        Key does not exist.
+     *          JOURNAL_KV_BAD_VALUE        Bad value in any of the parameters.
+     *          JOURNAL_KV_MEDIA_FULL       Not enough space even after garbage collection.
+     *          JOURNAL_KV_WRITE_PROTECTED  Key was set with WRITE_ONCE_FLAG.
+     */
+    int remove(const char *key);
+
+    /**
+     * @brief Start an incremental set, for values too large to hold in RAM at once.
+     *        The store stays locked for other callers until set_finalize().
+     *
+     * @param[out] handle               Handle for set_add_data() and set_finalize().
+     * @param[in]  key                  Null terminated key.
+     * @param[in]  final_data_size      Total value size in bytes.
+     * @param[in]  flags                Record flags.
+     *
+     * @returns As set(), nothing is written on failure.
+     */
+    int set_start(set_handle_t *handle, const char *key, size_t final_data_size, uint32_t flags = 0);
+
+    /**
+     * @brief Append to the value of an incremental set.
+     *
+     * @param[in]  handle               Handle from set_start().
+     * @param[in]  value_data           Data.
+     * @param[in]  data_size            Data size in bytes.
+     *
+     * @returns JOURNAL_KV_SUCCESS          Data was written.
+     *          JOURNAL_KV_WRITE_ERROR      Physical error writing data.
+     *          JOURNAL_KV_BAD_VALUE        Bad handle, or more data than set_start() announced.
+     */
+    int set_add_data(set_handle_t handle, const void *value_data, size_t data_size);
+
+    /**
+     * @brief Commit an incremental set. If less data was added than set_start() announced,
+     *        the set is abandoned and the previous value is kept.
+     *
+     * @param[in]  handle               Handle from set_start().
+     *
+     * @returns JOURNAL_KV_SUCCESS          Value was committed.
+     *          JOURNAL_KV_WRITE_ERROR      Physical error writing data.
+     *          JOURNAL_KV_BAD_VALUE        Bad handle, or the data was incomplete.
+     */
+    int set_finalize(set_handle_t handle);
+
+    /**
+     * @brief Compact the active area now rather than when it fills up.
+     *
+     * @returns JOURNAL_KV_SUCCESS          Garbage collection completed.
+     *          JOURNAL_KV_READ_ERROR       Physical error reading data.
+     *          JOURNAL_KV_WRITE_ERROR      Physical error writing data.
+     */
+    int garbage_collection();
+
+    /**
+     * @brief Return the number of keys.
+     */
+    size_t num_keys() const;
+
+    /**
+     * @brief Return the space left in the active area, in bytes. Space held by
+     *        stale records comes back on the next garbage collection.
+     */
+    size_t free_space() const;
+
+private:
+    typedef struct {
+        uint32_t hash;
+        uint32_t offset;
+    } ram_entry_t;
+
+    typedef struct {
+        char key[max_key_size + 1];
+        uint32_t key_hash;
+        uint32_t header_flags;
+        uint32_t data_size;
+        uint32_t data_left;
+        uint32_t record_offset;
+        uint32_t write_offset;
+        uint32_t buffered;
+        uint32_t crc;
+        bool in_progress;
+    } inc_set_t;
+
+    BlockDevice *_bd;
+    PlatformMutex _mutex;
+    bool _is_initialized;
+    uint8_t _active_area;
+    uint16_t _active_area_version;
+    uint32_t _area_size;
+    uint32_t _area_addr[2];
+    uint32_t _free_space_offset;
+    uint32_t _prog_size;
+    uint32_t _read_size;
+    uint32_t _header_slot_size;
+    uint32_t _master_record_size;
+    int _erase_value;
+    ram_entry_t *_ram_table;
+    size_t _num_keys;
+    size_t _ram_table_size;
+    uint8_t *_work_buf;
+    uint8_t *_write_buf;
+    uint8_t *_read_buf;
+    uint32_t _work_buf_size;
+    char *_key_buf;
+    inc_set_t _inc_set;
+
+    /**
+     * @brief Read from an area, any alignment.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int read_area(uint8_t area, uint32_t offset, uint32_t size, void *buf);
+
+    /**
+     * @brief Program an area, aligned to the program size.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int write_area(uint8_t area, uint32_t offset, uint32_t size, const void *buf);
+
+    /**
+     * @brief Erase an area.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int erase_area(uint8_t area);
+
+    /**
+     * @brief Check that an area is erased from offset to its end.
+     *
+     * @param[out] blank                Whether the space is erased.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int check_blank(uint8_t area, uint32_t offset, bool &blank);
+
+    /**
+     * @brief Read a record header and check that it is well formed.
+     *
+     * @param[in]  area                 Area.
+     * @param[in]  offset               Record offset.
+     * @param[out] header               Record header.
+     * @param[out] valid                Whether the header is well formed. Only the CRC makes it intact.
+     *
+     * @returns 0 for success, nonzero for a read failure.
+     */
+    int read_header(uint8_t area, uint32_t offset, void *header, bool &valid);
+
+    /**
+     * @brief Read a record and verify its CRC.
+     *
+     * @param[in]  area                 Area.
+     * @param[in]  offset               Record offset.
+     * @param[in]  version              Version the area's records are stamped with.
+     * @param[out] key                  Key buffer of max_key_size + 1 bytes.
+     * @param[out] header_flags         Record flags.
+     * @param[out] data_size            Value size.
+     * @param[out] next_offset          Offset after the record.
+     * @param[out] valid                Whether the record is intact and stamped with version.
+     *
+     * @returns 0 for success, JOURNAL_KV_DATA_CORRUPT for a well formed record failing its CRC
+     *          (next_offset is still set), or a read failure.
+     */
+    int read_record(uint8_t area, uint32_t offset, uint16_t version, char *key, uint32_t &header_flags,
+                    uint32_t &data_size, uint32_t &next_offset, bool &valid);
+
+    /**
+     * @brief Write the master record of an area, committing it.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int write_master_record(uint8_t area, uint16_t version);
+
+    /**
+     * @brief Read the master record of an area.
+     *
+     * @param[out] version              Area version.
+     * @param[out] valid                Whether the area holds a valid master record.
+     *
+     * @returns 0 for success, nonzero for a read failure.
+     */
+    int read_master_record(uint8_t area, uint16_t &version, bool &valid);
+
+    /**
+     * @brief Copy a record to the other area, restamping it with that area's version.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int copy_record(uint8_t from_area, uint32_t from_offset, uint32_t to_offset,
+                    uint16_t to_version, uint32_t &next_offset);
+
+    /**
+     * @brief Garbage collection, called with the mutex held.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int do_garbage_collection();
+
+    /**
+     * @brief Build the RAM index from the active area and find its free space.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int build_ram_table(bool &needs_recovery);
+
+    /**
+     * @brief Find a key in the RAM index.
+     *
+     * @param[out] index                Index of the entry, or where to insert it.
+     *
+     * @returns 0 when found, JOURNAL_KV_NOT_FOUND or a read failure otherwise.
+     */
+    int find_record(const char *key, uint32_t hash, size_t &index);
+
+    /**
+     * @brief Point a key at a new record, or drop it.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int update_ram_table(const char *key, uint32_t hash, uint32_t offset, bool remove);
+
+    /**
+     * @brief Actual logics of set_start (covers also set and remove APIs), called with the mutex held.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int do_set_start(const char *key, size_t final_data_size, uint32_t header_flags);
+
+    /**
+     * @brief Stage record bytes in the write buffer, programming it whenever it fills.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int write_buffered(const void *data, size_t size);
+
+    /**
+     * @brief Actual logics of set_finalize, called with the mutex held.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int do_set_finalize();
+};
+
+#endif
@@ -64,6 +64,10 @@ static void initialize(const ticker_data_t *ticker)
 
     ticker->queue->event_handler = NULL;
     ticker->queue->head = NULL;
+#if MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
+    ticker->queue->count = 0;
+    ticker->queue->sequence = 0;
+#endif
     ticker->queue->tick_last_read = ticker->interface->read();
     ticker->queue->tick_remainder = 0;
     ticker->queue->frequency = frequency;
@@ -209,6 +213,266 @@ static timestamp_t compute_tick_round_up(const ticker_data_t *const ticker, us_t
     return (queue->tick_last_read + delta) & queue->bitmask;
 }
 
+#if MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
+/*
+ * Pending events are kept in a binary min-heap of linked nodes, ordered by
+ * timestamp and then by insertion order. The position of the last node
+ * follows from the number of nodes, so inserting and removing an event walks
+ * a single path between the head and a leaf: O(log n) steps inside the
+ * critical section instead of a walk through the sorted list.
+ */
+
+/**
+ * Return true if event a has to be dispatched before event b.
+ */
+static bool event_before(const ticker_event_t *a, const ticker_event_t *b)
+{
+    if (a->timestamp != b->timestamp) {
+        return a->timestamp < b->timestamp;
+    }
+    return (int32_t)(a->sequence - b->sequence) < 0;
+}
+
+/**
+ * Return the link holding the node at the 1 based breadth first position
+ * index, and the node that link belongs to.
+ */
+static ticker_event_t **heap_link(ticker_event_queue_t *queue, uint32_t index, ticker_event_t **parent)
+{
+    ticker_event_t **link = &queue->head;
+    *parent = NULL;
+
+    // The bits of index below its most significant one spell the path from
+    // the head: 0 for the left child, 1 for the right child
+    uint32_t bit = 1;
+    while (bit <= (index >> 1)) {
+        bit <<= 1;
+    }
+    for (bit >>= 1; bit; bit >>= 1) {
+        *parent = *link;
+        link = (index & bit) ? &(*link)->right : &(*link)->left;
+    }
+    return link;
+}
+
+/**
+ * Swap a node with its parent.
+ */
+static void heap_swap(ticker_event_queue_t *queue, ticker_event_t *parent, ticker_event_t *child)
+{
+    ticker_event_t *grandparent = parent->parent;
+    ticker_event_t *left = child->left;
+    ticker_event_t *right = child->right;
+    ticker_event_t *sibling;
+
+    if (parent->left == child) {
+        sibling = parent->right;
+        child->left = parent;
+        child->right = sibling;
+    } else {
+        sibling = parent->left;
+        child->left = sibling;
+        child->right = parent;
+    }
+    if (sibling) {
+        sibling->parent = child;
+    }
+
+    parent->left = left;
+    parent->right = right;
+    if (left) {
+        left->parent = parent;
+    }
+    if (right) {
+        right->parent = parent;
+    }
+
+    uint32_t index = parent->index;
+    parent->index = child->index;
+    child->index = index;
+
+    parent->parent = child;
+    child->parent = grandparent;
+    if (grandparent == NULL) {
+        queue->head = child;
+    } else if (grandparent->left == parent) {
+        grandparent->left = child;
+    } else {
+        grandparent->right = child;
+    }
+}
+
+static void heap_sift_up(ticker_event_queue_t *queue, ticker_event_t *obj)
+{
+    while (obj->parent && event_before(obj, obj->parent)) {
+        heap_swap(queue, obj->parent, obj);
+    }
+}
+
+static void heap_sift_down(ticker_event_queue_t *queue, ticker_event_t *obj)
+{
+    while (1) {
+        ticker_event_t *first = obj;
+        if (obj->left && event_before(obj->left, first)) {
+            first = obj->left;
+        }
+        if (obj->right && event_before(obj->right, first)) {
+            first = obj->right;
+        }
+        if (first == obj) {
+            break;
+        }
+        heap_swap(queue, obj, first);
+    }
+}
+
+/**
+ * Return true if the event is queued.
+ *
+ * The position recorded in the event is checked against the heap, so an
+ * event that was never inserted is recognised whatever its contents are.
+ */
+static bool heap_contains(ticker_event_queue_t *queue, const ticker_event_t *obj)
+{
+    if ((obj->index == 0) || (obj->index > queue->count)) {
+        return false;
+    }
+    ticker_event_t *parent;
+    return *heap_link(queue, obj->index, &parent) == obj;
+}
+
+/**
+ * Remove an event from the queue if it is queued.
+ *
+ * @return true if the event was the head of the queue.
+ */
+static bool queue_remove(ticker_event_queue_t *queue, ticker_event_t *obj)
+{
+    if (!heap_contains(queue, obj)) {
+        return false;
+    }
+    bool was_head = (queue->head == obj);
+
+    // Detach the last node, then move it to the place of the removed one
+    ticker_event_t *parent;
+    ticker_event_t **link = heap_link(queue, queue->count, &parent);
+    ticker_event_t *last = *link;
+    *link = NULL;
+    queue->count--;
+
+    if (last != obj) {
+        last->left = obj->left;
+        last->right = obj->right;
+        last->parent = obj->parent;
+        last->index = obj->index;
+        if (last->left) {
+            last->left->parent = last;
+        }
+        if (last->right) {
+            last->right->parent = last;
+        }
+        if (obj->parent == NULL) {
+            queue->head = last;
+        } else if (obj->parent->left == obj) {
+            obj->parent->left = last;
+        } else {
+            obj->parent->right = last;
+        }
+        heap_sift_down(queue, last);
+        heap_sift_up(queue, last);
+    }
+
+    obj->parent = NULL;
+    obj->left = NULL;
+    obj->right = NULL;
+    obj->index = 0;
+    return was_head;
+}
+
+/**
+ * Insert an event in the queue.
+ *
+ * @return true if the head of the queue changed.
+ */
+static bool queue_insert(ticker_event_queue_t *queue, ticker_event_t *obj)
+{
+    // An event inserted twice is moved rather than linked a second time
+    bool head_changed = queue_remove(queue, obj);
+
+    obj->sequence = queue->sequence++;
+    obj->left = NULL;
+    obj->right = NULL;
+
+    ticker_event_t *parent;
+    queue->count++;
+    *heap_link(queue, queue->count, &parent) = obj;
+    obj->parent = parent;
+    obj->index = queue->count;
+    heap_sift_up(queue, obj);
+
+    return head_changed || (queue->head == obj);
+}
+#else
+/**
+ * Remove an event from the queue if it is queued.
+ *
+ * @return true if the event was the head of the queue.
+ */
+static bool queue_remove(ticker_event_queue_t *queue, ticker_event_t *obj)
+{
+    // remove this object from the list
+    if (queue->head == obj) {
+        // first in the list, so just drop me
+        queue->head = obj->next;
+        return true;
+    }
+
+    // find the object before me, then drop me
+    ticker_event_t *p = queue->head;
+    while (p != NULL) {
+        if (p->next == obj) {
+            p->next = obj->next;
+            break;
+        }
+        p = p->next;
+    }
+    return false;
+}
+
+/**
+ * Insert an event in the queue.
+ *
+ * @return true if the head of the queue changed.
+ */
+static bool queue_insert(ticker_event_queue_t *queue, ticker_event_t *obj)
+{
+    /* Go through the list until we either reach the end, or find
+       an element this should come before (which is possibly the
+       head). */
+    ticker_event_t *prev = NULL, *p = queue->head;
+    while (p != NULL) {
+        /* check if we come before p */
+        if (obj->timestamp < p->timestamp) {
+            break;
+        }
+        /* go to the next element */
+        prev = p;
+        p = p->next;
+    }
+
+    /* if we're at the end p will be NULL, which is correct */
+    obj->next = p;
+
+    /* if prev is NULL we're at the head */
+    if (prev == NULL) {
+        queue->head = obj;
+        return true;
+    }
+    prev->next = obj;
+    return false;
+}
+#endif
+
 /**
  * Return 1 if the tick has incremented to or past match_tick, otherwise 0.
  */
@@ -308,7 +572,7 @@ void ticker_irq_handler(const ticker_data_t *const ticker)
             // This event was in the past:
             //      point to the following one and execute its handler
             ticker_event_t *p = ticker->queue->head;
-            ticker->queue->head = ticker->queue->head->next;
+            queue_remove(ticker->queue, p);
             if (ticker->queue->event_handler != NULL) {
                 (*ticker->queue->event_handler)(p->id); // NOTE: the handler can set new events
             }
@@ -356,29 +620,9 @@ void ticker_insert_event_us(const ticker_data_t *const ticker, ticker_event_t *o
     obj->timestamp = timestamp;
     obj->id = id;
 
-    /* Go through the list until we either reach the end, or find
-       an element this should come before (which is possibly the
-       head). */
-    ticker_event_t *prev = NULL, *p = ticker->queue->head;
-    while (p != NULL) {
-        /* check if we come before p */
-        if (timestamp < p->timestamp) {
-            break;
-        }
-        /* go to the next element */
-        prev = p;
-        p = p->next;
-    }
-
-    /* if we're at the end p will be NULL, which is correct */
-    obj->next = p;
-
-    /* if prev is NULL we're at the head */
-    if (prev == NULL) {
-        ticker->queue->head = obj;
+    // the interrupt only needs to move if the event became the head
+    if (queue_insert(ticker->queue, obj)) {
         schedule_interrupt(ticker);
-    } else {
-        prev->next = obj;
     }
 
     core_util_critical_section_exit();
@@ -388,21 +632,8 @@ void ticker_remove_event(const ticker_data_t *const ticker, ticker_event_t *obj)
 {
     core_util_critical_section_enter();
 
-    // remove this object from the list
-    if (ticker->queue->head == obj) {
-        // first in the list, so just drop me
-        ticker->queue->head = obj->next;
+    if (queue_remove(ticker->queue, obj)) {
         schedule_interrupt(ticker);
-    } else {
-        // find the object before me, then drop me
-        ticker_event_t *p = ticker->queue->head;
-        while (p != NULL) {
-            if (p->next == obj) {
-                p->next = obj->next;
-                break;
-            }
-            p = p->next;
-        }
     }
 
     core_util_critical_section_exit();
@@ -43,6 +43,13 @@ typedef struct ticker_event_s {
     us_timestamp_t         timestamp; /**< Event's timestamp */
     uint32_t               id;        /**< TimerEvent object */
     struct ticker_event_s *next;      /**< Next event in the queue */
+#if MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
+    struct ticker_event_s *parent;    /**< Parent in the heap, NULL for the head */
+    struct ticker_event_s *left;      /**< Left child in the heap */
+    struct ticker_event_s *right;     /**< Right child in the heap */
+    uint32_t               index;     /**< 1 based position in the heap, 0 when not queued */
+    uint32_t               sequence;  /**< Insertion order, breaks ties between equal timestamps */
+#endif
 } ticker_event_t;
 
 typedef void (*ticker_event_handler)(uint32_t id);
@@ -72,7 +79,11 @@ typedef struct {
  */
 typedef struct {
     ticker_event_handler event_handler; /**< Event handler */
-    ticker_event_t *head;               /**< A pointer to head */
+    ticker_event_t *head;               /**< A pointer to head, the earliest event */
+#if MBED_CONF_PLATFORM_TICKER_EVENT_HEAP
+    uint32_t count;                     /**< Number of events in the heap */
+    uint32_t sequence;                  /**< Insertion counter for the events */
+#endif
     uint32_t frequency;                 /**< Frequency of the timer in Hz */
     uint32_t bitmask;                   /**< Mask to be applied to time values read */
     uint32_t max_delta;                 /**< Largest delta in ticks that can be used when scheduling */
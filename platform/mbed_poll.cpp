@@ -15,9 +15,10 @@
  */
 #include "mbed_poll.h"
 #include "FileHandle.h"
+#include "mbed_critical.h"
 #if MBED_CONF_RTOS_PRESENT
 #include "rtos/Kernel.h"
-#include "rtos/Thread.h"
+#include "rtos/EventFlags.h"
 using namespace rtos;
 #else
 #include "drivers/Timer.h"
@@ -26,66 +27,135 @@ using namespace rtos;
 
 namespace mbed {
 
+#if MBED_CONF_RTOS_PRESENT
+#define POLL_FLAG_CHANGE 1
+
+// A thread blocked in poll(), woken by poll_change() on one of its file handles
+struct poll_waiter {
+    poll_waiter *next;
+    const pollfh *fhs;
+    unsigned nfhs;
+    EventFlags flags;
+};
+
+// Protected by critical sections, as poll_change() is called from interrupts
+static poll_waiter *poll_waiters;
+
+static void poll_waiter_add(poll_waiter *waiter)
+{
+    core_util_critical_section_enter();
+    waiter->next = poll_waiters;
+    poll_waiters = waiter;
+    core_util_critical_section_exit();
+}
+
+static void poll_waiter_remove(poll_waiter *waiter)
+{
+    core_util_critical_section_enter();
+    for (poll_waiter **p = &poll_waiters; *p; p = &(*p)->next) {
+        if (*p == waiter) {
+            *p = waiter->next;
+            break;
+        }
+    }
+    core_util_critical_section_exit();
+}
+#endif
+
+void poll_change(FileHandle *fh)
+{
+#if MBED_CONF_RTOS_PRESENT
+    core_util_critical_section_enter();
+    for (poll_waiter *waiter = poll_waiters; waiter; waiter = waiter->next) {
+        for (unsigned n = 0; n < waiter->nfhs; n++) {
+            if (waiter->fhs[n].fh == fh) {
+                waiter->flags.set(POLL_FLAG_CHANGE);
+                break;
+            }
+        }
+    }
+    core_util_critical_section_exit();
+#else
+    (void)fh;
+#endif
+}
+
+static int poll_scan(pollfh fhs[], unsigned nfhs)
+{
+    int count = 0;
+    for (unsigned n = 0; n < nfhs; n++) {
+        FileHandle *fh = fhs[n].fh;
+        short mask = fhs[n].events | POLLERR | POLLHUP | POLLNVAL;
+        if (fh) {
+            fhs[n].revents = fh->poll(mask) & mask;
+        } else {
+            fhs[n].revents = POLLNVAL;
+        }
+        if (fhs[n].revents) {
+            count++;
+        }
+    }
+    return count;
+}
+
 // timeout -1 forever, or milliseconds
 int poll(pollfh fhs[], unsigned nfhs, int timeout)
 {
-    /**
-     * TODO Proper wake-up mechanism.
-     * In order to correctly detect availability of read/write a FileHandle, we needed
-     * a select or poll mechanisms. We opted for poll as POSIX defines in
-     * http://pubs.opengroup.org/onlinepubs/009695399/functions/poll.html Currently,
-     * mbed::poll() just spins and scans filehandles looking for any events we are
-     * interested in. In future, his spinning behaviour will be replaced with
-     * condition variables.
-     */
+    int count = poll_scan(fhs, nfhs);
+    if (count || timeout == 0) {
+        return count;
+    }
+
 #if MBED_CONF_RTOS_PRESENT
-    uint64_t start_time = 0;
-    if (timeout > 0) {
-        start_time = Kernel::get_ms_count();
+    /* Sleep until poll_change() is called on one of the file handles, or until the timeout.
+     * The thread is registered before scanning again, so that no change is missed. */
+    uint64_t start_time = Kernel::get_ms_count();
+    poll_waiter waiter;
+    waiter.fhs = fhs;
+    waiter.nfhs = nfhs;
+    poll_waiter_add(&waiter);
+
+    for (;;) {
+        count = poll_scan(fhs, nfhs);
+        if (count) {
+            break;
+        }
+
+        /* File handles that do not call poll_change() are still noticed by a rescan */
+        uint32_t wait_time = MBED_CONF_PLATFORM_POLL_RESCAN_INTERVAL ? MBED_CONF_PLATFORM_POLL_RESCAN_INTERVAL : osWaitForever;
+        if (timeout > 0) {
+            int64_t elapsed = int64_t(Kernel::get_ms_count() - start_time);
+            if (elapsed > timeout) {
+                break;
+            }
+            if (uint32_t(timeout - elapsed + 1) < wait_time) {
+                wait_time = uint32_t(timeout - elapsed + 1);
+            }
+        }
+        waiter.flags.wait_any(POLL_FLAG_CHANGE, wait_time);
     }
-#define TIME_ELAPSED() int64_t(Kernel::get_ms_count() - start_time)
+
+    poll_waiter_remove(&waiter);
 #else
+    /* Without an RTOS there is nothing to wait on, scan until the timeout */
 #if MBED_CONF_PLATFORM_POLL_USE_LOWPOWER_TIMER
     LowPowerTimer timer;
 #else
     Timer timer;
 #endif
-    if (timeout > 0) {
-        timer.start();
-    }
-#define TIME_ELAPSED() timer.read_ms()
-#endif // MBED_CONF_RTOS_PRESENT
+    timer.start();
 
-    int count = 0;
     for (;;) {
-        /* Scan the file handles */
-        for (unsigned n = 0; n < nfhs; n++) {
-            FileHandle *fh = fhs[n].fh;
-            short mask = fhs[n].events | POLLERR | POLLHUP | POLLNVAL;
-            if (fh) {
-                fhs[n].revents = fh->poll(mask) & mask;
-            } else {
-                fhs[n].revents = POLLNVAL;
-            }
-            if (fhs[n].revents) {
-                count++;
-            }
-        }
-
+        count = poll_scan(fhs, nfhs);
         if (count) {
             break;
         }
-
-        /* Nothing selected - this is where timeout handling would be needed */
-        if (timeout == 0 || (timeout > 0 && TIME_ELAPSED() > timeout)) {
+        if (timeout > 0 && timer.read_ms() > timeout) {
             break;
         }
-#ifdef MBED_CONF_RTOS_PRESENT
-        // TODO - proper blocking
-        // wait for condition variable, wait queue whatever here
-        rtos::Thread::wait(1);
-#endif
     }
+#endif // MBED_CONF_RTOS_PRESENT
+
     return count;
 }
 
@@ -51,6 +51,17 @@ struct pollfh {
  */
 int poll(pollfh fhs[], unsigned nfhs, int timeout);
 
+/** Notify poll() that the state of a file handle may have changed.
+ *
+ * FileHandle implementations call this, from thread or interrupt context, whenever
+ * events reported by their poll() may have changed, alongside calling the sigio() callback.
+ * Threads blocked in poll() on this file handle are woken up to rescan it. File handles
+ * that do not call it are only rescanned every platform.poll-rescan-interval milliseconds.
+ *
+ * @param fh      the file handle whose state may have changed
+ */
+void poll_change(FileHandle *fh);
+
 /**@}*/
 
 /**@}*/
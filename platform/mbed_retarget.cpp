@@ -155,6 +155,9 @@ public:
         return 0;
     }
     virtual short poll(short events) const;
+
+private:
+    static void irq(uint32_t id, SerialIrq event);
 };
 
 DirectSerial::DirectSerial(PinName tx, PinName rx, int baud)
@@ -201,8 +204,29 @@ short DirectSerial::poll(short events) const
     if ((events & POLLOUT) && serial_writable(&stdio_uart)) {
         revents |= POLLOUT;
     }
+#if MBED_CONF_RTOS_PRESENT
+    /* Arm the interrupts of the events not ready, to wake a thread waiting in mbed::poll().
+     * The interrupt is disabled again when it fires, so it wakes the thread once. */
+    short waiting = events & ~revents & (POLLIN | POLLOUT);
+    if (waiting) {
+        serial_irq_handler(&stdio_uart, DirectSerial::irq, (uint32_t)this);
+        if (waiting & POLLIN) {
+            serial_irq_set(&stdio_uart, RxIrq, 1);
+        }
+        if (waiting & POLLOUT) {
+            serial_irq_set(&stdio_uart, TxIrq, 1);
+        }
+    }
+#endif
     return revents;
 }
+
+void DirectSerial::irq(uint32_t id, SerialIrq event)
+{
+    // The condition stays pending until the data is read or written, so it must not fire again
+    serial_irq_set(&stdio_uart, event, 0);
+    poll_change(reinterpret_cast<DirectSerial *>(id));
+}
 #endif
 
 class Sink : public FileHandle {
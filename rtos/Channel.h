@@ -0,0 +1,348 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "cmsis_os2.h"
+#include "mbed_rtos_storage.h"
+#include "platform/mbed_assert.h"
+#include "platform/mbed_critical.h"
+#include "platform/NonCopyable.h"
+
+namespace rtos {
+/** \addtogroup rtos */
+/** @{*/
+/**
+ * \defgroup rtos_Channel Channel class
+ * @{
+ */
+
+/** The Channel class passes messages between threads and interrupt service routines by value.
+ Unlike Queue, which carries pointers, and Mail, which pairs a Queue with a MemoryPool, a Channel
+ copies each message into a slot of its own storage, so sending a small structure needs no allocation
+ and no kernel call unless a thread has to be woken.
+
+ Slots are claimed with atomic compare-and-swap, so try_put() and try_get() never take a lock and are
+ safe from any number of threads and interrupts. Blocking calls sleep on a single event flags object,
+ which is only signalled while somebody is waiting.
+
+  @tparam  T         data type of a single message, copied in and out by assignment.
+  @tparam  queue_sz  maximum number of messages in the channel, a power of two.
+
+ @note
+ Memory considerations: The messages and control structures will be created on current thread's stack,
+ both for the mbed OS and underlying RTOS objects (static or dynamic RTOS memory pools are not being used).
+*/
+template<typename T, uint32_t queue_sz>
+class Channel : private mbed::NonCopyable<Channel<T, queue_sz> > {
+    MBED_STRUCT_STATIC_ASSERT(queue_sz > 0 && (queue_sz & (queue_sz - 1)) == 0,
+                              "Channel size must be a power of two");
+
+public:
+    /** Create and initialize a Channel.
+     *
+     * @note You cannot call this function from ISR context.
+    */
+    Channel() : _put_pos(0), _get_pos(0), _put_waiters(0), _get_waiters(0)
+    {
+        for (uint32_t i = 0; i < queue_sz; i++) {
+            _slots[i].sequence = 2 * i;
+        }
+        memset(&_obj_mem, 0, sizeof(_obj_mem));
+        osEventFlagsAttr_t attr = { 0 };
+        attr.name = "channel";
+        attr.cb_mem = &_obj_mem;
+        attr.cb_size = sizeof(_obj_mem);
+        _id = osEventFlagsNew(&attr);
+        MBED_ASSERT(_id);
+    }
+
+    /** Channel destructor
+     *
+     * @note You cannot call this function from ISR context.
+     */
+    ~Channel()
+    {
+        osEventFlagsDelete(_id);
+    }
+
+    /** Check if the channel is empty
+     *
+     * @return True if the channel is empty, false if not
+     *
+     * @note You may call this function from ISR context.
+     */
+    bool empty() const
+    {
+        return count() == 0;
+    }
+
+    /** Check if the channel is full
+     *
+     * @return True if the channel is full, false if not
+     *
+     * @note You may call this function from ISR context.
+     */
+    bool full() const
+    {
+        return count() >= queue_sz;
+    }
+
+    /** Number of messages in the channel. Only a snapshot while other contexts use the channel.
+     *
+     * @return number of messages waiting to be received
+     *
+     * @note You may call this function from ISR context.
+     */
+    uint32_t count() const
+    {
+        // Read the consumer side first, so a get racing with this call cannot make the count negative
+        uint32_t get_pos = _get_pos;
+        uint32_t used = _put_pos - get_pos;
+        return used > queue_sz ? queue_sz : used;
+    }
+
+    /** Put a message in the channel without blocking.
+      @param   value     message copied into the channel.
+      @return  true if the message was sent, false if the channel was full.
+
+      @note You may call this function from ISR context.
+    */
+    bool try_put(const T &value)
+    {
+        if (!put_slot(&value, NULL)) {
+            return false;
+        }
+        notify_put();
+        return true;
+    }
+
+    /** Put a message in the channel, waiting for space if it is full.
+      @param   value     message copied into the channel.
+      @param   millisec  timeout value or 0 in case of no time-out. (default: osWaitForever)
+      @return  true if the message was sent, false if the channel stayed full for the given time.
+
+      @note You may call this function from ISR context if the millisec parameter is set to 0.
+    */
+    bool put(const T &value, uint32_t millisec = osWaitForever)
+    {
+        if (!put_slot(&value, NULL) && !wait(_put_waiters, flag_space, millisec, &Channel::put_slot, &value, NULL)) {
+            return false;
+        }
+        notify_put();
+        return true;
+    }
+
+    /** Get a message from the channel without blocking.
+      @param   value     receives the message.
+      @return  true if a message was received, false if the channel was empty.
+
+      @note You may call this function from ISR context.
+    */
+    bool try_get(T &value)
+    {
+        if (!get_slot(NULL, &value)) {
+            return false;
+        }
+        notify_get();
+        return true;
+    }
+
+    /** Get a message from the channel, waiting for one if it is empty.
+      @param   value     receives the message.
+      @param   millisec  timeout value or 0 in case of no time-out. (default: osWaitForever)
+      @return  true if a message was received, false if none arrived in the given time.
+
+      @note You may call this function from ISR context if the millisec parameter is set to 0.
+    */
+    bool get(T &value, uint32_t millisec = osWaitForever)
+    {
+        if (!get_slot(NULL, &value) && !wait(_get_waiters, flag_data, millisec, &Channel::get_slot, NULL, &value)) {
+            return false;
+        }
+        notify_get();
+        return true;
+    }
+
+    /** Receive up to max messages at once.
+      Waits up to millisec for the first message, then takes whatever else is already in the channel,
+      so a consumer can work through a burst with one wakeup.
+      @param   values    array receiving the messages, in order.
+      @param   max       size of the values array.
+      @param   millisec  timeout for the first message or 0 in case of no time-out. (default: 0)
+      @return  number of messages received.
+
+      @note You may call this function from ISR context if the millisec parameter is set to 0.
+    */
+    uint32_t drain(T *values, uint32_t max, uint32_t millisec = 0)
+    {
+        if (max == 0 || !get(values[0], millisec)) {
+            return 0;
+        }
+        uint32_t received = 1;
+        while (received < max && get_slot(NULL, &values[received])) {
+            received++;
+        }
+        if (received > 1) {
+            notify_get();
+        }
+        return received;
+    }
+
+private:
+    struct Slot {
+        volatile uint32_t sequence;
+        T value;
+    };
+
+    typedef bool (Channel::*attempt_t)(const T *in, T *out);
+
+    static const uint32_t flag_data = 0x1;
+    static const uint32_t flag_space = 0x2;
+
+    /* The slot for position pos is free for a producer while its sequence equals 2 * pos, and
+     * holds a message for a consumer once it equals 2 * pos + 1. Each side claims a position by
+     * advancing its counter with compare-and-swap, copies the message, then hands the slot over
+     * by moving the sequence on, after a get to 2 * (pos + queue_sz) for the next lap. Doubling
+     * keeps "full" and "free for the next position" apart even with a single slot.
+     */
+    Slot *claim(volatile uint32_t &counter, uint32_t lag, uint32_t &pos)
+    {
+        pos = counter;
+        for (;;) {
+            Slot *slot = &_slots[pos & (queue_sz - 1)];
+            int32_t diff = (int32_t)(slot->sequence - (2 * pos + lag));
+            if (diff == 0) {
+                if (core_util_atomic_cas_u32(&counter, &pos, pos + 1)) {
+                    return slot;
+                }
+            } else if (diff < 0) {
+                return NULL;
+            } else {
+                pos = counter;
+            }
+        }
+    }
+
+    bool put_slot(const T *in, T *)
+    {
+        uint32_t pos;
+        Slot *slot = claim(_put_pos, 0, pos);
+        if (slot == NULL) {
+            return false;
+        }
+        slot->value = *in;
+        publish(slot, 2 * pos, 2 * pos + 1);
+        return true;
+    }
+
+    bool get_slot(const T *, T *out)
+    {
+        uint32_t pos;
+        Slot *slot = claim(_get_pos, 1, pos);
+        if (slot == NULL) {
+            return false;
+        }
+        *out = slot->value;
+        publish(slot, 2 * pos + 1, 2 * (pos + queue_sz));
+        return true;
+    }
+
+    /* The message copy sits between two atomic calls, the claim and this one, which the
+     * compiler cannot move it across.
+     */
+    static void publish(Slot *slot, uint32_t current, uint32_t next)
+    {
+        core_util_atomic_cas_u32(&slot->sequence, &current, next);
+    }
+
+    void notify_put()
+    {
+        if (_get_waiters) {
+            osEventFlagsSet(_id, flag_data);
+        }
+        // Pass on a wakeup this thread may have taken in place of another producer
+        if (_put_waiters && !full()) {
+            osEventFlagsSet(_id, flag_space);
+        }
+    }
+
+    void notify_get()
+    {
+        if (_put_waiters) {
+            osEventFlagsSet(_id, flag_space);
+        }
+        if (_get_waiters && !empty()) {
+            osEventFlagsSet(_id, flag_data);
+        }
+    }
+
+    bool wait(volatile uint32_t &waiters, uint32_t flag, uint32_t millisec,
+              attempt_t attempt, const T *in, T *out)
+    {
+        if (millisec == 0) {
+            return false;
+        }
+        uint32_t start = osKernelGetTickCount();
+        bool done = false;
+        core_util_atomic_incr_u32(&waiters, 1);
+        for (;;) {
+            // Retry once registered, so a notification sent before the wait is not lost
+            if ((this->*attempt)(in, out)) {
+                done = true;
+                break;
+            }
+            uint32_t timeout = osWaitForever;
+            if (millisec != osWaitForever) {
+                uint32_t elapsed = osKernelGetTickCount() - start;
+                if (elapsed >= millisec) {
+                    break;
+                }
+                timeout = millisec - elapsed;
+            }
+            uint32_t ret = osEventFlagsWait(_id, flag, osFlagsWaitAny, timeout);
+            if ((ret & osFlagsError) && ret != osFlagsErrorTimeout) {
+                break;
+            }
+        }
+        core_util_atomic_decr_u32(&waiters, 1);
+        return done;
+    }
+
+    Slot _slots[queue_sz];
+    volatile uint32_t _put_pos;
+    volatile uint32_t _get_pos;
+    volatile uint32_t _put_waiters;
+    volatile uint32_t _get_waiters;
+    osEventFlagsId_t _id;
+    mbed_rtos_storage_event_flags_t _obj_mem;
+};
+
+/** @}*/
+/** @}*/
+
+} // namespace rtos
+
+#endif
@@ -29,6 +29,7 @@
 #include "mbed_rtos1_types.h"
 #include "mbed_rtos_storage.h"
 #include "platform/NonCopyable.h"
+#include "platform/mbed_assert.h"
 
 namespace rtos {
 /** \addtogroup rtos */
@@ -28,6 +28,7 @@
 #include "cmsis_os2.h"
 #include "mbed_rtos_storage.h"
 #include "platform/mbed_error.h"
+#include "platform/mbed_assert.h"
 #include "platform/NonCopyable.h"
 #include "mbed_rtos1_types.h"
 